@@ -3,10 +3,14 @@ from gym import error, spaces, utils
 from gym.utils import seeding
 import numpy as np
 import ctypes
+import sys
+
+from stable_baselines3.common.vec_env import VecEnv
 
 class PhysicsDLL() :
     def __init__(self):
-        self._physics = ctypes.CDLL('bin/Release_x86_64/Physics-Lib.dll')
+        library = 'bin/Release_x86_64/Physics-Lib.dll' if sys.platform == 'win32' else 'bin/Release_x86_64/libPhysics-Lib.so'
+        self._physics = ctypes.CDLL(library)
 
         self._physics.updatePhysics.argtypes = (ctypes.POINTER(ctypes.c_float), ctypes.POINTER(ctypes.c_float))
         self._physics.resetPhysics.argtypes = (ctypes.POINTER(ctypes.c_float),)
@@ -45,6 +49,57 @@ class PhysicsDLL() :
         return result_state, out_reward[0], done != 0
 
 
+def _float_ptr(array):
+    return array.ctypes.data_as(ctypes.POINTER(ctypes.c_float))
+
+def _int_ptr(array):
+    return array.ctypes.data_as(ctypes.POINTER(ctypes.c_int))
+
+def _aligned_zeros(shape, dtype, alignment=64):
+    nbytes = int(np.prod(shape)) * np.dtype(dtype).itemsize
+    buffer = np.zeros(nbytes + alignment, dtype=np.uint8)
+    offset = (-buffer.ctypes.data) % alignment
+    return buffer[offset:offset + nbytes].view(dtype).reshape(shape)
+
+
+class BatchedPhysicsDLL(PhysicsDLL) :
+    """Owns num_envs environments inside the DLL, which are stepped in parallel in one call.
+    The state, action, reward and done arrays are allocated once and registered with the DLL, which reads and writes them in place.
+    Write the actions into self.actions before stepping. If history_length > 0, self.state_history holds the last states of each environment."""
+
+    def __init__(self, num_envs, seed=0, history_length=0):
+        super(BatchedPhysicsDLL, self).__init__()
+
+        self._physics.createPhysicsEnvironments.argtypes = (ctypes.c_int, ctypes.c_int)
+        self._physics.registerPhysicsBuffers.argtypes = (ctypes.POINTER(ctypes.c_float), ctypes.POINTER(ctypes.c_float), ctypes.POINTER(ctypes.c_float),
+            ctypes.POINTER(ctypes.c_int), ctypes.POINTER(ctypes.c_float), ctypes.c_int)
+        self._physics.resetRegisteredPhysics.argtypes = (ctypes.c_int,)
+
+        self.num_envs = num_envs
+        self._physics.createPhysicsEnvironments(num_envs, seed)
+
+        self.states = _aligned_zeros((num_envs, self.state_size), np.float32)
+        self.actions = _aligned_zeros((num_envs, self.action_size), np.float32)
+        self.rewards = _aligned_zeros((num_envs,), np.float32)
+        self.dones = _aligned_zeros((num_envs,), np.int32)
+        self.state_history = _aligned_zeros((num_envs, history_length, self.state_size), np.float32) if history_length > 0 else None
+
+        self._physics.registerPhysicsBuffers(_float_ptr(self.states), _float_ptr(self.actions), _float_ptr(self.rewards), _int_ptr(self.dones),
+            _float_ptr(self.state_history) if self.state_history is not None else None, history_length)
+
+    def reset(self, only_done=False):
+        """Resets the environments whose done flag is set (all, if only_done is False). Returns the states of all environments."""
+        self._physics.resetRegisteredPhysics(1 if only_done else 0)
+        return self.states
+
+    def step(self, actions=None):
+        if actions is not None:
+            self.actions[:] = actions
+
+        self._physics.updateRegisteredPhysics()
+        return self.states, self.rewards, self.dones
+
+
 # https://blog.paperspace.com/creating-custom-environments-openai-gym/
 # Simple example: https://github.com/openai/gym/blob/master/gym/envs/classic_control/pendulum.py
 
@@ -77,6 +132,64 @@ class LocoEnv(gym.Env):
     
 
 
+class LocoVecEnv(VecEnv):
+    """All environments live in the DLL and are stepped with one call. Environments which are done are reset automatically."""
+
+    def __init__(self, num_envs, seed=0):
+        self.dll = BatchedPhysicsDLL(num_envs, seed)
+
+        observation_space = spaces.Box(np.float32(self.dll.state_min), np.float32(self.dll.state_max))
+        action_space = spaces.Box(np.float32(self.dll.action_min), np.float32(self.dll.action_max))
+        super(LocoVecEnv, self).__init__(num_envs, observation_space, action_space)
+
+        self.actions = None
+
+    def reset(self):
+        return self.dll.reset().copy()
+
+    def step_async(self, actions):
+        self.actions = actions
+
+    def step_wait(self):
+        states, rewards, dones = self.dll.step(self.actions)
+
+        done = dones != 0
+        infos = [{} for _ in range(self.num_envs)]
+        for i in np.nonzero(done)[0]:
+            infos[i]["terminal_observation"] = states[i].copy()
+
+        if done.any():
+            states = self.dll.reset(only_done=True)
+
+        return states.copy(), rewards.copy(), done, infos
+
+    def close(self):
+        pass
+
+    def seed(self, seed=None):
+        return [None] * self.num_envs
+
+    def get_attr(self, attr_name, indices=None):
+        return [getattr(self, attr_name)] * len(self._get_indices(indices))
+
+    def set_attr(self, attr_name, value, indices=None):
+        setattr(self, attr_name, value)
+
+    def env_method(self, method_name, *method_args, indices=None, **method_kwargs):
+        raise NotImplementedError
+
+    def env_is_wrapped(self, wrapper_class, indices=None):
+        return [False] * len(self._get_indices(indices))
+
+    def _get_indices(self, indices):
+        if indices is None:
+            return range(self.num_envs)
+        if isinstance(indices, int):
+            return [indices]
+        return indices
+
+
+
 # For testing only.
 
 def main():
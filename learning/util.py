@@ -28,10 +28,10 @@ def make_env(env_type, rank, seed=0):
 
 
 def make_loco_env(log_dir) :
-    env_type = loco_env.LocoEnv
     num_cpu = 16
     
-    env = SubprocVecEnv([make_env(env_type, i) for i in range(num_cpu)])
+    # All environments are stepped in parallel inside the DLL, so no subprocesses are needed.
+    env = loco_env.LocoVecEnv(num_cpu)
     env = VecMonitor(env, log_dir)
     torch.set_num_threads(num_cpu)
     return env
@@ -2,11 +2,16 @@ local gpu_name = ""
 local gpu_model_number = 0
 local sdk_version = 0
 
+-- On Linux, only the physics library is generated. The renderer requires D3D12.
+local renderer_supported = os.target() == "windows"
+
 
 -------------------------
 -- CHECK GPU
 -------------------------
 
+if renderer_supported then
+
 local gpu_handle = io.popen("wmic path win32_VideoController get name")
 local gpu_string = gpu_handle:read("*a")
 gpu_handle:close()
@@ -35,6 +40,8 @@ for filename in sdk_directory_handle:lines() do
 end
 sdk_directory_handle:close()
 
+end
+
 
 print("Windows SDK version: ", sdk_version)
 print("Installed GPU: ", gpu_name)
@@ -57,7 +64,7 @@ end
 
 local mesh_shaders_supported = turing_or_higher and new_sdk_available
 
-if not mesh_shaders_supported then
+if renderer_supported and not mesh_shaders_supported then
 	term.pushColor(term.infoColor)
 	print("Disabling mesh shader compilation, since not all requirements are met.")
 	term.popColor()
@@ -71,6 +78,8 @@ print("\n")
 -- GENERATING SHADERS
 -------------------------
 
+if renderer_supported then
+
 print("Generating custom shaders..")
 
 local generated_directory = "shaders/generated/"
@@ -127,6 +136,8 @@ end
 
 print("\n")
 
+end
+
 
 -- Premake extension to include files at solution-scope. From https://github.com/premake/premake-core/issues/1061#issuecomment-441417853
 
@@ -152,6 +163,88 @@ premake.override(premake.vstudio.sln2005, "projects", function(base, wks)
 end)
 
 
+newoption {
+	trigger = "physics-32bit-indices",
+	description = "Use 32-bit indices in the physics pipeline, for scenes with more than 65535 colliders or rigid bodies",
+}
+
+newoption {
+	trigger = "physics-deterministic",
+	description = "Bit-identical physics results across machines. Disables fast floating point math",
+}
+
+newoption {
+	trigger = "physics-avx512",
+	description = "Compile with AVX-512. The constraint solver and the narrow phase then process 16 lanes instead of 8",
+}
+
+newoption {
+	trigger = "physics-no-simd-dispatch",
+	description = "Compile the physics library and benchmark for a fixed instruction set (AVX2, or AVX-512 with --physics-avx512) instead of selecting the SIMD kernels at runtime",
+}
+
+local physics_simd_dispatch = not _OPTIONS["physics-no-simd-dispatch"]
+
+
+-- Adds the physics SIMD kernels to the current project. With runtime dispatch (see src/core/simd_dispatch.h), the project is compiled for SSE2
+-- and each kernel is compiled once per instruction set. Otherwise the kernels are compiled once, with the project's flags.
+function physics_simd_kernels()
+	if not physics_simd_dispatch then
+		vectorextensions "AVX2"
+
+		files {
+			"src/physics/*_simd.cpp",
+		}
+
+		filter { "options:physics-avx512", "system:windows" }
+			buildoptions { "/arch:AVX512" }
+
+		filter { "options:physics-avx512", "system:linux" }
+			buildoptions { "-mavx512f", "-mavx512bw", "-mavx512dq", "-mavx512vl" }
+
+		filter "system:linux"
+			buildoptions { "-mfma" }
+
+		filter {}
+		return
+	end
+
+	vectorextensions "SSE2"
+
+	defines {
+		"PHYSICS_SIMD_DISPATCH=1",
+	}
+
+	-- The kernel files are only compiled through the wrappers, which come last, so that the linker prefers the SSE2 copies of shared inline functions.
+	files {
+		"src/physics/*_simd.cpp",
+		"src/physics/simd_kernels/*_sse2.cpp",
+		"src/physics/simd_kernels/*_avx2.cpp",
+		"src/physics/simd_kernels/*_avx512.cpp",
+	}
+
+	filter "files:src/physics/*_simd.cpp"
+		flags { "ExcludeFromBuild" }
+
+	filter "files:src/physics/simd_kernels/**"
+		flags { "NoPCH" }
+
+	filter { "files:src/physics/simd_kernels/*_avx2.cpp" }
+		vectorextensions "AVX2"
+
+	filter { "files:src/physics/simd_kernels/*_avx2.cpp", "system:linux" }
+		buildoptions { "-mavx2", "-mfma" }
+
+	filter { "files:src/physics/simd_kernels/*_avx512.cpp", "system:windows" }
+		buildoptions { "/arch:AVX512" }
+
+	filter { "files:src/physics/simd_kernels/*_avx512.cpp", "system:linux" }
+		buildoptions { "-mavx2", "-mfma", "-mavx512f", "-mavx512bw", "-mavx512dq", "-mavx512vl" }
+
+	filter {}
+end
+
+
 -----------------------------------------
 -- GENERATE SOLUTION
 -----------------------------------------
@@ -175,11 +268,21 @@ workspace "D3D12Renderer"
 		"LICENSE",
     }
 
+	filter "options:physics-32bit-indices"
+		defines { "PHYSICS_32BIT_INDICES=1" }
+
+	filter "options:physics-deterministic"
+		defines { "PHYSICS_DETERMINISTIC=1" }
+
+	filter {}
+
 
 outputdir = "%{cfg.buildcfg}_%{cfg.architecture}"
 shaderoutputdir = "shaders/bin/%{cfg.buildcfg}/"
 
 
+if renderer_supported then
+
 group "Dependencies"
 	include "ext/directxtex"
 	include "ext/yaml-cpp"
@@ -218,6 +321,11 @@ project "D3D12Renderer"
 		"shaders/**.hlsl*",
 	}
 
+	removefiles {
+		"src/benchmark/**",
+		"src/physics/simd_kernels/**",
+	}
+
 	vpaths {
 		["Headers/*"] = { "src/**.h" },
 		["Sources/*"] = { "src/**.cpp" },
@@ -266,6 +374,14 @@ project "D3D12Renderer"
 	vectorextensions "AVX2"
 	floatingpoint "Fast"
 
+	filter "options:physics-deterministic"
+		floatingpoint "Default"
+
+	filter "options:physics-avx512"
+		buildoptions { "/arch:AVX512" }
+
+	filter {}
+
 	filter "configurations:Debug"
         runtime "Debug"
 		symbols "On"
@@ -379,6 +495,8 @@ project "D3D12Renderer"
 			shadermodel "6.5" -- Required for amplification shaders.
 	end
 
+end -- renderer_supported
+
 
 
 -----------------------------------------
@@ -412,9 +530,13 @@ project "Physics-Lib"
 		"ext",
 	}
 
-	vectorextensions "AVX2"
 	floatingpoint "Fast"
 
+	filter "options:physics-deterministic"
+		floatingpoint "Default"
+
+	filter {}
+
 	files {
 		"src/physics/bounding_volumes.*",
 		"src/physics/collision_broad.*",
@@ -422,14 +544,22 @@ project "Physics-Lib"
 		"src/physics/collision_gjk.*",
 		"src/physics/collision_narrow.*",
 		"src/physics/collision_sat.*",
+		"src/physics/hull_builder.*",
 		"src/physics/constraints.*",
 		"src/physics/physics.*",
+		"src/physics/physics_index.h",
+		"src/physics/physics_snapshot.*",
 		"src/physics/cloth.*",
 		"src/physics/rigid_body.*",
 		"src/physics/ragdoll.*",
 		"src/physics/heightmap_collision.*",
+		"src/physics/mesh_collision.*",
+		"src/physics/island.*",
+		"src/physics/scene_query.*",
 		"src/learning/**",
+		"src/core/job_system.*",
 		"src/core/math.*",
+		"src/core/simd_dispatch.*",
 		"src/core/memory.*",
 		"src/core/threading.*",
 		"src/scene/scene.*",
@@ -442,6 +572,8 @@ project "Physics-Lib"
 		["Sources/*"] = { "src/**.cpp" },
 	}
 
+	physics_simd_kernels()
+
 	filter "system:windows"
 		systemversion "latest"
 
@@ -454,6 +586,29 @@ project "Physics-Lib"
 			"ENABLE_DX_PROFILING=0",
 		}
 
+	-- GCC rejects the anonymous structs with constructors in math.h, so Linux builds use Clang.
+	filter "system:linux"
+		toolset "clang"
+		pic "On"
+		visibility "Hidden"
+
+		defines {
+			"PHYSICS_ONLY",
+			"ENABLE_CPU_PROFILING=0",
+			"ENABLE_DX_PROFILING=0",
+		}
+
+		buildoptions {
+			"-Wno-gnu-anonymous-struct",
+			"-Wno-nested-anon-types",
+		}
+
+		links {
+			"pthread",
+		}
+
+	filter {}
+
 	filter "configurations:Debug"
         runtime "Debug"
 		symbols "On"
@@ -462,3 +617,112 @@ project "Physics-Lib"
         runtime "Release"
 		optimize "On"
 
+
+
+-----------------------------------------
+-- GENERATE HEADLESS PHYSICS BENCHMARK
+-----------------------------------------
+
+project "Physics-Benchmark"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "Off"
+
+	targetdir ("./bin/" .. outputdir)
+	objdir ("./bin_int/" .. outputdir ..  "/%{prj.name}")
+
+	debugdir "."
+
+	pchheader "pch.h"
+	pchsource "src/pch.cpp"
+
+	includedirs {
+		"src",
+	}
+
+	sysincludedirs {
+		"ext/entt/src",
+		"ext",
+	}
+
+	floatingpoint "Fast"
+
+	filter "options:physics-deterministic"
+		floatingpoint "Default"
+
+	filter {}
+
+	files {
+		"src/benchmark/**",
+		"src/physics/bounding_volumes.*",
+		"src/physics/collision_broad.*",
+		"src/physics/collision_epa.*",
+		"src/physics/collision_gjk.*",
+		"src/physics/collision_narrow.*",
+		"src/physics/collision_sat.*",
+		"src/physics/hull_builder.*",
+		"src/physics/constraints.*",
+		"src/physics/physics.*",
+		"src/physics/physics_index.h",
+		"src/physics/physics_snapshot.*",
+		"src/physics/cloth.*",
+		"src/physics/rigid_body.*",
+		"src/physics/ragdoll.*",
+		"src/physics/vehicle.*",
+		"src/physics/heightmap_collision.*",
+		"src/physics/mesh_collision.*",
+		"src/physics/island.*",
+		"src/physics/scene_query.*",
+		"src/core/job_system.*",
+		"src/core/math.*",
+		"src/core/simd_dispatch.*",
+		"src/core/memory.*",
+		"src/core/threading.*",
+		"src/scene/scene.*",
+		"src/terrain/heightmap_collider.*",
+		"src/pch.*",
+	}
+
+	vpaths {
+		["Headers/*"] = { "src/**.h" },
+		["Sources/*"] = { "src/**.cpp" },
+	}
+
+	physics_simd_kernels()
+
+	-- The benchmark collects the CPU profile blocks itself (see benchmark_profiling.cpp).
+	defines {
+		"PHYSICS_ONLY",
+		"ENABLE_CPU_PROFILING=1",
+		"ENABLE_DX_PROFILING=0",
+	}
+
+	filter "system:windows"
+		systemversion "latest"
+
+		defines {
+			"_UNICODE",
+			"UNICODE",
+			"_CRT_SECURE_NO_WARNINGS",
+		}
+
+	filter "system:linux"
+		toolset "clang"
+
+		buildoptions {
+			"-Wno-gnu-anonymous-struct",
+			"-Wno-nested-anon-types",
+		}
+
+		links {
+			"pthread",
+		}
+
+	filter "configurations:Debug"
+        runtime "Debug"
+		symbols "On"
+		
+	filter "configurations:Release"
+        runtime "Release"
+		optimize "On"
@@ -53,6 +53,70 @@ static void freeFile(entire_file file)
 }
 
 
+// Asset cache files, which consist of a header followed by arrays of plain data, each prefixed with its element count. The header type must
+// start with the members header and version, whose default values identify the current format. Files of another format are rejected, so that
+// the caller rebuilds them.
+template <typename T>
+static bool readCacheFileArray(entire_file& file, std::vector<T>& out)
+{
+	uint32* count = file.consume<uint32>();
+	T* data = count ? file.consume<T>(*count) : 0;
+	if (!data)
+	{
+		return false;
+	}
+
+	out.assign(data, data + *count);
+	return true;
+}
+
+template <typename header_t, typename... element_t>
+static bool readCacheFile(const fs::path& path, header_t& outHeader, std::vector<element_t>&... outArrays)
+{
+	entire_file file = loadFile(path);
+	if (!file.content)
+	{
+		return false;
+	}
+
+	header_t* header = file.consume<header_t>();
+	bool success = header && header->header == header_t().header && header->version == header_t().version
+		&& (readCacheFileArray(file, outArrays) && ...);
+	if (success)
+	{
+		outHeader = *header;
+	}
+
+	freeFile(file);
+	return success;
+}
+
+template <typename T>
+static void writeCacheFileArray(FILE* file, const std::vector<T>& in)
+{
+	uint32 count = (uint32)in.size();
+	fwrite(&count, sizeof(uint32), 1, file);
+	fwrite(in.data(), sizeof(T), count, file);
+}
+
+template <typename header_t, typename... element_t>
+static void writeCacheFile(const fs::path& path, const header_t& header, const std::vector<element_t>&... arrays)
+{
+	fs::create_directories(path.parent_path());
+
+	FILE* file = fopen(path.string().c_str(), "wb");
+	if (!file)
+	{
+		return;
+	}
+
+	fwrite(&header, sizeof(header_t), 1, file);
+	(writeCacheFileArray(file, arrays), ...);
+
+	fclose(file);
+}
+
+
 struct sized_string
 {
 	const char* str;
@@ -0,0 +1,128 @@
+#include "pch.h"
+#include "physics_benchmark.h"
+#include "broadphase_benchmark.h"
+#include "core/job_system.h"
+#include "core/simd_dispatch.h"
+
+#include <fstream>
+
+// Headless physics benchmark. Writes the results as JSON to stdout, or to the file given with --out. Progress goes to stderr.
+// With --broadphase, only the broadphase types are compared on synthetic collider distributions (see broadphase_benchmark.h).
+
+static void printUsage()
+{
+	std::cerr << "Usage: Physics-Benchmark [options]\n"
+		<< "  --scenario <name>   Only run this scenario. Can be given multiple times.\n"
+		<< "  --variant <name>    Only run this variant. Can be given multiple times.\n"
+		<< "  --frames <n>        Number of measured frames per run (default 300, 100 with --broadphase).\n"
+		<< "  --warmup <n>        Number of frames before measuring (default 30).\n"
+		<< "  --scale <f>         Scales the number of objects in all scenarios (default 1).\n"
+		<< "  --sleeping          Enable rigid body sleeping.\n"
+		<< "  --serial            Run the narrow phase serially.\n"
+		<< "  --island-solver     Solve islands in parallel.\n"
+		<< "  --simd-level <name> Run the SIMD kernels at this level (default: the highest supported).\n"
+		<< "  --broadphase        Run the broadphase benchmark instead of the scenarios.\n"
+		<< "  --colliders <n>     Number of colliders in the broadphase benchmark (default 4096).\n"
+		<< "  --out <file>        Write the JSON to this file instead of stdout.\n";
+
+	std::cerr << "Scenarios:";
+	for (uint32 i = 0; i < physics_benchmark_scenario_count; ++i) { std::cerr << ' ' << physicsBenchmarkScenarioNames[i]; }
+	std::cerr << "\nVariants:";
+	for (uint32 i = 0; i < physics_benchmark_variant_count; ++i) { std::cerr << ' ' << physicsBenchmarkVariantNames[i]; }
+	std::cerr << "\nSIMD levels:";
+	for (uint32 i = 0; i < simd_level_count; ++i) { std::cerr << ' ' << simdLevelNames[i]; }
+	std::cerr << '\n';
+}
+
+template <uint32 count>
+static int32 findName(const char* (&names)[count], const char* name)
+{
+	for (uint32 i = 0; i < count; ++i)
+	{
+		if (strcmp(names[i], name) == 0)
+		{
+			return (int32)i;
+		}
+	}
+	return -1;
+}
+
+int main(int argc, char** argv)
+{
+	physics_benchmark_settings settings;
+	broadphase_benchmark_settings broadphaseSettings;
+	bool broadphase = false;
+	uint32 scenarioMask = 0;
+	uint32 variantMask = 0;
+	const char* outPath = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : 0;
+
+		if (strcmp(arg, "--scenario") == 0 && value)
+		{
+			int32 index = findName(physicsBenchmarkScenarioNames, value);
+			if (index < 0) { std::cerr << "Unknown scenario '" << value << "'.\n"; printUsage(); return 1; }
+			scenarioMask |= (1 << index);
+			++i;
+		}
+		else if (strcmp(arg, "--variant") == 0 && value)
+		{
+			int32 index = findName(physicsBenchmarkVariantNames, value);
+			if (index < 0) { std::cerr << "Unknown variant '" << value << "'.\n"; printUsage(); return 1; }
+			variantMask |= (1 << index);
+			++i;
+		}
+		else if (strcmp(arg, "--simd-level") == 0 && value)
+		{
+			int32 index = findName(simdLevelNames, value);
+			if (index < 0) { std::cerr << "Unknown SIMD level '" << value << "'.\n"; printUsage(); return 1; }
+			if (!setSIMDLevel((simd_level)index)) { std::cerr << "SIMD level '" << value << "' is not supported by this CPU or build.\n"; return 1; }
+			++i;
+		}
+		else if (strcmp(arg, "--frames") == 0 && value) { settings.numFrames = broadphaseSettings.numFrames = max(atoi(value), 1); ++i; }
+		else if (strcmp(arg, "--warmup") == 0 && value) { settings.numWarmupFrames = max(atoi(value), 0); ++i; }
+		else if (strcmp(arg, "--scale") == 0 && value) { settings.sizeScale = max((float)atof(value), 0.01f); ++i; }
+		else if (strcmp(arg, "--colliders") == 0 && value) { broadphaseSettings.numColliders = clamp(atoi(value), 1, (int)MAX_NUM_PHYSICS_OBJECTS); ++i; }
+		else if (strcmp(arg, "--out") == 0 && value) { outPath = value; ++i; }
+		else if (strcmp(arg, "--sleeping") == 0) { settings.enableSleeping = true; }
+		else if (strcmp(arg, "--serial") == 0) { settings.parallelNarrowPhase = false; }
+		else if (strcmp(arg, "--island-solver") == 0) { settings.parallelIslandSolver = true; }
+		else if (strcmp(arg, "--broadphase") == 0) { broadphase = true; }
+		else
+		{
+			printUsage();
+			return (strcmp(arg, "--help") == 0) ? 0 : 1;
+		}
+	}
+
+	if (scenarioMask) { settings.scenarioMask = scenarioMask; }
+	if (variantMask) { settings.variantMask = variantMask; }
+
+	initializeJobSystem();
+
+	std::ofstream file;
+	if (outPath)
+	{
+		file.open(outPath);
+		if (!file)
+		{
+			std::cerr << "Could not open '" << outPath << "' for writing.\n";
+			return 1;
+		}
+	}
+	std::ostream& out = outPath ? (std::ostream&)file : std::cout;
+
+	if (broadphase)
+	{
+		runBroadphaseBenchmarks(broadphaseSettings, out);
+	}
+	else
+	{
+		runPhysicsBenchmarks(settings, out);
+	}
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include "pch.h"
+#include "benchmark_profiling.h"
+
+#if !ENABLE_CPU_PROFILING
+#error "The physics benchmark requires ENABLE_CPU_PROFILING=1."
+#endif
+
+// Normally defined in cpu_profiling.cpp, which depends on the renderer.
+std::atomic<uint32> cpuProfileIndex;
+std::atomic<uint32> cpuProfileCompletelyWritten[2];
+profile_event cpuProfileEvents[2][MAX_NUM_CPU_PROFILE_EVENTS];
+profile_stat cpuProfileStats[2][MAX_NUM_CPU_PROFILE_STATS];
+
+bool cpuProfilerWindowOpen = false;
+
+
+// Swaps the event arrays and waits until all events and stats in the old array are written. Same protocol as cpuProfilingResolveTimeStamps.
+static uint32 swapProfileArrays(uint32& outArrayIndex)
+{
+	uint32 arrayIndex = _CPU_PROFILE_GET_ARRAY_INDEX(cpuProfileIndex);
+	uint32 currentIndex = cpuProfileIndex.exchange((1 - arrayIndex) << 31);
+
+	uint32 numWrites = _CPU_PROFILE_GET_EVENT_INDEX(currentIndex) + _CPU_PROFILE_GET_STAT_INDEX(currentIndex);
+	while (numWrites > cpuProfileCompletelyWritten[arrayIndex]) {}
+	cpuProfileCompletelyWritten[arrayIndex] = 0;
+
+	outArrayIndex = arrayIndex;
+	return currentIndex;
+}
+
+void benchmark_profile::discardRecorded()
+{
+	uint32 arrayIndex;
+	swapProfileArrays(arrayIndex);
+}
+
+void benchmark_profile::collectRecorded()
+{
+	uint32 arrayIndex;
+	uint32 currentIndex = swapProfileArrays(arrayIndex);
+
+	const profile_event* events = cpuProfileEvents[arrayIndex];
+	uint32 numEvents = _CPU_PROFILE_GET_EVENT_INDEX(currentIndex);
+
+	const profile_stat* stats = cpuProfileStats[arrayIndex];
+	uint32 numStats = _CPU_PROFILE_GET_STAT_INDEX(currentIndex);
+
+	// Each thread's events are in order, since a thread's indices are increasing. Events of different threads interleave,
+	// so begin and end are matched with one stack per thread.
+	struct open_block
+	{
+		uint32 threadID;
+		uint32 eventIndex;
+	};
+
+	std::vector<open_block> openBlocks;
+
+	for (uint32 i = 0; i < numEvents; ++i)
+	{
+		const profile_event& e = events[i];
+
+		if (e.type == profile_event_begin_block)
+		{
+			openBlocks.push_back({ e.threadID, i });
+		}
+		else if (e.type == profile_event_end_block)
+		{
+			// Find the innermost open block of this thread.
+			auto it = std::find_if(openBlocks.rbegin(), openBlocks.rend(), [&e](const open_block& b) { return b.threadID == e.threadID; });
+			ASSERT(it != openBlocks.rend());
+
+			const profile_event& begin = events[it->eventIndex];
+			ASSERT(strcmp(begin.name, e.name) == 0);
+
+			uint64 duration = e.timestamp - begin.timestamp;
+
+			benchmark_profile_block& block = findOrAddBlock(e.name);
+			++block.numCalls;
+			block.totalClocks += duration;
+			block.maxClocks = max(block.maxClocks, duration);
+
+			openBlocks.erase(std::next(it).base());
+		}
+	}
+
+	ASSERT(openBlocks.empty());
+
+	for (uint32 i = 0; i < numStats; ++i)
+	{
+		const profile_stat& s = stats[i];
+		benchmark_profile_stat& stat = findOrAddStat(s.label);
+
+		double value;
+		switch (s.type)
+		{
+			case profile_stat_type_bool: value = s.boolValue ? 1.0 : 0.0; break;
+			case profile_stat_type_int32: value = (double)s.int32Value; break;
+			case profile_stat_type_uint32: value = (double)s.uint32Value; break;
+			case profile_stat_type_int64: value = (double)s.int64Value; break;
+			case profile_stat_type_uint64: value = (double)s.uint64Value; break;
+			case profile_stat_type_float: value = (double)s.floatValue; break;
+			case profile_stat_type_string: value = 0.0; stat.lastString = s.stringValue; break;
+			default: value = 0.0; break;
+		}
+
+		++stat.numSamples;
+		stat.sum += value;
+		stat.max = max(stat.max, value);
+	}
+}
+
+benchmark_profile_block& benchmark_profile::findOrAddBlock(const char* name)
+{
+	// Names are compared by content, since the same literal can have different addresses in different translation units.
+	for (benchmark_profile_block& block : blocks)
+	{
+		if (block.name == name)
+		{
+			return block;
+		}
+	}
+
+	benchmark_profile_block& block = blocks.emplace_back();
+	block.name = name;
+	return block;
+}
+
+benchmark_profile_stat& benchmark_profile::findOrAddStat(const char* label)
+{
+	for (benchmark_profile_stat& stat : stats)
+	{
+		if (stat.label == label)
+		{
+			return stat;
+		}
+	}
+
+	benchmark_profile_stat& stat = stats.emplace_back();
+	stat.label = label;
+	return stat;
+}
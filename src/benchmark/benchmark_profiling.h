@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/cpu_profiling.h"
+
+// Collects the CPU_PROFILE_BLOCKs and CPU_PROFILE_STATs recorded by the physics code, without the editor's profiler window.
+// The benchmark target defines the profiler's event buffers itself (see benchmark_profiling.cpp) and doesn't link cpu_profiling.cpp.
+
+struct benchmark_profile_block
+{
+	std::string name;
+	uint32 numCalls = 0;
+	uint64 totalClocks = 0;
+	uint64 maxClocks = 0;
+};
+
+struct benchmark_profile_stat
+{
+	std::string label;
+	uint32 numSamples = 0;
+	double sum = 0.0;
+	double max = -std::numeric_limits<double>::max();
+	std::string lastString; // For string stats only.
+};
+
+struct benchmark_profile
+{
+	// Blocks and stats in order of their first appearance.
+	std::vector<benchmark_profile_block> blocks;
+	std::vector<benchmark_profile_stat> stats;
+
+	// Clears all events and stats recorded so far. Must not be called while any thread is inside a profile block.
+	void discardRecorded();
+
+	// Accumulates all events and stats recorded since the last call. Must not be called while any thread is inside a profile block.
+	void collectRecorded();
+
+private:
+	benchmark_profile_block& findOrAddBlock(const char* name);
+	benchmark_profile_stat& findOrAddStat(const char* label);
+};
@@ -0,0 +1,216 @@
+#include "pch.h"
+#include "broadphase_benchmark.h"
+#include "benchmark_profiling.h"
+#include "scene/scene.h"
+#include "physics/physics.h"
+#include "core/random.h"
+#include "core/simd_dispatch.h"
+
+
+static const physics_material colliderMaterial = { physics_material_type_wood, 0.1f, 0.5f, 1.f };
+
+static void generateBenchmarkColliders(broadphase_benchmark_distribution distribution, uint32 numColliders, random_number_generator& rng,
+	vec3* centers, vec3* radii, vec3* velocities)
+{
+	// Roughly the object sizes and velocities of a scene full of crates and debris.
+	for (uint32 i = 0; i < numColliders; ++i)
+	{
+		radii[i] = rng.randomVec3Between(0.2f, 1.f);
+		velocities[i] = rng.randomVec3Between(-2.f, 2.f);
+	}
+
+	switch (distribution)
+	{
+		case broadphase_benchmark_distribution_clustered:
+		{
+			const uint32 collidersPerCluster = 256;
+			uint32 numClusters = max(numColliders / collidersPerCluster, 1u);
+			float halfWorldSize = cbrtf((float)numColliders) * 4.f;
+			float clusterRadius = cbrtf((float)collidersPerCluster) * 1.2f;
+
+			std::vector<vec3> clusterCenters(numClusters);
+			for (uint32 i = 0; i < numClusters; ++i)
+			{
+				clusterCenters[i] = rng.randomVec3Between(-halfWorldSize, halfWorldSize);
+			}
+			for (uint32 i = 0; i < numColliders; ++i)
+			{
+				centers[i] = clusterCenters[i % numClusters] + rng.randomVec3Between(-clusterRadius, clusterRadius);
+			}
+		} break;
+
+		case broadphase_benchmark_distribution_planar:
+		{
+			float halfWorldSize = sqrtf((float)numColliders) * 1.5f;
+			for (uint32 i = 0; i < numColliders; ++i)
+			{
+				centers[i] = vec3(rng.randomFloatBetween(-halfWorldSize, halfWorldSize), rng.randomFloatBetween(0.f, 1.f), rng.randomFloatBetween(-halfWorldSize, halfWorldSize));
+				velocities[i].y = 0.f;
+			}
+		} break;
+
+		case broadphase_benchmark_distribution_uniform:
+		{
+			float halfWorldSize = cbrtf((float)numColliders) * 2.f;
+			for (uint32 i = 0; i < numColliders; ++i)
+			{
+				centers[i] = rng.randomVec3Between(-halfWorldSize, halfWorldSize);
+			}
+		} break;
+	}
+}
+
+enum broadphase_benchmark_variant
+{
+	broadphase_benchmark_variant_sweep_and_prune,
+	broadphase_benchmark_variant_sweep_and_prune_simd,
+	broadphase_benchmark_variant_aabb_tree,
+
+	broadphase_benchmark_variant_count,
+};
+
+static const char* broadphaseBenchmarkVariantNames[] =
+{
+	"sweep_and_prune",
+	"sweep_and_prune_simd",
+	"aabb_tree",
+};
+
+static_assert(arraysize(broadphaseBenchmarkVariantNames) == broadphase_benchmark_variant_count);
+
+struct broadphase_run_result
+{
+	uint64 firstFrameClocks;
+	uint64 totalClocks;
+	uint64 totalNumPairs;
+
+	benchmark_profile profile; // Stages of the broadphase (e.g. the AABB tree update and its pair update), without the first frame.
+};
+
+// All variants of a distribution start from the same generated colliders, so their pair counts must match.
+static broadphase_run_result runBenchmark(const broadphase_benchmark_settings& settings, broadphase_benchmark_variant variant,
+	const vec3* initialCenters, const vec3* radii, const vec3* velocities)
+{
+	broadphase_type type = (variant == broadphase_benchmark_variant_aabb_tree) ? broadphase_type_aabb_tree : broadphase_type_sweep_and_prune;
+	bool simd = (variant == broadphase_benchmark_variant_sweep_and_prune_simd);
+
+	uint32 numColliders = settings.numColliders;
+
+	game_scene scene;
+	for (uint32 i = 0; i < numColliders; ++i)
+	{
+		// The transforms are never read. The broadphase only sees the world space AABBs passed in below.
+		scene.createEntity("Collider")
+			.addComponent<transform_component>(vec3(0.f), quat::identity)
+			.addComponent<collider_component>(collider_component::asAABB(bounding_box::fromCenterRadius(vec3(0.f), radii[i]), colliderMaterial));
+	}
+
+	memory_arena arena;
+	arena.initialize(0, MB(256));
+
+	std::vector<vec3> centers(initialCenters, initialCenters + numColliders);
+	std::vector<bounding_box> aabbs(numColliders);
+	std::vector<collision_filter> filters(numColliders, collision_filter{ 1, UINT32_MAX });
+	std::vector<collider_pair> pairs;
+
+	broadphase_run_result result = {};
+
+	result.profile.discardRecorded();
+
+	for (uint32 frame = 0; frame <= settings.numFrames; ++frame)
+	{
+		for (uint32 i = 0; i < numColliders; ++i)
+		{
+			centers[i] += velocities[i] * settings.dt;
+			aabbs[i] = bounding_box::fromCenterRadius(centers[i], radii[i]);
+		}
+
+		uint64 start = getPerformanceCounter();
+		uint32 numPairs = broadphase(scene, aabbs.data(), filters.data(), arena, pairs, type, simd);
+		uint64 duration = getPerformanceCounter() - start;
+
+		if (frame == 0)
+		{
+			result.firstFrameClocks = duration;
+			result.profile.discardRecorded();
+		}
+		else
+		{
+			result.totalClocks += duration;
+			result.totalNumPairs += numPairs;
+
+			// Collected every frame, since the profiler's event buffer only holds a limited number of events.
+			result.profile.collectRecorded();
+		}
+	}
+
+	scene.clearAll();
+	arena.reset(true);
+
+	return result;
+}
+
+void runBroadphaseBenchmarks(const broadphase_benchmark_settings& settings, std::ostream& out)
+{
+	ASSERT(settings.numColliders > 0 && settings.numColliders <= MAX_NUM_PHYSICS_OBJECTS);
+	ASSERT(settings.numFrames > 0);
+
+	double clockFrequency = (double)getPerformanceFrequency();
+	auto toMilliseconds = [clockFrequency](uint64 clocks) { return (double)clocks / clockFrequency * 1000.0; };
+
+	uint32 numColliders = settings.numColliders;
+
+	std::vector<vec3> centers(numColliders);
+	std::vector<vec3> radii(numColliders);
+	std::vector<vec3> velocities(numColliders);
+
+	random_number_generator rng = { 61923 };
+
+	out << "{\n";
+	out << "  \"numColliders\": " << numColliders << ",\n";
+	out << "  \"numFrames\": " << settings.numFrames << ",\n";
+	out << "  \"dt\": " << settings.dt << ",\n";
+	out << "  \"simdLevel\": \"" << simdLevelNames[getSIMDLevel()] << "\",\n";
+	out << "  \"runs\": [\n";
+
+	for (uint32 distribution = 0; distribution < broadphase_benchmark_distribution_count; ++distribution)
+	{
+		generateBenchmarkColliders((broadphase_benchmark_distribution)distribution, numColliders, rng, centers.data(), radii.data(), velocities.data());
+
+		uint64 numPairs = 0;
+
+		for (uint32 variant = 0; variant < broadphase_benchmark_variant_count; ++variant)
+		{
+			std::cerr << "Running broadphase " << broadphaseBenchmarkDistributionNames[distribution] << " (" << broadphaseBenchmarkVariantNames[variant] << ")...\n";
+
+			broadphase_run_result result = runBenchmark(settings, (broadphase_benchmark_variant)variant, centers.data(), radii.data(), velocities.data());
+
+			ASSERT(variant == 0 || result.totalNumPairs == numPairs);
+			numPairs = result.totalNumPairs;
+
+			if (distribution != 0 || variant != 0)
+			{
+				out << ",\n";
+			}
+
+			out << "    {\n";
+			out << "      \"distribution\": \"" << broadphaseBenchmarkDistributionNames[distribution] << "\",\n";
+			out << "      \"variant\": \"" << broadphaseBenchmarkVariantNames[variant] << "\",\n";
+			out << "      \"firstFrameMs\": " << toMilliseconds(result.firstFrameClocks) << ",\n";
+			out << "      \"frameMs\": " << toMilliseconds(result.totalClocks) / settings.numFrames << ",\n";
+			out << "      \"pairsPerFrame\": " << result.totalNumPairs / settings.numFrames << ",\n";
+
+			out << "      \"blocks\": {";
+			for (uint32 i = 0; i < (uint32)result.profile.blocks.size(); ++i)
+			{
+				const benchmark_profile_block& block = result.profile.blocks[i];
+				out << (i == 0 ? "\n" : ",\n") << "        \"" << block.name << "\": { \"msPerFrame\": " << toMilliseconds(block.totalClocks) / settings.numFrames << " }";
+			}
+			out << "\n      }\n";
+			out << "    }";
+		}
+	}
+
+	out << "\n  ]\n";
+	out << "}\n";
+}
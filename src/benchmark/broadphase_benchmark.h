@@ -0,0 +1,33 @@
+#pragma once
+
+#include "physics/collision_broad.h"
+
+enum broadphase_benchmark_distribution
+{
+	broadphase_benchmark_distribution_clustered,
+	broadphase_benchmark_distribution_planar,
+	broadphase_benchmark_distribution_uniform,
+
+	broadphase_benchmark_distribution_count,
+};
+
+static const char* broadphaseBenchmarkDistributionNames[] =
+{
+	"clustered",
+	"planar",
+	"uniform",
+};
+
+static_assert(arraysize(broadphaseBenchmarkDistributionNames) == broadphase_benchmark_distribution_count);
+
+struct broadphase_benchmark_settings
+{
+	uint32 numColliders = 4096;
+	uint32 numFrames = 100;
+	float dt = 1.f / 60.f;
+};
+
+// Measures the pair finding time of both broadphase types on synthetic clustered, planar and uniform collider distributions and writes the
+// results as JSON. The first frame, which builds the structures from scratch, is reported separately. Each run also lists the time per frame of
+// the broadphase's profile blocks, e.g. the AABB tree's pair update. The job system must be initialized.
+void runBroadphaseBenchmarks(const broadphase_benchmark_settings& settings, std::ostream& out);
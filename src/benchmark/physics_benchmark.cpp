@@ -0,0 +1,501 @@
+#include "pch.h"
+#include "physics_benchmark.h"
+#include "benchmark_profiling.h"
+#include "physics/ragdoll.h"
+#include "physics/vehicle.h"
+#include "terrain/heightmap_collider.h"
+#include "core/random.h"
+#include "core/simd_dispatch.h"
+
+
+// Data referenced by a scenario's components, which must outlive the scene.
+struct benchmark_scene_data
+{
+	std::vector<uint16> heights;
+};
+
+static const physics_material groundMaterial = { physics_material_type_metal, 0.1f, 1.f, 4.f };
+static const physics_material boxMaterial = { physics_material_type_wood, 0.1f, 0.5f, 1.f };
+
+static uint32 scaledCount(uint32 count, float scale)
+{
+	return max((uint32)(count * scale + 0.5f), 1u);
+}
+
+static void createGround(game_scene& scene, float radius)
+{
+	// Top face at y = 0.
+	scene.createEntity("Ground")
+		.addComponent<transform_component>(vec3(0.f, -4.f, 0.f), quat::identity)
+		.addComponent<collider_component>(collider_component::asAABB(bounding_box::fromCenterRadius(vec3(0.f), vec3(radius, 4.f, radius)), groundMaterial));
+}
+
+static void createBoxPyramid(game_scene& scene, float scale)
+{
+	createGround(scene, 50.f);
+
+	// The number of boxes grows cubically with the base.
+	uint32 base = max((uint32)(10.f * cbrt(scale) + 0.5f), 1u);
+	float spacing = 1.02f;
+
+	for (uint32 level = 0; level < base; ++level)
+	{
+		uint32 numPerSide = base - level;
+		float offset = -0.5f * (numPerSide - 1) * spacing;
+
+		for (uint32 z = 0; z < numPerSide; ++z)
+		{
+			for (uint32 x = 0; x < numPerSide; ++x)
+			{
+				vec3 position(offset + x * spacing, 0.5f + level * 1.001f, offset + z * spacing);
+
+				scene.createEntity("Box")
+					.addComponent<transform_component>(position, quat::identity)
+					.addComponent<collider_component>(collider_component::asAABB(bounding_box::fromCenterRadius(vec3(0.f), vec3(0.5f)), boxMaterial))
+					.addComponent<rigid_body_component>(false, 1.f);
+			}
+		}
+	}
+}
+
+// Hexagonal prism with radius 0.5 and height 1. Allocated once, since hull geometries are global.
+static uint32 getBenchmarkHullGeometry()
+{
+	static uint32 index = []()
+	{
+		const float radius = 0.5f;
+		const float halfHeight = 0.5f;
+
+		vec3 vertices[12];
+		for (uint32 i = 0; i < 6; ++i)
+		{
+			float angle = i * M_TAU / 6.f;
+			vertices[i] = vec3(cos(angle) * radius, -halfHeight, sin(angle) * radius);
+			vertices[i + 6] = vec3(cos(angle) * radius, halfHeight, sin(angle) * radius);
+		}
+
+		return allocateBoundingHullGeometry(buildBoundingHull(vertices, arraysize(vertices)));
+	}();
+
+	return index;
+}
+
+static void createHullWall(game_scene& scene, float scale)
+{
+	createGround(scene, 50.f);
+
+	uint32 width = scaledCount(20, sqrt(scale));
+	uint32 height = scaledCount(10, sqrt(scale));
+
+	bounding_hull hull;
+	hull.position = vec3(0.f);
+	hull.rotation = quat::identity;
+	hull.geometryIndex = getBenchmarkHullGeometry();
+
+	float offset = -0.5f * (width - 1);
+
+	for (uint32 y = 0; y < height; ++y)
+	{
+		// Every other row is shifted by half a hull, like bricks.
+		float rowOffset = (y % 2) * 0.5f;
+
+		for (uint32 x = 0; x < width; ++x)
+		{
+			vec3 position(offset + x + rowOffset, 0.5f + y * 1.001f, 0.f);
+
+			scene.createEntity("Hull")
+				.addComponent<transform_component>(position, quat::identity)
+				.addComponent<collider_component>(collider_component::asHull(hull, boxMaterial))
+				.addComponent<rigid_body_component>(false, 1.f);
+		}
+	}
+}
+
+static void createRagdollPile(game_scene& scene, float scale)
+{
+	createGround(scene, 50.f);
+
+	uint32 numRagdolls = scaledCount(24, scale);
+
+	random_number_generator rng = { 9182734 };
+
+	for (uint32 i = 0; i < numRagdolls; ++i)
+	{
+		vec3 position(rng.randomFloatBetween(-1.f, 1.f), 1.5f + i * 1.2f, rng.randomFloatBetween(-1.f, 1.f));
+		humanoid_ragdoll::create(scene, position, rng.randomFloatBetween(0.f, M_TAU));
+	}
+}
+
+static void createVehicles(game_scene& scene, float scale)
+{
+	createGround(scene, 100.f);
+
+	uint32 numVehicles = scaledCount(8, scale);
+	uint32 numPerRow = (uint32)ceil(sqrt((float)numVehicles));
+
+	for (uint32 i = 0; i < numVehicles; ++i)
+	{
+		uint32 x = i % numPerRow;
+		uint32 z = i / numPerRow;
+
+		vec3 position((x - 0.5f * (numPerRow - 1)) * 8.f, 0.8f, (z - 0.5f * (numPerRow - 1)) * 8.f);
+		vehicle::create(scene, position);
+	}
+}
+
+static void createClothSheets(game_scene& scene, float scale)
+{
+	createGround(scene, 50.f);
+
+	uint32 numCloths = scaledCount(8, scale);
+
+	for (uint32 i = 0; i < numCloths; ++i)
+	{
+		vec3 position((i - 0.5f * (numCloths - 1)) * 6.f, 6.f, 0.f);
+
+		scene.createEntity("Cloth")
+			.addComponent<transform_component>(position, quat::identity)
+			.addComponent<cloth_component>(5.f, 5.f, 32u, 32u, 4.f);
+	}
+}
+
+// Many high resolution cloths, which stress the cloth solver rather than the rigid body pipeline. Each banner swings against a static sphere.
+static void createClothBanners(game_scene& scene, float scale)
+{
+	createGround(scene, 100.f);
+
+	uint32 numCloths = scaledCount(48, scale);
+	uint32 numPerRow = (uint32)ceil(sqrt((float)numCloths));
+
+	for (uint32 i = 0; i < numCloths; ++i)
+	{
+		uint32 x = i % numPerRow;
+		uint32 z = i / numPerRow;
+
+		vec3 position((x - 0.5f * (numPerRow - 1)) * 8.f, 10.f, (z - 0.5f * (numPerRow - 1)) * 8.f);
+
+		scene.createEntity("Banner")
+			.addComponent<transform_component>(position, quat::identity)
+			.addComponent<cloth_component>(4.f, 8.f, 64u, 64u, 6.f);
+
+		scene.createEntity("Banner post")
+			.addComponent<transform_component>(position + vec3(0.f, -3.f, 3.f), quat::identity)
+			.addComponent<collider_component>(collider_component::asSphere({ vec3(0.f), 1.5f }, groundMaterial));
+	}
+}
+
+static void createHeightmapScene(game_scene& scene, benchmark_scene_data& data, float scale)
+{
+	const uint32 chunksPerDim = 2;
+	const float chunkSize = 32.f;
+	const float amplitude = 6.f;
+	const uint32 verticesPerChunk = TERRAIN_LOD_0_VERTICES_PER_DIMENSION * TERRAIN_LOD_0_VERTICES_PER_DIMENSION;
+
+	float terrainSize = chunksPerDim * chunkSize;
+	vec3 minCorner(-0.5f * terrainSize, -amplitude, -0.5f * terrainSize);
+
+	// Rolling hills, continuous across chunk borders.
+	data.heights.resize(chunksPerDim * chunksPerDim * verticesPerChunk);
+	for (uint32 chunkZ = 0; chunkZ < chunksPerDim; ++chunkZ)
+	{
+		for (uint32 chunkX = 0; chunkX < chunksPerDim; ++chunkX)
+		{
+			uint16* heights = data.heights.data() + (chunkZ * chunksPerDim + chunkX) * verticesPerChunk;
+
+			for (uint32 z = 0; z < TERRAIN_LOD_0_VERTICES_PER_DIMENSION; ++z)
+			{
+				for (uint32 x = 0; x < TERRAIN_LOD_0_VERTICES_PER_DIMENSION; ++x)
+				{
+					float globalX = (chunkX + x / (float)(TERRAIN_LOD_0_VERTICES_PER_DIMENSION - 1)) * chunkSize;
+					float globalZ = (chunkZ + z / (float)(TERRAIN_LOD_0_VERTICES_PER_DIMENSION - 1)) * chunkSize;
+
+					float height = 0.5f + 0.4f * sin(globalX * 0.2f) * cos(globalZ * 0.15f);
+					heights[z * TERRAIN_LOD_0_VERTICES_PER_DIMENSION + x] = (uint16)(saturate(height) * UINT16_MAX);
+				}
+			}
+		}
+	}
+
+	heightmap_collider_component heightmap(chunksPerDim, chunkSize, groundMaterial);
+	heightmap.update(minCorner, amplitude);
+	for (uint32 chunkZ = 0; chunkZ < chunksPerDim; ++chunkZ)
+	{
+		for (uint32 chunkX = 0; chunkX < chunksPerDim; ++chunkX)
+		{
+			heightmap.collider(chunkX, chunkZ).setHeights(data.heights.data() + (chunkZ * chunksPerDim + chunkX) * verticesPerChunk);
+		}
+	}
+
+	scene.createEntity("Heightmap")
+		.addComponent<heightmap_collider_component>(std::move(heightmap));
+
+
+	uint32 numBodies = scaledCount(400, scale);
+
+	random_number_generator rng = { 47281943 };
+	float spawnRadius = 0.4f * terrainSize;
+
+	for (uint32 i = 0; i < numBodies; ++i)
+	{
+		vec3 position(rng.randomFloatBetween(-spawnRadius, spawnRadius), rng.randomFloatBetween(2.f, 12.f), rng.randomFloatBetween(-spawnRadius, spawnRadius));
+
+		collider_component collider;
+		switch (i % 3)
+		{
+			case 0: collider = collider_component::asSphere({ vec3(0.f), 0.5f }, boxMaterial); break;
+			case 1: collider = collider_component::asCapsule({ vec3(0.f, -0.4f, 0.f), vec3(0.f, 0.4f, 0.f), 0.3f }, boxMaterial); break;
+			default: collider = collider_component::asAABB(bounding_box::fromCenterRadius(vec3(0.f), vec3(0.4f)), boxMaterial); break;
+		}
+
+		scene.createEntity("Body")
+			.addComponent<transform_component>(position, quat(normalize(rng.randomVec3Between(-1.f, 1.f)), rng.randomFloatBetween(0.f, M_TAU)))
+			.addComponent<collider_component>(collider)
+			.addComponent<rigid_body_component>(false, 1.f);
+	}
+}
+
+static void createScenario(game_scene& scene, benchmark_scene_data& data, physics_benchmark_scenario scenario, float scale)
+{
+	switch (scenario)
+	{
+		case physics_benchmark_scenario_box_pyramid: createBoxPyramid(scene, scale); break;
+		case physics_benchmark_scenario_hull_wall: createHullWall(scene, scale); break;
+		case physics_benchmark_scenario_ragdoll_pile: createRagdollPile(scene, scale); break;
+		case physics_benchmark_scenario_vehicles: createVehicles(scene, scale); break;
+		case physics_benchmark_scenario_cloth_sheets: createClothSheets(scene, scale); break;
+		case physics_benchmark_scenario_cloth_banners: createClothBanners(scene, scale); break;
+		case physics_benchmark_scenario_heightmap: createHeightmapScene(scene, data, scale); break;
+	}
+}
+
+static void setVariant(physics_settings& settings, physics_benchmark_variant variant)
+{
+	settings.simdBroadPhase = variant == physics_benchmark_variant_simd_broadphase || variant == physics_benchmark_variant_simd;
+	settings.simdNarrowPhase = variant == physics_benchmark_variant_simd_narrowphase || variant == physics_benchmark_variant_simd;
+	settings.simdConstraintSolver = variant == physics_benchmark_variant_simd_constraint_solver || variant == physics_benchmark_variant_simd;
+}
+
+
+
+
+struct benchmark_run_result
+{
+	physics_benchmark_scenario scenario;
+	physics_benchmark_variant variant;
+
+	uint32 numRigidBodies;
+	uint32 numColliders;
+	uint32 numCloths;
+
+	uint64 totalClocks;
+	uint64 minClocks;
+	uint64 maxClocks;
+
+	uint64 finalStateHash;
+
+	benchmark_profile profile;
+};
+
+static benchmark_run_result runBenchmark(const physics_benchmark_settings& benchmarkSettings, physics_benchmark_scenario scenario, physics_benchmark_variant variant)
+{
+	benchmark_run_result result;
+	result.scenario = scenario;
+	result.variant = variant;
+
+	game_scene scene;
+	benchmark_scene_data data;
+	createScenario(scene, data, scenario, benchmarkSettings.sizeScale);
+
+	result.numRigidBodies = scene.numberOfComponentsOfType<rigid_body_component>();
+	result.numColliders = scene.numberOfComponentsOfType<collider_component>();
+	result.numCloths = scene.numberOfComponentsOfType<cloth_component>();
+
+	memory_arena arena;
+	arena.initialize(0, GB(2));
+
+	physics_settings settings;
+	settings.fixedFrameRate = false;
+	settings.enableSleeping = benchmarkSettings.enableSleeping;
+	settings.parallelNarrowPhase = benchmarkSettings.parallelNarrowPhase;
+	settings.parallelIslandSolver = benchmarkSettings.parallelIslandSolver;
+	setVariant(settings, variant);
+
+	float timer = 0.f;
+
+	for (uint32 frame = 0; frame < benchmarkSettings.numWarmupFrames; ++frame)
+	{
+		physicsStep(scene, arena, timer, settings, benchmarkSettings.dt);
+	}
+
+	result.profile.discardRecorded();
+
+	result.totalClocks = 0;
+	result.minClocks = UINT64_MAX;
+	result.maxClocks = 0;
+
+	for (uint32 frame = 0; frame < benchmarkSettings.numFrames; ++frame)
+	{
+		// The hash is only computed in the last frame, so that it doesn't show up in the timings of the others.
+		settings.computeStateHash = (frame == benchmarkSettings.numFrames - 1);
+
+		uint64 start = getPerformanceCounter();
+		physicsStep(scene, arena, timer, settings, benchmarkSettings.dt);
+		uint64 end = getPerformanceCounter();
+
+		uint64 duration = end - start;
+		result.totalClocks += duration;
+		result.minClocks = min(result.minClocks, duration);
+		result.maxClocks = max(result.maxClocks, duration);
+
+		// Collected every frame, since the profiler's event buffer only holds a limited number of events.
+		result.profile.collectRecorded();
+	}
+
+	result.finalStateHash = getPhysicsStateHash(scene);
+
+	scene.clearAll();
+	arena.reset(true);
+
+	return result;
+}
+
+
+
+
+static void writeJSONString(std::ostream& out, const std::string& s)
+{
+	out << '"';
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\') { out << '\\' << c; }
+		else if ((uint8)c < 0x20) { out << ' '; }
+		else { out << c; }
+	}
+	out << '"';
+}
+
+// scalarTotalClocks is 0, if the scalar variant was not run.
+static void writeRunResult(std::ostream& out, const benchmark_run_result& result, uint64 scalarTotalClocks,
+	const physics_benchmark_settings& settings, double clockFrequency)
+{
+	auto toMilliseconds = [clockFrequency](uint64 clocks) { return (double)clocks / clockFrequency * 1000.0; };
+
+	physics_settings variantSettings;
+	setVariant(variantSettings, result.variant);
+
+	double averageMs = toMilliseconds(result.totalClocks) / settings.numFrames;
+
+	char hash[32];
+	snprintf(hash, sizeof(hash), "0x%016llx", (unsigned long long)result.finalStateHash);
+
+	out << "    {\n";
+	out << "      \"scenario\": \"" << physicsBenchmarkScenarioNames[result.scenario] << "\",\n";
+	out << "      \"variant\": \"" << physicsBenchmarkVariantNames[result.variant] << "\",\n";
+	out << "      \"simdBroadPhase\": " << (variantSettings.simdBroadPhase ? "true" : "false") << ",\n";
+	out << "      \"simdNarrowPhase\": " << (variantSettings.simdNarrowPhase ? "true" : "false") << ",\n";
+	out << "      \"simdConstraintSolver\": " << (variantSettings.simdConstraintSolver ? "true" : "false") << ",\n";
+	out << "      \"numRigidBodies\": " << result.numRigidBodies << ",\n";
+	out << "      \"numColliders\": " << result.numColliders << ",\n";
+	out << "      \"numCloths\": " << result.numCloths << ",\n";
+	out << "      \"stepMs\": { \"avg\": " << averageMs << ", \"min\": " << toMilliseconds(result.minClocks) << ", \"max\": " << toMilliseconds(result.maxClocks) << " },\n";
+	if (scalarTotalClocks)
+	{
+		out << "      \"speedupVsScalar\": " << ((double)scalarTotalClocks / (double)result.totalClocks) << ",\n";
+	}
+	out << "      \"finalStateHash\": \"" << hash << "\",\n";
+
+	// Blocks on worker threads are summed, so the time per frame of a parallel stage can exceed its wall clock time.
+	out << "      \"blocks\": {";
+	for (uint32 i = 0; i < (uint32)result.profile.blocks.size(); ++i)
+	{
+		const benchmark_profile_block& block = result.profile.blocks[i];
+
+		out << (i == 0 ? "\n" : ",\n") << "        ";
+		writeJSONString(out, block.name);
+		out << ": { \"callsPerFrame\": " << (double)block.numCalls / settings.numFrames
+			<< ", \"msPerFrame\": " << toMilliseconds(block.totalClocks) / settings.numFrames
+			<< ", \"maxMs\": " << toMilliseconds(block.maxClocks) << " }";
+	}
+	out << "\n      },\n";
+
+	out << "      \"stats\": {";
+	for (uint32 i = 0; i < (uint32)result.profile.stats.size(); ++i)
+	{
+		const benchmark_profile_stat& stat = result.profile.stats[i];
+
+		out << (i == 0 ? "\n" : ",\n") << "        ";
+		writeJSONString(out, stat.label);
+		if (!stat.lastString.empty())
+		{
+			out << ": ";
+			writeJSONString(out, stat.lastString);
+		}
+		else
+		{
+			out << ": { \"avg\": " << stat.sum / stat.numSamples << ", \"max\": " << stat.max << " }";
+		}
+	}
+	out << "\n      }\n";
+	out << "    }";
+}
+
+void runPhysicsBenchmarks(const physics_benchmark_settings& settings, std::ostream& out)
+{
+	ASSERT(settings.numFrames > 0);
+
+	double clockFrequency = (double)getPerformanceFrequency();
+
+	out << "{\n";
+	out << "  \"numFrames\": " << settings.numFrames << ",\n";
+	out << "  \"numWarmupFrames\": " << settings.numWarmupFrames << ",\n";
+	out << "  \"dt\": " << settings.dt << ",\n";
+	out << "  \"sizeScale\": " << settings.sizeScale << ",\n";
+	out << "  \"enableSleeping\": " << (settings.enableSleeping ? "true" : "false") << ",\n";
+	out << "  \"parallelNarrowPhase\": " << (settings.parallelNarrowPhase ? "true" : "false") << ",\n";
+	out << "  \"parallelIslandSolver\": " << (settings.parallelIslandSolver ? "true" : "false") << ",\n";
+	out << "  \"physicsIndexBits\": " << (PHYSICS_32BIT_INDICES ? 32 : 16) << ",\n";
+	out << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n";
+	out << "  \"simdLevel\": \"" << simdLevelNames[getSIMDLevel()] << "\",\n";
+	out << "  \"supportedSIMDLevel\": \"" << simdLevelNames[getSupportedSIMDLevel()] << "\",\n";
+	out << "  \"runs\": [\n";
+
+	bool first = true;
+	for (uint32 scenario = 0; scenario < physics_benchmark_scenario_count; ++scenario)
+	{
+		if (!(settings.scenarioMask & (1 << scenario)))
+		{
+			continue;
+		}
+
+		// The scalar run is the baseline for the speedups, so it is run first.
+		uint64 scalarTotalClocks = 0;
+
+		for (uint32 variant = 0; variant < physics_benchmark_variant_count; ++variant)
+		{
+			if (!(settings.variantMask & (1 << variant)))
+			{
+				continue;
+			}
+
+			std::cerr << "Running " << physicsBenchmarkScenarioNames[scenario] << " (" << physicsBenchmarkVariantNames[variant] << ")...\n";
+
+			benchmark_run_result result = runBenchmark(settings, (physics_benchmark_scenario)scenario, (physics_benchmark_variant)variant);
+
+			if (!first)
+			{
+				out << ",\n";
+			}
+			first = false;
+
+			if (variant == physics_benchmark_variant_scalar)
+			{
+				scalarTotalClocks = result.totalClocks;
+			}
+
+			writeRunResult(out, result, scalarTotalClocks, settings, clockFrequency);
+		}
+	}
+
+	out << "\n  ]\n";
+	out << "}\n";
+}
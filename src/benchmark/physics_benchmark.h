@@ -0,0 +1,73 @@
+#pragma once
+
+#include "physics/physics.h"
+
+enum physics_benchmark_scenario
+{
+	physics_benchmark_scenario_box_pyramid,
+	physics_benchmark_scenario_hull_wall,
+	physics_benchmark_scenario_ragdoll_pile,
+	physics_benchmark_scenario_vehicles,
+	physics_benchmark_scenario_cloth_sheets,
+	physics_benchmark_scenario_cloth_banners,
+	physics_benchmark_scenario_heightmap,
+
+	physics_benchmark_scenario_count,
+};
+
+static const char* physicsBenchmarkScenarioNames[] =
+{
+	"box_pyramid",
+	"hull_wall",
+	"ragdoll_pile",
+	"vehicles",
+	"cloth_sheets",
+	"cloth_banners",
+	"heightmap",
+};
+
+static_assert(arraysize(physicsBenchmarkScenarioNames) == physics_benchmark_scenario_count);
+
+// Each variant is run for every scenario. The single flag variants show which stage a regression comes from.
+enum physics_benchmark_variant
+{
+	physics_benchmark_variant_scalar,
+	physics_benchmark_variant_simd_broadphase,
+	physics_benchmark_variant_simd_narrowphase,
+	physics_benchmark_variant_simd_constraint_solver,
+	physics_benchmark_variant_simd,
+
+	physics_benchmark_variant_count,
+};
+
+static const char* physicsBenchmarkVariantNames[] =
+{
+	"scalar",
+	"simd_broadphase",
+	"simd_narrowphase",
+	"simd_constraint_solver",
+	"simd",
+};
+
+static_assert(arraysize(physicsBenchmarkVariantNames) == physics_benchmark_variant_count);
+
+struct physics_benchmark_settings
+{
+	uint32 scenarioMask = (1 << physics_benchmark_scenario_count) - 1;
+	uint32 variantMask = (1 << physics_benchmark_variant_count) - 1;
+
+	// Scales the number of objects in all scenarios. 1 gives a few hundred rigid bodies per scenario.
+	float sizeScale = 1.f;
+
+	uint32 numWarmupFrames = 30;
+	uint32 numFrames = 300;
+	float dt = 1.f / 120.f;
+
+	// Sleeping is off by default, since settled scenes would otherwise measure only the sleeping check.
+	bool enableSleeping = false;
+	bool parallelNarrowPhase = true;
+	bool parallelIslandSolver = false;
+};
+
+// Runs all selected scenarios and variants and writes the results as JSON. The job system must be initialized.
+void runPhysicsBenchmarks(const physics_benchmark_settings& settings, std::ostream& out);
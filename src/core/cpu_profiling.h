@@ -38,7 +38,7 @@ extern bool cpuProfilerWindowOpen;
 	e->threadID = getThreadIDFast(); \
 	e->name = name_; \
 	e->type = type_; \
-	QueryPerformanceCounter((LARGE_INTEGER*)&e->timestamp); \
+	e->timestamp = getPerformanceCounter(); \
 	cpuProfileCompletelyWritten[arrayIndex].fetch_add(1, std::memory_order_release); // Mark this event as written. Release means that the compiler may not reorder the previous writes after this.
 
 
@@ -135,16 +135,13 @@ struct cpu_print_profile_block_recorder
 	cpu_print_profile_block_recorder(const char* name)
 		: name(name)
 	{
-		QueryPerformanceCounter((LARGE_INTEGER*)&start);
+		start = getPerformanceCounter();
 	}
 
 	~cpu_print_profile_block_recorder()
 	{
-		uint64 end;
-		QueryPerformanceCounter((LARGE_INTEGER*)&end);
-
-		uint64 clockFrequency;
-		QueryPerformanceFrequency((LARGE_INTEGER*)&clockFrequency);
+		uint64 end = getPerformanceCounter();
+		uint64 clockFrequency = getPerformanceFrequency();
 
 		float duration = (float)(end - start) / clockFrequency * 1000.f;
 		std::cout << "Profile block '" << name << "' took " << duration << "ms.\n";
@@ -1,23 +1,22 @@
 #include "pch.h"
 #include "job_system.h"
 #include "math.h"
-#include "imgui.h"
 
 
-void job_queue::initialize(uint32 numThreads, uint32 threadOffset, int threadPriority, const wchar* description)
+void job_queue::initialize(uint32 numThreads, uint32 threadOffset, thread_priority threadPriority, const wchar* description)
 {
     queue = moodycamel::ConcurrentQueue<int32>(capacity);
 
     for (uint32 i = 0; i < numThreads; ++i)
     {
-        std::thread thread([this, i]() { threadFunc(i); });
-
-        HANDLE handle = (HANDLE)thread.native_handle();
-        SetThreadPriority(handle, threadPriority);
+        std::thread thread([this, i, threadOffset, threadPriority, description]()
+        {
+            setCurrentThreadPriority(threadPriority);
+            setCurrentThreadAffinity(i + threadOffset);
+            setCurrentThreadDescription(description);
 
-        uint64 affinityMask = 1ull << (i + threadOffset);
-        SetThreadAffinityMask(handle, affinityMask);
-        SetThreadDescription(handle, description);
+            threadFunc(i);
+        });
 
         thread.detach();
     }
@@ -157,17 +156,15 @@ job_queue mainThreadJobQueue;
 
 void initializeJobSystem()
 {
-    HANDLE handle = GetCurrentThread();
-    SetThreadAffinityMask(handle, 1);
-    SetThreadPriority(handle, THREAD_PRIORITY_HIGHEST);
-    CloseHandle(handle);
+    setCurrentThreadAffinity(0);
+    setCurrentThreadPriority(thread_priority_highest);
 
     //uint32 numHardwareThreads = std::thread::hardware_concurrency();
 
 
-    highPriorityJobQueue.initialize(4, 1, THREAD_PRIORITY_NORMAL, L"High priority worker");
-    lowPriorityJobQueue.initialize(4, 5, THREAD_PRIORITY_BELOW_NORMAL, L"Low priority worker");
-    mainThreadJobQueue.initialize(0, 0, 0, 0);
+    highPriorityJobQueue.initialize(4, 1, thread_priority_normal, L"High priority worker");
+    lowPriorityJobQueue.initialize(4, 5, thread_priority_below_normal, L"Low priority worker");
+    mainThreadJobQueue.initialize(0, 0, thread_priority_normal, 0);
 }
 
 void executeMainThreadJobs()
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <concurrentqueue/concurrentqueue.h>
+#include <condition_variable>
+#include "threading.h"
 
 struct job_handle
 {
@@ -37,7 +39,7 @@ struct job_queue
 
 
 
-    void initialize(uint32 numThreads, uint32 threadOffset, int threadPriority, const wchar* description);
+    void initialize(uint32 numThreads, uint32 threadOffset, thread_priority threadPriority, const wchar* description);
 
     template <typename data_t,
         typename = std::enable_if_t<sizeof(data_t) <= job_queue_entry::DATA_SIZE>>
@@ -54,7 +56,7 @@ struct job_queue
             ++allJobs[parent.index].numUnfinishedJobs;
         }
 
-        job.templatedFunction = function;
+        job.templatedFunction = (void*)function;
         job.function = [](void* templatedFunction, void* rawData, job_handle job)
         {
             data_t& data = *(data_t*)rawData;
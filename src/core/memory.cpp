@@ -2,16 +2,29 @@
 #include "memory.h"
 #include "math.h"
 
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 void memory_arena::initialize(uint64 minimumBlockSize, uint64 reserveSize)
 {
 	reset(true);
 
+#if defined(_WIN32)
 	memory = (uint8*)VirtualAlloc(0, reserveSize, MEM_RESERVE, PAGE_READWRITE);
 
 	SYSTEM_INFO systemInfo;
 	GetSystemInfo(&systemInfo);
 
 	pageSize = systemInfo.dwPageSize;
+#else
+	// Reserve address space only. Pages are committed by making them accessible.
+	memory = (uint8*)mmap(0, reserveSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	ASSERT(memory != MAP_FAILED);
+
+	pageSize = (uint64)sysconf(_SC_PAGESIZE);
+#endif
 	sizeLeftTotal = reserveSize;
 	this->minimumBlockSize = minimumBlockSize;
 	this->reserveSize = reserveSize;
@@ -30,7 +43,11 @@ void memory_arena::ensureFreeSizeInternal(uint64 size)
 	{
 		uint64 allocationSize = max(size, minimumBlockSize);
 		allocationSize = pageSize * bucketize(allocationSize, pageSize); // Round up to next page boundary.
+#if defined(_WIN32)
 		VirtualAlloc(memory + committedMemory, allocationSize, MEM_COMMIT, PAGE_READWRITE);
+#else
+		mprotect(memory + committedMemory, allocationSize, PROT_READ | PROT_WRITE);
+#endif
 
 		sizeLeftTotal += allocationSize;
 		sizeLeftCurrent += allocationSize;
@@ -90,7 +107,11 @@ void memory_arena::reset(bool freeMemory)
 {
 	if (memory && freeMemory)
 	{
+#if defined(_WIN32)
 		VirtualFree(memory, 0, MEM_RELEASE);
+#else
+		munmap(memory, reserveSize);
+#endif
 		memory = 0;
 		committedMemory = 0;
 	}
@@ -6,6 +6,24 @@
 
 #define SIMD_SSE_2 // All x64 processors support SSE2.
 
+// Lane access. MSVC exposes the lanes as union members, GCC and Clang allow subscripting the vector types directly.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define M128_F32(v, i) ((v).m128_f32[i])
+#define M128I_I32(v, i) ((v).m128i_i32[i])
+#define M256_F32(v, i) ((v).m256_f32[i])
+#define M256I_I32(v, i) ((v).m256i_i32[i])
+#define M512_F32(v, i) ((v).m512_f32[i])
+#define M512I_I32(v, i) ((v).m512i_i32[i])
+#else
+#define M128_F32(v, i) (((__v4sf)(v))[i])
+#define M128I_I32(v, i) (((__v4si)(v))[i])
+#define M256_F32(v, i) (((__v8sf)(v))[i])
+#define M256I_I32(v, i) (((__v8si)(v))[i])
+#define M512_F32(v, i) (((__v16sf)(v))[i])
+#define M512I_I32(v, i) (((__v16si)(v))[i])
+#endif
+
+// The AVX-512 path uses the F, BW, DQ and VL subsets, which is what /arch:AVX512 (MSVC) and the premake option physics-avx512 enable.
 #if defined(__AVX__)
 #if defined(__AVX512F__)
 #define SIMD_AVX_512
@@ -152,7 +170,7 @@ static float_t acosInternal(float_t x)
 {
 	// https://developer.download.nvidia.com/cg/acos.html
 
-	float_t negate = ifThen(x < 0.f, 1.f, 0.f);
+	float_t negate = ifThen(x < 0.f, float_t(1.f), float_t(0.f));
 	x = abs(x);
 	float_t ret = -0.0187293f;
 	ret = fmadd(ret, x, 0.0742610f);
@@ -181,11 +199,11 @@ struct w4_float
 	w4_float(const float* baseAddress, int a, int b, int c, int d) : w4_float(baseAddress, _mm_setr_epi32(a, b, c, d)) {}
 #else
 	w4_float(const float* baseAddress, int a, int b, int c, int d) { f = _mm_setr_ps(baseAddress[a], baseAddress[b], baseAddress[c], baseAddress[d]);  }
-	w4_float(const float* baseAddress, __m128i indices) : w4_float(baseAddress, indices.m128i_i32[0], indices.m128i_i32[1], indices.m128i_i32[2], indices.m128i_i32[3]) {}
+	w4_float(const float* baseAddress, __m128i indices) : w4_float(baseAddress, M128I_I32(indices, 0), M128I_I32(indices, 1), M128I_I32(indices, 2), M128I_I32(indices, 3)) {}
 #endif
 
 	operator __m128() { return f; }
-	float operator[](uint32 i) const { return this->f.m128_f32[i]; }
+	float operator[](uint32 i) const { return M128_F32(this->f, i); }
 
 	void store(float* f_) const { _mm_storeu_ps(f_, f); }
 
@@ -195,18 +213,18 @@ struct w4_float
 #else
 	void scatter(float* baseAddress, int a, int b, int c, int d) const
 	{
-		baseAddress[a] = this->f.m128_f32[0];
-		baseAddress[b] = this->f.m128_f32[1];
-		baseAddress[c] = this->f.m128_f32[2];
-		baseAddress[d] = this->f.m128_f32[3];
+		baseAddress[a] = M128_F32(this->f, 0);
+		baseAddress[b] = M128_F32(this->f, 1);
+		baseAddress[c] = M128_F32(this->f, 2);
+		baseAddress[d] = M128_F32(this->f, 3);
 	}
 
 	void scatter(float* baseAddress, __m128i indices) const
 	{
-		baseAddress[indices.m128i_i32[0]] = this->f.m128_f32[0];
-		baseAddress[indices.m128i_i32[1]] = this->f.m128_f32[1];
-		baseAddress[indices.m128i_i32[2]] = this->f.m128_f32[2];
-		baseAddress[indices.m128i_i32[3]] = this->f.m128_f32[3];
+		baseAddress[M128I_I32(indices, 0)] = M128_F32(this->f, 0);
+		baseAddress[M128I_I32(indices, 1)] = M128_F32(this->f, 1);
+		baseAddress[M128I_I32(indices, 2)] = M128_F32(this->f, 2);
+		baseAddress[M128I_I32(indices, 3)] = M128_F32(this->f, 3);
 	}
 #endif
 
@@ -222,18 +240,18 @@ struct w4_int
 	w4_int(int i_) { i = _mm_set1_epi32(i_); }
 	w4_int(__m128i i_) { i = i_; }
 	w4_int(int a, int b, int c, int d) { i = _mm_setr_epi32(a, b, c, d); }
-	w4_int(int* i_) { i = _mm_loadu_si128((const __m128i*)i_); }
+	w4_int(const int* i_) { i = _mm_loadu_si128((const __m128i*)i_); }
 
 #if defined(SIMD_AVX_2)
 	w4_int(const int* baseAddress, __m128i indices) { i = _mm_i32gather_epi32(baseAddress, indices, 4); }
 	w4_int(const int* baseAddress, int a, int b, int c, int d) : w4_int(baseAddress, _mm_setr_epi32(a, b, c, d)) {}
 #else
 	w4_int(const int* baseAddress, int a, int b, int c, int d) { i = _mm_setr_epi32(baseAddress[a], baseAddress[b], baseAddress[c], baseAddress[d]); }
-	w4_int(const int* baseAddress, __m128i indices) : w4_int(baseAddress, indices.m128i_i32[0], indices.m128i_i32[1], indices.m128i_i32[2], indices.m128i_i32[3]) {}
+	w4_int(const int* baseAddress, __m128i indices) : w4_int(baseAddress, M128I_I32(indices, 0), M128I_I32(indices, 1), M128I_I32(indices, 2), M128I_I32(indices, 3)) {}
 #endif
 
 	operator __m128i() { return i; }
-	int operator[](uint32 i) const { return this->i.m128i_i32[i]; }
+	int operator[](uint32 i) const { return M128I_I32(this->i, i); }
 
 	void store(int* i_) const { _mm_storeu_si128((__m128i*)i_, i); }
 
@@ -243,18 +261,18 @@ struct w4_int
 #else
 	void scatter(int* baseAddress, int a, int b, int c, int d) const
 	{
-		baseAddress[a] = this->i.m128i_i32[0];
-		baseAddress[b] = this->i.m128i_i32[1];
-		baseAddress[c] = this->i.m128i_i32[2];
-		baseAddress[d] = this->i.m128i_i32[3];
+		baseAddress[a] = M128I_I32(this->i, 0);
+		baseAddress[b] = M128I_I32(this->i, 1);
+		baseAddress[c] = M128I_I32(this->i, 2);
+		baseAddress[d] = M128I_I32(this->i, 3);
 	}
 
 	void scatter(int* baseAddress, __m128i indices) const
 	{
-		baseAddress[indices.m128i_i32[0]] = this->i.m128i_i32[0];
-		baseAddress[indices.m128i_i32[1]] = this->i.m128i_i32[1];
-		baseAddress[indices.m128i_i32[2]] = this->i.m128i_i32[2];
-		baseAddress[indices.m128i_i32[3]] = this->i.m128i_i32[3];
+		baseAddress[M128I_I32(indices, 0)] = M128I_I32(this->i, 0);
+		baseAddress[M128I_I32(indices, 1)] = M128I_I32(this->i, 1);
+		baseAddress[M128I_I32(indices, 2)] = M128I_I32(this->i, 2);
+		baseAddress[M128I_I32(indices, 3)] = M128I_I32(this->i, 3);
 	}
 #endif
 
@@ -275,9 +293,24 @@ static w4_int operator+(w4_int a, w4_int b) { return _mm_add_epi32(a, b); }
 static w4_int& operator+=(w4_int& a, w4_int b) { a = a + b; return a; }
 static w4_int operator-(w4_int a, w4_int b) { return _mm_sub_epi32(a, b); }
 static w4_int& operator-=(w4_int& a, w4_int b) { a = a - b; return a; }
+#if defined(SIMD_AVX_2)
 static w4_int operator*(w4_int a, w4_int b) { return _mm_mul_epi32(a, b); }
+#else
+// SSE2 only has the unsigned multiply of the even lanes. The low 32 bits of the product are the same for signed and unsigned operands.
+static w4_int operator*(w4_int a, w4_int b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
 static w4_int& operator*=(w4_int& a, w4_int b) { a = a * b; return a; }
+#if defined(_MSC_VER) && !defined(__clang__)
 static w4_int operator/(w4_int a, w4_int b) { return _mm_div_epi32(a, b); }
+#else
+// SVML is MSVC only. There is no integer division instruction, so divide per lane.
+static w4_int operator/(w4_int a, w4_int b) { return _mm_setr_epi32(a[0] / b[0], a[1] / b[1], a[2] / b[2], a[3] / b[3]); }
+#endif
 static w4_int& operator/=(w4_int& a, w4_int b) { a = a / b; return a; }
 static w4_int operator&(w4_int a, w4_int b) { return _mm_and_si128(a, b); }
 static w4_int& operator&=(w4_int& a, w4_int b) { a = a & b; return a; }
@@ -289,11 +322,19 @@ static w4_int& operator^=(w4_int& a, w4_int b) { a = a ^ b; return a; }
 static w4_int operator~(w4_int a) { a = andNot(a, w4_int::allOnes()); return a; }
 
 static w4_int operator>>(w4_int a, int b) { return _mm_srli_epi32(a, b); }
+#if defined(SIMD_AVX_2)
 static w4_int operator>>(w4_int a, w4_int b) { return _mm_srlv_epi32(a, b); }
+#else
+static w4_int operator>>(w4_int a, w4_int b) { return _mm_setr_epi32((uint32)a[0] >> b[0], (uint32)a[1] >> b[1], (uint32)a[2] >> b[2], (uint32)a[3] >> b[3]); }
+#endif
 static w4_int& operator>>=(w4_int& a, int b) { a = a >> b; return a; }
 static w4_int& operator>>=(w4_int& a, w4_int b) { a = a >> b; return a; }
 static w4_int operator<<(w4_int a, int b) { return _mm_slli_epi32(a, b); }
+#if defined(SIMD_AVX_2)
 static w4_int operator<<(w4_int a, w4_int b) { return _mm_sllv_epi32(a, b); }
+#else
+static w4_int operator<<(w4_int a, w4_int b) { return _mm_setr_epi32((uint32)a[0] << b[0], (uint32)a[1] << b[1], (uint32)a[2] << b[2], (uint32)a[3] << b[3]); }
+#endif
 static w4_int& operator<<=(w4_int& a, int b) { a = a << b; return a; }
 static w4_int& operator<<=(w4_int& a, w4_int b) { a = a << b; return a; }
 
@@ -346,16 +387,40 @@ static w4_float operator-(w4_float a) { return _mm_xor_ps(a, reinterpret(w4_int(
 
 
 
-static float addElements(w4_float a) { __m128 aa = _mm_hadd_ps(a, a); aa = _mm_hadd_ps(aa, aa); return aa.m128_f32[0]; }
+// Without AVX2, the 4-wide path must run on plain SSE2 (see core/simd_dispatch.h). FMA, SSE3 and SSE4.1 instructions are emulated there.
+#if defined(SIMD_AVX_2)
+static float addElements(w4_float a) { __m128 aa = _mm_hadd_ps(a, a); aa = _mm_hadd_ps(aa, aa); return M128_F32(aa, 0); }
 
 static w4_float fmadd(w4_float a, w4_float b, w4_float c) { return _mm_fmadd_ps(a, b, c); }
 static w4_float fmsub(w4_float a, w4_float b, w4_float c) { return _mm_fmsub_ps(a, b, c); }
+#else
+static float addElements(w4_float a)
+{
+	__m128 aa = _mm_add_ps(a, _mm_movehl_ps(a, a));
+	aa = _mm_add_ss(aa, _mm_shuffle_ps(aa, aa, _MM_SHUFFLE(1, 1, 1, 1)));
+	return _mm_cvtss_f32(aa);
+}
+
+static w4_float fmadd(w4_float a, w4_float b, w4_float c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+static w4_float fmsub(w4_float a, w4_float b, w4_float c) { return _mm_sub_ps(_mm_mul_ps(a, b), c); }
+#endif
 
 static w4_float sqrt(w4_float a) { return _mm_sqrt_ps(a); }
+#if PHYSICS_DETERMINISTIC
+// The precision of the hardware approximation differs between CPU vendors.
+static w4_float rsqrt(w4_float a) { return 1.f / _mm_sqrt_ps(a); }
+#else
 static w4_float rsqrt(w4_float a) { return _mm_rsqrt_ps(a); }
+#endif
 
+#if defined(SIMD_AVX_2)
 static w4_float ifThen(w4_float cond, w4_float ifCase, w4_float elseCase) { return _mm_blendv_ps(elseCase, ifCase, cond); }
+#else
+// Unlike blendv, this requires all bits of a lane in cond to be equal, which holds for all comparison results.
+static w4_float ifThen(w4_float cond, w4_float ifCase, w4_float elseCase) { return _mm_or_ps(_mm_and_ps(cond, ifCase), _mm_andnot_ps(cond, elseCase)); }
+#endif
 static w4_int ifThen(w4_int cond, w4_int ifCase, w4_int elseCase) { return reinterpret(ifThen(reinterpret(cond), reinterpret(ifCase), reinterpret(elseCase))); }
+static w4_float ifThen(w4_int cond, w4_float ifCase, w4_float elseCase) { return ifThen(reinterpret(cond), ifCase, elseCase); }
 
 static int toBitMask(w4_float a) { return _mm_movemask_ps(a); }
 static int toBitMask(w4_int a) { return toBitMask(reinterpret(a)); }
@@ -371,8 +436,18 @@ static bool anyTrue(w4_int a) { return anyTrue(reinterpret(a)); }
 static bool anyFalse(w4_int a) { return anyFalse(reinterpret(a)); }
 
 static w4_float abs(w4_float a) { w4_float result = andNot(-0.f, a); return result; }
+#if defined(SIMD_AVX_2)
 static w4_float floor(w4_float a) { return _mm_floor_ps(a); }
 static w4_float round(w4_float a) { return _mm_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+#else
+// Both go through 32-bit integers, so they are only valid for |a| < 2^31.
+static w4_float floor(w4_float a)
+{
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+	return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a), _mm_set1_ps(1.f)));
+}
+static w4_float round(w4_float a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); } // Round to nearest even, the default MXCSR mode.
+#endif
 static w4_float minimum(w4_float a, w4_float b) { return _mm_min_ps(a, b); }
 static w4_float maximum(w4_float a, w4_float b) { return _mm_max_ps(a, b); }
 
@@ -414,7 +489,9 @@ static void transpose(w4_float& out0, w4_float& out1, w4_float& out2, w4_float&
 	_MM_TRANSPOSE4_PS(out0.f, out1.f, out2.f, out3.f);
 }
 
-static void load4(const float* baseAddress, const uint16* indices, uint32 stride,
+// Strided gathers and scatters of structures, transposed into SIMD registers. The index type can be any integer type (16-bit or 32-bit).
+template <typename index_t>
+static void load4(const float* baseAddress, const index_t* indices, uint32 stride,
 	w4_float& out0, w4_float& out1, w4_float& out2, w4_float& out3)
 {
 	const uint32 strideInFloats = stride / sizeof(float);
@@ -427,7 +504,8 @@ static void load4(const float* baseAddress, const uint16* indices, uint32 stride
 	transpose(out0, out1, out2, out3);
 }
 
-static void store4(float* baseAddress, const uint16* indices, uint32 stride,
+template <typename index_t>
+static void store4(float* baseAddress, const index_t* indices, uint32 stride,
 	w4_float in0, w4_float in1, w4_float in2, w4_float in3)
 {
 	const uint32 strideInFloats = stride / sizeof(float);
@@ -440,7 +518,8 @@ static void store4(float* baseAddress, const uint16* indices, uint32 stride,
 	in3.store(baseAddress + strideInFloats * indices[3]);
 }
 
-static void load8(const float* baseAddress, const uint16* indices, uint32 stride,
+template <typename index_t>
+static void load8(const float* baseAddress, const index_t* indices, uint32 stride,
 	w4_float& out0, w4_float& out1, w4_float& out2, w4_float& out3, w4_float& out4, w4_float& out5, w4_float& out6, w4_float& out7)
 {
 	const uint32 strideInFloats = stride / sizeof(float);
@@ -458,7 +537,8 @@ static void load8(const float* baseAddress, const uint16* indices, uint32 stride
 	transpose(out4, out5, out6, out7);
 }
 
-static void store8(float* baseAddress, const uint16* indices, uint32 stride,
+template <typename index_t>
+static void store8(float* baseAddress, const index_t* indices, uint32 stride,
 	w4_float in0, w4_float in1, w4_float in2, w4_float in3, w4_float in4, w4_float in5, w4_float in6, w4_float in7)
 {
 	const uint32 strideInFloats = stride / sizeof(float);
@@ -494,7 +574,7 @@ struct w8_float
 	w8_float(const float* baseAddress, int a, int b, int c, int d, int e, int f, int g, int h) : w8_float(baseAddress, _mm256_setr_epi32(a, b, c, d, e, f, g, h)) {}
 
 	operator __m256() { return f; }
-	float operator[](uint32 i) const { return this->f.m256_f32[i]; }
+	float operator[](uint32 i) const { return M256_F32(this->f, i); }
 
 	void store(float* f_) const { _mm256_storeu_ps(f_, f); }
 
@@ -504,26 +584,26 @@ struct w8_float
 #else
 	void scatter(float* baseAddress, int a, int b, int c, int d, int e, int f, int g, int h) const
 	{
-		baseAddress[a] = this->f.m256_f32[0];
-		baseAddress[b] = this->f.m256_f32[1];
-		baseAddress[c] = this->f.m256_f32[2];
-		baseAddress[d] = this->f.m256_f32[3];
-		baseAddress[e] = this->f.m256_f32[4];
-		baseAddress[f] = this->f.m256_f32[5];
-		baseAddress[g] = this->f.m256_f32[6];
-		baseAddress[h] = this->f.m256_f32[7];
+		baseAddress[a] = M256_F32(this->f, 0);
+		baseAddress[b] = M256_F32(this->f, 1);
+		baseAddress[c] = M256_F32(this->f, 2);
+		baseAddress[d] = M256_F32(this->f, 3);
+		baseAddress[e] = M256_F32(this->f, 4);
+		baseAddress[f] = M256_F32(this->f, 5);
+		baseAddress[g] = M256_F32(this->f, 6);
+		baseAddress[h] = M256_F32(this->f, 7);
 	}
 
 	void scatter(float* baseAddress, __m256i indices) const
 	{
-		baseAddress[indices.m256i_i32[0]] = this->f.m256_f32[0];
-		baseAddress[indices.m256i_i32[1]] = this->f.m256_f32[1];
-		baseAddress[indices.m256i_i32[2]] = this->f.m256_f32[2];
-		baseAddress[indices.m256i_i32[3]] = this->f.m256_f32[3];
-		baseAddress[indices.m256i_i32[4]] = this->f.m256_f32[4];
-		baseAddress[indices.m256i_i32[5]] = this->f.m256_f32[5];
-		baseAddress[indices.m256i_i32[6]] = this->f.m256_f32[6];
-		baseAddress[indices.m256i_i32[7]] = this->f.m256_f32[7];
+		baseAddress[M256I_I32(indices, 0)] = M256_F32(this->f, 0);
+		baseAddress[M256I_I32(indices, 1)] = M256_F32(this->f, 1);
+		baseAddress[M256I_I32(indices, 2)] = M256_F32(this->f, 2);
+		baseAddress[M256I_I32(indices, 3)] = M256_F32(this->f, 3);
+		baseAddress[M256I_I32(indices, 4)] = M256_F32(this->f, 4);
+		baseAddress[M256I_I32(indices, 5)] = M256_F32(this->f, 5);
+		baseAddress[M256I_I32(indices, 6)] = M256_F32(this->f, 6);
+		baseAddress[M256I_I32(indices, 7)] = M256_F32(this->f, 7);
 	}
 #endif
 
@@ -539,15 +619,15 @@ struct w8_int
 	w8_int(int i_) { i = _mm256_set1_epi32(i_); }
 	w8_int(__m256i i_) { i = i_; }
 	w8_int(int a, int b, int c, int d, int e, int f, int g, int h) { this->i = _mm256_setr_epi32(a, b, c, d, e, f, g, h); }
-	w8_int(const int* i_) { i = _mm256_loadu_epi32(i_); }
+	w8_int(const int* i_) { i = _mm256_loadu_si256((const __m256i*)i_); }
 
 	w8_int(const int* baseAddress, __m256i indices) { i = _mm256_i32gather_epi32(baseAddress, indices, 4); }
 	w8_int(const int* baseAddress, int a, int b, int c, int d, int e, int f, int g, int h) : w8_int(baseAddress, _mm256_setr_epi32(a, b, c, d, e, f, g, h)) {}
 
 	operator __m256i() { return i; }
-	int operator[](uint32 i) const { return this->i.m256i_i32[i]; }
+	int operator[](uint32 i) const { return M256I_I32(this->i, i); }
 
-	void store(int* i_) const { _mm256_storeu_epi32(i_, i); }
+	void store(int* i_) const { _mm256_storeu_si256((__m256i*)i_, i); }
 
 #if defined(SIMD_AVX_512)
 	void scatter(int* baseAddress, __m256i indices) { _mm256_i32scatter_epi32(baseAddress, indices, i, 4); }
@@ -555,26 +635,26 @@ struct w8_int
 #else
 	void scatter(int* baseAddress, int a, int b, int c, int d, int e, int f, int g, int h) const
 	{
-		baseAddress[a] = this->i.m256i_i32[0];
-		baseAddress[b] = this->i.m256i_i32[1];
-		baseAddress[c] = this->i.m256i_i32[2];
-		baseAddress[d] = this->i.m256i_i32[3];
-		baseAddress[e] = this->i.m256i_i32[4];
-		baseAddress[f] = this->i.m256i_i32[5];
-		baseAddress[g] = this->i.m256i_i32[6];
-		baseAddress[h] = this->i.m256i_i32[7];
+		baseAddress[a] = M256I_I32(this->i, 0);
+		baseAddress[b] = M256I_I32(this->i, 1);
+		baseAddress[c] = M256I_I32(this->i, 2);
+		baseAddress[d] = M256I_I32(this->i, 3);
+		baseAddress[e] = M256I_I32(this->i, 4);
+		baseAddress[f] = M256I_I32(this->i, 5);
+		baseAddress[g] = M256I_I32(this->i, 6);
+		baseAddress[h] = M256I_I32(this->i, 7);
 	}
 
 	void scatter(int* baseAddress, __m256i indices) const
 	{
-		baseAddress[indices.m256i_i32[0]] = this->i.m256i_i32[0];
-		baseAddress[indices.m256i_i32[1]] = this->i.m256i_i32[1];
-		baseAddress[indices.m256i_i32[2]] = this->i.m256i_i32[2];
-		baseAddress[indices.m256i_i32[3]] = this->i.m256i_i32[3];
-		baseAddress[indices.m256i_i32[4]] = this->i.m256i_i32[4];
-		baseAddress[indices.m256i_i32[5]] = this->i.m256i_i32[5];
-		baseAddress[indices.m256i_i32[6]] = this->i.m256i_i32[6];
-		baseAddress[indices.m256i_i32[7]] = this->i.m256i_i32[7];
+		baseAddress[M256I_I32(indices, 0)] = M256I_I32(this->i, 0);
+		baseAddress[M256I_I32(indices, 1)] = M256I_I32(this->i, 1);
+		baseAddress[M256I_I32(indices, 2)] = M256I_I32(this->i, 2);
+		baseAddress[M256I_I32(indices, 3)] = M256I_I32(this->i, 3);
+		baseAddress[M256I_I32(indices, 4)] = M256I_I32(this->i, 4);
+		baseAddress[M256I_I32(indices, 5)] = M256I_I32(this->i, 5);
+		baseAddress[M256I_I32(indices, 6)] = M256I_I32(this->i, 6);
+		baseAddress[M256I_I32(indices, 7)] = M256I_I32(this->i, 7);
 	}
 #endif
 
@@ -597,7 +677,11 @@ static w8_int operator-(w8_int a, w8_int b) { return _mm256_sub_epi32(a, b); }
 static w8_int& operator-=(w8_int& a, w8_int b) { a = a - b; return a; }
 static w8_int operator*(w8_int a, w8_int b) { return _mm256_mul_epi32(a, b); }
 static w8_int& operator*=(w8_int& a, w8_int b) { a = a * b; return a; }
+#if defined(_MSC_VER) && !defined(__clang__)
 static w8_int operator/(w8_int a, w8_int b) { return _mm256_div_epi32(a, b); }
+#else
+static w8_int operator/(w8_int a, w8_int b) { return _mm256_setr_epi32(a[0] / b[0], a[1] / b[1], a[2] / b[2], a[3] / b[3], a[4] / b[4], a[5] / b[5], a[6] / b[6], a[7] / b[7]); }
+#endif
 static w8_int& operator/=(w8_int& a, w8_int b) { a = a / b; return a; }
 static w8_int operator&(w8_int a, w8_int b) { return _mm256_and_si256(a, b); }
 static w8_int& operator&=(w8_int& a, w8_int b) { a = a & b; return a; }
@@ -685,13 +769,17 @@ static w8_float operator-(w8_float a) { return _mm256_xor_ps(a, reinterpret(w8_i
 
 
 
-static float addElements(w8_float a) { __m256 aa = _mm256_hadd_ps(a, a); aa = _mm256_hadd_ps(aa, aa); return aa.m256_f32[0] + aa.m256_f32[4]; }
+static float addElements(w8_float a) { __m256 aa = _mm256_hadd_ps(a, a); aa = _mm256_hadd_ps(aa, aa); return M256_F32(aa, 0) + M256_F32(aa, 4); }
 
 static w8_float fmadd(w8_float a, w8_float b, w8_float c) { return _mm256_fmadd_ps(a, b, c); }
 static w8_float fmsub(w8_float a, w8_float b, w8_float c) { return _mm256_fmsub_ps(a, b, c); }
 
 static w8_float sqrt(w8_float a) { return _mm256_sqrt_ps(a); }
+#if PHYSICS_DETERMINISTIC
+static w8_float rsqrt(w8_float a) { return 1.f / _mm256_sqrt_ps(a); }
+#else
 static w8_float rsqrt(w8_float a) { return _mm256_rsqrt_ps(a); }
+#endif
 
 static int toBitMask(w8_float a) { return _mm256_movemask_ps(a); }
 static int toBitMask(w8_int a) { return toBitMask(reinterpret(a)); }
@@ -709,6 +797,7 @@ static bool anyFalse(uint8 a) { return !allTrue(a); }
 #else
 static w8_float ifThen(w8_float cond, w8_float ifCase, w8_float elseCase) { return _mm256_blendv_ps(elseCase, ifCase, cond); }
 static w8_int ifThen(w8_int cond, w8_int ifCase, w8_int elseCase) { return reinterpret(ifThen(reinterpret(cond), reinterpret(ifCase), reinterpret(elseCase))); }
+static w8_float ifThen(w8_int cond, w8_float ifCase, w8_float elseCase) { return ifThen(reinterpret(cond), ifCase, elseCase); }
 
 static bool allTrue(w8_float a) { return toBitMask(a) == (1 << 8) - 1; }
 static bool allFalse(w8_float a) { return toBitMask(a) == 0; }
@@ -827,7 +916,8 @@ static void transpose(w8_float& out0, w8_float& out1, w8_float& out2, w8_float&
 	transpose32(out4, out5, out6, out7);
 }
 
-static void load4(const float* baseAddress, const uint16* indices, uint32 stride,
+template <typename index_t>
+static void load4(const float* baseAddress, const index_t* indices, uint32 stride,
 	w8_float& out0, w8_float& out1, w8_float& out2, w8_float& out3)
 {
 	const uint32 strideInFloats = stride / sizeof(float);
@@ -849,7 +939,8 @@ static void load4(const float* baseAddress, const uint16* indices, uint32 stride
 	transpose32(out0, out1, out2, out3);
 }
 
-static void load8(const float* baseAddress, const uint16* indices, uint32 stride,
+template <typename index_t>
+static void load8(const float* baseAddress, const index_t* indices, uint32 stride,
 	w8_float& out0, w8_float& out1, w8_float& out2, w8_float& out3, w8_float& out4, w8_float& out5, w8_float& out6, w8_float& out7)
 {
 	const uint32 strideInFloats = stride / sizeof(float);
@@ -866,7 +957,8 @@ static void load8(const float* baseAddress, const uint16* indices, uint32 stride
 	transpose(out0, out1, out2, out3, out4, out5, out6, out7);
 }
 
-static void store4(float* baseAddress, const uint16* indices, uint32 stride,
+template <typename index_t>
+static void store4(float* baseAddress, const index_t* indices, uint32 stride,
 	w8_float in0, w8_float in1, w8_float in2, w8_float in3)
 {
 	const uint32 strideInFloats = stride / sizeof(float);
@@ -892,7 +984,8 @@ static void store4(float* baseAddress, const uint16* indices, uint32 stride,
 	tmp7.store(baseAddress + strideInFloats * indices[7]);
 }
 
-static void store8(float* baseAddress, const uint16* indices, uint32 stride,
+template <typename index_t>
+static void store8(float* baseAddress, const index_t* indices, uint32 stride,
 	w8_float in0, w8_float in1, w8_float in2, w8_float in3, w8_float in4, w8_float in5, w8_float in6, w8_float in7)
 {
 	const uint32 strideInFloats = stride / sizeof(float);
@@ -928,11 +1021,15 @@ struct w16_float
 	w16_float(const float* baseAddress, int a, int b, int c, int d, int e, int f, int g, int h, int i, int j, int k, int l, int m, int n, int o, int p) : w16_float(baseAddress, _mm512_setr_epi32(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p)) {}
 
 	operator __m512() { return f; }
+	float operator[](uint32 i) const { return M512_F32(this->f, i); }
 
 	void store(float* f_) const { _mm512_storeu_ps(f_, f); }
 
 	void scatter(float* baseAddress, __m512i indices) const { _mm512_i32scatter_ps(baseAddress, indices, f, 4); }
 	void scatter(float* baseAddress, int a, int b, int c, int d, int e, int f, int g, int h, int i, int j, int k, int l, int m, int n, int o, int p) const { scatter(baseAddress, _mm512_setr_epi32(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p)); }
+
+	static w16_float allOnes() { const float nnan = (const float&)0xFFFFFFFF; return nnan; }
+	static w16_float zero() { return _mm512_setzero_ps(); }
 };
 
 struct w16_int
@@ -949,8 +1046,12 @@ struct w16_int
 	w16_int(const int* baseAddress, int a, int b, int c, int d, int e, int f, int g, int h, int i, int j, int k, int l, int m, int n, int o, int p) : w16_int(baseAddress, _mm512_setr_epi32(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p)) {}
 
 	operator __m512i() { return i; }
+	int operator[](uint32 i) const { return M512I_I32(this->i, i); }
 
 	void store(int* i_) const { _mm512_storeu_epi32(i_, i); }
+
+	static w16_int allOnes() { return UINT32_MAX; }
+	static w16_int zero() { return _mm512_setzero_si512(); }
 };
 
 static w16_float truex16() { const float nnan = (const float&)0xFFFFFFFF; return nnan; }
@@ -971,7 +1072,18 @@ static w16_int operator-(w16_int a, w16_int b) { return _mm512_sub_epi32(a, b);
 static w16_int& operator-=(w16_int& a, w16_int b) { a = a - b; return a; }
 static w16_int operator*(w16_int a, w16_int b) { return _mm512_mul_epi32(a, b); }
 static w16_int& operator*=(w16_int& a, w16_int b) { a = a * b; return a; }
+#if defined(_MSC_VER) && !defined(__clang__)
 static w16_int operator/(w16_int a, w16_int b) { return _mm512_div_epi32(a, b); }
+#else
+static w16_int operator/(w16_int a, w16_int b)
+{
+	int32 aa[16], bb[16];
+	_mm512_storeu_si512(aa, a);
+	_mm512_storeu_si512(bb, b);
+	for (uint32 i = 0; i < 16; ++i) { aa[i] /= bb[i]; }
+	return _mm512_loadu_si512(aa);
+}
+#endif
 static w16_int& operator/=(w16_int& a, w16_int b) { a = a / b; return a; }
 static w16_int operator&(w16_int a, w16_int b) { return _mm512_and_epi32(a, b); }
 static w16_int& operator&=(w16_int& a, w16_int b) { a = a & b; return a; }
@@ -991,9 +1103,13 @@ static uint16 operator<=(w16_int a, w16_int b) { return _mm512_cmp_epi32_mask(a,
 
 
 static w16_int operator>>(w16_int a, int b) { return _mm512_srli_epi32(a, b); }
+static w16_int operator>>(w16_int a, w16_int b) { return _mm512_srlv_epi32(a, b); }
 static w16_int& operator>>=(w16_int& a, int b) { a = a >> b; return a; }
+static w16_int& operator>>=(w16_int& a, w16_int b) { a = a >> b; return a; }
 static w16_int operator<<(w16_int a, int b) { return _mm512_slli_epi32(a, b); }
+static w16_int operator<<(w16_int a, w16_int b) { return _mm512_sllv_epi32(a, b); }
 static w16_int& operator<<=(w16_int& a, int b) { a = a << b; return a; }
+static w16_int& operator<<=(w16_int& a, w16_int b) { a = a << b; return a; }
 
 static w16_int operator-(w16_int a) { return _mm512_sub_epi32(_mm512_setzero_si512(), a); }
 
@@ -1048,6 +1164,8 @@ static w16_float rsqrt(w16_float a) { return 1.f / _mm512_sqrt_ps(a); }
 static w16_float ifThen(uint16 cond, w16_float ifCase, w16_float elseCase) { return _mm512_mask_blend_ps(cond, elseCase, ifCase); }
 static w16_int ifThen(uint16 cond, w16_int ifCase, w16_int elseCase) { return reinterpret(ifThen(cond, reinterpret(ifCase), reinterpret(elseCase))); }
 
+static int toBitMask(uint16 a) { return a; }
+
 static bool allTrue(uint16 a) { return a == (1 << 16) - 1; }
 static bool allFalse(uint16 a) { return a == 0; }
 static bool anyTrue(uint16 a) { return a > 0; }
@@ -1079,9 +1197,118 @@ static w16_float atan(w16_float x) { return atanInternal<w16_float, w16_int>(x);
 static w16_float atan2(w16_float y, w16_float x) { return atan2Internal<w16_float, w16_int>(y, x); }
 static w16_float acos(w16_float x) { return acosInternal(x); }
 
+static w16_float concat(w8_float a, w8_float b)
+{
+	return _mm512_insertf32x8(_mm512_castps256_ps512(a), b, 1);
+}
+
+static w16_int concat(w8_int a, w8_int b)
+{
+	return _mm512_inserti32x8(_mm512_castsi256_si512(a), b, 1);
+}
+
+static w8_float getLower(w16_float a)
+{
+	return _mm512_castps512_ps256(a);
+}
+
+static w8_float getUpper(w16_float a)
+{
+	return _mm512_extractf32x8_ps(a, 1);
+}
+
+static w8_int getLower(w16_int a)
+{
+	return _mm512_castsi512_si256(a);
+}
+
+static w8_int getUpper(w16_int a)
+{
+	return _mm512_extracti32x8_epi32(a, 1);
+}
+
+static w16_int fillWithFirstLane(w16_int a)
+{
+	return _mm512_permutexvar_epi32(_mm512_setzero_si512(), a);
+}
+
+// Transposes the two 8x8 blocks independently. Afterwards, the lower half of outN holds lane N and the upper half holds lane N + 8.
+static void transpose(w16_float& out0, w16_float& out1, w16_float& out2, w16_float& out3, w16_float& out4, w16_float& out5, w16_float& out6, w16_float& out7)
+{
+	w8_float lo0 = getLower(out0), lo1 = getLower(out1), lo2 = getLower(out2), lo3 = getLower(out3);
+	w8_float lo4 = getLower(out4), lo5 = getLower(out5), lo6 = getLower(out6), lo7 = getLower(out7);
+	w8_float hi0 = getUpper(out0), hi1 = getUpper(out1), hi2 = getUpper(out2), hi3 = getUpper(out3);
+	w8_float hi4 = getUpper(out4), hi5 = getUpper(out5), hi6 = getUpper(out6), hi7 = getUpper(out7);
+
+	transpose(lo0, lo1, lo2, lo3, lo4, lo5, lo6, lo7);
+	transpose(hi0, hi1, hi2, hi3, hi4, hi5, hi6, hi7);
+
+	out0 = concat(lo0, hi0);
+	out1 = concat(lo1, hi1);
+	out2 = concat(lo2, hi2);
+	out3 = concat(lo3, hi3);
+	out4 = concat(lo4, hi4);
+	out5 = concat(lo5, hi5);
+	out6 = concat(lo6, hi6);
+	out7 = concat(lo7, hi7);
+}
+
+// The 16-wide gathers and scatters process the first and second 8 indices with the 8-wide versions.
+template <typename index_t>
+static void load4(const float* baseAddress, const index_t* indices, uint32 stride,
+	w16_float& out0, w16_float& out1, w16_float& out2, w16_float& out3)
+{
+	w8_float lo0, lo1, lo2, lo3;
+	w8_float hi0, hi1, hi2, hi3;
+	load4(baseAddress, indices, stride, lo0, lo1, lo2, lo3);
+	load4(baseAddress, indices + 8, stride, hi0, hi1, hi2, hi3);
+
+	out0 = concat(lo0, hi0);
+	out1 = concat(lo1, hi1);
+	out2 = concat(lo2, hi2);
+	out3 = concat(lo3, hi3);
+}
+
+template <typename index_t>
+static void load8(const float* baseAddress, const index_t* indices, uint32 stride,
+	w16_float& out0, w16_float& out1, w16_float& out2, w16_float& out3, w16_float& out4, w16_float& out5, w16_float& out6, w16_float& out7)
+{
+	w8_float lo0, lo1, lo2, lo3, lo4, lo5, lo6, lo7;
+	w8_float hi0, hi1, hi2, hi3, hi4, hi5, hi6, hi7;
+	load8(baseAddress, indices, stride, lo0, lo1, lo2, lo3, lo4, lo5, lo6, lo7);
+	load8(baseAddress, indices + 8, stride, hi0, hi1, hi2, hi3, hi4, hi5, hi6, hi7);
+
+	out0 = concat(lo0, hi0);
+	out1 = concat(lo1, hi1);
+	out2 = concat(lo2, hi2);
+	out3 = concat(lo3, hi3);
+	out4 = concat(lo4, hi4);
+	out5 = concat(lo5, hi5);
+	out6 = concat(lo6, hi6);
+	out7 = concat(lo7, hi7);
+}
+
+template <typename index_t>
+static void store4(float* baseAddress, const index_t* indices, uint32 stride,
+	w16_float in0, w16_float in1, w16_float in2, w16_float in3)
+{
+	store4(baseAddress, indices, stride, getLower(in0), getLower(in1), getLower(in2), getLower(in3));
+	store4(baseAddress, indices + 8, stride, getUpper(in0), getUpper(in1), getUpper(in2), getUpper(in3));
+}
+
+template <typename index_t>
+static void store8(float* baseAddress, const index_t* indices, uint32 stride,
+	w16_float in0, w16_float in1, w16_float in2, w16_float in3, w16_float in4, w16_float in5, w16_float in6, w16_float in7)
+{
+	store8(baseAddress, indices, stride, getLower(in0), getLower(in1), getLower(in2), getLower(in3), getLower(in4), getLower(in5), getLower(in6), getLower(in7));
+	store8(baseAddress, indices + 8, stride, getUpper(in0), getUpper(in1), getUpper(in2), getUpper(in3), getUpper(in4), getUpper(in5), getUpper(in6), getUpper(in7));
+}
+
 
 #endif
 
+// Combined AVX-512 comparison masks (a < b & c < d) are promoted to int.
+static int toBitMask(int32 mask) { return mask; }
 static bool anyTrue(int32 mask) { return mask > 0; }
 static bool anyTrue(uint32 mask) { return mask > 0; }
 
@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "simd_dispatch.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+
+static void cpuid(int32 out[4], int32 leaf, int32 subleaf) { __cpuidex(out, leaf, subleaf); }
+static uint64 xgetbv() { return _xgetbv(0); }
+
+#else
+#include <cpuid.h>
+
+static void cpuid(int32 out[4], int32 leaf, int32 subleaf)
+{
+	uint32 a, b, c, d;
+	__cpuid_count(leaf, subleaf, a, b, c, d);
+	out[0] = (int32)a; out[1] = (int32)b; out[2] = (int32)c; out[3] = (int32)d;
+}
+
+static uint64 xgetbv()
+{
+	// Encoded directly, so that this file doesn't need -mxsave.
+	uint32 a, d;
+	__asm__ volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(a), "=d"(d) : "c"(0));
+	return ((uint64)d << 32) | a;
+}
+
+#endif
+
+
+static simd_level detectSIMDLevel()
+{
+	int32 info[4];
+	cpuid(info, 0, 0);
+	int32 maxLeaf = info[0];
+
+	if (maxLeaf < 7)
+	{
+		return simd_level_sse2;
+	}
+
+	cpuid(info, 1, 0);
+	uint32 ecx1 = (uint32)info[2];
+
+	bool osxsave = ecx1 & (1 << 27);
+	bool avx = ecx1 & (1 << 28);
+	bool fma = ecx1 & (1 << 12);
+
+	if (!osxsave || !avx)
+	{
+		return simd_level_sse2;
+	}
+
+	// XCR0: SSE (bit 1) and AVX (bit 2) state. AVX-512 additionally needs the opmask and upper ZMM state (bits 5 to 7).
+	uint64 xcr0 = xgetbv();
+	bool osAVX = (xcr0 & 0x6) == 0x6;
+	bool osAVX512 = (xcr0 & 0xE6) == 0xE6;
+
+	cpuid(info, 7, 0);
+	uint32 ebx7 = (uint32)info[1];
+
+	bool avx2 = ebx7 & (1 << 5);
+	bool avx512f = ebx7 & (1 << 16);
+	bool avx512dq = ebx7 & (1 << 17);
+	bool avx512bw = ebx7 & (1 << 30);
+	bool avx512vl = ebx7 & (1u << 31);
+
+	if (!osAVX || !avx2 || !fma)
+	{
+		return simd_level_sse2;
+	}
+
+	if (osAVX512 && avx512f && avx512dq && avx512bw && avx512vl)
+	{
+		return simd_level_avx512;
+	}
+
+	return simd_level_avx2;
+}
+
+static bool isSIMDLevelAvailable(simd_level level)
+{
+#if PHYSICS_SIMD_DISPATCH && PHYSICS_DETERMINISTIC
+	// The kernels of each level process a different number of lanes and round differently (e.g. FMA), so results are only bit-identical across
+	// machines, if all of them run the same level. SSE2 is the only one every x64 CPU supports.
+	return level == simd_level_sse2;
+#elif PHYSICS_SIMD_DISPATCH
+	return level <= getSupportedSIMDLevel();
+#else
+	return level == SIMD_ISA_LEVEL;
+#endif
+}
+
+static simd_level getDefaultSIMDLevel()
+{
+#if PHYSICS_SIMD_DISPATCH && PHYSICS_DETERMINISTIC
+	simd_level result = simd_level_sse2;
+#elif PHYSICS_SIMD_DISPATCH
+	simd_level result = getSupportedSIMDLevel();
+#else
+	simd_level result = SIMD_ISA_LEVEL;
+#endif
+
+	if (const char* forced = getenv("PHYSICS_SIMD_LEVEL"))
+	{
+		for (uint32 i = 0; i < simd_level_count; ++i)
+		{
+			if (strcmp(forced, simdLevelNames[i]) == 0 && isSIMDLevelAvailable((simd_level)i))
+			{
+				result = (simd_level)i;
+			}
+		}
+	}
+
+	return result;
+}
+
+static simd_level& currentSIMDLevel()
+{
+	// Initialized thread-safely on first use, so that kernels called during static initialization already see the right level.
+	static simd_level level = getDefaultSIMDLevel();
+	return level;
+}
+
+simd_level getSupportedSIMDLevel()
+{
+	static const simd_level supported = detectSIMDLevel();
+	return supported;
+}
+
+simd_level getSIMDLevel()
+{
+	return currentSIMDLevel();
+}
+
+bool setSIMDLevel(simd_level level)
+{
+	if (level >= simd_level_count || !isSIMDLevelAvailable(level))
+	{
+		return false;
+	}
+
+	currentSIMDLevel() = level;
+	return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "simd.h"
+
+// Runtime selection of the physics SIMD kernels (broad phase overlaps, narrow phase, constraint solver and cloth).
+// With PHYSICS_SIMD_DISPATCH, the build compiles each kernel file once per level, with the matching instruction set flags, into the namespaces
+// simd_sse2, simd_avx2 and simd_avx512. The rest of the code is compiled for SSE2 and calls the kernels through SIMD_DISPATCH, which picks the
+// level detected at startup. Without PHYSICS_SIMD_DISPATCH (the renderer and --physics-no-simd-dispatch), the kernels are compiled once, for the
+// instruction set of the compiler flags, and the level is fixed.
+//
+// Kernel files must only call inline and template functions that are static or live in the kernel's namespace. Otherwise the linker is free
+// to pick the copy compiled for a higher level and call it from the SSE2 code.
+
+enum simd_level
+{
+	simd_level_sse2, // 4 lanes.
+	simd_level_avx2, // 8 lanes. Includes FMA.
+	simd_level_avx512, // 16 lanes. F, BW, DQ and VL.
+
+	simd_level_count,
+};
+
+static const char* simdLevelNames[] =
+{
+	"sse2",
+	"avx2",
+	"avx512",
+};
+
+static_assert(arraysize(simdLevelNames) == simd_level_count);
+
+
+// Namespace and level of the kernels compiled in the current translation unit.
+#if defined(SIMD_AVX_512)
+#define SIMD_ISA simd_avx512
+#define SIMD_ISA_LEVEL simd_level_avx512
+#elif defined(SIMD_AVX_2)
+#define SIMD_ISA simd_avx2
+#define SIMD_ISA_LEVEL simd_level_avx2
+#else
+#define SIMD_ISA simd_sse2
+#define SIMD_ISA_LEVEL simd_level_sse2
+#endif
+
+
+// Highest level supported by both the CPU and the OS (which has to save the wider registers on context switches).
+simd_level getSupportedSIMDLevel();
+
+// Level the kernels are dispatched to. On first use, this is the highest level that is supported and compiled in, unless the environment
+// variable PHYSICS_SIMD_LEVEL names a lower one. The deterministic build (PHYSICS_DETERMINISTIC) with dispatch always runs the SSE2 kernels.
+simd_level getSIMDLevel();
+
+// Forces a level, e.g. to compare the kernels in benchmarks. Returns false and keeps the current level, if the level is not supported by the
+// CPU or not compiled in. Must not be called while a physics step is running. A constraint solver keeps the level it was initialized with.
+bool setSIMDLevel(simd_level level);
+
+
+#if PHYSICS_SIMD_DISPATCH
+
+// Declares the kernels in all three namespaces. Each kernel translation unit defines them in its own.
+#define SIMD_KERNEL_DECLARATIONS(...) \
+	namespace simd_sse2 { __VA_ARGS__ } \
+	namespace simd_avx2 { __VA_ARGS__ } \
+	namespace simd_avx512 { __VA_ARGS__ }
+
+#define SIMD_DISPATCH_LEVEL(level, name) (((level) == simd_level_avx512) ? simd_avx512::name : ((level) == simd_level_avx2) ? simd_avx2::name : simd_sse2::name)
+
+#else
+
+#define SIMD_KERNEL_DECLARATIONS(...) namespace SIMD_ISA { __VA_ARGS__ }
+#define SIMD_DISPATCH_LEVEL(level, name) SIMD_ISA::name
+
+#endif
+
+// Evaluates to the kernel function 'name' of the current level.
+#define SIMD_DISPATCH(name) SIMD_DISPATCH_LEVEL(getSIMDLevel(), name)
@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "threading.h"
+
+#if defined(_WIN32)
+
+void setCurrentThreadPriority(thread_priority priority)
+{
+	static const int priorities[] =
+	{
+		THREAD_PRIORITY_LOWEST,
+		THREAD_PRIORITY_BELOW_NORMAL,
+		THREAD_PRIORITY_NORMAL,
+		THREAD_PRIORITY_ABOVE_NORMAL,
+		THREAD_PRIORITY_HIGHEST,
+	};
+
+	SetThreadPriority(GetCurrentThread(), priorities[priority]);
+}
+
+void setCurrentThreadAffinity(uint32 core)
+{
+	// Cores beyond the first processor group can't be addressed with a simple mask. These threads are left to the scheduler.
+	if (core < 64)
+	{
+		SetThreadAffinityMask(GetCurrentThread(), 1ull << core);
+	}
+}
+
+void setCurrentThreadDescription(const wchar* description)
+{
+	SetThreadDescription(GetCurrentThread(), description);
+}
+
+#else
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+uint32 getThreadIDSlow()
+{
+	return (uint32)syscall(SYS_gettid);
+}
+
+void setCurrentThreadPriority(thread_priority priority)
+{
+	// Nice values. On Linux, setpriority with a thread ID only affects this thread.
+	static const int niceValues[] = { 10, 5, 0, -5, -10 };
+
+	setpriority(PRIO_PROCESS, (id_t)getThreadIDFast(), niceValues[priority]);
+}
+
+void setCurrentThreadAffinity(uint32 core)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core % CPU_SETSIZE, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+void setCurrentThreadDescription(const wchar* description)
+{
+	// Linux limits thread names to 15 characters.
+	char name[16];
+	uint32 length = 0;
+	while (description[length] && length < sizeof(name) - 1)
+	{
+		name[length] = (char)description[length];
+		++length;
+	}
+	name[length] = 0;
+
+	pthread_setname_np(pthread_self(), name);
+}
+
+#endif
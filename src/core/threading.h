@@ -3,6 +3,8 @@
 #include <functional>
 
 
+#if defined(_WIN32)
+
 // All functions return the value before the operation.
 static uint32 atomicAdd(volatile uint32& a, uint32 b) { return InterlockedAdd((volatile LONG*)&a, b) - b; }
 static uint64 atomicAdd(volatile uint64& a, uint64 b) {	return InterlockedAdd64((volatile LONG64*)&a, b) - b; }
@@ -22,3 +24,69 @@ static uint32 getThreadIDFast()
 	uint32 threadID = *(uint32*)(threadLocalStorage + 0x48);
 	return threadID;
 }
+
+static uint64 getPerformanceCounter()
+{
+	uint64 result;
+	QueryPerformanceCounter((LARGE_INTEGER*)&result);
+	return result;
+}
+
+static uint64 getPerformanceFrequency()
+{
+	uint64 result;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&result);
+	return result;
+}
+
+#else
+
+// All functions return the value before the operation. The GCC/Clang builtins have the same full-barrier semantics as the Interlocked functions.
+static uint32 atomicAdd(volatile uint32& a, uint32 b) { return __atomic_fetch_add(&a, b, __ATOMIC_SEQ_CST); }
+static uint64 atomicAdd(volatile uint64& a, uint64 b) { return __atomic_fetch_add(&a, b, __ATOMIC_SEQ_CST); }
+static uint32 atomicIncrement(volatile uint32& a) { return __atomic_fetch_add(&a, 1, __ATOMIC_SEQ_CST); }
+static uint64 atomicIncrement(volatile uint64& a) { return __atomic_fetch_add(&a, 1, __ATOMIC_SEQ_CST); }
+static uint32 atomicDecrement(volatile uint32& a) { return __atomic_fetch_sub(&a, 1, __ATOMIC_SEQ_CST); }
+static uint64 atomicDecrement(volatile uint64& a) { return __atomic_fetch_sub(&a, 1, __ATOMIC_SEQ_CST); }
+static uint32 atomicCompareExchange(volatile uint32& destination, uint32 exchange, uint32 compare) { __atomic_compare_exchange_n(&destination, &compare, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); return compare; }
+static uint64 atomicCompareExchange(volatile uint64& destination, uint64 exchange, uint64 compare) { __atomic_compare_exchange_n(&destination, &compare, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); return compare; }
+static uint32 atomicExchange(volatile uint32& destination, uint32 exchange) { return __atomic_exchange_n(&destination, exchange, __ATOMIC_SEQ_CST); }
+static uint64 atomicExchange(volatile uint64& destination, uint64 exchange) { return __atomic_exchange_n(&destination, exchange, __ATOMIC_SEQ_CST); }
+
+uint32 getThreadIDSlow();
+
+static uint32 getThreadIDFast()
+{
+	// The kernel thread ID requires a syscall, so it is cached per thread.
+	static thread_local uint32 threadID = getThreadIDSlow();
+	return threadID;
+}
+
+static uint64 getPerformanceCounter()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64)time.tv_sec * 1000000000ull + (uint64)time.tv_nsec;
+}
+
+static uint64 getPerformanceFrequency()
+{
+	return 1000000000ull;
+}
+
+#endif
+
+
+enum thread_priority
+{
+	thread_priority_lowest,
+	thread_priority_below_normal,
+	thread_priority_normal,
+	thread_priority_above_normal,
+	thread_priority_highest,
+};
+
+// These are only hints, so failures are ignored. On Linux, raising the priority above normal requires privileges.
+void setCurrentThreadPriority(thread_priority priority);
+void setCurrentThreadAffinity(uint32 core);
+void setCurrentThreadDescription(const wchar* description);
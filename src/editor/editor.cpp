@@ -1110,6 +1110,8 @@ bool scene_editor::drawSceneHierarchy()
 								ImGui::PropertySlider("Angular velocity damping", rb.angularDamping));
 							UNDOABLE_COMPONENT_SETTING("rigid body gravity factor", rb.gravityFactor,
 								ImGui::PropertySlider("Gravity factor", rb.gravityFactor));
+							UNDOABLE_COMPONENT_SETTING("rigid body continuous collision", rb.continuousCollision,
+								ImGui::PropertyCheckbox("Continuous collision", rb.continuousCollision));
 
 							//ImGui::PropertyValue("Linear velocity", rb.linearVelocity);
 							//ImGui::PropertyValue("Angular velocity", rb.angularVelocity);
@@ -1214,6 +1216,8 @@ bool scene_editor::drawSceneHierarchy()
 									ImGui::PropertySlider("Restitution", collider.material.restitution);
 									ImGui::PropertySlider("Friction", collider.material.friction);
 									dirty |= ImGui::PropertyDrag("Density", collider.material.density, 0.05f, 0.f);
+									ImGui::PropertyInput("Collision layer", collider.collisionLayer, "%08X");
+									ImGui::PropertyInput("Collision mask", collider.collisionMask, "%08X");
 
 									bool editCollider = selectedColliderEntity == colliderEntity;
 									if (ImGui::PropertyCheckbox("Edit", editCollider))
@@ -2666,6 +2670,8 @@ void scene_editor::drawSettings(float dt)
 
 				UNDOABLE_SETTING("rigid solver iterations", physicsSettings.numRigidSolverIterations,
 					ImGui::PropertySlider("Rigid solver iterations", physicsSettings.numRigidSolverIterations, 1, 200));
+				UNDOABLE_SETTING("warm start contacts", physicsSettings.warmStartContacts,
+					ImGui::PropertyCheckbox("Warm start contacts", physicsSettings.warmStartContacts));
 
 				UNDOABLE_SETTING("cloth velocity iterations", physicsSettings.numClothVelocityIterations,
 					ImGui::PropertySlider("Cloth velocity iterations", physicsSettings.numClothVelocityIterations, 0, 10));
@@ -2677,12 +2683,40 @@ void scene_editor::drawSettings(float dt)
 				UNDOABLE_SETTING("test force", physicsTestForce,
 					ImGui::PropertySlider("Test force", physicsTestForce, 1.f, 10000.f));
 
-				UNDOABLE_SETTING("SIMD broad phase", physicsSettings.simdBroadPhase,
-					ImGui::PropertyCheckbox("SIMD broad phase", physicsSettings.simdBroadPhase));
+				UNDOABLE_SETTING("broad phase", physicsSettings.broadphase,
+					ImGui::PropertyDropdown("Broad phase", broadphaseTypeNames, broadphase_type_count, (uint32&)physicsSettings.broadphase));
+				if (physicsSettings.broadphase == broadphase_type_sweep_and_prune)
+				{
+					UNDOABLE_SETTING("SIMD broad phase", physicsSettings.simdBroadPhase,
+						ImGui::PropertyCheckbox("SIMD broad phase", physicsSettings.simdBroadPhase));
+				}
 				UNDOABLE_SETTING("SIMD narrow phase", physicsSettings.simdNarrowPhase,
 					ImGui::PropertyCheckbox("SIMD narrow phase", physicsSettings.simdNarrowPhase));
+				UNDOABLE_SETTING("parallel narrow phase", physicsSettings.parallelNarrowPhase,
+					ImGui::PropertyCheckbox("Parallel narrow phase", physicsSettings.parallelNarrowPhase));
 				UNDOABLE_SETTING("SIMD constraint solver", physicsSettings.simdConstraintSolver,
 					ImGui::PropertyCheckbox("SIMD constraint solver", physicsSettings.simdConstraintSolver));
+				UNDOABLE_SETTING("parallel island solver", physicsSettings.parallelIslandSolver,
+					ImGui::PropertyCheckbox("Parallel island solver", physicsSettings.parallelIslandSolver));
+
+				UNDOABLE_SETTING("compute state hash", physicsSettings.computeStateHash,
+					ImGui::PropertyCheckbox("Compute state hash", physicsSettings.computeStateHash));
+				if (physicsSettings.computeStateHash)
+				{
+					ImGui::PropertyValue("State hash", "%016llX", getPhysicsStateHash(this->scene->getCurrentScene()));
+				}
+
+				UNDOABLE_SETTING("sleeping", physicsSettings.enableSleeping,
+					ImGui::PropertyCheckbox("Sleeping", physicsSettings.enableSleeping));
+				if (physicsSettings.enableSleeping)
+				{
+					UNDOABLE_SETTING("sleep linear velocity threshold", physicsSettings.sleepLinearVelocityThreshold,
+						ImGui::PropertySlider("Sleep linear velocity threshold", physicsSettings.sleepLinearVelocityThreshold, 0.f, 1.f));
+					UNDOABLE_SETTING("sleep angular velocity threshold", physicsSettings.sleepAngularVelocityThreshold,
+						ImGui::PropertySlider("Sleep angular velocity threshold", physicsSettings.sleepAngularVelocityThreshold, 0.f, 1.f));
+					UNDOABLE_SETTING("sleep time", physicsSettings.sleepTime,
+						ImGui::PropertySlider("Sleep time", physicsSettings.sleepTime, 0.f, 5.f));
+				}
 
 				ImGui::EndProperties();
 			}
@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "learned_locomotion.h"
 #include "core/random.h"
+#include "physics/physics_snapshot.h"
+#include "core/job_system.h"
 
 
 #if __has_include("../tmp/network.h")
@@ -386,16 +388,105 @@ static void getLimits(game_scene& scene, cone_twist_constraint_handle handle, fl
 
 
 
-static training_locomotion* trainingEnv = 0;
-static memory_arena stackArena;
-static game_scene trainingScene;
-static float totalReward;
-static random_number_generator rng = { (uint32)time(0) };
+// One independent training environment. The single environment entry points and the batched ones share this.
+struct training_environment
+{
+	void initialize(uint64 seed, memory_arena& snapshotArena);
+	void reset(float* outState);
+	bool step(const float* action, float* outState, float* outReward, bool parallelPhysics);
+
+	training_locomotion locomotion;
+	game_scene scene;
+	memory_arena stackArena;
+	physics_snapshot initialSnapshot;
+	random_number_generator rng;
+	float totalReward;
+};
+
+void training_environment::initialize(uint64 seed, memory_arena& snapshotArena)
+{
+	stackArena.initialize(0, MB(256));
+	rng = { seed };
+
+	physics_material groundMaterial = { physics_material_type_metal, 0.1f, 1.f, 4.f };
+
+	scene.createEntity("Test ground")
+		.addComponent<transform_component>(vec3(0.f, -4.f, 0.f), quat(vec3(1.f, 0.f, 0.f), deg2rad(0.f)))
+		.addComponent<collider_component>(collider_component::asAABB(bounding_box::fromCenterRadius(vec3(0.f, 0.f, 0.f), vec3(20.f, 4.f, 20.f)), groundMaterial));
+
+	locomotion.ragdoll = humanoid_ragdoll::create(scene, vec3(0.f, 1.25f, 0.f));
+
+	// The scene is built only once. Every episode restores this snapshot instead of recreating all entities.
+	initialSnapshot = createPhysicsSnapshot(scene, snapshotArena);
+}
+
+void training_environment::reset(float* outState)
+{
+	restorePhysicsSnapshot(scene, initialSnapshot);
+
+	totalReward = 0.f;
+	locomotion.reset(scene);
+	locomotion.getState(*(learned_locomotion::learning_state*)outState);
+}
+
+bool training_environment::step(const float* action, float* outState, float* outReward, bool parallelPhysics)
+{
+	stackArena.reset();
+
+	locomotion.applyAction(scene, *(const learned_locomotion::learning_action*)action);
+
+	if (rng.randomFloat01() < 0.02f)
+	{
+		uint32 bodyPartIndex = rng.randomUint32Between(0, learned_locomotion::NUM_BODY_PARTS - 1);
+
+		vec3 part = locomotion.ragdoll.bodyParts[bodyPartIndex].getComponent<transform_component>().position + vec3(0.f, 0.2f, 0.f);
+		vec3 direction = normalize(vec3(rng.randomFloatBetween(-1.f, 1.f), 0.f, rng.randomFloatBetween(-1.f, 1.f)));
+		vec3 origin = part - direction * 5.f;
+
+		testPhysicsInteraction(scene, ray{ origin, direction });
+	}
+
+	physics_settings physicsSettings;
+	physicsSettings.frameRate = 60;
+
+	// Batched environments are already distributed over the job system, so their physics steps run serially.
+	physicsSettings.parallelNarrowPhase = parallelPhysics;
 
-extern "C" __declspec(dllexport) int getPhysicsStateSize() { return sizeof(learned_locomotion::learning_state) / 4; }
-extern "C" __declspec(dllexport) int getPhysicsActionSize() { return sizeof(learned_locomotion::learning_action) / 4; }
+	const float physicsFixedTimeStep = 1.f / (float)physicsSettings.frameRate;
+	float physicsTimer = 0.f;
+	physicsStep(scene, stackArena, physicsTimer, physicsSettings, physicsFixedTimeStep);
+
+	bool failure = locomotion.getState(*(learned_locomotion::learning_state*)outState);
+	*outReward = 0.f;
+	if (!failure)
+	{
+		*outReward = locomotion.getReward();
+		totalReward += *outReward;
+	}
+	return failure;
+}
+
+
+static training_environment* trainingEnv = 0;
+static memory_arena snapshotArena;
+static uint32 numTrainingWorkers = 0;
+
+// The physics step submits jobs (parallel narrow phase, radix sorted SAP endpoints), so both the single and the batched entry points start the
+// workers. The engine's initializeJobSystem is not used here, since it would also pin the calling thread. The caller helps with the work, so
+// one core is left for it.
+static void initializeTrainingWorkers()
+{
+	if (!numTrainingWorkers)
+	{
+		numTrainingWorkers = max(std::thread::hardware_concurrency(), 2u) - 1;
+		highPriorityJobQueue.initialize(numTrainingWorkers, 1, thread_priority_normal, L"Training worker");
+	}
+}
 
-extern "C" __declspec(dllexport) void getPhysicsRanges(float* stateMin, float* stateMax, float* actionMin, float* actionMax)
+extern "C" PHYSICS_API int getPhysicsStateSize() { return sizeof(learned_locomotion::learning_state) / 4; }
+extern "C" PHYSICS_API int getPhysicsActionSize() { return sizeof(learned_locomotion::learning_action) / 4; }
+
+extern "C" PHYSICS_API void getPhysicsRanges(float* stateMin, float* stateMax, float* actionMin, float* actionMax)
 {
 	game_scene tmpScene;
 	humanoid_ragdoll tmpRagdoll;
@@ -426,64 +517,218 @@ extern "C" __declspec(dllexport) void getPhysicsRanges(float* stateMin, float* s
 	tmpScene.clearAll();
 }
 
-extern "C" __declspec(dllexport) void resetPhysics(float* outState)
+extern "C" PHYSICS_API void resetPhysics(float* outState)
 {
 	if (!trainingEnv)
 	{
-		trainingEnv = new training_locomotion;
-		stackArena.initialize();
+		initializeTrainingWorkers();
+		snapshotArena.initialize();
+
+		trainingEnv = new training_environment;
+		trainingEnv->initialize((uint64)time(0), snapshotArena);
 	}
 
-	totalReward = 0.f;
-	trainingScene.clearAll();
+	trainingEnv->reset(outState);
+}
 
-	physics_material groundMaterial = { physics_material_type_metal, 0.1f, 1.f, 4.f };
+extern "C" PHYSICS_API int updatePhysics(float* action, float* outState, float* outReward)
+{
+	return trainingEnv->step(action, outState, outReward, true);
+}
 
-	trainingScene.createEntity("Test ground")
-		.addComponent<transform_component>(vec3(0.f, -4.f, 0.f), quat(vec3(1.f, 0.f, 0.f), deg2rad(0.f)))
-		.addComponent<collider_component>(collider_component::asAABB(bounding_box::fromCenterRadius(vec3(0.f, 0.f, 0.f), vec3(20.f, 4.f, 20.f)), groundMaterial));
 
-	humanoid_ragdoll ragdoll = humanoid_ragdoll::create(trainingScene, vec3(0.f, 1.25f, 0.f));
 
-	trainingEnv->ragdoll = ragdoll;
-	trainingEnv->reset(trainingScene);
-}
+// --------------------------------
+// BATCHED TRAINING
+// --------------------------------
+
+// The batched entry points own numEnvironments independent environments and step them in parallel on the job system. States and actions
+// are contiguous [numEnvironments x stateSize] and [numEnvironments x actionSize] arrays, rewards and done flags are numEnvironments long.
 
-extern "C" __declspec(dllexport) int updatePhysics(float* action, float* outState, float* outReward)
+static training_environment* batchedEnvs = 0;
+static uint32 numBatchedEnvs = 0;
+static memory_arena batchedSnapshotArena;
+
+// Caller-owned buffers, which are registered once and then written in place by every step. This avoids all per-step allocations and
+// marshalling, and the buffers can be wrapped directly as numpy arrays. The layouts are the same as for updatePhysicsBatch. The buffers must
+// be 16-byte aligned and stay valid until they are replaced by another call or the environments are recreated.
+struct registered_physics_buffers
 {
-	stackArena.reset();
+	float* states;
+	const float* actions;
+	float* rewards;
+	int* dones;
 
-	trainingEnv->applyAction(trainingScene, *(learned_locomotion::learning_action*)action);
+	float* stateHistory; // Optional. [numEnvironments x historyLength x stateSize], oldest state first. Filled with the initial state on reset.
+	uint32 historyLength;
+};
 
-	if (rng.randomFloat01() < 0.02f)
+static registered_physics_buffers registeredBuffers;
+
+struct environment_batch_context
+{
+	const float* actions; // Null for resets.
+	const int* resetMask; // Resets only. If null, all environments are reset.
+
+	float* outStates;
+	float* outRewards;
+	int* outDones;
+
+	float* outStateHistory; // Optional. [numEnvironments x historyLength x stateSize], oldest state first.
+	uint32 historyLength;
+
+	std::atomic<uint32> nextEnvironment;
+};
+
+struct environment_batch_parent_job_data
+{
+	environment_batch_context* context;
+	uint32 numJobs;
+};
+
+static void processEnvironment(const environment_batch_context& context, uint32 index)
+{
+	const uint32 stateSize = (uint32)getPhysicsStateSize();
+	const uint32 actionSize = (uint32)getPhysicsActionSize();
+
+	training_environment& env = batchedEnvs[index];
+	float* outState = context.outStates + stateSize * index;
+
+	if (context.actions)
 	{
-		uint32 bodyPartIndex = rng.randomUint32Between(0, learned_locomotion::NUM_BODY_PARTS - 1);
+		context.outDones[index] = env.step(context.actions + actionSize * index, outState, context.outRewards + index, false);
 
-		vec3 part = trainingEnv->ragdoll.bodyParts[bodyPartIndex].getComponent<transform_component>().position + vec3(0.f, 0.2f, 0.f);
-		vec3 direction = normalize(vec3(rng.randomFloatBetween(-1.f, 1.f), 0.f, rng.randomFloatBetween(-1.f, 1.f)));
-		vec3 origin = part - direction * 5.f;
+		if (context.outStateHistory)
+		{
+			float* history = context.outStateHistory + (uint64)stateSize * context.historyLength * index;
+			memmove(history, history + stateSize, sizeof(float) * stateSize * (context.historyLength - 1));
+			memcpy(history + stateSize * (context.historyLength - 1), outState, sizeof(float) * stateSize);
+		}
+	}
+	else if (!context.resetMask || context.resetMask[index])
+	{
+		env.reset(outState);
 
-		testPhysicsInteraction(trainingScene, ray{ origin, direction });
+		if (context.outStateHistory)
+		{
+			float* history = context.outStateHistory + (uint64)stateSize * context.historyLength * index;
+			for (uint32 i = 0; i < context.historyLength; ++i)
+			{
+				memcpy(history + stateSize * i, outState, sizeof(float) * stateSize);
+			}
+		}
 	}
+}
 
-	physics_settings physicsSettings;
-	physicsSettings.frameRate = 60;
+static void processEnvironmentBatch(environment_batch_context& context)
+{
+	environment_batch_parent_job_data data = { &context, min(numTrainingWorkers + 1, numBatchedEnvs) };
 
-	const float physicsFixedTimeStep = 1.f / (float)physicsSettings.frameRate;
-	float physicsTimer = 0.f;
-	physicsStep(trainingScene, stackArena, physicsTimer, physicsSettings, physicsFixedTimeStep);
+	job_handle parentJob = highPriorityJobQueue.createJob<environment_batch_parent_job_data>([](environment_batch_parent_job_data& data, job_handle parent)
+	{
+		for (uint32 i = 0; i < data.numJobs; ++i)
+		{
+			highPriorityJobQueue.createJob<environment_batch_context*>([](environment_batch_context*& context, job_handle)
+			{
+				// Environments are handed out dynamically, since a falling ragdoll is much more expensive than a standing one.
+				uint32 index;
+				while ((index = context->nextEnvironment++) < numBatchedEnvs)
+				{
+					processEnvironment(*context, index);
+				}
+			}, data.context, parent).submitNow();
+		}
+	}, data);
 
-	bool failure = trainingEnv->getState(*(learned_locomotion::learning_state*)outState);
-	*outReward = 0.f;
-	if (!failure)
+	parentJob.submitNow();
+	parentJob.waitForCompletion();
+}
+
+extern "C" PHYSICS_API void createPhysicsEnvironments(int numEnvironments, int seed)
+{
+	ASSERT(numEnvironments > 0);
+
+	initializeTrainingWorkers();
+
+	if (!batchedEnvs)
 	{
-		*outReward = trainingEnv->getReward();
-		totalReward += *outReward;
+		batchedSnapshotArena.initialize();
 	}
-	else
+
+	delete[] batchedEnvs;
+	batchedSnapshotArena.reset();
+	registeredBuffers = {};
+
+	numBatchedEnvs = (uint32)numEnvironments;
+	batchedEnvs = new training_environment[numBatchedEnvs];
+
+	// Scene creation is not thread safe (e.g. bounding hulls are registered globally), so this runs serially.
+	for (uint32 i = 0; i < numBatchedEnvs; ++i)
 	{
-		//std::string out = "Rew: " + std::to_string(learningEnv->totalReward) + ",  EpLen: " + std::to_string(learningEnv->episodeLength) + '\n';
-		//std::cout << out;
+		batchedEnvs[i].initialize((uint64)seed * numBatchedEnvs + i + 1, batchedSnapshotArena);
 	}
-	return failure;
+}
+
+extern "C" PHYSICS_API int getNumPhysicsEnvironments() { return (int)numBatchedEnvs; }
+
+// Resets all environments, for which resetMask is non-zero. If resetMask is null, all environments are reset. Only the states of reset
+// environments are written.
+extern "C" PHYSICS_API void resetPhysicsBatch(const int* resetMask, float* outStates)
+{
+	environment_batch_context context = {};
+	context.resetMask = resetMask;
+	context.outStates = outStates;
+
+	processEnvironmentBatch(context);
+}
+
+// Steps all environments. Environments which are done are not reset automatically, use resetPhysicsBatch with outDones as the mask.
+extern "C" PHYSICS_API void updatePhysicsBatch(const float* actions, float* outStates, float* outRewards, int* outDones)
+{
+	environment_batch_context context = {};
+	context.actions = actions;
+	context.outStates = outStates;
+	context.outRewards = outRewards;
+	context.outDones = outDones;
+
+	processEnvironmentBatch(context);
+}
+
+extern "C" PHYSICS_API void registerPhysicsBuffers(float* states, const float* actions, float* rewards, int* dones, float* stateHistory, int historyLength)
+{
+	auto isAligned = [](const void* ptr) { return ((uint64)ptr & 15) == 0; };
+
+	ASSERT(isAligned(states) && isAligned(actions) && isAligned(rewards) && isAligned(dones));
+	ASSERT(!stateHistory || (isAligned(stateHistory) && historyLength > 0));
+
+	registeredBuffers = { states, actions, rewards, dones, stateHistory, stateHistory ? (uint32)historyLength : 0 };
+}
+
+// Resets the environments, whose done flag is set. If onlyDone is zero, all environments are reset.
+extern "C" PHYSICS_API void resetRegisteredPhysics(int onlyDone)
+{
+	ASSERT(registeredBuffers.states);
+
+	environment_batch_context context = {};
+	context.resetMask = onlyDone ? registeredBuffers.dones : 0;
+	context.outStates = registeredBuffers.states;
+	context.outStateHistory = registeredBuffers.stateHistory;
+	context.historyLength = registeredBuffers.historyLength;
+
+	processEnvironmentBatch(context);
+}
+
+extern "C" PHYSICS_API void updateRegisteredPhysics()
+{
+	ASSERT(registeredBuffers.states);
+
+	environment_batch_context context = {};
+	context.actions = registeredBuffers.actions;
+	context.outStates = registeredBuffers.states;
+	context.outRewards = registeredBuffers.rewards;
+	context.outDones = registeredBuffers.dones;
+	context.outStateHistory = registeredBuffers.stateHistory;
+	context.historyLength = registeredBuffers.historyLength;
+
+	processEnvironmentBatch(context);
 }
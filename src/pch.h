@@ -1,10 +1,17 @@
 #pragma once
 
+#if defined(_WIN32)
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <windowsx.h>
 #include <tchar.h>
+#else
+#include <alloca.h>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#endif
 
 #include <limits>
 #include <array>
@@ -17,8 +24,12 @@
 namespace fs = std::filesystem;
 
 #include <mutex>
+#include <atomic>
+#include <thread>
 
+#if defined(_WIN32)
 #include <wrl.h> 
+#endif
 
 typedef int8_t int8;
 typedef uint8_t uint8;
@@ -30,6 +41,13 @@ typedef int64_t int64;
 typedef uint64_t uint64;
 typedef wchar_t wchar;
 
+#if defined(_WIN32)
+#define PHYSICS_API __declspec(dllexport)
+#else
+#define PHYSICS_API __attribute__((visibility("default")))
+static inline void __debugbreak() { raise(SIGTRAP); }
+#endif
+
 #define ASSERT(cond) \
 	(void)((!!(cond)) || (std::cout << "Assertion '" << #cond "' failed [" __FILE__ " : " << __LINE__ << "].\n", ::__debugbreak(), 0))
 
@@ -48,8 +66,10 @@ template <typename T> struct is_ref<ref<T>> : std::true_type {};
 template <typename T> inline constexpr bool is_ref_v = is_ref<T>::value;
 
 
+#if defined(_WIN32)
 template <typename T>
 using com = Microsoft::WRL::ComPtr<T>;
+#endif
 
 #define arraysize(arr) (sizeof(arr) / sizeof((arr)[0]))
 
@@ -72,6 +92,7 @@ template <auto V> static constexpr auto force_consteval = V;
 #define unsetBit(mask, bit) (mask) ^= (1 << (bit))
 
 
+#if defined(_WIN32)
 static void checkResultInternal(HRESULT hr, char* file, int32 line)
 {
 	if (FAILED(hr))
@@ -92,6 +113,7 @@ static void checkResultInternal(HRESULT hr, char* file, int32 line)
 }
 
 #define checkResult(hr) checkResultInternal(hr, __FILE__, __LINE__)
+#endif
 
 
 
@@ -1424,7 +1424,7 @@ static bounding_hull_geometry hullFromMesh(vec3* vertices, uint32 numVertices, t
 		vec3 va = vertices[a];
 		vec3 vb = vertices[b];
 		vec3 vc = vertices[c];
-		vec3 normal = cross(vb - va, vc - va);
+		vec3 normal = normalize(cross(vb - va, vc - va));
 
 		hull.faces[i].a = a;
 		hull.faces[i].b = b;
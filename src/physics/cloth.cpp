@@ -1,8 +1,10 @@
 #include "pch.h"
 #include "cloth.h"
 #include "physics.h"
+#include "physics_snapshot.h"
 #include "core/random.h"
 #include "core/cpu_profiling.h"
+#include "terrain/heightmap_collider.h"
 
 cloth_component::cloth_component(float width, float height, uint32 gridSizeX, uint32 gridSizeY, float totalMass, float stiffness, float damping, float gravityFactor)
 	: gridSizeX(gridSizeX), gridSizeY(gridSizeY), width(width), height(height)
@@ -13,14 +15,18 @@ cloth_component::cloth_component(float width, float height, uint32 gridSizeX, ui
 	this->stiffness = stiffness;
 
 	uint32 numParticles = gridSizeX * gridSizeY;
+	uint32 numPaddedParticles = alignTo(numParticles + 1, CLOTH_SIMD_PADDING); // At least one padding particle.
 
 	float invMassPerParticle = numParticles / totalMass;
 
-	positions.reserve(numParticles);
-	prevPositions.reserve(numParticles);
-	invMasses.reserve(numParticles);
-	velocities.resize(numParticles, vec3(0.f));
-	forceAccumulators.resize(numParticles, vec3(0.f));
+	for (uint32 i = 0; i < 3; ++i)
+	{
+		positions[i].resize(numPaddedParticles, 0.f);
+		prevPositions[i].resize(numPaddedParticles, 0.f);
+		velocities[i].resize(numPaddedParticles, 0.f);
+		forceAccumulators[i].resize(numPaddedParticles, 0.f);
+	}
+	invMasses.resize(numPaddedParticles, 0.f);
 
 	random_number_generator rng = { 1578123 };
 
@@ -33,13 +39,19 @@ cloth_component::cloth_component(float width, float height, uint32 gridSizeX, ui
 			float relX = x / (float)(gridSizeX - 1);
 			float relY = y / (float)(gridSizeY - 1);
 			
+			uint32 index = y * gridSizeX + x;
 			vec3 position = getParticlePosition(relX, relY);
-			positions.push_back(position);
-			prevPositions.push_back(position);
-			invMasses.push_back(invMass);
+			setParticlePosition(index, position);
+			for (uint32 i = 0; i < 3; ++i)
+			{
+				prevPositions[i][index] = position.data[i];
+			}
+			invMasses[index] = invMass;
 		}
 	}
 
+	std::vector<std::pair<uint32, uint32>> pairs;
+
 	for (uint32 y = 0; y < gridSizeY; ++y)
 	{
 		for (uint32 x = 0; x < gridSizeX; ++x)
@@ -49,36 +61,99 @@ cloth_component::cloth_component(float width, float height, uint32 gridSizeX, ui
 			// Stretch constraints: direct right and bottom neighbor.
 			if (x < gridSizeX - 1)
 			{
-				addConstraint(index, index + 1);
+				pairs.push_back({ index, index + 1 });
 			}
 			if (y < gridSizeY - 1)
 			{
-				addConstraint(index, index + gridSizeX);
+				pairs.push_back({ index, index + gridSizeX });
 			}
 
 			// Shear constraints: direct diagonal neighbor.
 			if (x < gridSizeX - 1 && y < gridSizeY - 1)
 			{
-				addConstraint(index, index + gridSizeX + 1);
-				addConstraint(index + gridSizeX, index + 1);
+				pairs.push_back({ index, index + gridSizeX + 1 });
+				pairs.push_back({ index + gridSizeX, index + 1 });
 			}
 
 			// Bend constraints: neighbor right and bottom two places away.
 			if (x < gridSizeX - 2)
 			{
-				addConstraint(index, index + 2);
+				pairs.push_back({ index, index + 2 });
 			}
 			if (y < gridSizeY - 2)
 			{
-				addConstraint(index, index + gridSizeX * 2);
+				pairs.push_back({ index, index + gridSizeX * 2 });
 			}
 		}
 	}
 
+	buildConstraints(pairs);
+
 	oldTotalMass = totalMass;
 	oldStiffness = stiffness;
 }
 
+void cloth_component::buildConstraints(const std::vector<std::pair<uint32, uint32>>& pairs)
+{
+	uint32 numParticles = getNumParticles();
+	uint32 numConstraints = (uint32)pairs.size();
+
+	// Greedy coloring: Each constraint gets the lowest color, which is not yet used by any constraint at one of its particles.
+	// On the regular grid, this ends up with around a dozen colors.
+	std::vector<uint32> usedColors(numParticles, 0);
+	std::vector<uint8> constraintColors(numConstraints);
+
+	uint32 numPerColor[32] = {};
+	uint32 numColors = 0;
+
+	for (uint32 i = 0; i < numConstraints; ++i)
+	{
+		auto [a, b] = pairs[i];
+
+		uint32 freeColors = ~(usedColors[a] | usedColors[b]);
+		ASSERT(freeColors != 0);
+
+		uint32 color = indexOfLeastSignificantSetBit(freeColors);
+		usedColors[a] |= (1 << color);
+		usedColors[b] |= (1 << color);
+
+		constraintColors[i] = (uint8)color;
+		++numPerColor[color];
+		numColors = max(numColors, color + 1);
+	}
+
+	colorOffsets.resize(numColors + 1);
+	colorOffsets[0] = 0;
+	for (uint32 color = 0; color < numColors; ++color)
+	{
+		colorOffsets[color + 1] = colorOffsets[color] + alignTo(numPerColor[color], CLOTH_SIMD_PADDING);
+	}
+
+	uint32 numPaddedConstraints = colorOffsets[numColors];
+
+	// Padding constraints connect the first padding particle to itself. Since its inverse mass is zero, they have no effect.
+	int32 paddingParticle = (int32)numParticles;
+	constraintA.assign(numPaddedConstraints, paddingParticle);
+	constraintB.assign(numPaddedConstraints, paddingParticle);
+	restDistances.assign(numPaddedConstraints, 0.f);
+	inverseMassSums.assign(numPaddedConstraints, 0.f);
+
+	uint32 writeOffsets[32];
+	memcpy(writeOffsets, colorOffsets.data(), sizeof(uint32) * numColors);
+
+	float invStiffness = 1.f / stiffness;
+	for (uint32 i = 0; i < numConstraints; ++i)
+	{
+		auto [a, b] = pairs[i];
+		uint32 writeIndex = writeOffsets[constraintColors[i]]++;
+
+		constraintA[writeIndex] = (int32)a;
+		constraintB[writeIndex] = (int32)b;
+		restDistances[writeIndex] = length(getParticlePosition(b) - getParticlePosition(a));
+		inverseMassSums[writeIndex] = (invMasses[a] + invMasses[b]) * invStiffness;
+	}
+}
+
 void cloth_component::setWorldPositionOfFixedVertices(const trs& transform, bool moveRigid)
 {
 	if (moveRigid)
@@ -86,14 +161,14 @@ void cloth_component::setWorldPositionOfFixedVertices(const trs& transform, bool
 		vec3 pivot;
 		if (gridSizeX % 2 == 1)
 		{
-			pivot = positions[gridSizeX / 2];
+			pivot = getParticlePosition(gridSizeX / 2);
 		}
 		else
 		{
-			pivot = (positions[gridSizeX / 2] + positions[gridSizeX / 2 - 1]) * 0.5f;
+			pivot = (getParticlePosition(gridSizeX / 2) + getParticlePosition(gridSizeX / 2 - 1)) * 0.5f;
 		}
 
-		vec3 currentAxis = normalize(positions[gridSizeX - 1] - positions[0]);
+		vec3 currentAxis = normalize(getParticlePosition(gridSizeX - 1) - getParticlePosition(0u));
 		vec3 newAxis = normalize(transformPosition(transform, getParticlePosition(1.f, 0.f)) - transformPosition(transform, getParticlePosition(0.f, 0.f)));
 
 		vec3 newPivot = transformPosition(transform, getParticlePosition(0.5f, 0.f));
@@ -105,8 +180,8 @@ void cloth_component::setWorldPositionOfFixedVertices(const trs& transform, bool
 		{
 			for (uint32 x = 0; x < gridSizeX; ++x)
 			{
-				vec3& position = positions[y * gridSizeX + x];
-				position = deltaRotation * (position - pivot) + newPivot;
+				uint32 index = y * gridSizeX + x;
+				setParticlePosition(index, deltaRotation * (getParticlePosition(index) - pivot) + newPivot);
 			}
 		}
 	}
@@ -117,7 +192,7 @@ void cloth_component::setWorldPositionOfFixedVertices(const trs& transform, bool
 		float relX = x / (float)(gridSizeX - 1);
 		float relY = 0.f;
 		vec3 localPosition = getParticlePosition(relX, relY);
-		positions[x] = transformPosition(transform, localPosition);
+		setParticlePosition(x, transformPosition(transform, localPosition));
 	}
 }
 
@@ -129,6 +204,13 @@ vec3 cloth_component::getParticlePosition(float relX, float relY)
 	return position;
 }
 
+void cloth_component::setParticlePosition(uint32 index, vec3 position)
+{
+	positions[0][index] = position.x;
+	positions[1][index] = position.y;
+	positions[2][index] = position.z;
+}
+
 static vec3 calculateNormal(vec3 a, vec3 b, vec3 c)
 {
 	return cross(b - a, c - a);
@@ -136,6 +218,17 @@ static vec3 calculateNormal(vec3 a, vec3 b, vec3 c)
 
 void cloth_component::applyWindForce(vec3 force)
 {
+	float* forceX = forceAccumulators[0].data();
+	float* forceY = forceAccumulators[1].data();
+	float* forceZ = forceAccumulators[2].data();
+
+	auto addForce = [=](uint32 index, vec3 f)
+	{
+		forceX[index] += f.x;
+		forceY[index] += f.y;
+		forceZ[index] += f.z;
+	};
+
 	for (uint32 y = 0; y < gridSizeY - 1; ++y)
 	{
 		for (uint32 x = 0; x < gridSizeX - 1; ++x)
@@ -145,203 +238,174 @@ void cloth_component::applyWindForce(vec3 force)
 			uint32 blIndex = tlIndex + gridSizeX;
 			uint32 brIndex = blIndex + 1;
 
-			vec3& tlForce = forceAccumulators[tlIndex];
-			vec3& trForce = forceAccumulators[trIndex];
-			vec3& blForce = forceAccumulators[blIndex];
-			vec3& brForce = forceAccumulators[brIndex];
+			vec3 tlPosition = getParticlePosition(tlIndex);
+			vec3 trPosition = getParticlePosition(trIndex);
+			vec3 blPosition = getParticlePosition(blIndex);
+			vec3 brPosition = getParticlePosition(brIndex);
 
 			{
-				vec3 normal = calculateNormal(positions[tlIndex], positions[blIndex], positions[trIndex]);
+				vec3 normal = calculateNormal(tlPosition, blPosition, trPosition);
 				vec3 forceInNormalDir = normal * dot(normalize(normal), force);
 				forceInNormalDir *= 1.f / 3.f;
-				tlForce += forceInNormalDir;
-				trForce += forceInNormalDir;
-				blForce += forceInNormalDir;
+				addForce(tlIndex, forceInNormalDir);
+				addForce(trIndex, forceInNormalDir);
+				addForce(blIndex, forceInNormalDir);
 			}
 
 			{
-				vec3 normal = calculateNormal(positions[brIndex], positions[trIndex], positions[blIndex]);
+				vec3 normal = calculateNormal(brPosition, trPosition, blPosition);
 				vec3 forceInNormalDir = normal * dot(normalize(normal), force);
 				forceInNormalDir *= 1.f / 3.f;
-				brForce += forceInNormalDir;
-				trForce += forceInNormalDir;
-				blForce += forceInNormalDir;
+				addForce(brIndex, forceInNormalDir);
+				addForce(trIndex, forceInNormalDir);
+				addForce(blIndex, forceInNormalDir);
 			}
 		}
 	}
 }
 
-struct cloth_constraint_temp
-{
-	vec3 gradient;
-	float inverseScaledGradientSquared;
-};
-
-void cloth_component::simulate(uint32 velocityIterations, uint32 positionIterations, uint32 driftIterations, float dt)
+bounding_box cloth_component::getSweptBoundingBox(float dt) const
 {
-	CPU_PROFILE_BLOCK("Simulate cloth");
+	bounding_box result = bounding_box::negativeInfinity();
 
-	if (totalMass != oldTotalMass || stiffness != oldStiffness)
+	uint32 numParticles = getNumParticles();
+	for (uint32 i = 0; i < numParticles; ++i)
 	{
-		recalculateProperties();
+		vec3 position = getParticlePosition(i);
+		vec3 velocity(velocities[0][i], velocities[1][i], velocities[2][i]);
 
-		oldTotalMass = totalMass;
-		oldStiffness = stiffness;
+		result.grow(position);
+		result.grow(position + velocity * dt);
 	}
 
+	// Gravity adds at most this much during the step.
+	float gravityDisplacement = abs(GRAVITY * gravityFactor) * dt * dt;
+	result.pad(vec3(CLOTH_COLLISION_RADIUS + gravityDisplacement));
+	return result;
+}
 
-	float gravityVelocity = GRAVITY * dt * gravityFactor;
-	uint32 numParticles = gridSizeX * gridSizeY;
+// Samples the heightmaps below the particles' predicted positions. Returns null, if the cloth is not above any heightmap.
+static float* sampleGroundHeights(const cloth_collision_input& collision, const float* const* positions,
+	const float* const* velocities, uint32 numParticles, uint32 numPaddedParticles, float dt, memory_arena& arena)
+{
+	float* result = 0;
 
-	for (uint32 i = 0; i < numParticles; ++i)
+	for (uint32 h = 0; h < collision.numHeightmaps; ++h)
 	{
-		vec3& position = positions[i];
-		vec3& prevPosition = prevPositions[i];
-		float invMass = invMasses[i];
-		vec3& velocity = velocities[i];
-		vec3& force = forceAccumulators[i];
-
-		if (invMass > 0.f)
+		const heightmap_collider_component& heightmap = *collision.heightmaps[h];
+		if (!aabbVsAABB(heightmap.getBoundingBox(), collision.bounds))
 		{
-			velocity.y += gravityVelocity;
+			continue;
 		}
 
-		velocity += force * (invMass * dt);
-
-		prevPosition = position;
-		position += velocity * dt;
-		force = vec3(0.f);
-	}
-
-	float invDt = (dt > 1e-5f) ? (1.f / dt) : 1.f;
-	
-	// Solve velocities.
-	if (velocityIterations > 0)
-	{
-		std::vector<cloth_constraint_temp> constraintsTemp;
-		constraintsTemp.reserve(constraints.size());
+		if (!result)
+		{
+			result = arena.allocate<float>(numPaddedParticles);
+			for (uint32 i = 0; i < numPaddedParticles; ++i)
+			{
+				result[i] = -FLT_MAX;
+			}
+		}
 
-		for (cloth_constraint& c : constraints)
+		for (uint32 i = 0; i < numParticles; ++i)
 		{
-			vec3 prevPositionA = prevPositions[c.a];
-			vec3 prevPositionB = prevPositions[c.b];
+			vec2 predicted(positions[0][i] + velocities[0][i] * dt, positions[2][i] + velocities[2][i] * dt);
 
-			cloth_constraint_temp temp;
-			temp.gradient = prevPositionB - prevPositionA;
-			temp.inverseScaledGradientSquared = (c.inverseMassSum == 0.f) ? 0.f : (1.f / (squaredLength(temp.gradient) * c.inverseMassSum));
-			constraintsTemp.push_back(temp);
+			// Returns -FLT_MAX outside of the heightmap, so overlapping heightmaps can simply be combined.
+			float height = heightmap.getHeightAt(predicted);
+			result[i] = max(result[i], height + CLOTH_COLLISION_RADIUS);
 		}
+	}
 
+	return result;
+}
 
-		for (uint32 it = 0; it < velocityIterations; ++it)
-		{
-			solveVelocities(constraintsTemp);
-		}
+void cloth_component::simulate(uint32 velocityIterations, uint32 positionIterations, uint32 driftIterations, float dt, memory_arena& arena,
+	const cloth_collision_input* collision)
+{
+	CPU_PROFILE_BLOCK("Simulate cloth");
 
-		for (uint32 i = 0; i < numParticles; ++i)
-		{
-			positions[i] = prevPositions[i] + velocities[i] * dt;
-		}
+	if (invMasses.empty())
+	{
+		return;
 	}
 
-	// Solve positions.
-	if (positionIterations > 0)
+	if (totalMass != oldTotalMass || stiffness != oldStiffness)
 	{
-		for (uint32 it = 0; it < positionIterations; ++it)
-		{
-			solvePositions();
-		}
+		recalculateProperties();
 
-		for (uint32 i = 0; i < numParticles; ++i)
-		{
-			velocities[i] = (positions[i] - prevPositions[i]) * invDt;
-		}
+		oldTotalMass = totalMass;
+		oldStiffness = stiffness;
 	}
 
-	// Solve drift.
-	if (driftIterations > 0)
-	{
-		for (uint32 i = 0; i < numParticles; ++i)
-		{
-			prevPositions[i] = positions[i];
-		}
+	uint32 numConstraints = (uint32)constraintA.size();
 
-		for (uint32 it = 0; it < driftIterations; ++it)
-		{
-			solvePositions();
-		}
+	cloth_solver_data data;
+	for (uint32 i = 0; i < 3; ++i)
+	{
+		data.positions[i] = positions[i].data();
+		data.prevPositions[i] = prevPositions[i].data();
+		data.velocities[i] = velocities[i].data();
+		data.forceAccumulators[i] = forceAccumulators[i].data();
+		data.gradients[i] = (velocityIterations > 0) ? arena.allocate<float>(numConstraints) : 0;
+	}
+	data.invMasses = invMasses.data();
+	data.numParticles = (uint32)invMasses.size();
+	data.constraintA = constraintA.data();
+	data.constraintB = constraintB.data();
+	data.restDistances = restDistances.data();
+	data.inverseMassSums = inverseMassSums.data();
+	data.colorOffsets = colorOffsets.data();
+	data.numColors = (uint32)colorOffsets.size() - 1;
+	data.inverseScaledGradientsSquared = (velocityIterations > 0) ? arena.allocate<float>(numConstraints) : 0;
+
+	data.colliders = 0;
+	data.numColliders = 0;
+	data.groundHeights = 0;
+	if (collision)
+	{
+		data.colliders = collision->colliders;
+		data.numColliders = collision->numColliders;
 
-		for (uint32 i = 0; i < numParticles; ++i)
+		if (collision->numHeightmaps > 0)
 		{
-			velocities[i] += (positions[i] - prevPositions[i]) * invDt;
+			data.groundHeights = sampleGroundHeights(*collision, data.positions, data.velocities,
+				getNumParticles(), data.numParticles, dt, arena);
 		}
 	}
 
-	// Damping.
+	float gravityVelocity = GRAVITY * dt * gravityFactor;
 	float dampingFactor = 1.f / (1.f + dt * damping);
-	for (uint32 i = 0; i < numParticles; ++i)
-	{
-		velocities[i] *= dampingFactor;
-	}
-}
 
-void cloth_component::solveVelocities(const std::vector<cloth_constraint_temp>& constraintsTemp)
-{
-	for (uint32 i = 0; i < (uint32)constraints.size(); ++i)
-	{
-		cloth_constraint& c = constraints[i];
-		const cloth_constraint_temp& temp = constraintsTemp[i];
-		float j = -dot(temp.gradient, velocities[c.a] - velocities[c.b]) * temp.inverseScaledGradientSquared;
-		velocities[c.a] += temp.gradient * (j * invMasses[c.a]);
-		velocities[c.b] -= temp.gradient * (j * invMasses[c.b]);
-	}
+	SIMD_DISPATCH(simulateClothSIMD)(data, velocityIterations, positionIterations, driftIterations, gravityVelocity, dampingFactor, dt);
 }
 
-void cloth_component::solvePositions()
+void cloth_component::serializeState(physics_snapshot_stream& stream)
 {
-	for (cloth_constraint& c : constraints)
+	for (uint32 i = 0; i < 3; ++i)
 	{
-		if (c.inverseMassSum > 0.f)
-		{
-			vec3 delta = positions[c.b] - positions[c.a];
-			float len = squaredLength(delta);
-
-			float sqRestDistance = c.restDistance * c.restDistance;
-			if (sqRestDistance + len > 1e-5f)
-			{
-				float k = ((sqRestDistance - len) / (c.inverseMassSum * (sqRestDistance + len)));
-				positions[c.a] -= delta * (k * invMasses[c.a]);
-				positions[c.b] += delta * (k * invMasses[c.b]);
-			}
-		}
+		stream.vector(positions[i]);
+		stream.vector(prevPositions[i]);
+		stream.vector(velocities[i]);
+		stream.vector(forceAccumulators[i]);
 	}
 }
 
-void cloth_component::addConstraint(uint32 indexA, uint32 indexB)
-{
-	constraints.push_back(cloth_constraint
-		{ 
-			indexA, 
-			indexB, 
-			length(positions[indexA] - positions[indexB]),
-			(invMasses[indexA] + invMasses[indexB]) / stiffness,
-		});
-}
-
 void cloth_component::recalculateProperties()
 {
 	uint32 numParticles = gridSizeX * gridSizeY;
 	float invMassPerParticle = numParticles / totalMass;
-	for (float& invMass : invMasses)
+	for (uint32 i = 0; i < numParticles; ++i)
 	{
-		invMass = (invMass != 0.f) ? invMassPerParticle : 0.f;
+		invMasses[i] = (invMasses[i] != 0.f) ? invMassPerParticle : 0.f;
 	}
 
 	stiffness = clamp(stiffness, 0.01f, 1.f);
 	float invStiffness = 1.f / stiffness;
-	for (cloth_constraint& c : constraints)
+	for (uint32 i = 0; i < (uint32)constraintA.size(); ++i)
 	{
-		c.inverseMassSum = (invMasses[c.a] + invMasses[c.b]) * invStiffness;
+		// Padding constraints stay at zero, since the padding particles have zero inverse mass.
+		inverseMassSums[i] = (invMasses[constraintA[i]] + invMasses[constraintB[i]]) * invStiffness;
 	}
 }
 
@@ -360,7 +424,11 @@ std::tuple<dx_vertex_buffer_group_view, dx_vertex_buffer_group_view, dx_index_bu
 	uint32 numTriangles = (cloth.gridSizeX - 1) * (cloth.gridSizeY - 1) * 2;
 
 	auto [positionVertexBuffer, positionPtr] = dxContext.createDynamicVertexBuffer(sizeof(vec3), numVertices);
-	memcpy(positionPtr, cloth.positions.data(), numVertices * sizeof(vec3));
+	vec3* positions = (vec3*)positionPtr;
+	for (uint32 i = 0; i < numVertices; ++i)
+	{
+		positions[i] = cloth.getParticlePosition(i);
+	}
 
 	dx_vertex_buffer_group_view vb = skinCloth(positionVertexBuffer, cloth.gridSizeX, cloth.gridSizeY);
 	submesh_info sm;
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "bounding_volumes.h"
+#include "core/memory.h"
+#include "core/simd_dispatch.h"
+
+struct cloth_collision_input;
 
 struct cloth_component
 {
@@ -15,7 +19,20 @@ struct cloth_component
 
 	void setWorldPositionOfFixedVertices(const trs& transform, bool moveRigid = false);
 	void applyWindForce(vec3 force);
-	void simulate(uint32 velocityIterations, uint32 positionIterations, uint32 driftIterations, float dt);
+
+	// The arena is used for scratch memory only. Different cloths can be simulated in parallel.
+	// If collision is set, the particles are pushed out of its colliders and heightmaps after each position iteration.
+	void simulate(uint32 velocityIterations, uint32 positionIterations, uint32 driftIterations, float dt, memory_arena& arena,
+		const cloth_collision_input* collision = 0);
+
+	// Bounds of the particles over the next step, assuming they keep their velocity. Padded by the collision radius.
+	bounding_box getSweptBoundingBox(float dt) const;
+
+	// Particle state only. See physics_snapshot.h.
+	void serializeState(struct physics_snapshot_stream& stream);
+
+	uint32 getNumParticles() const { return gridSizeX * gridSizeY; }
+	vec3 getParticlePosition(uint32 index) const { return vec3(positions[0][index], positions[1][index], positions[2][index]); }
 
 	float totalMass;
 	float gravityFactor;
@@ -31,31 +48,110 @@ private:
 
 	void recalculateProperties();
 
-	struct cloth_constraint
-	{
-		uint32 a, b;
-		float restDistance;
-		float inverseMassSum;
-	};
-
-	std::vector<vec3> positions;
-	std::vector<vec3> prevPositions;
-	std::vector<vec3> velocities;
-	std::vector<vec3> forceAccumulators;
+	// Particles are stored as structure of arrays, padded to a multiple of CLOTH_SIMD_PADDING. The padding particles have zero inverse mass.
+	// The first one is the target of the padding constraints.
+	std::vector<float> positions[3];
+	std::vector<float> prevPositions[3];
+	std::vector<float> velocities[3];
+	std::vector<float> forceAccumulators[3];
 	std::vector<float> invMasses;
-	std::vector<cloth_constraint> constraints;
 
-	void solveVelocities(const std::vector<struct cloth_constraint_temp>& constraintsTemp);
-	void solvePositions();
+	// Constraints are sorted by color. No two constraints of the same color share a particle, so each color can be solved in parallel.
+	// Each color is padded to a multiple of CLOTH_SIMD_PADDING.
+	std::vector<int32> constraintA;
+	std::vector<int32> constraintB;
+	std::vector<float> restDistances;
+	std::vector<float> inverseMassSums;
+	std::vector<uint32> colorOffsets; // Number of colors + 1 entries.
 
 	vec3 getParticlePosition(float relX, float relY);
+	void setParticlePosition(uint32 index, vec3 position);
 
-	void addConstraint(uint32 a, uint32 b);
+	void buildConstraints(const std::vector<std::pair<uint32, uint32>>& pairs);
 
 	friend struct cloth_render_component;
 };
 
 
+// Internal.
+
+// Widest SIMD width (see core/simd_dispatch.h). Particle and constraint arrays are padded to this, so that every kernel can run on full registers.
+#define CLOTH_SIMD_PADDING 16
+
+// Particles are treated as spheres of this radius when colliding. This keeps the cloth surface from visibly clipping into colliders.
+#define CLOTH_COLLISION_RADIUS 0.05f
+
+enum cloth_collider_type
+{
+	cloth_collider_type_sphere,
+	cloth_collider_type_capsule,
+	cloth_collider_type_planes, // Convex, as the intersection of the planes' negative half spaces. Used for boxes and hulls.
+};
+
+struct cloth_collider_planes
+{
+	const vec4* planes; // xyz is the normal. A point p is outside of a plane, if dot(normal, p) > w.
+	uint32 numPlanes;
+};
+
+// World space collision shape, already inflated by the collision radius, so that the kernel can treat the particles as points.
+struct cloth_collider
+{
+	cloth_collider() {}
+
+	union
+	{
+		bounding_sphere sphere;
+		bounding_capsule capsule;
+		cloth_collider_planes planes;
+	};
+
+	cloth_collider_type type;
+};
+
+// Collision input of one cloth for one step. The colliders are the ones overlapping the cloth's swept bounds (see broadphaseQuery).
+struct cloth_collision_input
+{
+	bounding_box bounds; // See cloth_component::getSweptBoundingBox.
+
+	const cloth_collider* colliders;
+	uint32 numColliders;
+
+	const struct heightmap_collider_component* const* heightmaps;
+	uint32 numHeightmaps;
+};
+
+struct cloth_solver_data
+{
+	float* positions[3];
+	float* prevPositions[3];
+	float* velocities[3];
+	float* forceAccumulators[3];
+	const float* invMasses;
+	uint32 numParticles; // Padded.
+
+	int32* constraintA;
+	int32* constraintB;
+	const float* restDistances;
+	const float* inverseMassSums;
+	const uint32* colorOffsets;
+	uint32 numColors;
+
+	// Scratch, one entry per constraint.
+	float* gradients[3];
+	float* inverseScaledGradientsSquared;
+
+	const cloth_collider* colliders;
+	uint32 numColliders;
+	const float* groundHeights; // One entry per particle, already raised by the collision radius. Null if the cloth is not above a heightmap.
+};
+
+SIMD_KERNEL_DECLARATIONS(
+	void simulateClothSIMD(const cloth_solver_data& data, uint32 velocityIterations, uint32 positionIterations, uint32 driftIterations,
+		float gravityVelocity, float dampingFactor, float dt);
+)
+
+
 #ifndef PHYSICS_ONLY
 
 #include "geometry/mesh_builder.h"
@@ -0,0 +1,326 @@
+#include "pch.h"
+#include "cloth.h"
+#include "core/cpu_profiling.h"
+#include "core/math_simd.h"
+
+// Cloth solver SIMD kernels. Compiled once per SIMD level, see core/simd_dispatch.h.
+
+namespace SIMD_ISA
+{
+
+#if defined(SIMD_AVX_512)
+#define CLOTH_SIMD_WIDTH 16
+typedef w16_float w_float;
+typedef w16_int w_int;
+#elif defined(SIMD_AVX_2)
+#define CLOTH_SIMD_WIDTH 8
+typedef w8_float w_float;
+typedef w8_int w_int;
+#else
+#define CLOTH_SIMD_WIDTH 4
+typedef w4_float w_float;
+typedef w4_int w_int;
+#endif
+
+static_assert(CLOTH_SIMD_PADDING % CLOTH_SIMD_WIDTH == 0);
+
+typedef wN_vec3<w_float> w_vec3;
+
+static w_vec3 load(float* const* arrays, uint32 offset)
+{
+	return w_vec3(w_float(arrays[0] + offset), w_float(arrays[1] + offset), w_float(arrays[2] + offset));
+}
+
+static void store(float* const* arrays, uint32 offset, w_vec3 v)
+{
+	v.store(arrays[0] + offset, arrays[1] + offset, arrays[2] + offset);
+}
+
+static w_vec3 gather(float* const* arrays, w_int indices)
+{
+	return w_vec3(w_float(arrays[0], indices), w_float(arrays[1], indices), w_float(arrays[2], indices));
+}
+
+static void scatter(float* const* arrays, w_int indices, w_vec3 v)
+{
+	v.x.scatter(arrays[0], indices);
+	v.y.scatter(arrays[1], indices);
+	v.z.scatter(arrays[2], indices);
+}
+
+static void integrate(const cloth_solver_data& data, float gravityVelocity, float dt)
+{
+	w_float zero = w_float::zero();
+	w_float gravity = gravityVelocity;
+	w_float wideDt = dt;
+
+	for (uint32 i = 0; i < data.numParticles; i += CLOTH_SIMD_WIDTH)
+	{
+		w_vec3 position = load(data.positions, i);
+		w_vec3 velocity = load(data.velocities, i);
+		w_vec3 force = load(data.forceAccumulators, i);
+		w_float invMass = data.invMasses + i;
+
+		velocity.y += ifThen(invMass > zero, gravity, zero);
+		velocity += force * (invMass * wideDt);
+
+		store(data.prevPositions, i, position);
+		store(data.positions, i, position + velocity * wideDt);
+		store(data.velocities, i, velocity);
+		store(data.forceAccumulators, i, w_vec3::zero());
+	}
+}
+
+static void prepareVelocityConstraints(const cloth_solver_data& data)
+{
+	w_float zero = w_float::zero();
+	w_float one = 1.f;
+
+	uint32 numConstraints = data.colorOffsets[data.numColors];
+	for (uint32 i = 0; i < numConstraints; i += CLOTH_SIMD_WIDTH)
+	{
+		w_int a = data.constraintA + i;
+		w_int b = data.constraintB + i;
+		w_float inverseMassSum = data.inverseMassSums + i;
+
+		w_vec3 gradient = gather(data.prevPositions, b) - gather(data.prevPositions, a);
+		w_float inverseScaledGradientSquared = ifThen(inverseMassSum == zero, zero, one / (squaredLength(gradient) * inverseMassSum));
+
+		store(data.gradients, i, gradient);
+		inverseScaledGradientSquared.store(data.inverseScaledGradientsSquared + i);
+	}
+}
+
+// Constraints of one color don't share particles, so all lanes can be gathered and scattered without conflicts. The padding constraints all
+// write the unchanged padding particle.
+static void solveVelocities(const cloth_solver_data& data)
+{
+	for (uint32 color = 0; color < data.numColors; ++color)
+	{
+		for (uint32 i = data.colorOffsets[color]; i < data.colorOffsets[color + 1]; i += CLOTH_SIMD_WIDTH)
+		{
+			w_int a = data.constraintA + i;
+			w_int b = data.constraintB + i;
+
+			w_vec3 gradient = load(data.gradients, i);
+			w_float inverseScaledGradientSquared = data.inverseScaledGradientsSquared + i;
+
+			w_vec3 velocityA = gather(data.velocities, a);
+			w_vec3 velocityB = gather(data.velocities, b);
+			w_float invMassA(data.invMasses, a);
+			w_float invMassB(data.invMasses, b);
+
+			w_float j = -dot(gradient, velocityA - velocityB) * inverseScaledGradientSquared;
+			velocityA += gradient * (j * invMassA);
+			velocityB -= gradient * (j * invMassB);
+
+			scatter(data.velocities, a, velocityA);
+			scatter(data.velocities, b, velocityB);
+		}
+	}
+}
+
+static void solvePositions(const cloth_solver_data& data)
+{
+	w_float zero = w_float::zero();
+	w_float epsilon = 1e-5f;
+
+	for (uint32 color = 0; color < data.numColors; ++color)
+	{
+		for (uint32 i = data.colorOffsets[color]; i < data.colorOffsets[color + 1]; i += CLOTH_SIMD_WIDTH)
+		{
+			w_int a = data.constraintA + i;
+			w_int b = data.constraintB + i;
+
+			w_float restDistance = data.restDistances + i;
+			w_float inverseMassSum = data.inverseMassSums + i;
+
+			w_vec3 positionA = gather(data.positions, a);
+			w_vec3 positionB = gather(data.positions, b);
+			w_float invMassA(data.invMasses, a);
+			w_float invMassB(data.invMasses, b);
+
+			w_vec3 delta = positionB - positionA;
+			w_float len = squaredLength(delta);
+
+			w_float sqRestDistance = restDistance * restDistance;
+			w_float sum = sqRestDistance + len;
+
+			auto valid = (inverseMassSum > zero) & (sum > epsilon);
+			w_float k = ifThen(valid, (sqRestDistance - len) / (inverseMassSum * sum), zero);
+
+			positionA -= delta * (k * invMassA);
+			positionB += delta * (k * invMassB);
+
+			scatter(data.positions, a, positionA);
+			scatter(data.positions, b, positionB);
+		}
+	}
+}
+
+// Pushes the particles out of the colliders and above the ground. The colliders are already inflated by the collision radius, so each particle
+// is tested as a point. Particles are processed in contiguous batches, with the colliders broadcast to all lanes.
+static void projectCollisions(const cloth_solver_data& data)
+{
+	w_float zero = w_float::zero();
+	w_float epsilon = 1e-6f;
+
+	for (uint32 i = 0; i < data.numParticles; i += CLOTH_SIMD_WIDTH)
+	{
+		w_vec3 original = load(data.positions, i);
+		w_vec3 position = original;
+
+		for (uint32 c = 0; c < data.numColliders; ++c)
+		{
+			const cloth_collider& collider = data.colliders[c];
+
+			if (collider.type == cloth_collider_type_planes)
+			{
+				const cloth_collider_planes& planes = collider.planes;
+
+				w_float maxDistance = -FLT_MAX;
+				w_vec3 bestNormal = w_vec3::zero();
+
+				for (uint32 p = 0; p < planes.numPlanes; ++p)
+				{
+					vec4 plane = planes.planes[p];
+					w_vec3 normal(plane.x, plane.y, plane.z);
+
+					w_float distance = dot(normal, position) - w_float(plane.w);
+					auto closer = distance > maxDistance;
+					maxDistance = ifThen(closer, distance, maxDistance);
+					bestNormal = ifThen(closer, normal, bestNormal);
+				}
+
+				// Inside all planes: leave through the nearest one.
+				position = ifThen(maxDistance < zero, position - bestNormal * maxDistance, position);
+			}
+			else
+			{
+				w_vec3 center;
+				w_float radius;
+
+				if (collider.type == cloth_collider_type_sphere)
+				{
+					center = w_vec3(collider.sphere.center.x, collider.sphere.center.y, collider.sphere.center.z);
+					radius = collider.sphere.radius;
+				}
+				else
+				{
+					const bounding_capsule& capsule = collider.capsule;
+
+					vec3 axis = capsule.positionB - capsule.positionA;
+					float sqAxisLength = dot(axis, axis);
+					float invSqAxisLength = (sqAxisLength > 1e-12f) ? (1.f / sqAxisLength) : 0.f;
+
+					w_vec3 a(capsule.positionA.x, capsule.positionA.y, capsule.positionA.z);
+					w_vec3 wideAxis(axis.x, axis.y, axis.z);
+
+					w_float t = clamp01(dot(position - a, wideAxis) * w_float(invSqAxisLength));
+					center = a + wideAxis * t;
+					radius = capsule.radius;
+				}
+
+				w_vec3 delta = position - center;
+				w_float sqDistance = squaredLength(delta);
+
+				auto inside = (sqDistance < radius * radius) & (sqDistance > epsilon);
+				w_float scale = radius / sqrt(ifThen(inside, sqDistance, w_float(1.f)));
+				position = ifThen(inside, center + delta * scale, position);
+			}
+		}
+
+		if (data.groundHeights)
+		{
+			position.y = maximum(position.y, w_float(data.groundHeights + i));
+		}
+
+		// Fixed particles and the padding never move.
+		w_float invMass = data.invMasses + i;
+		store(data.positions, i, ifThen(invMass > zero, position, original));
+	}
+}
+
+void simulateClothSIMD(const cloth_solver_data& data, uint32 velocityIterations, uint32 positionIterations, uint32 driftIterations,
+	float gravityVelocity, float dampingFactor, float dt)
+{
+	integrate(data, gravityVelocity, dt);
+
+	w_float wideDt = dt;
+	w_float invDt = (dt > 1e-5f) ? (1.f / dt) : 1.f;
+
+	// Solve velocities.
+	if (velocityIterations > 0)
+	{
+		prepareVelocityConstraints(data);
+
+		for (uint32 it = 0; it < velocityIterations; ++it)
+		{
+			solveVelocities(data);
+		}
+
+		for (uint32 i = 0; i < data.numParticles; i += CLOTH_SIMD_WIDTH)
+		{
+			store(data.positions, i, load(data.prevPositions, i) + load(data.velocities, i) * wideDt);
+		}
+	}
+
+	bool collide = data.numColliders > 0 || data.groundHeights;
+
+	// Solve positions. With colliders, the particles are projected out of them after each iteration, so at least one pass is needed.
+	if (positionIterations > 0 || collide)
+	{
+		for (uint32 it = 0; it < positionIterations; ++it)
+		{
+			solvePositions(data);
+			if (collide)
+			{
+				projectCollisions(data);
+			}
+		}
+
+		if (positionIterations == 0)
+		{
+			projectCollisions(data);
+		}
+
+		for (uint32 i = 0; i < data.numParticles; i += CLOTH_SIMD_WIDTH)
+		{
+			store(data.velocities, i, (load(data.positions, i) - load(data.prevPositions, i)) * invDt);
+		}
+	}
+
+	// Solve drift.
+	if (driftIterations > 0)
+	{
+		for (uint32 i = 0; i < data.numParticles; i += CLOTH_SIMD_WIDTH)
+		{
+			store(data.prevPositions, i, load(data.positions, i));
+		}
+
+		for (uint32 it = 0; it < driftIterations; ++it)
+		{
+			solvePositions(data);
+			if (collide)
+			{
+				projectCollisions(data);
+			}
+		}
+
+		for (uint32 i = 0; i < data.numParticles; i += CLOTH_SIMD_WIDTH)
+		{
+			w_vec3 velocity = load(data.velocities, i);
+			velocity += (load(data.positions, i) - load(data.prevPositions, i)) * invDt;
+			store(data.velocities, i, velocity);
+		}
+	}
+
+	// Damping.
+	w_float wideDampingFactor = dampingFactor;
+	for (uint32 i = 0; i < data.numParticles; i += CLOTH_SIMD_WIDTH)
+	{
+		store(data.velocities, i, load(data.velocities, i) * wideDampingFactor);
+	}
+}
+
+}
@@ -1,53 +1,88 @@
 #include "pch.h"
 #include "collision_broad.h"
+#include "collision_narrow.h"
 #include "scene/scene.h"
 #include "physics.h"
+#include "physics_snapshot.h"
 #include "core/cpu_profiling.h"
 
-#include "bounding_volumes_simd.h"
+#include "core/job_system.h"
 
-struct sap_endpoint
-{
-	float value;
-	entity_handle entity = entt::null;
-	bool start;
-	uint16 colliderIndex; // Set each frame.
 
-	sap_endpoint(entity_handle entity, bool start) : entity(entity), start(start) { }
-	sap_endpoint(const sap_endpoint&) = default;
-};
+#define SAP_RADIX_BITS 11
+#define SAP_RADIX_BUCKETS (1 << SAP_RADIX_BITS)
+#define SAP_RADIX_PASSES 3 // 32 bit keys.
+
+#define SAP_MIN_ENDPOINTS_PER_RADIX_JOB 16384
+#define SAP_MAX_NUM_RADIX_JOBS 16
+
+// Above this many endpoints out of order, the insertion sort is replaced by a radix sort.
+#define SAP_MAX_DESCENTS_FOR_INSERTION_SORT(numEndpoints) (16 + (numEndpoints) / 64)
 
 struct sap_context
 {
-	std::vector<sap_endpoint> endpoints;
+	// Endpoints in SoA layout, sorted along the sorting axis.
+	std::vector<float> values;
+	std::vector<uint32> indices; // Packed collider index and start flag, see packEndpoint. The collider index is set each frame.
+	std::vector<entity_handle> entities; // Owning collider of each endpoint. Only needed when removing colliders.
+
 	uint32 sortingAxis = 0;
+	uint32 endpointAxis = 0; // Axis of the current endpoint values. The sorting axis already points to the next frame's axis.
+
+	// Type of the last broadphase call. Unchanged colliders can only skip their update, if the same structure has been updated with their
+	// bounds in the last call. Reset when colliders are added or removed.
+	broadphase_type lastType = broadphase_type_count;
 };
 
+// The narrow phase caches features by collider index, which changes when colliders are added or removed.
+static void invalidateNarrowphaseCache(entt::registry& registry)
+{
+	if (narrowphase_cache* cache = registry.ctx().find<narrowphase_cache>())
+	{
+		cache->entries.clear();
+	}
+}
 
 void addColliderToBroadphase(scene_entity entity)
 {
+	invalidateNarrowphaseCache(*entity.registry);
+
 	sap_context& context = createOrGetContextVariable<sap_context>(*entity.registry);
+	context.lastType = broadphase_type_count;
 
 	sap_endpoint_indirection_component endpointIndirection;
 
-	endpointIndirection.startEndpoint = (uint16)context.endpoints.size();
-	context.endpoints.emplace_back(entity.handle, true);
+	endpointIndirection.startEndpoint = (uint32)context.values.size();
+	context.values.push_back(0.f);
+	context.indices.push_back(packEndpoint(0, true));
+	context.entities.push_back(entity.handle);
 
-	endpointIndirection.endEndpoint = (uint16)context.endpoints.size();
-	context.endpoints.emplace_back(entity.handle, false);
+	endpointIndirection.endEndpoint = (uint32)context.values.size();
+	context.values.push_back(0.f);
+	context.indices.push_back(packEndpoint(0, false));
+	context.entities.push_back(entity.handle);
 
 	entity.addComponent<sap_endpoint_indirection_component>(endpointIndirection);
+
+	// The leaf is created in the first broadphase update, when the collider's bounds are known.
+	createOrGetContextVariable<aabb_tree>(*entity.registry);
+	entity.addComponent<aabb_tree_leaf_component>(aabb_tree_leaf_component{ AABB_TREE_NULL_NODE });
 }
 
-static void removeEndpoint(uint16 endpointIndex, entt::registry& registry, sap_context& context)
+static void removeEndpoint(uint32 endpointIndex, entt::registry& registry, sap_context& context)
 {
-	sap_endpoint last = context.endpoints.back();
-	context.endpoints[endpointIndex] = last;
+	uint32 last = (uint32)context.values.size() - 1;
+	entity_handle lastEntity = context.entities[last];
+	bool lastStart = isStartEndpoint(context.indices[last]);
+
+	context.values[endpointIndex] = context.values[last];
+	context.indices[endpointIndex] = context.indices[last];
+	context.entities[endpointIndex] = lastEntity;
 
 	// Point moved entity to correct slot.
-	sap_endpoint_indirection_component& in = registry.get<sap_endpoint_indirection_component>(last.entity);
+	sap_endpoint_indirection_component& in = registry.get<sap_endpoint_indirection_component>(lastEntity);
 		
-	if (last.start) 
+	if (lastStart) 
 	{ 
 		in.startEndpoint = endpointIndex; 
 	}
@@ -56,7 +91,9 @@ static void removeEndpoint(uint16 endpointIndex, entt::registry& registry, sap_c
 		in.endEndpoint = endpointIndex; 
 	}
 
-	context.endpoints.pop_back();
+	context.values.pop_back();
+	context.indices.pop_back();
+	context.entities.pop_back();
 }
 
 void removeColliderFromBroadphase(scene_entity entity)
@@ -64,6 +101,9 @@ void removeColliderFromBroadphase(scene_entity entity)
 	sap_endpoint_indirection_component& endpointIndirection = entity.getComponent<sap_endpoint_indirection_component>();
 
 	sap_context& context = getContextVariable<sap_context>(*entity.registry);
+	context.lastType = broadphase_type_count;
+
+	invalidateNarrowphaseCache(*entity.registry);
 
 	removeEndpoint(endpointIndirection.startEndpoint, *entity.registry, context);
 	removeEndpoint(endpointIndirection.endEndpoint, *entity.registry, context);
@@ -72,20 +112,58 @@ void removeColliderFromBroadphase(scene_entity entity)
 	{
 		entity.removeComponent<sap_endpoint_indirection_component>();
 	}
+
+	if (entity.hasComponent<aabb_tree_leaf_component>())
+	{
+		uint32 leaf = entity.getComponent<aabb_tree_leaf_component>().leaf;
+		if (leaf != AABB_TREE_NULL_NODE)
+		{
+			getContextVariable<aabb_tree>(*entity.registry).destroyLeaf(leaf);
+		}
+		entity.removeComponent<aabb_tree_leaf_component>();
+	}
 }
 
 void clearBroadphase(game_scene& scene)
 {
-	auto c = scene.registry.ctx();
+	auto& c = scene.registry.ctx();
 	if (sap_context* context = c.find<sap_context>())
 	{
-		context->endpoints.clear();
+		context->values.clear();
+		context->indices.clear();
+		context->entities.clear();
 		context->sortingAxis = 0;
+		context->endpointAxis = 0;
+		context->lastType = broadphase_type_count;
 	}
+	if (aabb_tree* tree = c.find<aabb_tree>())
+	{
+		tree->clear();
+	}
+	invalidateNarrowphaseCache(scene.registry);
 }
 
-static uint32 determineOverlapsScalar(const sap_endpoint* endpoints, uint32 numEndpoints, const bounding_box* worldSpaceAABBs, uint32 numColliders, memory_arena& arena,
-	collider_pair* outCollisions)
+void serializeBroadphaseState(game_scene& scene, physics_snapshot_stream& stream)
+{
+	sap_context& context = scene.createOrGetContextVariable<sap_context>();
+	stream.vector(context.values);
+	stream.vector(context.indices);
+	stream.vector(context.entities);
+	stream.value(context.sortingAxis);
+	stream.value(context.endpointAxis);
+	stream.value(context.lastType);
+
+	aabb_tree& tree = scene.createOrGetContextVariable<aabb_tree>();
+	stream.vector(tree.nodes);
+	stream.value(tree.root);
+	stream.value(tree.freeList);
+	stream.vector(tree.movedLeaves);
+	stream.vector(tree.pairs);
+}
+
+// The overlap buffers are only ever grown, so their size is their capacity. This keeps the hot loops writing through raw pointers.
+static uint32 determineOverlapsScalar(const uint32* endpoints, uint32 numEndpoints, const bounding_box* worldSpaceAABBs, const collision_filter* filters, uint32 numColliders,
+	memory_arena& arena, std::vector<collider_pair>& outCollisions)
 {
 	CPU_PROFILE_BLOCK("Determine overlaps");
 
@@ -97,22 +175,29 @@ static uint32 determineOverlapsScalar(const sap_endpoint* endpoints, uint32 numE
 	uint32 activeListCapacity = numColliders; // Conservative estimate.
 
 	uint32 numActive = 0;
-	uint16* activeList = arena.allocate<uint16>(activeListCapacity);
+	physics_index* activeList = arena.allocate<physics_index>(activeListCapacity);
 
 #if CACHE_AABBS
 	bounding_box* activeBBs = arena.allocate<bounding_box>(activeListCapacity);
 #endif
 
-	uint16* positionInActiveList = arena.allocate<uint16>(numColliders);
+	// Kept next to the active list, so that the filter test doesn't have to gather from the per collider array.
+	collision_filter* activeFilters = arena.allocate<collision_filter>(activeListCapacity);
+
+	physics_index* positionInActiveList = arena.allocate<physics_index>(numColliders);
 
 	uint32 maxNumActive = 0;
 
 	for (uint32 i = 0; i < numEndpoints; ++i)
 	{
-		sap_endpoint ep = endpoints[i];
-		if (ep.start)
+		uint32 ep = endpoints[i];
+		physics_index colliderIndex = getColliderIndex(ep);
+		if (isStartEndpoint(ep))
 		{
-			const bounding_box& a = worldSpaceAABBs[ep.colliderIndex];
+			const bounding_box& a = worldSpaceAABBs[colliderIndex];
+			collision_filter filter = filters[colliderIndex];
+
+			collider_pair* out = ensureOverlapCapacity(outCollisions, numCollisions + numActive);
 
 			for (uint32 active = 0; active < numActive; ++active)
 			{
@@ -122,30 +207,31 @@ static uint32 determineOverlapsScalar(const sap_endpoint* endpoints, uint32 numE
 				const bounding_box& b = worldSpaceAABBs[activeList[active]];
 #endif
 
-				if (aabbVsAABB(a, b))
+				if (aabbVsAABB(a, b) && collisionFiltersMatch(filter, activeFilters[active]))
 				{
-					outCollisions[numCollisions++] = { ep.colliderIndex, activeList[active] };
+					out[numCollisions++] = { colliderIndex, activeList[active] };
 				}
 			}
 
-			ASSERT(ep.colliderIndex < numColliders);
-			positionInActiveList[ep.colliderIndex] = numActive;
+			ASSERT(colliderIndex < numColliders);
+			positionInActiveList[colliderIndex] = numActive;
 
 #if CACHE_AABBS
-			activeBBs[numActive] = worldSpaceAABBs[ep.colliderIndex];
+			activeBBs[numActive] = worldSpaceAABBs[colliderIndex];
 #endif
+			activeFilters[numActive] = filter;
 
-			activeList[numActive++] = ep.colliderIndex;
+			activeList[numActive++] = colliderIndex;
 
 			maxNumActive = max(maxNumActive, numActive);
 		}
 		else
 		{
-			uint16 pos = positionInActiveList[ep.colliderIndex];
+			physics_index pos = positionInActiveList[colliderIndex];
 
 			--numActive;
 
-			uint16 lastColliderInActiveList = activeList[numActive];
+			physics_index lastColliderInActiveList = activeList[numActive];
 			positionInActiveList[lastColliderInActiveList] = pos;
 
 			activeList[pos] = activeList[numActive];
@@ -153,6 +239,7 @@ static uint32 determineOverlapsScalar(const sap_endpoint* endpoints, uint32 numE
 #if CACHE_AABBS
 			activeBBs[pos] = activeBBs[numActive];
 #endif
+			activeFilters[pos] = activeFilters[numActive];
 		}
 	}
 
@@ -165,179 +252,262 @@ static uint32 determineOverlapsScalar(const sap_endpoint* endpoints, uint32 numE
 #undef CACHE_AABBS
 }
 
-static uint32 determineOverlapsSIMD(const sap_endpoint* endpoints, uint32 numEndpoints, const bounding_box* worldSpaceAABBs, uint32 numColliders, memory_arena& arena,
-	collider_pair* outCollisions)
+
+
+static void insertionSortEndpoints(float* values, uint32* indices, uint32 numEndpoints)
 {
-	CPU_PROFILE_BLOCK("Determine overlaps SIMD");
+	CPU_PROFILE_BLOCK("Insertion sort endpoints");
 
-#define COLLISION_SIMD_WIDTH 8u
+	for (uint32 i = 1; i < numEndpoints; ++i)
+	{
+		float keyValue = values[i];
+		uint32 keyIndex = indices[i];
+		uint32 j = i - 1;
 
-#if COLLISION_SIMD_WIDTH == 4
-	typedef w4_float w_float;
-	typedef w4_int w_int;
-#elif COLLISION_SIMD_WIDTH == 8 && defined(SIMD_AVX_2)
-	typedef w8_float w_float;
-	typedef w8_int w_int;
-#endif
+		while (j != UINT32_MAX && values[j] > keyValue)
+		{
+			values[j + 1] = values[j];
+			indices[j + 1] = indices[j];
+			j = j - 1;
+		}
+		values[j + 1] = keyValue;
+		indices[j + 1] = keyIndex;
+	}
+}
 
-	typedef wN_vec2<w_float> w_vec2;
-	typedef wN_vec3<w_float> w_vec3;
-	typedef wN_vec4<w_float> w_vec4;
-	typedef wN_quat<w_float> w_quat;
-	typedef wN_mat2<w_float> w_mat2;
-	typedef wN_mat3<w_float> w_mat3;
+// Maps floats to unsigned integers with the same ordering.
+static uint32 floatToSortableKey(float value)
+{
+	uint32 bits = *(uint32*)&value;
+	uint32 mask = (uint32)(-(int32)(bits >> 31)) | 0x80000000;
+	return bits ^ mask;
+}
 
-	typedef wN_bounding_box<w_float> w_bounding_box;
+static float sortableKeyToFloat(uint32 key)
+{
+	uint32 mask = ((key >> 31) - 1) | 0x80000000;
+	uint32 bits = key ^ mask;
+	return *(float*)&bits;
+}
 
-	struct soa_bounding_box
-	{
-		float minX[COLLISION_SIMD_WIDTH];
-		float minY[COLLISION_SIMD_WIDTH];
-		float minZ[COLLISION_SIMD_WIDTH];
-		float maxX[COLLISION_SIMD_WIDTH];
-		float maxY[COLLISION_SIMD_WIDTH];
-		float maxZ[COLLISION_SIMD_WIDTH];
-	};
+struct radix_sort_pass
+{
+	const uint32* srcKeys;
+	const uint32* srcIndices;
+	uint32* dstKeys;
+	uint32* dstIndices;
+
+	// numChunks * SAP_RADIX_BUCKETS. Holds the per chunk histograms, which are then turned into scatter offsets.
+	uint32* chunkOffsets;
+
+	uint32 numEndpoints;
+	uint32 numChunks;
+	uint32 chunkSize;
+	uint32 shift;
+};
 
-	uint32 numCollisions = 0;
+struct radix_sort_chunk_job_data
+{
+	const radix_sort_pass* pass;
+	uint32 chunk;
+};
 
+static void radixHistogram(const radix_sort_pass& pass, uint32 chunk)
+{
+	uint32* histogram = pass.chunkOffsets + chunk * SAP_RADIX_BUCKETS;
+	memset(histogram, 0, sizeof(uint32) * SAP_RADIX_BUCKETS);
 
-	uint32 activeListCapacity = alignTo(numColliders, COLLISION_SIMD_WIDTH); // Conservative estimate.
+	uint32 first = chunk * pass.chunkSize;
+	uint32 end = min(first + pass.chunkSize, pass.numEndpoints);
+	for (uint32 i = first; i < end; ++i)
+	{
+		++histogram[(pass.srcKeys[i] >> pass.shift) & (SAP_RADIX_BUCKETS - 1)];
+	}
+}
 
-	uint32 numActive = 0;
-	uint16* activeList = arena.allocate<uint16>(activeListCapacity);
+static void radixScatter(const radix_sort_pass& pass, uint32 chunk)
+{
+	uint32* offsets = pass.chunkOffsets + chunk * SAP_RADIX_BUCKETS;
 
-	soa_bounding_box* activeBBs = arena.allocate<soa_bounding_box>(activeListCapacity / COLLISION_SIMD_WIDTH);
+	uint32 first = chunk * pass.chunkSize;
+	uint32 end = min(first + pass.chunkSize, pass.numEndpoints);
+	for (uint32 i = first; i < end; ++i)
+	{
+		uint32 key = pass.srcKeys[i];
+		uint32 dst = offsets[(key >> pass.shift) & (SAP_RADIX_BUCKETS - 1)]++;
+		pass.dstKeys[dst] = key;
+		pass.dstIndices[dst] = pass.srcIndices[i];
+	}
+}
 
-	uint16* positionInActiveList = arena.allocate<uint16>(numColliders);
+// Turns the per chunk histograms into scatter offsets. Within each bucket, the chunks write in chunk order, which keeps the sort stable and
+// the result independent of the number of chunks. Returns false if all keys fall into the same bucket, in which case the pass can be skipped.
+static bool computeScatterOffsets(uint32* chunkOffsets, uint32 numChunks, uint32 numEndpoints)
+{
+	uint32 offset = 0;
+	for (uint32 bucket = 0; bucket < SAP_RADIX_BUCKETS; ++bucket)
+	{
+		uint32 total = 0;
+		for (uint32 chunk = 0; chunk < numChunks; ++chunk)
+		{
+			total += chunkOffsets[chunk * SAP_RADIX_BUCKETS + bucket];
+		}
 
-	uint32 maxNumActive = 0;
+		if (total == numEndpoints)
+		{
+			return false;
+		}
 
-	for (uint32 i = 0; i < numEndpoints; ++i)
+		for (uint32 chunk = 0; chunk < numChunks; ++chunk)
+		{
+			uint32& o = chunkOffsets[chunk * SAP_RADIX_BUCKETS + bucket];
+			uint32 count = o;
+			o = offset;
+			offset += count;
+		}
+	}
+	return true;
+}
+
+static void runRadixSortJobs(const radix_sort_pass& pass, job_function<radix_sort_chunk_job_data> function)
+{
+	struct radix_sort_parent_job_data
+	{
+		const radix_sort_pass* pass;
+		job_function<radix_sort_chunk_job_data> function;
+	};
+
+	job_handle parentJob = highPriorityJobQueue.createJob<radix_sort_parent_job_data>([](radix_sort_parent_job_data& data, job_handle parent)
 	{
-		sap_endpoint ep = endpoints[i];
-		if (ep.start)
+		for (uint32 i = 0; i < data.pass->numChunks; ++i)
 		{
-			const bounding_box& a = worldSpaceAABBs[ep.colliderIndex];
+			highPriorityJobQueue.createJob<radix_sort_chunk_job_data>(data.function, { data.pass, i }, parent).submitNow();
+		}
+	}, { &pass, function });
 
-			w_bounding_box wA = { w_vec3(a.minCorner.x, a.minCorner.y, a.minCorner.z), w_vec3(a.maxCorner.x, a.maxCorner.y, a.maxCorner.z) };
-			uint32 count = bucketize(numActive, COLLISION_SIMD_WIDTH);
+	parentJob.submitNow();
+	parentJob.waitForCompletion();
+}
 
-			for (uint32 active = 0; active < count; ++active)
-			{
-				const soa_bounding_box& soaBB = activeBBs[active];
-				const w_bounding_box& wB = { w_vec3(soaBB.minX, soaBB.minY, soaBB.minZ), w_vec3(soaBB.maxX, soaBB.maxY, soaBB.maxZ) };
+// LSD radix sort with 11 bit digits. Large inputs are split into chunks, which are histogrammed and scattered in parallel.
+static void radixSortEndpoints(float* values, uint32* indices, uint32 numEndpoints, memory_arena& arena)
+{
+	CPU_PROFILE_BLOCK("Radix sort endpoints");
 
-				uint32 numValidLanes = clamp(numActive - active * COLLISION_SIMD_WIDTH, 0u, COLLISION_SIMD_WIDTH);
-				uint32 validLanesMask = (1 << numValidLanes) - 1;
+	memory_marker marker = arena.getMarker();
 
-				auto overlap = aabbVsAABB(wA, wB);
-				int32 mask = toBitMask(overlap) & validLanesMask;
+	uint32* keys = arena.allocate<uint32>(numEndpoints);
+	uint32* tmpKeys = arena.allocate<uint32>(numEndpoints);
+	uint32* tmpIndices = arena.allocate<uint32>(numEndpoints);
 
-				for (uint32 k = 0; k < COLLISION_SIMD_WIDTH; ++k)
-				{
-					if (mask & (1 << k))
-					{
-						outCollisions[numCollisions++] = { ep.colliderIndex, activeList[active * COLLISION_SIMD_WIDTH + k] };
-					}
-				}
-			}
+	for (uint32 i = 0; i < numEndpoints; ++i)
+	{
+		keys[i] = floatToSortableKey(values[i]);
+	}
 
-			ASSERT(ep.colliderIndex < numColliders);
-			positionInActiveList[ep.colliderIndex] = numActive;
+	radix_sort_pass pass;
+	pass.numEndpoints = numEndpoints;
+	pass.numChunks = clamp(numEndpoints / SAP_MIN_ENDPOINTS_PER_RADIX_JOB, 1u, (uint32)SAP_MAX_NUM_RADIX_JOBS);
+	pass.chunkSize = bucketize(numEndpoints, pass.numChunks);
+	pass.chunkOffsets = arena.allocate<uint32>(pass.numChunks * SAP_RADIX_BUCKETS);
 
-			soa_bounding_box& outBB = activeBBs[numActive / COLLISION_SIMD_WIDTH];
-			uint32 outBBSlot = numActive % COLLISION_SIMD_WIDTH;
-			outBB.minX[outBBSlot] = a.minCorner.x;
-			outBB.minY[outBBSlot] = a.minCorner.y;
-			outBB.minZ[outBBSlot] = a.minCorner.z;
-			outBB.maxX[outBBSlot] = a.maxCorner.x;
-			outBB.maxY[outBBSlot] = a.maxCorner.y;
-			outBB.maxZ[outBBSlot] = a.maxCorner.z;
+	CPU_PROFILE_STAT("Radix sort chunks", pass.numChunks);
 
+	uint32* srcKeys = keys;
+	uint32* srcIndices = indices;
+	uint32* dstKeys = tmpKeys;
+	uint32* dstIndices = tmpIndices;
 
-			activeList[numActive++] = ep.colliderIndex;
+	for (uint32 p = 0; p < SAP_RADIX_PASSES; ++p)
+	{
+		pass.srcKeys = srcKeys;
+		pass.srcIndices = srcIndices;
+		pass.dstKeys = dstKeys;
+		pass.dstIndices = dstIndices;
+		pass.shift = p * SAP_RADIX_BITS;
 
-			maxNumActive = max(maxNumActive, numActive);
+		if (pass.numChunks > 1)
+		{
+			runRadixSortJobs(pass, [](radix_sort_chunk_job_data& data, job_handle) { radixHistogram(*data.pass, data.chunk); });
 		}
 		else
 		{
-			uint16 pos = positionInActiveList[ep.colliderIndex];
-
-			--numActive;
-
-			uint16 lastColliderInActiveList = activeList[numActive];
-			positionInActiveList[lastColliderInActiveList] = pos;
-
-			activeList[pos] = activeList[numActive];
+			radixHistogram(pass, 0);
+		}
 
-			soa_bounding_box& outBB = activeBBs[pos / COLLISION_SIMD_WIDTH];
-			uint32 outBBSlot = pos % COLLISION_SIMD_WIDTH;
-			const soa_bounding_box& fromBB = activeBBs[numActive / COLLISION_SIMD_WIDTH];
-			uint32 fromBBSlot = numActive % COLLISION_SIMD_WIDTH;
-
-			outBB.minX[outBBSlot] = fromBB.minX[fromBBSlot];
-			outBB.minY[outBBSlot] = fromBB.minY[fromBBSlot];
-			outBB.minZ[outBBSlot] = fromBB.minZ[fromBBSlot];
-			outBB.maxX[outBBSlot] = fromBB.maxX[fromBBSlot];
-			outBB.maxY[outBBSlot] = fromBB.maxY[fromBBSlot];
-			outBB.maxZ[outBBSlot] = fromBB.maxZ[fromBBSlot];
+		if (!computeScatterOffsets(pass.chunkOffsets, pass.numChunks, numEndpoints))
+		{
+			continue;
 		}
-	}
 
-	ASSERT(numActive == 0);
+		if (pass.numChunks > 1)
+		{
+			runRadixSortJobs(pass, [](radix_sort_chunk_job_data& data, job_handle) { radixScatter(*data.pass, data.chunk); });
+		}
+		else
+		{
+			radixScatter(pass, 0);
+		}
 
-	CPU_PROFILE_STAT("Max num active in SAP", maxNumActive);
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcIndices, dstIndices);
+	}
 
-	return numCollisions;
+	for (uint32 i = 0; i < numEndpoints; ++i)
+	{
+		values[i] = sortableKeyToFloat(srcKeys[i]);
+	}
+	if (srcIndices != indices)
+	{
+		memcpy(indices, srcIndices, sizeof(uint32) * numEndpoints);
+	}
 
-#undef COLLISION_SIMD_WIDTH
+	arena.resetToMarker(marker);
 }
 
-uint32 broadphase(game_scene& scene, bounding_box* worldSpaceAABBs, memory_arena& arena, collider_pair* outCollisions, bool simd)
+static void sortEndpoints(float* values, uint32* indices, uint32 numEndpoints, memory_arena& arena)
 {
-	CPU_PROFILE_BLOCK("Broad phase");
+	CPU_PROFILE_BLOCK("Sort endpoints");
 
-	uint32 numColliders = scene.numberOfComponentsOfType<collider_component>();
-	if (numColliders == 0)
+	// Between coherent frames, the endpoints are nearly sorted and insertion sort is close to linear. After the sorting axis changes or many
+	// colliders are added (e.g. when loading a scene), it becomes quadratic, so we count the endpoints out of order to pick the sort.
+	uint32 numDescents = 0;
+	for (uint32 i = 1; i < numEndpoints; ++i)
 	{
-		return 0;
+		numDescents += values[i] < values[i - 1];
 	}
 
-	sap_context& context = scene.getContextVariable<sap_context>();
-	auto& endpoints = context.endpoints;
+	CPU_PROFILE_STAT("SAP endpoints out of order", numDescents);
 
-	uint32 numEndpoints = numColliders * 2;
+	if (numDescents > SAP_MAX_DESCENTS_FOR_INSERTION_SORT(numEndpoints))
+	{
+		radixSortEndpoints(values, indices, numEndpoints, arena);
+	}
+	else
+	{
+		insertionSortEndpoints(values, indices, numEndpoints);
+	}
+}
 
-	ASSERT(numEndpoints == endpoints.size());
+static uint32 determineSortingAxis(vec3 s, vec3 s2, uint32 numColliders)
+{
+	vec3 variance = s2 - s * s / (float)numColliders;
+	return (variance.x > variance.y) ? ((variance.x > variance.z) ? 0 : 2) : ((variance.y > variance.z) ? 1 : 2);
+}
 
-	uint32 numCollisions = 0;
+static uint32 sweepAndPrune(game_scene& scene, const bounding_box* worldSpaceAABBs, const collision_filter* filters, const bool* unchangedColliders, uint32 numColliders,
+	memory_arena& arena, std::vector<collider_pair>& outCollisions, bool simd)
+{
+	sap_context& context = scene.getContextVariable<sap_context>();
 
-#if 0
-	// Disable broadphase.
+	uint32 numEndpoints = numColliders * 2;
 
-	uint16 collider0Index = 0;
-	for (auto [entityHandle0, collider0] : scene.view<collider_component>().each())
-	{
-		uint16 collider1Index = 0;
-		for (auto [entityHandle1, collider1] : scene.view<collider_component>().each())
-		{
-			if (entityHandle0 == entityHandle1)
-			{
-				break;
-			}
-			if (collider0.parentEntity != collider1.parentEntity)
-			{
-				outCollisions[numCollisions++] = { collider0Index, collider1Index };
-			}
+	ASSERT(numEndpoints == context.values.size());
 
-			++collider1Index;
-		}
-		++collider0Index;
-	}
-	return numCollisions;
+	float* values = context.values.data();
+	uint32* indices = context.indices.data();
 
-#endif
+	uint32 numCollisions = 0;
 
 	vec3 s(0.f, 0.f, 0.f);
 	vec3 s2(0.f, 0.f, 0.f);
@@ -346,30 +516,46 @@ uint32 broadphase(game_scene& scene, bounding_box* worldSpaceAABBs, memory_arena
 
 	CPU_PROFILE_STAT("Broadphase sorting axis", sortingAxis);
 
+	// The endpoint values of unchanged colliders are only valid along the axis they were written for.
+	if (context.endpointAxis != sortingAxis)
+	{
+		unchangedColliders = 0;
+	}
+
+	memory_marker marker = arena.getMarker();
+
+	// Gathered per collider during the update, so that the fix up does not have to go through the registry.
+	sap_endpoint_indirection_component** indirections = arena.allocate<sap_endpoint_indirection_component*>(numColliders);
+	entity_handle* colliderEntities = arena.allocate<entity_handle>(numColliders);
+
 	{
 		CPU_PROFILE_BLOCK("Update endpoints");
 
 		// Index of each collider in the scene. 
 		// We iterate over the endpoint indirections, which are sorted the exact same way as the colliders.
-		uint16 index = 0;
+		uint32 index = 0;
 
 		for (auto [entityHandle, indirection] : scene.view<sap_endpoint_indirection_component>().each())
 		{
 			const bounding_box& aabb = worldSpaceAABBs[index];
 
-			uint16 start = indirection.startEndpoint;
-			uint16 end = indirection.endEndpoint;
+			uint32 start = indirection.startEndpoint;
+			uint32 end = indirection.endEndpoint;
 
-			float lo = aabb.minCorner.data[sortingAxis];
-			float hi = aabb.maxCorner.data[sortingAxis];
-			endpoints[start].value = lo;
-			endpoints[end].value = hi;
+			if (!unchangedColliders || !unchangedColliders[index])
+			{
+				values[start] = aabb.minCorner.data[sortingAxis];
+				values[end] = aabb.maxCorner.data[sortingAxis];
 
-			endpoints[start].colliderIndex = index;
-			endpoints[end].colliderIndex = index;
+				indices[start] = packEndpoint(index, true);
+				indices[end] = packEndpoint(index, false);
+			}
+
+			ASSERT(context.entities[start] == entityHandle);
+			ASSERT(context.entities[end] == entityHandle);
 
-			ASSERT(endpoints[start].entity == entityHandle);
-			ASSERT(endpoints[end].entity == entityHandle);
+			indirections[index] = &indirection;
+			colliderEntities[index] = entityHandle;
 
 			vec3 center = aabb.getCenter();
 			s += center;
@@ -379,69 +565,730 @@ uint32 broadphase(game_scene& scene, bounding_box* worldSpaceAABBs, memory_arena
 		}
 	}
 
+	sortEndpoints(values, indices, numEndpoints, arena);
+
+	if (simd)
 	{
-		CPU_PROFILE_BLOCK("Sort endpoints");
+		numCollisions = SIMD_DISPATCH(determineOverlapsSIMD)(indices, numEndpoints, worldSpaceAABBs, filters, numColliders, arena, outCollisions);
+	}
+	else
+	{
+		numCollisions = determineOverlapsScalar(indices, numEndpoints, worldSpaceAABBs, filters, numColliders, arena, outCollisions);
+	}
 
-#if 1
-		// Insertion sort.
-		for (uint32 i = 1; i < numEndpoints; ++i)
+	// Fix up indirections.
+	{
+		CPU_PROFILE_BLOCK("Fix up indirections");
+
+		entity_handle* entities = context.entities.data();
+
+		for (uint32 i = 0; i < numEndpoints; ++i)
 		{
-			sap_endpoint key = endpoints[i];
-			uint32 j = i - 1;
+			uint32 ep = indices[i];
+			physics_index colliderIndex = getColliderIndex(ep);
 
-			while (j != UINT32_MAX && endpoints[j].value > key.value)
+			if (isStartEndpoint(ep))
 			{
-				endpoints[j + 1] = endpoints[j];
-				j = j - 1;
+				indirections[colliderIndex]->startEndpoint = i;
 			}
-			endpoints[j + 1] = key;
+			else
+			{
+				indirections[colliderIndex]->endEndpoint = i;
+			}
+
+			entities[i] = colliderEntities[colliderIndex];
 		}
-#else
-		std::sort(endpoints, endpoints + numEndpoints, [](sap_endpoint a, sap_endpoint b) { return a.value < b.value; });
-#endif
 	}
 
+	arena.resetToMarker(marker);
 
-	memory_marker marker = arena.getMarker();
 
+	context.endpointAxis = sortingAxis;
+	context.sortingAxis = determineSortingAxis(s, s2, numColliders);
 
-	if (simd)
+	return numCollisions;
+}
+
+
+
+
+// Dynamic AABB tree.
+
+static bool aabbContains(const bounding_box& outer, const bounding_box& inner)
+{
+	return outer.minCorner.x <= inner.minCorner.x && outer.minCorner.y <= inner.minCorner.y && outer.minCorner.z <= inner.minCorner.z
+		&& outer.maxCorner.x >= inner.maxCorner.x && outer.maxCorner.y >= inner.maxCorner.y && outer.maxCorner.z >= inner.maxCorner.z;
+}
+
+static bounding_box combine(const bounding_box& a, const bounding_box& b)
+{
+	return bounding_box::fromMinMax(min(a.minCorner, b.minCorner), max(a.maxCorner, b.maxCorner));
+}
+
+static float surfaceArea(const bounding_box& aabb)
+{
+	vec3 d = aabb.maxCorner - aabb.minCorner;
+	return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+uint32 aabb_tree::allocateNode()
+{
+	uint32 index;
+	if (freeList != AABB_TREE_NULL_NODE)
 	{
-		numCollisions = determineOverlapsSIMD(endpoints.data(), numEndpoints, worldSpaceAABBs, numColliders, arena, outCollisions);
+		index = freeList;
+		freeList = nodes[index].parent;
 	}
 	else
 	{
-		numCollisions = determineOverlapsScalar(endpoints.data(), numEndpoints, worldSpaceAABBs, numColliders, arena, outCollisions);
+		index = (uint32)nodes.size();
+		nodes.emplace_back();
+	}
+
+	aabb_tree_node& node = nodes[index];
+	node.parent = AABB_TREE_NULL_NODE;
+	node.left = AABB_TREE_NULL_NODE;
+	node.right = AABB_TREE_NULL_NODE;
+	node.height = 0;
+	node.colliderIndex = 0;
+	return index;
+}
+
+void aabb_tree::freeNode(uint32 index)
+{
+	nodes[index].parent = freeList;
+	nodes[index].height = -1;
+	freeList = index;
+}
+
+// Rotates the subtree at index, if it is imbalanced. Returns the new root of the subtree.
+uint32 aabb_tree::balance(uint32 iA)
+{
+	aabb_tree_node& A = nodes[iA];
+	if (A.isLeaf() || A.height < 2)
+	{
+		return iA;
 	}
 
-	
+	uint32 iB = A.left;
+	uint32 iC = A.right;
+	aabb_tree_node& B = nodes[iB];
+	aabb_tree_node& C = nodes[iC];
+
+	int32 imbalance = C.height - B.height;
+
+	if (imbalance > 1)
+	{
+		// Rotate C up.
+		uint32 iF = C.left;
+		uint32 iG = C.right;
+		aabb_tree_node& F = nodes[iF];
+		aabb_tree_node& G = nodes[iG];
+
+		C.left = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+
+		if (C.parent != AABB_TREE_NULL_NODE)
+		{
+			aabb_tree_node& parent = nodes[C.parent];
+			if (parent.left == iA) { parent.left = iC; } else { parent.right = iC; }
+		}
+		else
+		{
+			root = iC;
+		}
+
+		if (F.height > G.height)
+		{
+			C.right = iF;
+			A.right = iG;
+			G.parent = iA;
+			A.aabb = combine(B.aabb, G.aabb);
+			C.aabb = combine(A.aabb, F.aabb);
+			A.height = 1 + max(B.height, G.height);
+			C.height = 1 + max(A.height, F.height);
+		}
+		else
+		{
+			C.right = iG;
+			A.right = iF;
+			F.parent = iA;
+			A.aabb = combine(B.aabb, F.aabb);
+			C.aabb = combine(A.aabb, G.aabb);
+			A.height = 1 + max(B.height, F.height);
+			C.height = 1 + max(A.height, G.height);
+		}
+
+		return iC;
+	}
+
+	if (imbalance < -1)
+	{
+		// Rotate B up.
+		uint32 iD = B.left;
+		uint32 iE = B.right;
+		aabb_tree_node& D = nodes[iD];
+		aabb_tree_node& E = nodes[iE];
+
+		B.left = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+
+		if (B.parent != AABB_TREE_NULL_NODE)
+		{
+			aabb_tree_node& parent = nodes[B.parent];
+			if (parent.left == iA) { parent.left = iB; } else { parent.right = iB; }
+		}
+		else
+		{
+			root = iB;
+		}
+
+		if (D.height > E.height)
+		{
+			B.right = iD;
+			A.left = iE;
+			E.parent = iA;
+			A.aabb = combine(C.aabb, E.aabb);
+			B.aabb = combine(A.aabb, D.aabb);
+			A.height = 1 + max(C.height, E.height);
+			B.height = 1 + max(A.height, D.height);
+		}
+		else
+		{
+			B.right = iE;
+			A.left = iD;
+			D.parent = iA;
+			A.aabb = combine(C.aabb, D.aabb);
+			B.aabb = combine(A.aabb, E.aabb);
+			A.height = 1 + max(C.height, D.height);
+			B.height = 1 + max(A.height, E.height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
+
+// Walks up from index to the root, rebalancing and refitting all ancestors.
+void aabb_tree::refitAncestors(uint32 index)
+{
+	while (index != AABB_TREE_NULL_NODE)
+	{
+		index = balance(index);
+
+		aabb_tree_node& node = nodes[index];
+		const aabb_tree_node& left = nodes[node.left];
+		const aabb_tree_node& right = nodes[node.right];
+
+		node.height = 1 + max(left.height, right.height);
+		node.aabb = combine(left.aabb, right.aabb);
+
+		index = node.parent;
+	}
+}
+
+void aabb_tree::insertLeaf(uint32 leaf)
+{
+	if (root == AABB_TREE_NULL_NODE)
+	{
+		root = leaf;
+		nodes[root].parent = AABB_TREE_NULL_NODE;
+		return;
+	}
+
+	// Find the best sibling by descending the tree along the cheapest path (surface area heuristic).
+	bounding_box leafAABB = nodes[leaf].aabb;
+	uint32 index = root;
+	while (!nodes[index].isLeaf())
+	{
+		const aabb_tree_node& node = nodes[index];
+
+		float area = surfaceArea(node.aabb);
+		float combinedArea = surfaceArea(combine(node.aabb, leafAABB));
+
+		// Cost of creating a new parent for this node and the new leaf.
+		float cost = 2.f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down the tree.
+		float inheritanceCost = 2.f * (combinedArea - area);
+
+		auto descendCost = [&](uint32 childIndex)
+		{
+			const aabb_tree_node& child = nodes[childIndex];
+			float childCost = surfaceArea(combine(leafAABB, child.aabb));
+			if (!child.isLeaf())
+			{
+				childCost -= surfaceArea(child.aabb);
+			}
+			return childCost + inheritanceCost;
+		};
+
+		float costLeft = descendCost(node.left);
+		float costRight = descendCost(node.right);
+
+		if (cost < costLeft && cost < costRight)
+		{
+			break;
+		}
+
+		index = (costLeft < costRight) ? node.left : node.right;
+	}
+
+	uint32 sibling = index;
+
+	// Create a new parent. This may reallocate the node array, so no references are held across this call.
+	uint32 oldParent = nodes[sibling].parent;
+	uint32 newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].aabb = combine(leafAABB, nodes[sibling].aabb);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].left = sibling;
+	nodes[newParent].right = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent != AABB_TREE_NULL_NODE)
+	{
+		aabb_tree_node& parent = nodes[oldParent];
+		if (parent.left == sibling) { parent.left = newParent; } else { parent.right = newParent; }
+	}
+	else
+	{
+		root = newParent;
+	}
+
+	refitAncestors(nodes[leaf].parent);
+}
+
+void aabb_tree::removeLeaf(uint32 leaf)
+{
+	if (leaf == root)
+	{
+		root = AABB_TREE_NULL_NODE;
+		return;
+	}
+
+	uint32 parent = nodes[leaf].parent;
+	uint32 grandParent = nodes[parent].parent;
+	uint32 sibling = (nodes[parent].left == leaf) ? nodes[parent].right : nodes[parent].left;
+
+	if (grandParent != AABB_TREE_NULL_NODE)
+	{
+		// Replace the parent with the sibling.
+		aabb_tree_node& gp = nodes[grandParent];
+		if (gp.left == parent) { gp.left = sibling; } else { gp.right = sibling; }
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+
+		refitAncestors(grandParent);
+	}
+	else
+	{
+		root = sibling;
+		nodes[sibling].parent = AABB_TREE_NULL_NODE;
+		freeNode(parent);
+	}
+}
+
+uint32 aabb_tree::createLeaf(const bounding_box& aabb)
+{
+	uint32 leaf = allocateNode();
+	nodes[leaf].aabb = aabb;
+	nodes[leaf].aabb.pad(vec3(AABB_TREE_FAT_MARGIN));
+	insertLeaf(leaf);
+	movedLeaves.push_back(leaf);
+	return leaf;
+}
+
+void aabb_tree::destroyLeaf(uint32 leaf)
+{
+	removeLeaf(leaf);
+	freeNode(leaf);
+	movedLeaves.push_back(leaf); // Drops the leaf's pairs in the next pair update.
+}
+
+bool aabb_tree::moveLeaf(uint32 leaf, const bounding_box& aabb)
+{
+	if (aabbContains(nodes[leaf].aabb, aabb))
+	{
+		return false;
+	}
+
+	removeLeaf(leaf);
+	nodes[leaf].aabb = aabb;
+	nodes[leaf].aabb.pad(vec3(AABB_TREE_FAT_MARGIN));
+	insertLeaf(leaf);
+	movedLeaves.push_back(leaf);
+	return true;
+}
+
+void aabb_tree::clear()
+{
+	nodes.clear();
+	root = AABB_TREE_NULL_NODE;
+	freeList = AABB_TREE_NULL_NODE;
+	movedLeaves.clear();
+	pairs.clear();
+}
+
+// Inserts new colliders into the tree and reinserts colliders, which have left their fat AABB. Returns the (possibly new) leaf of the collider.
+static uint32 updateLeaf(aabb_tree& tree, uint32 leaf, const bounding_box& aabb, physics_index colliderIndex, uint32& numReinserted)
+{
+	if (leaf == AABB_TREE_NULL_NODE)
+	{
+		leaf = tree.createLeaf(aabb);
+		++numReinserted;
+	}
+	else if (tree.moveLeaf(leaf, aabb))
+	{
+		++numReinserted;
+	}
+
+	tree.nodes[leaf].colliderIndex = colliderIndex;
+	return leaf;
+}
+
+// Brings the persistent leaf pairs up to date and writes the pairs whose actual bounds overlap and whose filters match to the beginning of
+// outCollisions. Returns their number. Only the leaves in the move buffer are queried against the tree, so in a mostly resting scene this costs
+// a pass over the pairs instead of one tree query per collider.
+static uint32 updateAABBTreePairs(aabb_tree& tree, const bounding_box* worldSpaceAABBs, const collision_filter* filters,
+	memory_arena& arena, std::vector<collider_pair>& outCollisions)
+{
+	CPU_PROFILE_BLOCK("Update AABB tree pairs");
+
+	CPU_PROFILE_STAT("AABB tree moved leaves", (uint32)tree.movedLeaves.size());
+
+	// 1 for moved leaves, 2 once they have been queried.
+	uint8* moved = arena.allocate<uint8>((uint32)tree.nodes.size(), true);
+	for (uint32 leaf : tree.movedLeaves)
+	{
+		moved[leaf] = 1;
+	}
+
+	// Pairs with a moved leaf are dropped and found again below, if they still overlap.
+	uint32 numKeptPairs = 0;
+	for (aabb_tree_leaf_pair pair : tree.pairs)
+	{
+		if (!moved[pair.leafA] && !moved[pair.leafB])
+		{
+			tree.pairs[numKeptPairs++] = pair;
+		}
+	}
+	tree.pairs.resize(numKeptPairs);
+
+	if (tree.root != AABB_TREE_NULL_NODE)
+	{
+		// A depth first traversal never holds more than one pending node per level.
+		uint32 stackCapacity = tree.nodes[tree.root].height + 2;
+		uint32* stack = arena.allocate<uint32>(stackCapacity);
+
+		for (uint32 leaf : tree.movedLeaves)
+		{
+			// Skips duplicates and destroyed leaves, whose nodes are either free or have been reused as inner nodes.
+			if (moved[leaf] != 1 || tree.nodes[leaf].height != 0)
+			{
+				continue;
+			}
+			moved[leaf] = 2;
+
+			const bounding_box& a = tree.nodes[leaf].aabb;
+
+			uint32 stackSize = 0;
+			stack[stackSize++] = tree.root;
+
+			while (stackSize)
+			{
+				uint32 nodeIndex = stack[--stackSize];
+				const aabb_tree_node& node = tree.nodes[nodeIndex];
+				if (!aabbVsAABB(node.aabb, a))
+				{
+					continue;
+				}
+
+				if (node.isLeaf())
+				{
+					// A pair of two moved leaves has already been added by the one queried first.
+					if (moved[nodeIndex] != 2)
+					{
+						tree.pairs.push_back({ min(leaf, nodeIndex), max(leaf, nodeIndex) });
+					}
+				}
+				else
+				{
+					ASSERT(stackSize + 2 <= stackCapacity);
+					stack[stackSize++] = node.left;
+					stack[stackSize++] = node.right;
+				}
+			}
+		}
+	}
+
+	tree.movedLeaves.clear();
+
+	CPU_PROFILE_STAT("AABB tree leaf pairs", (uint32)tree.pairs.size());
+
+	uint32 numCollisions = 0;
+	collider_pair* collisions = ensureOverlapCapacity(outCollisions, (uint32)tree.pairs.size());
+
+	for (aabb_tree_leaf_pair pair : tree.pairs)
+	{
+		physics_index a = tree.nodes[pair.leafA].colliderIndex;
+		physics_index b = tree.nodes[pair.leafB].colliderIndex;
+
+		// The leaf bounds are fattened, so the actual bounds have to be tested again to report the same pairs as the SAP.
+		if (aabbVsAABB(worldSpaceAABBs[a], worldSpaceAABBs[b]) && collisionFiltersMatch(filters[a], filters[b]))
+		{
+			collisions[numCollisions++] = { min(a, b), max(a, b) };
+		}
+	}
+
+	return numCollisions;
+}
+
+static uint32 aabbTreeBroadphase(game_scene& scene, const bounding_box* worldSpaceAABBs, const collision_filter* filters, const bool* unchangedColliders,
+	memory_arena& arena, std::vector<collider_pair>& outCollisions)
+{
+	aabb_tree& tree = scene.getContextVariable<aabb_tree>();
+
+	{
+		CPU_PROFILE_BLOCK("Update AABB tree");
+
+		uint32 numReinserted = 0;
+
+		// We iterate over the leaf components, which are sorted the exact same way as the colliders.
+		physics_index index = 0;
+		for (auto [entityHandle, leaf] : scene.view<aabb_tree_leaf_component>().each())
+		{
+			if (!unchangedColliders || !unchangedColliders[index])
+			{
+				leaf.leaf = updateLeaf(tree, leaf.leaf, worldSpaceAABBs[index], index, numReinserted);
+			}
+			++index;
+		}
+
+		CPU_PROFILE_STAT("AABB tree reinserted leaves", numReinserted);
+	}
+
+	memory_marker marker = arena.getMarker();
+	uint32 numCollisions = updateAABBTreePairs(tree, worldSpaceAABBs, filters, arena, outCollisions);
 	arena.resetToMarker(marker);
 
+	return numCollisions;
+}
+
+uint32 broadphase(game_scene& scene, bounding_box* worldSpaceAABBs, const collision_filter* filters, memory_arena& arena, std::vector<collider_pair>& outCollisions, broadphase_type type, bool simd,
+	const bool* unchangedColliders)
+{
+	CPU_PROFILE_BLOCK("Broad phase");
 
-	// Fix up indirections.
+	uint32 numColliders = scene.numberOfComponentsOfType<collider_component>();
+	if (numColliders == 0)
 	{
-		CPU_PROFILE_BLOCK("Fix up indirections");
+		return 0;
+	}
 
-		for (uint32 i = 0; i < numEndpoints; ++i)
+	sap_context& context = scene.getContextVariable<sap_context>();
+	if (context.lastType != type)
+	{
+		unchangedColliders = 0;
+	}
+	context.lastType = type;
+
+	if (type == broadphase_type_aabb_tree)
+	{
+		return aabbTreeBroadphase(scene, worldSpaceAABBs, filters, unchangedColliders, arena, outCollisions);
+	}
+	return sweepAndPrune(scene, worldSpaceAABBs, filters, unchangedColliders, numColliders, arena, outCollisions, simd);
+}
+
+
+
+
+// Queries.
+
+// Merges the sorted collider endpoints with the sorted query endpoints and keeps one active list for each. A starting collider is tested
+// against all active queries and vice versa, so each pair is found exactly once.
+static uint32 sweepAndPruneQuery(game_scene& scene, const bounding_box* worldSpaceAABBs, uint32 numColliders, const bounding_box* queryAABBs, uint32 numQueries,
+	memory_arena& arena, std::vector<collider_pair>& outOverlaps)
+{
+	sap_context& context = scene.getContextVariable<sap_context>();
+
+	uint32 numEndpoints = numColliders * 2;
+	ASSERT(numEndpoints == context.values.size());
+
+	const float* values = context.values.data();
+	const uint32* indices = context.indices.data();
+	uint32 axis = context.endpointAxis;
+
+	uint32 numQueryEndpoints = numQueries * 2;
+	float* queryValues = arena.allocate<float>(numQueryEndpoints);
+	uint32* queryIndices = arena.allocate<uint32>(numQueryEndpoints);
+
+	for (uint32 i = 0; i < numQueries; ++i)
+	{
+		// Empty (inverted) bounds must still start before they end. They are rejected by the full overlap test.
+		float minValue = queryAABBs[i].minCorner.data[axis];
+		queryValues[2 * i + 0] = minValue;
+		queryValues[2 * i + 1] = max(queryAABBs[i].maxCorner.data[axis], minValue);
+		queryIndices[2 * i + 0] = packEndpoint(i, true);
+		queryIndices[2 * i + 1] = packEndpoint(i, false);
+	}
+
+	sortEndpoints(queryValues, queryIndices, numQueryEndpoints, arena);
+
+	physics_index* activeColliders = arena.allocate<physics_index>(numColliders);
+	physics_index* colliderPositions = arena.allocate<physics_index>(numColliders);
+	uint32 numActiveColliders = 0;
+
+	uint32* activeQueries = arena.allocate<uint32>(numQueries);
+	uint32* queryPositions = arena.allocate<uint32>(numQueries);
+	uint32 numActiveQueries = 0;
+
+	uint32 numOverlaps = 0;
+
+	uint32 c = 0;
+	uint32 q = 0;
+
+	// Colliders ending after the last query endpoint can't overlap any query anymore.
+	while (q < numQueryEndpoints)
+	{
+		// On ties, start endpoints go first, so that touching bounds are reported like in the broadphase.
+		bool takeCollider = (c < numEndpoints)
+			&& ((values[c] < queryValues[q]) || (values[c] == queryValues[q] && isStartEndpoint(indices[c])));
+
+		if (takeCollider)
 		{
-			sap_endpoint ep = endpoints[i];
-			scene_entity entity = { ep.entity, scene };
-			sap_endpoint_indirection_component& in = entity.getComponent<sap_endpoint_indirection_component>();
+			uint32 ep = indices[c++];
+			physics_index colliderIndex = getColliderIndex(ep);
 
-			if (ep.start)
+			if (isStartEndpoint(ep))
 			{
-				in.startEndpoint = i;
+				const bounding_box& a = worldSpaceAABBs[colliderIndex];
+				collider_pair* out = ensureOverlapCapacity(outOverlaps, numOverlaps + numActiveQueries);
+
+				for (uint32 i = 0; i < numActiveQueries; ++i)
+				{
+					if (aabbVsAABB(a, queryAABBs[activeQueries[i]]))
+					{
+						out[numOverlaps++] = { (physics_index)activeQueries[i], colliderIndex };
+					}
+				}
+
+				colliderPositions[colliderIndex] = numActiveColliders;
+				activeColliders[numActiveColliders++] = colliderIndex;
 			}
 			else
 			{
-				in.endEndpoint = i;
+				physics_index pos = colliderPositions[colliderIndex];
+				physics_index last = activeColliders[--numActiveColliders];
+				colliderPositions[last] = pos;
+				activeColliders[pos] = last;
+			}
+		}
+		else
+		{
+			uint32 ep = queryIndices[q++];
+			uint32 queryIndex = getColliderIndex(ep);
+
+			if (isStartEndpoint(ep))
+			{
+				const bounding_box& a = queryAABBs[queryIndex];
+				collider_pair* out = ensureOverlapCapacity(outOverlaps, numOverlaps + numActiveColliders);
+
+				for (uint32 i = 0; i < numActiveColliders; ++i)
+				{
+					if (aabbVsAABB(a, worldSpaceAABBs[activeColliders[i]]))
+					{
+						out[numOverlaps++] = { (physics_index)queryIndex, activeColliders[i] };
+					}
+				}
+
+				queryPositions[queryIndex] = numActiveQueries;
+				activeQueries[numActiveQueries++] = queryIndex;
+			}
+			else
+			{
+				uint32 pos = queryPositions[queryIndex];
+				uint32 last = activeQueries[--numActiveQueries];
+				queryPositions[last] = pos;
+				activeQueries[pos] = last;
 			}
 		}
 	}
 
+	return numOverlaps;
+}
 
-	vec3 variance = s2 - s * s / (float)numColliders;
-	context.sortingAxis = (variance.x > variance.y) ? ((variance.x > variance.z) ? 0 : 2) : ((variance.y > variance.z) ? 1 : 2);
+static uint32 aabbTreeQuery(game_scene& scene, const bounding_box* worldSpaceAABBs, const bounding_box* queryAABBs, uint32 numQueries, memory_arena& arena,
+	std::vector<collider_pair>& outOverlaps)
+{
+	aabb_tree& tree = scene.getContextVariable<aabb_tree>();
 
-	return numCollisions;
+	if (tree.root == AABB_TREE_NULL_NODE)
+	{
+		return 0;
+	}
+
+	uint32 numOverlaps = 0;
+
+	uint32 stackCapacity = tree.nodes[tree.root].height + 2;
+	uint32* stack = arena.allocate<uint32>(stackCapacity);
+
+	for (uint32 i = 0; i < numQueries; ++i)
+	{
+		const bounding_box& a = queryAABBs[i];
+
+		uint32 stackSize = 0;
+		stack[stackSize++] = tree.root;
+
+		while (stackSize)
+		{
+			const aabb_tree_node& node = tree.nodes[stack[--stackSize]];
+			if (!aabbVsAABB(node.aabb, a))
+			{
+				continue;
+			}
+
+			if (node.isLeaf())
+			{
+				if (aabbVsAABB(a, worldSpaceAABBs[node.colliderIndex]))
+				{
+					ensureOverlapCapacity(outOverlaps, numOverlaps + 1)[numOverlaps++] = { (physics_index)i, node.colliderIndex };
+				}
+			}
+			else
+			{
+				ASSERT(stackSize + 2 <= stackCapacity);
+				stack[stackSize++] = node.left;
+				stack[stackSize++] = node.right;
+			}
+		}
+	}
+
+	return numOverlaps;
+}
+
+uint32 broadphaseQuery(game_scene& scene, const bounding_box* worldSpaceAABBs, const bounding_box* queryAABBs, uint32 numQueries, memory_arena& arena,
+	std::vector<collider_pair>& outOverlaps, broadphase_type type)
+{
+	CPU_PROFILE_BLOCK("Broad phase query");
+
+	uint32 numColliders = scene.numberOfComponentsOfType<collider_component>();
+	if (numColliders == 0 || numQueries == 0)
+	{
+		return 0;
+	}
+
+	memory_marker marker = arena.getMarker();
+
+	uint32 numOverlaps = (type == broadphase_type_aabb_tree)
+		? aabbTreeQuery(scene, worldSpaceAABBs, queryAABBs, numQueries, arena, outOverlaps)
+		: sweepAndPruneQuery(scene, worldSpaceAABBs, numColliders, queryAABBs, numQueries, arena, outOverlaps);
+
+	arena.resetToMarker(marker);
+
+	return numOverlaps;
 }
@@ -3,16 +3,63 @@
 #include "bounding_volumes.h"
 #include "scene/scene.h"
 #include "core/memory.h"
+#include "physics_index.h"
+#include "core/simd_dispatch.h"
 
 
 struct collider_pair
 {
 	// Indices of the colliders in the scene.
-	uint16 colliderA;
-	uint16 colliderB;
+	physics_index colliderA;
+	physics_index colliderB;
+
+	bool operator<(collider_pair o) const { return (colliderA != o.colliderA) ? (colliderA < o.colliderA) : (colliderB < o.colliderB); }
+	bool operator==(collider_pair o) const { return colliderA == o.colliderA && colliderB == o.colliderB; }
+};
+
+// Two colliders only interact, if the layer of each one has a bit in common with the mask of the other. Evaluated in the broadphase, so filtered
+// pairs never reach the narrow phase.
+struct collision_filter
+{
+	uint32 layer;
+	uint32 mask;
 };
 
-uint32 broadphase(struct game_scene& scene, bounding_box* worldSpaceAABBs, memory_arena& arena, collider_pair* outOverlaps, bool simd);
+static bool collisionFiltersMatch(collision_filter a, collision_filter b)
+{
+	return (a.layer & b.mask) && (b.layer & a.mask);
+}
+
+enum broadphase_type
+{
+	// Single axis sweep and prune. Very fast for scenes spread out along one axis, but degrades when many colliders overlap on the sorting axis.
+	broadphase_type_sweep_and_prune,
+
+	// Dynamic bounding volume hierarchy over fattened AABBs. Only colliders leaving their fattened bounds are reinserted and queried for new pairs
+	// each frame. The other pairs persist between frames.
+	broadphase_type_aabb_tree,
+
+	broadphase_type_count,
+};
+
+static const char* broadphaseTypeNames[] =
+{
+	"Sweep and prune",
+	"Dynamic AABB tree",
+};
+
+// Writes the overlapping collider pairs to the beginning of outOverlaps and returns their number. The buffer is grown as needed, but never
+// shrunk, so its size can be larger than the number of overlaps. Keeping it around between frames avoids reallocations.
+// The filters are indexed like the colliders. Colliders flagged in unchangedColliders (optional) have the same bounds as in the last call and
+// skip their update.
+uint32 broadphase(struct game_scene& scene, bounding_box* worldSpaceAABBs, const collision_filter* filters, memory_arena& arena, std::vector<collider_pair>& outOverlaps, broadphase_type type, bool simd,
+	const bool* unchangedColliders = 0);
+
+// Finds the colliders overlapping the given query bounds (e.g. of cloths), using the structures built by the last broadphase call of this frame.
+// Must be called with the same world space AABBs and broadphase type. Writes the pairs to the beginning of outOverlaps, with colliderA being the
+// query index and colliderB the collider index, and returns their number. Queries are not tested against each other.
+uint32 broadphaseQuery(struct game_scene& scene, const bounding_box* worldSpaceAABBs, const bounding_box* queryAABBs, uint32 numQueries, memory_arena& arena,
+	std::vector<collider_pair>& outOverlaps, broadphase_type type);
 
 
 
@@ -22,6 +69,96 @@ uint32 broadphase(struct game_scene& scene, bounding_box* worldSpaceAABBs, memor
 // Internal.
 struct sap_endpoint_indirection_component
 {
-	uint16 startEndpoint;
-	uint16 endEndpoint;
+	uint32 startEndpoint;
+	uint32 endEndpoint;
+};
+
+// Sweep and prune endpoints store the collider index and a start flag in one integer.
+static uint32 packEndpoint(uint32 colliderIndex, bool start)
+{
+	return (colliderIndex << 1) | (uint32)start;
+}
+
+static physics_index getColliderIndex(uint32 endpoint)
+{
+	return (physics_index)(endpoint >> 1);
+}
+
+static bool isStartEndpoint(uint32 endpoint)
+{
+	return endpoint & 1;
+}
+
+static collider_pair* ensureOverlapCapacity(std::vector<collider_pair>& overlaps, uint32 requiredSize)
+{
+	if (overlaps.size() < requiredSize)
+	{
+		overlaps.resize(max(requiredSize, (uint32)overlaps.size() * 2));
+	}
+	return overlaps.data();
+}
+
+// Sweeps over the sorted endpoints and writes the overlapping pairs with matching filters to the beginning of outCollisions. Returns their number.
+// Compiled once per SIMD level (see collision_broad_simd.cpp), call through SIMD_DISPATCH.
+SIMD_KERNEL_DECLARATIONS(
+	uint32 determineOverlapsSIMD(const uint32* endpoints, uint32 numEndpoints, const bounding_box* worldSpaceAABBs, const collision_filter* filters, uint32 numColliders,
+		memory_arena& arena, std::vector<collider_pair>& outCollisions);
+)
+
+#define AABB_TREE_NULL_NODE UINT32_MAX
+
+// Leaves store the collider bounds enlarged by this margin, so that small movements don't require a tree update.
+#define AABB_TREE_FAT_MARGIN 0.1f
+
+struct aabb_tree_node
+{
+	bounding_box aabb; // Fattened for leaves.
+	uint32 parent; // Next free node, if this node is in the free list.
+	uint32 left;
+	uint32 right;
+	int32 height; // 0 for leaves, -1 for free nodes.
+	physics_index colliderIndex; // Leaves only. Set each frame.
+
+	bool isLeaf() const { return left == AABB_TREE_NULL_NODE; }
+};
+
+// Pair of leaves with overlapping fattened bounds. leafA < leafB.
+struct aabb_tree_leaf_pair
+{
+	uint32 leafA;
+	uint32 leafB;
+};
+
+struct aabb_tree
+{
+	std::vector<aabb_tree_node> nodes;
+	uint32 root = AABB_TREE_NULL_NODE;
+	uint32 freeList = AABB_TREE_NULL_NODE;
+
+	// Leaves created, reinserted or destroyed since the last pair update. Only these can gain or lose pairs, since the fattened bounds of all
+	// other leaves are unchanged.
+	std::vector<uint32> movedLeaves;
+
+	// All pairs of leaves with overlapping fattened bounds, as of the last pair update.
+	std::vector<aabb_tree_leaf_pair> pairs;
+
+	uint32 createLeaf(const bounding_box& aabb);
+	void destroyLeaf(uint32 leaf);
+
+	// Reinserts the leaf, if the aabb is not contained in its fattened bounds. Returns true, if the leaf was reinserted.
+	bool moveLeaf(uint32 leaf, const bounding_box& aabb);
+
+	void clear();
+
+	uint32 allocateNode();
+	void freeNode(uint32 index);
+	void insertLeaf(uint32 leaf);
+	void removeLeaf(uint32 leaf);
+	void refitAncestors(uint32 index);
+	uint32 balance(uint32 index);
+};
+
+struct aabb_tree_leaf_component
+{
+	uint32 leaf;
 };
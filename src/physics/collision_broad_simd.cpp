@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "collision_broad.h"
+#include "core/cpu_profiling.h"
+
+#include "bounding_volumes_simd.h"
+
+// Broad phase SIMD kernels. Compiled once per SIMD level, see core/simd_dispatch.h.
+
+namespace SIMD_ISA
+{
+
+uint32 determineOverlapsSIMD(const uint32* endpoints, uint32 numEndpoints, const bounding_box* worldSpaceAABBs, const collision_filter* filters, uint32 numColliders,
+	memory_arena& arena, std::vector<collider_pair>& outCollisions)
+{
+	CPU_PROFILE_BLOCK("Determine overlaps SIMD");
+
+#if defined(SIMD_AVX_512)
+#define COLLISION_SIMD_WIDTH 16u
+	typedef w16_float w_float;
+	typedef w16_int w_int;
+#elif defined(SIMD_AVX_2)
+#define COLLISION_SIMD_WIDTH 8u
+	typedef w8_float w_float;
+	typedef w8_int w_int;
+#else
+#define COLLISION_SIMD_WIDTH 4u
+	typedef w4_float w_float;
+	typedef w4_int w_int;
+#endif
+
+	typedef wN_vec2<w_float> w_vec2;
+	typedef wN_vec3<w_float> w_vec3;
+	typedef wN_vec4<w_float> w_vec4;
+	typedef wN_quat<w_float> w_quat;
+	typedef wN_mat2<w_float> w_mat2;
+	typedef wN_mat3<w_float> w_mat3;
+
+	typedef wN_bounding_box<w_float> w_bounding_box;
+
+	struct soa_bounding_box
+	{
+		float minX[COLLISION_SIMD_WIDTH];
+		float minY[COLLISION_SIMD_WIDTH];
+		float minZ[COLLISION_SIMD_WIDTH];
+		float maxX[COLLISION_SIMD_WIDTH];
+		float maxY[COLLISION_SIMD_WIDTH];
+		float maxZ[COLLISION_SIMD_WIDTH];
+
+		// Collision filters of the same colliders, so that a block of active colliders is rejected with one more vector test.
+		int32 layer[COLLISION_SIMD_WIDTH];
+		int32 mask[COLLISION_SIMD_WIDTH];
+	};
+
+	uint32 numCollisions = 0;
+
+
+	uint32 activeListCapacity = alignTo(numColliders, COLLISION_SIMD_WIDTH); // Conservative estimate.
+
+	uint32 numActive = 0;
+	physics_index* activeList = arena.allocate<physics_index>(activeListCapacity);
+
+	soa_bounding_box* activeBBs = arena.allocate<soa_bounding_box>(activeListCapacity / COLLISION_SIMD_WIDTH);
+
+	physics_index* positionInActiveList = arena.allocate<physics_index>(numColliders);
+
+	uint32 maxNumActive = 0;
+
+	for (uint32 i = 0; i < numEndpoints; ++i)
+	{
+		uint32 ep = endpoints[i];
+		physics_index colliderIndex = getColliderIndex(ep);
+		if (isStartEndpoint(ep))
+		{
+			const bounding_box& a = worldSpaceAABBs[colliderIndex];
+			collision_filter filter = filters[colliderIndex];
+
+			w_bounding_box wA = { w_vec3(a.minCorner.x, a.minCorner.y, a.minCorner.z), w_vec3(a.maxCorner.x, a.maxCorner.y, a.maxCorner.z) };
+			w_int wLayer = (int32)filter.layer;
+			w_int wMask = (int32)filter.mask;
+			w_int zero = w_int::zero();
+			uint32 count = bucketize(numActive, COLLISION_SIMD_WIDTH);
+
+			collider_pair* out = ensureOverlapCapacity(outCollisions, numCollisions + numActive);
+
+			for (uint32 active = 0; active < count; ++active)
+			{
+				const soa_bounding_box& soaBB = activeBBs[active];
+				const w_bounding_box& wB = { w_vec3(soaBB.minX, soaBB.minY, soaBB.minZ), w_vec3(soaBB.maxX, soaBB.maxY, soaBB.maxZ) };
+
+				uint32 numValidLanes = clamp(numActive - active * COLLISION_SIMD_WIDTH, 0u, COLLISION_SIMD_WIDTH);
+				uint32 validLanesMask = (1 << numValidLanes) - 1;
+
+				auto overlap = aabbVsAABB(wA, wB);
+				auto layerInMask = (wLayer & w_int(soaBB.mask)) != zero;
+				auto maskHasLayer = (wMask & w_int(soaBB.layer)) != zero;
+				int32 mask = toBitMask(overlap) & toBitMask(layerInMask) & toBitMask(maskHasLayer) & validLanesMask;
+
+				for (uint32 k = 0; k < COLLISION_SIMD_WIDTH; ++k)
+				{
+					if (mask & (1 << k))
+					{
+						out[numCollisions++] = { colliderIndex, activeList[active * COLLISION_SIMD_WIDTH + k] };
+					}
+				}
+			}
+
+			ASSERT(colliderIndex < numColliders);
+			positionInActiveList[colliderIndex] = numActive;
+
+			soa_bounding_box& outBB = activeBBs[numActive / COLLISION_SIMD_WIDTH];
+			uint32 outBBSlot = numActive % COLLISION_SIMD_WIDTH;
+			outBB.minX[outBBSlot] = a.minCorner.x;
+			outBB.minY[outBBSlot] = a.minCorner.y;
+			outBB.minZ[outBBSlot] = a.minCorner.z;
+			outBB.maxX[outBBSlot] = a.maxCorner.x;
+			outBB.maxY[outBBSlot] = a.maxCorner.y;
+			outBB.maxZ[outBBSlot] = a.maxCorner.z;
+			outBB.layer[outBBSlot] = (int32)filter.layer;
+			outBB.mask[outBBSlot] = (int32)filter.mask;
+
+
+			activeList[numActive++] = colliderIndex;
+
+			maxNumActive = max(maxNumActive, numActive);
+		}
+		else
+		{
+			physics_index pos = positionInActiveList[colliderIndex];
+
+			--numActive;
+
+			physics_index lastColliderInActiveList = activeList[numActive];
+			positionInActiveList[lastColliderInActiveList] = pos;
+
+			activeList[pos] = activeList[numActive];
+
+			soa_bounding_box& outBB = activeBBs[pos / COLLISION_SIMD_WIDTH];
+			uint32 outBBSlot = pos % COLLISION_SIMD_WIDTH;
+			const soa_bounding_box& fromBB = activeBBs[numActive / COLLISION_SIMD_WIDTH];
+			uint32 fromBBSlot = numActive % COLLISION_SIMD_WIDTH;
+
+			outBB.minX[outBBSlot] = fromBB.minX[fromBBSlot];
+			outBB.minY[outBBSlot] = fromBB.minY[fromBBSlot];
+			outBB.minZ[outBBSlot] = fromBB.minZ[fromBBSlot];
+			outBB.maxX[outBBSlot] = fromBB.maxX[fromBBSlot];
+			outBB.maxY[outBBSlot] = fromBB.maxY[fromBBSlot];
+			outBB.maxZ[outBBSlot] = fromBB.maxZ[fromBBSlot];
+			outBB.layer[outBBSlot] = fromBB.layer[fromBBSlot];
+			outBB.mask[outBBSlot] = fromBB.mask[fromBBSlot];
+		}
+	}
+
+	ASSERT(numActive == 0);
+
+	CPU_PROFILE_STAT("Max num active in SAP", maxNumActive);
+
+	return numCollisions;
+
+#undef COLLISION_SIMD_WIDTH
+}
+
+}
@@ -211,3 +211,211 @@ gjk_internal_success updateGJKSimplex(gjk_simplex& s, const gjk_support_point& a
 	return gjk_unexpected_error;
 }
 
+
+// Closest point on a segment, triangle or tetrahedron to the origin (Real-Time Collision Detection, chapter 5.1).
+// The simplex is reduced to the smallest sub-simplex containing the closest point, and the barycentric coordinates of the
+// closest point are written to lambdas. Returns false, if the origin is contained in the tetrahedron.
+
+struct gjk_sub_simplex
+{
+	gjk_support_point points[3];
+	float lambdas[3];
+	uint32 numPoints;
+
+	vec3 closestPoint() const
+	{
+		vec3 result(0.f);
+		for (uint32 i = 0; i < numPoints; ++i)
+		{
+			result += lambdas[i] * points[i].minkowski;
+		}
+		return result;
+	}
+};
+
+static gjk_sub_simplex vertexSubSimplex(const gjk_support_point& a)
+{
+	gjk_sub_simplex result;
+	result.points[0] = a;
+	result.lambdas[0] = 1.f;
+	result.numPoints = 1;
+	return result;
+}
+
+static gjk_sub_simplex edgeSubSimplex(const gjk_support_point& a, const gjk_support_point& b, float t)
+{
+	gjk_sub_simplex result;
+	result.points[0] = a;
+	result.points[1] = b;
+	result.lambdas[0] = 1.f - t;
+	result.lambdas[1] = t;
+	result.numPoints = 2;
+	return result;
+}
+
+static gjk_sub_simplex closestOnSegment(const gjk_support_point& a, const gjk_support_point& b)
+{
+	vec3 ab = b.minkowski - a.minkowski;
+	float abab = dot(ab, ab);
+	float t = (abab > 0.f) ? (-dot(a.minkowski, ab) / abab) : 0.f;
+
+	if (t <= 0.f)
+	{
+		return vertexSubSimplex(a);
+	}
+	if (t >= 1.f)
+	{
+		return vertexSubSimplex(b);
+	}
+	return edgeSubSimplex(a, b, t);
+}
+
+static gjk_sub_simplex closestOnTriangle(const gjk_support_point& A, const gjk_support_point& B, const gjk_support_point& C)
+{
+	vec3 a = A.minkowski;
+	vec3 b = B.minkowski;
+	vec3 c = C.minkowski;
+
+	vec3 ab = b - a;
+	vec3 ac = c - a;
+
+	float d1 = -dot(ab, a);
+	float d2 = -dot(ac, a);
+	if (d1 <= 0.f && d2 <= 0.f)
+	{
+		return vertexSubSimplex(A);
+	}
+
+	float d3 = -dot(ab, b);
+	float d4 = -dot(ac, b);
+	if (d3 >= 0.f && d4 <= d3)
+	{
+		return vertexSubSimplex(B);
+	}
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+	{
+		return edgeSubSimplex(A, B, d1 / (d1 - d3));
+	}
+
+	float d5 = -dot(ab, c);
+	float d6 = -dot(ac, c);
+	if (d6 >= 0.f && d5 <= d6)
+	{
+		return vertexSubSimplex(C);
+	}
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+	{
+		return edgeSubSimplex(A, C, d2 / (d2 - d6));
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f)
+	{
+		return edgeSubSimplex(B, C, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	float denom = va + vb + vc;
+	if (denom <= 0.f)
+	{
+		// Degenerate triangle. Fall back to the closest of the edges.
+		gjk_sub_simplex edgeAB = closestOnSegment(A, B);
+		gjk_sub_simplex edgeAC = closestOnSegment(A, C);
+		return (squaredLength(edgeAB.closestPoint()) < squaredLength(edgeAC.closestPoint())) ? edgeAB : edgeAC;
+	}
+
+	denom = 1.f / denom;
+	float v = vb * denom;
+	float w = vc * denom;
+
+	gjk_sub_simplex result;
+	result.points[0] = A;
+	result.points[1] = B;
+	result.points[2] = C;
+	result.lambdas[0] = 1.f - v - w;
+	result.lambdas[1] = v;
+	result.lambdas[2] = w;
+	result.numPoints = 3;
+	return result;
+}
+
+static bool originOutsideOfPlane(vec3 a, vec3 b, vec3 c, vec3 d)
+{
+	vec3 n = cross(b - a, c - a);
+	float signO = -dot(a, n);
+	float signD = dot(d - a, n);
+
+	// For degenerate (flat) tetrahedra we can't tell, so we check the face anyway.
+	if (signD * signD < 1e-12f)
+	{
+		return true;
+	}
+	return signO * signD < 0.f;
+}
+
+bool gjkClosestPointOnSimplex(gjk_support_point* points, float* lambdas, uint32& numPoints, vec3& outClosest)
+{
+	gjk_sub_simplex best;
+
+	if (numPoints == 2)
+	{
+		best = closestOnSegment(points[0], points[1]);
+	}
+	else if (numPoints == 3)
+	{
+		best = closestOnTriangle(points[0], points[1], points[2]);
+	}
+	else
+	{
+		ASSERT(numPoints == 4);
+
+		const gjk_support_point& a = points[0];
+		const gjk_support_point& b = points[1];
+		const gjk_support_point& c = points[2];
+		const gjk_support_point& d = points[3];
+
+		const gjk_support_point* faces[4][4] =
+		{
+			{ &a, &b, &c, &d },
+			{ &a, &c, &d, &b },
+			{ &a, &d, &b, &c },
+			{ &b, &d, &c, &a },
+		};
+
+		float bestSquaredDistance = FLT_MAX;
+		bool outside = false;
+
+		for (uint32 i = 0; i < 4; ++i)
+		{
+			const gjk_support_point* const* f = faces[i];
+			if (originOutsideOfPlane(f[0]->minkowski, f[1]->minkowski, f[2]->minkowski, f[3]->minkowski))
+			{
+				gjk_sub_simplex candidate = closestOnTriangle(*f[0], *f[1], *f[2]);
+				float sqDistance = squaredLength(candidate.closestPoint());
+				if (sqDistance < bestSquaredDistance)
+				{
+					bestSquaredDistance = sqDistance;
+					best = candidate;
+				}
+				outside = true;
+			}
+		}
+
+		if (!outside)
+		{
+			return false;
+		}
+	}
+
+	for (uint32 i = 0; i < best.numPoints; ++i)
+	{
+		points[i] = best.points[i];
+		lambdas[i] = best.lambdas[i];
+	}
+	numPoints = best.numPoints;
+	outClosest = best.closestPoint();
+	return true;
+}
@@ -99,6 +99,28 @@ struct hull_support_fn
 	};
 };
 
+// The following two are the "core" shapes of spheres and capsules. The distance query runs on the core and subtracts the radius afterwards,
+// since GJK converges much faster on polytopes than on round shapes.
+struct point_support_fn
+{
+	vec3 p;
+
+	vec3 operator()(const vec3& dir) const
+	{
+		return p;
+	}
+};
+
+struct segment_support_fn
+{
+	vec3 a, b;
+
+	vec3 operator()(const vec3& dir) const
+	{
+		return (dot(dir, a) > dot(dir, b)) ? a : b;
+	}
+};
+
 union extruded_triangle_support_fn
 {
 	struct
@@ -115,6 +137,14 @@ union extruded_triangle_support_fn
 		f(c.x, c.y - extrusion, c.z)
 	{}
 
+	// Extrudes along an arbitrary direction, e.g. against the normal of a mesh triangle.
+	extruded_triangle_support_fn(vec3 a, vec3 b, vec3 c, vec3 extrusion)
+		: a(a), b(b), c(c),
+		d(a + extrusion),
+		e(b + extrusion),
+		f(c + extrusion)
+	{}
+
 	vec3 operator()(vec3 dir) const
 	{
 		float maxD = dot(a, dir);
@@ -180,19 +210,24 @@ enum gjk_internal_success
 	gjk_unexpected_error, // Happens very very seldom. I don't know the reason yet, but instead of asserting we return this. I figure it's better than crashing.
 };
 
+// The search starts along the given direction, which should point from shape A towards shape B. If the shapes don't intersect, it is
+// overwritten with a separating axis (again pointing from A to B). Starting with last frame's axis lets separated pairs exit after the first
+// support point.
 template <typename shapeA_t, typename shapeB_t>
-static bool gjkIntersectionTest(const shapeA_t& shapeA, const shapeB_t& shapeB, gjk_simplex& outSimplex)
+static bool gjkIntersectionTest(const shapeA_t& shapeA, const shapeB_t& shapeB, gjk_simplex& outSimplex, vec3& inOutDirection)
 {
 	// http://www.dyn4j.org/2010/04/gjk-gilbert-johnson-keerthi/
 
 	gjk_internal_success updateGJKSimplex(gjk_simplex& s, const gjk_support_point& a, vec3& dir);
 
-	vec3 dir(1.f, 0.1f, -0.2f); // Arbitrary.
+	// The Minkowski difference is A - B, so the direction from A to B is negated.
+	vec3 dir = -inOutDirection;
 
 	// First point.
 	outSimplex.c = support(shapeA, shapeB, dir);
 	if (dot(outSimplex.c.minkowski, dir) < 0.f)
 	{
+		inOutDirection = -dir;
 		return false;
 	}
 
@@ -201,6 +236,7 @@ static bool gjkIntersectionTest(const shapeA_t& shapeA, const shapeB_t& shapeB,
 	outSimplex.b = support(shapeA, shapeB, dir);
 	if (dot(outSimplex.b.minkowski, dir) < 0.f)
 	{
+		inOutDirection = -dir;
 		return false;
 	}
 
@@ -217,6 +253,7 @@ static bool gjkIntersectionTest(const shapeA_t& shapeA, const shapeB_t& shapeB,
 		gjk_support_point a = support(shapeA, shapeB, dir);
 		if (dot(a.minkowski, dir) < 0.f)
 		{
+			inOutDirection = -dir;
 			return false;
 		}
 
@@ -237,4 +274,81 @@ static bool gjkIntersectionTest(const shapeA_t& shapeA, const shapeB_t& shapeB,
 	return true;
 }
 
+template <typename shapeA_t, typename shapeB_t>
+static bool gjkIntersectionTest(const shapeA_t& shapeA, const shapeB_t& shapeB, gjk_simplex& outSimplex)
+{
+	vec3 dir(-1.f, -0.1f, 0.2f); // Arbitrary.
+	return gjkIntersectionTest(shapeA, shapeB, outSimplex, dir);
+}
+
+
+struct gjk_distance_result
+{
+	vec3 closestPointA;
+	vec3 closestPointB;
+	float distance;
+};
+
+// Returns false, if the shapes intersect. In this case the result is not filled.
+template <typename shapeA_t, typename shapeB_t>
+static bool gjkDistance(const shapeA_t& shapeA, const shapeB_t& shapeB, gjk_distance_result& outResult)
+{
+	bool gjkClosestPointOnSimplex(gjk_support_point* points, float* lambdas, uint32& numPoints, vec3& outClosest);
+
+	gjk_support_point points[4];
+	float lambdas[4];
 
+	points[0] = support(shapeA, shapeB, vec3(1.f, 0.1f, -0.2f)); // Arbitrary.
+	lambdas[0] = 1.f;
+	uint32 numPoints = 1;
+
+	vec3 v = points[0].minkowski;
+
+	for (uint32 iteration = 0; iteration < 64; ++iteration)
+	{
+		float vv = squaredLength(v);
+		if (vv < 1e-10f)
+		{
+			return false;
+		}
+
+		gjk_support_point w = support(shapeA, shapeB, -v);
+
+		// Stop if the new support point does not get us any closer to the origin.
+		if (vv - dot(v, w.minkowski) <= 1e-6f * vv)
+		{
+			break;
+		}
+
+		bool duplicate = false;
+		for (uint32 i = 0; i < numPoints; ++i)
+		{
+			duplicate |= (w.minkowski == points[i].minkowski);
+		}
+		if (duplicate)
+		{
+			break;
+		}
+
+		points[numPoints] = w;
+		lambdas[numPoints] = 0.f;
+		++numPoints;
+
+		if (!gjkClosestPointOnSimplex(points, lambdas, numPoints, v))
+		{
+			return false;
+		}
+	}
+
+	vec3 a(0.f), b(0.f);
+	for (uint32 i = 0; i < numPoints; ++i)
+	{
+		a += lambdas[i] * points[i].shapeAPoint;
+		b += lambdas[i] * points[i].shapeBPoint;
+	}
+
+	outResult.closestPointA = a;
+	outResult.closestPointB = b;
+	outResult.distance = length(v);
+	return true;
+}
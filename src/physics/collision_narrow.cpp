@@ -6,36 +6,7 @@
 #include "collision_epa.h"
 #include "collision_sat.h"
 #include "core/cpu_profiling.h"
-
-#include "bounding_volumes_simd.h"
-
-#define COLLISION_SIMD_WIDTH 8u
-
-
-#if COLLISION_SIMD_WIDTH == 4
-typedef w4_float w_float;
-typedef w4_int w_int;
-#elif COLLISION_SIMD_WIDTH == 8 && defined(SIMD_AVX_2)
-typedef w8_float w_float;
-typedef w8_int w_int;
-#endif
-
-typedef wN_vec2<w_float> w_vec2;
-typedef wN_vec3<w_float> w_vec3;
-typedef wN_vec4<w_float> w_vec4;
-typedef wN_quat<w_float> w_quat;
-typedef wN_mat2<w_float> w_mat2;
-typedef wN_mat3<w_float> w_mat3;
-
-typedef wN_bounding_sphere<w_float> w_bounding_sphere;
-typedef wN_bounding_capsule<w_float> w_bounding_capsule;
-typedef wN_bounding_cylinder<w_float> w_bounding_cylinder;
-typedef wN_bounding_box<w_float> w_bounding_box;
-typedef wN_bounding_oriented_box<w_float> w_bounding_oriented_box;
-typedef wN_line_segment<w_float> w_line_segment;
-
-
-
+#include "core/job_system.h"
 
 struct contact_manifold
 {
@@ -45,12 +16,17 @@ struct contact_manifold
 	uint32 numContacts;
 };
 
-static bool intersection(const bounding_oriented_box& a, const bounding_oriented_box& b, contact_manifold& outContact);
+static bool intersection(const bounding_oriented_box& a, const bounding_oriented_box& b, contact_manifold& outContact, narrowphase_feature* feature = 0);
 
 struct vertex_penetration_pair
 {
 	vec3 vertex;
 	float penetrationDepth;
+
+	// Set by clipPointsAndBuildContact. The line of a polygon edge is the incident edge it lies on (0-15) or the side plane it was clipped
+	// along (16 + plane index), which names the points clipped from it.
+	uint32 feature;
+	uint32 edgeLine;
 };
 
 static void findStableContactManifold(vertex_penetration_pair* vertices, uint32 numVertices, vec3 normal, contact_manifold& outContact)
@@ -75,6 +51,7 @@ static void findStableContactManifold(vertex_penetration_pair* vertices, uint32
 
 		outContact.contacts[0].penetrationDepth = vertices[resultIndex].penetrationDepth;
 		outContact.contacts[0].point = vertices[resultIndex].vertex;
+		outContact.contacts[0].feature = vertices[resultIndex].feature;
 
 		// Find second point which is furthest away from first.
 		bestDistance = 0.f;
@@ -91,15 +68,17 @@ static void findStableContactManifold(vertex_penetration_pair* vertices, uint32
 
 		outContact.contacts[1].penetrationDepth = vertices[resultIndex].penetrationDepth;
 		outContact.contacts[1].point = vertices[resultIndex].vertex;
+		outContact.contacts[1].feature = vertices[resultIndex].feature;
 
-		// Find third point which maximizes the area of the resulting triangle.
+		// Find third point which maximizes the area of the resulting triangle. The first two points often span an edge of the polygon, so
+		// both sides are searched.
 		float bestArea = 0.f;
 		resultIndex = 0;
 		for (uint32 i = 0; i < numVertices; ++i)
 		{
 			vec3 qa = outContact.contacts[0].point - vertices[i].vertex;
 			vec3 qb = outContact.contacts[1].point - vertices[i].vertex;
-			float area = 0.5f * dot(cross(qa, qb), normal);
+			float area = abs(0.5f * dot(cross(qa, qb), normal));
 			if (area > bestArea)
 			{
 				resultIndex = i;
@@ -109,8 +88,12 @@ static void findStableContactManifold(vertex_penetration_pair* vertices, uint32
 
 		outContact.contacts[2].penetrationDepth = vertices[resultIndex].penetrationDepth;
 		outContact.contacts[2].point = vertices[resultIndex].vertex;
+		outContact.contacts[2].feature = vertices[resultIndex].feature;
+
+		// Find fourth point which adds the most area to the triangle. Points outside of an edge have the opposite winding of the triangle.
+		vec3 triangleNormal = cross(outContact.contacts[0].point - outContact.contacts[2].point, outContact.contacts[1].point - outContact.contacts[2].point);
+		float winding = (dot(triangleNormal, normal) < 0.f) ? 0.5f : -0.5f;
 
-		// Find fourth point.
 		bestArea = 0.f;
 		resultIndex = 0;
 		for (uint32 i = 0; i < numVertices; ++i)
@@ -118,9 +101,9 @@ static void findStableContactManifold(vertex_penetration_pair* vertices, uint32
 			vec3 qa = outContact.contacts[0].point - vertices[i].vertex;
 			vec3 qb = outContact.contacts[1].point - vertices[i].vertex;
 			vec3 qc = outContact.contacts[2].point - vertices[i].vertex;
-			float area1 = 0.5f * dot(cross(qa, qb), normal);
-			float area2 = 0.5f * dot(cross(qb, qc), normal);
-			float area3 = 0.5f * dot(cross(qc, qa), normal);
+			float area1 = winding * dot(cross(qa, qb), normal);
+			float area2 = winding * dot(cross(qb, qc), normal);
+			float area3 = winding * dot(cross(qc, qa), normal);
 			float area = max(max(area1, area2), area3);
 			if (area > bestArea)
 			{
@@ -131,6 +114,7 @@ static void findStableContactManifold(vertex_penetration_pair* vertices, uint32
 
 		outContact.contacts[3].penetrationDepth = vertices[resultIndex].penetrationDepth;
 		outContact.contacts[3].point = vertices[resultIndex].vertex;
+		outContact.contacts[3].feature = vertices[resultIndex].feature;
 
 		outContact.numContacts = 4;
 	}
@@ -141,6 +125,7 @@ static void findStableContactManifold(vertex_penetration_pair* vertices, uint32
 		{
 			outContact.contacts[i].penetrationDepth = vertices[i].penetrationDepth;
 			outContact.contacts[i].point = vertices[i].vertex;
+			outContact.contacts[i].feature = vertices[i].feature;
 		}
 	}
 }
@@ -162,6 +147,14 @@ static vertex_penetration_pair clipAgainstPlane(vertex_penetration_pair a, verte
 	return { lerp(a.vertex, b.vertex, t), lerp(a.penetrationDepth, b.penetrationDepth, t) };
 }
 
+#define CLIP_PLANE_LINE(plane) (16 + (plane))
+
+// Names the point, where a polygon edge on the given line crosses a clip plane.
+static uint32 getClippedFeature(uint32 edgeLine, uint32 clipPlane)
+{
+	return (edgeLine < CLIP_PLANE_LINE(0)) ? contactFeatureEdgePlane(edgeLine, clipPlane) : contactFeaturePlanePlane(edgeLine - CLIP_PLANE_LINE(0), clipPlane);
+}
+
 // Planes must point inside.
 static void sutherlandHodgmanClipping(clipping_polygon& input, const vec4* clipPlanes, uint32 numClipPlanes, clipping_polygon& output)
 {
@@ -195,11 +188,18 @@ static void sutherlandHodgmanClipping(clipping_polygon& input, const vec4* clipP
 			}
 			else if (startInside)
 			{
-				out->points[out->numPoints++] = clipAgainstPlane(startPoint, endPoint, startDist, endDist);
+				// Leaving the plane. The polygon continues along the plane up to where it enters again.
+				vertex_penetration_pair p = clipAgainstPlane(startPoint, endPoint, startDist, endDist);
+				p.feature = getClippedFeature(startPoint.edgeLine, clipIndex);
+				p.edgeLine = CLIP_PLANE_LINE(clipIndex);
+				out->points[out->numPoints++] = p;
 			}
 			else if (!startInside && endInside)
 			{
-				out->points[out->numPoints++] = clipAgainstPlane(startPoint, endPoint, startDist, endDist);
+				vertex_penetration_pair p = clipAgainstPlane(startPoint, endPoint, startDist, endDist);
+				p.feature = getClippedFeature(startPoint.edgeLine, clipIndex);
+				p.edgeLine = startPoint.edgeLine;
+				out->points[out->numPoints++] = p;
 				out->points[out->numPoints++] = endPoint;
 			}
 
@@ -253,7 +253,16 @@ static void getAABBClippingPlanes(vec3 aabbRadius, vec3 normal, vec3* clipPlaneP
 	}
 }
 
-// Returns points in AABB's local space. The caller must transform them to world space if needed.
+// Face of the AABB, which points along normal. Numbered as in contactFeature.
+static uint32 getAABBFace(vec3 normal)
+{
+	vec3 p = abs(normal);
+
+	uint32 maxElement = (p.x > p.y) ? ((p.x > p.z) ? 0 : 2) : ((p.y > p.z) ? 1 : 2);
+	return maxElement * 2 + (normal.data[maxElement] < 0.f);
+}
+
+// Returns points in AABB's local space. The caller must transform them to world space if needed. The incident face points against normal.
 static void getAABBIncidentVertices(vec3 aabbRadius, vec3 normal, clipping_polygon& polygon)
 {
 	vec3 p = abs(normal);
@@ -335,9 +344,16 @@ static void getAABBIncidentEdge(vec3 aabbRadius, vec3 normal, vec3& outA, vec3&
 	outB *= vec3(sx, sy, sz);
 }
 
-// Expects that normal and tangents are already set in contact.
-static bool clipPointsAndBuildContact(clipping_polygon& polygon, const vec4* clipPlanes, uint32 numClipPlanes, const vec4& referencePlane, contact_manifold& outContact)
+// Expects that normal and tangents are already set in contact. The faces name the contacts, see contactFeature.
+static bool clipPointsAndBuildContact(clipping_polygon& polygon, const vec4* clipPlanes, uint32 numClipPlanes, const vec4& referencePlane,
+	uint32 referenceFace, uint32 incidentFace, contact_manifold& outContact)
 {
+	for (uint32 i = 0; i < polygon.numPoints; ++i)
+	{
+		polygon.points[i].feature = contactFeatureVertex(i);
+		polygon.points[i].edgeLine = i;
+	}
+
 	clipping_polygon clippedPolygon;
 	sutherlandHodgmanClipping(polygon, clipPlanes, numClipPlanes, clippedPolygon);
 
@@ -361,6 +377,10 @@ static bool clipPointsAndBuildContact(clipping_polygon& polygon, const vec4* cli
 		if (clippedPolygon.numPoints > 0)
 		{
 			findStableContactManifold(clippedPolygon.points, clippedPolygon.numPoints, outContact.collisionNormal, outContact);
+			for (uint32 i = 0; i < outContact.numContacts; ++i)
+			{
+				outContact.contacts[i].feature = contactFeature(referenceFace, incidentFace, outContact.contacts[i].feature);
+			}
 			return true;
 		}
 	}
@@ -368,6 +388,50 @@ static bool clipPointsAndBuildContact(clipping_polygon& polygon, const vec4* cli
 	return false;
 }
 
+// The search starts along the axis found in the last frame. Pairs which are still separated by it exit after one support point, and touching
+// pairs start next to last frame's contact normal.
+template <typename support_a_t, typename support_b_t>
+static bool gjkEPAIntersection(const support_a_t& supportA, const support_b_t& supportB, contact_manifold& outContact, narrowphase_feature* feature)
+{
+	vec3 axis(-1.f, -0.1f, 0.2f); // Arbitrary.
+	if (feature && feature->type != narrowphase_feature_none)
+	{
+		axis = feature->axis;
+	}
+
+	gjk_simplex gjkSimplex;
+	if (!gjkIntersectionTest(supportA, supportB, gjkSimplex, axis))
+	{
+		if (feature)
+		{
+			feature->type = narrowphase_feature_separating_axis;
+			feature->axis = axis;
+		}
+		return false;
+	}
+
+	epa_result epa;
+	auto epaSuccess = epaCollisionInfo(gjkSimplex, supportA, supportB, epa);
+	if (epaSuccess != epa_success)
+	{
+		//return false;
+	}
+
+	// A failed EPA may not have a usable normal. Keep the old axis then, it's only a starting point anyway.
+	if (feature && squaredLength(epa.normal) > 1e-6f)
+	{
+		feature->type = narrowphase_feature_contact;
+		feature->axis = epa.normal;
+	}
+
+	outContact.collisionNormal = epa.normal;
+	outContact.numContacts = 1;
+	outContact.contacts[0].penetrationDepth = epa.penetrationDepth;
+	outContact.contacts[0].point = epa.point;
+
+	return true;
+}
+
 
 
 // Sphere tests.
@@ -442,7 +506,7 @@ static bool intersection(const bounding_sphere& s, const bounding_cylinder& c, c
 		outContact.numContacts = 1;
 		outContact.contacts[0].penetrationDepth = s.radius - distance;
 		ASSERT(outContact.contacts[0].penetrationDepth >= 0.f);
-		outContact.contacts[0].point = closestToSphere + 0.5f * outContact.contacts[0].penetrationDepth * normal;
+		outContact.contacts[0].point = closestToSphere + 0.5f * outContact.contacts[0].penetrationDepth * outContact.collisionNormal;
 		return true;
 	}
 	return false;
@@ -493,30 +557,12 @@ static bool intersection(const bounding_sphere& s, const bounding_oriented_box&
 	return false;
 }
 
-static bool intersection(const bounding_sphere& s, const bounding_hull& h, contact_manifold& outContact)
+static bool intersection(const bounding_sphere& s, const bounding_hull& h, contact_manifold& outContact, narrowphase_feature* feature = 0)
 {
 	sphere_support_fn sphereSupport{ s };
 	hull_support_fn hullSupport{ h };
 
-	gjk_simplex gjkSimplex;
-	if (!gjkIntersectionTest(sphereSupport, hullSupport, gjkSimplex))
-	{
-		return false;
-	}
-
-	epa_result epa;
-	auto epaSuccess = epaCollisionInfo(gjkSimplex, sphereSupport, hullSupport, epa);
-	if (epaSuccess != epa_success)
-	{
-		//return false;
-	}
-
-	outContact.collisionNormal = epa.normal;
-	outContact.numContacts = 1;
-	outContact.contacts[0].penetrationDepth = epa.penetrationDepth;
-	outContact.contacts[0].point = epa.point;
-
-	return true;
+	return gjkEPAIntersection(sphereSupport, hullSupport, outContact, feature);
 }
 
 // Capsule tests.
@@ -761,7 +807,7 @@ static bool intersection(const bounding_capsule& c, const bounding_box& a, conta
 				clipPlanes[i] = createPlane(clipPlanePoints[i], clipPlaneNormals[i]);
 			}
 
-			clipPointsAndBuildContact(polygon, clipPlanes, 4, referencePlane, outContact);
+			clipPointsAndBuildContact(polygon, clipPlanes, 4, referencePlane, getAABBFace(aabbNormal), 0, outContact);
 		}
 	}
 
@@ -789,32 +835,14 @@ static bool intersection(const bounding_capsule& c, const bounding_oriented_box&
 	return false;
 }
 
-static bool intersection(const bounding_capsule& c, const bounding_hull& h, contact_manifold& outContact)
+static bool intersection(const bounding_capsule& c, const bounding_hull& h, contact_manifold& outContact, narrowphase_feature* feature = 0)
 {
 	// TODO: Handle multiple-contact-points case.
 
 	capsule_support_fn capsuleSupport{ c };
 	hull_support_fn hullSupport{ h };
 
-	gjk_simplex gjkSimplex;
-	if (!gjkIntersectionTest(capsuleSupport, hullSupport, gjkSimplex))
-	{
-		return false;
-	}
-
-	epa_result epa;
-	auto epaSuccess = epaCollisionInfo(gjkSimplex, capsuleSupport, hullSupport, epa);
-	if (epaSuccess != epa_success)
-	{
-		//return false;
-	}
-
-	outContact.collisionNormal = epa.normal;
-	outContact.numContacts = 1;
-	outContact.contacts[0].penetrationDepth = epa.penetrationDepth;
-	outContact.contacts[0].point = epa.point;
-
-	return true;
+	return gjkEPAIntersection(capsuleSupport, hullSupport, outContact, feature);
 }
 
 // Cylinder tests.
@@ -1010,7 +1038,7 @@ static bool intersection(const bounding_cylinder& c, const bounding_box& a, cont
 				clipPlanes[i] = createPlane(clipPlanePoints[i], clipPlaneNormals[i]);
 			}
 
-			clipPointsAndBuildContact(polygon, clipPlanes, 4, referencePlane, outContact);
+			clipPointsAndBuildContact(polygon, clipPlanes, 4, referencePlane, getAABBFace(aabbNormal), 0, outContact);
 		}
 		else if (cosAngle > 0.99f)
 		{
@@ -1042,32 +1070,14 @@ static bool intersection(const bounding_cylinder& c, const bounding_oriented_box
 	return false;
 }
 
-static bool intersection(const bounding_cylinder& c, const bounding_hull& h, contact_manifold& outContact)
+static bool intersection(const bounding_cylinder& c, const bounding_hull& h, contact_manifold& outContact, narrowphase_feature* feature = 0)
 {
 	// TODO: Handle multiple-contact-points case.
 
 	cylinder_support_fn cylinderSupport{ c };
 	hull_support_fn hullSupport{ h };
 
-	gjk_simplex gjkSimplex;
-	if (!gjkIntersectionTest(cylinderSupport, hullSupport, gjkSimplex))
-	{
-		return false;
-	}
-
-	epa_result epa;
-	auto epaSuccess = epaCollisionInfo(gjkSimplex, cylinderSupport, hullSupport, epa);
-	if (epaSuccess != epa_success)
-	{
-		//return false;
-	}
-
-	outContact.collisionNormal = epa.normal;
-	outContact.numContacts = 1;
-	outContact.contacts[0].penetrationDepth = epa.penetrationDepth;
-	outContact.contacts[0].point = epa.point;
-
-	return true;
+	return gjkEPAIntersection(cylinderSupport, hullSupport, outContact, feature);
 }
 
 // AABB tests.
@@ -1090,7 +1100,7 @@ static bool intersection(const bounding_box& a, const bounding_box& b, contact_m
 	uint32 minElement = (p.x < p.y) ? ((p.x < p.z) ? 0 : 2) : ((p.y < p.z) ? 1 : 2);
 
 	float s = d.data[minElement] < 0.f ? -1.f : 1.f;
-	float penetration = p.data[minElement] * s;
+	float penetration = p.data[minElement];
 	vec3 normal(0.f);
 	normal.data[minElement] = s;
 
@@ -1105,7 +1115,8 @@ static bool intersection(const bounding_box& a, const bounding_box& b, contact_m
 	float max0 = min(a.maxCorner.data[axis0], b.maxCorner.data[axis0]);
 	float max1 = min(a.maxCorner.data[axis1], b.maxCorner.data[axis1]);
 
-	float depth = centerA.data[minElement] + radiusA.data[minElement] - penetration * 0.5f;
+	// Halfway into the overlap, on the side of a which faces b.
+	float depth = centerA.data[minElement] + s * (radiusA.data[minElement] - penetration * 0.5f);
 
 	outContact.contacts[0].penetrationDepth = penetration;
 	outContact.contacts[0].point = vec3(0.f);
@@ -1131,6 +1142,12 @@ static bool intersection(const bounding_box& a, const bounding_box& b, contact_m
 	outContact.contacts[3].point.data[axis1] = max1;
 	outContact.contacts[3].point.data[minElement] = depth;
 
+	// The contacts are the corners of the overlap on a's face.
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		outContact.contacts[i].feature = contactFeature(getAABBFace(normal), 0, contactFeatureVertex(i));
+	}
+
 	//debugSphere(outContact.contacts[0].point, 0.1f, { 0.f, 0.f, 1.f, 0.f });
 	//debugSphere(outContact.contacts[1].point, 0.1f, { 0.f, 0.f, 1.f, 0.f });
 	//debugSphere(outContact.contacts[2].point, 0.1f, { 0.f, 0.f, 1.f, 0.f });
@@ -1139,44 +1156,69 @@ static bool intersection(const bounding_box& a, const bounding_box& b, contact_m
 	return true;
 }
 
-static bool intersection(const bounding_box& a, const bounding_oriented_box& b, contact_manifold& outContact)
+static bool intersection(const bounding_box& a, const bounding_oriented_box& b, contact_manifold& outContact, narrowphase_feature* feature = 0)
 {
 	// We forward to the more general case OBB vs OBB here. This is not ideal, since this test then again transforms to a space local
 	// to one OOB.
 	// However, I don't expect this function to be called very often, as AABBs are uncommon, so this is probably fine.
-	return intersection(bounding_oriented_box{ quat::identity, a.getCenter(), a.getRadius() }, b, outContact);
+	return intersection(bounding_oriented_box{ quat::identity, a.getCenter(), a.getRadius() }, b, outContact, feature);
 }
 
-static bool intersection(const bounding_box& a, const bounding_hull& h, contact_manifold& outContact)
+static bool intersection(const bounding_box& a, const bounding_hull& h, contact_manifold& outContact, narrowphase_feature* feature = 0)
 {
 	// TODO: Handle multiple-contact-points case.
 
 	aabb_support_fn aabbSupport{ a };
 	hull_support_fn hullSupport{ h };
 
-	gjk_simplex gjkSimplex;
-	if (!gjkIntersectionTest(aabbSupport, hullSupport, gjkSimplex))
+	return gjkEPAIntersection(aabbSupport, hullSupport, outContact, feature);
+}
+
+// OBB tests.
+
+// Penetration along one of the 15 SAT axes, see narrowphase_feature::satAxis. Negative, if the axis separates the boxes. r is the rotation of b
+// in a's local space, t the position of b in a's local space, and the normal is in a's local space as well.
+static float obbAxisPenetration(uint32 axis, vec3 radiusA, vec3 radiusB, const mat3& r, const mat3& absR, vec3 t, vec3& outNormal)
+{
+	outNormal = vec3(0.f);
+
+	if (axis < 3)
 	{
-		return false;
+		outNormal.data[axis] = 1.f;
+		return radiusA.data[axis] + dot(row(absR, axis), radiusB) - abs(t.data[axis]);
+	}
+	if (axis < 6)
+	{
+		uint32 i = axis - 3;
+		outNormal = col(r, i);
+		return dot(col(absR, i), radiusA) + radiusB.data[i] - abs(dot(col(r, i), t));
 	}
 
-	epa_result epa;
-	auto epaSuccess = epaCollisionInfo(gjkSimplex, aabbSupport, hullSupport, epa);
-	if (epaSuccess != epa_success)
+	// a_i x b_j.
+	uint32 i = (axis - 6) / 3;
+	uint32 j = (axis - 6) % 3;
+	uint32 i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+	uint32 j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+
+	outNormal.data[i1] = -row(r, i2).data[j];
+	outNormal.data[i2] = row(r, i1).data[j];
+
+	float l = length(outNormal);
+	if (l < 1e-5f)
 	{
-		//return false;
+		// Parallel edges don't define an axis.
+		return FLT_MAX;
 	}
 
-	outContact.collisionNormal = epa.normal;
-	outContact.numContacts = 1;
-	outContact.contacts[0].penetrationDepth = epa.penetrationDepth;
-	outContact.contacts[0].point = epa.point;
+	float ra = radiusA.data[i1] * row(absR, i2).data[j] + radiusA.data[i2] * row(absR, i1).data[j];
+	float rb = radiusB.data[j1] * row(absR, i).data[j2] + radiusB.data[j2] * row(absR, i).data[j1];
+	float d = t.data[i2] * row(r, i1).data[j] - t.data[i1] * row(r, i2).data[j];
 
-	return true;
+	outNormal /= l;
+	return (ra + rb - abs(d)) / l;
 }
 
-// OBB tests.
-static bool intersection(const bounding_oriented_box& a, const bounding_oriented_box& b, contact_manifold& outContact)
+static bool intersection(const bounding_oriented_box& a, const bounding_oriented_box& b, contact_manifold& outContact, narrowphase_feature* feature)
 {
 	union obb_axes
 	{
@@ -1225,190 +1267,237 @@ static bool intersection(const bounding_oriented_box& a, const bounding_oriented
 		}
 	}
 
+	auto separated = [feature](uint32 axis)
+	{
+		if (feature)
+		{
+			feature->type = narrowphase_feature_separating_axis;
+			feature->satAxis = (uint8)axis;
+		}
+		return false;
+	};
+
+	quat relativeRotation = conjugate(a.rotation) * b.rotation;
+
 	float ra, rb;
 
 	float minPenetration = FLT_MAX;
 	vec3 normal;
 	bool bFace = false;
+	uint32 minAxis = 0;
 
+	bool edgeCollision = false;
+	vec3 edgeNormal;
 
-	// Test a's faces.
-	for (uint32 i = 0; i < 3; ++i)
+	// Test last frame's axis first. If it was the reference face of a contact and the boxes have barely moved relative to each other since,
+	// the SAT would find the same face again.
+	// Edge axes are skipped for (nearly) parallel boxes, just like below.
+	bool reuseCachedFace = false;
+	if (feature && feature->type != narrowphase_feature_none && (feature->satAxis < 6 || !parallel))
 	{
-		ra = a.radius.data[i];
-		rb = dot(row(absR, i), b.radius);
-		float d = t.data[i];
-		float penetration = ra + rb - abs(d);
-		if (penetration < 0.f) { return false; }
-		if (penetration < minPenetration)
-		{
-			minPenetration = penetration;
-			normal = vec3(0.f); normal.data[i] = 1.f;
-		}
-	}
+		vec3 cachedNormal;
+		float penetration = obbAxisPenetration(feature->satAxis, a.radius, b.radius, r, absR, t, cachedNormal);
+		if (penetration < 0.f) { return separated(feature->satAxis); }
 
-	// Test b's faces.
-	for (uint32 i = 0; i < 3; ++i)
-	{
-		ra = dot(col(absR, i), a.radius);
-		rb = b.radius.data[i];
-		float d = dot(col(r, i), t);
-		float penetration = ra + rb - abs(d);
-		if (penetration < 0.f) { return false; }
-		if (penetration < minPenetration)
+		reuseCachedFace = canReuseCachedFace(*feature, relativeRotation, t);
+
+		if (reuseCachedFace)
 		{
 			minPenetration = penetration;
-			normal = vec3(0.f); normal.data[i] = 1.f;
-			bFace = true;
+			minAxis = feature->satAxis;
+			bFace = minAxis >= 3;
+			normal = vec3(0.f); normal.data[minAxis % 3] = 1.f;
 		}
 	}
 
-	bool edgeCollision = false;
-	vec3 edgeNormal;
 
-	if (!parallel)
+	if (!reuseCachedFace)
 	{
-		float penetration;
-		vec3 normal;
-		float l;
-
-		// Test a.x x b.x.
-		ra = a.radius.y * absR.m20 + a.radius.z * absR.m10;
-		rb = b.radius.y * absR.m02 + b.radius.z * absR.m01;
-		penetration = ra + rb - abs(t.z * r.m10 - t.y * r.m20);
-		if (penetration < 0.f) { return false; }
-		normal = vec3(0.f, -r.m20, r.m10);
-		l = 1.f / length(normal);
-		penetration *= l;
-		if (penetration < minPenetration)
+		// Test a's faces.
+		for (uint32 i = 0; i < 3; ++i)
 		{
-			minPenetration = penetration;
-			edgeNormal = normal * l;
-			edgeCollision = true;
+			ra = a.radius.data[i];
+			rb = dot(row(absR, i), b.radius);
+			float d = t.data[i];
+			float penetration = ra + rb - abs(d);
+			if (penetration < 0.f) { return separated(i); }
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				normal = vec3(0.f); normal.data[i] = 1.f;
+				minAxis = i;
+			}
 		}
 
-		// Test a.x x b.y.
-		ra = a.radius.y * absR.m21 + a.radius.z * absR.m11;
-		rb = b.radius.x * absR.m02 + b.radius.z * absR.m00;
-		penetration = ra + rb - abs(t.z * r.m11 - t.y * r.m21);
-		if (penetration < 0.f) { return false; }
-		normal = vec3(0.f, -r.m21, r.m11);
-		l = 1.f / length(normal);
-		penetration *= l;
-		if (penetration < minPenetration)
+		// Test b's faces.
+		for (uint32 i = 0; i < 3; ++i)
 		{
-			minPenetration = penetration;
-			edgeNormal = normal * l;
-			edgeCollision = true;
+			ra = dot(col(absR, i), a.radius);
+			rb = b.radius.data[i];
+			float d = dot(col(r, i), t);
+			float penetration = ra + rb - abs(d);
+			if (penetration < 0.f) { return separated(3 + i); }
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				normal = vec3(0.f); normal.data[i] = 1.f;
+				bFace = true;
+				minAxis = 3 + i;
+			}
 		}
 
-		// Test a.x x b.z.
-		ra = a.radius.y * absR.m22 + a.radius.z * absR.m12;
-		rb = b.radius.x * absR.m01 + b.radius.y * absR.m00;
-		penetration = ra + rb - abs(t.z * r.m12 - t.y * r.m22);
-		if (penetration < 0.f) { return false; }
-		normal = vec3(0.f, -r.m22, r.m12);
-		l = 1.f / length(normal);
-		penetration *= l;
-		if (penetration < minPenetration)
+		if (!parallel)
 		{
-			minPenetration = penetration;
-			edgeNormal = normal * l;
-			edgeCollision = true;
-		}
+			float penetration;
+			vec3 normal;
+			float l;
 
-		// Test a.y x b.x.
-		ra = a.radius.x * absR.m20 + a.radius.z * absR.m00;
-		rb = b.radius.y * absR.m12 + b.radius.z * absR.m11;
-		penetration = ra + rb - abs(t.x * r.m20 - t.z * r.m00);
-		if (penetration < 0.f) { return false; }
-		normal = vec3(r.m20, 0.f, -r.m00);
-		l = 1.f / length(normal);
-		penetration *= l;
-		if (penetration < minPenetration)
-		{
-			minPenetration = penetration;
-			edgeNormal = normal * l;
-			edgeCollision = true;
-		}
+			// Test a.x x b.x.
+			ra = a.radius.y * absR.m20 + a.radius.z * absR.m10;
+			rb = b.radius.y * absR.m02 + b.radius.z * absR.m01;
+			penetration = ra + rb - abs(t.z * r.m10 - t.y * r.m20);
+			if (penetration < 0.f) { return separated(6); }
+			normal = vec3(0.f, -r.m20, r.m10);
+			l = 1.f / length(normal);
+			penetration *= l;
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				edgeNormal = normal * l;
+				edgeCollision = true;
+				minAxis = 6;
+			}
 
-		// Test a.y x b.y.
-		ra = a.radius.x * absR.m21 + a.radius.z * absR.m01;
-		rb = b.radius.x * absR.m12 + b.radius.z * absR.m10;
-		penetration = ra + rb - abs(t.x * r.m21 - t.z * r.m01);
-		if (penetration < 0.f) { return false; }
-		normal = vec3(r.m21, 0.f, -r.m01);
-		l = 1.f / length(normal);
-		penetration *= l;
-		if (penetration < minPenetration)
-		{
-			minPenetration = penetration;
-			edgeNormal = normal * l;
-			edgeCollision = true;
-		}
+			// Test a.x x b.y.
+			ra = a.radius.y * absR.m21 + a.radius.z * absR.m11;
+			rb = b.radius.x * absR.m02 + b.radius.z * absR.m00;
+			penetration = ra + rb - abs(t.z * r.m11 - t.y * r.m21);
+			if (penetration < 0.f) { return separated(7); }
+			normal = vec3(0.f, -r.m21, r.m11);
+			l = 1.f / length(normal);
+			penetration *= l;
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				edgeNormal = normal * l;
+				edgeCollision = true;
+				minAxis = 7;
+			}
 
-		// Test a.y x b.z.
-		ra = a.radius.x * absR.m22 + a.radius.z * absR.m02;
-		rb = b.radius.x * absR.m11 + b.radius.y * absR.m10;
-		penetration = ra + rb - abs(t.x * r.m22 - t.z * r.m02);
-		if (penetration < 0.f) { return false; }
-		normal = vec3(r.m22, 0.f, -r.m02);
-		l = 1.f / length(normal);
-		penetration *= l;
-		if (penetration < minPenetration)
-		{
-			minPenetration = penetration;
-			edgeNormal = normal * l;
-			edgeCollision = true;
-		}
+			// Test a.x x b.z.
+			ra = a.radius.y * absR.m22 + a.radius.z * absR.m12;
+			rb = b.radius.x * absR.m01 + b.radius.y * absR.m00;
+			penetration = ra + rb - abs(t.z * r.m12 - t.y * r.m22);
+			if (penetration < 0.f) { return separated(8); }
+			normal = vec3(0.f, -r.m22, r.m12);
+			l = 1.f / length(normal);
+			penetration *= l;
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				edgeNormal = normal * l;
+				edgeCollision = true;
+				minAxis = 8;
+			}
 
-		// Test a.z x b.x.
-		ra = a.radius.x * absR.m10 + a.radius.y * absR.m00;
-		rb = b.radius.y * absR.m22 + b.radius.z * absR.m21;
-		penetration = ra + rb - abs(t.y * r.m00 - t.x * r.m10);
-		if (penetration < 0.f) { return false; }
-		normal = vec3(-r.m10, r.m00, 0.f);
-		l = 1.f / length(normal);
-		penetration *= l;
-		if (penetration < minPenetration)
-		{
-			minPenetration = penetration;
-			edgeNormal = normal * l;
-			edgeCollision = true;
-		}
+			// Test a.y x b.x.
+			ra = a.radius.x * absR.m20 + a.radius.z * absR.m00;
+			rb = b.radius.y * absR.m12 + b.radius.z * absR.m11;
+			penetration = ra + rb - abs(t.x * r.m20 - t.z * r.m00);
+			if (penetration < 0.f) { return separated(9); }
+			normal = vec3(r.m20, 0.f, -r.m00);
+			l = 1.f / length(normal);
+			penetration *= l;
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				edgeNormal = normal * l;
+				edgeCollision = true;
+				minAxis = 9;
+			}
 
-		// Test a.z x b.y.
-		ra = a.radius.x * absR.m11 + a.radius.y * absR.m01;
-		rb = b.radius.x * absR.m22 + b.radius.z * absR.m20;
-		penetration = ra + rb - abs(t.y * r.m01 - t.x * r.m11);
-		if (penetration < 0.f) { return false; }
-		normal = vec3(-r.m11, r.m01, 0.f);
-		l = 1.f / length(normal);
-		penetration *= l;
-		if (penetration < minPenetration)
-		{
-			minPenetration = penetration;
-			edgeNormal = normal * l;
-			edgeCollision = true;
-		}
+			// Test a.y x b.y.
+			ra = a.radius.x * absR.m21 + a.radius.z * absR.m01;
+			rb = b.radius.x * absR.m12 + b.radius.z * absR.m10;
+			penetration = ra + rb - abs(t.x * r.m21 - t.z * r.m01);
+			if (penetration < 0.f) { return separated(10); }
+			normal = vec3(r.m21, 0.f, -r.m01);
+			l = 1.f / length(normal);
+			penetration *= l;
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				edgeNormal = normal * l;
+				edgeCollision = true;
+				minAxis = 10;
+			}
 
-		// Test a.z x b.z.
-		ra = a.radius.x * absR.m12 + a.radius.y * absR.m02;
-		rb = b.radius.x * absR.m21 + b.radius.y * absR.m20;
-		penetration = ra + rb - abs(t.y * r.m02 - t.x * r.m12);
-		if (penetration < 0.f) { return false; }
-		normal = vec3(-r.m12, r.m02, 0.f);
-		l = 1.f / length(normal);
-		penetration *= l;
-		if (penetration < minPenetration)
-		{
-			minPenetration = penetration;
-			edgeNormal = normal * l;
-			edgeCollision = true;
+			// Test a.y x b.z.
+			ra = a.radius.x * absR.m22 + a.radius.z * absR.m02;
+			rb = b.radius.x * absR.m11 + b.radius.y * absR.m10;
+			penetration = ra + rb - abs(t.x * r.m22 - t.z * r.m02);
+			if (penetration < 0.f) { return separated(11); }
+			normal = vec3(r.m22, 0.f, -r.m02);
+			l = 1.f / length(normal);
+			penetration *= l;
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				edgeNormal = normal * l;
+				edgeCollision = true;
+				minAxis = 11;
+			}
+
+			// Test a.z x b.x.
+			ra = a.radius.x * absR.m10 + a.radius.y * absR.m00;
+			rb = b.radius.y * absR.m22 + b.radius.z * absR.m21;
+			penetration = ra + rb - abs(t.y * r.m00 - t.x * r.m10);
+			if (penetration < 0.f) { return separated(12); }
+			normal = vec3(-r.m10, r.m00, 0.f);
+			l = 1.f / length(normal);
+			penetration *= l;
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				edgeNormal = normal * l;
+				edgeCollision = true;
+				minAxis = 12;
+			}
+
+			// Test a.z x b.y.
+			ra = a.radius.x * absR.m11 + a.radius.y * absR.m01;
+			rb = b.radius.x * absR.m22 + b.radius.z * absR.m20;
+			penetration = ra + rb - abs(t.y * r.m01 - t.x * r.m11);
+			if (penetration < 0.f) { return separated(13); }
+			normal = vec3(-r.m11, r.m01, 0.f);
+			l = 1.f / length(normal);
+			penetration *= l;
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				edgeNormal = normal * l;
+				edgeCollision = true;
+				minAxis = 13;
+			}
+
+			// Test a.z x b.z.
+			ra = a.radius.x * absR.m12 + a.radius.y * absR.m02;
+			rb = b.radius.x * absR.m21 + b.radius.y * absR.m20;
+			penetration = ra + rb - abs(t.y * r.m02 - t.x * r.m12);
+			if (penetration < 0.f) { return separated(14); }
+			normal = vec3(-r.m12, r.m02, 0.f);
+			l = 1.f / length(normal);
+			penetration *= l;
+			if (penetration < minPenetration)
+			{
+				minPenetration = penetration;
+				edgeNormal = normal * l;
+				edgeCollision = true;
+				minAxis = 14;
+			}
 		}
 	}
 
-
 	bool faceCollision = !edgeCollision;
 	if (faceCollision)
 	{
@@ -1433,6 +1522,14 @@ static bool intersection(const bounding_oriented_box& a, const bounding_oriented
 
 	// Normal is now in world space and points from a to b.
 
+	if (feature)
+	{
+		feature->type = narrowphase_feature_contact;
+		feature->satAxis = (uint8)minAxis;
+		feature->relativeRotation = relativeRotation;
+		feature->relativePosition = t;
+	}
+
 	outContact.collisionNormal = normal;
 
 	if (faceCollision)
@@ -1443,13 +1540,19 @@ static bool intersection(const bounding_oriented_box& a, const bounding_oriented
 		clipping_polygon polygon;
 
 		vec4 plane;
+		uint32 referenceFace, incidentFace;
 
 		if (!bFace)
 		{
 			// A's face -> A is reference and B is incidence.
 
-			getAABBClippingPlanes(a.radius, conjugate(a.rotation) * normal, clipPlanePoints, clipPlaneNormals);
-			getAABBIncidentVertices(b.radius, conjugate(b.rotation) * normal, polygon);
+			vec3 referenceNormal = conjugate(a.rotation) * normal;
+			vec3 incidentNormal = conjugate(b.rotation) * normal;
+			referenceFace = getAABBFace(referenceNormal);
+			incidentFace = getAABBFace(-incidentNormal);
+
+			getAABBClippingPlanes(a.radius, referenceNormal, clipPlanePoints, clipPlaneNormals);
+			getAABBIncidentVertices(b.radius, incidentNormal, polygon);
 
 			for (uint32 i = 0; i < 4; ++i)
 			{
@@ -1466,8 +1569,13 @@ static bool intersection(const bounding_oriented_box& a, const bounding_oriented
 		{
 			// B's face -> B is reference and A is incidence.
 
-			getAABBClippingPlanes(b.radius, conjugate(b.rotation) * -normal, clipPlanePoints, clipPlaneNormals);
-			getAABBIncidentVertices(a.radius, conjugate(a.rotation) * -normal, polygon);
+			vec3 referenceNormal = conjugate(b.rotation) * -normal;
+			vec3 incidentNormal = conjugate(a.rotation) * -normal;
+			referenceFace = 6 + getAABBFace(referenceNormal);
+			incidentFace = getAABBFace(-incidentNormal);
+
+			getAABBClippingPlanes(b.radius, referenceNormal, clipPlanePoints, clipPlaneNormals);
+			getAABBIncidentVertices(a.radius, incidentNormal, polygon);
 
 			for (uint32 i = 0; i < 4; ++i)
 			{
@@ -1488,7 +1596,7 @@ static bool intersection(const bounding_oriented_box& a, const bounding_oriented
 			polygon.points[i].penetrationDepth = -signedDistanceToPlane(polygon.points[i].vertex, plane);
 		}
 
-		if (!clipPointsAndBuildContact(polygon, clipPlanes, 4, plane, outContact))
+		if (!clipPointsAndBuildContact(polygon, clipPlanes, 4, plane, referenceFace, incidentFace, outContact))
 		{
 			return false;
 		}
@@ -1515,6 +1623,7 @@ static bool intersection(const bounding_oriented_box& a, const bounding_oriented
 		outContact.numContacts = 1;
 		outContact.contacts[0].penetrationDepth = sqrt(sqDistance);
 		outContact.contacts[0].point = (pa + pb) * 0.5f;
+		outContact.contacts[0].feature = contactFeatureEdgeEdge(minAxis);
 	}
 
 
@@ -1526,61 +1635,25 @@ static bool intersection(const bounding_oriented_box& a, const bounding_oriented
 	return true;
 }
 
-static bool intersection(const bounding_oriented_box& o, const bounding_hull& h, contact_manifold& outContact)
+static bool intersection(const bounding_oriented_box& o, const bounding_hull& h, contact_manifold& outContact, narrowphase_feature* feature = 0)
 {
 	// TODO: Handle multiple-contact-points case.
 
 	obb_support_fn obbSupport{ o };
 	hull_support_fn hullSupport{ h };
 
-	gjk_simplex gjkSimplex;
-	if (!gjkIntersectionTest(obbSupport, hullSupport, gjkSimplex))
-	{
-		return false;
-	}
-
-	epa_result epa;
-	auto epaSuccess = epaCollisionInfo(gjkSimplex, obbSupport, hullSupport, epa);
-	if (epaSuccess != epa_success)
-	{
-		//return false;
-	}
-
-	outContact.collisionNormal = epa.normal;
-	outContact.numContacts = 1;
-	outContact.contacts[0].penetrationDepth = epa.penetrationDepth;
-	outContact.contacts[0].point = epa.point;
-
-	return true;
+	return gjkEPAIntersection(obbSupport, hullSupport, outContact, feature);
 }
 
 // Hull tests.
-static bool intersection(const bounding_hull& a, const bounding_hull& b, contact_manifold& outContact)
+static bool intersection(const bounding_hull& a, const bounding_hull& b, contact_manifold& outContact, narrowphase_feature* feature = 0)
 {
 	// TODO: Handle multiple-contact-points case.
 
 	hull_support_fn hullSupport1{ a };
 	hull_support_fn hullSupport2{ b };
 
-	gjk_simplex gjkSimplex;
-	if (!gjkIntersectionTest(hullSupport1, hullSupport2, gjkSimplex))
-	{
-		return false;
-	}
-
-	epa_result epa;
-	auto epaSuccess = epaCollisionInfo(gjkSimplex, hullSupport1, hullSupport2, epa);
-	if (epaSuccess != epa_success)
-	{
-		//return false;
-	}
-
-	outContact.collisionNormal = epa.normal;
-	outContact.numContacts = 1;
-	outContact.contacts[0].penetrationDepth = epa.penetrationDepth;
-	outContact.contacts[0].point = epa.point;
-
-	return true;
+	return gjkEPAIntersection(hullSupport1, hullSupport2, outContact, feature);
 }
 
 
@@ -1697,69 +1770,6 @@ static bool overlapCheck(const collider_union* worldSpaceColliders, collider_pai
 
 
 
-template <typename collider_t>
-static collider_t loadBoundingVolumeSIMD(const collider_union* worldSpaceColliders, uint16* indices) { static_assert(false); }
-
-template <>
-static w_bounding_sphere loadBoundingVolumeSIMD<w_bounding_sphere>(const collider_union* worldSpaceColliders, uint16* indices)
-{
-	w_bounding_sphere result;
-	load4((float*)&worldSpaceColliders->sphere, indices, sizeof(collider_union),
-		result.center.x, result.center.y, result.center.z, result.radius);
-	return result;
-}
-
-template <>
-static w_bounding_capsule loadBoundingVolumeSIMD<w_bounding_capsule>(const collider_union* worldSpaceColliders, uint16* indices)
-{
-	w_bounding_capsule result;
-	w_float dummy;
-	load8((float*)&worldSpaceColliders->capsule, indices, sizeof(collider_union),
-		result.positionA.x, result.positionA.y, result.positionA.z,
-		result.positionB.x, result.positionB.y, result.positionB.z,
-		result.radius, dummy);
-	return result;
-}
-
-template <>
-static w_bounding_cylinder loadBoundingVolumeSIMD<w_bounding_cylinder>(const collider_union* worldSpaceColliders, uint16* indices)
-{
-	w_bounding_cylinder result;
-	w_float dummy;
-	load8((float*)&worldSpaceColliders->cylinder, indices, sizeof(collider_union),
-		result.positionA.x, result.positionA.y, result.positionA.z,
-		result.positionB.x, result.positionB.y, result.positionB.z,
-		result.radius, dummy);
-	return result;
-}
-
-template <>
-static w_bounding_box loadBoundingVolumeSIMD<w_bounding_box>(const collider_union* worldSpaceColliders, uint16* indices)
-{
-	w_bounding_box result;
-	w_float dummy0, dummy1;
-	load8((float*)&worldSpaceColliders->aabb, indices, sizeof(collider_union),
-		result.minCorner.x, result.minCorner.y, result.minCorner.z,
-		result.maxCorner.x, result.maxCorner.y, result.maxCorner.z,
-		dummy0, dummy1);
-	return result;
-}
-
-template <>
-static w_bounding_oriented_box loadBoundingVolumeSIMD<w_bounding_oriented_box>(const collider_union* worldSpaceColliders, uint16* indices)
-{
-	w_bounding_oriented_box result;
-	w_float dummy0, dummy1;
-	load8(&worldSpaceColliders->obb.rotation.x, indices, sizeof(collider_union),
-		result.rotation.x, result.rotation.y, result.rotation.z, result.rotation.w,
-		result.center.x, result.center.y, result.center.z,
-		result.radius.x);
-	load4(&worldSpaceColliders->obb.radius.y, indices, sizeof(collider_union),
-		result.radius.y, result.radius.z,
-		dummy0, dummy1);
-	return result;
-}
-
 template <typename collider_t> static const collider_t& loadBoundingVolumeScalar(const collider_union* worldSpaceColliders, uint32 index) { static_assert(false); }
 template <> static const bounding_sphere& loadBoundingVolumeScalar<bounding_sphere>(const collider_union* worldSpaceColliders, uint32 index) { return worldSpaceColliders[index].sphere; }
 template <> static const bounding_capsule& loadBoundingVolumeScalar<bounding_capsule>(const collider_union* worldSpaceColliders, uint32 index) { return worldSpaceColliders[index].capsule; }
@@ -1769,567 +1779,505 @@ template <> static const bounding_oriented_box& loadBoundingVolumeScalar<boundin
 template <> static const bounding_hull& loadBoundingVolumeScalar<bounding_hull>(const collider_union* worldSpaceColliders, uint32 index) { return worldSpaceColliders[index].hull; }
 
 
-struct w_collision_contact
+static void writeScalarContact(const collider_union* worldSpaceColliders, const contact_manifold& contact,
+	physics_index aIndex, physics_index bIndex,
+	collision_write_context& writeContext)
 {
-	w_vec3 point;
-	w_float penetrationDepth;
-	w_vec3 normal;
-	uint32 mask;
-};
+	const collider_union* colliderA = worldSpaceColliders + aIndex;
+	const collider_union* colliderB = worldSpaceColliders + bIndex;
 
+	physics_index rbA = colliderA->objectIndex;
+	physics_index rbB = colliderB->objectIndex;
 
-// Sphere tests.
-static uint32 intersectionSIMD(const w_bounding_sphere& s1, const w_bounding_sphere& s2, w_collision_contact* outContacts)
-{
-	w_vec3 n = s2.center - s1.center;
-	w_float radiusSum = s2.radius + s1.radius;
-	w_float sqDistance = squaredLength(n);
+	physics_material propsA = colliderA->material;
+	physics_material propsB = colliderB->material;
 
-	auto intersects = (sqDistance <= radiusSum * radiusSum);
-	
-	uint32 mask = toBitMask(intersects);
+	float friction = clamp01(sqrt(propsA.friction * propsB.friction));
+	float restitution = clamp01(max(propsA.restitution, propsB.restitution));
 
-	if (anyTrue(mask))
-	{
-		auto degenerate = (sqDistance == 0.f);
-		w_float distance = ifThen(degenerate, 0.f, sqrt(sqDistance));
-		w_vec3 collisionNormal = ifThen(degenerate, w_vec3(0.f, 1.f, 0.f), n / distance);
+	uint32 friction_restitution = ((uint32)(friction * 0xFFFF) << 16) | (uint32)(restitution * 0xFFFF);
 
-		w_float penetrationDepth = radiusSum - distance; // Flipped to change sign.
-		w_vec3 point = w_float(0.5f) * (s1.center + s1.radius * collisionNormal + s2.center - s2.radius * collisionNormal);
+	writeContext.pushCollision(aIndex, bIndex, contact.numContacts);
+
+	for (uint32 contactIndex = 0; contactIndex < contact.numContacts; ++contactIndex)
+	{
+		auto& [outContact, outBodyPair] = writeContext.pushContact(contact.contacts[contactIndex].feature);
 
-		outContacts[0].point = point;
-		outContacts[0].penetrationDepth = penetrationDepth;
-		outContacts[0].normal = collisionNormal;
-		outContacts[0].mask = mask;
+		outContact.normal = contact.collisionNormal;
+		outContact.penetrationDepth = contact.contacts[contactIndex].penetrationDepth;
+		outContact.point = contact.contacts[contactIndex].point;
+		outContact.friction_restitution = friction_restitution;
 
-		return 1;
+		outBodyPair.rbA = rbA;
+		outBodyPair.rbB = rbB;
 	}
-
-	return 0;
 }
 
-static uint32 intersectionSIMD(const w_bounding_sphere& s, const w_bounding_capsule& c, w_collision_contact* outContacts)
-{
-	w_vec3 closestPoint = closestPoint_PointSegment(s.center, w_line_segment{ c.positionA, c.positionB });
-	return intersectionSIMD(s, w_bounding_sphere{ closestPoint, c.radius }, outContacts);
-}
+// Pairs tested with the SAT (OBBs) or GJK (hulls), which start with the feature found in the last frame.
+template <typename collider_a, typename collider_b>
+static constexpr bool usesFeatureCache = std::is_same_v<collider_b, bounding_hull>
+	|| (std::is_same_v<collider_b, bounding_oriented_box> && (std::is_same_v<collider_a, bounding_box> || std::is_same_v<collider_a, bounding_oriented_box>));
 
-static uint32 intersectionSIMD(const w_bounding_sphere& s, const w_bounding_cylinder& c, w_collision_contact* outContacts)
+template <typename collider_a, typename collider_b>
+static void collisionScalar(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
+	collision_write_context& writeContext)
 {
-	w_vec3 ab = c.positionB - c.positionA;
-	w_float t = dot(s.center - c.positionA, ab) / squaredLength(ab);
+	for (uint32 i = 0; i < numColliderPairs; ++i)
+	{
+		collider_pair pair = colliderPairs[i];
 
-	auto tSaturated = t >= 0.f & t <= 1.f;
+		const collider_a& bvA = loadBoundingVolumeScalar<collider_a>(worldSpaceColliders, pair.colliderA);
+		const collider_b& bvB = loadBoundingVolumeScalar<collider_b>(worldSpaceColliders, pair.colliderB);
 
-	int32 tSaturatedMask = toBitMask(tSaturated);
+		contact_manifold contact;
 
-	uint32 sphereSphereTest = 0;
-	if (anyTrue(tSaturatedMask))
-	{
-		sphereSphereTest = intersectionSIMD(s, w_bounding_sphere{ lerp(c.positionA, c.positionB, t), c.radius }, outContacts);
+		bool intersects;
+		if constexpr (usesFeatureCache<collider_a, collider_b>)
+		{
+			narrowphase_feature feature = writeContext.getCachedFeature(pair);
+			intersects = intersection(bvA, bvB, contact, &feature);
+			writeContext.pushFeature(pair, feature);
+		}
+		else
+		{
+			intersects = intersection(bvA, bvB, contact);
+		}
 
-		if (allTrue(tSaturated))
+		if (intersects)
 		{
-			return sphereSphereTest;
+			writeScalarContact(worldSpaceColliders, contact, pair.colliderA, pair.colliderB, writeContext);
 		}
 	}
+}
 
-
-
-	w_vec3 p = ifThen(t <= 0.f, c.positionA, c.positionB);
-	w_vec3 up = ifThen(t <= 0.f, -ab, ab);
-
-	w_vec3 projectedDirToCenter = normalize(cross(cross(up, s.center - p), up));
-	w_vec3 endA = p + projectedDirToCenter * c.radius;
-	w_vec3 endB = p - projectedDirToCenter * c.radius;
-
-	w_vec3 closestToSphere = closestPoint_PointSegment(s.center, w_line_segment{ endA, endB });
-	w_vec3 normal = closestToSphere - s.center; // From sphere to cylinder.
-	w_float sqDistance = squaredLength(normal);
-
-	auto intersects = (sqDistance <= s.radius * s.radius);
-
-	uint32 mask = toBitMask(intersects);
-
-	if (mask)
+// Pairs are sorted by type, so a.type <= b.type.
+static bool dispatchIntersection(const collider_union& a, const collider_union& b, contact_manifold& outContact)
+{
+	switch (a.type)
 	{
-		auto degenerate = sqDistance == 0.f;
-
-		w_float distance = ifThen(degenerate, 0.f, sqrt(sqDistance));
-		normal = ifThen(degenerate, -normalize(up), normal / distance);
-		
-		w_float penetrationDepth = s.radius - distance;
-		w_vec3 point = closestToSphere + 0.5f * penetrationDepth * normal;
-
-		if (anyTrue(tSaturatedMask))
+		case collider_type_sphere:
 		{
-			point = ifThen(tSaturated, outContacts[0].point, point);
-			penetrationDepth = ifThen(tSaturated, outContacts[0].penetrationDepth, penetrationDepth);
-			normal = ifThen(tSaturated, outContacts[0].normal, normal);
-
-			mask |= tSaturatedMask;
-		}
-
-		outContacts[0].point = point;
-		outContacts[0].penetrationDepth = penetrationDepth;
-		outContacts[0].normal = normal;
-		outContacts[0].mask = mask;
-		
-		return 1;
+			switch (b.type)
+			{
+				case collider_type_sphere: return intersection(a.sphere, b.sphere, outContact);
+				case collider_type_capsule: return intersection(a.sphere, b.capsule, outContact);
+				case collider_type_cylinder: return intersection(a.sphere, b.cylinder, outContact);
+				case collider_type_aabb: return intersection(a.sphere, b.aabb, outContact);
+				case collider_type_obb: return intersection(a.sphere, b.obb, outContact);
+				case collider_type_hull: return intersection(a.sphere, b.hull, outContact);
+			}
+		} break;
+		case collider_type_capsule:
+		{
+			switch (b.type)
+			{
+				case collider_type_capsule: return intersection(a.capsule, b.capsule, outContact);
+				case collider_type_cylinder: return intersection(a.capsule, b.cylinder, outContact);
+				case collider_type_aabb: return intersection(a.capsule, b.aabb, outContact);
+				case collider_type_obb: return intersection(a.capsule, b.obb, outContact);
+				case collider_type_hull: return intersection(a.capsule, b.hull, outContact);
+			}
+		} break;
+		case collider_type_cylinder:
+		{
+			switch (b.type)
+			{
+				case collider_type_cylinder: return intersection(a.cylinder, b.cylinder, outContact);
+				case collider_type_aabb: return intersection(a.cylinder, b.aabb, outContact);
+				case collider_type_obb: return intersection(a.cylinder, b.obb, outContact);
+				case collider_type_hull: return intersection(a.cylinder, b.hull, outContact);
+			}
+		} break;
+		case collider_type_aabb:
+		{
+			switch (b.type)
+			{
+				case collider_type_aabb: return intersection(a.aabb, b.aabb, outContact);
+				case collider_type_obb: return intersection(a.aabb, b.obb, outContact);
+				case collider_type_hull: return intersection(a.aabb, b.hull, outContact);
+			}
+		} break;
+		case collider_type_obb:
+		{
+			switch (b.type)
+			{
+				case collider_type_obb: return intersection(a.obb, b.obb, outContact);
+				case collider_type_hull: return intersection(a.obb, b.hull, outContact);
+			}
+		} break;
+		case collider_type_hull:
+		{
+			switch (b.type)
+			{
+				case collider_type_hull: return intersection(a.hull, b.hull, outContact);
+			}
+		} break;
 	}
 
-	return sphereSphereTest;
+	ASSERT(false);
+	return false;
 }
 
-static uint32 intersectionSIMD(const w_bounding_sphere& s, const w_bounding_box& a, w_collision_contact* outContacts)
+// Speculative contacts are generated for separated shapes, whose gap may close within this frame. The contact carries the (negative) gap as 
+// penetration depth, and the solver only removes the relative velocity which would close more than this gap. This keeps fast bodies from tunneling.
+// Spheres and capsules are handled as point and segment with a radius, since GJK converges badly on round shapes.
+template <typename support_a_t, typename support_b_t>
+static bool speculativeContact(const support_a_t& supportA, float radiusA, const support_b_t& supportB, float radiusB, float margin, contact_manifold& outContact)
 {
-	w_vec3 p = closestPoint_PointAABB(s.center, a);
-	w_vec3 n = p - s.center;
-	w_float sqDistance = squaredLength(n);
-
-	auto intersects = sqDistance <= s.radius * s.radius;
-
-	uint32 mask = toBitMask(intersects);
+	gjk_distance_result result;
+	if (!gjkDistance(supportA, supportB, result) || result.distance <= 0.f)
+	{
+		return false; // Cores intersect. This is handled by the discrete test.
+	}
 
-	if (anyTrue(mask))
+	float distance = result.distance - radiusA - radiusB;
+	if (distance <= 0.f || distance > margin)
 	{
-		auto valid = (sqDistance > 0.f);
-		w_float dist = ifThen(valid, sqrt(sqDistance), 0.f);
-		n = ifThen(valid, n / dist, w_vec3(0.f, 1.f, 0.f));
+		return false;
+	}
 
-		outContacts[0].point = w_float(0.5f) * (p + s.center + n * s.radius);
-		outContacts[0].penetrationDepth = s.radius - dist; // Flipped to change sign.
-		outContacts[0].normal = n;
-		outContacts[0].mask = mask;
+	vec3 normal = (result.closestPointB - result.closestPointA) / result.distance;
+	vec3 pointA = result.closestPointA + normal * radiusA;
+	vec3 pointB = result.closestPointB - normal * radiusB;
 
-		return 1;
-	}
-	return 0;
+	outContact.collisionNormal = normal;
+	outContact.numContacts = 1;
+	outContact.contacts[0].point = 0.5f * (pointA + pointB);
+	outContact.contacts[0].penetrationDepth = -distance;
+	outContact.contacts[0].feature = 0;
+	return true;
 }
 
-static uint32 intersectionSIMD(const w_bounding_sphere& s, const w_bounding_oriented_box& o, w_collision_contact* outContacts)
+template <typename support_a_t>
+static bool speculativeContact(const support_a_t& supportA, float radiusA, const collider_union& b, float margin, contact_manifold& outContact)
 {
-	w_bounding_box aabb = w_bounding_box::fromCenterRadius(o.center, o.radius);
-	w_bounding_sphere s_ = {
-		conjugate(o.rotation) * (s.center - o.center) + o.center,
-		s.radius };
-
-	uint32 result = intersectionSIMD(s_, aabb, outContacts);
-
-	if (result)
+	switch (b.type)
 	{
-		outContacts[0].normal = o.rotation * outContacts[0].normal;
-		outContacts[0].point = o.rotation * (outContacts[0].point - o.center) + o.center;
-		return 1;
+		case collider_type_sphere: return speculativeContact(supportA, radiusA, point_support_fn{ b.sphere.center }, b.sphere.radius, margin, outContact);
+		case collider_type_capsule: return speculativeContact(supportA, radiusA, segment_support_fn{ b.capsule.positionA, b.capsule.positionB }, b.capsule.radius, margin, outContact);
+		case collider_type_cylinder: return speculativeContact(supportA, radiusA, cylinder_support_fn{ b.cylinder }, 0.f, margin, outContact);
+		case collider_type_aabb: return speculativeContact(supportA, radiusA, aabb_support_fn{ b.aabb }, 0.f, margin, outContact);
+		case collider_type_obb: return speculativeContact(supportA, radiusA, obb_support_fn{ b.obb }, 0.f, margin, outContact);
+		case collider_type_hull: return speculativeContact(supportA, radiusA, hull_support_fn{ b.hull }, 0.f, margin, outContact);
 	}
-	return 0;
+	return false;
 }
 
-// Capsule tests.
-static uint32 intersectionSIMD(const w_bounding_capsule& a, const w_bounding_capsule& b, w_collision_contact* outContacts)
+static bool speculativeContact(const collider_union& a, const collider_union& b, float margin, contact_manifold& outContact)
 {
-	w_vec3 aDir = a.positionB - a.positionA;
-	w_vec3 bDir = normalize(b.positionB - b.positionA);
-
-	w_float aDirLength = length(aDir);
-	aDir *= 1.f / aDirLength;
-
-	w_float alignment = dot(aDir, bDir);
-
-	auto valid = (abs(alignment) <= 0.99f);
-
-	uint32 result = 0;
-
-	int32 validMask = toBitMask(valid);
-
-	if (anyTrue(validMask))
+	switch (a.type)
 	{
-		w_vec3 closestPoint1, closestPoint2;
-		closestPoint_SegmentSegment(w_line_segment{ a.positionA, a.positionB }, w_line_segment{ b.positionA, b.positionB }, closestPoint1, closestPoint2);
-		result = intersectionSIMD(w_bounding_sphere{ closestPoint1, a.radius }, w_bounding_sphere{ closestPoint2, b.radius }, outContacts);
-
-		if (allTrue(valid))
-		{
-			return result;
-		}
+		case collider_type_sphere: return speculativeContact(point_support_fn{ a.sphere.center }, a.sphere.radius, b, margin, outContact);
+		case collider_type_capsule: return speculativeContact(segment_support_fn{ a.capsule.positionA, a.capsule.positionB }, a.capsule.radius, b, margin, outContact);
+		case collider_type_cylinder: return speculativeContact(cylinder_support_fn{ a.cylinder }, 0.f, b, margin, outContact);
+		case collider_type_aabb: return speculativeContact(aabb_support_fn{ a.aabb }, 0.f, b, margin, outContact);
+		case collider_type_obb: return speculativeContact(obb_support_fn{ a.obb }, 0.f, b, margin, outContact);
+		case collider_type_hull: return speculativeContact(hull_support_fn{ a.hull }, 0.f, b, margin, outContact);
 	}
+	return false;
+}
 
-	// Parallel case.
-
-	w_vec3 pAa = a.positionA;
-	w_vec3 pAb = a.positionB;
-	w_vec3 pBa = b.positionA;
-	w_vec3 pBb = b.positionB;
-
-	auto swap = alignment < 0.f;
-	
-	if (anyTrue(swap))
-	{
-		w_vec3 tmp = pBa;
-		pBa = ifThen(swap, pBb, pBa);
-		pBb = ifThen(swap, tmp, pBb);
-	}
-
-	w_vec3 referencePoint = a.positionA;
-
-	w_float a0 = 0.f;
-	w_float a1 = aDirLength;
-
-	w_float b0 = dot(aDir, pBa - referencePoint);
-	w_float b1 = dot(aDir, pBb - referencePoint);
-
-	w_float left = maximum(a0, b0);
-	w_float right = minimum(a1, b1);
-
-	auto endToEnd = right < left;
-	if (anyTrue(endToEnd))
+static void collisionSpeculative(const collider_union* worldSpaceColliders, const collider_pair* colliderPairs, uint32 numColliderPairs,
+	const float* speculativeMargins, collision_write_context& writeContext)
+{
+	for (uint32 i = 0; i < numColliderPairs; ++i)
 	{
-		auto mask = a0 > b1;
-		w_vec3 refA = ifThen(mask, pAa, pAb);
-		w_vec3 refB = ifThen(mask, pBb, pBa);
+		collider_pair pair = colliderPairs[i];
 
-		w_collision_contact contact;
-		uint32 endToEndTest = intersectionSIMD(w_bounding_sphere{ refA, a.radius }, w_bounding_sphere{ refB, b.radius }, &contact);
+		const collider_union& colliderA = worldSpaceColliders[pair.colliderA];
+		const collider_union& colliderB = worldSpaceColliders[pair.colliderB];
 
-		if (endToEndTest)
-		{
-			outContacts[0].point = ifThen(valid, outContacts[0].point, contact.point);
-			outContacts[0].penetrationDepth = ifThen(valid, outContacts[0].penetrationDepth, contact.penetrationDepth);
-			outContacts[0].normal = ifThen(valid, outContacts[0].normal, contact.normal);
-			outContacts[0].mask |= contact.mask;
-			valid |= mask;
-		}
+		float margin = speculativeMargins[pair.colliderA] + speculativeMargins[pair.colliderB];
 
-		result = max(endToEndTest, result);
+		contact_manifold contact;
 
-		if (allTrue(valid))
+		if (dispatchIntersection(colliderA, colliderB, contact)
+			|| speculativeContact(colliderA, colliderB, margin, contact))
 		{
-			return result;
+			writeScalarContact(worldSpaceColliders, contact, pair.colliderA, pair.colliderB, writeContext);
 		}
 	}
+}
 
-	w_vec3 contactA0 = referencePoint + left * aDir;
-	w_vec3 contactA1 = referencePoint + right * aDir;
-
-	w_vec3 contactB0 = closestPoint_PointSegment(contactA0, w_line_segment{ pBa, pBb });
-	w_vec3 contactB1 = contactB0 + (right - left) * aDir;
-
-	w_vec3 normal = contactB0 - contactA0;
-	w_float d = length(normal);
-
-	auto degenerate = (d < EPSILON);
-
-	d = ifThen(degenerate, 0.f, d);
-	normal = ifThen(degenerate, w_vec3(0.f, 1.f, 0.f), normal / d);
-
-	w_float radiusSum = a.radius + b.radius;
+typedef void (*collision_func)(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
+	collision_write_context& writeContext);
 
-	w_float penetration = radiusSum - d;
-	auto collision = (penetration >= 0.f);
+// Indexed by collider types, with a.type <= b.type. The order of the checks (and thus of the output) is row by row.
+static const collision_func collisionFunctions[collider_type_count][collider_type_count] =
+{
+	{
+		collisionScalar<bounding_sphere, bounding_sphere>,
+		collisionScalar<bounding_sphere, bounding_capsule>,
+		collisionScalar<bounding_sphere, bounding_cylinder>,
+		collisionScalar<bounding_sphere, bounding_box>,
+		collisionScalar<bounding_sphere, bounding_oriented_box>,
+		collisionScalar<bounding_sphere, bounding_hull>,
+	},
+	{
+		0,
+		collisionScalar<bounding_capsule, bounding_capsule>,
+		collisionScalar<bounding_capsule, bounding_cylinder>,
+		collisionScalar<bounding_capsule, bounding_box>,
+		collisionScalar<bounding_capsule, bounding_oriented_box>,
+		collisionScalar<bounding_capsule, bounding_hull>,
+	},
+	{
+		0,
+		0,
+		collisionScalar<bounding_cylinder, bounding_cylinder>,
+		collisionScalar<bounding_cylinder, bounding_box>,
+		collisionScalar<bounding_cylinder, bounding_oriented_box>,
+		collisionScalar<bounding_cylinder, bounding_hull>,
+	},
+	{
+		0,
+		0,
+		0,
+		collisionScalar<bounding_box, bounding_box>,
+		collisionScalar<bounding_box, bounding_oriented_box>,
+		collisionScalar<bounding_box, bounding_hull>,
+	},
+	{
+		0,
+		0,
+		0,
+		0,
+		collisionScalar<bounding_oriented_box, bounding_oriented_box>,
+		collisionScalar<bounding_oriented_box, bounding_hull>,
+	},
+	{
+		0,
+		0,
+		0,
+		0,
+		0,
+		collisionScalar<bounding_hull, bounding_hull>,
+	},
+};
 
-	int32 mask = toBitMask(collision);
+// Must be a multiple of the SIMD width of all levels, so that chunking doesn't change the SIMD batches compared to the serial path.
+#define NARROWPHASE_PAIRS_PER_CHUNK 256u
 
-	if (!mask)
+static void collision(uint32 typeA, uint32 typeB, const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
+	collision_write_context& writeContext, bool simd)
+{
+	if (!simd)
 	{
-		return result;
+		collisionFunctions[typeA][typeB](worldSpaceColliders, colliderPairs, numColliderPairs, writeContext);
+		return;
 	}
 
-	w_vec3 point0 = (contactA0 + contactB0) * w_float(0.5f);
-	w_float penetration0 = penetration;
-	w_vec3 normal0 = normal;
-	int32 mask0 = mask;
-
-	if (anyTrue(validMask))
+	// The SIMD kernels hand back the pairs they can't decide, which are then tested here. This is done in blocks of the chunk size, so that the
+	// output order is the same in the serial and the parallel path.
+	for (uint32 first = 0; first < numColliderPairs; first += NARROWPHASE_PAIRS_PER_CHUNK)
 	{
-		point0 = ifThen(valid, outContacts[0].point, point0);
-		penetration0 = ifThen(valid, outContacts[0].penetrationDepth, penetration0);
-		normal0 = ifThen(valid, outContacts[0].normal, normal0);
+		collider_pair* pairs = colliderPairs + first;
+		uint32 numPairs = min(NARROWPHASE_PAIRS_PER_CHUNK, numColliderPairs - first);
 
-		mask0 |= validMask;
+		uint32 numScalarPairs = SIMD_DISPATCH(narrowphaseSIMD)(typeA, typeB, worldSpaceColliders, pairs, numPairs, writeContext);
+		if (numScalarPairs)
+		{
+			collisionFunctions[typeA][typeB](worldSpaceColliders, pairs, numScalarPairs, writeContext);
+		}
 	}
-
-	outContacts[0].point = point0;
-	outContacts[0].penetrationDepth = penetration0;
-	outContacts[0].normal = normal0;
-	outContacts[0].mask = mask0;
-
-	outContacts[1].point = (contactA1 + contactB1) * w_float(0.5f);
-	outContacts[1].penetrationDepth = penetration;
-	outContacts[1].normal = normal;
-	outContacts[1].mask = mask;
-
-	return 2;
 }
 
 
+#define MAX_NUM_NARROWPHASE_JOBS 32
+#define MIN_NUM_PAIRS_FOR_PARALLEL_NARROWPHASE 1024
 
+static_assert(NARROWPHASE_PAIRS_PER_CHUNK % 16 == 0);
 
+struct narrowphase_chunk
+{
+	collider_pair* pairs;
+	uint32 numPairs;
 
+	uint8 typeA;
+	uint8 typeB; // Both are collider_type_count for speculative pairs.
 
+	// Each chunk writes to its own region of the scratch buffers, which is large enough for the maximum of 4 contacts per pair.
+	uint32 firstOutput; // Index of the chunk's first pair among all pairs.
 
+	uint32 numCollisions;
+	uint32 numContacts;
+	uint32 numFeatures;
+};
 
+struct narrowphase_job_context
+{
+	const collider_union* worldSpaceColliders;
+	const float* speculativeMargins;
 
-template <typename collider_a, typename collider_b, typename = void>
-struct simd_intersection_available : std::false_type {};
+	narrowphase_chunk* chunks;
+	uint32 numChunks;
+	std::atomic<uint32> nextChunk;
 
-template <typename collider_a, typename collider_b>
-struct simd_intersection_available<collider_a, collider_b,
-	std::void_t<decltype(intersectionSIMD(std::declval<const collider_a&>(), std::declval<const collider_b&>())) >> : std::true_type {};
+	collision_contact* scratchContacts;
+	constraint_body_pair* scratchBodyPairs;
+	uint32* scratchContactFeatures;
+	collider_pair* scratchColliderPairs;
+	uint8* scratchContactCountPerCollision;
+	narrowphase_cache_entry* scratchFeatures;
 
-template <typename collider_t> struct scalar_to_wide { using type = void; };
-template <> struct scalar_to_wide<bounding_sphere> { using type = w_bounding_sphere; };
-template <> struct scalar_to_wide<bounding_capsule> { using type = w_bounding_capsule; };
-template <> struct scalar_to_wide<bounding_cylinder> { using type = w_bounding_cylinder; };
-template <> struct scalar_to_wide<bounding_box> { using type = w_bounding_box; };
-template <> struct scalar_to_wide<bounding_oriented_box> { using type = w_bounding_oriented_box; };
+	const narrowphase_cache_entry* cachedFeatures;
+	uint32 numCachedFeatures;
 
+	bool simd;
+};
 
-struct collision_write_context
+static void processNarrowphaseChunk(narrowphase_job_context& context, narrowphase_chunk& chunk)
 {
-	collision_contact* outContacts;
-	constraint_body_pair* outBodyPairs;
-
-	collider_pair* outColliderPairs;
-	uint8* outContactCountPerCollision;
-
-	uint32 numContacts;
-	uint32 numCollisions;
+	collision_write_context writeContext;
+	writeContext.numCollisions = 0;
+	writeContext.numContacts = 0;
+	writeContext.outContacts = context.scratchContacts + chunk.firstOutput * 4;
+	writeContext.outBodyPairs = context.scratchBodyPairs + chunk.firstOutput * 4;
+	writeContext.outContactFeatures = context.scratchContactFeatures + chunk.firstOutput * 4;
+	writeContext.outColliderPairs = context.scratchColliderPairs + chunk.firstOutput;
+	writeContext.outContactCountPerCollision = context.scratchContactCountPerCollision + chunk.firstOutput;
+	writeContext.cachedFeatures = context.cachedFeatures;
+	writeContext.numCachedFeatures = context.numCachedFeatures;
+	writeContext.outFeatures = context.scratchFeatures + chunk.firstOutput;
+	writeContext.numFeatures = 0;
 
-	std::pair<collision_contact&, constraint_body_pair&> pushContact()
+	if (chunk.typeA == collider_type_count)
 	{
-		std::pair<collision_contact&, constraint_body_pair&> result = { outContacts[numContacts], outBodyPairs[numContacts] };
-		++numContacts;
-		return result;
+		collisionSpeculative(context.worldSpaceColliders, chunk.pairs, chunk.numPairs, context.speculativeMargins, writeContext);
 	}
-
-	void pushCollision(uint16 colliderA, uint16 colliderB, uint32 numContacts)
+	else
 	{
-		outColliderPairs[numCollisions] = { colliderA, colliderB };
-		outContactCountPerCollision[numCollisions] = (uint8)numContacts;
-		++numCollisions;
+		collision(chunk.typeA, chunk.typeB, context.worldSpaceColliders, chunk.pairs, chunk.numPairs, writeContext, context.simd);
 	}
-};
-
-static void writeWideContact(const collider_union* worldSpaceColliders, const w_collision_contact* wideContacts, uint32 numWideContacts,
-	uint16* aIndices, uint16* bIndices, uint32 numValidLanes,
-	collision_write_context& writeContext)
-{
-	if (numWideContacts > 0)
-	{
-		uint32 validLanesMask = (1 << numValidLanes) - 1;
-
-		w_float restitutionA, frictionA, densityA;
-		w_float restitutionB, frictionB, densityB;
-		w_float rbA, rbB;
 
-		load4(&worldSpaceColliders->material.restitution, aIndices, sizeof(collider_union),
-			restitutionA, frictionA, densityA, rbA);
-		load4(&worldSpaceColliders->material.restitution, bIndices, sizeof(collider_union),
-			restitutionB, frictionB, densityB, rbB);
+	ASSERT(writeContext.numCollisions <= chunk.numPairs);
+	ASSERT(writeContext.numContacts <= chunk.numPairs * 4);
 
-		w_float friction = clamp01(sqrt(frictionA * frictionB));
-		w_float restitution = clamp01(maximum(restitutionA, restitutionB));
+	chunk.numCollisions = writeContext.numCollisions;
+	chunk.numContacts = writeContext.numContacts;
+	chunk.numFeatures = writeContext.numFeatures;
+}
 
-		w_float friction_restitution = reinterpret((convert(friction * 0xFFFF) << 16) | convert(restitution * 0xFFFF));
+static uint32 pushNarrowphaseChunks(narrowphase_chunk* chunks, uint32 numChunks, collider_pair* pairs, uint32 numPairs, uint8 typeA, uint8 typeB, uint32& numTotalPairs)
+{
+	for (uint32 first = 0; first < numPairs; first += NARROWPHASE_PAIRS_PER_CHUNK)
+	{
+		narrowphase_chunk& chunk = chunks[numChunks++];
+		chunk.pairs = pairs + first;
+		chunk.numPairs = min(NARROWPHASE_PAIRS_PER_CHUNK, numPairs - first);
+		chunk.typeA = typeA;
+		chunk.typeB = typeB;
+		chunk.firstOutput = numTotalPairs;
 
-		rbA >>= 16;
-		rbB >>= 16;
-		w_int bodyPairs = reinterpret((rbB << 16) | rbA);
+		numTotalPairs += chunk.numPairs;
+	}
+	return numChunks;
+}
 
+// Splits the pairs into chunks, which are processed on the job system. Each chunk writes into its own scratch region, and the results are
+// then compacted in chunk order, so the output is identical to the serial path.
+static void collisionParallel(const collider_union* worldSpaceColliders,
+	collider_pair* collisionPairMatrix[collider_type_count][collider_type_count], const uint32 collisionCountMatrix[collider_type_count][collider_type_count],
+	collider_pair* speculativePairs, uint32 numSpeculativePairs, const float* speculativeMargins,
+	memory_arena& arena, collision_write_context& writeContext, bool simd)
+{
+	CPU_PROFILE_BLOCK("Check for collisions parallel");
 
-		uint32 numContactsPerLane[COLLISION_SIMD_WIDTH] = {};
-		for (uint32 j = 0; j < numWideContacts; ++j)
+	uint32 maxNumChunks = bucketize(numSpeculativePairs, NARROWPHASE_PAIRS_PER_CHUNK);
+	for (uint32 i = 0; i < collider_type_count; ++i)
+	{
+		for (uint32 j = i; j < collider_type_count; ++j)
 		{
-			uint32 mask = wideContacts[j].mask;
-			ASSERT(mask != 0);
-
-			mask &= validLanesMask;
-
-			for (uint32 k = 0; k < numValidLanes; ++k)
-			{
-				if (mask & (1 << k))
-				{
-					++numContactsPerLane[k];
-				}
-			}
+			maxNumChunks += bucketize(collisionCountMatrix[i][j], NARROWPHASE_PAIRS_PER_CHUNK);
 		}
-		uint32 offsetPerLane[COLLISION_SIMD_WIDTH];
-		exclusivePrefixSum(numContactsPerLane, offsetPerLane, numValidLanes);
+	}
 
-		for (uint32 k = 0; k < numValidLanes; ++k)
-		{
-			if (numContactsPerLane[k] > 0)
-			{
-				writeContext.pushCollision(aIndices[k], bIndices[k], numContactsPerLane[k]);
-			}
-		}
+	narrowphase_chunk* chunks = arena.allocate<narrowphase_chunk>(maxNumChunks);
+	uint32 numChunks = 0;
+	uint32 numTotalPairs = 0;
 
-		for (uint32 j = 0; j < numWideContacts; ++j)
+	for (uint32 i = 0; i < collider_type_count; ++i)
+	{
+		for (uint32 j = i; j < collider_type_count; ++j)
 		{
-			const w_collision_contact& c = wideContacts[j];
-
-			uint32 mask = c.mask;
-			ASSERT(mask != 0);
-
-			mask &= validLanesMask;
-
-			if (mask)
-			{
-				w_float v[] =
-				{
-					c.point.x,
-					c.point.y,
-					c.point.z,
-					c.penetrationDepth,
-					c.normal.x,
-					c.normal.y,
-					c.normal.z,
-					friction_restitution,
-				};
-
-#if COLLISION_SIMD_WIDTH == 4
-				transpose(v[0], v[1], v[2], v[3]);
-				transpose(v[4], v[5], v[6], v[7]);
-#elif COLLISION_SIMD_WIDTH == 8
-				transpose(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
-#endif
-
-				for (uint32 k = 0; k < numValidLanes; ++k)
-				{
-					if (mask & (1 << k))
-					{
-						uint32 offset = offsetPerLane[k];
-
-						auto& [outContact, outBodyPair] = writeContext.pushContact();
-
-						v[k].store((float*)&outContact);
-#if COLLISION_SIMD_WIDTH == 4
-						v[k + 4].store((float*)&outContact + 4);
-#endif
-
-						*(int*)&outBodyPair = bodyPairs[k];
-						
-						++offsetPerLane[k];
-					}
-				}
-			}
+			numChunks = pushNarrowphaseChunks(chunks, numChunks, collisionPairMatrix[i][j], collisionCountMatrix[i][j], (uint8)i, (uint8)j, numTotalPairs);
 		}
 	}
-}
-
-static void writeScalarContact(const collider_union* worldSpaceColliders, const contact_manifold& contact,
-	uint16 aIndex, uint16 bIndex,
-	collision_write_context& writeContext)
-{
-	const collider_union* colliderA = worldSpaceColliders + aIndex;
-	const collider_union* colliderB = worldSpaceColliders + bIndex;
-
-	uint16 rbA = colliderA->objectIndex;
-	uint16 rbB = colliderB->objectIndex;
-
-	physics_material propsA = colliderA->material;
-	physics_material propsB = colliderB->material;
+	numChunks = pushNarrowphaseChunks(chunks, numChunks, speculativePairs, numSpeculativePairs, collider_type_count, collider_type_count, numTotalPairs);
 
-	float friction = clamp01(sqrt(propsA.friction * propsB.friction));
-	float restitution = clamp01(max(propsA.restitution, propsB.restitution));
+	ASSERT(numChunks == maxNumChunks);
 
-	uint32 friction_restitution = ((uint32)(friction * 0xFFFF) << 16) | (uint32)(restitution * 0xFFFF);
+	CPU_PROFILE_STAT("Narrow phase chunks", numChunks);
 
-	writeContext.pushCollision(aIndex, bIndex, contact.numContacts);
+	narrowphase_job_context context;
+	context.worldSpaceColliders = worldSpaceColliders;
+	context.speculativeMargins = speculativeMargins;
+	context.chunks = chunks;
+	context.numChunks = numChunks;
+	context.nextChunk = 0;
+	context.scratchContacts = arena.allocate<collision_contact>(numTotalPairs * 4);
+	context.scratchBodyPairs = arena.allocate<constraint_body_pair>(numTotalPairs * 4);
+	context.scratchContactFeatures = arena.allocate<uint32>(numTotalPairs * 4);
+	context.scratchColliderPairs = arena.allocate<collider_pair>(numTotalPairs);
+	context.scratchContactCountPerCollision = arena.allocate<uint8>(numTotalPairs);
+	context.scratchFeatures = arena.allocate<narrowphase_cache_entry>(numTotalPairs);
+	context.cachedFeatures = writeContext.cachedFeatures;
+	context.numCachedFeatures = writeContext.numCachedFeatures;
+	context.simd = simd;
 
-	for (uint32 contactIndex = 0; contactIndex < contact.numContacts; ++contactIndex)
+	struct narrowphase_parent_job_data
 	{
-		auto& [outContact, outBodyPair] = writeContext.pushContact();
-
-		outContact.normal = contact.collisionNormal;
-		outContact.penetrationDepth = contact.contacts[contactIndex].penetrationDepth;
-		outContact.point = contact.contacts[contactIndex].point;
-		outContact.friction_restitution = friction_restitution;
+		narrowphase_job_context* context;
+		uint32 numJobs;
+	};
 
-		outBodyPair.rbA = rbA;
-		outBodyPair.rbB = rbB;
-	}
-}
+	narrowphase_parent_job_data data = { &context, min(numChunks, (uint32)MAX_NUM_NARROWPHASE_JOBS) };
 
-template <typename collider_a, typename collider_b>
-static void collisionSIMD(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
-	collision_write_context& writeContext)
-{
-	for (uint32 i = 0; i < numColliderPairs; i += COLLISION_SIMD_WIDTH)
+	job_handle parentJob = highPriorityJobQueue.createJob<narrowphase_parent_job_data>([](narrowphase_parent_job_data& data, job_handle parent)
 	{
-		uint32 numValidLanes = clamp(numColliderPairs - i, 0u, COLLISION_SIMD_WIDTH);
-
-		uint16 aIndices[COLLISION_SIMD_WIDTH] = {};
-		uint16 bIndices[COLLISION_SIMD_WIDTH] = {};
-
-		// TODO: This could be done with SIMD.
-		for (uint32 j = 0; j < numValidLanes; ++j)
+		for (uint32 i = 0; i < data.numJobs; ++i)
 		{
-			collider_pair pair = colliderPairs[i + j];
-			aIndices[j] = pair.colliderA;
-			bIndices[j] = pair.colliderB;
+			highPriorityJobQueue.createJob<narrowphase_job_context*>([](narrowphase_job_context*& context, job_handle)
+			{
+				// Chunks are handed out dynamically, since their cost varies a lot with the collider types.
+				uint32 chunkIndex;
+				while ((chunkIndex = context->nextChunk++) < context->numChunks)
+				{
+					processNarrowphaseChunk(*context, context->chunks[chunkIndex]);
+				}
+			}, data.context, parent).submitNow();
 		}
+	}, data);
 
-		collider_a bvA = loadBoundingVolumeSIMD<collider_a>(worldSpaceColliders, aIndices);
-		collider_b bvB = loadBoundingVolumeSIMD<collider_b>(worldSpaceColliders, bIndices);
-
-		w_collision_contact wideContacts[4];
-		uint32 numWideContacts = intersectionSIMD(bvA, bvB, wideContacts);
-
-		writeWideContact(worldSpaceColliders, wideContacts, numWideContacts, aIndices, bIndices, numValidLanes, writeContext);
-	}
-}
+	parentJob.submitNow();
+	parentJob.waitForCompletion();
 
-template <typename collider_a, typename collider_b>
-static void collisionScalar(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
-	collision_write_context& writeContext)
-{
-	for (uint32 i = 0; i < numColliderPairs; ++i)
 	{
-		collider_pair pair = colliderPairs[i];
-
-		const collider_a& bvA = loadBoundingVolumeScalar<collider_a>(worldSpaceColliders, pair.colliderA);
-		const collider_b& bvB = loadBoundingVolumeScalar<collider_b>(worldSpaceColliders, pair.colliderB);
-
-		contact_manifold contact;
+		CPU_PROFILE_BLOCK("Compact contacts");
 
-		if (intersection(bvA, bvB, contact))
+		for (uint32 i = 0; i < numChunks; ++i)
 		{
-			writeScalarContact(worldSpaceColliders, contact, pair.colliderA, pair.colliderB, writeContext);
-		}
-	}
-}
+			const narrowphase_chunk& chunk = chunks[i];
 
-template <typename collider_a, typename collider_b>
-static void collision(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs, 
-	collision_write_context& writeContext, bool simd)
-{
-	if (simd)
-	{
-		using wide_collider_a = scalar_to_wide<collider_a>::type;
-		using wide_collider_b = scalar_to_wide<collider_b>::type;
+			memcpy(writeContext.outContacts + writeContext.numContacts, context.scratchContacts + chunk.firstOutput * 4, sizeof(collision_contact) * chunk.numContacts);
+			memcpy(writeContext.outBodyPairs + writeContext.numContacts, context.scratchBodyPairs + chunk.firstOutput * 4, sizeof(constraint_body_pair) * chunk.numContacts);
+			memcpy(writeContext.outContactFeatures + writeContext.numContacts, context.scratchContactFeatures + chunk.firstOutput * 4, sizeof(uint32) * chunk.numContacts);
+			memcpy(writeContext.outColliderPairs + writeContext.numCollisions, context.scratchColliderPairs + chunk.firstOutput, sizeof(collider_pair) * chunk.numCollisions);
+			memcpy(writeContext.outContactCountPerCollision + writeContext.numCollisions, context.scratchContactCountPerCollision + chunk.firstOutput, sizeof(uint8) * chunk.numCollisions);
+			memcpy(writeContext.outFeatures + writeContext.numFeatures, context.scratchFeatures + chunk.firstOutput, sizeof(narrowphase_cache_entry) * chunk.numFeatures);
 
-		if constexpr (simd_intersection_available<wide_collider_a, wide_collider_b>::value)
-		{
-			collisionSIMD<wide_collider_a, wide_collider_b>(worldSpaceColliders, colliderPairs, numColliderPairs, writeContext);
+			writeContext.numContacts += chunk.numContacts;
+			writeContext.numCollisions += chunk.numCollisions;
+			writeContext.numFeatures += chunk.numFeatures;
 		}
-		else
-		{
-			collisionScalar<collider_a, collider_b>(worldSpaceColliders, colliderPairs, numColliderPairs, writeContext);
-		}
-	}
-	else
-	{
-		collisionScalar<collider_a, collider_b>(worldSpaceColliders, colliderPairs, numColliderPairs, writeContext);
 	}
 }
 
 narrowphase_result narrowphase(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numCollisionPairs, memory_arena& arena,
-	collision_contact* outContacts, constraint_body_pair* outBodyPairs, 
+	collision_contact* outContacts, constraint_body_pair* outBodyPairs, uint32* outContactFeatures,
 	collider_pair* outColliderPairs, uint8* outContactCountPerCollision,
 	non_collision_interaction* outNonCollisionInteractions,
-	bool simd)
+	const float* speculativeMargins, narrowphase_cache* cache, bool simd, bool parallel)
 {
 	CPU_PROFILE_BLOCK("Narrow phase");
 
@@ -2340,6 +2288,10 @@ narrowphase_result narrowphase(const collider_union* worldSpaceColliders, collid
 	
 	memory_marker marker = arena.getMarker();
 
+	// Pairs involving continuous colliders go through the scalar path, which additionally generates speculative contacts.
+	collider_pair* speculativePairs = speculativeMargins ? arena.allocate<collider_pair>(numCollisionPairs) : 0;
+	uint32 numSpeculativeChecks = 0;
+
 	uint32 collisionCountMatrix[collider_type_count][collider_type_count] = {};
 	uint32 intersectionCountMatrix[collider_type_count][collider_type_count] = {};
 
@@ -2371,16 +2323,25 @@ narrowphase_result narrowphase(const collider_union* worldSpaceColliders, collid
 
 			// At this point, either one or both colliders belong to a rigid body. One of them could be a force field, trigger or a solo collider still.
 
-			pair = (colliderA->type < colliderB->type) ? pair : collider_pair{ pair.colliderB, pair.colliderA };
+			// Pairs of the same type are ordered by index, so that a pair keeps its order (and its cached features) across frames.
+			bool inOrder = (colliderA->type < colliderB->type) || (colliderA->type == colliderB->type && pair.colliderA < pair.colliderB);
+			pair = inOrder ? pair : collider_pair{ pair.colliderB, pair.colliderA };
 			colliderA = worldSpaceColliders + pair.colliderA;
 			colliderB = worldSpaceColliders + pair.colliderB;
 
 			if (colliderA->objectType == physics_object_type_rigid_body && colliderB->objectType == physics_object_type_rigid_body // Both rigid bodies.
 				|| colliderA->objectType == physics_object_type_static_collider || colliderB->objectType == physics_object_type_static_collider) // One is a static collider.
 			{
-				++collisionCountMatrix[colliderA->type][colliderB->type];
+				if (speculativeMargins && speculativeMargins[pair.colliderA] + speculativeMargins[pair.colliderB] > 0.f)
+				{
+					speculativePairs[numSpeculativeChecks++] = pair;
+				}
+				else
+				{
+					++collisionCountMatrix[colliderA->type][colliderB->type];
 
-				colliderPairs[numCollisionChecks++] = pair;
+					colliderPairs[numCollisionChecks++] = pair;
+				}
 			}
 			else
 			{
@@ -2456,118 +2417,44 @@ narrowphase_result narrowphase(const collider_union* worldSpaceColliders, collid
 
 	// Collision checks.
 
-
-	// SPHERE.
-
 	collision_write_context writeContext;
 	writeContext.numCollisions = 0;
 	writeContext.numContacts = 0;
 	writeContext.outContacts = outContacts;
 	writeContext.outBodyPairs = outBodyPairs;
+	writeContext.outContactFeatures = outContactFeatures;
 	writeContext.outColliderPairs = outColliderPairs;
 	writeContext.outContactCountPerCollision = outContactCountPerCollision;
+	writeContext.cachedFeatures = cache ? cache->entries.data() : 0;
+	writeContext.numCachedFeatures = cache ? (uint32)cache->entries.size() : 0;
+	writeContext.outFeatures = arena.allocate<narrowphase_cache_entry>(numCollisionChecks);
+	writeContext.numFeatures = 0;
 
+	if (parallel && numCollisionChecks + numSpeculativeChecks >= MIN_NUM_PAIRS_FOR_PARALLEL_NARROWPHASE)
 	{
-		CPU_PROFILE_BLOCK("Check for collisions");
-
-		collision<bounding_sphere, bounding_sphere>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_sphere][collider_type_sphere], collisionCountMatrix[collider_type_sphere][collider_type_sphere],
-			writeContext, simd);
-
-		collision<bounding_sphere, bounding_capsule>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_sphere][collider_type_capsule], collisionCountMatrix[collider_type_sphere][collider_type_capsule],
-			writeContext, simd);
-
-		collision<bounding_sphere, bounding_cylinder>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_sphere][collider_type_cylinder], collisionCountMatrix[collider_type_sphere][collider_type_cylinder],
-			writeContext, simd);
-
-		collision<bounding_sphere, bounding_box>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_sphere][collider_type_aabb], collisionCountMatrix[collider_type_sphere][collider_type_aabb],
-			writeContext, simd);
-
-		collision<bounding_sphere, bounding_oriented_box>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_sphere][collider_type_obb], collisionCountMatrix[collider_type_sphere][collider_type_obb],
-			writeContext, simd);
-
-		collision<bounding_sphere, bounding_hull>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_sphere][collider_type_hull], collisionCountMatrix[collider_type_sphere][collider_type_hull],
-			writeContext, simd);
-
-
-		// CAPSULE.
-
-		collision<bounding_capsule, bounding_capsule>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_capsule][collider_type_capsule], collisionCountMatrix[collider_type_capsule][collider_type_capsule],
-			writeContext, simd);
-
-		collision<bounding_capsule, bounding_cylinder>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_capsule][collider_type_cylinder], collisionCountMatrix[collider_type_capsule][collider_type_cylinder],
-			writeContext, simd);
-
-		collision<bounding_capsule, bounding_box>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_capsule][collider_type_aabb], collisionCountMatrix[collider_type_capsule][collider_type_aabb],
-			writeContext, simd);
-
-		collision<bounding_capsule, bounding_oriented_box>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_capsule][collider_type_obb], collisionCountMatrix[collider_type_capsule][collider_type_obb],
-			writeContext, simd);
-
-		collision<bounding_capsule, bounding_hull>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_capsule][collider_type_hull], collisionCountMatrix[collider_type_capsule][collider_type_hull],
-			writeContext, simd);
-
-
-		// CYLINDER.
-
-		collision<bounding_cylinder, bounding_cylinder>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_cylinder][collider_type_cylinder], collisionCountMatrix[collider_type_cylinder][collider_type_cylinder],
-			writeContext, simd);
-
-		collision<bounding_cylinder, bounding_box>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_cylinder][collider_type_aabb], collisionCountMatrix[collider_type_cylinder][collider_type_aabb],
-			writeContext, simd);
-
-		collision<bounding_cylinder, bounding_oriented_box>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_cylinder][collider_type_obb], collisionCountMatrix[collider_type_cylinder][collider_type_obb],
-			writeContext, simd);
-
-		collision<bounding_cylinder, bounding_hull>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_cylinder][collider_type_hull], collisionCountMatrix[collider_type_cylinder][collider_type_hull],
-			writeContext, simd);
-
-
-		// AABB.
-
-		collision<bounding_box, bounding_box>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_aabb][collider_type_aabb], collisionCountMatrix[collider_type_aabb][collider_type_aabb],
-			writeContext, simd);
-
-		collision<bounding_box, bounding_oriented_box>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_aabb][collider_type_obb], collisionCountMatrix[collider_type_aabb][collider_type_obb],
-			writeContext, simd);
-
-		collision<bounding_box, bounding_hull>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_aabb][collider_type_hull], collisionCountMatrix[collider_type_aabb][collider_type_hull],
-			writeContext, simd);
-
-
-		// OBB.
-
-		collision<bounding_oriented_box, bounding_oriented_box>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_obb][collider_type_obb], collisionCountMatrix[collider_type_obb][collider_type_obb],
-			writeContext, simd);
-
-		collision<bounding_oriented_box, bounding_hull>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_obb][collider_type_hull], collisionCountMatrix[collider_type_obb][collider_type_hull],
-			writeContext, simd);
+		collisionParallel(worldSpaceColliders, collisionPairMatrix, collisionCountMatrix, speculativePairs, numSpeculativeChecks, speculativeMargins,
+			arena, writeContext, simd);
+	}
+	else
+	{
+		{
+			CPU_PROFILE_BLOCK("Check for collisions");
 
+			for (uint32 i = 0; i < collider_type_count; ++i)
+			{
+				for (uint32 j = i; j < collider_type_count; ++j)
+				{
+					collision(i, j, worldSpaceColliders, collisionPairMatrix[i][j], collisionCountMatrix[i][j], writeContext, simd);
+				}
+			}
+		}
 
-		// HULL.
+		if (numSpeculativeChecks > 0)
+		{
+			CPU_PROFILE_BLOCK("Check for speculative collisions");
 
-		collision<bounding_hull, bounding_hull>(worldSpaceColliders,
-			collisionPairMatrix[collider_type_hull][collider_type_hull], collisionCountMatrix[collider_type_hull][collider_type_hull],
-			writeContext, simd);
+			collisionSpeculative(worldSpaceColliders, speculativePairs, numSpeculativeChecks, speculativeMargins, writeContext);
+		}
 	}
 
 	{
@@ -2593,6 +2480,17 @@ narrowphase_result narrowphase(const collider_union* worldSpaceColliders, collid
 	}
 
 
+	if (cache)
+	{
+		CPU_PROFILE_BLOCK("Update feature cache");
+
+		cache->entries.assign(writeContext.outFeatures, writeContext.outFeatures + writeContext.numFeatures);
+		std::sort(cache->entries.begin(), cache->entries.end(),
+			[](const narrowphase_cache_entry& a, const narrowphase_cache_entry& b) { return a.pair < b.pair; });
+
+		CPU_PROFILE_STAT("Cached narrow phase features", writeContext.numFeatures);
+	}
+
 	// TODO: Write valid collision pairs and numCollisions.
 
 
@@ -2,14 +2,15 @@
 
 #include "core/math.h"
 #include "physics.h"
+#include "collision_broad.h"
+#include "core/simd_dispatch.h"
 
 struct collider_union;
-struct collider_pair;
 
 struct non_collision_interaction
 {
-	uint16 rigidBodyIndex;
-	uint16 otherIndex;
+	physics_index rigidBodyIndex;
+	physics_index otherIndex;
 	physics_object_type otherType;
 };
 
@@ -20,10 +21,158 @@ struct narrowphase_result
 	uint32 numNonCollisionInteractions;		// Number of interactions between RBs and triggers, force fields etc.
 };
 
+// Growable collision output, for collision routines whose number of contacts is not known up front. These are collisions with objects
+// without a collider (heightmaps and meshes), so the collider pairs have INVALID_PHYSICS_INDEX as the second collider and the object is stored separately.
+struct collision_output_buffers
+{
+	std::vector<collision_contact> contacts;
+	std::vector<constraint_body_pair> bodyPairs;					// contacts.size() many.
+	std::vector<uint32> contactFeatures;							// contacts.size() many. Identifies the contact within its collision for warm starting.
+	std::vector<collider_pair> colliderPairs;
+	std::vector<uint8> contactCountPerCollision;					// colliderPairs.size() many.
+	std::vector<entity_handle> otherEntities;						// colliderPairs.size() many. The object collided with.
+
+	void clear()
+	{
+		contacts.clear();
+		bodyPairs.clear();
+		contactFeatures.clear();
+		colliderPairs.clear();
+		contactCountPerCollision.clear();
+		otherEntities.clear();
+	}
+};
+
+enum narrowphase_feature_type : uint8
+{
+	narrowphase_feature_none,
+	narrowphase_feature_separating_axis,
+	narrowphase_feature_contact,
+};
+
+// What the last frame's intersection test of a collider pair found. Stacked boxes and hull piles mostly end up with the same axis again, so it
+// is tested first: A separating axis, which still separates, ends the test immediately.
+struct narrowphase_feature
+{
+	// GJK pairs: Separating axis or contact normal in world space, pointing from a to b. GJK starts its search along it.
+	vec3 axis;
+
+	narrowphase_feature_type type = narrowphase_feature_none;
+
+	// OBB pairs: Index of the SAT axis. 0-2 are the faces of a, 3-5 the faces of b, 6-14 the edge pairs.
+	uint8 satAxis;
+
+	// OBB pairs: Pose of b relative to a. If it barely changed since a face contact, the contact is clipped again from the same reference face
+	// without running the SAT.
+	quat relativeRotation;
+	vec3 relativePosition;
+};
+
+// A face contact is clipped again from last frame's reference face, if b moved less than this relative to a.
+#define OBB_FEATURE_CACHE_MAX_TRANSLATION 0.005f
+#define OBB_FEATURE_CACHE_MIN_ROTATION_DOT 0.99999f // About half a degree.
+
+// Whether the OBB test can skip the SAT and clip the contact again from the cached reference face. The pose is the one of b relative to a.
+inline bool canReuseCachedFace(const narrowphase_feature& feature, quat relativeRotation, vec3 relativePosition)
+{
+	return feature.type == narrowphase_feature_contact && feature.satAxis < 6
+		&& squaredLength(relativePosition - feature.relativePosition) < OBB_FEATURE_CACHE_MAX_TRANSLATION * OBB_FEATURE_CACHE_MAX_TRANSLATION
+		&& abs(dot(relativeRotation.v4, feature.relativeRotation.v4)) > OBB_FEATURE_CACHE_MIN_ROTATION_DOT;
+}
+
+struct narrowphase_cache_entry
+{
+	collider_pair pair;
+	narrowphase_feature feature;
+};
+
+// Features of all collider pairs with SAT or GJK tests from the last frame. The pairs are collider indices, so this has to be cleared when
+// colliders are added or removed.
+struct narrowphase_cache
+{
+	std::vector<narrowphase_cache_entry> entries; // Sorted by pair.
+};
+
+// Contact features of the box tests. A clipped contact is named by the reference face and the incident face it was clipped from, plus the
+// clipped feature: An incident vertex, an incident edge crossing a side plane of the reference face, or a corner of the reference face (two side
+// planes). The side planes are numbered as in getAABBClippingPlanes, the incident vertices as in getAABBIncidentVertices and edge i runs from
+// vertex i to vertex i + 1. The scalar and the SIMD test name the same contact the same way. Features stay below 2^24, so that the SIMD test
+// can carry them in floats. 0 means no feature.
+static uint32 contactFeatureVertex(uint32 vertex) { return (1 << 8) | vertex; }
+static uint32 contactFeatureEdgePlane(uint32 edge, uint32 plane) { return (2 << 8) | (plane << 4) | edge; }
+static uint32 contactFeaturePlanePlane(uint32 planeA, uint32 planeB) { return (3 << 8) | (max(planeA, planeB) << 4) | min(planeA, planeB); }
+static uint32 contactFeatureEdgeEdge(uint32 satAxis) { return (4 << 8) | satAxis; }
+
+// referenceFace and incidentFace are box faces, numbered axis * 2 + (1 if the face points along the negative axis).
+static uint32 contactFeature(uint32 referenceFace, uint32 incidentFace, uint32 clippedFeature) { return ((1 + referenceFace * 8 + incidentFace) << 11) | clippedFeature; }
+
 // outColliderPairs may be the same as colliderPairs
 narrowphase_result narrowphase(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numCollisionPairs, memory_arena& arena,
-	collision_contact* outContacts, constraint_body_pair* outBodyPairs, // result.numContacts many.
+	collision_contact* outContacts, constraint_body_pair* outBodyPairs, uint32* outContactFeatures, // result.numContacts many.
 	collider_pair* outColliderPairs, uint8* outContactCountPerCollision, // result.numCollisions many.
 	non_collision_interaction* outNonCollisionInteractions,			// result.numNonCollisionInteractions many.
-	bool simd);
+	const float* speculativeMargins,								// Per collider. May be null, if no collider uses continuous collision detection.
+	narrowphase_cache* cache,										// May be null. Read and updated.
+	bool simd, bool parallel);
+
+
+
+
+// Internal.
+struct collision_write_context
+{
+	collision_contact* outContacts;
+	constraint_body_pair* outBodyPairs;
+	uint32* outContactFeatures;
+
+	collider_pair* outColliderPairs;
+	uint8* outContactCountPerCollision;
+
+	uint32 numContacts;
+	uint32 numCollisions;
+
+	// Features of the last frame, sorted by pair, and the ones found in this frame. At most one per pair.
+	const narrowphase_cache_entry* cachedFeatures;
+	uint32 numCachedFeatures;
+	narrowphase_cache_entry* outFeatures;
+	uint32 numFeatures;
+
+	std::pair<collision_contact&, constraint_body_pair&> pushContact(uint32 feature)
+	{
+		std::pair<collision_contact&, constraint_body_pair&> result = { outContacts[numContacts], outBodyPairs[numContacts] };
+		outContactFeatures[numContacts] = feature;
+		++numContacts;
+		return result;
+	}
+
+	void pushCollision(physics_index colliderA, physics_index colliderB, uint32 numContacts)
+	{
+		outColliderPairs[numCollisions] = { colliderA, colliderB };
+		outContactCountPerCollision[numCollisions] = (uint8)numContacts;
+		++numCollisions;
+	}
+
+	narrowphase_feature getCachedFeature(collider_pair pair) const
+	{
+		const narrowphase_cache_entry* end = cachedFeatures + numCachedFeatures;
+		const narrowphase_cache_entry* it = std::lower_bound(cachedFeatures, end, pair,
+			[](const narrowphase_cache_entry& entry, collider_pair pair) { return entry.pair < pair; });
+		return (it != end && it->pair == pair) ? it->feature : narrowphase_feature{};
+	}
+
+	void pushFeature(collider_pair pair, const narrowphase_feature& feature)
+	{
+		if (feature.type != narrowphase_feature_none)
+		{
+			outFeatures[numFeatures++] = { pair, feature };
+		}
+	}
+};
 
+// SIMD narrow phase, compiled once per SIMD level (see collision_narrow_simd.cpp). Checks pairs of the given collider types, with typeA <= typeB.
+// Returns the number of pairs which are left for the scalar test. These are moved to the front of colliderPairs, in their original order. For
+// types without a SIMD test, this is simply numColliderPairs. Reads and writes the feature cache like the scalar test. Call through SIMD_DISPATCH.
+SIMD_KERNEL_DECLARATIONS(
+	uint32 narrowphaseSIMD(uint32 typeA, uint32 typeB, const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
+		collision_write_context& writeContext);
+)
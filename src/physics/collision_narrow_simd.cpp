@@ -0,0 +1,2169 @@
+#include "pch.h"
+#include "collision_narrow.h"
+#include "collision_broad.h"
+#include "physics.h"
+
+#include "bounding_volumes_simd.h"
+
+// Narrow phase SIMD kernels. Compiled once per SIMD level, see core/simd_dispatch.h.
+
+namespace SIMD_ISA
+{
+
+#if defined(SIMD_AVX_512)
+#define COLLISION_SIMD_WIDTH 16u
+#elif defined(SIMD_AVX_2)
+#define COLLISION_SIMD_WIDTH 8u
+#else
+#define COLLISION_SIMD_WIDTH 4u
+#endif
+
+
+#if COLLISION_SIMD_WIDTH == 4
+typedef w4_float w_float;
+typedef w4_int w_int;
+#elif COLLISION_SIMD_WIDTH == 8 && defined(SIMD_AVX_2)
+typedef w8_float w_float;
+typedef w8_int w_int;
+#elif COLLISION_SIMD_WIDTH == 16 && defined(SIMD_AVX_512)
+typedef w16_float w_float;
+typedef w16_int w_int;
+#endif
+
+typedef wN_vec2<w_float> w_vec2;
+typedef wN_vec3<w_float> w_vec3;
+typedef wN_vec4<w_float> w_vec4;
+typedef wN_quat<w_float> w_quat;
+typedef wN_mat2<w_float> w_mat2;
+typedef wN_mat3<w_float> w_mat3;
+
+typedef wN_bounding_sphere<w_float> w_bounding_sphere;
+typedef wN_bounding_capsule<w_float> w_bounding_capsule;
+typedef wN_bounding_cylinder<w_float> w_bounding_cylinder;
+typedef wN_bounding_box<w_float> w_bounding_box;
+typedef wN_bounding_oriented_box<w_float> w_bounding_oriented_box;
+typedef wN_line_segment<w_float> w_line_segment;
+
+
+
+template <typename collider_t>
+static collider_t loadBoundingVolumeSIMD(const collider_union* worldSpaceColliders, physics_index* indices) { static_assert(false); }
+
+template <>
+static w_bounding_sphere loadBoundingVolumeSIMD<w_bounding_sphere>(const collider_union* worldSpaceColliders, physics_index* indices)
+{
+	w_bounding_sphere result;
+	load4((float*)&worldSpaceColliders->sphere, indices, sizeof(collider_union),
+		result.center.x, result.center.y, result.center.z, result.radius);
+	return result;
+}
+
+template <>
+static w_bounding_capsule loadBoundingVolumeSIMD<w_bounding_capsule>(const collider_union* worldSpaceColliders, physics_index* indices)
+{
+	w_bounding_capsule result;
+	w_float dummy;
+	load8((float*)&worldSpaceColliders->capsule, indices, sizeof(collider_union),
+		result.positionA.x, result.positionA.y, result.positionA.z,
+		result.positionB.x, result.positionB.y, result.positionB.z,
+		result.radius, dummy);
+	return result;
+}
+
+template <>
+static w_bounding_cylinder loadBoundingVolumeSIMD<w_bounding_cylinder>(const collider_union* worldSpaceColliders, physics_index* indices)
+{
+	w_bounding_cylinder result;
+	w_float dummy;
+	load8((float*)&worldSpaceColliders->cylinder, indices, sizeof(collider_union),
+		result.positionA.x, result.positionA.y, result.positionA.z,
+		result.positionB.x, result.positionB.y, result.positionB.z,
+		result.radius, dummy);
+	return result;
+}
+
+template <>
+static w_bounding_box loadBoundingVolumeSIMD<w_bounding_box>(const collider_union* worldSpaceColliders, physics_index* indices)
+{
+	w_bounding_box result;
+	w_float dummy0, dummy1;
+	load8((float*)&worldSpaceColliders->aabb, indices, sizeof(collider_union),
+		result.minCorner.x, result.minCorner.y, result.minCorner.z,
+		result.maxCorner.x, result.maxCorner.y, result.maxCorner.z,
+		dummy0, dummy1);
+	return result;
+}
+
+template <>
+static w_bounding_oriented_box loadBoundingVolumeSIMD<w_bounding_oriented_box>(const collider_union* worldSpaceColliders, physics_index* indices)
+{
+	w_bounding_oriented_box result;
+	w_float dummy0, dummy1;
+	load8(&worldSpaceColliders->obb.rotation.x, indices, sizeof(collider_union),
+		result.rotation.x, result.rotation.y, result.rotation.z, result.rotation.w,
+		result.center.x, result.center.y, result.center.z,
+		result.radius.x);
+	load4(&worldSpaceColliders->obb.radius.y, indices, sizeof(collider_union),
+		result.radius.y, result.radius.z,
+		dummy0, dummy1);
+	return result;
+}
+
+
+struct w_collision_contact
+{
+	w_vec3 point;
+	w_float penetrationDepth;
+	w_vec3 normal;
+	uint32 mask;
+	w_float feature = w_float::zero(); // See contactFeature. Exact in floats.
+};
+
+// Per lane result of the box SAT, for the feature cache. Axis indices as in narrowphase_feature::satAxis.
+struct w_sat_feature
+{
+	w_float axis; // The first separating axis of separated lanes, otherwise the axis of minimum penetration.
+	uint32 separatedLanes;
+};
+
+static uint32 intersectionSIMD(const w_bounding_oriented_box& a, const w_bounding_oriented_box& b, w_collision_contact* outContacts,
+	w_sat_feature* outFeature = 0);
+
+// Comparison results. Float masks for SSE and AVX2, bit masks for AVX-512.
+typedef decltype(w_float::zero() < w_float::zero()) w_mask;
+
+// ~ promotes AVX-512 masks to int, which sets the bits above the lanes.
+static w_mask maskNot(w_mask m) { return (w_mask)~m; }
+
+// Rotates the components per lane, so that the selected axis k becomes x: (v[k], v[k + 1], v[k + 2]). k is x where isX is set, y where isY is
+// set and z otherwise.
+static w_vec3 permuteAxes(w_vec3 v, w_mask isX, w_mask isY)
+{
+	return w_vec3(
+		ifThen(isX, v.x, ifThen(isY, v.y, v.z)),
+		ifThen(isX, v.y, ifThen(isY, v.z, v.x)),
+		ifThen(isX, v.z, ifThen(isY, v.x, v.y)));
+}
+
+// Inverse of permuteAxes.
+static w_vec3 unpermuteAxes(w_vec3 v, w_mask isX, w_mask isY)
+{
+	return w_vec3(
+		ifThen(isX, v.x, ifThen(isY, v.z, v.y)),
+		ifThen(isX, v.y, ifThen(isY, v.x, v.z)),
+		ifThen(isX, v.z, ifThen(isY, v.y, v.x)));
+}
+
+
+// Sphere tests.
+static uint32 intersectionSIMD(const w_bounding_sphere& s1, const w_bounding_sphere& s2, w_collision_contact* outContacts)
+{
+	w_vec3 n = s2.center - s1.center;
+	w_float radiusSum = s2.radius + s1.radius;
+	w_float sqDistance = squaredLength(n);
+
+	auto intersects = (sqDistance <= radiusSum * radiusSum);
+	
+	uint32 mask = toBitMask(intersects);
+
+	if (anyTrue(mask))
+	{
+		auto degenerate = (sqDistance == 0.f);
+		w_float distance = ifThen(degenerate, 0.f, sqrt(sqDistance));
+		w_vec3 collisionNormal = ifThen(degenerate, w_vec3(0.f, 1.f, 0.f), n / distance);
+
+		w_float penetrationDepth = radiusSum - distance; // Flipped to change sign.
+		w_vec3 point = w_float(0.5f) * (s1.center + s1.radius * collisionNormal + s2.center - s2.radius * collisionNormal);
+
+		outContacts[0].point = point;
+		outContacts[0].penetrationDepth = penetrationDepth;
+		outContacts[0].normal = collisionNormal;
+		outContacts[0].mask = mask;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static uint32 intersectionSIMD(const w_bounding_sphere& s, const w_bounding_capsule& c, w_collision_contact* outContacts)
+{
+	w_vec3 closestPoint = closestPoint_PointSegment(s.center, w_line_segment{ c.positionA, c.positionB });
+	return intersectionSIMD(s, w_bounding_sphere{ closestPoint, c.radius }, outContacts);
+}
+
+static uint32 intersectionSIMD(const w_bounding_sphere& s, const w_bounding_cylinder& c, w_collision_contact* outContacts)
+{
+	w_vec3 ab = c.positionB - c.positionA;
+	w_float t = dot(s.center - c.positionA, ab) / squaredLength(ab);
+
+	auto tSaturated = t >= 0.f & t <= 1.f;
+
+	int32 tSaturatedMask = toBitMask(tSaturated);
+
+	uint32 sphereSphereTest = 0;
+	uint32 sphereSphereMask = 0;
+	if (anyTrue(tSaturatedMask))
+	{
+		sphereSphereTest = intersectionSIMD(s, w_bounding_sphere{ lerp(c.positionA, c.positionB, t), c.radius }, outContacts);
+
+		// Lanes outside of the cylinder's extent are handled below.
+		sphereSphereMask = sphereSphereTest ? (outContacts[0].mask & tSaturatedMask) : 0;
+		outContacts[0].mask = sphereSphereMask;
+		sphereSphereTest = sphereSphereMask ? sphereSphereTest : 0;
+
+		if (tSaturatedMask == (1 << COLLISION_SIMD_WIDTH) - 1)
+		{
+			return sphereSphereTest;
+		}
+	}
+
+
+
+	w_vec3 p = ifThen(t <= 0.f, c.positionA, c.positionB);
+	w_vec3 up = ifThen(t <= 0.f, -ab, ab);
+
+	w_vec3 projectedDirToCenter = normalize(cross(cross(up, s.center - p), up));
+	w_vec3 endA = p + projectedDirToCenter * c.radius;
+	w_vec3 endB = p - projectedDirToCenter * c.radius;
+
+	w_vec3 closestToSphere = closestPoint_PointSegment(s.center, w_line_segment{ endA, endB });
+	w_vec3 normal = closestToSphere - s.center; // From sphere to cylinder.
+	w_float sqDistance = squaredLength(normal);
+
+	auto intersects = (sqDistance <= s.radius * s.radius);
+
+	uint32 mask = toBitMask(intersects) & ~tSaturatedMask;
+
+	if (mask)
+	{
+		auto degenerate = sqDistance == 0.f;
+
+		w_float distance = ifThen(degenerate, 0.f, sqrt(sqDistance));
+		normal = ifThen(degenerate, -normalize(up), normal / distance);
+		
+		w_float penetrationDepth = s.radius - distance;
+		w_vec3 point = closestToSphere + 0.5f * penetrationDepth * normal;
+
+		if (anyTrue(tSaturatedMask))
+		{
+			point = ifThen(tSaturated, outContacts[0].point, point);
+			penetrationDepth = ifThen(tSaturated, outContacts[0].penetrationDepth, penetrationDepth);
+			normal = ifThen(tSaturated, outContacts[0].normal, normal);
+
+			mask |= sphereSphereMask;
+		}
+
+		outContacts[0].point = point;
+		outContacts[0].penetrationDepth = penetrationDepth;
+		outContacts[0].normal = normal;
+		outContacts[0].mask = mask;
+		
+		return 1;
+	}
+
+	return sphereSphereTest;
+}
+
+static uint32 intersectionSIMD(const w_bounding_sphere& s, const w_bounding_box& a, w_collision_contact* outContacts)
+{
+	w_vec3 p = closestPoint_PointAABB(s.center, a);
+	w_vec3 n = p - s.center;
+	w_float sqDistance = squaredLength(n);
+
+	auto intersects = sqDistance <= s.radius * s.radius;
+
+	uint32 mask = toBitMask(intersects);
+
+	if (anyTrue(mask))
+	{
+		auto valid = (sqDistance > 0.f);
+		w_float dist = ifThen(valid, sqrt(sqDistance), 0.f);
+		n = ifThen(valid, n / dist, w_vec3(0.f, 1.f, 0.f));
+
+		outContacts[0].point = w_float(0.5f) * (p + s.center + n * s.radius);
+		outContacts[0].penetrationDepth = s.radius - dist; // Flipped to change sign.
+		outContacts[0].normal = n;
+		outContacts[0].mask = mask;
+
+		return 1;
+	}
+	return 0;
+}
+
+static uint32 intersectionSIMD(const w_bounding_sphere& s, const w_bounding_oriented_box& o, w_collision_contact* outContacts)
+{
+	w_bounding_box aabb = w_bounding_box::fromCenterRadius(o.center, o.radius);
+	w_bounding_sphere s_ = {
+		conjugate(o.rotation) * (s.center - o.center) + o.center,
+		s.radius };
+
+	uint32 result = intersectionSIMD(s_, aabb, outContacts);
+
+	if (result)
+	{
+		outContacts[0].normal = o.rotation * outContacts[0].normal;
+		outContacts[0].point = o.rotation * (outContacts[0].point - o.center) + o.center;
+		return 1;
+	}
+	return 0;
+}
+
+// Capsule tests.
+
+// Parallel axes, as in the scalar tests. b's segment is flipped to point along a's, and both are projected onto a's axis. Where the projections
+// are disjoint (the returned lanes), the shapes can only touch end to end, and outEndA and outEndB are the facing ends. Otherwise outA0 to
+// outA1 is the overlap on a's axis, and outB0 to outB1 the same stretch on b's.
+static w_mask parallelSegmentsSIMD(w_vec3 aA, w_vec3 aB, w_vec3 bA, w_vec3 bB, w_vec3 aDir, w_float aDirLength, w_float alignment,
+	w_vec3& outEndA, w_vec3& outEndB, w_vec3& outA0, w_vec3& outA1, w_vec3& outB0, w_vec3& outB1)
+{
+	auto swap = alignment < 0.f;
+	w_vec3 pBa = ifThen(swap, bB, bA);
+	w_vec3 pBb = ifThen(swap, bA, bB);
+
+	w_vec3 referencePoint = aA;
+
+	w_float a0 = 0.f;
+	w_float a1 = aDirLength;
+
+	w_float b0 = dot(aDir, pBa - referencePoint);
+	w_float b1 = dot(aDir, pBb - referencePoint);
+
+	w_float left = maximum(a0, b0);
+	w_float right = minimum(a1, b1);
+
+	auto aAfterB = a0 > b1;
+	outEndA = ifThen(aAfterB, aA, aB);
+	outEndB = ifThen(aAfterB, pBb, pBa);
+
+	outA0 = referencePoint + left * aDir;
+	outA1 = referencePoint + right * aDir;
+
+	outB0 = closestPoint_PointSegment(outA0, w_line_segment{ pBa, pBb });
+	outB1 = outB0 + (right - left) * aDir;
+
+	return right < left;
+}
+
+// Two contacts along the overlap of parallel axes, see parallelSegmentsSIMD. Only the given lanes are set in the masks.
+static void tubeContactsSIMD(w_vec3 a0, w_vec3 a1, w_vec3 b0, w_vec3 b1, w_float radiusSum, uint32 lanes, w_collision_contact* outContacts)
+{
+	w_vec3 normal = b0 - a0;
+	w_float d = length(normal);
+
+	auto degenerate = (d < EPSILON);
+
+	d = ifThen(degenerate, 0.f, d);
+	normal = ifThen(degenerate, w_vec3(0.f, 1.f, 0.f), normal / d);
+
+	w_float penetration = radiusSum - d;
+	uint32 mask = toBitMask(penetration >= 0.f) & lanes;
+
+	outContacts[0].point = (a0 + b0) * w_float(0.5f);
+	outContacts[0].penetrationDepth = penetration;
+	outContacts[0].normal = normal;
+	outContacts[0].mask = mask;
+
+	outContacts[1].point = (a1 + b1) * w_float(0.5f);
+	outContacts[1].penetrationDepth = penetration;
+	outContacts[1].normal = normal;
+	outContacts[1].mask = mask;
+}
+
+// Lanes have either the single contact or the two tube contacts.
+static uint32 writeCapsuleContacts(const w_collision_contact& single, const w_collision_contact* tube, w_mask isTube, w_collision_contact* outContacts)
+{
+	if (!(single.mask | tube[0].mask))
+	{
+		return 0;
+	}
+
+	outContacts[0].point = ifThen(isTube, tube[0].point, single.point);
+	outContacts[0].penetrationDepth = ifThen(isTube, tube[0].penetrationDepth, single.penetrationDepth);
+	outContacts[0].normal = ifThen(isTube, tube[0].normal, single.normal);
+	outContacts[0].mask = single.mask | tube[0].mask;
+
+	if (!tube[1].mask)
+	{
+		return 1;
+	}
+
+	outContacts[1] = tube[1];
+	return 2;
+}
+
+static uint32 intersectionSIMD(const w_bounding_capsule& a, const w_bounding_capsule& b, w_collision_contact* outContacts)
+{
+	w_vec3 aDir = a.positionB - a.positionA;
+	w_vec3 bDir = normalize(b.positionB - b.positionA);
+
+	w_float aDirLength = length(aDir);
+	aDir *= 1.f / aDirLength;
+
+	w_float alignment = dot(aDir, bDir);
+
+	w_mask parallel = (abs(alignment) > 0.99f);
+	uint32 parallelMask = toBitMask(parallel);
+
+	w_collision_contact single = {};
+	w_collision_contact tube[2] = {};
+	w_mask isTube = parallel & maskNot(parallel);
+
+	if (parallelMask != (1 << COLLISION_SIMD_WIDTH) - 1)
+	{
+		w_vec3 closestPoint1, closestPoint2;
+		closestPoint_SegmentSegment(w_line_segment{ a.positionA, a.positionB }, w_line_segment{ b.positionA, b.positionB }, closestPoint1, closestPoint2);
+		intersectionSIMD(w_bounding_sphere{ closestPoint1, a.radius }, w_bounding_sphere{ closestPoint2, b.radius }, &single);
+		single.mask &= ~parallelMask;
+	}
+
+	if (parallelMask)
+	{
+		w_vec3 endA, endB, a0, a1, b0, b1;
+		w_mask endToEnd = parallel & parallelSegmentsSIMD(a.positionA, a.positionB, b.positionA, b.positionB, aDir, aDirLength, alignment,
+			endA, endB, a0, a1, b0, b1);
+		uint32 endToEndMask = toBitMask(endToEnd);
+
+		w_collision_contact contact;
+		if (endToEndMask && intersectionSIMD(w_bounding_sphere{ endA, a.radius }, w_bounding_sphere{ endB, b.radius }, &contact))
+		{
+			single.point = ifThen(endToEnd, contact.point, single.point);
+			single.penetrationDepth = ifThen(endToEnd, contact.penetrationDepth, single.penetrationDepth);
+			single.normal = ifThen(endToEnd, contact.normal, single.normal);
+			single.mask |= contact.mask & endToEndMask;
+		}
+
+		isTube = parallel & maskNot(endToEnd);
+		tubeContactsSIMD(a0, a1, b0, b1, a.radius + b.radius, toBitMask(isTube), tube);
+	}
+
+	return writeCapsuleContacts(single, tube, isTube, outContacts);
+}
+
+static uint32 intersectionSIMD(const w_bounding_capsule& a, const w_bounding_cylinder& b, w_collision_contact* outContacts)
+{
+	w_vec3 aDir = a.positionB - a.positionA;
+	w_vec3 bDir = normalize(b.positionB - b.positionA);
+
+	w_float aDirLength = length(aDir);
+	aDir *= 1.f / aDirLength;
+
+	w_float alignment = dot(aDir, bDir);
+
+	w_mask parallel = (abs(alignment) > 0.99f);
+	uint32 parallelMask = toBitMask(parallel);
+
+	w_collision_contact single = {};
+	w_collision_contact tube[2] = {};
+	w_mask isTube = parallel & maskNot(parallel);
+
+	if (parallelMask != (1 << COLLISION_SIMD_WIDTH) - 1)
+	{
+		w_vec3 closestPoint1, closestPoint2;
+		closestPoint_SegmentSegment(w_line_segment{ a.positionA, a.positionB }, w_line_segment{ b.positionA, b.positionB }, closestPoint1, closestPoint2);
+		intersectionSIMD(w_bounding_sphere{ closestPoint1, a.radius }, b, &single);
+		single.mask &= ~parallelMask;
+	}
+
+	if (parallelMask)
+	{
+		w_vec3 endA, endB, a0, a1, b0, b1;
+		w_mask endToEnd = parallel & parallelSegmentsSIMD(a.positionA, a.positionB, b.positionA, b.positionB, aDir, aDirLength, alignment,
+			endA, endB, a0, a1, b0, b1);
+		uint32 endToEndMask = toBitMask(endToEnd);
+
+		w_collision_contact contact;
+		if (endToEndMask && intersectionSIMD(w_bounding_sphere{ endA, a.radius }, b, &contact))
+		{
+			single.point = ifThen(endToEnd, contact.point, single.point);
+			single.penetrationDepth = ifThen(endToEnd, contact.penetrationDepth, single.penetrationDepth);
+			single.normal = ifThen(endToEnd, contact.normal, single.normal);
+			single.mask |= contact.mask & endToEndMask;
+		}
+
+		isTube = parallel & maskNot(endToEnd);
+		tubeContactsSIMD(a0, a1, b0, b1, a.radius + b.radius, toBitMask(isTube), tube);
+	}
+
+	return writeCapsuleContacts(single, tube, isTube, outContacts);
+}
+
+// Unlike the scalar test, this doesn't go through GJK and EPA. The closest points of the segment and the box are found exactly: The derivative
+// of the squared distance along the segment is piecewise linear and nondecreasing, with kinks where the segment enters or leaves the box's
+// slabs, so its root is interpolated between the two kinks around it. Segments which touch the box are pushed out along the axis of least
+// penetration instead. Segments lying flat on a face get two contacts, just like in the scalar test.
+static uint32 intersectionSIMD(const w_bounding_capsule& c, const w_bounding_box& a, w_collision_contact* outContacts)
+{
+	w_float zero = w_float::zero();
+
+	w_vec3 center = (a.minCorner + a.maxCorner) * w_float(0.5f);
+	w_vec3 radius = (a.maxCorner - a.minCorner) * w_float(0.5f);
+
+	// Relative to the box center.
+	w_vec3 p0 = c.positionA - center;
+	w_vec3 p1 = c.positionB - center;
+	w_vec3 d = p1 - p0;
+
+	auto clampToBox = [&](w_vec3 p)
+	{
+		return w_vec3(clamp(p.x, -radius.x, radius.x), clamp(p.y, -radius.y, radius.y), clamp(p.z, -radius.z, radius.z));
+	};
+
+	// Half of the derivative of the squared distance.
+	auto distanceDerivative = [&](w_float t)
+	{
+		w_vec3 p = p0 + d * t;
+		return dot(d, p - clampToBox(p));
+	};
+
+	w_float tLo = zero;
+	w_float fLo = distanceDerivative(tLo);
+	w_float tHi = 1.f;
+	w_float fHi = distanceDerivative(tHi);
+
+	for (uint32 k = 0; k < 3; ++k)
+	{
+		for (uint32 side = 0; side < 2; ++side)
+		{
+			w_float bound = side ? radius.data[k] : -radius.data[k];
+			w_float t = clamp01(ifThen(d.data[k] != 0.f, (bound - p0.data[k]) / d.data[k], zero));
+			w_float f = distanceDerivative(t);
+
+			auto below = (f <= 0.f) & (t > tLo);
+			tLo = ifThen(below, t, tLo);
+			fLo = ifThen(below, f, fLo);
+
+			auto above = (f >= 0.f) & (t < tHi);
+			tHi = ifThen(above, t, tHi);
+			fHi = ifThen(above, f, fHi);
+		}
+	}
+
+	// If the derivative doesn't change its sign on the segment, this extrapolates beyond the ends, which the clamp takes care of.
+	w_float slope = fHi - fLo;
+	w_float t = clamp01(ifThen(slope > 0.f, tLo - fLo * (tHi - tLo) / slope, tLo));
+
+	w_vec3 segmentPoint = p0 + d * t;
+	w_vec3 boxPoint = clampToBox(segmentPoint);
+	w_vec3 n = boxPoint - segmentPoint;
+	w_float sqDistance = squaredLength(n);
+
+	uint32 mask = toBitMask(sqDistance <= c.radius * c.radius);
+	if (!mask)
+	{
+		return 0;
+	}
+
+	auto shallow = sqDistance > 1e-8f;
+	w_float distance = sqrt(sqDistance);
+
+	w_vec3 normal = n / distance;
+	w_float penetration = c.radius - distance;
+	w_vec3 point = (boxPoint + segmentPoint + normal * c.radius) * w_float(0.5f);
+
+	if ((toBitMask(shallow) & mask) != mask)
+	{
+		// The segment touches the box. Candidate axes are the box's axes and their cross products with the segment.
+		w_float minPenetration = FLT_MAX;
+		w_vec3 deepNormal(0.f, 1.f, 0.f);
+
+		for (uint32 k = 0; k < 3; ++k)
+		{
+			w_vec3 axis(k == 0 ? 1.f : 0.f, k == 1 ? 1.f : 0.f, k == 2 ? 1.f : 0.f);
+
+			w_float penetrationPos = maximum(p0.data[k], p1.data[k]) + c.radius + radius.data[k];
+			w_float penetrationNeg = radius.data[k] - minimum(p0.data[k], p1.data[k]) + c.radius;
+
+			auto better = penetrationPos < minPenetration;
+			minPenetration = ifThen(better, penetrationPos, minPenetration);
+			deepNormal = ifThen(better, axis, deepNormal);
+
+			better = penetrationNeg < minPenetration;
+			minPenetration = ifThen(better, penetrationNeg, minPenetration);
+			deepNormal = ifThen(better, -axis, deepNormal);
+		}
+
+		w_float sqSegmentLength = squaredLength(d);
+		for (uint32 k = 0; k < 3; ++k)
+		{
+			w_vec3 axis = cross(d, w_vec3(k == 0 ? 1.f : 0.f, k == 1 ? 1.f : 0.f, k == 2 ? 1.f : 0.f));
+			w_float sqAxisLength = squaredLength(axis);
+			auto valid = sqAxisLength > 1e-6f * sqSegmentLength;
+			axis = axis / sqrt(sqAxisLength);
+
+			// The segment projects onto a single point.
+			w_float projected = dot(p0, axis);
+			w_float extent = dot(abs(axis), radius);
+
+			w_float penetrationPos = extent + projected + c.radius;
+			w_float penetrationNeg = extent - projected + c.radius;
+
+			auto better = valid & (penetrationPos < minPenetration);
+			minPenetration = ifThen(better, penetrationPos, minPenetration);
+			deepNormal = ifThen(better, axis, deepNormal);
+
+			better = valid & (penetrationNeg < minPenetration);
+			minPenetration = ifThen(better, penetrationNeg, minPenetration);
+			deepNormal = ifThen(better, -axis, deepNormal);
+		}
+
+		normal = ifThen(shallow, normal, deepNormal);
+		penetration = ifThen(shallow, penetration, minPenetration);
+		point = ifThen(shallow, point, segmentPoint + deepNormal * (c.radius - w_float(0.5f) * minPenetration));
+	}
+
+	outContacts[0].point = point + center;
+	outContacts[0].penetrationDepth = penetration;
+	outContacts[0].normal = normal;
+	outContacts[0].mask = mask;
+
+	// Capsule parallel to a box face (perpendicular to the normal): The segment is clipped to the face, see the scalar test.
+	w_vec3 absNormal = abs(normal);
+	auto faceNormal = (absNormal.x > 0.99f) | (absNormal.y > 0.99f) | (absNormal.z > 0.99f);
+	auto parallelToFace = abs(dot(normal, d)) < 0.01f * length(d);
+
+	w_mask flat = faceNormal & parallelToFace;
+	uint32 flatMask = toBitMask(flat) & mask;
+	if (!flatMask)
+	{
+		return 1;
+	}
+
+	w_vec3 boxNormal = -normal;
+	w_vec3 corner(
+		ifThen(boxNormal.x < 0.f, -radius.x, radius.x),
+		ifThen(boxNormal.y < 0.f, -radius.y, radius.y),
+		ifThen(boxNormal.z < 0.f, -radius.z, radius.z));
+	w_float planeDistance = dot(boxNormal, corner);
+
+	w_vec3 pa = p0 + normal * c.radius;
+	w_vec3 pb = p1 + normal * c.radius;
+	w_float depthA = planeDistance - dot(boxNormal, pa);
+	w_float depthB = planeDistance - dot(boxNormal, pb);
+
+	// Clip against the slabs of the two axes spanning the face, see getAABBClippingPlanes.
+	auto xGreaterY = absNormal.x > absNormal.y;
+	w_mask isX = xGreaterY & (absNormal.x > absNormal.z);
+	w_mask isY = maskNot(xGreaterY) & (absNormal.y > absNormal.z);
+
+	w_vec3 localA = permuteAxes(pa, isX, isY);
+	w_vec3 localB = permuteAxes(pb, isX, isY);
+	w_vec3 localRadius = permuteAxes(radius, isX, isY);
+
+	w_float tMin = zero;
+	w_float tMax = 1.f;
+	w_mask outside = (zero < zero);
+	for (uint32 k = 1; k < 3; ++k)
+	{
+		w_float x = localA.data[k];
+		w_float delta = localB.data[k] - x;
+		w_float h = localRadius.data[k];
+
+		auto moving = delta != 0.f;
+		w_float t0 = (-h - x) / delta;
+		w_float t1 = (h - x) / delta;
+
+		tMin = ifThen(moving, maximum(tMin, minimum(t0, t1)), tMin);
+		tMax = ifThen(moving, minimum(tMax, maximum(t0, t1)), tMax);
+		outside = outside | (maskNot(moving) & (abs(x) > h));
+	}
+
+	w_mask clipped = flat & maskNot(outside) & (tMin <= tMax);
+
+	w_float depth0 = depthA + (depthB - depthA) * tMin;
+	w_float depth1 = depthA + (depthB - depthA) * tMax;
+	w_mask keep0 = clipped & (depth0 >= 0.f);
+	w_mask keep1 = clipped & (depth1 >= 0.f);
+
+	// Projected onto the face.
+	w_vec3 point0 = lerp(pa, pb, tMin) + boxNormal * depth0 + center;
+	w_vec3 point1 = lerp(pa, pb, tMax) + boxNormal * depth1 + center;
+
+	// Lanes without clipped points keep the single contact, like clipPointsAndBuildContact.
+	outContacts[0].point = ifThen(keep0, point0, ifThen(keep1, point1, outContacts[0].point));
+	outContacts[0].penetrationDepth = ifThen(keep0, depth0, ifThen(keep1, depth1, outContacts[0].penetrationDepth));
+
+	uint32 secondMask = toBitMask(keep0 & keep1) & mask;
+	if (!secondMask)
+	{
+		return 1;
+	}
+
+	outContacts[1].point = point1;
+	outContacts[1].penetrationDepth = depth1;
+	outContacts[1].normal = normal;
+	outContacts[1].mask = secondMask;
+
+	return 2;
+}
+
+static uint32 intersectionSIMD(const w_bounding_capsule& c, const w_bounding_oriented_box& o, w_collision_contact* outContacts)
+{
+	w_bounding_box aabb = w_bounding_box::fromCenterRadius(o.center, o.radius);
+	w_quat invRotation = conjugate(o.rotation);
+	w_bounding_capsule c_ = {
+		invRotation * (c.positionA - o.center) + o.center,
+		invRotation * (c.positionB - o.center) + o.center,
+		c.radius };
+
+	uint32 numContacts = intersectionSIMD(c_, aabb, outContacts);
+
+	for (uint32 i = 0; i < numContacts; ++i)
+	{
+		outContacts[i].normal = o.rotation * outContacts[i].normal;
+		outContacts[i].point = o.rotation * (outContacts[i].point - o.center) + o.center;
+	}
+	return numContacts;
+}
+
+// AABB tests.
+static uint32 intersectionSIMD(const w_bounding_box& a, const w_bounding_box& b, w_collision_contact* outContacts)
+{
+	w_vec3 centerA = (a.minCorner + a.maxCorner) * w_float(0.5f);
+	w_vec3 centerB = (b.minCorner + b.maxCorner) * w_float(0.5f);
+
+	w_vec3 radiusA = (a.maxCorner - a.minCorner) * w_float(0.5f);
+	w_vec3 radiusB = (b.maxCorner - b.minCorner) * w_float(0.5f);
+
+	w_vec3 d = centerB - centerA;
+	w_vec3 p = (radiusB + radiusA) - abs(d);
+
+	uint32 mask = toBitMask(p.x >= 0.f) & toBitMask(p.y >= 0.f) & toBitMask(p.z >= 0.f);
+	if (!mask)
+	{
+		return 0;
+	}
+
+	// Axis of least penetration, with the same tie breaking as the scalar test. Everything below is permuted, so that this axis is x.
+	auto xLessY = p.x < p.y;
+	w_mask isX = xLessY & (p.x < p.z);
+	w_mask isY = maskNot(xLessY) & (p.y < p.z);
+
+	w_float s = ifThen(permuteAxes(d, isX, isY).x < 0.f, w_float(-1.f), w_float(1.f));
+	w_float penetration = permuteAxes(p, isX, isY).x;
+	w_vec3 normal = unpermuteAxes(w_vec3(s, 0.f, 0.f), isX, isY);
+
+	// Halfway into the overlap, on the side of a which faces b.
+	w_float depth = permuteAxes(centerA, isX, isY).x + s * (permuteAxes(radiusA, isX, isY).x - penetration * 0.5f);
+
+	w_vec3 overlapMin = permuteAxes(w_vec3(
+		maximum(a.minCorner.x, b.minCorner.x), maximum(a.minCorner.y, b.minCorner.y), maximum(a.minCorner.z, b.minCorner.z)), isX, isY);
+	w_vec3 overlapMax = permuteAxes(w_vec3(
+		minimum(a.maxCorner.x, b.maxCorner.x), minimum(a.maxCorner.y, b.maxCorner.y), minimum(a.maxCorner.z, b.maxCorner.z)), isX, isY);
+
+	w_vec3 points[] =
+	{
+		w_vec3(depth, overlapMin.y, overlapMin.z),
+		w_vec3(depth, overlapMin.y, overlapMax.z),
+		w_vec3(depth, overlapMax.y, overlapMin.z),
+		w_vec3(depth, overlapMax.y, overlapMax.z),
+	};
+
+	// The contacts are the corners of the overlap on a's face, see the scalar test.
+	w_float face = ifThen(isX, w_float(0.f), ifThen(isY, w_float(2.f), w_float(4.f))) + ifThen(s < 0.f, w_float(1.f), w_float::zero());
+
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		outContacts[i].point = unpermuteAxes(points[i], isX, isY);
+		outContacts[i].penetrationDepth = penetration;
+		outContacts[i].normal = normal;
+		outContacts[i].mask = mask;
+		outContacts[i].feature = (w_float(1.f) + face * 8.f) * 2048.f + w_float((float)contactFeatureVertex(i));
+	}
+
+	return 4;
+}
+
+static uint32 intersectionSIMD(const w_bounding_box& a, const w_bounding_oriented_box& b, w_collision_contact* outContacts,
+	w_sat_feature* outFeature = 0)
+{
+	// Forwarded to OBB vs OBB, just like the scalar test.
+	w_bounding_oriented_box o = { (a.minCorner + a.maxCorner) * w_float(0.5f), (a.maxCorner - a.minCorner) * w_float(0.5f), w_quat::identity() };
+	return intersectionSIMD(o, b, outContacts, outFeature);
+}
+
+// OBB tests.
+
+// Columns of the rotation matrix, i.e. the box axes in world space.
+static void getBoxAxes(w_quat q, w_vec3* outAxes)
+{
+	w_float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	w_float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	w_float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	outAxes[0] = w_vec3(1.f - 2.f * (yy + zz), 2.f * (xy + wz), 2.f * (xz - wy));
+	outAxes[1] = w_vec3(2.f * (xy - wz), 1.f - 2.f * (xx + zz), 2.f * (yz + wx));
+	outAxes[2] = w_vec3(2.f * (xz + wy), 2.f * (yz - wx), 1.f - 2.f * (xx + yy));
+}
+
+static w_vec3 localVector(const w_vec3* axes, w_vec3 v)
+{
+	return w_vec3(dot(axes[0], v), dot(axes[1], v), dot(axes[2], v));
+}
+
+static w_vec3 boxToWorld(const w_vec3* axes, w_vec3 center, w_vec3 v)
+{
+	return center + axes[0] * v.x + axes[1] * v.y + axes[2] * v.z;
+}
+
+// See getAABBIncidentEdge.
+static void getBoxIncidentEdge(w_vec3 radius, w_vec3 normal, w_vec3& outA, w_vec3& outB)
+{
+	w_vec3 p = abs(normal);
+
+	auto xGreaterY = p.x > p.y;
+	w_mask flipZ = (xGreaterY & (p.y > p.z)) | (maskNot(xGreaterY) & (p.x > p.z));
+	w_mask flipY = xGreaterY & maskNot(flipZ);
+	w_mask flipX = maskNot(xGreaterY | flipZ);
+
+	w_vec3 s(
+		ifThen(normal.x < 0.f, w_float(-1.f), w_float(1.f)),
+		ifThen(normal.y < 0.f, w_float(-1.f), w_float(1.f)),
+		ifThen(normal.z < 0.f, w_float(-1.f), w_float(1.f)));
+
+	outA = radius * s;
+	outB = w_vec3(ifThen(flipX, -radius.x, radius.x), ifThen(flipY, -radius.y, radius.y), ifThen(flipZ, -radius.z, radius.z)) * s;
+}
+
+// Point of the clipped contact polygon, in the coordinates of the reference face.
+struct w_face_point
+{
+	w_float x, y;
+	w_float depth;
+	w_float feature; // Clipped feature, see contactFeature.
+	w_mask valid;
+};
+
+// Relative pose of two boxes for the SAT, see the scalar test.
+struct w_box_sat_frame
+{
+	w_vec3 axesA[3], axesB[3];
+	w_float r[3][3]; // Rotation of b in a's local space.
+	w_float absR[3][3];
+	w_mask parallel; // Edge axes are skipped for (nearly) parallel boxes.
+	w_vec3 tw; // From a to b, in world space.
+	w_float t[3]; // From a to b, in a's local space.
+};
+
+static w_box_sat_frame getBoxSATFrame(const w_bounding_oriented_box& a, const w_bounding_oriented_box& b)
+{
+	w_float zero = w_float::zero();
+
+	w_box_sat_frame f;
+	getBoxAxes(a.rotation, f.axesA);
+	getBoxAxes(b.rotation, f.axesB);
+
+	f.parallel = (zero < zero);
+	for (uint32 i = 0; i < 3; ++i)
+	{
+		for (uint32 j = 0; j < 3; ++j)
+		{
+			f.r[i][j] = dot(f.axesA[i], f.axesB[j]);
+			f.absR[i][j] = abs(f.r[i][j]) + EPSILON; // See scalar test.
+			f.parallel = f.parallel | (f.absR[i][j] >= 0.99f);
+		}
+	}
+
+	f.tw = b.center - a.center;
+	for (uint32 i = 0; i < 3; ++i)
+	{
+		f.t[i] = dot(f.axesA[i], f.tw);
+	}
+	return f;
+}
+
+// Penetration along one of the 15 SAT axes (see narrowphase_feature::satAxis). Negative, if the axis separates the boxes. The normal is in a's
+// local space. Same as obbAxisPenetration in the scalar test, except that parallel lanes are not caught here, see w_box_sat_frame::parallel.
+static w_float boxAxisPenetrationSIMD(const w_box_sat_frame& f, const w_bounding_oriented_box& a, const w_bounding_oriented_box& b, uint32 axis,
+	w_vec3& outNormal)
+{
+	if (axis < 3)
+	{
+		uint32 i = axis;
+		w_float rb = f.absR[i][0] * b.radius.x + f.absR[i][1] * b.radius.y + f.absR[i][2] * b.radius.z;
+		outNormal = w_vec3(i == 0 ? 1.f : 0.f, i == 1 ? 1.f : 0.f, i == 2 ? 1.f : 0.f);
+		return a.radius.data[i] + rb - abs(f.t[i]);
+	}
+	if (axis < 6)
+	{
+		uint32 j = axis - 3;
+		w_float ra = f.absR[0][j] * a.radius.x + f.absR[1][j] * a.radius.y + f.absR[2][j] * a.radius.z;
+		w_float d = f.r[0][j] * f.t[0] + f.r[1][j] * f.t[1] + f.r[2][j] * f.t[2];
+		outNormal = w_vec3(f.r[0][j], f.r[1][j], f.r[2][j]);
+		return ra + b.radius.data[j] - abs(d);
+	}
+
+	// a_i x b_j.
+	uint32 i = (axis - 6) / 3;
+	uint32 j = (axis - 6) % 3;
+	uint32 i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+	uint32 j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+
+	w_float ra = a.radius.data[i1] * f.absR[i2][j] + a.radius.data[i2] * f.absR[i1][j];
+	w_float rb = b.radius.data[j1] * f.absR[i][j2] + b.radius.data[j2] * f.absR[i][j1];
+	w_float d = f.t[i2] * f.r[i1][j] - f.t[i1] * f.r[i2][j];
+
+	w_vec3 normal = w_vec3::zero();
+	normal.data[i1] = -f.r[i2][j];
+	normal.data[i2] = f.r[i1][j];
+
+	w_float l = length(normal);
+	outNormal = normal / l;
+	return (ra + rb - abs(d)) / l;
+}
+
+// Tests each lane along its axis from last frame's feature cache (-1 for none) and returns the lanes it still separates. Like the scalar test,
+// which tests the cached axis first. Only the axes which occur in the batch are evaluated.
+static w_mask separatedByCachedAxisSIMD(const w_bounding_oriented_box& a, const w_bounding_oriented_box& b, w_float cachedAxis)
+{
+	w_float zero = w_float::zero();
+	w_box_sat_frame f = getBoxSATFrame(a, b);
+
+	w_mask separated = (zero < zero);
+	for (uint32 axis = 0; axis < 15; ++axis)
+	{
+		w_mask lanes = (cachedAxis == w_float((float)axis));
+		if (axis >= 6)
+		{
+			lanes = lanes & maskNot(f.parallel);
+		}
+
+		if (toBitMask(lanes))
+		{
+			w_vec3 normal;
+			w_float penetration = boxAxisPenetrationSIMD(f, a, b, axis, normal);
+			separated = separated | (lanes & (penetration < 0.f));
+		}
+	}
+	return separated;
+}
+
+static w_mask separatedByCachedAxisSIMD(const w_bounding_box& a, const w_bounding_oriented_box& b, w_float cachedAxis)
+{
+	// AABBs are unrotated boxes, see intersectionSIMD.
+	w_bounding_oriented_box o = { (a.minCorner + a.maxCorner) * w_float(0.5f), (a.maxCorner - a.minCorner) * w_float(0.5f), w_quat::identity() };
+	return separatedByCachedAxisSIMD(o, b, cachedAxis);
+}
+
+// Same SAT as the scalar test. It does not start with a cached feature, since the pairs which their cached axis still separates have already been
+// dropped (see separatedByCachedAxisSIMD), but reports what it found (see boxCollisionSIMD).
+// Face contacts are clipped in the 2D coordinates of the reference face: The clipped polygon consists of the incident vertices inside the reference face, the crossings of the incident edges with the face's borders, and the face's corners inside the incident
+// face. These are tested as fixed candidates, instead of running Sutherland-Hodgman per lane.
+static uint32 intersectionSIMD(const w_bounding_oriented_box& a, const w_bounding_oriented_box& b, w_collision_contact* outContacts,
+	w_sat_feature* outFeature)
+{
+	w_float zero = w_float::zero();
+	w_mask all = (zero == zero);
+	w_mask none = (zero < zero);
+
+	w_box_sat_frame f = getBoxSATFrame(a, b);
+	const w_vec3* axesA = f.axesA;
+	const w_vec3* axesB = f.axesB;
+	w_vec3 tw = f.tw;
+
+	// Axis index as in narrowphase_feature::satAxis.
+	w_mask separated = none;
+	w_float separatingAxis = zero;
+	w_float minPenetration = FLT_MAX;
+	w_float minAxis = zero;
+	w_vec3 localNormal(0.f, 1.f, 0.f);
+
+	auto testAxis = [&](uint32 axis, w_mask valid)
+	{
+		w_vec3 normal;
+		w_float penetration = boxAxisPenetrationSIMD(f, a, b, axis, normal);
+
+		// The scalar test stops at the first separating axis, so that one is reported.
+		w_mask separatedHere = valid & (penetration < 0.f);
+		separatingAxis = ifThen(separatedHere & maskNot(separated), w_float((float)axis), separatingAxis);
+		separated = separated | separatedHere;
+
+		w_mask better = valid & (penetration < minPenetration);
+		minPenetration = ifThen(better, penetration, minPenetration);
+		minAxis = ifThen(better, w_float((float)axis), minAxis);
+		localNormal = ifThen(better, normal, localNormal);
+	};
+
+	// Test a's and b's faces.
+	for (uint32 axis = 0; axis < 6; ++axis)
+	{
+		testAxis(axis, all);
+	}
+
+	auto writeFeature = [&]()
+	{
+		if (outFeature)
+		{
+			outFeature->axis = ifThen(separated, separatingAxis, minAxis);
+			outFeature->separatedLanes = toBitMask(separated);
+		}
+	};
+
+	uint32 allLanes = (1 << COLLISION_SIMD_WIDTH) - 1;
+	if (toBitMask(separated) == allLanes)
+	{
+		writeFeature();
+		return 0;
+	}
+
+	// Test a_i x b_j. Skipped for (nearly) parallel boxes.
+	w_mask notParallel = maskNot(f.parallel);
+	if (toBitMask(notParallel))
+	{
+		for (uint32 axis = 6; axis < 15; ++axis)
+		{
+			testAxis(axis, notParallel);
+		}
+	}
+
+	writeFeature();
+
+	uint32 mask = ~toBitMask(separated) & allLanes;
+	if (!mask)
+	{
+		return 0;
+	}
+
+	// World space, pointing from a to b.
+	w_vec3 normal = boxToWorld(axesA, w_vec3::zero(), localNormal);
+	normal = ifThen(dot(normal, tw) < 0.f, -normal, normal);
+
+	w_mask edge = (minAxis >= 6.f);
+	w_mask bFace = maskNot(edge) & (minAxis >= 3.f);
+
+	uint32 edgeMask = toBitMask(edge) & mask;
+	uint32 faceMask = ~toBitMask(edge) & mask;
+
+	w_collision_contact edgeContact;
+	if (edgeMask)
+	{
+		w_vec3 a0, a1, b0, b1;
+		getBoxIncidentEdge(a.radius, localVector(axesA, normal), a0, a1);
+		getBoxIncidentEdge(b.radius, localVector(axesB, -normal), b0, b1);
+
+		a0 = boxToWorld(axesA, a.center, a0);
+		a1 = boxToWorld(axesA, a.center, a1);
+		b0 = boxToWorld(axesB, b.center, b0);
+		b1 = boxToWorld(axesB, b.center, b1);
+
+		w_vec3 pa, pb;
+		w_float sqDistance = closestPoint_SegmentSegment(w_line_segment{ a0, a1 }, w_line_segment{ b0, b1 }, pa, pb);
+
+		edgeContact.point = (pa + pb) * w_float(0.5f);
+		edgeContact.penetrationDepth = sqrt(sqDistance);
+		edgeContact.normal = normal;
+		edgeContact.mask = edgeMask;
+		edgeContact.feature = w_float((float)contactFeatureEdgeEdge(0)) + minAxis;
+
+		if (!faceMask)
+		{
+			outContacts[0] = edgeContact;
+			return 1;
+		}
+	}
+
+	// Reference face of a or b, and the incident face of the other box.
+	w_vec3 refAxes[3], incAxes[3];
+	for (uint32 k = 0; k < 3; ++k)
+	{
+		refAxes[k] = ifThen(bFace, axesB[k], axesA[k]);
+		incAxes[k] = ifThen(bFace, axesA[k], axesB[k]);
+	}
+	w_vec3 refCenter = ifThen(bFace, b.center, a.center);
+	w_vec3 incCenter = ifThen(bFace, a.center, b.center);
+	w_vec3 refRadius = ifThen(bFace, b.radius, a.radius);
+	w_vec3 incRadius = ifThen(bFace, a.radius, b.radius);
+	w_vec3 refNormal = ifThen(bFace, -normal, normal);
+
+	w_float faceAxis = minAxis - ifThen(bFace, w_float(3.f), zero);
+	w_mask refX = (faceAxis == 0.f);
+	w_mask refY = (faceAxis == 1.f);
+
+	// Tangents of the reference face, see getAABBClippingPlanes.
+	w_vec3 refU = ifThen(refX, refAxes[1], ifThen(refY, refAxes[2], refAxes[0]));
+	w_vec3 refV = ifThen(refX, refAxes[2], ifThen(refY, refAxes[0], refAxes[1]));
+	w_vec3 refFaceRadius = permuteAxes(refRadius, refX, refY);
+	w_float hu = refFaceRadius.y;
+	w_float hv = refFaceRadius.z;
+	w_vec3 faceCenter = refCenter + refNormal * refFaceRadius.x;
+
+	// Incident face, see getAABBIncidentVertices.
+	w_vec3 incLocalNormal = localVector(incAxes, refNormal);
+	w_vec3 pInc = abs(incLocalNormal);
+	auto xGreaterY = pInc.x > pInc.y;
+	w_mask incX = xGreaterY & (pInc.x > pInc.z);
+	w_mask incY = maskNot(xGreaterY) & (pInc.y > pInc.z);
+
+	w_vec3 incN = ifThen(incX, incAxes[0], ifThen(incY, incAxes[1], incAxes[2]));
+	w_vec3 incU = ifThen(incX, incAxes[1], ifThen(incY, incAxes[2], incAxes[0]));
+	w_vec3 incV = ifThen(incX, incAxes[2], ifThen(incY, incAxes[0], incAxes[1]));
+	w_vec3 incFaceRadius = permuteAxes(incRadius, incX, incY);
+	w_float s = ifThen(permuteAxes(incLocalNormal, incX, incY).x < 0.f, w_float(1.f), w_float(-1.f)); // Flipped sign.
+
+	// Faces as in contactFeature. The reference faces of b follow the ones of a.
+	w_vec3 refFaceAxis = ifThen(refX, refAxes[0], ifThen(refY, refAxes[1], refAxes[2]));
+	w_float referenceFace = faceAxis * 2.f + ifThen(dot(refNormal, refFaceAxis) < 0.f, w_float(1.f), zero) + ifThen(bFace, w_float(6.f), zero);
+	w_float incidentFace = ifThen(incX, zero, ifThen(incY, w_float(2.f), w_float(4.f))) + ifThen(s < 0.f, w_float(1.f), zero);
+	w_float faceFeature = (w_float(1.f) + referenceFace * 8.f + incidentFace) * 2048.f;
+
+	w_vec3 incFaceCenter = incCenter + incN * (s * incFaceRadius.x);
+	w_vec3 e1 = incU * incFaceRadius.y;
+	w_vec3 e2 = incV * incFaceRadius.z;
+
+	w_vec3 incVertices[4] = { incFaceCenter - e1 - e2, incFaceCenter + e1 - e2, incFaceCenter + e1 + e2, incFaceCenter - e1 + e2 };
+
+	w_float vx[4], vy[4], vd[4];
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		w_vec3 q = incVertices[i] - faceCenter;
+		vx[i] = dot(q, refU);
+		vy[i] = dot(q, refV);
+		vd[i] = -dot(q, refNormal);
+	}
+
+	w_face_point candidates[24];
+	uint32 numCandidates = 0;
+	auto addCandidate = [&](w_float x, w_float y, w_float depth, uint32 feature, w_mask valid)
+	{
+		candidates[numCandidates++] = { x, y, depth, w_float((float)feature), (w_mask)(valid & (depth >= 0.f)) };
+	};
+
+	// Incident vertices inside the reference face.
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		addCandidate(vx[i], vy[i], vd[i], contactFeatureVertex(i), (abs(vx[i]) <= hu) & (abs(vy[i]) <= hv));
+	}
+
+	// Incident edges crossing the borders of the reference face. The borders at -hu, -hv, hu, hv are the side planes 0 to 3.
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		uint32 i1 = (i + 1) % 4;
+		for (uint32 side = 0; side < 2; ++side)
+		{
+			w_float bound = side ? hu : -hu;
+			w_float d0 = vx[i] - bound;
+			w_float d1 = vx[i1] - bound;
+			w_float u = d0 / (d0 - d1);
+			w_float y = vy[i] + (vy[i1] - vy[i]) * u;
+			addCandidate(bound, y, vd[i] + (vd[i1] - vd[i]) * u, contactFeatureEdgePlane(i, side * 2), (d0 * d1 < 0.f) & (abs(y) <= hv));
+
+			bound = side ? hv : -hv;
+			d0 = vy[i] - bound;
+			d1 = vy[i1] - bound;
+			u = d0 / (d0 - d1);
+			w_float x = vx[i] + (vx[i1] - vx[i]) * u;
+			addCandidate(x, bound, vd[i] + (vd[i1] - vd[i]) * u, contactFeatureEdgePlane(i, side * 2 + 1), (d0 * d1 < 0.f) & (abs(x) <= hu));
+		}
+	}
+
+	// Corners of the reference face inside the incident face. The incident face is the parallelogram v0 + alpha * (v1 - v0) + beta * (v3 - v0).
+	w_float ux = vx[1] - vx[0], uy = vy[1] - vy[0], ud = vd[1] - vd[0];
+	w_float wx = vx[3] - vx[0], wy = vy[3] - vy[0], wd = vd[3] - vd[0];
+	w_float det = ux * wy - uy * wx;
+	w_mask nonDegenerate = (det != zero);
+	w_float invDet = ifThen(nonDegenerate, 1.f / det, zero);
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		bool maxU = (i == 1 || i == 2);
+		bool maxV = (i >= 2);
+		w_float cx = maxU ? hu : -hu;
+		w_float cy = maxV ? hv : -hv;
+		w_float px = cx - vx[0];
+		w_float py = cy - vy[0];
+		w_float alpha = (px * wy - py * wx) * invDet;
+		w_float beta = (ux * py - uy * px) * invDet;
+		addCandidate(cx, cy, vd[0] + alpha * ud + beta * wd, contactFeaturePlanePlane(maxU ? 2 : 0, maxV ? 3 : 1),
+			nonDegenerate & (alpha >= 0.f) & (alpha <= 1.f) & (beta >= 0.f) & (beta <= 1.f));
+	}
+
+	// Up to four candidates are kept in order. More are reduced as in findStableContactManifold.
+	w_face_point selected[4];
+	for (uint32 k = 0; k < 4; ++k)
+	{
+		selected[k] = { zero, zero, zero, zero, none };
+	}
+
+	w_float count = zero;
+	for (uint32 i = 0; i < numCandidates; ++i)
+	{
+		const w_face_point& c = candidates[i];
+		for (uint32 k = 0; k < 4; ++k)
+		{
+			w_mask take = c.valid & (count == (float)k);
+			selected[k].x = ifThen(take, c.x, selected[k].x);
+			selected[k].y = ifThen(take, c.y, selected[k].y);
+			selected[k].depth = ifThen(take, c.depth, selected[k].depth);
+			selected[k].feature = ifThen(take, c.feature, selected[k].feature);
+			selected[k].valid = selected[k].valid | take;
+		}
+		count = count + ifThen(c.valid, w_float(1.f), zero);
+	}
+
+	w_mask many = (count > 4.f);
+	if (toBitMask(many) & faceMask)
+	{
+		auto cross2 = [](w_float ax, w_float ay, w_float bx, w_float by) { return ax * by - ay * bx; };
+
+		w_face_point p[4];
+		for (uint32 k = 0; k < 4; ++k)
+		{
+			p[k] = { zero, zero, zero, zero, none };
+		}
+
+		// Search direction of the first point, in face coordinates.
+		w_vec3 tangent = getTangent(normal);
+		w_float searchX = dot(tangent, refU);
+		w_float searchY = dot(tangent, refV);
+
+		w_float best = -FLT_MAX;
+		for (uint32 i = 0; i < numCandidates; ++i)
+		{
+			const w_face_point& c = candidates[i];
+			w_float distance = c.x * searchX + c.y * searchY;
+			w_mask better = c.valid & (distance > best);
+			best = ifThen(better, distance, best);
+			p[0].x = ifThen(better, c.x, p[0].x);
+			p[0].y = ifThen(better, c.y, p[0].y);
+			p[0].depth = ifThen(better, c.depth, p[0].depth);
+			p[0].feature = ifThen(better, c.feature, p[0].feature);
+			p[0].valid = p[0].valid | better;
+		}
+
+		best = zero;
+		for (uint32 i = 0; i < numCandidates; ++i)
+		{
+			const w_face_point& c = candidates[i];
+			w_float dx = c.x - p[0].x;
+			w_float dy = c.y - p[0].y;
+			w_float sqDistance = dx * dx + dy * dy;
+			w_mask better = c.valid & (sqDistance > best);
+			best = ifThen(better, sqDistance, best);
+			p[1].x = ifThen(better, c.x, p[1].x);
+			p[1].y = ifThen(better, c.y, p[1].y);
+			p[1].depth = ifThen(better, c.depth, p[1].depth);
+			p[1].feature = ifThen(better, c.feature, p[1].feature);
+			p[1].valid = p[1].valid | better;
+		}
+
+		best = zero;
+		for (uint32 i = 0; i < numCandidates; ++i)
+		{
+			const w_face_point& c = candidates[i];
+			w_float area = abs(cross2(p[0].x - c.x, p[0].y - c.y, p[1].x - c.x, p[1].y - c.y));
+			w_mask better = c.valid & p[1].valid & (area > best);
+			best = ifThen(better, area, best);
+			p[2].x = ifThen(better, c.x, p[2].x);
+			p[2].y = ifThen(better, c.y, p[2].y);
+			p[2].depth = ifThen(better, c.depth, p[2].depth);
+			p[2].feature = ifThen(better, c.feature, p[2].feature);
+			p[2].valid = p[2].valid | better;
+		}
+
+		// Points outside of an edge have the opposite winding of the triangle.
+		w_float orientation = ifThen(cross2(p[0].x - p[2].x, p[0].y - p[2].y, p[1].x - p[2].x, p[1].y - p[2].y) < 0.f, w_float(1.f), w_float(-1.f));
+
+		best = zero;
+		for (uint32 i = 0; i < numCandidates; ++i)
+		{
+			const w_face_point& c = candidates[i];
+			w_float qax = p[0].x - c.x, qay = p[0].y - c.y;
+			w_float qbx = p[1].x - c.x, qby = p[1].y - c.y;
+			w_float qcx = p[2].x - c.x, qcy = p[2].y - c.y;
+			w_float area = maximum(maximum(cross2(qax, qay, qbx, qby) * orientation, cross2(qbx, qby, qcx, qcy) * orientation),
+				cross2(qcx, qcy, qax, qay) * orientation);
+			w_mask better = c.valid & p[2].valid & (area > best);
+			best = ifThen(better, area, best);
+			p[3].x = ifThen(better, c.x, p[3].x);
+			p[3].y = ifThen(better, c.y, p[3].y);
+			p[3].depth = ifThen(better, c.depth, p[3].depth);
+			p[3].feature = ifThen(better, c.feature, p[3].feature);
+			p[3].valid = p[3].valid | better;
+		}
+
+		// Points which aren't found (e.g. all candidates on a line) are dropped instead of repeating the first one.
+		for (uint32 k = 0; k < 4; ++k)
+		{
+			selected[k].x = ifThen(many, p[k].x, selected[k].x);
+			selected[k].y = ifThen(many, p[k].y, selected[k].y);
+			selected[k].depth = ifThen(many, p[k].depth, selected[k].depth);
+			selected[k].feature = ifThen(many, p[k].feature, selected[k].feature);
+			selected[k].valid = (many & p[k].valid) | (maskNot(many) & selected[k].valid);
+		}
+	}
+
+	uint32 numContacts = 0;
+	for (uint32 k = 0; k < 4; ++k)
+	{
+		uint32 slotMask = toBitMask(selected[k].valid) & faceMask;
+		w_vec3 point = faceCenter + refU * selected[k].x + refV * selected[k].y;
+		w_float penetration = selected[k].depth;
+		w_float feature = faceFeature + selected[k].feature;
+
+		if (k == 0 && edgeMask)
+		{
+			point = ifThen(edge, edgeContact.point, point);
+			penetration = ifThen(edge, edgeContact.penetrationDepth, penetration);
+			feature = ifThen(edge, edgeContact.feature, feature);
+			slotMask |= edgeMask;
+		}
+
+		if (slotMask)
+		{
+			outContacts[numContacts].point = point;
+			outContacts[numContacts].penetrationDepth = penetration;
+			outContacts[numContacts].normal = normal;
+			outContacts[numContacts].mask = slotMask;
+			outContacts[numContacts].feature = feature;
+			++numContacts;
+		}
+	}
+
+	return numContacts;
+}
+
+// GJK tests.
+
+// Pairs without an exact SIMD test (cylinders against boxes and cylinders, anything against hulls) only run the first half of the scalar test
+// here: A wide GJK looks for a separating axis, and drops the pairs which have one. The others are handed back to the scalar test, since EPA
+// doesn't vectorize well.
+
+#define GJK_SIMD_MAX_NUM_ITERATIONS 32
+#define GJK_SIMD_MAX_NUM_HULL_VERTICES 64 // Hulls with more vertices are left to the scalar test.
+
+// Hull vertices in local space, stored per vertex and coordinate, so that one vertex of all lanes is loaded at once.
+struct w_bounding_hull
+{
+	w_quat rotation;
+	w_vec3 position;
+
+	float vertices[GJK_SIMD_MAX_NUM_HULL_VERTICES][3][COLLISION_SIMD_WIDTH];
+	uint32 numVertices;			// Maximum over all lanes. Shorter hulls repeat their first vertex.
+	uint32 unsupportedLanes;	// Hulls with too many vertices.
+};
+
+template <>
+static w_bounding_hull loadBoundingVolumeSIMD<w_bounding_hull>(const collider_union* worldSpaceColliders, physics_index* indices)
+{
+	w_bounding_hull result;
+	w_float dummy;
+	load8(&worldSpaceColliders->hull.rotation.x, indices, sizeof(collider_union),
+		result.rotation.x, result.rotation.y, result.rotation.z, result.rotation.w,
+		result.position.x, result.position.y, result.position.z,
+		dummy);
+
+	const vec3* vertices[COLLISION_SIMD_WIDTH];
+	uint32 numVertices[COLLISION_SIMD_WIDTH];
+
+	result.numVertices = 0;
+	result.unsupportedLanes = 0;
+	for (uint32 j = 0; j < COLLISION_SIMD_WIDTH; ++j)
+	{
+		const bounding_hull_geometry* geometry = worldSpaceColliders[indices[j]].hull.geometryPtr;
+		vertices[j] = geometry->vertices.data();
+		numVertices[j] = (uint32)geometry->vertices.size();
+
+		if (numVertices[j] > GJK_SIMD_MAX_NUM_HULL_VERTICES)
+		{
+			result.unsupportedLanes |= 1 << j;
+			numVertices[j] = 1;
+		}
+		result.numVertices = (numVertices[j] > result.numVertices) ? numVertices[j] : result.numVertices;
+	}
+
+	for (uint32 i = 0; i < result.numVertices; ++i)
+	{
+		for (uint32 j = 0; j < COLLISION_SIMD_WIDTH; ++j)
+		{
+			vec3 v = vertices[j][(i < numVertices[j]) ? i : 0];
+			result.vertices[i][0][j] = v.x;
+			result.vertices[i][1][j] = v.y;
+			result.vertices[i][2][j] = v.z;
+		}
+	}
+
+	return result;
+}
+
+// Wide versions of the support functions in collision_gjk.h. The directions are normalized exactly (not with rsqrt), since a slightly
+// shrunk shape could produce a separating axis which doesn't exist.
+struct w_sphere_support_fn
+{
+	const w_bounding_sphere& s;
+
+	w_vec3 operator()(const w_vec3& dir) const
+	{
+		return dir * (s.radius / length(dir)) + s.center;
+	}
+};
+
+struct w_capsule_support_fn
+{
+	const w_bounding_capsule& c;
+
+	w_vec3 operator()(const w_vec3& dir) const
+	{
+		w_vec3 fartherPoint = ifThen(dot(dir, c.positionA) > dot(dir, c.positionB), c.positionA, c.positionB);
+		return dir * (c.radius / length(dir)) + fartherPoint;
+	}
+};
+
+struct w_cylinder_support_fn
+{
+	const w_bounding_cylinder& c;
+
+	w_vec3 operator()(const w_vec3& dir) const
+	{
+		w_vec3 fartherPoint = ifThen(dot(dir, c.positionA) > dot(dir, c.positionB), c.positionA, c.positionB);
+
+		// Unlike noz, only (nearly) exactly parallel directions fall back to the cap's center. The absolute threshold would otherwise drop the
+		// rim for short cylinders and short directions.
+		w_vec3 n = c.positionA - c.positionB;
+		w_vec3 projectedDir = cross(cross(n, dir), n);
+		w_float sqLength = squaredLength(projectedDir);
+		projectedDir = ifThen(sqLength < 1e-30f, w_vec3::zero(), projectedDir / sqrt(sqLength));
+
+		return fartherPoint + projectedDir * c.radius;
+	}
+};
+
+struct w_aabb_support_fn
+{
+	const w_bounding_box& b;
+
+	w_vec3 operator()(const w_vec3& dir) const
+	{
+		return w_vec3(
+			ifThen(dir.x < 0.f, b.minCorner.x, b.maxCorner.x),
+			ifThen(dir.y < 0.f, b.minCorner.y, b.maxCorner.y),
+			ifThen(dir.z < 0.f, b.minCorner.z, b.maxCorner.z));
+	}
+};
+
+struct w_obb_support_fn
+{
+	const w_bounding_oriented_box& b;
+
+	w_vec3 operator()(const w_vec3& dir) const
+	{
+		w_vec3 localDir = conjugate(b.rotation) * dir;
+		w_vec3 r(
+			ifThen(localDir.x < 0.f, -b.radius.x, b.radius.x),
+			ifThen(localDir.y < 0.f, -b.radius.y, b.radius.y),
+			ifThen(localDir.z < 0.f, -b.radius.z, b.radius.z));
+
+		return b.center + b.rotation * r;
+	}
+};
+
+struct w_hull_support_fn
+{
+	const w_bounding_hull& h;
+
+	w_vec3 operator()(const w_vec3& dir) const
+	{
+		w_vec3 localDir = conjugate(h.rotation) * dir;
+
+		w_vec3 result(h.vertices[0][0], h.vertices[0][1], h.vertices[0][2]);
+		w_float maxDist = dot(localDir, result);
+
+		for (uint32 i = 1; i < h.numVertices; ++i)
+		{
+			w_vec3 v(h.vertices[i][0], h.vertices[i][1], h.vertices[i][2]);
+			w_float d = dot(localDir, v);
+
+			auto better = d > maxDist;
+			maxDist = ifThen(better, d, maxDist);
+			result = ifThen(better, v, result);
+		}
+
+		return h.position + h.rotation * result;
+	}
+};
+
+static w_sphere_support_fn getSupportFunction(const w_bounding_sphere& s) { return { s }; }
+static w_capsule_support_fn getSupportFunction(const w_bounding_capsule& c) { return { c }; }
+static w_cylinder_support_fn getSupportFunction(const w_bounding_cylinder& c) { return { c }; }
+static w_aabb_support_fn getSupportFunction(const w_bounding_box& b) { return { b }; }
+static w_obb_support_fn getSupportFunction(const w_bounding_oriented_box& b) { return { b }; }
+static w_hull_support_fn getSupportFunction(const w_bounding_hull& h) { return { h }; }
+
+static w_vec3 getCenter(const w_bounding_sphere& s) { return s.center; }
+static w_vec3 getCenter(const w_bounding_capsule& c) { return (c.positionA + c.positionB) * w_float(0.5f); }
+static w_vec3 getCenter(const w_bounding_cylinder& c) { return (c.positionA + c.positionB) * w_float(0.5f); }
+static w_vec3 getCenter(const w_bounding_box& b) { return (b.minCorner + b.maxCorner) * w_float(0.5f); }
+static w_vec3 getCenter(const w_bounding_oriented_box& b) { return b.center; }
+static w_vec3 getCenter(const w_bounding_hull& h) { return h.position; }
+
+template <typename collider_t> static uint32 getUnsupportedLanes(const collider_t& c) { return 0; }
+static uint32 getUnsupportedLanes(const w_bounding_hull& h) { return h.unsupportedLanes; }
+
+static w_vec3 crossABA(const w_vec3& a, const w_vec3& b)
+{
+	return cross(cross(a, b), a);
+}
+
+// gjkIntersectionTest and updateGJKSimplex, with every branch turned into a lane mask. dir is the initial search direction in the Minkowski
+// difference A - B, i.e. from B towards A. Returns the lanes for which a separating axis was found, and writes that axis in the same direction
+// to outSeparatingDir. Lanes which run into any of the scalar test's error cases, or don't finish within the iteration limit, are reported as
+// not separated.
+template <typename support_a_t, typename support_b_t>
+static w_mask gjkSeparatedSIMD(const support_a_t& supportA, const support_b_t& supportB, w_vec3 dir, w_vec3& outSeparatingDir)
+{
+	auto support = [&](const w_vec3& d) { return supportA(d) - supportB(-d); };
+
+	w_float zero = w_float::zero();
+	w_mask none = (zero < zero);
+
+	// First point.
+	w_vec3 c = support(dir);
+	w_mask separated = (dot(c, dir) < 0.f);
+	w_mask done = separated;
+	outSeparatingDir = dir;
+
+	// Second point.
+	dir = -c;
+	w_vec3 b = support(dir);
+	w_mask separatedB = maskNot(done) & (dot(b, dir) < 0.f);
+	separated = separated | separatedB;
+	done = done | separatedB;
+	outSeparatingDir = ifThen(separatedB, dir, outSeparatingDir);
+
+	w_vec3 d = w_vec3::zero();
+	w_mask isTetrahedron = none;
+
+	dir = crossABA(c - b, -b);
+
+	for (uint32 iteration = 0; iteration < GJK_SIMD_MAX_NUM_ITERATIONS; ++iteration)
+	{
+		done = done | (squaredLength(dir) < 0.0001f);
+		w_mask active = maskNot(done);
+		if (!toBitMask(active))
+		{
+			break;
+		}
+
+		w_vec3 a = support(dir);
+
+		w_mask separatedA = active & (dot(a, dir) < 0.f);
+		separated = separated | separatedA;
+		done = done | separatedA;
+		active = active & maskNot(separatedA);
+		outSeparatingDir = ifThen(separatedA, dir, outSeparatingDir);
+
+		w_vec3 ao = -a;
+		w_vec3 ab = b - a;
+		w_vec3 ac = c - a;
+		w_vec3 ad = d - a;
+
+		// Triangle case.
+		w_mask triangle = active & maskNot(isTetrahedron);
+
+		w_vec3 abc = cross(ab, ac);
+		w_mask overAB = triangle & (dot(ao, cross(ab, abc)) > 0.f);
+		w_mask overAC = triangle & maskNot(overAB) & (dot(ao, cross(abc, ac)) > 0.f);
+		w_mask inTriangle = triangle & maskNot(overAB | overAC);
+		w_mask above = inTriangle & (dot(ao, abc) >= 0.f);
+		w_mask below = inTriangle & maskNot(above) & (dot(ao, -abc) >= 0.f);
+
+		// Tetrahedron case.
+		w_vec3 bcd = cross(c - b, d - b);
+		w_mask tetrahedronError = (dot(bcd, dir) > 0.00001f) | (dot(bcd, b) < -0.00001f);
+
+		w_vec3 abcT = cross(ac, ab);
+		w_vec3 abd = cross(ab, ad);
+		w_vec3 adc = cross(ad, ac);
+
+		w_mask overABC = (dot(abcT, ao) > 0.f);
+		w_mask overABD = (dot(abd, ao) > 0.f);
+		w_mask overADC = (dot(adc, ao) > 0.f);
+
+		tetrahedronError = tetrahedronError | (overABC & overABD & overADC);
+		w_mask inside = maskNot(overABC | overABD | overADC);
+		w_mask tetrahedron = active & isTetrahedron & maskNot(tetrahedronError | inside);
+
+		w_mask edgeABC_AB = (dot(cross(abcT, ab), ao) > 0.f);
+		w_mask edgeABC_AC = (dot(cross(ac, abcT), ao) > 0.f);
+		w_mask edgeABD_AD = (dot(cross(abd, ad), ao) > 0.f);
+		w_mask edgeABD_AB = (dot(cross(ab, abd), ao) > 0.f);
+		w_mask edgeADC_AC = (dot(cross(adc, ac), ao) > 0.f);
+		w_mask edgeADC_AD = (dot(cross(ad, adc), ao) > 0.f);
+
+		// The labels of the scalar test. Entering at label 1 falls through to label 2, if the first edge test fails.
+		w_mask onlyABC = overABC & maskNot(overABD | overADC);
+		w_mask onlyABD = overABD & maskNot(overABC | overADC);
+		w_mask onlyADC = overADC & maskNot(overABC | overABD);
+
+		w_mask abc1 = tetrahedron & (onlyABC | (overADC & overABC & edgeADC_AC));
+		w_mask abd1 = tetrahedron & (onlyABD | (overABC & overABD & edgeABC_AB));
+		w_mask adc1 = tetrahedron & (onlyADC | (overABD & overADC & edgeABD_AD));
+		w_mask abc2 = (abc1 | (tetrahedron & overABC & overABD)) & maskNot(edgeABC_AB);
+		w_mask abd2 = (abd1 | (tetrahedron & overABD & overADC)) & maskNot(edgeABD_AD);
+		w_mask adc2 = (adc1 | (tetrahedron & overADC & overABC)) & maskNot(edgeADC_AC);
+
+		w_mask lineAB = overAB | (abc1 & edgeABC_AB) | (abd2 & edgeABD_AB);
+		w_mask lineAC = overAC | (abc2 & edgeABC_AC) | (adc1 & edgeADC_AC);
+		w_mask lineDA = abd1 & edgeABD_AD;
+		w_mask lineAD = adc2 & edgeADC_AD;
+		w_mask triangleABC = abc2 & maskNot(edgeABC_AC);
+		w_mask triangleABD = abd2 & maskNot(edgeABD_AB);
+		w_mask triangleADC = adc2 & maskNot(edgeADC_AD);
+
+		w_mask bToA = lineAC | lineAD | triangleADC | above | below;
+		w_mask cToA = lineAB | lineDA | triangleABD;
+
+		w_vec3 newB = ifThen(bToA, a, ifThen(lineDA, d, b));
+		w_vec3 newC = ifThen(cToA, a, ifThen(lineAD, d, ifThen(below, b, c)));
+		w_vec3 newD = ifThen(triangleABC, a, ifThen(above, b, ifThen(below, c, d)));
+
+		w_vec3 newDir = dir;
+		newDir = ifThen(lineAB, crossABA(ab, ao), newDir);
+		newDir = ifThen(lineAC, crossABA(ac, ao), newDir);
+		newDir = ifThen(lineDA | lineAD, crossABA(ad, ao), newDir);
+		newDir = ifThen(triangleABC, abcT, newDir);
+		newDir = ifThen(triangleABD, abd, newDir);
+		newDir = ifThen(triangleADC, adc, newDir);
+		newDir = ifThen(above, abc, newDir);
+		newDir = ifThen(below, -abc, newDir);
+
+		b = newB;
+		c = newC;
+		d = newD;
+		dir = newDir;
+
+		w_mask toLine = lineAB | lineAC | lineDA | lineAD;
+		isTetrahedron = (isTetrahedron & maskNot(toLine)) | above | below;
+
+		// Lanes without any of the above outcomes contain the origin or hit an error case.
+		w_mask progress = toLine | triangleABC | triangleABD | triangleADC | above | below;
+		done = done | (active & maskNot(progress));
+	}
+
+	return separated;
+}
+
+// Rejects the pairs which GJK separates, and moves the others to the front of colliderPairs. Like the scalar test, each lane starts along the
+// axis cached for its pair in the last frame, and the separating axis of rejected pairs is cached for the next one. The other pairs update
+// their cache entry in the scalar test.
+template <typename collider_a, typename collider_b>
+static uint32 collisionGJKSIMD(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
+	collision_write_context& writeContext)
+{
+	uint32 numScalarPairs = 0;
+
+	for (uint32 i = 0; i < numColliderPairs; i += COLLISION_SIMD_WIDTH)
+	{
+		uint32 numValidLanes = clamp(numColliderPairs - i, 0u, COLLISION_SIMD_WIDTH);
+
+		physics_index aIndices[COLLISION_SIMD_WIDTH];
+		physics_index bIndices[COLLISION_SIMD_WIDTH];
+
+		// Unused lanes repeat the first pair, since hull lanes dereference their geometry.
+		for (uint32 j = 0; j < COLLISION_SIMD_WIDTH; ++j)
+		{
+			collider_pair pair = colliderPairs[i + ((j < numValidLanes) ? j : 0)];
+			aIndices[j] = pair.colliderA;
+			bIndices[j] = pair.colliderB;
+		}
+
+		collider_a bvA = loadBoundingVolumeSIMD<collider_a>(worldSpaceColliders, aIndices);
+		collider_b bvB = loadBoundingVolumeSIMD<collider_b>(worldSpaceColliders, bIndices);
+
+		// From b to a, see gjkSeparatedSIMD. The cached axes point from a to b.
+		w_vec3 dir = getCenter(bvA) - getCenter(bvB);
+		dir = ifThen(squaredLength(dir) < 1e-8f, w_vec3(1.f, 0.1f, -0.2f), dir);
+
+		alignas(64) float dirX[COLLISION_SIMD_WIDTH], dirY[COLLISION_SIMD_WIDTH], dirZ[COLLISION_SIMD_WIDTH];
+		dir.store(dirX, dirY, dirZ);
+		for (uint32 j = 0; j < numValidLanes; ++j)
+		{
+			narrowphase_feature feature = writeContext.getCachedFeature({ aIndices[j], bIndices[j] });
+			if (feature.type != narrowphase_feature_none)
+			{
+				dirX[j] = -feature.axis.x;
+				dirY[j] = -feature.axis.y;
+				dirZ[j] = -feature.axis.z;
+			}
+		}
+		dir = w_vec3(w_float(dirX), w_float(dirY), w_float(dirZ));
+
+		w_vec3 separatingDir;
+		uint32 separatedMask = toBitMask(gjkSeparatedSIMD(getSupportFunction(bvA), getSupportFunction(bvB), dir, separatingDir));
+		separatedMask &= ~(getUnsupportedLanes(bvA) | getUnsupportedLanes(bvB));
+
+		separatingDir.store(dirX, dirY, dirZ);
+		for (uint32 j = 0; j < numValidLanes; ++j)
+		{
+			collider_pair pair = { aIndices[j], bIndices[j] };
+			if (separatedMask & (1 << j))
+			{
+				narrowphase_feature feature;
+				feature.type = narrowphase_feature_separating_axis;
+				feature.axis = vec3(-dirX[j], -dirY[j], -dirZ[j]);
+				writeContext.pushFeature(pair, feature);
+			}
+			else
+			{
+				colliderPairs[numScalarPairs++] = pair;
+			}
+		}
+	}
+
+	return numScalarPairs;
+}
+
+
+// Must match the signature of the wide tests, including the output contacts. Otherwise no pair is detected and the SIMD narrow phase silently
+// falls back to the scalar tests.
+template <typename collider_a, typename collider_b, typename = void>
+struct simd_intersection_available : std::false_type {};
+
+template <typename collider_a, typename collider_b>
+struct simd_intersection_available<collider_a, collider_b,
+	std::void_t<decltype(intersectionSIMD(std::declval<const collider_a&>(), std::declval<const collider_b&>(), std::declval<w_collision_contact*>())) >> : std::true_type {};
+
+template <typename collider_t> struct scalar_to_wide { using type = void; };
+template <> struct scalar_to_wide<bounding_sphere> { using type = w_bounding_sphere; };
+template <> struct scalar_to_wide<bounding_capsule> { using type = w_bounding_capsule; };
+template <> struct scalar_to_wide<bounding_cylinder> { using type = w_bounding_cylinder; };
+template <> struct scalar_to_wide<bounding_box> { using type = w_bounding_box; };
+template <> struct scalar_to_wide<bounding_oriented_box> { using type = w_bounding_oriented_box; };
+template <> struct scalar_to_wide<bounding_hull> { using type = w_bounding_hull; };
+
+template <typename collider_t, typename = void>
+struct simd_support_available : std::false_type {};
+
+template <typename collider_t>
+struct simd_support_available<collider_t,
+	std::void_t<decltype(getSupportFunction(std::declval<const collider_t&>()))>> : std::true_type {};
+
+
+static void writeWideContact(const collider_union* worldSpaceColliders, const w_collision_contact* wideContacts, uint32 numWideContacts,
+	physics_index* aIndices, physics_index* bIndices, uint32 numValidLanes,
+	collision_write_context& writeContext)
+{
+	if (numWideContacts > 0)
+	{
+		uint32 validLanesMask = (1 << numValidLanes) - 1;
+
+		w_float restitutionA, frictionA, densityA;
+		w_float restitutionB, frictionB, densityB;
+		w_float rbA, rbB;
+
+		load4(&worldSpaceColliders->material.restitution, aIndices, sizeof(collider_union),
+			restitutionA, frictionA, densityA, rbA);
+		load4(&worldSpaceColliders->material.restitution, bIndices, sizeof(collider_union),
+			restitutionB, frictionB, densityB, rbB);
+
+		w_float friction = clamp01(sqrt(frictionA * frictionB));
+		w_float restitution = clamp01(maximum(restitutionA, restitutionB));
+
+		w_float friction_restitution = reinterpret((convert(friction * 0xFFFF) << 16) | convert(restitution * 0xFFFF));
+
+#if !PHYSICS_32BIT_INDICES
+		// The fourth value is the collider type, the object type and the object index, which sits in the upper 16 bits.
+		rbA >>= 16;
+		rbB >>= 16;
+		w_int bodyPairs = reinterpret((rbB << 16) | rbA);
+#endif
+
+
+		uint32 numContactsPerLane[COLLISION_SIMD_WIDTH] = {};
+		for (uint32 j = 0; j < numWideContacts; ++j)
+		{
+			uint32 mask = wideContacts[j].mask;
+			ASSERT(mask != 0);
+
+			mask &= validLanesMask;
+
+			for (uint32 k = 0; k < numValidLanes; ++k)
+			{
+				if (mask & (1 << k))
+				{
+					++numContactsPerLane[k];
+				}
+			}
+		}
+		// Not exclusivePrefixSum, since kernels must not instantiate shared templates (see core/simd_dispatch.h).
+		uint32 offsetPerLane[COLLISION_SIMD_WIDTH];
+		uint32 offset = 0;
+		for (uint32 k = 0; k < numValidLanes; ++k)
+		{
+			offsetPerLane[k] = offset;
+			offset += numContactsPerLane[k];
+		}
+
+		for (uint32 k = 0; k < numValidLanes; ++k)
+		{
+			if (numContactsPerLane[k] > 0)
+			{
+				writeContext.pushCollision(aIndices[k], bIndices[k], numContactsPerLane[k]);
+			}
+		}
+
+		for (uint32 j = 0; j < numWideContacts; ++j)
+		{
+			const w_collision_contact& c = wideContacts[j];
+
+			uint32 mask = c.mask;
+			ASSERT(mask != 0);
+
+			mask &= validLanesMask;
+
+			if (mask)
+			{
+				alignas(64) float features[COLLISION_SIMD_WIDTH];
+				c.feature.store(features);
+
+				w_float v[] =
+				{
+					c.point.x,
+					c.point.y,
+					c.point.z,
+					c.penetrationDepth,
+					c.normal.x,
+					c.normal.y,
+					c.normal.z,
+					friction_restitution,
+				};
+
+#if COLLISION_SIMD_WIDTH == 4
+				transpose(v[0], v[1], v[2], v[3]);
+				transpose(v[4], v[5], v[6], v[7]);
+#elif COLLISION_SIMD_WIDTH == 8 || COLLISION_SIMD_WIDTH == 16
+				transpose(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+#endif
+
+				for (uint32 k = 0; k < numValidLanes; ++k)
+				{
+					if (mask & (1 << k))
+					{
+						uint32 offset = offsetPerLane[k];
+
+						auto& [outContact, outBodyPair] = writeContext.pushContact((uint32)features[k]);
+
+#if COLLISION_SIMD_WIDTH == 4
+						v[k].store((float*)&outContact);
+						v[k + 4].store((float*)&outContact + 4);
+#elif COLLISION_SIMD_WIDTH == 8
+						v[k].store((float*)&outContact);
+#elif COLLISION_SIMD_WIDTH == 16
+						// Lanes 8 to 15 are in the upper halves, see transpose.
+						w8_float row = (k < 8) ? getLower(v[k]) : getUpper(v[k - 8]);
+						row.store((float*)&outContact);
+#endif
+
+#if PHYSICS_32BIT_INDICES
+						// The 32-bit object index does not fit into the gathered material, so it is read directly.
+						outBodyPair = { worldSpaceColliders[aIndices[k]].objectIndex, worldSpaceColliders[bIndices[k]].objectIndex };
+#else
+						*(int*)&outBodyPair = bodyPairs[k];
+#endif
+						
+						++offsetPerLane[k];
+					}
+				}
+			}
+		}
+	}
+}
+
+// Box pairs tested with the SAT, which use the feature cache in the scalar test (see usesFeatureCache in collision_narrow.cpp).
+template <typename collider_a, typename collider_b>
+static constexpr bool usesSATFeatureCache = std::is_same_v<collider_b, w_bounding_oriented_box>
+	&& (std::is_same_v<collider_a, w_bounding_box> || std::is_same_v<collider_a, w_bounding_oriented_box>);
+
+// Pose of box b relative to box a, as cached in narrowphase_feature. AABBs are unrotated boxes, see intersectionSIMD.
+static void getRelativeBoxPose(const collider_union* worldSpaceColliders, collider_pair pair, quat& outRotation, vec3& outPosition)
+{
+	const collider_union& a = worldSpaceColliders[pair.colliderA];
+	const bounding_oriented_box& b = worldSpaceColliders[pair.colliderB].obb;
+	quat rotationA = (a.type == collider_type_obb) ? a.obb.rotation : quat::identity;
+	vec3 centerA = (a.type == collider_type_obb) ? a.obb.center : a.aabb.getCenter();
+
+	outRotation = conjugate(rotationA) * b.rotation;
+	outPosition = conjugate(rotationA) * (b.center - centerA);
+}
+
+// Stores what the SIMD SAT found for each lane, just like the scalar test would have.
+static void pushSATFeatures(const collider_union* worldSpaceColliders, const w_sat_feature& satFeature,
+	const physics_index* aIndices, const physics_index* bIndices, uint32 numValidLanes,
+	collision_write_context& writeContext)
+{
+	alignas(64) float axes[COLLISION_SIMD_WIDTH];
+	satFeature.axis.store(axes);
+
+	for (uint32 j = 0; j < numValidLanes; ++j)
+	{
+		narrowphase_feature feature;
+		feature.satAxis = (uint8)axes[j];
+
+		if (satFeature.separatedLanes & (1 << j))
+		{
+			feature.type = narrowphase_feature_separating_axis;
+		}
+		else
+		{
+			feature.type = narrowphase_feature_contact;
+			getRelativeBoxPose(worldSpaceColliders, { aIndices[j], bIndices[j] }, feature.relativeRotation, feature.relativePosition);
+		}
+
+		writeContext.pushFeature({ aIndices[j], bIndices[j] }, feature);
+	}
+}
+
+// Box pairs which can clip last frame's reference face again (see canReuseCachedFace) are left to the scalar test, which does that without
+// running the SAT. They are moved to the front of colliderPairs, in their original order. The pairs with any other cached feature are first
+// tested along their cached axis, one batch at a time, and the ones it still separates are done. All remaining pairs run the full SIMD SAT,
+// which caches what it found.
+template <typename collider_a, typename collider_b>
+static uint32 boxCollisionSIMD(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
+	collision_write_context& writeContext)
+{
+	uint32 numScalarPairs = 0;
+
+	// Pairs waiting for the cached axis test and pairs waiting for the full SAT. The cached axis test moves at most one batch into the SAT
+	// queue, which is run whenever it holds a full batch, so it never holds more than two.
+	collider_pair cachedPairs[COLLISION_SIMD_WIDTH];
+	alignas(64) float cachedAxes[COLLISION_SIMD_WIDTH];
+	uint32 numCachedPairs = 0;
+
+	collider_pair satPairs[2 * COLLISION_SIMD_WIDTH];
+	uint32 numSATPairs = 0;
+
+	auto runCachedAxisTest = [&]()
+	{
+		physics_index aIndices[COLLISION_SIMD_WIDTH] = {};
+		physics_index bIndices[COLLISION_SIMD_WIDTH] = {};
+		for (uint32 j = 0; j < COLLISION_SIMD_WIDTH; ++j)
+		{
+			if (j < numCachedPairs)
+			{
+				aIndices[j] = cachedPairs[j].colliderA;
+				bIndices[j] = cachedPairs[j].colliderB;
+			}
+			else
+			{
+				cachedAxes[j] = -1.f; // Unused lanes test no axis.
+			}
+		}
+
+		collider_a bvA = loadBoundingVolumeSIMD<collider_a>(worldSpaceColliders, aIndices);
+		collider_b bvB = loadBoundingVolumeSIMD<collider_b>(worldSpaceColliders, bIndices);
+
+		uint32 separatedMask = toBitMask(separatedByCachedAxisSIMD(bvA, bvB, w_float(cachedAxes)));
+
+		for (uint32 j = 0; j < numCachedPairs; ++j)
+		{
+			if (separatedMask & (1 << j))
+			{
+				narrowphase_feature feature;
+				feature.type = narrowphase_feature_separating_axis;
+				feature.satAxis = (uint8)cachedAxes[j];
+				writeContext.pushFeature(cachedPairs[j], feature);
+			}
+			else
+			{
+				satPairs[numSATPairs++] = cachedPairs[j];
+			}
+		}
+		numCachedPairs = 0;
+	};
+
+	auto runSAT = [&](uint32 numValidLanes)
+	{
+		physics_index aIndices[COLLISION_SIMD_WIDTH] = {};
+		physics_index bIndices[COLLISION_SIMD_WIDTH] = {};
+		for (uint32 j = 0; j < numValidLanes; ++j)
+		{
+			aIndices[j] = satPairs[j].colliderA;
+			bIndices[j] = satPairs[j].colliderB;
+		}
+
+		collider_a bvA = loadBoundingVolumeSIMD<collider_a>(worldSpaceColliders, aIndices);
+		collider_b bvB = loadBoundingVolumeSIMD<collider_b>(worldSpaceColliders, bIndices);
+
+		w_collision_contact wideContacts[4];
+		w_sat_feature satFeature;
+		uint32 numWideContacts = intersectionSIMD(bvA, bvB, wideContacts, &satFeature);
+
+		writeWideContact(worldSpaceColliders, wideContacts, numWideContacts, aIndices, bIndices, numValidLanes, writeContext);
+		pushSATFeatures(worldSpaceColliders, satFeature, aIndices, bIndices, numValidLanes, writeContext);
+
+		numSATPairs -= numValidLanes;
+		memmove(satPairs, satPairs + numValidLanes, sizeof(collider_pair) * numSATPairs);
+	};
+
+	for (uint32 i = 0; i < numColliderPairs; ++i)
+	{
+		collider_pair pair = colliderPairs[i];
+		narrowphase_feature feature = writeContext.getCachedFeature(pair);
+
+		if (feature.type == narrowphase_feature_none)
+		{
+			satPairs[numSATPairs++] = pair;
+		}
+		else
+		{
+			quat relativeRotation;
+			vec3 relativePosition;
+			getRelativeBoxPose(worldSpaceColliders, pair, relativeRotation, relativePosition);
+
+			if (canReuseCachedFace(feature, relativeRotation, relativePosition))
+			{
+				// Written behind the read position, so the pairs are compacted in place.
+				colliderPairs[numScalarPairs++] = pair;
+				continue;
+			}
+
+			cachedPairs[numCachedPairs] = pair;
+			cachedAxes[numCachedPairs] = (float)feature.satAxis;
+			if (++numCachedPairs == COLLISION_SIMD_WIDTH)
+			{
+				runCachedAxisTest();
+			}
+		}
+
+		if (numSATPairs >= COLLISION_SIMD_WIDTH)
+		{
+			runSAT(COLLISION_SIMD_WIDTH);
+		}
+	}
+
+	if (numCachedPairs > 0)
+	{
+		runCachedAxisTest();
+	}
+	while (numSATPairs > 0)
+	{
+		runSAT(min(numSATPairs, (uint32)COLLISION_SIMD_WIDTH));
+	}
+
+	return numScalarPairs;
+}
+
+// Box pairs are handled by boxCollisionSIMD. All other pairs are decided here.
+template <typename collider_a, typename collider_b>
+static uint32 collisionSIMD(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
+	collision_write_context& writeContext)
+{
+	if constexpr (usesSATFeatureCache<collider_a, collider_b>)
+	{
+		return boxCollisionSIMD<collider_a, collider_b>(worldSpaceColliders, colliderPairs, numColliderPairs, writeContext);
+	}
+	else
+	{
+		for (uint32 i = 0; i < numColliderPairs; i += COLLISION_SIMD_WIDTH)
+		{
+			uint32 numValidLanes = min(numColliderPairs - i, (uint32)COLLISION_SIMD_WIDTH);
+
+			physics_index aIndices[COLLISION_SIMD_WIDTH] = {};
+			physics_index bIndices[COLLISION_SIMD_WIDTH] = {};
+			for (uint32 j = 0; j < numValidLanes; ++j)
+			{
+				aIndices[j] = colliderPairs[i + j].colliderA;
+				bIndices[j] = colliderPairs[i + j].colliderB;
+			}
+
+			collider_a bvA = loadBoundingVolumeSIMD<collider_a>(worldSpaceColliders, aIndices);
+			collider_b bvB = loadBoundingVolumeSIMD<collider_b>(worldSpaceColliders, bIndices);
+
+			w_collision_contact wideContacts[4];
+			uint32 numWideContacts = intersectionSIMD(bvA, bvB, wideContacts);
+
+			writeWideContact(worldSpaceColliders, wideContacts, numWideContacts, aIndices, bIndices, numValidLanes, writeContext);
+		}
+
+		return 0;
+	}
+}
+
+// Returns the number of pairs left for the scalar test, see narrowphaseSIMD.
+typedef uint32 (*simd_collision_func)(const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
+	collision_write_context& writeContext);
+
+template <typename collider_a, typename collider_b>
+static constexpr simd_collision_func getSIMDCollisionFunction()
+{
+	using wide_collider_a = typename scalar_to_wide<collider_a>::type;
+	using wide_collider_b = typename scalar_to_wide<collider_b>::type;
+
+	if constexpr (simd_intersection_available<wide_collider_a, wide_collider_b>::value)
+	{
+		return collisionSIMD<wide_collider_a, wide_collider_b>;
+	}
+	else if constexpr (simd_support_available<wide_collider_a>::value && simd_support_available<wide_collider_b>::value)
+	{
+		return collisionGJKSIMD<wide_collider_a, wide_collider_b>;
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+// Indexed by collider types, with a.type <= b.type. Null for pairs without a SIMD test.
+static const simd_collision_func simdCollisionFunctions[collider_type_count][collider_type_count] =
+{
+	{
+		getSIMDCollisionFunction<bounding_sphere, bounding_sphere>(),
+		getSIMDCollisionFunction<bounding_sphere, bounding_capsule>(),
+		getSIMDCollisionFunction<bounding_sphere, bounding_cylinder>(),
+		getSIMDCollisionFunction<bounding_sphere, bounding_box>(),
+		getSIMDCollisionFunction<bounding_sphere, bounding_oriented_box>(),
+		getSIMDCollisionFunction<bounding_sphere, bounding_hull>(),
+	},
+	{
+		0,
+		getSIMDCollisionFunction<bounding_capsule, bounding_capsule>(),
+		getSIMDCollisionFunction<bounding_capsule, bounding_cylinder>(),
+		getSIMDCollisionFunction<bounding_capsule, bounding_box>(),
+		getSIMDCollisionFunction<bounding_capsule, bounding_oriented_box>(),
+		getSIMDCollisionFunction<bounding_capsule, bounding_hull>(),
+	},
+	{
+		0,
+		0,
+		getSIMDCollisionFunction<bounding_cylinder, bounding_cylinder>(),
+		getSIMDCollisionFunction<bounding_cylinder, bounding_box>(),
+		getSIMDCollisionFunction<bounding_cylinder, bounding_oriented_box>(),
+		getSIMDCollisionFunction<bounding_cylinder, bounding_hull>(),
+	},
+	{
+		0,
+		0,
+		0,
+		getSIMDCollisionFunction<bounding_box, bounding_box>(),
+		getSIMDCollisionFunction<bounding_box, bounding_oriented_box>(),
+		getSIMDCollisionFunction<bounding_box, bounding_hull>(),
+	},
+	{
+		0,
+		0,
+		0,
+		0,
+		getSIMDCollisionFunction<bounding_oriented_box, bounding_oriented_box>(),
+		getSIMDCollisionFunction<bounding_oriented_box, bounding_hull>(),
+	},
+	{
+		0,
+		0,
+		0,
+		0,
+		0,
+		getSIMDCollisionFunction<bounding_hull, bounding_hull>(),
+	},
+};
+
+uint32 narrowphaseSIMD(uint32 typeA, uint32 typeB, const collider_union* worldSpaceColliders, collider_pair* colliderPairs, uint32 numColliderPairs,
+	collision_write_context& writeContext)
+{
+	simd_collision_func func = simdCollisionFunctions[typeA][typeB];
+	if (!func)
+	{
+		return numColliderPairs;
+	}
+
+	return func(worldSpaceColliders, colliderPairs, numColliderPairs, writeContext);
+}
+
+}
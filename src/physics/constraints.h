@@ -3,14 +3,14 @@
 #include "core/math.h"
 #include "core/memory.h"
 #include "scene/scene.h"
+#include "physics_index.h"
+#include "core/simd_dispatch.h"
 
 
 
 struct rigid_body_global_state;
 struct collision_contact;
 
-#define CONSTRAINT_SIMD_WIDTH 8
-
 enum constraint_type
 {
 	constraint_type_none = -1,
@@ -27,14 +27,14 @@ enum constraint_type
 	constraint_type_count,
 };
 
-#define INVALID_CONSTRAINT_EDGE UINT16_MAX
+#define INVALID_CONSTRAINT_EDGE INVALID_PHYSICS_INDEX
 
 struct constraint_edge
 {
 	entity_handle constraintEntity;
 	constraint_type type;
-	uint16 prevConstraintEdge;
-	uint16 nextConstraintEdge;
+	physics_index prevConstraintEdge;
+	physics_index nextConstraintEdge;
 };
 
 
@@ -52,7 +52,15 @@ static const char* constraintMotorTypeNames[] =
 
 struct constraint_body_pair
 {
-	uint16 rbA, rbB;
+	physics_index rbA, rbB;
+};
+
+// Accumulated impulses of a contact. These are carried over to the next frame to warm start the solver.
+struct contact_impulse
+{
+	// Don't change the order here. It's required by the SIMD code.
+	vec3 tangentImpulse; // Friction impulse in world space.
+	float normalImpulse;
 };
 
 
@@ -60,8 +68,8 @@ struct constraint_entity_reference_component
 {
 	entity_handle entityA = entt::null;
 	entity_handle entityB = entt::null;
-	uint16 edgeA = INVALID_CONSTRAINT_EDGE;
-	uint16 edgeB = INVALID_CONSTRAINT_EDGE;
+	physics_index edgeA = INVALID_CONSTRAINT_EDGE;
+	physics_index edgeB = INVALID_CONSTRAINT_EDGE;
 };
 
 
@@ -81,8 +89,8 @@ struct distance_constraint
 
 struct distance_constraint_update
 {
-	uint16 rigidBodyIndexA;
-	uint16 rigidBodyIndexB;
+	physics_index rigidBodyIndexA;
+	physics_index rigidBodyIndexB;
 
 	vec3 relGlobalAnchorA;
 	vec3 relGlobalAnchorB;
@@ -101,28 +109,6 @@ struct distance_constraint_solver
 	uint32 count;
 };
 
-struct simd_distance_constraint_batch
-{
-	uint16 rbAIndices[CONSTRAINT_SIMD_WIDTH];
-	uint16 rbBIndices[CONSTRAINT_SIMD_WIDTH];
-
-	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
-	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
-
-	float impulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
-	float impulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
-
-	float u[3][CONSTRAINT_SIMD_WIDTH];
-	float bias[CONSTRAINT_SIMD_WIDTH];
-	float effectiveMass[CONSTRAINT_SIMD_WIDTH];
-};
-
-struct simd_distance_constraint_solver
-{
-	simd_distance_constraint_batch* batches;
-	uint32 numBatches;
-};
-
 
 // Ball constraint.
 
@@ -136,8 +122,8 @@ struct ball_constraint
 
 struct ball_constraint_update
 {
-	uint16 rigidBodyIndexA;
-	uint16 rigidBodyIndexB;
+	physics_index rigidBodyIndexA;
+	physics_index rigidBodyIndexB;
 	vec3 relGlobalAnchorA;
 	vec3 relGlobalAnchorB;
 
@@ -151,24 +137,6 @@ struct ball_constraint_solver
 	uint32 count;
 };
 
-struct simd_ball_constraint_batch
-{
-	uint16 rbAIndices[CONSTRAINT_SIMD_WIDTH];
-	uint16 rbBIndices[CONSTRAINT_SIMD_WIDTH];
-
-	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
-	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
-
-	float bias[3][CONSTRAINT_SIMD_WIDTH];
-	float invEffectiveMass[9][CONSTRAINT_SIMD_WIDTH];
-};
-
-struct simd_ball_constraint_solver
-{
-	simd_ball_constraint_batch* batches;
-	uint32 numBatches;
-};
-
 
 // Fixed constraint.
 
@@ -184,8 +152,8 @@ struct fixed_constraint
 
 struct fixed_constraint_update
 {
-	uint16 rigidBodyIndexA;
-	uint16 rigidBodyIndexB;
+	physics_index rigidBodyIndexA;
+	physics_index rigidBodyIndexB;
 	vec3 relGlobalAnchorA;
 	vec3 relGlobalAnchorB;
 
@@ -202,27 +170,6 @@ struct fixed_constraint_solver
 	uint32 count;
 };
 
-struct simd_fixed_constraint_batch
-{
-	uint16 rbAIndices[CONSTRAINT_SIMD_WIDTH];
-	uint16 rbBIndices[CONSTRAINT_SIMD_WIDTH];
-
-	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
-	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
-
-	float translationBias[3][CONSTRAINT_SIMD_WIDTH];
-	float invEffectiveTranslationMass[9][CONSTRAINT_SIMD_WIDTH];
-
-	float rotationBias[3][CONSTRAINT_SIMD_WIDTH];
-	float invEffectiveRotationMass[9][CONSTRAINT_SIMD_WIDTH];
-};
-
-struct simd_fixed_constraint_solver
-{
-	simd_fixed_constraint_batch* batches;
-	uint32 numBatches;
-};
-
 
 // Hinge constraint.
 
@@ -258,8 +205,8 @@ struct hinge_constraint
 
 struct hinge_constraint_update
 {
-	uint16 rigidBodyIndexA;
-	uint16 rigidBodyIndexB;
+	physics_index rigidBodyIndexA;
+	physics_index rigidBodyIndexB;
 
 	vec3 relGlobalAnchorA;
 	vec3 relGlobalAnchorB;
@@ -298,48 +245,6 @@ struct hinge_constraint_solver
 	uint32 count;
 };
 
-struct simd_hinge_constraint_batch
-{
-	uint16 rbAIndices[CONSTRAINT_SIMD_WIDTH];
-	uint16 rbBIndices[CONSTRAINT_SIMD_WIDTH];
-
-	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
-	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
-
-	float translationBias[3][CONSTRAINT_SIMD_WIDTH];
-	float invEffectiveTranslationMass[9][CONSTRAINT_SIMD_WIDTH];
-
-
-	float rotationBias[2][CONSTRAINT_SIMD_WIDTH];
-	float invEffectiveRotationMass[4][CONSTRAINT_SIMD_WIDTH];
-	float bxa[3][CONSTRAINT_SIMD_WIDTH];
-	float cxa[3][CONSTRAINT_SIMD_WIDTH];
-
-	bool solveLimit;
-	bool solveMotor;
-
-	float globalRotationAxis[3][CONSTRAINT_SIMD_WIDTH];
-	float effectiveLimitAxialMass[CONSTRAINT_SIMD_WIDTH];
-	float effectiveMotorAxialMass[CONSTRAINT_SIMD_WIDTH];
-
-	float limitImpulse[CONSTRAINT_SIMD_WIDTH];
-	float limitBias[CONSTRAINT_SIMD_WIDTH];
-	float limitSign[CONSTRAINT_SIMD_WIDTH];
-
-	float motorImpulse[CONSTRAINT_SIMD_WIDTH];
-	float maxMotorImpulse[CONSTRAINT_SIMD_WIDTH];
-	float motorVelocity[CONSTRAINT_SIMD_WIDTH];
-
-	float motorAndLimitImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
-	float motorAndLimitImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
-};
-
-struct simd_hinge_constraint_solver
-{
-	simd_hinge_constraint_batch* batches;
-	uint32 numBatches;
-};
-
 
 // Cone-twist constraint.
 
@@ -381,8 +286,8 @@ struct cone_twist_constraint
 
 struct cone_twist_constraint_update
 {
-	uint16 rigidBodyIndexA;
-	uint16 rigidBodyIndexB;
+	physics_index rigidBodyIndexA;
+	physics_index rigidBodyIndexB;
 	vec3 relGlobalAnchorA;
 	vec3 relGlobalAnchorB;
 
@@ -432,65 +337,6 @@ struct cone_twist_constraint_solver
 	uint32 count;
 };
 
-struct simd_cone_twist_constraint_batch
-{
-	uint16 rbAIndices[CONSTRAINT_SIMD_WIDTH];
-	uint16 rbBIndices[CONSTRAINT_SIMD_WIDTH];
-
-	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
-	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
-
-	float bias[3][CONSTRAINT_SIMD_WIDTH];
-	float invEffectiveMass[9][CONSTRAINT_SIMD_WIDTH];
-
-	bool solveSwingLimit;
-	bool solveTwistLimit;
-	bool solveSwingMotor;
-	bool solveTwistMotor;
-
-	// Limits.
-	float globalSwingAxis[3][CONSTRAINT_SIMD_WIDTH];
-	float swingImpulse[CONSTRAINT_SIMD_WIDTH];
-	float effectiveSwingLimitMass[CONSTRAINT_SIMD_WIDTH];
-	float swingLimitBias[CONSTRAINT_SIMD_WIDTH];
-
-	float swingLimitImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
-	float swingLimitImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
-
-
-	float globalTwistAxis[3][CONSTRAINT_SIMD_WIDTH];
-	float twistImpulse[CONSTRAINT_SIMD_WIDTH];
-	float twistLimitSign[CONSTRAINT_SIMD_WIDTH];
-	float effectiveTwistLimitMass[CONSTRAINT_SIMD_WIDTH];
-	float twistLimitBias[CONSTRAINT_SIMD_WIDTH];
-
-
-
-	// Motors.
-	float swingMotorImpulse[CONSTRAINT_SIMD_WIDTH];
-	float maxSwingMotorImpulse[CONSTRAINT_SIMD_WIDTH];
-	float swingMotorVelocity[CONSTRAINT_SIMD_WIDTH];
-	float globalSwingMotorAxis[3][CONSTRAINT_SIMD_WIDTH];
-	float effectiveSwingMotorMass[CONSTRAINT_SIMD_WIDTH];
-
-	float swingMotorImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
-	float swingMotorImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
-
-	float twistMotorImpulse[CONSTRAINT_SIMD_WIDTH];
-	float maxTwistMotorImpulse[CONSTRAINT_SIMD_WIDTH];
-	float twistMotorVelocity[CONSTRAINT_SIMD_WIDTH];
-	float effectiveTwistMotorMass[CONSTRAINT_SIMD_WIDTH];
-
-	float twistMotorAndLimitImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
-	float twistMotorAndLimitImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
-};
-
-struct simd_cone_twist_constraint_solver
-{
-	simd_cone_twist_constraint_batch* batches;
-	uint32 numBatches;
-};
-
 
 // Slider constraint
 
@@ -521,8 +367,8 @@ struct slider_constraint
 
 struct slider_constraint_update
 {
-	uint16 rigidBodyIndexA;
-	uint16 rigidBodyIndexB;
+	physics_index rigidBodyIndexA;
+	physics_index rigidBodyIndexB;
 
 	vec3 rAuxt;
 	vec3 rAuxb;
@@ -563,52 +409,6 @@ struct slider_constraint_solver
 	uint32 count;
 };
 
-struct simd_slider_constraint_batch
-{
-	uint16 rbAIndices[CONSTRAINT_SIMD_WIDTH];
-	uint16 rbBIndices[CONSTRAINT_SIMD_WIDTH];
-
-	float rAuxt[3][CONSTRAINT_SIMD_WIDTH];
-	float rAuxb[3][CONSTRAINT_SIMD_WIDTH];
-	float rBxt[3][CONSTRAINT_SIMD_WIDTH];
-	float rBxb[3][CONSTRAINT_SIMD_WIDTH];
-
-	float tangent[3][CONSTRAINT_SIMD_WIDTH];
-	float bitangent[3][CONSTRAINT_SIMD_WIDTH];
-
-	float invEffectiveTranslationMass[4][CONSTRAINT_SIMD_WIDTH];
-	float translationBias[2][CONSTRAINT_SIMD_WIDTH];
-
-	float invEffectiveRotationMass[9][CONSTRAINT_SIMD_WIDTH];
-	float rotationBias[3][CONSTRAINT_SIMD_WIDTH];
-
-	float globalSliderAxis[3][CONSTRAINT_SIMD_WIDTH];
-
-	bool solveLimit;
-	bool solveMotor;
-
-	float effectiveAxialMass[CONSTRAINT_SIMD_WIDTH];
-	float limitBias[CONSTRAINT_SIMD_WIDTH];
-	float limitImpulse[CONSTRAINT_SIMD_WIDTH];
-	float limitSign[CONSTRAINT_SIMD_WIDTH];
-	float rAuxs[3][CONSTRAINT_SIMD_WIDTH];
-	float rBxs[3][CONSTRAINT_SIMD_WIDTH];
-
-	float limitImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
-	float limitImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
-
-	float motorVelocity[CONSTRAINT_SIMD_WIDTH];
-	float motorImpulse[CONSTRAINT_SIMD_WIDTH];
-	float maxMotorImpulse[CONSTRAINT_SIMD_WIDTH];
-	float effectiveMotorMass[CONSTRAINT_SIMD_WIDTH];
-};
-
-struct simd_slider_constraint_solver
-{
-	simd_slider_constraint_batch* batches;
-	uint32 numBatches;
-};
-
 
 // Collision constraint.
 
@@ -638,35 +438,6 @@ struct collision_constraint_solver
 	uint32 count;
 };
 
-struct simd_collision_constraint_batch
-{
-	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
-	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
-	float normal[3][CONSTRAINT_SIMD_WIDTH];
-	float tangent[3][CONSTRAINT_SIMD_WIDTH];
-
-	float normalImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
-	float tangentImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
-	float normalImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
-	float tangentImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
-
-	float effectiveMassInNormalDir[CONSTRAINT_SIMD_WIDTH];
-	float effectiveMassInTangentDir[CONSTRAINT_SIMD_WIDTH];
-	float friction[CONSTRAINT_SIMD_WIDTH];
-	float impulseInNormalDir[CONSTRAINT_SIMD_WIDTH];
-	float impulseInTangentDir[CONSTRAINT_SIMD_WIDTH];
-	float bias[CONSTRAINT_SIMD_WIDTH];
-
-	uint16 rbAIndices[CONSTRAINT_SIMD_WIDTH];
-	uint16 rbBIndices[CONSTRAINT_SIMD_WIDTH];
-};
-
-struct simd_collision_constraint_solver
-{
-	simd_collision_constraint_batch* batches;
-	uint32 numBatches;
-};
-
 
 
 
@@ -688,37 +459,15 @@ void solveConeTwistVelocityConstraints(cone_twist_constraint_solver constraints,
 slider_constraint_solver initializeSliderVelocityConstraints(memory_arena& arena, const rigid_body_global_state* rbs, const slider_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt);
 void solveSliderVelocityConstraints(slider_constraint_solver constraints, rigid_body_global_state* rbs);
 
-collision_constraint_solver initializeCollisionVelocityConstraints(memory_arena& arena, const rigid_body_global_state* rbs, const collision_contact* contacts, const constraint_body_pair* bodyPairs, uint32 numContacts, float dt);
+// warmStartImpulses may be null.
+collision_constraint_solver initializeCollisionVelocityConstraints(memory_arena& arena, const rigid_body_global_state* rbs, const collision_contact* contacts, const contact_impulse* warmStartImpulses, const constraint_body_pair* bodyPairs, uint32 numContacts, float dt);
+void warmStartCollisionVelocityConstraints(collision_constraint_solver constraints, rigid_body_global_state* rbs);
 void solveCollisionVelocityConstraints(collision_constraint_solver constraints, rigid_body_global_state* rbs);
+void getCollisionImpulses(collision_constraint_solver constraints, contact_impulse* outImpulses);
 
 
 
 
-// SIMD.
-
-simd_distance_constraint_solver initializeDistanceVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const distance_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt);
-void solveDistanceVelocityConstraintsSIMD(simd_distance_constraint_solver constraints, rigid_body_global_state* rbs);
-
-simd_ball_constraint_solver initializeBallVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const ball_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt);
-void solveBallVelocityConstraintsSIMD(simd_ball_constraint_solver constraints, rigid_body_global_state* rbs);
-
-simd_fixed_constraint_solver initializeFixedVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const fixed_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt);
-void solveFixedVelocityConstraintsSIMD(simd_fixed_constraint_solver constraints, rigid_body_global_state* rbs);
-
-simd_hinge_constraint_solver initializeHingeVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const hinge_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt);
-void solveHingeVelocityConstraintsSIMD(simd_hinge_constraint_solver constraints, rigid_body_global_state* rbs);
-
-simd_cone_twist_constraint_solver initializeConeTwistVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const cone_twist_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt);
-void solveConeTwistVelocityConstraintsSIMD(simd_cone_twist_constraint_solver constraints, rigid_body_global_state* rbs);
-
-simd_slider_constraint_solver initializeSliderVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const slider_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt);
-void solveSliderVelocityConstraintsSIMD(simd_slider_constraint_solver constraints, rigid_body_global_state* rbs);
-
-simd_collision_constraint_solver initializeCollisionVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const collision_contact* contacts, const constraint_body_pair* bodyPairs, uint32 numContacts, uint16 dummyRigidBodyIndex, float dt);
-void solveCollisionVelocityConstraintsSIMD(simd_collision_constraint_solver constraints, rigid_body_global_state* rbs);
-
-
-
 struct constraint_solver
 {
 	void initialize(memory_arena& arena, rigid_body_global_state* rbs,
@@ -729,39 +478,61 @@ struct constraint_solver
 		cone_twist_constraint* coneTwistConstraints, constraint_body_pair* coneTwistConstraintBodyPairs, uint32 numConeTwistConstraints,
 		slider_constraint* sliderConstraints, constraint_body_pair* sliderConstraintBodyPairs, uint32 numSliderConstraints,
 		collision_contact* contacts, constraint_body_pair* collisionBodyPairs, uint32 numContacts, 
+		const contact_impulse* contactWarmStartImpulses, // May be null. Otherwise numContacts many.
 		uint32 dummyRigidBodyIndex,	bool simd, float dt);
 
 	void solveOneIteration();
 
+	// Writes the accumulated impulses of all contacts. Call this after the last iteration.
+	void getContactImpulses(contact_impulse* outImpulses);
+
 private:
 
 	rigid_body_global_state* rbs;
 	bool simd;
 
 	distance_constraint_solver distanceConstraintSolver;
-	simd_distance_constraint_solver distanceConstraintSolverSIMD;
-
 	ball_constraint_solver ballConstraintSolver;
-	simd_ball_constraint_solver ballConstraintSolverSIMD;
-
 	fixed_constraint_solver fixedConstraintSolver;
-	simd_fixed_constraint_solver fixedConstraintSolverSIMD;
-
 	hinge_constraint_solver hingeConstraintSolver;
-	simd_hinge_constraint_solver hingeConstraintSolverSIMD;
-
 	cone_twist_constraint_solver coneTwistConstraintSolver;
-	simd_cone_twist_constraint_solver coneTwistConstraintSolverSIMD;
-
 	slider_constraint_solver sliderConstraintSolver;
-	simd_slider_constraint_solver sliderConstraintSolverSIMD;
-
 	collision_constraint_solver collisionConstraintSolver;
-	simd_collision_constraint_solver collisionConstraintSolverSIMD;
+
+	// The batch layout depends on the SIMD width, so the SIMD solvers are only known to the kernels of simdLevel (see constraints_simd.cpp).
+	// Allocated from the arena passed to initialize.
+	simd_level simdLevel;
+	void* simdSolvers;
 };
 
 
 
 
+// Internal.
+#define DISTANCE_CONSTRAINT_BETA 0.1f
+#define BALL_CONSTRAINT_BETA 0.1f
+#define SLIDER_CONSTRAINT_BETA 0.1f
+#define HINGE_ROTATION_CONSTRAINT_BETA 0.3f
+#define HINGE_LIMIT_CONSTRAINT_BETA 0.1f
+#define TWIST_LIMIT_CONSTRAINT_BETA 0.1f
+#define SLIDER_LIMIT_CONSTRAINT_BETA 0.1f
 
+#define DT_THRESHOLD 1e-5f
+
+// SIMD kernels, compiled once per SIMD level (see constraints_simd.cpp). Call through SIMD_DISPATCH_LEVEL with the level the solvers were
+// initialized with. Arguments as in constraint_solver::initialize.
+SIMD_KERNEL_DECLARATIONS(
+	void* initializeConstraintsSIMD(memory_arena& arena, rigid_body_global_state* rbs,
+		distance_constraint* distanceConstraints, constraint_body_pair* distanceConstraintBodyPairs, uint32 numDistanceConstraints,
+		ball_constraint* ballConstraints, constraint_body_pair* ballConstraintBodyPairs, uint32 numBallConstraints,
+		fixed_constraint* fixedConstraints, constraint_body_pair* fixedConstraintBodyPairs, uint32 numFixedConstraints,
+		hinge_constraint* hingeConstraints, constraint_body_pair* hingeConstraintBodyPairs, uint32 numHingeConstraints,
+		cone_twist_constraint* coneTwistConstraints, constraint_body_pair* coneTwistConstraintBodyPairs, uint32 numConeTwistConstraints,
+		slider_constraint* sliderConstraints, constraint_body_pair* sliderConstraintBodyPairs, uint32 numSliderConstraints,
+		collision_contact* contacts, constraint_body_pair* collisionBodyPairs, uint32 numContacts,
+		const contact_impulse* contactWarmStartImpulses,
+		uint32 dummyRigidBodyIndex, float dt);
 
+	void solveConstraintsOneIterationSIMD(void* solvers, rigid_body_global_state* rbs);
+	void getContactImpulsesSIMD(void* solvers, contact_impulse* outImpulses);
+)
@@ -0,0 +1,3045 @@
+#include "pch.h"
+#include "constraints.h"
+#include "physics.h"
+#include "collision_narrow.h"
+#include "core/cpu_profiling.h"
+#include "core/math_simd.h"
+
+// Constraint solver SIMD kernels. Compiled once per SIMD level, see core/simd_dispatch.h.
+
+namespace SIMD_ISA
+{
+
+#if defined(SIMD_AVX_512)
+#define CONSTRAINT_SIMD_WIDTH 16
+#elif defined(SIMD_AVX_2)
+#define CONSTRAINT_SIMD_WIDTH 8
+#else
+#define CONSTRAINT_SIMD_WIDTH 4
+#endif
+
+#if CONSTRAINT_SIMD_WIDTH == 4
+typedef w4_float w_float;
+typedef w4_int w_int;
+#elif CONSTRAINT_SIMD_WIDTH == 8 && defined(SIMD_AVX_2)
+typedef w8_float w_float;
+typedef w8_int w_int;
+#elif CONSTRAINT_SIMD_WIDTH == 16 && defined(SIMD_AVX_512)
+typedef w16_float w_float;
+typedef w16_int w_int;
+#endif
+
+typedef wN_vec2<w_float> w_vec2;
+typedef wN_vec3<w_float> w_vec3;
+typedef wN_vec4<w_float> w_vec4;
+typedef wN_quat<w_float> w_quat;
+typedef wN_mat2<w_float> w_mat2;
+typedef wN_mat3<w_float> w_mat3;
+
+
+
+
+struct simd_distance_constraint_batch
+{
+	physics_index rbAIndices[CONSTRAINT_SIMD_WIDTH];
+	physics_index rbBIndices[CONSTRAINT_SIMD_WIDTH];
+
+	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
+	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
+
+	float impulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
+	float impulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
+
+	float u[3][CONSTRAINT_SIMD_WIDTH];
+	float bias[CONSTRAINT_SIMD_WIDTH];
+	float effectiveMass[CONSTRAINT_SIMD_WIDTH];
+};
+
+struct simd_distance_constraint_solver
+{
+	simd_distance_constraint_batch* batches;
+	uint32 numBatches;
+};
+
+struct simd_ball_constraint_batch
+{
+	physics_index rbAIndices[CONSTRAINT_SIMD_WIDTH];
+	physics_index rbBIndices[CONSTRAINT_SIMD_WIDTH];
+
+	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
+	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
+
+	float bias[3][CONSTRAINT_SIMD_WIDTH];
+	float invEffectiveMass[9][CONSTRAINT_SIMD_WIDTH];
+};
+
+struct simd_ball_constraint_solver
+{
+	simd_ball_constraint_batch* batches;
+	uint32 numBatches;
+};
+
+struct simd_fixed_constraint_batch
+{
+	physics_index rbAIndices[CONSTRAINT_SIMD_WIDTH];
+	physics_index rbBIndices[CONSTRAINT_SIMD_WIDTH];
+
+	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
+	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
+
+	float translationBias[3][CONSTRAINT_SIMD_WIDTH];
+	float invEffectiveTranslationMass[9][CONSTRAINT_SIMD_WIDTH];
+
+	float rotationBias[3][CONSTRAINT_SIMD_WIDTH];
+	float invEffectiveRotationMass[9][CONSTRAINT_SIMD_WIDTH];
+};
+
+struct simd_fixed_constraint_solver
+{
+	simd_fixed_constraint_batch* batches;
+	uint32 numBatches;
+};
+
+struct simd_hinge_constraint_batch
+{
+	physics_index rbAIndices[CONSTRAINT_SIMD_WIDTH];
+	physics_index rbBIndices[CONSTRAINT_SIMD_WIDTH];
+
+	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
+	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
+
+	float translationBias[3][CONSTRAINT_SIMD_WIDTH];
+	float invEffectiveTranslationMass[9][CONSTRAINT_SIMD_WIDTH];
+
+
+	float rotationBias[2][CONSTRAINT_SIMD_WIDTH];
+	float invEffectiveRotationMass[4][CONSTRAINT_SIMD_WIDTH];
+	float bxa[3][CONSTRAINT_SIMD_WIDTH];
+	float cxa[3][CONSTRAINT_SIMD_WIDTH];
+
+	bool solveLimit;
+	bool solveMotor;
+
+	float globalRotationAxis[3][CONSTRAINT_SIMD_WIDTH];
+	float effectiveLimitAxialMass[CONSTRAINT_SIMD_WIDTH];
+	float effectiveMotorAxialMass[CONSTRAINT_SIMD_WIDTH];
+
+	float limitImpulse[CONSTRAINT_SIMD_WIDTH];
+	float limitBias[CONSTRAINT_SIMD_WIDTH];
+	float limitSign[CONSTRAINT_SIMD_WIDTH];
+
+	float motorImpulse[CONSTRAINT_SIMD_WIDTH];
+	float maxMotorImpulse[CONSTRAINT_SIMD_WIDTH];
+	float motorVelocity[CONSTRAINT_SIMD_WIDTH];
+
+	float motorAndLimitImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
+	float motorAndLimitImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
+};
+
+struct simd_hinge_constraint_solver
+{
+	simd_hinge_constraint_batch* batches;
+	uint32 numBatches;
+};
+
+struct simd_cone_twist_constraint_batch
+{
+	physics_index rbAIndices[CONSTRAINT_SIMD_WIDTH];
+	physics_index rbBIndices[CONSTRAINT_SIMD_WIDTH];
+
+	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
+	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
+
+	float bias[3][CONSTRAINT_SIMD_WIDTH];
+	float invEffectiveMass[9][CONSTRAINT_SIMD_WIDTH];
+
+	bool solveSwingLimit;
+	bool solveTwistLimit;
+	bool solveSwingMotor;
+	bool solveTwistMotor;
+
+	// Limits.
+	float globalSwingAxis[3][CONSTRAINT_SIMD_WIDTH];
+	float swingImpulse[CONSTRAINT_SIMD_WIDTH];
+	float effectiveSwingLimitMass[CONSTRAINT_SIMD_WIDTH];
+	float swingLimitBias[CONSTRAINT_SIMD_WIDTH];
+
+	float swingLimitImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
+	float swingLimitImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
+
+
+	float globalTwistAxis[3][CONSTRAINT_SIMD_WIDTH];
+	float twistImpulse[CONSTRAINT_SIMD_WIDTH];
+	float twistLimitSign[CONSTRAINT_SIMD_WIDTH];
+	float effectiveTwistLimitMass[CONSTRAINT_SIMD_WIDTH];
+	float twistLimitBias[CONSTRAINT_SIMD_WIDTH];
+
+
+
+	// Motors.
+	float swingMotorImpulse[CONSTRAINT_SIMD_WIDTH];
+	float maxSwingMotorImpulse[CONSTRAINT_SIMD_WIDTH];
+	float swingMotorVelocity[CONSTRAINT_SIMD_WIDTH];
+	float globalSwingMotorAxis[3][CONSTRAINT_SIMD_WIDTH];
+	float effectiveSwingMotorMass[CONSTRAINT_SIMD_WIDTH];
+
+	float swingMotorImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
+	float swingMotorImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
+
+	float twistMotorImpulse[CONSTRAINT_SIMD_WIDTH];
+	float maxTwistMotorImpulse[CONSTRAINT_SIMD_WIDTH];
+	float twistMotorVelocity[CONSTRAINT_SIMD_WIDTH];
+	float effectiveTwistMotorMass[CONSTRAINT_SIMD_WIDTH];
+
+	float twistMotorAndLimitImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
+	float twistMotorAndLimitImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
+};
+
+struct simd_cone_twist_constraint_solver
+{
+	simd_cone_twist_constraint_batch* batches;
+	uint32 numBatches;
+};
+
+struct simd_slider_constraint_batch
+{
+	physics_index rbAIndices[CONSTRAINT_SIMD_WIDTH];
+	physics_index rbBIndices[CONSTRAINT_SIMD_WIDTH];
+
+	float rAuxt[3][CONSTRAINT_SIMD_WIDTH];
+	float rAuxb[3][CONSTRAINT_SIMD_WIDTH];
+	float rBxt[3][CONSTRAINT_SIMD_WIDTH];
+	float rBxb[3][CONSTRAINT_SIMD_WIDTH];
+
+	float tangent[3][CONSTRAINT_SIMD_WIDTH];
+	float bitangent[3][CONSTRAINT_SIMD_WIDTH];
+
+	float invEffectiveTranslationMass[4][CONSTRAINT_SIMD_WIDTH];
+	float translationBias[2][CONSTRAINT_SIMD_WIDTH];
+
+	float invEffectiveRotationMass[9][CONSTRAINT_SIMD_WIDTH];
+	float rotationBias[3][CONSTRAINT_SIMD_WIDTH];
+
+	float globalSliderAxis[3][CONSTRAINT_SIMD_WIDTH];
+
+	bool solveLimit;
+	bool solveMotor;
+
+	float effectiveAxialMass[CONSTRAINT_SIMD_WIDTH];
+	float limitBias[CONSTRAINT_SIMD_WIDTH];
+	float limitImpulse[CONSTRAINT_SIMD_WIDTH];
+	float limitSign[CONSTRAINT_SIMD_WIDTH];
+	float rAuxs[3][CONSTRAINT_SIMD_WIDTH];
+	float rBxs[3][CONSTRAINT_SIMD_WIDTH];
+
+	float limitImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
+	float limitImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
+
+	float motorVelocity[CONSTRAINT_SIMD_WIDTH];
+	float motorImpulse[CONSTRAINT_SIMD_WIDTH];
+	float maxMotorImpulse[CONSTRAINT_SIMD_WIDTH];
+	float effectiveMotorMass[CONSTRAINT_SIMD_WIDTH];
+};
+
+struct simd_slider_constraint_solver
+{
+	simd_slider_constraint_batch* batches;
+	uint32 numBatches;
+};
+
+struct simd_collision_constraint_batch
+{
+	float relGlobalAnchorA[3][CONSTRAINT_SIMD_WIDTH];
+	float relGlobalAnchorB[3][CONSTRAINT_SIMD_WIDTH];
+	float normal[3][CONSTRAINT_SIMD_WIDTH];
+	float tangent[3][CONSTRAINT_SIMD_WIDTH];
+
+	float normalImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
+	float tangentImpulseToAngularVelocityA[3][CONSTRAINT_SIMD_WIDTH];
+	float normalImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
+	float tangentImpulseToAngularVelocityB[3][CONSTRAINT_SIMD_WIDTH];
+
+	float effectiveMassInNormalDir[CONSTRAINT_SIMD_WIDTH];
+	float effectiveMassInTangentDir[CONSTRAINT_SIMD_WIDTH];
+	float friction[CONSTRAINT_SIMD_WIDTH];
+	float impulseInNormalDir[CONSTRAINT_SIMD_WIDTH];
+	float impulseInTangentDir[CONSTRAINT_SIMD_WIDTH];
+	float bias[CONSTRAINT_SIMD_WIDTH];
+
+	physics_index rbAIndices[CONSTRAINT_SIMD_WIDTH];
+	physics_index rbBIndices[CONSTRAINT_SIMD_WIDTH];
+	uint32 contactIndices[CONSTRAINT_SIMD_WIDTH];
+};
+
+struct simd_collision_constraint_solver
+{
+	simd_collision_constraint_batch* batches;
+	uint32 numBatches;
+};
+
+
+
+struct alignas(CONSTRAINT_SIMD_WIDTH * 4) simd_constraint_body_pair
+{
+#if PHYSICS_32BIT_INDICES
+	uint32 a[CONSTRAINT_SIMD_WIDTH];
+	uint32 b[CONSTRAINT_SIMD_WIDTH];
+#else
+	uint32 ab[CONSTRAINT_SIMD_WIDTH]; // Both 16-bit indices packed into one lane.
+#endif
+};
+
+struct alignas(CONSTRAINT_SIMD_WIDTH * 4) simd_constraint_slot
+{
+	uint32 indices[CONSTRAINT_SIMD_WIDTH];
+};
+
+static void setInvalid(simd_constraint_body_pair& pair, w_int invalid)
+{
+#if PHYSICS_32BIT_INDICES
+	invalid.store((int*)pair.a);
+	invalid.store((int*)pair.b);
+#else
+	invalid.store((int*)pair.ab);
+#endif
+}
+
+static uint32 scheduleConstraintsSIMD(memory_arena& arena, const constraint_body_pair* bodyPairs, uint32 numBodyPairs, physics_index dummyRigidBodyIndex, simd_constraint_slot* outConstraintSlots)
+{
+	CPU_PROFILE_BLOCK("Schedule constraints SIMD");
+
+	uint32 numConstraintSlots = 0;
+
+	static const uint32 numBuckets = 4;
+	simd_constraint_body_pair* pairBuckets[numBuckets];
+	simd_constraint_slot* slotBuckets[numBuckets];
+	uint32 numEntriesPerBucket[numBuckets] = {};
+
+	w_int invalid = ~0;
+
+	uint32 numAllocationsPerBucket = bucketize(numBodyPairs, numBuckets);
+
+	memory_marker marker = arena.getMarker();
+
+	for (unsigned i = 0; i < numBuckets; ++i)
+	{
+		pairBuckets[i] = arena.allocate<simd_constraint_body_pair>(numAllocationsPerBucket + 1);
+		slotBuckets[i] = arena.allocate<simd_constraint_slot>(numAllocationsPerBucket);
+
+		// Add padding with invalid data so we don't have to range check.
+		setInvalid(pairBuckets[i][0], invalid);
+	}
+
+	for (uint32 i = 0; i < numBodyPairs; ++i)
+	{
+		constraint_body_pair bodyPair = bodyPairs[i];
+
+		// If one of the bodies is the dummy, just set it to the other for the comparison below.
+		physics_index rbA = (bodyPair.rbA == dummyRigidBodyIndex) ? bodyPair.rbB : bodyPair.rbA;
+		physics_index rbB = (bodyPair.rbB == dummyRigidBodyIndex) ? bodyPair.rbA : bodyPair.rbB;
+
+		uint32 bucket = i % numBuckets;
+		simd_constraint_body_pair* pairs = pairBuckets[bucket];
+		simd_constraint_slot* slots = slotBuckets[bucket];
+
+
+#if PHYSICS_32BIT_INDICES
+		w_int a = (int32)rbA;
+		w_int b = (int32)rbB;
+		w_int scheduled;
+
+		uint32 j = 0;
+		for (;; ++j)
+		{
+			scheduled = (const int32*)pairs[j].a;
+			w_int scheduledB = (const int32*)pairs[j].b;
+
+			auto conflictsWithThisSlot = (a == scheduled) | (a == scheduledB) | (b == scheduled) | (b == scheduledB);
+			if (!anyTrue(conflictsWithThisSlot))
+			{
+				break;
+			}
+		}
+#elif CONSTRAINT_SIMD_WIDTH == 4
+		w_int a = _mm_set1_epi16(rbA);
+		w_int b = _mm_set1_epi16(rbB);
+		w_int scheduled;
+
+		uint32 j = 0;
+		for (;; ++j)
+		{
+			scheduled = _mm_load_si128((const __m128i*)pairs[j].ab);
+
+			__m128i conflictsWithThisSlot = _mm_packs_epi16(_mm_cmpeq_epi16(a, scheduled), _mm_cmpeq_epi16(b, scheduled));
+			if (!_mm_movemask_epi8(conflictsWithThisSlot))
+			{
+				break;
+			}
+		}
+#elif CONSTRAINT_SIMD_WIDTH == 16
+		w_int a = _mm512_set1_epi16(rbA);
+		w_int b = _mm512_set1_epi16(rbB);
+		w_int scheduled;
+
+		uint32 j = 0;
+		for (;; ++j)
+		{
+			scheduled = _mm512_load_si512(pairs[j].ab);
+
+			__mmask32 conflictsWithThisSlot = _mm512_cmpeq_epi16_mask(a, scheduled) | _mm512_cmpeq_epi16_mask(b, scheduled);
+			if (!conflictsWithThisSlot)
+			{
+				break;
+			}
+		}
+#else
+		w_int a = _mm256_set1_epi16(rbA);
+		w_int b = _mm256_set1_epi16(rbB);
+		w_int scheduled;
+
+		uint32 j = 0;
+		for (;; ++j)
+		{
+			scheduled = _mm256_load_si256((const __m256i*)pairs[j].ab);
+
+			__m256i conflictsWithThisSlot = _mm256_packs_epi16(_mm256_cmpeq_epi16(a, scheduled), _mm256_cmpeq_epi16(b, scheduled));
+			if (!_mm256_movemask_epi8(conflictsWithThisSlot))
+			{
+				break;
+			}
+		}
+
+#endif
+
+
+		uint32 lane = indexOfLeastSignificantSetBit(toBitMask(scheduled == invalid));
+
+		simd_constraint_body_pair* pair = pairs + j;
+		simd_constraint_slot* slot = slots + j;
+
+		slot->indices[lane] = i;
+
+		// Use the original indices here.
+#if PHYSICS_32BIT_INDICES
+		pair->a[lane] = bodyPair.rbA;
+		pair->b[lane] = bodyPair.rbB;
+#else
+		pair->ab[lane] = ((uint32)bodyPair.rbA << 16) | bodyPair.rbB;
+#endif
+
+		uint32& count = numEntriesPerBucket[bucket];
+		if (j == count)
+		{
+			// We used a new entry.
+			++count;
+
+			// Set entry at end to invalid.
+			setInvalid(pairs[count], invalid);
+		}
+		else if (lane == CONSTRAINT_SIMD_WIDTH - 1)
+		{
+			// This entry is full -> commit it.
+			w_int indices = (int32*)slot->indices;
+
+			// Swap and pop.
+			--count;
+			*pair = pairs[count];
+			*slot = slots[count];
+
+			indices.store((int32*)outConstraintSlots[numConstraintSlots++].indices);
+
+			// Set entry at end to invalid.
+			setInvalid(pairs[count], invalid);
+		}
+	}
+
+	// There are still entries left, where not all lanes are filled. We replace these indices with the first in this entry.
+
+	for (uint32 bucket = 0; bucket < numBuckets; ++bucket)
+	{
+		simd_constraint_body_pair* pairs = pairBuckets[bucket];
+		simd_constraint_slot* slots = slotBuckets[bucket];
+		uint32 count = numEntriesPerBucket[bucket];
+
+		for (uint32 i = 0; i < count; ++i)
+		{
+#if PHYSICS_32BIT_INDICES
+			w_int ab = (int32*)pairs[i].a;
+#else
+			w_int ab = (int32*)pairs[i].ab;
+#endif
+			w_int indices = (int32_t*)slots[i].indices;
+
+			w_int firstIndex = fillWithFirstLane(indices);
+
+			auto mask = ab == invalid;
+			indices = ifThen(mask, firstIndex, indices);
+			indices.store((int32*)outConstraintSlots[numConstraintSlots++].indices);
+		}
+	}
+
+	arena.resetToMarker(marker);
+
+	return numConstraintSlots;
+}
+
+
+
+static simd_distance_constraint_solver initializeDistanceVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const distance_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt)
+{
+	CPU_PROFILE_BLOCK("Initialize distance constraints SIMD");
+
+	simd_constraint_slot* contactSlots = arena.allocate<simd_constraint_slot>(count);
+	uint32 numBatches = scheduleConstraintsSIMD(arena, bodyPairs, count, INVALID_PHYSICS_INDEX, contactSlots);
+
+	simd_distance_constraint_batch* batches = arena.allocate<simd_distance_constraint_batch>(numBatches);
+
+	const w_float zero = w_float::zero();
+	const w_float invDt = 1.f / dt;
+
+	for (uint32 i = 0; i < numBatches; ++i)
+	{
+		const simd_constraint_slot& slot = contactSlots[i];
+		simd_distance_constraint_batch& batch = batches[i];
+
+		physics_index constraintIndices[CONSTRAINT_SIMD_WIDTH];
+		for (uint32 j = 0; j < CONSTRAINT_SIMD_WIDTH; ++j)
+		{
+			constraintIndices[j] = (physics_index)slot.indices[j];
+			batch.rbAIndices[j] = bodyPairs[slot.indices[j]].rbA;
+			batch.rbBIndices[j] = bodyPairs[slot.indices[j]].rbB;
+		}
+
+
+		w_vec3 localAnchorA, localAnchorB;
+		w_float globalLength;
+		w_float dummy;
+		load8((float*)input, constraintIndices, (uint32)sizeof(*input),
+			localAnchorA.x, localAnchorA.y, localAnchorA.z, localAnchorB.x, localAnchorB.y, localAnchorB.z, globalLength, dummy);
+
+
+		// Load body A.
+		w_vec3 localCOGPositionA;
+		w_quat rotationA;
+		w_vec3 positionA;
+		w_mat3 invInertiaA;
+		w_float invMassA;
+
+		load8(&rbs->rotation.x, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationA.x, rotationA.y, rotationA.z, rotationA.w,
+			localCOGPositionA.x, localCOGPositionA.y, localCOGPositionA.z,
+			positionA.x);
+
+		load8(&rbs->position.y, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			positionA.y, positionA.z,
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m02, invInertiaA.m12, invInertiaA.m22,
+			invMassA);
+
+
+		// Load body B.
+		w_quat rotationB;
+		w_vec3 positionB;
+		w_vec3 localCOGPositionB;
+		w_mat3 invInertiaB;
+		w_float invMassB;
+
+		load8(&rbs->rotation.x, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationB.x, rotationB.y, rotationB.z, rotationB.w,
+			localCOGPositionB.x, localCOGPositionB.y, localCOGPositionB.z,
+			positionB.x);
+
+		load8(&rbs->position.y, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			positionB.y, positionB.z,
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m02, invInertiaB.m12, invInertiaB.m22,
+			invMassB);
+
+
+		// Relative to COG.
+		w_vec3 relGlobalAnchorA = rotationA * (localAnchorA - localCOGPositionA);
+		w_vec3 relGlobalAnchorB = rotationB * (localAnchorB - localCOGPositionB);
+
+		// Global.
+		w_vec3 globalAnchorA = positionA + relGlobalAnchorA;
+		w_vec3 globalAnchorB = positionB + relGlobalAnchorB;
+
+		w_vec3 u = globalAnchorB - globalAnchorA;
+		w_float l = length(u);
+		u = ifThen(l > 0.001f, u * (1.f / l), w_vec3::zero());
+
+		w_vec3 crAu = cross(relGlobalAnchorA, u);
+		w_vec3 crBu = cross(relGlobalAnchorB, u);
+		w_float invMass = invMassA + dot(crAu, invInertiaA * crAu)
+					   + invMassB + dot(crBu, invInertiaB * crBu);
+		w_float effectiveMass = ifThen(invMass != zero, 1.f / invMass, zero);
+
+		w_float bias = zero;
+		if (dt > DT_THRESHOLD)
+		{
+			bias = (l - globalLength) * (w_float(DISTANCE_CONSTRAINT_BETA) * invDt);
+		}
+
+		w_vec3 impulseToAngularVelocityA = invInertiaA * cross(relGlobalAnchorA, crAu);
+		w_vec3 impulseToAngularVelocityB = invInertiaB * cross(relGlobalAnchorB, crBu);
+
+
+		relGlobalAnchorA.x.store(batch.relGlobalAnchorA[0]);
+		relGlobalAnchorA.y.store(batch.relGlobalAnchorA[1]);
+		relGlobalAnchorA.z.store(batch.relGlobalAnchorA[2]);
+
+		relGlobalAnchorB.x.store(batch.relGlobalAnchorB[0]);
+		relGlobalAnchorB.y.store(batch.relGlobalAnchorB[1]);
+		relGlobalAnchorB.z.store(batch.relGlobalAnchorB[2]);
+
+		impulseToAngularVelocityA.x.store(batch.impulseToAngularVelocityA[0]);
+		impulseToAngularVelocityA.y.store(batch.impulseToAngularVelocityA[1]);
+		impulseToAngularVelocityA.z.store(batch.impulseToAngularVelocityA[2]);
+
+		impulseToAngularVelocityB.x.store(batch.impulseToAngularVelocityB[0]);
+		impulseToAngularVelocityB.y.store(batch.impulseToAngularVelocityB[1]);
+		impulseToAngularVelocityB.z.store(batch.impulseToAngularVelocityB[2]);
+
+		u.x.store(batch.u[0]);
+		u.y.store(batch.u[1]);
+		u.z.store(batch.u[2]);
+
+		bias.store(batch.bias);
+		effectiveMass.store(batch.effectiveMass);
+	}
+
+	simd_distance_constraint_solver result;
+	result.batches = batches;
+	result.numBatches = numBatches;
+	return result;
+}
+
+static void solveDistanceVelocityConstraintsSIMD(simd_distance_constraint_solver constraints, rigid_body_global_state* rbs)
+{
+	CPU_PROFILE_BLOCK("Solve distance constraints SIMD");
+
+	for (uint32 i = 0; i < constraints.numBatches; ++i)
+	{
+		simd_distance_constraint_batch& batch = constraints.batches[i];
+
+
+		// Load body A.
+		w_vec3 vA, wA;
+		w_float invMassA;
+		w_float dummyA;
+
+		load8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyA, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+
+		// Load body B.
+		w_vec3 vB, wB;
+		w_float invMassB;
+		w_float dummyB;
+
+		load8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyB, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+
+
+		// Load constraint.
+		w_vec3 relGlobalAnchorA(batch.relGlobalAnchorA[0], batch.relGlobalAnchorA[1], batch.relGlobalAnchorA[2]);
+		w_vec3 relGlobalAnchorB(batch.relGlobalAnchorB[0], batch.relGlobalAnchorB[1], batch.relGlobalAnchorB[2]);
+		w_vec3 impulseToAngularVelocityA(batch.impulseToAngularVelocityA[0], batch.impulseToAngularVelocityA[1], batch.impulseToAngularVelocityA[2]);
+		w_vec3 impulseToAngularVelocityB(batch.impulseToAngularVelocityB[0], batch.impulseToAngularVelocityB[1], batch.impulseToAngularVelocityB[2]);
+		w_vec3 u(batch.u[0], batch.u[1], batch.u[2]);
+		w_float bias(batch.bias);
+		w_float effectiveMass(batch.effectiveMass);
+
+		w_vec3 anchorVelocityA = vA + cross(wA, relGlobalAnchorA);
+		w_vec3 anchorVelocityB = vB + cross(wB, relGlobalAnchorB);
+		w_float Cdot = dot(u, anchorVelocityB - anchorVelocityA) + bias;
+
+		w_float lambda = -effectiveMass * Cdot;
+		w_vec3 P = lambda * u;
+		vA -= invMassA * P;
+		wA -= impulseToAngularVelocityA * lambda;
+		vB += invMassB * P;
+		wB += impulseToAngularVelocityB * lambda;
+
+
+		store8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyA, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+		store8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyB, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+	}
+}
+
+
+
+
+static simd_ball_constraint_solver initializeBallVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const ball_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt)
+{
+	CPU_PROFILE_BLOCK("Initialize distance constraints SIMD");
+
+	simd_constraint_slot* contactSlots = arena.allocate<simd_constraint_slot>(count);
+	uint32 numBatches = scheduleConstraintsSIMD(arena, bodyPairs, count, INVALID_PHYSICS_INDEX, contactSlots);
+
+	simd_ball_constraint_batch* batches = arena.allocate<simd_ball_constraint_batch>(numBatches);
+
+	const w_float zero = w_float::zero();
+	const w_float invDt = 1.f / dt;
+	const w_float one = 1.f;
+
+	const w_mat3 identity(one, zero, zero,
+		zero, one, zero,
+		zero, zero, one);
+
+	for (uint32 i = 0; i < numBatches; ++i)
+	{
+		const simd_constraint_slot& slot = contactSlots[i];
+		simd_ball_constraint_batch& batch = batches[i];
+
+		physics_index constraintIndices[CONSTRAINT_SIMD_WIDTH];
+		for (uint32 j = 0; j < CONSTRAINT_SIMD_WIDTH; ++j)
+		{
+			constraintIndices[j] = (physics_index)slot.indices[j];
+			batch.rbAIndices[j] = bodyPairs[slot.indices[j]].rbA;
+			batch.rbBIndices[j] = bodyPairs[slot.indices[j]].rbB;
+		}
+
+		// Load body A.
+		w_vec3 localCOGPositionA;
+		w_quat rotationA;
+		w_vec3 positionA;
+		w_mat3 invInertiaA;
+		w_float invMassA;
+
+		load8(&rbs->rotation.x, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationA.x, rotationA.y, rotationA.z, rotationA.w,
+			localCOGPositionA.x, localCOGPositionA.y, localCOGPositionA.z,
+			positionA.x);
+
+		load8(&rbs->position.y, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			positionA.y, positionA.z,
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m02, invInertiaA.m12, invInertiaA.m22,
+			invMassA);
+
+
+		// Load body B.
+		w_quat rotationB;
+		w_vec3 positionB;
+		w_vec3 localCOGPositionB;
+		w_mat3 invInertiaB;
+		w_float invMassB;
+
+		load8(&rbs->rotation.x, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationB.x, rotationB.y, rotationB.z, rotationB.w,
+			localCOGPositionB.x, localCOGPositionB.y, localCOGPositionB.z,
+			positionB.x);
+
+		load8(&rbs->position.y, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			positionB.y, positionB.z,
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m02, invInertiaB.m12, invInertiaB.m22,
+			invMassB);
+
+
+
+		w_vec3 localAnchorA, localAnchorB;
+		w_float dummy0, dummy1;
+		load8((float*)input, constraintIndices, (uint32)sizeof(*input),
+			localAnchorA.x, localAnchorA.y, localAnchorA.z, localAnchorB.x, localAnchorB.y, localAnchorB.z, dummy0, dummy1);
+
+
+		// Relative to COG.
+		w_vec3 relGlobalAnchorA = rotationA * (localAnchorA - localCOGPositionA);
+		w_vec3 relGlobalAnchorB = rotationB * (localAnchorB - localCOGPositionB);
+
+		// Global.
+		w_vec3 globalAnchorA = positionA + relGlobalAnchorA;
+		w_vec3 globalAnchorB = positionB + relGlobalAnchorB;
+
+		w_mat3 skewMatA = getSkewMatrix(relGlobalAnchorA);
+		w_mat3 skewMatB = getSkewMatrix(relGlobalAnchorB);
+		
+		w_mat3 invEffectiveMass = skewMatA * invInertiaA * transpose(skewMatA)
+							   + skewMatB * invInertiaB * transpose(skewMatB);
+		w_float invMassSum = invMassA + invMassB;
+		invEffectiveMass.m00 += invMassSum;
+		invEffectiveMass.m11 += invMassSum;
+		invEffectiveMass.m22 += invMassSum;
+
+		w_vec3 bias = zero;
+		if (dt > DT_THRESHOLD)
+		{
+			bias = (globalAnchorB - globalAnchorA) * (w_float(BALL_CONSTRAINT_BETA) * invDt);
+		}
+
+		relGlobalAnchorA.x.store(batch.relGlobalAnchorA[0]);
+		relGlobalAnchorA.y.store(batch.relGlobalAnchorA[1]);
+		relGlobalAnchorA.z.store(batch.relGlobalAnchorA[2]);
+
+		relGlobalAnchorB.x.store(batch.relGlobalAnchorB[0]);
+		relGlobalAnchorB.y.store(batch.relGlobalAnchorB[1]);
+		relGlobalAnchorB.z.store(batch.relGlobalAnchorB[2]);
+
+		bias.x.store(batch.bias[0]);
+		bias.y.store(batch.bias[1]);
+		bias.z.store(batch.bias[2]);
+
+		invEffectiveMass.m[0].store(batch.invEffectiveMass[0]);
+		invEffectiveMass.m[1].store(batch.invEffectiveMass[1]);
+		invEffectiveMass.m[2].store(batch.invEffectiveMass[2]);
+		invEffectiveMass.m[3].store(batch.invEffectiveMass[3]);
+		invEffectiveMass.m[4].store(batch.invEffectiveMass[4]);
+		invEffectiveMass.m[5].store(batch.invEffectiveMass[5]);
+		invEffectiveMass.m[6].store(batch.invEffectiveMass[6]);
+		invEffectiveMass.m[7].store(batch.invEffectiveMass[7]);
+		invEffectiveMass.m[8].store(batch.invEffectiveMass[8]);
+	}
+
+	simd_ball_constraint_solver result;
+	result.batches = batches;
+	result.numBatches = numBatches;
+	return result;
+}
+
+static void solveBallVelocityConstraintsSIMD(simd_ball_constraint_solver constraints, rigid_body_global_state* rbs)
+{
+	CPU_PROFILE_BLOCK("Solve ball constraints SIMD");
+
+	for (uint32 i = 0; i < constraints.numBatches; ++i)
+	{
+		simd_ball_constraint_batch& batch = constraints.batches[i];
+
+
+		// Load body A.
+		w_vec3 vA, wA;
+		w_float invMassA;
+		w_mat3 invInertiaA;
+
+		load8(&rbs->invInertia.m00, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21,
+			invInertiaA.m02, invInertiaA.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+
+		// Load body B.
+		w_vec3 vB, wB;
+		w_float invMassB;
+		w_mat3 invInertiaB;
+
+		load8(&rbs->invInertia.m00, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21,
+			invInertiaB.m02, invInertiaB.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+
+
+		// Load constraint.
+		w_vec3 relGlobalAnchorA(batch.relGlobalAnchorA[0], batch.relGlobalAnchorA[1], batch.relGlobalAnchorA[2]);
+		w_vec3 relGlobalAnchorB(batch.relGlobalAnchorB[0], batch.relGlobalAnchorB[1], batch.relGlobalAnchorB[2]);
+		w_vec3 bias(batch.bias[0], batch.bias[1], batch.bias[2]);
+		w_mat3 invEffectiveMass;
+		invEffectiveMass.m[0] = w_float(batch.invEffectiveMass[0]);
+		invEffectiveMass.m[1] = w_float(batch.invEffectiveMass[1]);
+		invEffectiveMass.m[2] = w_float(batch.invEffectiveMass[2]);
+		invEffectiveMass.m[3] = w_float(batch.invEffectiveMass[3]);
+		invEffectiveMass.m[4] = w_float(batch.invEffectiveMass[4]);
+		invEffectiveMass.m[5] = w_float(batch.invEffectiveMass[5]);
+		invEffectiveMass.m[6] = w_float(batch.invEffectiveMass[6]);
+		invEffectiveMass.m[7] = w_float(batch.invEffectiveMass[7]);
+		invEffectiveMass.m[8] = w_float(batch.invEffectiveMass[8]);
+
+		w_vec3 anchorVelocityA = vA + cross(wA, relGlobalAnchorA);
+		w_vec3 anchorVelocityB = vB + cross(wB, relGlobalAnchorB);
+		w_vec3 Cdot = anchorVelocityB - anchorVelocityA + bias;
+
+		w_vec3 P = solveLinearSystem(invEffectiveMass, -Cdot);
+		vA -= invMassA * P;
+		wA -= invInertiaA * cross(relGlobalAnchorA, P);
+		vB += invMassB * P;
+		wB += invInertiaB * cross(relGlobalAnchorB, P);
+
+
+		store8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+		store8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+	}
+}
+
+
+static simd_fixed_constraint_solver initializeFixedVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const fixed_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt)
+{
+	CPU_PROFILE_BLOCK("Initialize fixed constraints SIMD");
+
+	simd_constraint_slot* contactSlots = arena.allocate<simd_constraint_slot>(count);
+	uint32 numBatches = scheduleConstraintsSIMD(arena, bodyPairs, count, INVALID_PHYSICS_INDEX, contactSlots);
+
+	simd_fixed_constraint_batch* batches = arena.allocate<simd_fixed_constraint_batch>(numBatches);
+
+	const w_float zero = w_float::zero();
+	const w_float invDt = 1.f / dt;
+	const w_float one = 1.f;
+
+	for (uint32 i = 0; i < numBatches; ++i)
+	{
+		const simd_constraint_slot& slot = contactSlots[i];
+		simd_fixed_constraint_batch& batch = batches[i];
+
+		physics_index constraintIndices[CONSTRAINT_SIMD_WIDTH];
+		for (uint32 j = 0; j < CONSTRAINT_SIMD_WIDTH; ++j)
+		{
+			constraintIndices[j] = (physics_index)slot.indices[j];
+			batch.rbAIndices[j] = bodyPairs[slot.indices[j]].rbA;
+			batch.rbBIndices[j] = bodyPairs[slot.indices[j]].rbB;
+		}
+
+
+		// Load body A.
+		w_vec3 localCOGPositionA;
+		w_quat rotationA;
+		w_vec3 positionA;
+		w_mat3 invInertiaA;
+		w_float invMassA;
+
+		load8(&rbs->rotation.x, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationA.x, rotationA.y, rotationA.z, rotationA.w,
+			localCOGPositionA.x, localCOGPositionA.y, localCOGPositionA.z,
+			positionA.x);
+
+		load8(&rbs->position.y, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			positionA.y, positionA.z,
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m02, invInertiaA.m12, invInertiaA.m22,
+			invMassA);
+
+
+		// Load body B.
+		w_quat rotationB;
+		w_vec3 positionB;
+		w_vec3 localCOGPositionB;
+		w_mat3 invInertiaB;
+		w_float invMassB;
+
+		load8(&rbs->rotation.x, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationB.x, rotationB.y, rotationB.z, rotationB.w,
+			localCOGPositionB.x, localCOGPositionB.y, localCOGPositionB.z,
+			positionB.x);
+
+		load8(&rbs->position.y, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			positionB.y, positionB.z,
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m02, invInertiaB.m12, invInertiaB.m22,
+			invMassB);
+
+
+		w_quat initialInvRotationDifference;
+		w_vec3 localAnchorA, localAnchorB;
+		w_float dummy0, dummy1;
+		load8((float*)input, constraintIndices, (uint32)sizeof(*input),
+			initialInvRotationDifference.x, initialInvRotationDifference.y, initialInvRotationDifference.z, initialInvRotationDifference.w,
+			localAnchorA.x, localAnchorA.y, localAnchorA.z, localAnchorB.x);
+
+		load4(&input->localAnchorB.y, constraintIndices, (uint32)sizeof(*input),
+			localAnchorB.y, localAnchorB.z, dummy0, dummy1);
+
+
+		// Relative to COG.
+		w_vec3 relGlobalAnchorA = rotationA * (localAnchorA - localCOGPositionA);
+		w_vec3 relGlobalAnchorB = rotationB * (localAnchorB - localCOGPositionB);
+
+		// Global.
+		w_vec3 globalAnchorA = positionA + relGlobalAnchorA;
+		w_vec3 globalAnchorB = positionB + relGlobalAnchorB;
+
+		w_mat3 skewMatA = getSkewMatrix(relGlobalAnchorA);
+		w_mat3 skewMatB = getSkewMatrix(relGlobalAnchorB);
+
+		w_mat3 invEffectiveTranslationMass = skewMatA * invInertiaA * transpose(skewMatA)
+										  + skewMatB * invInertiaB * transpose(skewMatB);
+		w_float invMassSum = invMassA + invMassB;
+		invEffectiveTranslationMass.m00 += invMassSum;
+		invEffectiveTranslationMass.m11 += invMassSum;
+		invEffectiveTranslationMass.m22 += invMassSum;
+
+		w_mat3 invEffectiveRotationMass = invInertiaA + invInertiaB;
+
+		w_vec3 translationBias = zero;
+		w_vec3 rotationBias = zero;
+
+		if (dt > DT_THRESHOLD)
+		{
+			translationBias = (globalAnchorB - globalAnchorA) * (w_float(BALL_CONSTRAINT_BETA) * invDt);
+
+			w_quat rotationError = rotationB * initialInvRotationDifference * conjugate(rotationA);
+			rotationBias = rotationError.v * (SLIDER_CONSTRAINT_BETA * 2.f * invDt);
+		}
+
+		relGlobalAnchorA.x.store(batch.relGlobalAnchorA[0]);
+		relGlobalAnchorA.y.store(batch.relGlobalAnchorA[1]);
+		relGlobalAnchorA.z.store(batch.relGlobalAnchorA[2]);
+
+		relGlobalAnchorB.x.store(batch.relGlobalAnchorB[0]);
+		relGlobalAnchorB.y.store(batch.relGlobalAnchorB[1]);
+		relGlobalAnchorB.z.store(batch.relGlobalAnchorB[2]);
+
+		invEffectiveTranslationMass.m[0].store(batch.invEffectiveTranslationMass[0]);
+		invEffectiveTranslationMass.m[1].store(batch.invEffectiveTranslationMass[1]);
+		invEffectiveTranslationMass.m[2].store(batch.invEffectiveTranslationMass[2]);
+		invEffectiveTranslationMass.m[3].store(batch.invEffectiveTranslationMass[3]);
+		invEffectiveTranslationMass.m[4].store(batch.invEffectiveTranslationMass[4]);
+		invEffectiveTranslationMass.m[5].store(batch.invEffectiveTranslationMass[5]);
+		invEffectiveTranslationMass.m[6].store(batch.invEffectiveTranslationMass[6]);
+		invEffectiveTranslationMass.m[7].store(batch.invEffectiveTranslationMass[7]);
+		invEffectiveTranslationMass.m[8].store(batch.invEffectiveTranslationMass[8]);
+
+		translationBias.x.store(batch.translationBias[0]);
+		translationBias.y.store(batch.translationBias[1]);
+		translationBias.z.store(batch.translationBias[2]);
+
+		invEffectiveRotationMass.m[0].store(batch.invEffectiveRotationMass[0]);
+		invEffectiveRotationMass.m[1].store(batch.invEffectiveRotationMass[1]);
+		invEffectiveRotationMass.m[2].store(batch.invEffectiveRotationMass[2]);
+		invEffectiveRotationMass.m[3].store(batch.invEffectiveRotationMass[3]);
+		invEffectiveRotationMass.m[4].store(batch.invEffectiveRotationMass[4]);
+		invEffectiveRotationMass.m[5].store(batch.invEffectiveRotationMass[5]);
+		invEffectiveRotationMass.m[6].store(batch.invEffectiveRotationMass[6]);
+		invEffectiveRotationMass.m[7].store(batch.invEffectiveRotationMass[7]);
+		invEffectiveRotationMass.m[8].store(batch.invEffectiveRotationMass[8]);
+
+		rotationBias.x.store(batch.rotationBias[0]);
+		rotationBias.y.store(batch.rotationBias[1]);
+		rotationBias.z.store(batch.rotationBias[2]);
+	}
+
+	simd_fixed_constraint_solver result;
+	result.batches = batches;
+	result.numBatches = numBatches;
+	return result;
+}
+
+static void solveFixedVelocityConstraintsSIMD(simd_fixed_constraint_solver constraints, rigid_body_global_state* rbs)
+{
+	CPU_PROFILE_BLOCK("Solve fixed constraints SIMD");
+
+	for (uint32 i = 0; i < constraints.numBatches; ++i)
+	{
+		simd_fixed_constraint_batch& batch = constraints.batches[i];
+
+
+		// Load body A.
+		w_vec3 vA, wA;
+		w_float invMassA;
+		w_mat3 invInertiaA;
+
+		load8(&rbs->invInertia.m00, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21,
+			invInertiaA.m02, invInertiaA.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+
+		// Load body B.
+		w_vec3 vB, wB;
+		w_float invMassB;
+		w_mat3 invInertiaB;
+
+		load8(&rbs->invInertia.m00, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21,
+			invInertiaB.m02, invInertiaB.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+
+
+		// Rotation part.
+		{
+			w_vec3 rotationBias(batch.rotationBias[0], batch.rotationBias[1], batch.rotationBias[2]);
+			w_mat3 invEffectiveRotationMass;
+			invEffectiveRotationMass.m[0] = w_float(batch.invEffectiveRotationMass[0]);
+			invEffectiveRotationMass.m[1] = w_float(batch.invEffectiveRotationMass[1]);
+			invEffectiveRotationMass.m[2] = w_float(batch.invEffectiveRotationMass[2]);
+			invEffectiveRotationMass.m[3] = w_float(batch.invEffectiveRotationMass[3]);
+			invEffectiveRotationMass.m[4] = w_float(batch.invEffectiveRotationMass[4]);
+			invEffectiveRotationMass.m[5] = w_float(batch.invEffectiveRotationMass[5]);
+			invEffectiveRotationMass.m[6] = w_float(batch.invEffectiveRotationMass[6]);
+			invEffectiveRotationMass.m[7] = w_float(batch.invEffectiveRotationMass[7]);
+			invEffectiveRotationMass.m[8] = w_float(batch.invEffectiveRotationMass[8]);
+
+			w_vec3 Cdot = wB - wA;
+
+			w_vec3 rotationLambda = solveLinearSystem(invEffectiveRotationMass, -(Cdot + rotationBias));
+			wA -= invInertiaA * rotationLambda;
+			wB += invInertiaB * rotationLambda;
+		}
+
+
+		// Position part.
+		{
+			w_vec3 relGlobalAnchorA(batch.relGlobalAnchorA[0], batch.relGlobalAnchorA[1], batch.relGlobalAnchorA[2]);
+			w_vec3 relGlobalAnchorB(batch.relGlobalAnchorB[0], batch.relGlobalAnchorB[1], batch.relGlobalAnchorB[2]);
+			w_vec3 translationBias(batch.translationBias[0], batch.translationBias[1], batch.translationBias[2]);
+			w_mat3 invEffectiveTranslationMass;
+			invEffectiveTranslationMass.m[0] = w_float(batch.invEffectiveTranslationMass[0]);
+			invEffectiveTranslationMass.m[1] = w_float(batch.invEffectiveTranslationMass[1]);
+			invEffectiveTranslationMass.m[2] = w_float(batch.invEffectiveTranslationMass[2]);
+			invEffectiveTranslationMass.m[3] = w_float(batch.invEffectiveTranslationMass[3]);
+			invEffectiveTranslationMass.m[4] = w_float(batch.invEffectiveTranslationMass[4]);
+			invEffectiveTranslationMass.m[5] = w_float(batch.invEffectiveTranslationMass[5]);
+			invEffectiveTranslationMass.m[6] = w_float(batch.invEffectiveTranslationMass[6]);
+			invEffectiveTranslationMass.m[7] = w_float(batch.invEffectiveTranslationMass[7]);
+			invEffectiveTranslationMass.m[8] = w_float(batch.invEffectiveTranslationMass[8]);
+
+
+			w_vec3 anchorVelocityA = vA + cross(wA, relGlobalAnchorA);
+			w_vec3 anchorVelocityB = vB + cross(wB, relGlobalAnchorB);
+			w_vec3 Cdot = anchorVelocityB - anchorVelocityA + translationBias;
+
+			w_vec3 P = solveLinearSystem(invEffectiveTranslationMass, -Cdot);
+			vA -= invMassA * P;
+			wA -= invInertiaA * cross(relGlobalAnchorA, P);
+			vB += invMassB * P;
+			wB += invInertiaB * cross(relGlobalAnchorB, P);
+		}
+
+
+		store8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+		store8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+	}
+}
+
+
+
+static simd_hinge_constraint_solver initializeHingeVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const hinge_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt)
+{
+	CPU_PROFILE_BLOCK("Initialize hinge constraints SIMD");
+
+	simd_constraint_slot* contactSlots = arena.allocate<simd_constraint_slot>(count);
+	uint32 numBatches = scheduleConstraintsSIMD(arena, bodyPairs, count, INVALID_PHYSICS_INDEX, contactSlots);
+
+	simd_hinge_constraint_batch* batches = arena.allocate<simd_hinge_constraint_batch>(numBatches);
+
+	const w_float zero = w_float::zero();
+	const w_float invDt = 1.f / dt;
+	const w_float one = 1.f;
+
+	for (uint32 i = 0; i < numBatches; ++i)
+	{
+		const simd_constraint_slot& slot = contactSlots[i];
+		simd_hinge_constraint_batch& batch = batches[i];
+
+		physics_index constraintIndices[CONSTRAINT_SIMD_WIDTH];
+		for (uint32 j = 0; j < CONSTRAINT_SIMD_WIDTH; ++j)
+		{
+			constraintIndices[j] = (physics_index)slot.indices[j];
+			batch.rbAIndices[j] = bodyPairs[slot.indices[j]].rbA;
+			batch.rbBIndices[j] = bodyPairs[slot.indices[j]].rbB;
+		}
+
+
+		// Load body A.
+		w_vec3 localCOGPositionA;
+		w_quat rotationA;
+		w_vec3 positionA;
+		w_mat3 invInertiaA;
+		w_float invMassA;
+
+		load8(&rbs->rotation.x, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationA.x, rotationA.y, rotationA.z, rotationA.w,
+			localCOGPositionA.x, localCOGPositionA.y, localCOGPositionA.z,
+			positionA.x);
+
+		load8(&rbs->position.y, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			positionA.y, positionA.z,
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m02, invInertiaA.m12, invInertiaA.m22,
+			invMassA);
+
+
+		// Load body B.
+		w_quat rotationB;
+		w_vec3 positionB;
+		w_vec3 localCOGPositionB;
+		w_mat3 invInertiaB;
+		w_float invMassB;
+
+		load8(&rbs->rotation.x, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationB.x, rotationB.y, rotationB.z, rotationB.w,
+			localCOGPositionB.x, localCOGPositionB.y, localCOGPositionB.z,
+			positionB.x);
+
+		load8(&rbs->position.y, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			positionB.y, positionB.z,
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m02, invInertiaB.m12, invInertiaB.m22,
+			invMassB);
+
+
+
+		w_vec3 localAnchorA;
+		w_vec3 localAnchorB;
+		w_vec3 localHingeAxisA;
+		w_vec3 localHingeAxisB;
+
+		w_float minRotationLimit;
+		w_float maxRotationLimit;
+
+		w_float maxMotorTorque;
+		w_float motorTypeF;
+
+
+
+		load8((float*)input, constraintIndices, (uint32)sizeof(*input),
+			localAnchorA.x, localAnchorA.y, localAnchorA.z,
+			localAnchorB.x, localAnchorB.y, localAnchorB.z,
+			localHingeAxisA.x, localHingeAxisA.y);
+
+		load8(&input->localHingeAxisA.z, constraintIndices, (uint32)sizeof(*input),
+			localHingeAxisA.z, 
+			localHingeAxisB.x, localHingeAxisB.y, localHingeAxisB.z,
+			minRotationLimit, maxRotationLimit,
+			maxMotorTorque, motorTypeF);
+
+		w_int motorType = reinterpret(motorTypeF);
+
+
+		// Relative to COG.
+		w_vec3 relGlobalAnchorA = rotationA * (localAnchorA - localCOGPositionA);
+		w_vec3 relGlobalAnchorB = rotationB * (localAnchorB - localCOGPositionB);
+
+		// Global.
+		w_vec3 globalAnchorA = positionA + relGlobalAnchorA;
+		w_vec3 globalAnchorB = positionB + relGlobalAnchorB;
+
+
+
+
+		// Position part. Identical to ball.
+
+		w_mat3 skewMatA = getSkewMatrix(relGlobalAnchorA);
+		w_mat3 skewMatB = getSkewMatrix(relGlobalAnchorB);
+
+		w_mat3 invEffectiveTranslationMass = skewMatA * invInertiaA * transpose(skewMatA)
+										  + skewMatB * invInertiaB * transpose(skewMatB);
+		w_float invMassSum = invMassA + invMassB;
+		invEffectiveTranslationMass.m00 += invMassSum;
+		invEffectiveTranslationMass.m11 += invMassSum;
+		invEffectiveTranslationMass.m22 += invMassSum;
+
+		w_vec3 translationBias = zero;
+		if (dt > DT_THRESHOLD)
+		{
+			translationBias = (globalAnchorB - globalAnchorA) * (w_float(BALL_CONSTRAINT_BETA) * invDt);
+		}
+
+		relGlobalAnchorA.x.store(batch.relGlobalAnchorA[0]);
+		relGlobalAnchorA.y.store(batch.relGlobalAnchorA[1]);
+		relGlobalAnchorA.z.store(batch.relGlobalAnchorA[2]);
+
+		relGlobalAnchorB.x.store(batch.relGlobalAnchorB[0]);
+		relGlobalAnchorB.y.store(batch.relGlobalAnchorB[1]);
+		relGlobalAnchorB.z.store(batch.relGlobalAnchorB[2]);
+
+		translationBias.x.store(batch.translationBias[0]);
+		translationBias.y.store(batch.translationBias[1]);
+		translationBias.z.store(batch.translationBias[2]);
+
+		invEffectiveTranslationMass.m[0].store(batch.invEffectiveTranslationMass[0]);
+		invEffectiveTranslationMass.m[1].store(batch.invEffectiveTranslationMass[1]);
+		invEffectiveTranslationMass.m[2].store(batch.invEffectiveTranslationMass[2]);
+		invEffectiveTranslationMass.m[3].store(batch.invEffectiveTranslationMass[3]);
+		invEffectiveTranslationMass.m[4].store(batch.invEffectiveTranslationMass[4]);
+		invEffectiveTranslationMass.m[5].store(batch.invEffectiveTranslationMass[5]);
+		invEffectiveTranslationMass.m[6].store(batch.invEffectiveTranslationMass[6]);
+		invEffectiveTranslationMass.m[7].store(batch.invEffectiveTranslationMass[7]);
+		invEffectiveTranslationMass.m[8].store(batch.invEffectiveTranslationMass[8]);
+
+
+
+		// Rotation part.
+		w_vec3 globalHingeAxisA = rotationA * localHingeAxisA;
+		w_vec3 globalHingeAxisB = rotationB * localHingeAxisB;
+
+		w_vec3 globalTangentB, globalBitangentB;
+		getTangents(globalHingeAxisB, globalTangentB, globalBitangentB);
+
+		w_vec3 bxa = cross(globalTangentB, globalHingeAxisA);
+		w_vec3 cxa = cross(globalBitangentB, globalHingeAxisA);
+		w_vec3 iAbxa = invInertiaA * bxa;
+		w_vec3 iBbxa = invInertiaB * bxa;
+		w_vec3 iAcxa = invInertiaA * cxa;
+		w_vec3 iBcxa = invInertiaB * cxa;
+
+		w_mat2 invEffectiveRotationMass;
+		invEffectiveRotationMass.m00 = dot(bxa, iAbxa) + dot(bxa, iBbxa);
+		invEffectiveRotationMass.m01 = dot(bxa, iAcxa) + dot(bxa, iBcxa);
+		invEffectiveRotationMass.m10 = dot(cxa, iAbxa) + dot(cxa, iBbxa);
+		invEffectiveRotationMass.m11 = dot(cxa, iAcxa) + dot(cxa, iBcxa);
+
+		w_vec2 rotationBias = zero;
+		if (dt > DT_THRESHOLD)
+		{
+			rotationBias = w_vec2(dot(globalHingeAxisA, globalTangentB), dot(globalHingeAxisA, globalBitangentB)) * (w_float(HINGE_ROTATION_CONSTRAINT_BETA) * invDt);
+		}
+
+		rotationBias.x.store(batch.rotationBias[0]);
+		rotationBias.y.store(batch.rotationBias[1]);
+
+		invEffectiveRotationMass.m[0].store(batch.invEffectiveRotationMass[0]);
+		invEffectiveRotationMass.m[1].store(batch.invEffectiveRotationMass[1]);
+		invEffectiveRotationMass.m[2].store(batch.invEffectiveRotationMass[2]);
+		invEffectiveRotationMass.m[3].store(batch.invEffectiveRotationMass[3]);
+
+		bxa.x.store(batch.bxa[0]);
+		bxa.y.store(batch.bxa[1]);
+		bxa.z.store(batch.bxa[2]);
+
+		cxa.x.store(batch.cxa[0]);
+		cxa.y.store(batch.cxa[1]);
+		cxa.z.store(batch.cxa[2]);
+
+
+		// Limits and motor.
+		batch.solveLimit = false;
+		batch.solveMotor = false;
+
+		auto minLimitActive = minRotationLimit <= zero;
+		auto maxLimitActive = maxRotationLimit >= zero;
+		auto motorActive = maxMotorTorque > zero;
+		auto cond = minLimitActive | maxLimitActive | motorActive;
+
+		if (anyTrue(cond))
+		{
+			w_float motorVelocity;
+
+			w_vec3 localHingeTangentA;
+			w_vec3 localHingeBitangentA;
+			w_vec3 localHingeTangentB;
+
+			w_float dummy0, dummy1;
+
+			load8(&input->motorVelocity, constraintIndices, (uint32)sizeof(*input),
+				motorVelocity,
+				localHingeTangentA.x, localHingeTangentA.y, localHingeTangentA.z,
+				localHingeBitangentA.x, localHingeBitangentA.y, localHingeBitangentA.z,
+				localHingeTangentB.x);
+
+			load4(&input->localHingeTangentB.y, constraintIndices, (uint32)sizeof(*input),
+				localHingeTangentB.y, localHingeTangentB.z,
+				dummy0, dummy1);
+
+
+
+			w_vec3 localHingeCompareA = conjugate(rotationA) * (rotationB * localHingeTangentB);
+			w_float angle = atan2(dot(localHingeCompareA, localHingeBitangentA), dot(localHingeCompareA, localHingeTangentA));
+
+			auto minLimitViolated = minLimitActive & (angle <= minRotationLimit);
+			auto maxLimitViolated = maxLimitActive & (angle >= maxRotationLimit);
+
+			auto limitViolated = minLimitViolated | maxLimitViolated;
+
+			batch.solveLimit = anyTrue(limitViolated);
+			batch.solveMotor = anyTrue(motorActive);
+			if (batch.solveLimit || batch.solveMotor)
+			{
+				w_vec3 globalRotationAxis = globalHingeAxisA;
+
+				w_float invEffectiveAxialMass = dot(globalRotationAxis, invInertiaA * globalRotationAxis)
+											 + dot(globalRotationAxis, invInertiaB * globalRotationAxis);
+
+				w_float effectiveAxialMass = ifThen(invEffectiveAxialMass != zero, 1.f / invEffectiveAxialMass, zero);
+				w_float effectiveLimitAxialMass = ifThen(limitViolated, effectiveAxialMass, zero);
+				w_float effectiveMotorAxialMass = ifThen(motorActive, effectiveAxialMass, zero);
+
+				w_float limitSign = ifThen(minLimitViolated, 1.f, -1.f);
+
+				w_float maxMotorImpulse = maxMotorTorque * w_float(dt);
+				maxMotorImpulse = ifThen(motorActive, maxMotorImpulse, zero);
+
+				w_vec3 motorAndLimitImpulseToAngularVelocityA = invInertiaA * globalRotationAxis;
+				w_vec3 motorAndLimitImpulseToAngularVelocityB = invInertiaB * globalRotationAxis;
+
+				if (batch.solveMotor)
+				{
+					auto isVelocityMotor = motorType == constraint_velocity_motor;
+
+					if (anyFalse(isVelocityMotor))
+					{
+						// Inspired by Bullet Engine. We set the velocity such that the target angle is reached within one frame.
+						// This will later get clamped to the maximum motor impulse.
+
+						w_float motorTargetAngle = motorVelocity; // This is a union.
+
+						w_float minLimit = ifThen(minLimitActive, minRotationLimit, -M_PI);
+						w_float maxLimit = ifThen(maxLimitActive, maxRotationLimit, M_PI);
+						w_float targetAngle = clamp(motorTargetAngle, minLimit, maxLimit);
+
+						w_float motorVelocityOverride = (dt > DT_THRESHOLD) ? ((targetAngle - angle) * invDt) : zero;
+						motorVelocity = ifThen(isVelocityMotor, motorVelocity, motorVelocityOverride);
+					}
+				}
+
+				w_float limitBias = zero;
+				if (batch.solveLimit && dt > DT_THRESHOLD)
+				{
+					w_float d = ifThen(minLimitViolated, angle - minRotationLimit, maxRotationLimit - angle);
+					limitBias = d * w_float(HINGE_LIMIT_CONSTRAINT_BETA) * invDt;
+				}
+				
+				globalRotationAxis.x.store(batch.globalRotationAxis[0]);
+				globalRotationAxis.y.store(batch.globalRotationAxis[1]);
+				globalRotationAxis.z.store(batch.globalRotationAxis[2]);
+
+				effectiveLimitAxialMass.store(batch.effectiveLimitAxialMass);
+				effectiveMotorAxialMass.store(batch.effectiveMotorAxialMass);
+
+				zero.store(batch.limitImpulse);
+				limitBias.store(batch.limitBias);
+				limitSign.store(batch.limitSign);
+
+				zero.store(batch.motorImpulse);
+				maxMotorImpulse.store(batch.maxMotorImpulse);
+				motorVelocity.store(batch.motorVelocity);
+
+				motorAndLimitImpulseToAngularVelocityA.x.store(batch.motorAndLimitImpulseToAngularVelocityA[0]);
+				motorAndLimitImpulseToAngularVelocityA.y.store(batch.motorAndLimitImpulseToAngularVelocityA[1]);
+				motorAndLimitImpulseToAngularVelocityA.z.store(batch.motorAndLimitImpulseToAngularVelocityA[2]);
+
+				motorAndLimitImpulseToAngularVelocityB.x.store(batch.motorAndLimitImpulseToAngularVelocityB[0]);
+				motorAndLimitImpulseToAngularVelocityB.y.store(batch.motorAndLimitImpulseToAngularVelocityB[1]);
+				motorAndLimitImpulseToAngularVelocityB.z.store(batch.motorAndLimitImpulseToAngularVelocityB[2]);
+			}
+		}
+
+	}
+
+	simd_hinge_constraint_solver result;
+	result.batches = batches;
+	result.numBatches = numBatches;
+	return result;
+}
+
+static void solveHingeVelocityConstraintsSIMD(simd_hinge_constraint_solver constraints, rigid_body_global_state* rbs)
+{
+	CPU_PROFILE_BLOCK("Solve hinge constraints SIMD");
+
+	for (uint32 i = 0; i < constraints.numBatches; ++i)
+	{
+		simd_hinge_constraint_batch& batch = constraints.batches[i];
+
+
+		// Load body A.
+		w_vec3 vA, wA;
+		w_float invMassA;
+		w_mat3 invInertiaA;
+
+		load8(&rbs->invInertia.m00, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21,
+			invInertiaA.m02, invInertiaA.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+
+		// Load body B.
+		w_vec3 vB, wB;
+		w_float invMassB;
+		w_mat3 invInertiaB;
+
+		load8(&rbs->invInertia.m00, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21,
+			invInertiaB.m02, invInertiaB.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+
+
+		// Solve in order of importance (most important last): Motor -> Limits -> Rotation -> Position.
+
+		w_vec3 globalRotationAxis(batch.globalRotationAxis[0], batch.globalRotationAxis[1], batch.globalRotationAxis[2]);
+		w_vec3 motorAndLimitImpulseToAngularVelocityA(batch.motorAndLimitImpulseToAngularVelocityA[0], batch.motorAndLimitImpulseToAngularVelocityA[1], batch.motorAndLimitImpulseToAngularVelocityA[2]);
+		w_vec3 motorAndLimitImpulseToAngularVelocityB(batch.motorAndLimitImpulseToAngularVelocityB[0], batch.motorAndLimitImpulseToAngularVelocityB[1], batch.motorAndLimitImpulseToAngularVelocityB[2]);
+
+		// Motor.
+		if (batch.solveMotor)
+		{
+			w_float motorVelocity(batch.motorVelocity);
+			w_float effectiveMotorAxialMass(batch.effectiveMotorAxialMass);
+			w_float motorImpulse(batch.motorImpulse);
+			w_float maxMotorImpulse(batch.maxMotorImpulse);
+
+			w_float aDotWA = dot(globalRotationAxis, wA); // How fast are we turning about the axis.
+			w_float aDotWB = dot(globalRotationAxis, wB);
+
+			w_float relAngularVelocity = (aDotWB - aDotWA);
+			w_float motorCdot = relAngularVelocity - motorVelocity;
+
+			w_float motorLambda = -effectiveMotorAxialMass * motorCdot;
+			w_float oldImpulse = motorImpulse;
+			motorImpulse = clamp(motorImpulse + motorLambda, -maxMotorImpulse, maxMotorImpulse);
+			motorLambda = motorImpulse - oldImpulse;
+
+			wA -= motorAndLimitImpulseToAngularVelocityA * motorLambda;
+			wB += motorAndLimitImpulseToAngularVelocityB * motorLambda;
+
+			motorImpulse.store(batch.motorImpulse);
+		}
+
+		// Limits.
+		if (batch.solveLimit)
+		{
+			w_float limitSign(batch.limitSign);
+			w_float limitBias(batch.limitBias);
+			w_float limitImpulse(batch.limitImpulse);
+			w_float effectiveLimitAxialMass(batch.effectiveLimitAxialMass);
+
+			w_float aDotWA = dot(globalRotationAxis, wA); // How fast are we turning about the axis.
+			w_float aDotWB = dot(globalRotationAxis, wB);
+			w_float relAngularVelocity = limitSign * (aDotWB - aDotWA);
+
+			w_float limitCdot = relAngularVelocity + limitBias;
+			w_float limitLambda = -effectiveLimitAxialMass * limitCdot;
+
+			w_float impulse = maximum(limitImpulse + limitLambda, 0.f);
+			limitLambda = impulse - limitImpulse;
+			limitImpulse = impulse;
+
+			limitLambda *= limitSign;
+
+			wA -= motorAndLimitImpulseToAngularVelocityA * limitLambda;
+			wB += motorAndLimitImpulseToAngularVelocityB * limitLambda;
+
+			limitImpulse.store(batch.limitImpulse);
+		}
+
+		// Rotation part.
+		{
+			w_vec3 bxa(batch.bxa[0], batch.bxa[1], batch.bxa[2]);
+			w_vec3 cxa(batch.cxa[0], batch.cxa[1], batch.cxa[2]);
+			w_vec2 rotationBias(batch.rotationBias[0], batch.rotationBias[1]);
+			w_mat2 invEffectiveRotationMass;
+			invEffectiveRotationMass.m[0] = w_float(batch.invEffectiveRotationMass[0]);
+			invEffectiveRotationMass.m[1] = w_float(batch.invEffectiveRotationMass[1]);
+			invEffectiveRotationMass.m[2] = w_float(batch.invEffectiveRotationMass[2]);
+			invEffectiveRotationMass.m[3] = w_float(batch.invEffectiveRotationMass[3]);
+
+			w_vec3 deltaAngularVelocity = wB - wA;
+
+			w_vec2 rotationCdot(dot(bxa, deltaAngularVelocity), dot(cxa, deltaAngularVelocity));
+			w_vec2 rotLambda = solveLinearSystem(invEffectiveRotationMass, -(rotationCdot + rotationBias));
+
+			w_vec3 rotationP = bxa * rotLambda.x + cxa * rotLambda.y;
+
+			wA -= invInertiaA * rotationP;
+			wB += invInertiaB * rotationP;
+		}
+
+		// Position part.
+		{
+			w_vec3 relGlobalAnchorA(batch.relGlobalAnchorA[0], batch.relGlobalAnchorA[1], batch.relGlobalAnchorA[2]);
+			w_vec3 relGlobalAnchorB(batch.relGlobalAnchorB[0], batch.relGlobalAnchorB[1], batch.relGlobalAnchorB[2]);
+			w_vec3 translationBias(batch.translationBias[0], batch.translationBias[1], batch.translationBias[2]);
+
+			w_mat3 invEffectiveTranslationMass;
+			invEffectiveTranslationMass.m[0] = w_float(batch.invEffectiveTranslationMass[0]);
+			invEffectiveTranslationMass.m[1] = w_float(batch.invEffectiveTranslationMass[1]);
+			invEffectiveTranslationMass.m[2] = w_float(batch.invEffectiveTranslationMass[2]);
+			invEffectiveTranslationMass.m[3] = w_float(batch.invEffectiveTranslationMass[3]);
+			invEffectiveTranslationMass.m[4] = w_float(batch.invEffectiveTranslationMass[4]);
+			invEffectiveTranslationMass.m[5] = w_float(batch.invEffectiveTranslationMass[5]);
+			invEffectiveTranslationMass.m[6] = w_float(batch.invEffectiveTranslationMass[6]);
+			invEffectiveTranslationMass.m[7] = w_float(batch.invEffectiveTranslationMass[7]);
+			invEffectiveTranslationMass.m[8] = w_float(batch.invEffectiveTranslationMass[8]);
+
+			w_vec3 anchorVelocityA = vA + cross(wA, relGlobalAnchorA);
+			w_vec3 anchorVelocityB = vB + cross(wB, relGlobalAnchorB);
+			w_vec3 translationCdot = anchorVelocityB - anchorVelocityA + translationBias;
+
+			w_vec3 translationP = solveLinearSystem(invEffectiveTranslationMass, -translationCdot);
+
+			vA -= invMassA * translationP;
+			wA -= invInertiaA * cross(relGlobalAnchorA, translationP);
+			vB += invMassB * translationP;
+			wB += invInertiaB * cross(relGlobalAnchorB, translationP);
+		}
+
+
+		store8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+		store8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+	}
+}
+
+
+
+
+static simd_cone_twist_constraint_solver initializeConeTwistVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const cone_twist_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt)
+{
+	CPU_PROFILE_BLOCK("Initialize cone twist constraints SIMD");
+
+	simd_constraint_slot* contactSlots = arena.allocate<simd_constraint_slot>(count);
+	uint32 numBatches = scheduleConstraintsSIMD(arena, bodyPairs, count, INVALID_PHYSICS_INDEX, contactSlots);
+
+	simd_cone_twist_constraint_batch* batches = arena.allocate<simd_cone_twist_constraint_batch>(numBatches);
+
+	const w_float zero = w_float::zero();
+	const w_float invDt = 1.f / dt;
+	const w_float one = 1.f;
+
+	for (uint32 i = 0; i < numBatches; ++i)
+	{
+		const simd_constraint_slot& slot = contactSlots[i];
+		simd_cone_twist_constraint_batch& batch = batches[i];
+
+		physics_index constraintIndices[CONSTRAINT_SIMD_WIDTH];
+		for (uint32 j = 0; j < CONSTRAINT_SIMD_WIDTH; ++j)
+		{
+			constraintIndices[j] = (physics_index)slot.indices[j];
+			batch.rbAIndices[j] = bodyPairs[slot.indices[j]].rbA;
+			batch.rbBIndices[j] = bodyPairs[slot.indices[j]].rbB;
+		}
+
+
+		// Load body A.
+		w_vec3 localCOGPositionA;
+		w_quat rotationA;
+		w_vec3 positionA;
+		w_mat3 invInertiaA;
+		w_float invMassA;
+
+		load8(&rbs->rotation.x, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationA.x, rotationA.y, rotationA.z, rotationA.w,
+			localCOGPositionA.x, localCOGPositionA.y, localCOGPositionA.z,
+			positionA.x);
+
+		load8(&rbs->position.y, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			positionA.y, positionA.z,
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m02, invInertiaA.m12, invInertiaA.m22,
+			invMassA);
+
+
+		// Load body B.
+		w_quat rotationB;
+		w_vec3 positionB;
+		w_vec3 localCOGPositionB;
+		w_mat3 invInertiaB;
+		w_float invMassB;
+
+		load8(&rbs->rotation.x, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationB.x, rotationB.y, rotationB.z, rotationB.w,
+			localCOGPositionB.x, localCOGPositionB.y, localCOGPositionB.z,
+			positionB.x);
+
+		load8(&rbs->position.y, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			positionB.y, positionB.z,
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m02, invInertiaB.m12, invInertiaB.m22,
+			invMassB);
+
+
+
+
+
+
+		w_vec3 localAnchorA;
+		w_vec3 localAnchorB;
+
+		w_vec3 localLimitAxisA;
+		w_vec3 localLimitAxisB;
+
+		w_vec3 localLimitTangentA;
+		w_vec3 localLimitBitangentA;
+		w_vec3 localLimitTangentB;
+
+		w_float swingLimit;
+		w_float twistLimit;
+
+		w_float swingMotorTypeF;
+		w_float swingMotorVelocity;
+		w_float maxSwingMotorTorque;
+		w_float swingMotorAxis;
+
+		w_float twistMotorTypeF;
+		w_float twistMotorVelocity;
+		w_float maxTwistMotorTorque;
+
+		w_float dummy0, dummy1;
+
+
+		load8((float*)input, constraintIndices, (uint32)sizeof(*input),
+			localAnchorA.x, localAnchorA.y, localAnchorA.z, 
+			localAnchorB.x, localAnchorB.y, localAnchorB.z, 
+			localLimitAxisA.x, localLimitAxisA.y);
+
+		load8(&input->localLimitAxisA.z, constraintIndices, (uint32)sizeof(*input),
+			localLimitAxisA.z,
+			localLimitAxisB.x, localLimitAxisB.y, localLimitAxisB.z,
+			localLimitTangentA.x, localLimitTangentA.y, localLimitTangentA.z, 
+			localLimitBitangentA.x);
+
+		load8(&input->localLimitBitangentA.y, constraintIndices, (uint32)sizeof(*input),
+			localLimitBitangentA.y, localLimitBitangentA.z,
+			localLimitTangentB.x, localLimitTangentB.y, localLimitTangentB.z,
+			swingLimit, twistLimit, swingMotorTypeF);
+
+		load8(&input->swingMotorVelocity, constraintIndices, (uint32)sizeof(*input),
+			swingMotorVelocity, maxSwingMotorTorque, swingMotorAxis,
+			twistMotorTypeF, twistMotorVelocity, maxTwistMotorTorque,
+			dummy0, dummy1);
+
+
+		w_int swingMotorType = reinterpret(swingMotorTypeF);
+		w_int twistMotorType = reinterpret(twistMotorTypeF);
+
+
+
+
+
+
+		// Relative to COG.
+		w_vec3 relGlobalAnchorA = rotationA * (localAnchorA - localCOGPositionA);
+		w_vec3 relGlobalAnchorB = rotationB * (localAnchorB - localCOGPositionB);
+
+		// Global.
+		w_vec3 globalAnchorA = positionA + relGlobalAnchorA;
+		w_vec3 globalAnchorB = positionB + relGlobalAnchorB;
+
+		w_mat3 skewMatA = getSkewMatrix(relGlobalAnchorA);
+		w_mat3 skewMatB = getSkewMatrix(relGlobalAnchorB);
+
+		w_mat3 invEffectiveMass = skewMatA * invInertiaA * transpose(skewMatA)
+							   + skewMatB * invInertiaB * transpose(skewMatB);
+		w_float invMassSum = invMassA + invMassB;
+		invEffectiveMass.m00 += invMassSum;
+		invEffectiveMass.m11 += invMassSum;
+		invEffectiveMass.m22 += invMassSum;
+
+		w_vec3 bias = zero;
+		if (dt > DT_THRESHOLD)
+		{
+			bias = (globalAnchorB - globalAnchorA) * (w_float(BALL_CONSTRAINT_BETA) * invDt);
+		}
+
+		relGlobalAnchorA.x.store(batch.relGlobalAnchorA[0]);
+		relGlobalAnchorA.y.store(batch.relGlobalAnchorA[1]);
+		relGlobalAnchorA.z.store(batch.relGlobalAnchorA[2]);
+
+		relGlobalAnchorB.x.store(batch.relGlobalAnchorB[0]);
+		relGlobalAnchorB.y.store(batch.relGlobalAnchorB[1]);
+		relGlobalAnchorB.z.store(batch.relGlobalAnchorB[2]);
+
+		bias.x.store(batch.bias[0]);
+		bias.y.store(batch.bias[1]);
+		bias.z.store(batch.bias[2]);
+
+		invEffectiveMass.m[0].store(batch.invEffectiveMass[0]);
+		invEffectiveMass.m[1].store(batch.invEffectiveMass[1]);
+		invEffectiveMass.m[2].store(batch.invEffectiveMass[2]);
+		invEffectiveMass.m[3].store(batch.invEffectiveMass[3]);
+		invEffectiveMass.m[4].store(batch.invEffectiveMass[4]);
+		invEffectiveMass.m[5].store(batch.invEffectiveMass[5]);
+		invEffectiveMass.m[6].store(batch.invEffectiveMass[6]);
+		invEffectiveMass.m[7].store(batch.invEffectiveMass[7]);
+		invEffectiveMass.m[8].store(batch.invEffectiveMass[8]);
+
+
+		// Limits and motors.
+
+		w_quat btoa = conjugate(rotationA) * rotationB;
+
+		w_vec3 localLimitAxisCompareA = btoa * localLimitAxisB;
+
+		w_quat swingRotation = rotateFromTo(localLimitAxisA, localLimitAxisCompareA);
+
+		w_vec3 twistTangentA = swingRotation * localLimitTangentA;
+		w_vec3 twistBitangentA = swingRotation * localLimitBitangentA;
+		w_vec3 localLimitTangentCompareA = btoa * localLimitTangentB;
+		w_float twistAngle = atan2(dot(localLimitTangentCompareA, twistBitangentA), dot(localLimitTangentCompareA, twistTangentA));
+
+
+
+		// Swing limit.
+		w_vec3 swingAxis; w_float swingAngle;
+		getAxisRotation(swingRotation, swingAxis, swingAngle);
+		auto swingAngleNegative = swingAngle < zero;
+		swingAngle = ifThen(swingAngleNegative, -swingAngle, swingAngle);
+		swingAxis = ifThen(swingAngleNegative, -swingAxis, swingAxis);
+
+		auto solveSwingLimit = (swingLimit >= zero) & (swingAngle >= swingLimit);
+		batch.solveSwingLimit = anyTrue(solveSwingLimit);
+		if (batch.solveSwingLimit)
+		{
+			w_vec3 globalSwingAxis = rotationA * swingAxis;
+			w_float invEffectiveLimitMass = dot(globalSwingAxis, invInertiaA * globalSwingAxis)
+										 + dot(globalSwingAxis, invInertiaB * globalSwingAxis);
+			w_float effectiveSwingLimitMass = ifThen(invEffectiveLimitMass != zero, 1.f / invEffectiveLimitMass, zero);
+			effectiveSwingLimitMass = ifThen(solveSwingLimit, effectiveSwingLimitMass, zero); // Set to zero for constraints, which aren't at the limit.
+
+			w_float swingLimitBias = zero;
+			if (dt > DT_THRESHOLD)
+			{
+				swingLimitBias = (swingLimit - swingAngle) * (w_float(HINGE_LIMIT_CONSTRAINT_BETA) * invDt);
+			}
+
+			w_vec3 swingLimitImpulseToAngularVelocityA = invInertiaA * globalSwingAxis;
+			w_vec3 swingLimitImpulseToAngularVelocityB = invInertiaB * globalSwingAxis;
+
+			globalSwingAxis.x.store(batch.globalSwingAxis[0]);
+			globalSwingAxis.y.store(batch.globalSwingAxis[1]);
+			globalSwingAxis.z.store(batch.globalSwingAxis[2]);
+
+			zero.store(batch.swingImpulse);
+			effectiveSwingLimitMass.store(batch.effectiveSwingLimitMass);
+			swingLimitBias.store(batch.swingLimitBias);
+
+			swingLimitImpulseToAngularVelocityA.x.store(batch.swingLimitImpulseToAngularVelocityA[0]);
+			swingLimitImpulseToAngularVelocityA.y.store(batch.swingLimitImpulseToAngularVelocityA[1]);
+			swingLimitImpulseToAngularVelocityA.z.store(batch.swingLimitImpulseToAngularVelocityA[2]);
+
+			swingLimitImpulseToAngularVelocityB.x.store(batch.swingLimitImpulseToAngularVelocityB[0]);
+			swingLimitImpulseToAngularVelocityB.y.store(batch.swingLimitImpulseToAngularVelocityB[1]);
+			swingLimitImpulseToAngularVelocityB.z.store(batch.swingLimitImpulseToAngularVelocityB[2]);
+		}
+
+		// Swing motor.
+		auto solveSwingMotor = maxSwingMotorTorque > zero;
+		batch.solveSwingMotor = anyTrue(solveSwingMotor);
+		if (batch.solveSwingMotor)
+		{
+			w_float maxSwingMotorImpulse = maxSwingMotorTorque * w_float(dt);
+			maxSwingMotorTorque = ifThen(solveSwingMotor, maxSwingMotorTorque, zero);
+
+			w_float axisX = cos(swingMotorAxis), axisY = sin(swingMotorAxis);
+			w_vec3 localSwingMotorAxis = axisX * localLimitTangentA + axisY * localLimitBitangentA;
+
+			auto isVelocityMotor = swingMotorType == constraint_velocity_motor;
+			w_vec3 globalSwingMotorAxis = rotationA * localSwingMotorAxis;
+
+			if (anyFalse(isVelocityMotor)) // At least one position motor.
+			{
+				w_float targetAngle = swingMotorVelocity; // This is a union.
+				targetAngle = ifThen(swingLimit >= zero, clamp(targetAngle, -swingLimit, swingLimit), targetAngle);
+
+				w_vec3 localTargetDirection = w_quat(localSwingMotorAxis, targetAngle) * localLimitAxisA;
+				w_vec3 localSwingMotorAxis = noz(cross(localLimitAxisCompareA, localTargetDirection));
+				w_vec3 globalSwingMotorAxisOverride = rotationA * localSwingMotorAxis;
+
+				w_float cosAngle = dot(localTargetDirection, localLimitAxisCompareA);
+				w_float deltaAngle = acos(clamp01(cosAngle));
+				w_float swingMotorVelocityOverride = (dt > DT_THRESHOLD) ? (deltaAngle * invDt * w_float(0.2f)) : zero;
+
+				swingMotorVelocity = ifThen(isVelocityMotor, swingMotorVelocity, swingMotorVelocityOverride);
+				globalSwingMotorAxis = ifThen(isVelocityMotor, globalSwingMotorAxis, globalSwingMotorAxisOverride);
+			}
+
+			w_vec3 swingMotorImpulseToAngularVelocityA = invInertiaA * globalSwingMotorAxis;
+			w_vec3 swingMotorImpulseToAngularVelocityB = invInertiaB * globalSwingMotorAxis;
+
+			w_float invEffectiveMotorMass = dot(globalSwingMotorAxis, invInertiaA * globalSwingMotorAxis)
+										 + dot(globalSwingMotorAxis, invInertiaB * globalSwingMotorAxis);
+			w_float effectiveSwingMotorMass = ifThen(invEffectiveMotorMass != zero, 1.f / invEffectiveMotorMass, zero);
+			effectiveSwingMotorMass = ifThen(solveSwingMotor, effectiveSwingMotorMass, zero); // Set to zero for constraints, which have no motor.
+
+			
+			zero.store(batch.swingMotorImpulse);
+			maxSwingMotorImpulse.store(batch.maxSwingMotorImpulse);
+			swingMotorVelocity.store(batch.swingMotorVelocity);
+
+			globalSwingMotorAxis.x.store(batch.globalSwingMotorAxis[0]);
+			globalSwingMotorAxis.y.store(batch.globalSwingMotorAxis[1]);
+			globalSwingMotorAxis.z.store(batch.globalSwingMotorAxis[2]);
+
+			swingMotorImpulseToAngularVelocityA.x.store(batch.swingMotorImpulseToAngularVelocityA[0]);
+			swingMotorImpulseToAngularVelocityA.y.store(batch.swingMotorImpulseToAngularVelocityA[1]);
+			swingMotorImpulseToAngularVelocityA.z.store(batch.swingMotorImpulseToAngularVelocityA[2]);
+
+			swingMotorImpulseToAngularVelocityB.x.store(batch.swingMotorImpulseToAngularVelocityB[0]);
+			swingMotorImpulseToAngularVelocityB.y.store(batch.swingMotorImpulseToAngularVelocityB[1]);
+			swingMotorImpulseToAngularVelocityB.z.store(batch.swingMotorImpulseToAngularVelocityB[2]);
+
+			effectiveSwingMotorMass.store(batch.effectiveSwingMotorMass);
+		}
+
+		// Twist limit and motor.
+		auto mw_intistLimitViolated = (twistLimit >= zero) & (twistAngle <= -twistLimit);
+		auto maxTwistLimitViolated = (twistLimit >= zero) & (twistAngle >= twistLimit);
+
+		auto solveTwistLimit = mw_intistLimitViolated | maxTwistLimitViolated;
+		auto solveTwistMotor = maxTwistMotorTorque > zero;
+		batch.solveTwistLimit = anyTrue(solveTwistLimit);
+		batch.solveTwistMotor = anyTrue(solveTwistMotor);
+		if (batch.solveTwistLimit || batch.solveTwistMotor)
+		{
+			w_vec3 globalTwistAxis = rotationA * localLimitAxisA;
+			w_float invEffectiveMass = dot(globalTwistAxis, invInertiaA * globalTwistAxis)
+									+ dot(globalTwistAxis, invInertiaB * globalTwistAxis);
+			w_float effectiveTwistMass = ifThen(invEffectiveMass != zero, 1.f / invEffectiveMass, zero);
+
+			w_float effectiveTwistLimitMass = ifThen(solveTwistLimit, effectiveTwistMass, zero); // Set to zero for constraints, which aren't at the limit.
+			w_float effectiveTwistMotorMass = ifThen(solveTwistMotor, effectiveTwistMass, zero); // Set to zero for constraints, which have no motor.
+
+			w_float twistLimitSign = ifThen(mw_intistLimitViolated, 1.f, -1.f);
+
+			w_float maxTwistMotorImpulse = maxTwistMotorTorque * w_float(dt);
+			maxTwistMotorImpulse = ifThen(solveTwistMotor, maxTwistMotorImpulse, zero);
+
+			w_vec3 twistMotorAndLimitImpulseToAngularVelocityA = invInertiaA * globalTwistAxis;
+			w_vec3 twistMotorAndLimitImpulseToAngularVelocityB = invInertiaB * globalTwistAxis;
+
+			if (batch.solveTwistMotor)
+			{
+				auto isVelocityMotor = twistMotorType == constraint_velocity_motor;
+
+				if (anyFalse(isVelocityMotor)) // At least one position motor.
+				{
+					// Inspired by Bullet Engine. We set the velocity such that the target angle is reached within one frame.
+					// This will later get clamped to the maximum motor impulse.
+					w_float limit = ifThen(twistLimit >= zero, twistLimit, M_PI);
+					w_float twistMotorTargetAngle = twistMotorVelocity; // This is a union.
+					w_float targetAngle = clamp(twistMotorTargetAngle, -limit, limit);
+
+					w_float twistMotorVelocityOverride = (dt > DT_THRESHOLD) ? ((targetAngle - twistAngle) * invDt) : zero;
+					twistMotorVelocity = ifThen(isVelocityMotor, twistMotorVelocity, twistMotorVelocityOverride);
+				}
+			}
+
+			w_float twistLimitBias = zero;
+			if (batch.solveTwistLimit && dt > DT_THRESHOLD)
+			{
+				w_float d = ifThen(mw_intistLimitViolated, twistLimit + twistAngle, twistLimit - twistAngle);
+				twistLimitBias = d * (w_float(TWIST_LIMIT_CONSTRAINT_BETA) * invDt);
+			}
+
+			globalTwistAxis.x.store(batch.globalTwistAxis[0]);
+			globalTwistAxis.y.store(batch.globalTwistAxis[1]);
+			globalTwistAxis.z.store(batch.globalTwistAxis[2]);
+
+			zero.store(batch.twistImpulse);
+			twistLimitSign.store(batch.twistLimitSign);
+			effectiveTwistLimitMass.store(batch.effectiveTwistLimitMass);
+			effectiveTwistMotorMass.store(batch.effectiveTwistMotorMass);
+			twistLimitBias.store(batch.twistLimitBias);
+
+			maxTwistMotorImpulse.store(batch.maxTwistMotorImpulse);
+			zero.store(batch.twistMotorImpulse);
+			twistMotorVelocity.store(batch.twistMotorVelocity);
+
+			twistMotorAndLimitImpulseToAngularVelocityA.x.store(batch.twistMotorAndLimitImpulseToAngularVelocityA[0]);
+			twistMotorAndLimitImpulseToAngularVelocityA.y.store(batch.twistMotorAndLimitImpulseToAngularVelocityA[1]);
+			twistMotorAndLimitImpulseToAngularVelocityA.z.store(batch.twistMotorAndLimitImpulseToAngularVelocityA[2]);
+
+			twistMotorAndLimitImpulseToAngularVelocityB.x.store(batch.twistMotorAndLimitImpulseToAngularVelocityB[0]);
+			twistMotorAndLimitImpulseToAngularVelocityB.y.store(batch.twistMotorAndLimitImpulseToAngularVelocityB[1]);
+			twistMotorAndLimitImpulseToAngularVelocityB.z.store(batch.twistMotorAndLimitImpulseToAngularVelocityB[2]);
+		}
+
+	}
+
+	simd_cone_twist_constraint_solver result;
+	result.batches = batches;
+	result.numBatches = numBatches;
+	return result;
+}
+
+static void solveConeTwistVelocityConstraintsSIMD(simd_cone_twist_constraint_solver constraints, rigid_body_global_state* rbs)
+{
+	CPU_PROFILE_BLOCK("Solve cone twist constraints SIMD");
+
+	for (uint32 i = 0; i < constraints.numBatches; ++i)
+	{
+		simd_cone_twist_constraint_batch& batch = constraints.batches[i];
+
+
+		// Load body A.
+		w_vec3 vA, wA;
+		w_float invMassA;
+		w_mat3 invInertiaA;
+
+		load8(&rbs->invInertia.m00, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21,
+			invInertiaA.m02, invInertiaA.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+
+		// Load body B.
+		w_vec3 vB, wB;
+		w_float invMassB;
+		w_mat3 invInertiaB;
+
+		load8(&rbs->invInertia.m00, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21,
+			invInertiaB.m02, invInertiaB.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+
+
+		// Solve in order of importance (most important last): Motors -> Limits -> Position.
+
+		w_vec3 globalTwistAxis(batch.globalTwistAxis[0], batch.globalTwistAxis[1], batch.globalTwistAxis[2]);
+		w_vec3 twistMotorAndLimitImpulseToAngularVelocityA(batch.twistMotorAndLimitImpulseToAngularVelocityA[0], batch.twistMotorAndLimitImpulseToAngularVelocityA[1], batch.twistMotorAndLimitImpulseToAngularVelocityA[2]);
+		w_vec3 twistMotorAndLimitImpulseToAngularVelocityB(batch.twistMotorAndLimitImpulseToAngularVelocityB[0], batch.twistMotorAndLimitImpulseToAngularVelocityB[1], batch.twistMotorAndLimitImpulseToAngularVelocityB[2]);
+
+		// Motor.
+		if (batch.solveTwistMotor)
+		{
+			w_float twistMotorVelocity(batch.twistMotorVelocity);
+			w_float effectiveTwistMotorMass(batch.effectiveTwistMotorMass);
+			w_float twistMotorImpulse(batch.twistMotorImpulse);
+			w_float maxTwistMotorImpulse(batch.maxTwistMotorImpulse);
+
+			w_float aDotWA = dot(globalTwistAxis, wA);
+			w_float aDotWB = dot(globalTwistAxis, wB);
+			w_float relAngularVelocity = (aDotWB - aDotWA);
+
+			w_float motorCdot = relAngularVelocity - twistMotorVelocity;
+
+			w_float motorLambda = -effectiveTwistMotorMass * motorCdot;
+			w_float oldImpulse = twistMotorImpulse;
+			twistMotorImpulse = clamp(twistMotorImpulse + motorLambda, -maxTwistMotorImpulse, maxTwistMotorImpulse);
+			motorLambda = twistMotorImpulse - oldImpulse;
+
+			wA -= twistMotorAndLimitImpulseToAngularVelocityA * motorLambda;
+			wB += twistMotorAndLimitImpulseToAngularVelocityB * motorLambda;
+
+			twistMotorImpulse.store(batch.twistMotorImpulse);
+		}
+
+		if (batch.solveSwingMotor)
+		{
+			w_float swingMotorVelocity(batch.swingMotorVelocity);
+			w_float effectiveSwingMotorMass(batch.effectiveSwingMotorMass);
+			w_vec3 globalSwingMotorAxis(batch.globalSwingMotorAxis[0], batch.globalSwingMotorAxis[1], batch.globalSwingMotorAxis[2]);
+			w_float swingMotorImpulse(batch.swingMotorImpulse);
+			w_float maxSwingMotorImpulse(batch.maxSwingMotorImpulse);
+
+			w_vec3 swingMotorImpulseToAngularVelocityA(batch.swingMotorImpulseToAngularVelocityA[0], batch.swingMotorImpulseToAngularVelocityA[1], batch.swingMotorImpulseToAngularVelocityA[2]);
+			w_vec3 swingMotorImpulseToAngularVelocityB(batch.swingMotorImpulseToAngularVelocityB[0], batch.swingMotorImpulseToAngularVelocityB[1], batch.swingMotorImpulseToAngularVelocityB[2]);
+
+			w_float aDotWA = dot(globalSwingMotorAxis, wA);
+			w_float aDotWB = dot(globalSwingMotorAxis, wB);
+			w_float relAngularVelocity = (aDotWB - aDotWA);
+
+			w_float motorCdot = relAngularVelocity - swingMotorVelocity;
+
+			w_float motorLambda = -effectiveSwingMotorMass * motorCdot;
+			w_float oldImpulse = swingMotorImpulse;
+			swingMotorImpulse = clamp(swingMotorImpulse + motorLambda, -maxSwingMotorImpulse, maxSwingMotorImpulse);
+			motorLambda = swingMotorImpulse - oldImpulse;
+
+			wA -= swingMotorImpulseToAngularVelocityA * motorLambda;
+			wB += swingMotorImpulseToAngularVelocityB * motorLambda;
+
+			swingMotorImpulse.store(batch.swingMotorImpulse);
+		}
+
+		// Twist.
+		if (batch.solveTwistLimit)
+		{
+			w_float limitSign(batch.twistLimitSign);
+			w_float twistLimitBias(batch.twistLimitBias);
+			w_float effectiveTwistLimitMass(batch.effectiveTwistLimitMass);
+			w_float twistImpulse(batch.twistImpulse);
+
+			w_float aDotWA = dot(globalTwistAxis, wA);
+			w_float aDotWB = dot(globalTwistAxis, wB);
+			w_float relAngularVelocity = limitSign * (aDotWB - aDotWA);
+
+			w_float limitCdot = relAngularVelocity + twistLimitBias;
+			w_float limitLambda = -effectiveTwistLimitMass * limitCdot;
+
+			w_float impulse = maximum(twistImpulse + limitLambda, w_float::zero());
+			limitLambda = impulse - twistImpulse;
+			twistImpulse = impulse;
+
+			limitLambda *= limitSign;
+
+			wA -= twistMotorAndLimitImpulseToAngularVelocityA * limitLambda;
+			wB += twistMotorAndLimitImpulseToAngularVelocityB * limitLambda;
+
+			twistImpulse.store(batch.twistImpulse);
+		}
+
+		// Cone.
+		if (batch.solveSwingLimit)
+		{
+			w_vec3 globalSwingAxis(batch.globalSwingAxis[0], batch.globalSwingAxis[1], batch.globalSwingAxis[2]);
+			w_float swingLimitBias(batch.swingLimitBias);
+			w_float effectiveSwingLimitMass(batch.effectiveSwingLimitMass);
+			w_float swingImpulse(batch.swingImpulse);
+
+			w_vec3 swingLimitImpulseToAngularVelocityA(batch.swingLimitImpulseToAngularVelocityA[0], batch.swingLimitImpulseToAngularVelocityA[1], batch.swingLimitImpulseToAngularVelocityA[2]);
+			w_vec3 swingLimitImpulseToAngularVelocityB(batch.swingLimitImpulseToAngularVelocityB[0], batch.swingLimitImpulseToAngularVelocityB[1], batch.swingLimitImpulseToAngularVelocityB[2]);
+
+			w_float aDotWA = dot(globalSwingAxis, wA);
+			w_float aDotWB = dot(globalSwingAxis, wB);
+			w_float swingLimitCdot = aDotWA - aDotWB + swingLimitBias;
+			w_float limitLambda = -effectiveSwingLimitMass * swingLimitCdot;
+
+			w_float impulse = maximum(swingImpulse + limitLambda, w_float::zero());
+			limitLambda = impulse - swingImpulse;
+			swingImpulse = impulse;
+
+			wA += swingLimitImpulseToAngularVelocityA * limitLambda;
+			wB -= swingLimitImpulseToAngularVelocityB * limitLambda;
+
+			swingImpulse.store(batch.swingImpulse);
+		}
+
+
+		// Position part.
+		{
+			w_vec3 relGlobalAnchorA(batch.relGlobalAnchorA[0], batch.relGlobalAnchorA[1], batch.relGlobalAnchorA[2]);
+			w_vec3 relGlobalAnchorB(batch.relGlobalAnchorB[0], batch.relGlobalAnchorB[1], batch.relGlobalAnchorB[2]);
+			w_vec3 bias(batch.bias[0], batch.bias[1], batch.bias[2]);
+
+			w_mat3 invEffectiveMass;
+			invEffectiveMass.m[0] = w_float(batch.invEffectiveMass[0]);
+			invEffectiveMass.m[1] = w_float(batch.invEffectiveMass[1]);
+			invEffectiveMass.m[2] = w_float(batch.invEffectiveMass[2]);
+			invEffectiveMass.m[3] = w_float(batch.invEffectiveMass[3]);
+			invEffectiveMass.m[4] = w_float(batch.invEffectiveMass[4]);
+			invEffectiveMass.m[5] = w_float(batch.invEffectiveMass[5]);
+			invEffectiveMass.m[6] = w_float(batch.invEffectiveMass[6]);
+			invEffectiveMass.m[7] = w_float(batch.invEffectiveMass[7]);
+			invEffectiveMass.m[8] = w_float(batch.invEffectiveMass[8]);
+
+			w_vec3 anchorVelocityA = vA + cross(wA, relGlobalAnchorA);
+			w_vec3 anchorVelocityB = vB + cross(wB, relGlobalAnchorB);
+			w_vec3 translationCdot = anchorVelocityB - anchorVelocityA + bias;
+
+			w_vec3 translationP = solveLinearSystem(invEffectiveMass, -translationCdot);
+
+			vA -= invMassA * translationP;
+			wA -= invInertiaA * cross(relGlobalAnchorA, translationP);
+			vB += invMassB * translationP;
+			wB += invInertiaB * cross(relGlobalAnchorB, translationP);
+		}
+
+
+
+		store8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+		store8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+	}
+}
+
+
+
+static simd_slider_constraint_solver initializeSliderVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const slider_constraint* input, const constraint_body_pair* bodyPairs, uint32 count, float dt)
+{
+	CPU_PROFILE_BLOCK("Initialize slider constraints SIMD");
+
+	simd_constraint_slot* contactSlots = arena.allocate<simd_constraint_slot>(count);
+	uint32 numBatches = scheduleConstraintsSIMD(arena, bodyPairs, count, INVALID_PHYSICS_INDEX, contactSlots);
+
+	simd_slider_constraint_batch* batches = arena.allocate<simd_slider_constraint_batch>(numBatches);
+
+	const w_float zero = w_float::zero();
+	const w_float invDt = 1.f / dt;
+	const w_float one = 1.f;
+
+	for (uint32 i = 0; i < numBatches; ++i)
+	{
+		const simd_constraint_slot& slot = contactSlots[i];
+		simd_slider_constraint_batch& batch = batches[i];
+
+		physics_index constraintIndices[CONSTRAINT_SIMD_WIDTH];
+		for (uint32 j = 0; j < CONSTRAINT_SIMD_WIDTH; ++j)
+		{
+			constraintIndices[j] = (physics_index)slot.indices[j];
+			batch.rbAIndices[j] = bodyPairs[slot.indices[j]].rbA;
+			batch.rbBIndices[j] = bodyPairs[slot.indices[j]].rbB;
+		}
+
+
+		// Load body A.
+		w_vec3 localCOGPositionA;
+		w_quat rotationA;
+		w_vec3 positionA;
+		w_mat3 invInertiaA;
+		w_float invMassA;
+
+		load8(&rbs->rotation.x, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationA.x, rotationA.y, rotationA.z, rotationA.w,
+			localCOGPositionA.x, localCOGPositionA.y, localCOGPositionA.z,
+			positionA.x);
+
+		load8(&rbs->position.y, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			positionA.y, positionA.z,
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m02, invInertiaA.m12, invInertiaA.m22,
+			invMassA);
+
+
+		// Load body B.
+		w_quat rotationB;
+		w_vec3 positionB;
+		w_vec3 localCOGPositionB;
+		w_mat3 invInertiaB;
+		w_float invMassB;
+
+		load8(&rbs->rotation.x, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			rotationB.x, rotationB.y, rotationB.z, rotationB.w,
+			localCOGPositionB.x, localCOGPositionB.y, localCOGPositionB.z,
+			positionB.x);
+
+		load8(&rbs->position.y, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			positionB.y, positionB.z,
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21);
+
+		load4(&rbs->invInertia.m02, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m02, invInertiaB.m12, invInertiaB.m22,
+			invMassB);
+
+
+		w_quat initialInvRotationDifference;
+		w_vec3 localAnchorA;
+		w_vec3 localAnchorB;
+		w_vec3 localAxisA;
+
+		w_float negDistanceLimit;
+		w_float posDistanceLimit;
+		w_float maxMotorForce;
+
+		load8((float*)input, constraintIndices, (uint32)sizeof(*input),
+			initialInvRotationDifference.x, initialInvRotationDifference.y, initialInvRotationDifference.z, initialInvRotationDifference.w,
+			localAnchorA.x, localAnchorA.y, localAnchorA.z,
+			localAnchorB.x);
+
+		load8(&input->localAnchorB.y, constraintIndices, (uint32)sizeof(*input),
+			localAnchorB.y, localAnchorB.z,
+			localAxisA.x, localAxisA.y, localAxisA.z,
+			negDistanceLimit, posDistanceLimit, 
+			maxMotorForce);
+
+
+
+		// Relative to COG.
+		w_vec3 relGlobalAnchorA = rotationA * (localAnchorA - localCOGPositionA);
+		w_vec3 relGlobalAnchorB = rotationB * (localAnchorB - localCOGPositionB);
+
+		// Global.
+		w_vec3 globalAnchorA = positionA + relGlobalAnchorA;
+		w_vec3 globalAnchorB = positionB + relGlobalAnchorB;
+
+		w_vec3 globalSliderAxis = rotationA * localAxisA;
+
+		w_vec3 tangent, bitangent;
+		getTangents(globalSliderAxis, tangent, bitangent);
+		w_vec3 u = globalAnchorB - globalAnchorA;
+
+		w_vec3 rAu = relGlobalAnchorA + u;
+		w_vec3 rBxt = cross(relGlobalAnchorB, tangent);
+		w_vec3 rBxb = cross(relGlobalAnchorB, bitangent);
+		w_vec3 rAuxt = cross(rAu, tangent);
+		w_vec3 rAuxb = cross(rAu, bitangent);
+
+		w_vec3 iArAuxt = invInertiaA * rAuxt;
+		w_vec3 iArAuxb = invInertiaA * rAuxb;
+		w_vec3 iBrBxt = invInertiaB * rBxt;
+		w_vec3 iBrBxb = invInertiaB * rBxb;
+		w_float invMassSum = invMassA + invMassB;
+
+		w_mat2 invEffectiveTranslationMass;
+		invEffectiveTranslationMass.m00 = dot(rAuxt, iArAuxt) + dot(rBxt, iBrBxt) + invMassSum;
+		invEffectiveTranslationMass.m01 = dot(rAuxt, iArAuxb) + dot(rBxt, iBrBxb);
+		invEffectiveTranslationMass.m10 = dot(rAuxb, iArAuxt) + dot(rBxb, iBrBxt);
+		invEffectiveTranslationMass.m11 = dot(rAuxb, iArAuxb) + dot(rBxb, iBrBxb) + invMassSum;
+
+		w_mat3 invEffectiveRotationMass = invInertiaA + invInertiaB;
+		w_vec2 translationBias = zero;
+		w_vec3 rotationBias = zero;
+
+		if (dt > DT_THRESHOLD)
+		{
+			w_float a = dot(u, tangent);
+			w_float b = dot(u, bitangent);
+			translationBias = w_vec2(a, b) * (SLIDER_CONSTRAINT_BETA * invDt);
+
+			w_quat rotationError = rotationB * initialInvRotationDifference * conjugate(rotationA);
+			rotationBias = rotationError.v * (SLIDER_CONSTRAINT_BETA * 2.f * invDt);
+		}
+
+		rAuxt.x.store(batch.rAuxt[0]);
+		rAuxt.y.store(batch.rAuxt[1]);
+		rAuxt.z.store(batch.rAuxt[2]);
+
+		rAuxb.x.store(batch.rAuxb[0]);
+		rAuxb.y.store(batch.rAuxb[1]);
+		rAuxb.z.store(batch.rAuxb[2]);
+
+		rBxt.x.store(batch.rBxt[0]);
+		rBxt.y.store(batch.rBxt[1]);
+		rBxt.z.store(batch.rBxt[2]);
+
+		rBxb.x.store(batch.rBxb[0]);
+		rBxb.y.store(batch.rBxb[1]);
+		rBxb.z.store(batch.rBxb[2]);
+
+		tangent.x.store(batch.tangent[0]);
+		tangent.y.store(batch.tangent[1]);
+		tangent.z.store(batch.tangent[2]);
+
+		bitangent.x.store(batch.bitangent[0]);
+		bitangent.y.store(batch.bitangent[1]);
+		bitangent.z.store(batch.bitangent[2]);
+
+		invEffectiveTranslationMass.m[0].store(batch.invEffectiveTranslationMass[0]);
+		invEffectiveTranslationMass.m[1].store(batch.invEffectiveTranslationMass[1]);
+		invEffectiveTranslationMass.m[2].store(batch.invEffectiveTranslationMass[2]);
+		invEffectiveTranslationMass.m[3].store(batch.invEffectiveTranslationMass[3]);
+
+		translationBias.x.store(batch.translationBias[0]);
+		translationBias.y.store(batch.translationBias[1]);
+
+		invEffectiveRotationMass.m[0].store(batch.invEffectiveRotationMass[0]);
+		invEffectiveRotationMass.m[1].store(batch.invEffectiveRotationMass[1]);
+		invEffectiveRotationMass.m[2].store(batch.invEffectiveRotationMass[2]);
+		invEffectiveRotationMass.m[3].store(batch.invEffectiveRotationMass[3]);
+		invEffectiveRotationMass.m[4].store(batch.invEffectiveRotationMass[4]);
+		invEffectiveRotationMass.m[5].store(batch.invEffectiveRotationMass[5]);
+		invEffectiveRotationMass.m[6].store(batch.invEffectiveRotationMass[6]);
+		invEffectiveRotationMass.m[7].store(batch.invEffectiveRotationMass[7]);
+		invEffectiveRotationMass.m[8].store(batch.invEffectiveRotationMass[8]);
+
+		rotationBias.x.store(batch.rotationBias[0]);
+		rotationBias.y.store(batch.rotationBias[1]);
+		rotationBias.z.store(batch.rotationBias[2]);
+
+		globalSliderAxis.x.store(batch.globalSliderAxis[0]);
+		globalSliderAxis.y.store(batch.globalSliderAxis[1]);
+		globalSliderAxis.z.store(batch.globalSliderAxis[2]);
+
+
+		w_float distanceAlongSlider = dot(u, globalSliderAxis);
+
+
+		auto minLimitActive = negDistanceLimit <= zero;
+		auto maxLimitActive = posDistanceLimit >= zero;
+
+		if (anyTrue(minLimitActive | maxLimitActive))
+		{
+			auto minLimitViolated = minLimitActive & (distanceAlongSlider < negDistanceLimit);
+			auto maxLimitViolated = maxLimitActive & (distanceAlongSlider > posDistanceLimit);
+
+			auto limitViolated = minLimitViolated | maxLimitViolated;
+			batch.solveLimit = anyTrue(limitViolated);
+
+			if (batch.solveLimit)
+			{
+				w_vec3 rAuxs = cross(rAu, globalSliderAxis);
+				w_vec3 rBxs = cross(relGlobalAnchorB, globalSliderAxis);
+				w_float invEffectiveAxialMass = invMassSum + dot(rAuxs, invInertiaA * rAuxs) + dot(rBxs, invInertiaB * rBxs);
+				w_float effectiveAxialMass = ifThen(invEffectiveAxialMass != zero, one / invEffectiveAxialMass, zero);
+				effectiveAxialMass = ifThen(limitViolated, effectiveAxialMass, zero);
+				w_float limitSign = ifThen(minLimitViolated, one, -one);
+
+				w_float limitBias = zero;
+				if (dt > DT_THRESHOLD)
+				{
+					w_float error = ifThen(minLimitViolated, distanceAlongSlider - negDistanceLimit, posDistanceLimit - distanceAlongSlider);
+					limitBias = error * (SLIDER_LIMIT_CONSTRAINT_BETA * invDt);
+				}
+
+				w_vec3 limitImpulseToAngularVelocityA = invInertiaA * rAuxs;
+				w_vec3 limitImpulseToAngularVelocityB = invInertiaB * rBxs;
+
+				rAuxs.x.store(batch.rAuxs[0]);
+				rAuxs.y.store(batch.rAuxs[1]);
+				rAuxs.z.store(batch.rAuxs[2]);
+
+				rBxs.x.store(batch.rBxs[0]);
+				rBxs.y.store(batch.rBxs[1]);
+				rBxs.z.store(batch.rBxs[2]);
+
+				zero.store(batch.limitImpulse);
+				effectiveAxialMass.store(batch.effectiveAxialMass);
+				limitSign.store(batch.limitSign);
+				limitBias.store(batch.limitBias);
+
+				limitImpulseToAngularVelocityA.x.store(batch.limitImpulseToAngularVelocityA[0]);
+				limitImpulseToAngularVelocityA.y.store(batch.limitImpulseToAngularVelocityA[1]);
+				limitImpulseToAngularVelocityA.z.store(batch.limitImpulseToAngularVelocityA[2]);
+
+				limitImpulseToAngularVelocityB.x.store(batch.limitImpulseToAngularVelocityB[0]);
+				limitImpulseToAngularVelocityB.y.store(batch.limitImpulseToAngularVelocityB[1]);
+				limitImpulseToAngularVelocityB.z.store(batch.limitImpulseToAngularVelocityB[2]);
+			}
+
+		}
+
+
+
+
+		auto motorActive = maxMotorForce > zero;
+		batch.solveMotor = anyTrue(motorActive);
+		if (batch.solveMotor)
+		{
+			w_float motorTypeF;
+			w_float motorVelocity;
+			w_float dummy0, dummy1;
+
+			load4((float*)&input->motorType, constraintIndices, (uint32)sizeof(*input),
+				motorTypeF, motorVelocity,
+				dummy0, dummy1);
+
+			w_int motorType = reinterpret(motorTypeF);
+
+			w_float maxMotorImpulse = maxMotorForce * dt;
+			maxMotorImpulse = ifThen(motorActive, maxMotorImpulse, zero);
+
+			auto isVelocityMotor = motorType == constraint_velocity_motor;
+
+			if (anyFalse(isVelocityMotor))
+			{
+				// Inspired by Bullet Engine. We set the velocity such that the target angle is reached within one frame.
+				// This will later get clamped to the maximum motor impulse.
+
+				w_float motorTargetDistance = motorVelocity; // This is a union.
+
+				w_float minLimit = ifThen(negDistanceLimit <= zero, negDistanceLimit, -INFINITY);
+				w_float maxLimit = ifThen(posDistanceLimit >= zero, posDistanceLimit, INFINITY);
+				w_float targetDistance = clamp(motorTargetDistance, minLimit, maxLimit);
+				w_float motorVelocityOverride = (dt > DT_THRESHOLD) ? ((targetDistance - distanceAlongSlider) * invDt) : 0.f;
+				motorVelocity = ifThen(isVelocityMotor, motorVelocity, motorVelocityOverride);
+			}
+
+			w_float effectiveMotorMass = one / invMassSum;
+			effectiveMotorMass = ifThen(motorActive, effectiveMotorMass, zero);
+
+			zero.store(batch.motorImpulse);
+			maxMotorImpulse.store(batch.maxMotorImpulse);
+			motorVelocity.store(batch.motorVelocity);
+			effectiveMotorMass.store(batch.effectiveMotorMass);
+		}
+
+	}
+
+	simd_slider_constraint_solver result;
+	result.batches = batches;
+	result.numBatches = numBatches;
+	return result;
+}
+
+static void solveSliderVelocityConstraintsSIMD(simd_slider_constraint_solver constraints, rigid_body_global_state* rbs)
+{
+	CPU_PROFILE_BLOCK("Solve slider constraints SIMD");
+
+	for (uint32 i = 0; i < constraints.numBatches; ++i)
+	{
+		simd_slider_constraint_batch& batch = constraints.batches[i];
+
+
+		// Load body A.
+		w_vec3 vA, wA;
+		w_float invMassA;
+		w_mat3 invInertiaA;
+
+		load8(&rbs->invInertia.m00, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20,
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21,
+			invInertiaA.m02, invInertiaA.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+
+		// Load body B.
+		w_vec3 vB, wB;
+		w_float invMassB;
+		w_mat3 invInertiaB;
+
+		load8(&rbs->invInertia.m00, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21,
+			invInertiaB.m02, invInertiaB.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+
+
+		w_vec3 globalSliderAxis(batch.globalSliderAxis[0], batch.globalSliderAxis[1], batch.globalSliderAxis[2]);
+
+		// Motor.
+		if (batch.solveMotor)
+		{
+			w_float motorVelocity(batch.motorVelocity);
+			w_float motorImpulse(batch.motorImpulse);
+			w_float maxMotorImpulse(batch.maxMotorImpulse);
+			w_float effectiveMotorMass(batch.effectiveMotorMass);
+
+			w_float Cdot = dot(vB, globalSliderAxis) - dot(vA, globalSliderAxis) - motorVelocity;
+
+			w_float motorLambda = -effectiveMotorMass * Cdot;
+			w_float oldImpulse = motorImpulse;
+			motorImpulse = clamp(motorImpulse + motorLambda, -maxMotorImpulse, maxMotorImpulse);
+			motorLambda = motorImpulse - oldImpulse;
+
+			w_vec3 P = motorLambda * globalSliderAxis;
+
+			vA -= invMassA * P;
+			vB += invMassB * P;
+
+			motorImpulse.store(batch.motorImpulse);
+		}
+
+		// Limit.
+		if (batch.solveLimit)
+		{
+			w_float limitSign(batch.limitSign);
+			w_float limitBias(batch.limitBias);
+			w_float effectiveAxialMass(batch.effectiveAxialMass);
+			w_float limitImpulse(batch.limitImpulse);
+
+			w_vec3 rAuxs(batch.rAuxs[0], batch.rAuxs[1], batch.rAuxs[2]);
+			w_vec3 rBxs(batch.rBxs[0], batch.rBxs[1], batch.rBxs[2]);
+
+			w_vec3 limitImpulseToAngularVelocityA(batch.limitImpulseToAngularVelocityA[0], batch.limitImpulseToAngularVelocityA[1], batch.limitImpulseToAngularVelocityA[2]);
+			w_vec3 limitImpulseToAngularVelocityB(batch.limitImpulseToAngularVelocityB[0], batch.limitImpulseToAngularVelocityB[1], batch.limitImpulseToAngularVelocityB[2]);
+
+			w_float Cdot = dot(vB, globalSliderAxis) + dot(wB, rBxs) - dot(vA, globalSliderAxis) - dot(wA, rAuxs);
+			w_float limitLambda = -effectiveAxialMass * (limitSign * Cdot + limitBias);
+
+			w_float impulse = maximum(limitImpulse + limitLambda, 0.f);
+			limitLambda = impulse - limitImpulse;
+			limitImpulse = impulse;
+
+			limitLambda *= limitSign;
+
+			w_vec3 P = limitLambda * globalSliderAxis;
+
+			vA -= invMassA * P;
+			wA -= limitImpulseToAngularVelocityA * limitLambda;
+			vB += invMassB * P;
+			wB += limitImpulseToAngularVelocityB * limitLambda;
+
+			limitImpulse.store(batch.limitImpulse);
+		}
+
+
+		// Rotation part.
+		{
+			w_mat3 invEffectiveRotationMass;
+			invEffectiveRotationMass.m[0] = w_float(batch.invEffectiveRotationMass[0]);
+			invEffectiveRotationMass.m[1] = w_float(batch.invEffectiveRotationMass[1]);
+			invEffectiveRotationMass.m[2] = w_float(batch.invEffectiveRotationMass[2]);
+			invEffectiveRotationMass.m[3] = w_float(batch.invEffectiveRotationMass[3]);
+			invEffectiveRotationMass.m[4] = w_float(batch.invEffectiveRotationMass[4]);
+			invEffectiveRotationMass.m[5] = w_float(batch.invEffectiveRotationMass[5]);
+			invEffectiveRotationMass.m[6] = w_float(batch.invEffectiveRotationMass[6]);
+			invEffectiveRotationMass.m[7] = w_float(batch.invEffectiveRotationMass[7]);
+			invEffectiveRotationMass.m[8] = w_float(batch.invEffectiveRotationMass[8]);
+
+			w_vec3 rotationBias(batch.rotationBias[0], batch.rotationBias[1], batch.rotationBias[2]);
+
+			w_vec3 Cdot = wB - wA;
+
+			w_vec3 rotationLambda = solveLinearSystem(invEffectiveRotationMass, -(Cdot + rotationBias));
+			wA -= invInertiaA * rotationLambda;
+			wB += invInertiaB * rotationLambda;
+		}
+
+		// Position part.
+		{
+			w_vec3 tangent(batch.tangent[0], batch.tangent[1], batch.tangent[2]);
+			w_vec3 bitangent(batch.bitangent[0], batch.bitangent[1], batch.bitangent[2]);
+			w_vec3 rAuxt(batch.rAuxt[0], batch.rAuxt[1], batch.rAuxt[2]);
+			w_vec3 rAuxb(batch.rAuxb[0], batch.rAuxb[1], batch.rAuxb[2]);
+			w_vec3 rBxt(batch.rBxt[0], batch.rBxt[1], batch.rBxt[2]);
+			w_vec3 rBxb(batch.rBxb[0], batch.rBxb[1], batch.rBxb[2]);
+
+			w_mat2 invEffectiveTranslationMass;
+			invEffectiveTranslationMass.m[0] = w_float(batch.invEffectiveTranslationMass[0]);
+			invEffectiveTranslationMass.m[1] = w_float(batch.invEffectiveTranslationMass[1]);
+			invEffectiveTranslationMass.m[2] = w_float(batch.invEffectiveTranslationMass[2]);
+			invEffectiveTranslationMass.m[3] = w_float(batch.invEffectiveTranslationMass[3]);
+
+			w_vec2 translationBias(batch.translationBias[0], batch.translationBias[1]);
+
+			w_vec2 Cdot;
+			Cdot.x = dot(tangent, vB) + dot(rBxt, wB) - dot(tangent, vA) - dot(rAuxt, wA);
+			Cdot.y = dot(bitangent, vB) + dot(rBxb, wB) - dot(bitangent, vA) - dot(rAuxb, wA);
+
+			w_vec2 translationLambda = solveLinearSystem(invEffectiveTranslationMass, -(Cdot + translationBias));
+
+			w_vec3 tb = tangent * translationLambda.x + bitangent * translationLambda.y;
+
+			vA -= invMassA * tb;
+			wA -= invInertiaA * (rAuxt * translationLambda.x + rAuxb * translationLambda.y);
+			vB += invMassB * tb;
+			wB += invInertiaB * (rBxt * translationLambda.x + rBxb * translationLambda.y);
+		}
+
+
+		store8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+		store8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+	}
+}
+
+
+static simd_collision_constraint_solver initializeCollisionVelocityConstraintsSIMD(memory_arena& arena, const rigid_body_global_state* rbs, const collision_contact* contacts, const contact_impulse* warmStartImpulses, const constraint_body_pair* bodyPairs, uint32 numContacts, physics_index dummyRigidBodyIndex, float dt)
+{
+	CPU_PROFILE_BLOCK("Initialize collision constraints SIMD");
+
+	simd_constraint_slot* contactSlots = arena.allocate<simd_constraint_slot>(numContacts);
+	uint32 numBatches = scheduleConstraintsSIMD(arena, bodyPairs, numContacts, dummyRigidBodyIndex, contactSlots);
+
+	simd_collision_constraint_batch* batches = arena.allocate<simd_collision_constraint_batch>(numBatches);
+
+	const w_float zero = w_float::zero();
+	const w_float slop = -0.001f;
+	const w_float scale = 0.1f;
+	const w_float invDt = 1.f / dt;
+
+	for (uint32 i = 0; i < numBatches; ++i)
+	{
+		const simd_constraint_slot& slot = contactSlots[i];
+		simd_collision_constraint_batch& batch = batches[i];
+
+		uint32* contactIndices = batch.contactIndices;
+		for (uint32 j = 0; j < CONSTRAINT_SIMD_WIDTH; ++j)
+		{
+			contactIndices[j] = slot.indices[j];
+			batch.rbAIndices[j] = bodyPairs[slot.indices[j]].rbA;
+			batch.rbBIndices[j] = bodyPairs[slot.indices[j]].rbB;
+		}
+
+		w_vec3 point, normal;
+		w_float penetrationDepth, friction_restitutionF;
+		load8((float*)contacts, contactIndices, (uint32)sizeof(collision_contact),
+			point.x, point.y, point.z, penetrationDepth, normal.x, normal.y, normal.z, friction_restitutionF);
+		w_int friction_restitution = reinterpret(friction_restitutionF);
+
+		w_float friction = convert(friction_restitution >> 16) / w_float(0xFFFF);
+		w_float restitution = convert(friction_restitution & 0xFFFF) / w_float(0xFFFF);
+
+
+		// Load body A.
+		w_vec3 vA, wA;
+		w_mat3 invInertiaA;
+		w_float invMassA;
+		w_vec3 positionA;
+		w_float unused;
+
+		load8(&rbs->invInertia.m00, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m00, invInertiaA.m10, invInertiaA.m20, 
+			invInertiaA.m01, invInertiaA.m11, invInertiaA.m21, 
+			invInertiaA.m02, invInertiaA.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaA.m22, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+		load4(&rbs->position.x, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			positionA.x, positionA.y, positionA.z, unused);
+
+
+		// Load body B.
+		w_vec3 vB, wB;
+		w_mat3 invInertiaB;
+		w_float invMassB;
+		w_vec3 positionB;
+
+		load8(&rbs->invInertia.m00, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m00, invInertiaB.m10, invInertiaB.m20,
+			invInertiaB.m01, invInertiaB.m11, invInertiaB.m21,
+			invInertiaB.m02, invInertiaB.m12);
+
+		load8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			invInertiaB.m22, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+
+		load4(&rbs->position.x, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			positionB.x, positionB.y, positionB.z, unused);
+
+
+
+
+
+		w_vec3 relGlobalAnchorA = point - positionA;
+		w_vec3 relGlobalAnchorB = point - positionB;
+
+		w_vec3 anchorVelocityA = vA + cross(wA, relGlobalAnchorA);
+		w_vec3 anchorVelocityB = vB + cross(wB, relGlobalAnchorB);
+
+		w_vec3 relVelocity = anchorVelocityB - anchorVelocityA;
+		w_vec3 tangent = relVelocity - dot(normal, relVelocity) * normal;
+		tangent = noz(tangent);
+
+		relGlobalAnchorA.x.store(batch.relGlobalAnchorA[0]);
+		relGlobalAnchorA.y.store(batch.relGlobalAnchorA[1]);
+		relGlobalAnchorA.z.store(batch.relGlobalAnchorA[2]);
+
+		relGlobalAnchorB.x.store(batch.relGlobalAnchorB[0]);
+		relGlobalAnchorB.y.store(batch.relGlobalAnchorB[1]);
+		relGlobalAnchorB.z.store(batch.relGlobalAnchorB[2]);
+
+		normal.x.store(batch.normal[0]);
+		normal.y.store(batch.normal[1]);
+		normal.z.store(batch.normal[2]);
+
+		tangent.x.store(batch.tangent[0]);
+		tangent.y.store(batch.tangent[1]);
+		tangent.z.store(batch.tangent[2]);
+
+		w_float impulseInNormalDir = zero;
+		w_float impulseInTangentDir = zero;
+
+		if (warmStartImpulses)
+		{
+			// The tangent may have changed since the last frame, so only the part of the friction impulse along the new tangent is kept.
+			w_vec3 warmStartTangentImpulse;
+			w_float warmStartNormalImpulse;
+			load4(&warmStartImpulses->tangentImpulse.x, contactIndices, (uint32)sizeof(contact_impulse),
+				warmStartTangentImpulse.x, warmStartTangentImpulse.y, warmStartTangentImpulse.z, warmStartNormalImpulse);
+
+			w_float maxFriction = friction * warmStartNormalImpulse;
+			impulseInNormalDir = warmStartNormalImpulse;
+			impulseInTangentDir = clamp(dot(warmStartTangentImpulse, tangent), -maxFriction, maxFriction);
+		}
+
+		impulseInNormalDir.store(batch.impulseInNormalDir);
+		impulseInTangentDir.store(batch.impulseInTangentDir);
+		friction.store(batch.friction);
+
+
+
+		{ // Tangent direction.
+			w_vec3 crAt = cross(relGlobalAnchorA, tangent);
+			w_vec3 crBt = cross(relGlobalAnchorB, tangent);
+			w_float invMassInTangentDir = invMassA + dot(crAt, invInertiaA * crAt)
+				+ invMassB + dot(crBt, invInertiaB * crBt);
+			w_float effectiveMassInTangentDir = ifThen(invMassInTangentDir != zero, 1.f / invMassInTangentDir, zero);
+			effectiveMassInTangentDir.store(batch.effectiveMassInTangentDir);
+
+			w_vec3 tangentImpulseToAngularVelocityA = invInertiaA * crAt;
+			tangentImpulseToAngularVelocityA.x.store(batch.tangentImpulseToAngularVelocityA[0]);
+			tangentImpulseToAngularVelocityA.y.store(batch.tangentImpulseToAngularVelocityA[1]);
+			tangentImpulseToAngularVelocityA.z.store(batch.tangentImpulseToAngularVelocityA[2]);
+
+			w_vec3 tangentImpulseToAngularVelocityB = invInertiaB * crBt;
+			tangentImpulseToAngularVelocityB.x.store(batch.tangentImpulseToAngularVelocityB[0]);
+			tangentImpulseToAngularVelocityB.y.store(batch.tangentImpulseToAngularVelocityB[1]);
+			tangentImpulseToAngularVelocityB.z.store(batch.tangentImpulseToAngularVelocityB[2]);
+		}
+
+
+		{ // Normal direction.
+			w_vec3 crAn = cross(relGlobalAnchorA, normal);
+			w_vec3 crBn = cross(relGlobalAnchorB, normal);
+			w_float invMassInNormalDir = invMassA + dot(crAn, invInertiaA * crAn)
+				+ invMassB + dot(crBn, invInertiaB * crBn);
+			w_float effectiveMassInNormalDir = ifThen(invMassInNormalDir != zero, 1.f / invMassInNormalDir, zero);
+
+			w_float bias = zero;
+
+			if (dt > DT_THRESHOLD)
+			{
+				w_float vRel = dot(normal, relVelocity);
+
+				w_float bounceBias = -restitution * vRel - scale * (-penetrationDepth - slop) * invDt;
+				bias = ifThen((-penetrationDepth < slop) & (vRel < zero), bounceBias, bias);
+
+				// Speculative contacts. The bodies may approach until they touch at the end of the frame.
+				bias = ifThen(penetrationDepth < zero, penetrationDepth * invDt, bias);
+			}
+
+			effectiveMassInNormalDir.store(batch.effectiveMassInNormalDir);
+			bias.store(batch.bias);
+
+			w_vec3 normalImpulseToAngularVelocityA = invInertiaA * crAn;
+			normalImpulseToAngularVelocityA.x.store(batch.normalImpulseToAngularVelocityA[0]);
+			normalImpulseToAngularVelocityA.y.store(batch.normalImpulseToAngularVelocityA[1]);
+			normalImpulseToAngularVelocityA.z.store(batch.normalImpulseToAngularVelocityA[2]);
+
+			w_vec3 normalImpulseToAngularVelocityB = invInertiaB * crBn;
+			normalImpulseToAngularVelocityB.x.store(batch.normalImpulseToAngularVelocityB[0]);
+			normalImpulseToAngularVelocityB.y.store(batch.normalImpulseToAngularVelocityB[1]);
+			normalImpulseToAngularVelocityB.z.store(batch.normalImpulseToAngularVelocityB[2]);
+		}
+	}
+
+	simd_collision_constraint_solver result;
+	result.batches = batches;
+	result.numBatches = numBatches;
+	return result;
+}
+
+static void warmStartCollisionVelocityConstraintsSIMD(simd_collision_constraint_solver constraints, rigid_body_global_state* rbs)
+{
+	CPU_PROFILE_BLOCK("Warm start collision constraints SIMD");
+
+	for (uint32 i = 0; i < constraints.numBatches; ++i)
+	{
+		const simd_collision_constraint_batch& batch = constraints.batches[i];
+
+		// Load body A.
+		w_vec3 vA, wA;
+		w_float invMassA;
+		w_float dummyA;
+
+		load8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyA, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+
+		// Load body B.
+		w_vec3 vB, wB;
+		w_float invMassB;
+		w_float dummyB;
+
+		load8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyB, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+
+
+		// Load constraint.
+		w_vec3 normal(batch.normal[0], batch.normal[1], batch.normal[2]);
+		w_vec3 tangent(batch.tangent[0], batch.tangent[1], batch.tangent[2]);
+		w_float impulseInNormalDir(batch.impulseInNormalDir);
+		w_float impulseInTangentDir(batch.impulseInTangentDir);
+
+		w_vec3 tangentImpulseToAngularVelocityA(batch.tangentImpulseToAngularVelocityA[0], batch.tangentImpulseToAngularVelocityA[1], batch.tangentImpulseToAngularVelocityA[2]);
+		w_vec3 tangentImpulseToAngularVelocityB(batch.tangentImpulseToAngularVelocityB[0], batch.tangentImpulseToAngularVelocityB[1], batch.tangentImpulseToAngularVelocityB[2]);
+		w_vec3 normalImpulseToAngularVelocityA(batch.normalImpulseToAngularVelocityA[0], batch.normalImpulseToAngularVelocityA[1], batch.normalImpulseToAngularVelocityA[2]);
+		w_vec3 normalImpulseToAngularVelocityB(batch.normalImpulseToAngularVelocityB[0], batch.normalImpulseToAngularVelocityB[1], batch.normalImpulseToAngularVelocityB[2]);
+
+		w_vec3 P = impulseInNormalDir * normal + impulseInTangentDir * tangent;
+		vA -= invMassA * P;
+		wA -= normalImpulseToAngularVelocityA * impulseInNormalDir + tangentImpulseToAngularVelocityA * impulseInTangentDir;
+		vB += invMassB * P;
+		wB += normalImpulseToAngularVelocityB * impulseInNormalDir + tangentImpulseToAngularVelocityB * impulseInTangentDir;
+
+		store8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyA, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+		store8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyB, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+	}
+}
+
+static void solveCollisionVelocityConstraintsSIMD(simd_collision_constraint_solver constraints, rigid_body_global_state* rbs)
+{
+	CPU_PROFILE_BLOCK("Solve collision constraints SIMD");
+
+	for (uint32 i = 0; i < constraints.numBatches; ++i)
+	{
+		simd_collision_constraint_batch& batch = constraints.batches[i];
+
+		// Load body A.
+		w_vec3 vA, wA;
+		w_float invMassA;
+		w_float dummyA;
+
+		load8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyA, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+
+		// Load body B.
+		w_vec3 vB, wB;
+		w_float invMassB;
+		w_float dummyB;
+
+		load8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyB, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+
+
+		// Load constraint.
+		w_vec3 relGlobalAnchorA(batch.relGlobalAnchorA[0], batch.relGlobalAnchorA[1], batch.relGlobalAnchorA[2]);
+		w_vec3 relGlobalAnchorB(batch.relGlobalAnchorB[0], batch.relGlobalAnchorB[1], batch.relGlobalAnchorB[2]);
+		w_vec3 normal(batch.normal[0], batch.normal[1], batch.normal[2]);
+		w_vec3 tangent(batch.tangent[0], batch.tangent[1], batch.tangent[2]);
+		w_float effectiveMassInNormalDir(batch.effectiveMassInNormalDir);
+		w_float effectiveMassInTangentDir(batch.effectiveMassInTangentDir);
+		w_float friction(batch.friction);
+		w_float impulseInNormalDir(batch.impulseInNormalDir);
+		w_float impulseInTangentDir(batch.impulseInTangentDir);
+		w_float bias(batch.bias);
+
+		w_vec3 tangentImpulseToAngularVelocityA(batch.tangentImpulseToAngularVelocityA[0], batch.tangentImpulseToAngularVelocityA[1], batch.tangentImpulseToAngularVelocityA[2]);
+		w_vec3 tangentImpulseToAngularVelocityB(batch.tangentImpulseToAngularVelocityB[0], batch.tangentImpulseToAngularVelocityB[1], batch.tangentImpulseToAngularVelocityB[2]);
+
+		{ // Tangent dir.
+			w_vec3 anchorVelocityA = vA + cross(wA, relGlobalAnchorA);
+			w_vec3 anchorVelocityB = vB + cross(wB, relGlobalAnchorB);
+
+			w_vec3 relVelocity = anchorVelocityB - anchorVelocityA;
+			w_float vt = dot(relVelocity, tangent);
+			w_float lambda = -effectiveMassInTangentDir * vt;
+
+			w_float maxFriction = friction * impulseInNormalDir;
+			w_float newImpulse = clamp(impulseInTangentDir + lambda, -maxFriction, maxFriction);
+			lambda = newImpulse - impulseInTangentDir;
+			impulseInTangentDir = newImpulse;
+
+			w_vec3 P = lambda * tangent;
+			vA -= invMassA * P;
+			wA -= tangentImpulseToAngularVelocityA * lambda;
+			vB += invMassB * P;
+			wB += tangentImpulseToAngularVelocityB * lambda;
+		}
+
+		w_vec3 normalImpulseToAngularVelocityA(batch.normalImpulseToAngularVelocityA[0], batch.normalImpulseToAngularVelocityA[1], batch.normalImpulseToAngularVelocityA[2]);
+		w_vec3 normalImpulseToAngularVelocityB(batch.normalImpulseToAngularVelocityB[0], batch.normalImpulseToAngularVelocityB[1], batch.normalImpulseToAngularVelocityB[2]);
+
+		{ // Normal dir.
+			w_vec3 anchorVelocityA = vA + cross(wA, relGlobalAnchorA);
+			w_vec3 anchorVelocityB = vB + cross(wB, relGlobalAnchorB);
+
+			w_vec3 relVelocity = anchorVelocityB - anchorVelocityA;
+			w_float vn = dot(relVelocity, normal);
+			w_float lambda = -effectiveMassInNormalDir * (vn - bias);
+			w_float impulse = maximum(impulseInNormalDir + lambda, w_float::zero());
+			lambda = impulse - impulseInNormalDir;
+			impulseInNormalDir = impulse;
+
+			w_vec3 P = lambda * normal;
+			vA -= invMassA * P;
+			wA -= normalImpulseToAngularVelocityA * lambda;
+			vB += invMassB * P;
+			wB += normalImpulseToAngularVelocityB * lambda;
+		}
+
+		impulseInNormalDir.store(batch.impulseInNormalDir);
+		impulseInTangentDir.store(batch.impulseInTangentDir);
+
+		store8(&rbs->invInertia.m22, batch.rbAIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyA, invMassA, vA.x, vA.y, vA.z, wA.x, wA.y, wA.z);
+
+		store8(&rbs->invInertia.m22, batch.rbBIndices, (uint32)sizeof(rigid_body_global_state),
+			dummyB, invMassB, vB.x, vB.y, vB.z, wB.x, wB.y, wB.z);
+	}
+}
+
+static void getCollisionImpulsesSIMD(simd_collision_constraint_solver constraints, contact_impulse* outImpulses)
+{
+	for (uint32 i = 0; i < constraints.numBatches; ++i)
+	{
+		const simd_collision_constraint_batch& batch = constraints.batches[i];
+
+		// Unused lanes are filled with copies of the first lane, so writing them is harmless.
+		for (uint32 j = 0; j < CONSTRAINT_SIMD_WIDTH; ++j)
+		{
+			contact_impulse& impulse = outImpulses[batch.contactIndices[j]];
+			impulse.tangentImpulse = batch.impulseInTangentDir[j] * vec3(batch.tangent[0][j], batch.tangent[1][j], batch.tangent[2][j]);
+			impulse.normalImpulse = batch.impulseInNormalDir[j];
+		}
+	}
+}
+
+struct simd_constraint_solvers
+{
+	simd_distance_constraint_solver distance;
+	simd_ball_constraint_solver ball;
+	simd_fixed_constraint_solver fixed;
+	simd_hinge_constraint_solver hinge;
+	simd_cone_twist_constraint_solver coneTwist;
+	simd_slider_constraint_solver slider;
+	simd_collision_constraint_solver collision;
+};
+
+void* initializeConstraintsSIMD(memory_arena& arena, rigid_body_global_state* rbs,
+	distance_constraint* distanceConstraints, constraint_body_pair* distanceConstraintBodyPairs, uint32 numDistanceConstraints,
+	ball_constraint* ballConstraints, constraint_body_pair* ballConstraintBodyPairs, uint32 numBallConstraints,
+	fixed_constraint* fixedConstraints, constraint_body_pair* fixedConstraintBodyPairs, uint32 numFixedConstraints,
+	hinge_constraint* hingeConstraints, constraint_body_pair* hingeConstraintBodyPairs, uint32 numHingeConstraints,
+	cone_twist_constraint* coneTwistConstraints, constraint_body_pair* coneTwistConstraintBodyPairs, uint32 numConeTwistConstraints,
+	slider_constraint* sliderConstraints, constraint_body_pair* sliderConstraintBodyPairs, uint32 numSliderConstraints,
+	collision_contact* contacts, constraint_body_pair* collisionBodyPairs, uint32 numContacts,
+	const contact_impulse* contactWarmStartImpulses,
+	uint32 dummyRigidBodyIndex, float dt)
+{
+	simd_constraint_solvers* solvers = arena.allocate<simd_constraint_solvers>(1);
+
+	solvers->distance = initializeDistanceVelocityConstraintsSIMD(arena, rbs, distanceConstraints, distanceConstraintBodyPairs, numDistanceConstraints, dt);
+	solvers->ball = initializeBallVelocityConstraintsSIMD(arena, rbs, ballConstraints, ballConstraintBodyPairs, numBallConstraints, dt);
+	solvers->fixed = initializeFixedVelocityConstraintsSIMD(arena, rbs, fixedConstraints, fixedConstraintBodyPairs, numFixedConstraints, dt);
+	solvers->hinge = initializeHingeVelocityConstraintsSIMD(arena, rbs, hingeConstraints, hingeConstraintBodyPairs, numHingeConstraints, dt);
+	solvers->coneTwist = initializeConeTwistVelocityConstraintsSIMD(arena, rbs, coneTwistConstraints, coneTwistConstraintBodyPairs, numConeTwistConstraints, dt);
+	solvers->slider = initializeSliderVelocityConstraintsSIMD(arena, rbs, sliderConstraints, sliderConstraintBodyPairs, numSliderConstraints, dt);
+	solvers->collision = initializeCollisionVelocityConstraintsSIMD(arena, rbs, contacts, contactWarmStartImpulses, collisionBodyPairs, numContacts, dummyRigidBodyIndex, dt);
+
+	if (contactWarmStartImpulses)
+	{
+		warmStartCollisionVelocityConstraintsSIMD(solvers->collision, rbs);
+	}
+
+	return solvers;
+}
+
+void solveConstraintsOneIterationSIMD(void* solvers, rigid_body_global_state* rbs)
+{
+	simd_constraint_solvers& s = *(simd_constraint_solvers*)solvers;
+
+	solveDistanceVelocityConstraintsSIMD(s.distance, rbs);
+	solveBallVelocityConstraintsSIMD(s.ball, rbs);
+	solveFixedVelocityConstraintsSIMD(s.fixed, rbs);
+	solveHingeVelocityConstraintsSIMD(s.hinge, rbs);
+	solveConeTwistVelocityConstraintsSIMD(s.coneTwist, rbs);
+	solveSliderVelocityConstraintsSIMD(s.slider, rbs);
+	solveCollisionVelocityConstraintsSIMD(s.collision, rbs);
+}
+
+void getContactImpulsesSIMD(void* solvers, contact_impulse* outImpulses)
+{
+	simd_constraint_solvers& s = *(simd_constraint_solvers*)solvers;
+	getCollisionImpulsesSIMD(s.collision, outImpulses);
+}
+
+}
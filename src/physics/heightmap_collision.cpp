@@ -77,7 +77,7 @@ static uint32 collideSphereVsTriangle(vec3 center, float radius, vec3 a, vec3 b,
 	return 0;
 }
 
-static uint32 collideAABBvsTriangle(vec3 center, vec3 radius, vec3 a, vec3 b, vec3 c, collision_contact* outContacts)
+uint32 collideAABBvsTriangle(vec3 center, vec3 radius, vec3 a, vec3 b, vec3 c, collision_contact* outContacts)
 {
 	a -= center;
 	b -= center;
@@ -420,13 +420,18 @@ static uint32 collideAABBvsTriangle(vec3 center, vec3 radius, vec3 a, vec3 b, ve
 }
 
 static uint32 intersection(const bounding_sphere& s, const bounding_box& aabb, const heightmap_collider_component& heightmap, memory_arena& arena,
-	collision_contact* outContacts)
+	collision_contact* outContacts, uint32* outFeatures, uint32 maxNumContacts)
 {
 	uint32 numContacts = 0;
 
-	heightmap.iterateTrianglesInVolume(aabb, arena, [s, outContacts, &numContacts](vec3 a, vec3 b, vec3 c)
+	heightmap.iterateTrianglesInVolume(aabb, arena, [s, outContacts, outFeatures, maxNumContacts, &numContacts](vec3 a, vec3 b, vec3 c, uint32 triangleIndex)
 	{
-		numContacts += collideSphereVsTriangle(s.center, s.radius, a, b, c, outContacts + numContacts);
+		if (numContacts == maxNumContacts) { return; }
+
+		if (collideSphereVsTriangle(s.center, s.radius, a, b, c, outContacts + numContacts))
+		{
+			outFeatures[numContacts++] = triangleIndex;
+		}
 	});
 
 	// TODO: De-duplicate contacts (for if we hit triangle edges or vertices).
@@ -435,14 +440,16 @@ static uint32 intersection(const bounding_sphere& s, const bounding_box& aabb, c
 }
 
 static uint32 intersection(const bounding_capsule& capsule, const bounding_box& aabb, const heightmap_collider_component& heightmap, memory_arena& arena,
-	collision_contact* outContacts)
+	collision_contact* outContacts, uint32* outFeatures, uint32 maxNumContacts)
 {
 	uint32 numContacts = 0;
 
 	ray r = { capsule.positionA, normalize(capsule.positionB - capsule.positionA) };
 
-	heightmap.iterateTrianglesInVolume(aabb, arena, [r, capsule, outContacts, &numContacts](vec3 a, vec3 b, vec3 c)
+	heightmap.iterateTrianglesInVolume(aabb, arena, [r, capsule, outContacts, outFeatures, maxNumContacts, &numContacts](vec3 a, vec3 b, vec3 c, uint32 triangleIndex)
 	{
+		if (numContacts == maxNumContacts) { return; }
+
 		vec3 triNormal = normalize(cross(b - a, c - a));
 		float d = -dot(triNormal, a);
 
@@ -455,7 +462,10 @@ static uint32 intersection(const bounding_capsule& capsule, const bounding_box&
 
 		vec3 reference = closestPoint_PointSegment(closest, { capsule.positionA, capsule.positionB });
 
-		numContacts += collideSphereVsTriangle(reference, capsule.radius, a, b, c, outContacts + numContacts);
+		if (collideSphereVsTriangle(reference, capsule.radius, a, b, c, outContacts + numContacts))
+		{
+			outFeatures[numContacts++] = triangleIndex;
+		}
 	});
 
 	// TODO: De-duplicate contacts (for if we hit triangle edges or vertices).
@@ -464,16 +474,21 @@ static uint32 intersection(const bounding_capsule& capsule, const bounding_box&
 }
 
 static uint32 intersection(const bounding_box& box, const bounding_box& aabb, const heightmap_collider_component& heightmap, memory_arena& arena,
-	collision_contact* outContacts)
+	collision_contact* outContacts, uint32* outFeatures, uint32 maxNumContacts)
 {
 	uint32 numContacts = 0;
 
 	vec3 center = box.getCenter();
 	vec3 radius = box.getRadius();
 
-	heightmap.iterateTrianglesInVolume(aabb, arena, [center, radius, outContacts, &numContacts](vec3 a, vec3 b, vec3 c)
+	heightmap.iterateTrianglesInVolume(aabb, arena, [center, radius, outContacts, outFeatures, maxNumContacts, &numContacts](vec3 a, vec3 b, vec3 c, uint32 triangleIndex)
 	{
-		numContacts += collideAABBvsTriangle(center, radius, a, b, c, outContacts + numContacts);
+		if (numContacts == maxNumContacts) { return; }
+
+		if (collideAABBvsTriangle(center, radius, a, b, c, outContacts + numContacts))
+		{
+			outFeatures[numContacts++] = triangleIndex;
+		}
 	});
 
 	// TODO: De-duplicate contacts (for if we hit triangle edges or vertices).
@@ -482,17 +497,22 @@ static uint32 intersection(const bounding_box& box, const bounding_box& aabb, co
 }
 
 static uint32 intersection(const bounding_oriented_box& obb, const bounding_box& aabb, const heightmap_collider_component& heightmap, memory_arena& arena,
-	collision_contact* outContacts)
+	collision_contact* outContacts, uint32* outFeatures, uint32 maxNumContacts)
 {
 	uint32 numContacts = 0;
 
-	heightmap.iterateTrianglesInVolume(aabb, arena, [obb, outContacts, &numContacts](vec3 a, vec3 b, vec3 c)
+	heightmap.iterateTrianglesInVolume(aabb, arena, [obb, outContacts, outFeatures, maxNumContacts, &numContacts](vec3 a, vec3 b, vec3 c, uint32 triangleIndex)
 	{
+		if (numContacts == maxNumContacts) { return; }
+
 		a = conjugate(obb.rotation) * (a - obb.center);
 		b = conjugate(obb.rotation) * (b - obb.center);
 		c = conjugate(obb.rotation) * (c - obb.center);
 
-		numContacts += collideAABBvsTriangle(vec3(0.f, 0.f, 0.f), obb.radius, a, b, c, outContacts + numContacts);
+		if (collideAABBvsTriangle(vec3(0.f, 0.f, 0.f), obb.radius, a, b, c, outContacts + numContacts))
+		{
+			outFeatures[numContacts++] = triangleIndex;
+		}
 	});
 
 	// TODO: De-duplicate contacts (for if we hit triangle edges or vertices).
@@ -506,15 +526,18 @@ static uint32 intersection(const bounding_oriented_box& obb, const bounding_box&
 	return numContacts;
 }
 
-narrowphase_result heightmapCollision(const heightmap_collider_component& heightmap, 
+void heightmapCollision(const heightmap_collider_component& heightmap, entity_handle heightmapEntity,
 	const collider_union* worldSpaceColliders, const bounding_box* worldSpaceAABBs, uint32 numColliders, 
-	collision_contact* outContacts, constraint_body_pair* outBodyPairs, collider_pair* outColliderPairs, uint8* outContactCountPerCollision, 
-	memory_arena& arena, uint16 dummyRigidBodyIndex)
+	collision_output_buffers& out,
+	memory_arena& arena, physics_index dummyRigidBodyIndex, const bool* rbAwake)
 {
 	CPU_PROFILE_BLOCK("Heightmap collisions");
 
-	uint32 totalNumContacts = 0;
-	uint32 totalNumCollisions = 0;
+	collision_contact colliderContacts[HEIGHTMAP_MAX_CONTACTS_PER_COLLIDER];
+	uint32 colliderFeatures[HEIGHTMAP_MAX_CONTACTS_PER_COLLIDER];
+
+	// One slot is reserved for the contact at the lowest point of the collider.
+	const uint32 maxNumTriangleContacts = HEIGHTMAP_MAX_CONTACTS_PER_COLLIDER - 1;
 
 	for (uint32 i = 0; i < numColliders; ++i)
 	{
@@ -525,37 +548,39 @@ narrowphase_result heightmapCollision(const heightmap_collider_component& height
 			continue;
 		}
 
+		if (rbAwake && !rbAwake[collider.objectIndex])
+		{
+			continue;
+		}
+
 
 		bounding_box aabb = worldSpaceAABBs[i];
 		aabb.maxCorner.y += 10.f;
 
 		uint32 numContacts = 0;
 
-		collision_contact* contactPtr = outContacts + totalNumContacts;
-
-
 		vec3 lowestPoint;
 
 		switch (collider.type)
 		{
 			case collider_type_sphere:
 			{
-				numContacts = intersection(collider.sphere, aabb, heightmap, arena, contactPtr);
+				numContacts = intersection(collider.sphere, aabb, heightmap, arena, colliderContacts, colliderFeatures, maxNumTriangleContacts);
 				lowestPoint = sphere_support_fn{ collider.sphere }(vec3(0.f, -1.f, 0.f));
 			} break;
 			case collider_type_capsule:
 			{
-				numContacts = intersection(collider.capsule, aabb, heightmap, arena, contactPtr);
+				numContacts = intersection(collider.capsule, aabb, heightmap, arena, colliderContacts, colliderFeatures, maxNumTriangleContacts);
 				lowestPoint = capsule_support_fn{ collider.capsule }(vec3(0.f, -1.f, 0.f));
 			} break;
 			case collider_type_aabb:
 			{
-				numContacts = intersection(collider.aabb, aabb, heightmap, arena, contactPtr);
+				numContacts = intersection(collider.aabb, aabb, heightmap, arena, colliderContacts, colliderFeatures, maxNumTriangleContacts);
 				lowestPoint = aabb_support_fn{ collider.aabb }(vec3(0.f, -1.f, 0.f));
 			} break;
 			case collider_type_obb:
 			{
-				numContacts = intersection(collider.obb, aabb, heightmap, arena, contactPtr);
+				numContacts = intersection(collider.obb, aabb, heightmap, arena, colliderContacts, colliderFeatures, maxNumTriangleContacts);
 				lowestPoint = obb_support_fn{ collider.obb }(vec3(0.f, -1.f, 0.f));
 			} break;
 		}
@@ -563,7 +588,8 @@ narrowphase_result heightmapCollision(const heightmap_collider_component& height
 		float heightAtLowestPoint = heightmap.getHeightAt(vec2(lowestPoint.x, lowestPoint.z));
 		if (lowestPoint.y < heightAtLowestPoint)
 		{
-			collision_contact& contact = contactPtr[numContacts++];
+			colliderFeatures[numContacts] = HEIGHTMAP_LOWEST_POINT_FEATURE;
+			collision_contact& contact = colliderContacts[numContacts++];
 			contact.normal = vec3(0.f, -1.f, 0.f);
 			contact.point = lowestPoint;
 			contact.penetrationDepth = heightAtLowestPoint - lowestPoint.y;
@@ -572,8 +598,6 @@ narrowphase_result heightmapCollision(const heightmap_collider_component& height
 
 		if (numContacts > 0)
 		{
-			constraint_body_pair* bodyPairPtr = outBodyPairs + totalNumContacts;
-
 			float friction = clamp01(sqrt(collider.material.friction * heightmap.material.friction));
 			float restitution = clamp01(max(collider.material.restitution, heightmap.material.restitution));
 
@@ -581,25 +605,28 @@ narrowphase_result heightmapCollision(const heightmap_collider_component& height
 
 			for (uint32 j = 0; j < numContacts; ++j)
 			{
-				contactPtr[j].friction_restitution = friction_restitution;
-				bodyPairPtr[j] = { collider.objectIndex, dummyRigidBodyIndex };
+				colliderContacts[j].friction_restitution = friction_restitution;
+				out.contacts.push_back(colliderContacts[j]);
+				out.bodyPairs.push_back({ collider.objectIndex, dummyRigidBodyIndex });
+				out.contactFeatures.push_back(colliderFeatures[j]);
 			}
 
-			ASSERT(numContacts < 256);
-			outContactCountPerCollision[totalNumCollisions] = (uint8)numContacts;
-			outColliderPairs[totalNumCollisions++] = { (uint16)i, UINT16_MAX };
+			ASSERT(numContacts <= HEIGHTMAP_MAX_CONTACTS_PER_COLLIDER);
+			out.contactCountPerCollision.push_back((uint8)numContacts);
+			out.colliderPairs.push_back({ (physics_index)i, INVALID_PHYSICS_INDEX });
+			out.otherEntities.push_back(heightmapEntity);
 		}
 
 #if 0
 		for (uint32 j = 0; j < numContacts; ++j)
 		{
-			float px = contactPtr[j].point.x;
-			float py = contactPtr[j].point.y;
-			float pz = contactPtr[j].point.z;
-			float nx = contactPtr[j].normal.x;
-			float ny = contactPtr[j].normal.y;
-			float nz = contactPtr[j].normal.z;
-			float pen = contactPtr[j].penetrationDepth;
+			float px = colliderContacts[j].point.x;
+			float py = colliderContacts[j].point.y;
+			float pz = colliderContacts[j].point.z;
+			float nx = colliderContacts[j].normal.x;
+			float ny = colliderContacts[j].normal.y;
+			float nz = colliderContacts[j].normal.z;
+			float pen = colliderContacts[j].penetrationDepth;
 
 			if (isnan(px)) { __debugbreak(); }
 			if (isnan(py)) { __debugbreak(); }
@@ -611,8 +638,5 @@ narrowphase_result heightmapCollision(const heightmap_collider_component& height
 		}
 #endif
 
-		totalNumContacts += numContacts;
 	}
-
-	return narrowphase_result{ totalNumCollisions, totalNumContacts, 0 };
 }
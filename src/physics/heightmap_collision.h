@@ -5,9 +5,20 @@
 #include "terrain/heightmap_collider.h"
 
 
-narrowphase_result heightmapCollision(const heightmap_collider_component& heightmap, 
+// Each collider generates at most this many contacts with a heightmap.
+#define HEIGHTMAP_MAX_CONTACTS_PER_COLLIDER 255
+
+// The contact features are the triangle indices (see heightmap_collider_component::iterateTrianglesInVolume), or this for the contact at the
+// lowest point of the collider.
+#define HEIGHTMAP_LOWEST_POINT_FEATURE 0xFFFFFFFF
+
+// Appends the collisions to out. The collider pairs have INVALID_PHYSICS_INDEX as the second collider.
+void heightmapCollision(const heightmap_collider_component& heightmap, entity_handle heightmapEntity,
 	const collider_union* worldSpaceColliders, const bounding_box* worldSpaceAABBs, uint32 numColliders,
-	collision_contact* outContacts, constraint_body_pair* outBodyPairs, // result.numContacts many.
-	collider_pair* outColliderPairs, uint8* outContactCountPerCollision, // result.numCollisions many.
-	memory_arena& arena, uint16 dummyRigidBodyIndex);
+	collision_output_buffers& out,
+	memory_arena& arena, physics_index dummyRigidBodyIndex,
+	const bool* rbAwake = 0); // If set, colliders of sleeping rigid bodies are skipped.
 
+// Box centered at center with the given half extents. Writes at most one contact with the normal pointing from the box to the triangle. Also
+// used by the mesh collider.
+uint32 collideAABBvsTriangle(vec3 center, vec3 radius, vec3 a, vec3 b, vec3 c, collision_contact* outContacts);
@@ -0,0 +1,709 @@
+#include "pch.h"
+#include "hull_builder.h"
+#include "core/cpu_profiling.h"
+
+#include <unordered_map>
+
+struct quickhull_face
+{
+	uint32 v[3];
+	uint32 neighbors[3]; // Face across the edge from v[i] to v[(i + 1) % 3].
+
+	vec3 normal;
+	float d;
+
+	std::vector<uint32> outsidePoints;
+	uint32 furthestPoint;
+	float furthestDistance;
+
+	uint32 mark; // Iteration in which the face was last classified.
+	bool visible;
+	bool alive;
+};
+
+struct quickhull_horizon_edge
+{
+	uint32 from, to;
+	uint32 outsideFace;
+};
+
+static uint32 addQuickhullFace(std::vector<quickhull_face>& faces, const vec3* points, uint32 a, uint32 b, uint32 c)
+{
+	uint32 index = (uint32)faces.size();
+	quickhull_face& face = faces.emplace_back();
+
+	face.v[0] = a;
+	face.v[1] = b;
+	face.v[2] = c;
+	face.neighbors[0] = face.neighbors[1] = face.neighbors[2] = UINT32_MAX;
+
+	// Slivers get a zero normal, so that no point is ever outside of them. They are merged into their neighbors at the end.
+	vec3 n = cross(points[b] - points[a], points[c] - points[a]);
+	float l = length(n);
+	face.normal = (l > 0.f) ? (n / l) : vec3(0.f, 0.f, 0.f);
+	face.d = dot(face.normal, points[a]);
+
+	face.furthestPoint = UINT32_MAX;
+	face.furthestDistance = 0.f;
+	face.mark = 0;
+	face.visible = false;
+	face.alive = true;
+
+	return index;
+}
+
+// Adds the point to the outside set of the face it is farthest above. Points which are not above any face by more than the tolerance are
+// inside the hull and dropped.
+static void assignOutsidePoint(std::vector<quickhull_face>& faces, const uint32* candidateFaces, uint32 numCandidateFaces, const vec3* points, uint32 point,
+	float tolerance)
+{
+	uint32 bestFace = UINT32_MAX;
+	float bestDistance = tolerance;
+
+	for (uint32 i = 0; i < numCandidateFaces; ++i)
+	{
+		const quickhull_face& face = faces[candidateFaces[i]];
+		float distance = dot(face.normal, points[point]) - face.d;
+		if (distance > bestDistance)
+		{
+			bestDistance = distance;
+			bestFace = candidateFaces[i];
+		}
+	}
+
+	if (bestFace != UINT32_MAX)
+	{
+		quickhull_face& face = faces[bestFace];
+		face.outsidePoints.push_back(point);
+		if (bestDistance > face.furthestDistance)
+		{
+			face.furthestDistance = bestDistance;
+			face.furthestPoint = point;
+		}
+	}
+}
+
+static void linkQuickhullFaces(std::vector<quickhull_face>& faces, uint32 first, uint32 count)
+{
+	for (uint32 f = first; f < first + count; ++f)
+	{
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			uint32 from = faces[f].v[i];
+			uint32 to = faces[f].v[(i + 1) % 3];
+
+			for (uint32 g = first; g < first + count; ++g)
+			{
+				for (uint32 j = 0; j < 3; ++j)
+				{
+					if (faces[g].v[j] == to && faces[g].v[(j + 1) % 3] == from)
+					{
+						faces[f].neighbors[i] = g;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Returns false if the points don't span a volume.
+static bool buildInitialSimplex(std::vector<quickhull_face>& faces, const vec3* points, uint32 numPoints, float tolerance, uint32 (&outVertices)[4])
+{
+	uint32 extremes[6] = {};
+	for (uint32 i = 1; i < numPoints; ++i)
+	{
+		for (uint32 axis = 0; axis < 3; ++axis)
+		{
+			if (points[i].data[axis] < points[extremes[2 * axis + 0]].data[axis]) { extremes[2 * axis + 0] = i; }
+			if (points[i].data[axis] > points[extremes[2 * axis + 1]].data[axis]) { extremes[2 * axis + 1] = i; }
+		}
+	}
+
+	// The two most distant extreme points.
+	uint32 i0 = 0, i1 = 0;
+	float maxSqDistance = 0.f;
+	for (uint32 a = 0; a < 6; ++a)
+	{
+		for (uint32 b = a + 1; b < 6; ++b)
+		{
+			float sqDistance = squaredLength(points[extremes[a]] - points[extremes[b]]);
+			if (sqDistance > maxSqDistance)
+			{
+				maxSqDistance = sqDistance;
+				i0 = extremes[a];
+				i1 = extremes[b];
+			}
+		}
+	}
+
+	if (maxSqDistance <= tolerance * tolerance)
+	{
+		return false;
+	}
+
+	// The point farthest from their line.
+	vec3 direction = normalize(points[i1] - points[i0]);
+	uint32 i2 = 0;
+	float maxLineDistance = 0.f;
+	for (uint32 i = 0; i < numPoints; ++i)
+	{
+		float sqDistance = squaredLength(cross(points[i] - points[i0], direction));
+		if (sqDistance > maxLineDistance)
+		{
+			maxLineDistance = sqDistance;
+			i2 = i;
+		}
+	}
+
+	if (maxLineDistance <= tolerance * tolerance)
+	{
+		return false;
+	}
+
+	// The point farthest from their plane.
+	vec3 normal = normalize(cross(points[i1] - points[i0], points[i2] - points[i0]));
+	uint32 i3 = 0;
+	float maxPlaneDistance = 0.f;
+	for (uint32 i = 0; i < numPoints; ++i)
+	{
+		float distance = abs(dot(points[i] - points[i0], normal));
+		if (distance > maxPlaneDistance)
+		{
+			maxPlaneDistance = distance;
+			i3 = i;
+		}
+	}
+
+	if (maxPlaneDistance <= tolerance)
+	{
+		return false;
+	}
+
+	// Make the base face point away from the apex. The other faces then wind the same way.
+	if (dot(points[i3] - points[i0], normal) > 0.f)
+	{
+		std::swap(i1, i2);
+	}
+
+	addQuickhullFace(faces, points, i0, i1, i2);
+	addQuickhullFace(faces, points, i0, i3, i1);
+	addQuickhullFace(faces, points, i1, i3, i2);
+	addQuickhullFace(faces, points, i2, i3, i0);
+	linkQuickhullFaces(faces, 0, 4);
+
+	outVertices[0] = i0;
+	outVertices[1] = i1;
+	outVertices[2] = i2;
+	outVertices[3] = i3;
+
+	return true;
+}
+
+// Boundary of a group of merged faces, in winding order. Each entry is a vertex and the group on the other side of the edge starting there.
+struct hull_boundary_vertex
+{
+	uint32 vertex;
+	uint32 neighborGroup;
+};
+
+static bool buildGroupBoundary(const std::vector<quickhull_face>& faces, const std::vector<uint32>& groupFaces, const std::vector<uint32>& faceGroups,
+	uint32 group, std::vector<hull_boundary_vertex>& outBoundary)
+{
+	outBoundary.clear();
+
+	// Maps the start vertex of each boundary edge to the edge. Pinched groups, which touch themselves in a vertex, are rejected.
+	std::unordered_map<uint32, std::pair<uint32, uint32>> next;
+	for (uint32 f : groupFaces)
+	{
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			uint32 neighborGroup = faceGroups[faces[f].neighbors[i]];
+			if (neighborGroup != group)
+			{
+				if (!next.insert({ faces[f].v[i], { faces[f].v[(i + 1) % 3], neighborGroup } }).second)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	if (next.size() < 3)
+	{
+		return false;
+	}
+
+	uint32 start = next.begin()->first;
+	uint32 current = start;
+	do
+	{
+		auto it = next.find(current);
+		if (it == next.end() || outBoundary.size() == next.size())
+		{
+			return false;
+		}
+
+		outBoundary.push_back({ current, it->second.second });
+		current = it->second.first;
+	} while (current != start);
+
+	// The boundary must be a single loop.
+	return outBoundary.size() == next.size();
+}
+
+// Corners of the merged face in winding order, after dropping the removed vertices. Fails if the boundary is not a single loop, if fewer than
+// three corners remain, or if the corners don't form a convex polygon, so that a fan would overlap itself.
+static bool getGroupCorners(const std::vector<quickhull_face>& faces, const std::vector<uint32>& groupFaces, const std::vector<uint32>& faceGroups,
+	uint32 group, const std::vector<bool>& keepVertex, const vec3* points, vec3 normal, float epsilon,
+	std::vector<hull_boundary_vertex>& boundary, std::vector<uint32>& outCorners)
+{
+	outCorners.clear();
+
+	if (!buildGroupBoundary(faces, groupFaces, faceGroups, group, boundary))
+	{
+		return false;
+	}
+
+	for (const hull_boundary_vertex& b : boundary)
+	{
+		if (keepVertex[b.vertex])
+		{
+			outCorners.push_back(b.vertex);
+		}
+	}
+
+	uint32 numCorners = (uint32)outCorners.size();
+	if (numCorners < 3)
+	{
+		return false;
+	}
+
+	for (uint32 i = 0; i < numCorners; ++i)
+	{
+		vec3 a = points[outCorners[i]];
+		vec3 b = points[outCorners[(i + 1) % numCorners]];
+		vec3 c = points[outCorners[(i + 2) % numCorners]];
+		if (dot(cross(b - a, c - b), normal) < -epsilon * epsilon)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bounding_hull_geometry buildBoundingHull(const vec3* points, uint32 numPoints, const bounding_hull_build_settings& settings)
+{
+	CPU_PROFILE_BLOCK("Build bounding hull");
+
+	bounding_hull_geometry result;
+	result.aabb = bounding_box::negativeInfinity();
+
+	if (numPoints < 4)
+	{
+		return result;
+	}
+
+	// The geometry uses 16 bit indices.
+	uint32 maxNumVertices = clamp(settings.maxNumVertices, 4u, (uint32)UINT16_MAX);
+	uint32 maxNumFaces = clamp(settings.maxNumFaces, 4u, (uint32)UINT16_MAX);
+
+	bounding_box bounds = bounding_box::negativeInfinity();
+	for (uint32 i = 0; i < numPoints; ++i)
+	{
+		bounds.grow(points[i]);
+	}
+
+	vec3 maxAbs = max(abs(bounds.minCorner), abs(bounds.maxCorner));
+	float epsilon = 3.f * FLT_EPSILON * (maxAbs.x + maxAbs.y + maxAbs.z);
+	float tolerance = max(settings.coplanarTolerance * length(bounds.maxCorner - bounds.minCorner), epsilon);
+
+	std::vector<quickhull_face> faces;
+	uint32 simplex[4];
+	if (!buildInitialSimplex(faces, points, numPoints, tolerance, simplex))
+	{
+		return result;
+	}
+
+	{
+		uint32 initialFaces[4] = { 0, 1, 2, 3 };
+		for (uint32 i = 0; i < numPoints; ++i)
+		{
+			if (i != simplex[0] && i != simplex[1] && i != simplex[2] && i != simplex[3])
+			{
+				assignOutsidePoint(faces, initialFaces, 4, points, i, tolerance);
+			}
+		}
+	}
+
+	uint32 numVertices = 4;
+	uint32 numFaces = 4;
+	uint32 iteration = 0;
+
+	std::vector<uint32> stack;
+	std::vector<uint32> visibleFaces;
+	std::vector<quickhull_horizon_edge> horizon;
+	std::vector<uint32> newFaces;
+	std::vector<uint32> orphans;
+
+	// Each added vertex adds two triangles (Euler characteristic), so the budget is checked before each step.
+	while (numVertices < maxNumVertices && numFaces + 2 <= maxNumFaces)
+	{
+		// Grow towards the globally farthest point, so that a hull cut short by the budget covers as much as possible.
+		uint32 eyeFace = UINT32_MAX;
+		float maxDistance = 0.f;
+		for (uint32 f = 0; f < (uint32)faces.size(); ++f)
+		{
+			if (faces[f].alive && !faces[f].outsidePoints.empty() && faces[f].furthestDistance > maxDistance)
+			{
+				maxDistance = faces[f].furthestDistance;
+				eyeFace = f;
+			}
+		}
+
+		if (eyeFace == UINT32_MAX)
+		{
+			break;
+		}
+
+		uint32 eye = faces[eyeFace].furthestPoint;
+		vec3 eyePoint = points[eye];
+		++iteration;
+
+		// Flood fill the faces visible from the eye point. Crossing into an invisible face marks a horizon edge.
+		visibleFaces.clear();
+		horizon.clear();
+
+		faces[eyeFace].mark = iteration;
+		faces[eyeFace].visible = true;
+		stack.push_back(eyeFace);
+
+		while (!stack.empty())
+		{
+			uint32 f = stack.back();
+			stack.pop_back();
+			visibleFaces.push_back(f);
+
+			for (uint32 i = 0; i < 3; ++i)
+			{
+				uint32 n = faces[f].neighbors[i];
+				quickhull_face& neighbor = faces[n];
+
+				if (neighbor.mark != iteration)
+				{
+					neighbor.mark = iteration;
+					neighbor.visible = dot(neighbor.normal, eyePoint) - neighbor.d > tolerance;
+					if (neighbor.visible)
+					{
+						stack.push_back(n);
+					}
+				}
+
+				if (!neighbor.visible)
+				{
+					horizon.push_back({ faces[f].v[i], faces[f].v[(i + 1) % 3], n });
+				}
+			}
+		}
+
+		// Numerical trouble can produce a horizon which is not a simple loop. The point is then skipped.
+		bool validHorizon = horizon.size() >= 3;
+		for (uint32 i = 0; i < (uint32)horizon.size() && validHorizon; ++i)
+		{
+			for (uint32 j = i + 1; j < (uint32)horizon.size(); ++j)
+			{
+				validHorizon &= horizon[i].from != horizon[j].from;
+			}
+		}
+
+		if (!validHorizon)
+		{
+			quickhull_face& face = faces[eyeFace];
+			face.outsidePoints.erase(std::find(face.outsidePoints.begin(), face.outsidePoints.end(), eye));
+			face.furthestDistance = 0.f;
+			for (uint32 p : face.outsidePoints)
+			{
+				float distance = dot(face.normal, points[p]) - face.d;
+				if (distance > face.furthestDistance)
+				{
+					face.furthestDistance = distance;
+					face.furthestPoint = p;
+				}
+			}
+			continue;
+		}
+
+		// Cone of new faces from the horizon to the eye point.
+		newFaces.clear();
+		for (const quickhull_horizon_edge& edge : horizon)
+		{
+			uint32 f = addQuickhullFace(faces, points, edge.from, edge.to, eye);
+			newFaces.push_back(f);
+
+			faces[f].neighbors[0] = edge.outsideFace;
+			quickhull_face& outside = faces[edge.outsideFace];
+			for (uint32 j = 0; j < 3; ++j)
+			{
+				if (outside.v[j] == edge.to && outside.v[(j + 1) % 3] == edge.from)
+				{
+					outside.neighbors[j] = f;
+				}
+			}
+		}
+
+		for (uint32 i = 0; i < (uint32)newFaces.size(); ++i)
+		{
+			for (uint32 j = 0; j < (uint32)newFaces.size(); ++j)
+			{
+				if (horizon[j].from == horizon[i].to) { faces[newFaces[i]].neighbors[1] = newFaces[j]; }
+				if (horizon[j].to == horizon[i].from) { faces[newFaces[i]].neighbors[2] = newFaces[j]; }
+			}
+		}
+
+		orphans.clear();
+		for (uint32 f : visibleFaces)
+		{
+			quickhull_face& face = faces[f];
+			for (uint32 p : face.outsidePoints)
+			{
+				if (p != eye)
+				{
+					orphans.push_back(p);
+				}
+			}
+			face.outsidePoints.clear();
+			face.outsidePoints.shrink_to_fit();
+			face.alive = false;
+		}
+
+		for (uint32 p : orphans)
+		{
+			assignOutsidePoint(faces, newFaces.data(), (uint32)newFaces.size(), points, p, tolerance);
+		}
+
+		numFaces += (uint32)newFaces.size() - (uint32)visibleFaces.size();
+		++numVertices;
+	}
+
+
+	// Merge neighboring faces which lie in the same plane (within the tolerance) into groups. The plane of the first face of a group is kept
+	// as reference, so that gently curved surfaces are not merged into one.
+	const uint32 noGroup = UINT32_MAX;
+	std::vector<uint32> faceGroups(faces.size(), noGroup);
+	std::vector<std::vector<uint32>> groups;
+	std::vector<vec3> groupNormals;
+
+	// Slivers without a normal can't seed a group. They join a neighbor, or otherwise stay alone in a second pass.
+	for (uint32 pass = 0; pass < 2; ++pass)
+	{
+		for (uint32 seed = 0; seed < (uint32)faces.size(); ++seed)
+		{
+			bool hasNormal = faces[seed].normal != vec3(0.f, 0.f, 0.f);
+			if (!faces[seed].alive || faceGroups[seed] != noGroup || (pass == 0 && !hasNormal))
+			{
+				continue;
+			}
+
+			uint32 group = (uint32)groups.size();
+			std::vector<uint32>& groupFaces = groups.emplace_back();
+
+			vec3 n0 = faces[seed].normal;
+			float d0 = faces[seed].d;
+			vec3 areaWeightedNormal(0.f, 0.f, 0.f);
+
+			faceGroups[seed] = group;
+			stack.push_back(seed);
+			while (!stack.empty())
+			{
+				uint32 f = stack.back();
+				stack.pop_back();
+				groupFaces.push_back(f);
+
+				const quickhull_face& face = faces[f];
+				areaWeightedNormal += cross(points[face.v[1]] - points[face.v[0]], points[face.v[2]] - points[face.v[0]]);
+
+				for (uint32 i = 0; i < 3; ++i)
+				{
+					uint32 n = face.neighbors[i];
+					const quickhull_face& neighbor = faces[n];
+					if (!hasNormal || faceGroups[n] != noGroup || dot(neighbor.normal, n0) < 0.f)
+					{
+						continue;
+					}
+
+					bool coplanar = true;
+					for (uint32 j = 0; j < 3; ++j)
+					{
+						coplanar &= abs(dot(n0, points[neighbor.v[j]]) - d0) <= tolerance;
+					}
+
+					if (coplanar)
+					{
+						faceGroups[n] = group;
+						stack.push_back(n);
+					}
+				}
+			}
+
+			float area = length(areaWeightedNormal);
+			groupNormals.push_back((area > 0.f) ? (areaWeightedNormal / area) : vec3(0.f, 0.f, 0.f));
+		}
+	}
+
+	uint32 numGroups = (uint32)groups.size();
+
+	// Vertices where fewer than three planes meet lie inside a merged face or on a straight edge and are dropped. Groups whose boundary is
+	// not a single loop keep their triangles and all of their vertices, which in turn may keep a vertex of a neighboring group.
+	std::unordered_map<uint32, std::vector<uint32>> vertexGroups;
+	for (uint32 g = 0; g < numGroups; ++g)
+	{
+		for (uint32 f : groups[g])
+		{
+			for (uint32 i = 0; i < 3; ++i)
+			{
+				std::vector<uint32>& list = vertexGroups[faces[f].v[i]];
+				if (std::find(list.begin(), list.end(), g) == list.end())
+				{
+					list.push_back(g);
+				}
+			}
+		}
+	}
+
+	std::vector<bool> keepVertex(numPoints, false);
+	for (auto& [vertex, list] : vertexGroups)
+	{
+		keepVertex[vertex] = list.size() >= 3;
+	}
+
+	std::vector<bool> fallbackGroups(numGroups, false);
+	std::vector<hull_boundary_vertex> boundary;
+	std::vector<uint32> corners;
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (uint32 g = 0; g < numGroups; ++g)
+		{
+			if (fallbackGroups[g])
+			{
+				continue;
+			}
+
+			if (!getGroupCorners(faces, groups[g], faceGroups, g, keepVertex, points, groupNormals[g], epsilon, boundary, corners))
+			{
+				fallbackGroups[g] = true;
+				for (uint32 f : groups[g])
+				{
+					for (uint32 i = 0; i < 3; ++i)
+					{
+						keepVertex[faces[f].v[i]] = true;
+					}
+				}
+				changed = true;
+			}
+		}
+	}
+
+
+	// Output. Vertices are compacted in order of first use.
+	std::unordered_map<uint32, uint16> vertexRemap;
+	auto remapVertex = [&](uint32 point)
+	{
+		auto it = vertexRemap.find(point);
+		if (it != vertexRemap.end())
+		{
+			return it->second;
+		}
+
+		uint16 index = (uint16)result.vertices.size();
+		vertexRemap.insert({ point, index });
+		result.vertices.push_back(points[point]);
+		result.aabb.grow(points[point]);
+		return index;
+	};
+
+	std::unordered_map<uint64, uint32> edgeMap;
+	auto addEdge = [&](uint32 from, uint32 to, uint32 triangle)
+	{
+		uint16 a = remapVertex(from);
+		uint16 b = remapVertex(to);
+		uint64 key = ((uint64)min(a, b) << 32) | max(a, b);
+
+		auto it = edgeMap.find(key);
+		if (it == edgeMap.end())
+		{
+			edgeMap.insert({ key, (uint32)result.edges.size() });
+			result.edges.push_back({ min(a, b), max(a, b), (uint16)triangle, UINT16_MAX });
+		}
+		else
+		{
+			result.edges[it->second].faceB = (uint16)triangle;
+		}
+	};
+
+	for (uint32 g = 0; g < numGroups; ++g)
+	{
+		// Groups of slivers only cover zero area.
+		vec3 normal = groupNormals[g];
+		if (normal == vec3(0.f, 0.f, 0.f))
+		{
+			continue;
+		}
+
+		uint32 firstTriangle = (uint32)result.faces.size();
+
+		if (fallbackGroups[g])
+		{
+			for (uint32 f : groups[g])
+			{
+				const quickhull_face& face = faces[f];
+				result.faces.push_back({ remapVertex(face.v[0]), remapVertex(face.v[1]), remapVertex(face.v[2]), normal });
+			}
+
+			for (uint32 f : groups[g])
+			{
+				const quickhull_face& face = faces[f];
+				for (uint32 i = 0; i < 3; ++i)
+				{
+					if (faceGroups[face.neighbors[i]] != g)
+					{
+						addEdge(face.v[i], face.v[(i + 1) % 3], firstTriangle);
+					}
+				}
+			}
+			continue;
+		}
+
+		bool valid = getGroupCorners(faces, groups[g], faceGroups, g, keepVertex, points, normal, epsilon, boundary, corners);
+		ASSERT(valid);
+
+		// The merged face is convex, so a fan covers it. Triangles spanning collinear corners have no area and are left out.
+		for (uint32 i = 1; i + 1 < (uint32)corners.size(); ++i)
+		{
+			vec3 a = points[corners[0]];
+			vec3 b = points[corners[i]];
+			vec3 c = points[corners[i + 1]];
+			if (squaredLength(cross(b - a, c - a)) > epsilon * epsilon)
+			{
+				result.faces.push_back({ remapVertex(corners[0]), remapVertex(corners[i]), remapVertex(corners[i + 1]), normal });
+			}
+		}
+
+		if ((uint32)result.faces.size() == firstTriangle)
+		{
+			continue;
+		}
+
+		for (uint32 i = 0; i < (uint32)corners.size(); ++i)
+		{
+			addEdge(corners[i], corners[(i + 1) % corners.size()], firstTriangle);
+		}
+	}
+
+	ASSERT(result.vertices.size() <= UINT16_MAX);
+	ASSERT(result.faces.size() <= UINT16_MAX);
+
+	return result;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "bounding_volumes.h"
+
+
+// Convex hulls of arbitrary point clouds, e.g. all vertices of a render mesh, simplified for collision detection. GJK and EPA evaluate the
+// support function over all hull vertices, so every vertex saved makes each collision with the hull cheaper.
+struct bounding_hull_build_settings
+{
+	// The hull is grown from the most extreme points first and stops at these limits. It then doesn't contain all input points.
+	uint32 maxNumVertices = 64;
+	uint32 maxNumFaces = 128; // Triangles.
+
+	// Points closer than this to a face are treated as lying on it, and neighboring faces this close to a common plane are merged. Relative
+	// to the diagonal of the points' bounding box.
+	float coplanarTolerance = 1e-3f;
+};
+
+// Quickhull. Merged faces are triangulated again, since the hull geometry stores triangles, but vertices lying inside a merged face or on the
+// edge between two faces are removed. The hull's edges are only the borders between different planes, which are the candidate axes of the
+// SAT edge tests. Returns an empty geometry if the points don't span a volume.
+bounding_hull_geometry buildBoundingHull(const vec3* points, uint32 numPoints, const bounding_hull_build_settings& settings = {});
@@ -2,18 +2,24 @@
 #include "island.h"
 #include "core/cpu_profiling.h"
 
-void buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 numBodyPairs, uint32 numRigidBodies, uint16 dummyRigidBodyIndex, const constraint_offsets& offsets)
+island_description buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 numBodyPairs, uint32 numRigidBodies, physics_index dummyRigidBodyIndex, const constraint_offsets& offsets)
 {
 	CPU_PROFILE_BLOCK("Build islands");
 
 	uint32 islandCapacity = numBodyPairs;
-	uint16* allIslands = arena.allocate<uint16>(islandCapacity);
+	uint32* allIslands = arena.allocate<uint32>(islandCapacity);
+
+	physics_index* bodyIndices = arena.allocate<physics_index>(numRigidBodies);
+	constraint_island* islands = arena.allocate<constraint_island>(numRigidBodies);
+	uint32* numConstraintsPerType = arena.allocate<uint32>(numRigidBodies * constraint_type_count, true);
+	uint32 numIslands = 0;
 
 	memory_marker marker = arena.getMarker();
 
 	uint32 count = numRigidBodies + 1; // 1 for the dummy.
 
-	uint16* numConstraintsPerBody = arena.allocate<uint16>(count, true);
+	// The dummy touches every static collider, so its count doesn't fit into a 16-bit physics_index.
+	uint32* numConstraintsPerBody = arena.allocate<uint32>(count, true);
 
 	for (uint32 i = 0; i < numBodyPairs; ++i)
 	{
@@ -22,9 +28,9 @@ void buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 n
 		++numConstraintsPerBody[pair.rbB];
 	}
 
-	uint16* offsetToFirstConstraintPerBody = arena.allocate<uint16>(count);
+	uint32* offsetToFirstConstraintPerBody = arena.allocate<uint32>(count);
 
-	uint16 currentOffset = 0;
+	uint32 currentOffset = 0;
 	for (uint32 i = 0; i < count; ++i)
 	{
 		offsetToFirstConstraintPerBody[i] = currentOffset;
@@ -33,31 +39,32 @@ void buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 n
 
 	struct body_pair_reference
 	{
-		uint16 otherBody;
-		uint16 pairIndex;
+		physics_index otherBody;
+		uint32 pairIndex;
 	};
 
 	body_pair_reference* pairReferences = arena.allocate<body_pair_reference>(numBodyPairs * 2);
-	uint16* counter = arena.allocate<uint16>(count);
-	memcpy(counter, offsetToFirstConstraintPerBody, sizeof(uint16) * count);
+	uint32* counter = arena.allocate<uint32>(count);
+	memcpy(counter, offsetToFirstConstraintPerBody, sizeof(uint32) * count);
 
 	for (uint32 i = 0; i < numBodyPairs; ++i)
 	{
 		constraint_body_pair pair = bodyPairs[i];
-		pairReferences[counter[pair.rbA]++] = { pair.rbB, (uint16)i };
-		pairReferences[counter[pair.rbB]++] = { pair.rbA, (uint16)i };
+		pairReferences[counter[pair.rbA]++] = { pair.rbB, i };
+		pairReferences[counter[pair.rbB]++] = { pair.rbA, i };
 	}
 
 
-	uint16* rbStack = arena.allocate<uint16>(count);
+	physics_index* rbStack = arena.allocate<physics_index>(count);
 	uint32 stackPtr;
 
 	bool* alreadyVisited = arena.allocate<bool>(count, true);
 	bool* alreadyOnStack = arena.allocate<bool>(count, true);
 
 	uint32 islandPtr = 0;
+	uint32 bodyPtr = 0;
 
-	for (uint16 rbIndexOuter = 0; rbIndexOuter < (uint16)numRigidBodies; ++rbIndexOuter)
+	for (physics_index rbIndexOuter = 0; rbIndexOuter < (physics_index)numRigidBodies; ++rbIndexOuter)
 	{
 		if (alreadyVisited[rbIndexOuter] || rbIndexOuter == dummyRigidBodyIndex)
 		{
@@ -66,6 +73,7 @@ void buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 n
 
 		// Reset island.
 		uint32 islandStart = islandPtr;
+		uint32 bodyStart = bodyPtr;
 
 		rbStack[0] = rbIndexOuter;
 		alreadyOnStack[rbIndexOuter] = true;
@@ -75,11 +83,12 @@ void buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 n
 
 		while (stackPtr != 0)
 		{
-			uint16 rbIndex = rbStack[--stackPtr];
+			physics_index rbIndex = rbStack[--stackPtr];
 
 			ASSERT(rbIndex != dummyRigidBodyIndex);
 			ASSERT(!alreadyVisited[rbIndex]);
 			alreadyVisited[rbIndex] = true;
+			bodyIndices[bodyPtr++] = rbIndex;
 
 
 			// Push connected bodies.
@@ -88,7 +97,7 @@ void buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 n
 			for (uint32 i = startIndex; i < startIndex + count; ++i)
 			{
 				body_pair_reference ref = pairReferences[i];
-				uint16 other = ref.otherBody;
+				physics_index other = ref.otherBody;
 				if (!alreadyOnStack[other] && other != dummyRigidBodyIndex) // Don't push dummy to stack. We don't want to grow islands over the dummy.
 				{
 					alreadyOnStack[other] = true;
@@ -109,11 +118,23 @@ void buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 n
 		uint32 islandSize = islandPtr - islandStart;
 		if (islandSize > 0)
 		{
-			uint16* islandPairs = allIslands + islandStart;
+			uint32* islandPairs = allIslands + islandStart;
 			std::sort(islandPairs, islandPairs + islandSize);
 
-
+			// Since the pairs are sorted, each constraint type forms a contiguous range.
+			uint32* typeCounts = numConstraintsPerType + numIslands * constraint_type_count;
+			uint32 type = 0;
+			for (uint32 i = 0; i < islandSize; ++i)
+			{
+				while (type < constraint_type_count - 1 && islandPairs[i] >= offsets.constraintOffsets[type + 1])
+				{
+					++type;
+				}
+				++typeCounts[type];
+			}
 		}
+
+		islands[numIslands++] = { islandStart, islandSize, bodyStart, bodyPtr - bodyStart };
 	}
 
 
@@ -126,4 +147,12 @@ void buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 n
 #endif
 
 	arena.resetToMarker(marker);
+
+	island_description result;
+	result.constraintIndices = allIslands;
+	result.bodyIndices = bodyIndices;
+	result.islands = islands;
+	result.numIslands = numIslands;
+	result.numConstraintsPerType = numConstraintsPerType;
+	return result;
 }
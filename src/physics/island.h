@@ -8,4 +8,30 @@ struct constraint_offsets
 	uint32 constraintOffsets[constraint_type_count];
 };
 
-void buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 numBodyPairs, uint32 numRigidBodies, uint16 dummyRigidBodyIndex, const constraint_offsets& offsets);
+struct constraint_island
+{
+	uint32 startIndex; // Into island_description::constraintIndices.
+	uint32 count;
+
+	uint32 bodyStartIndex; // Into island_description::bodyIndices.
+	uint32 numBodies;
+};
+
+struct island_description
+{
+	// Indices into the body pair array. The indices of each island are sorted, so all constraints of one type are contiguous.
+	uint32* constraintIndices;
+
+	// Rigid body indices, grouped by island. Every rigid body (except the dummy) is part of exactly one island, so this is numRigidBodies many.
+	physics_index* bodyIndices;
+
+	// This includes islands without any constraints, i.e. single unconnected rigid bodies.
+	constraint_island* islands;
+	uint32 numIslands;
+
+	// Number of constraints per type in each island. numIslands * constraint_type_count many.
+	uint32* numConstraintsPerType;
+};
+
+// All outputs are allocated from the arena and stay valid until the caller resets it.
+island_description buildIslands(memory_arena& arena, constraint_body_pair* bodyPairs, uint32 numBodyPairs, uint32 numRigidBodies, physics_index dummyRigidBodyIndex, const constraint_offsets& offsets);
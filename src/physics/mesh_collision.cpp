@@ -0,0 +1,622 @@
+#include "pch.h"
+#include "mesh_collision.h"
+#include "heightmap_collision.h"
+#include "collision_gjk.h"
+#include "collision_epa.h"
+#include "scene/components.h"
+#include "core/cpu_profiling.h"
+
+static std::vector<mesh_collider_geometry> meshColliderGeometries;
+
+// Triangles tested with GJK are extruded by this amount against their normal, so that shapes which have tunneled slightly into the mesh are
+// still pushed out the front.
+static const float meshTriangleThickness = 0.2f;
+
+struct mesh_collider_build_triangle
+{
+	bounding_box aabb;
+	vec3 centroid;
+	uint32 index;
+};
+
+static mesh_collider_bvh_node quantizeNode(const bounding_box& aabb, const bounding_box& meshAABB, vec3 quantizationScale)
+{
+	vec3 minCorner = (aabb.minCorner - meshAABB.minCorner) * quantizationScale;
+	vec3 maxCorner = (aabb.maxCorner - meshAABB.minCorner) * quantizationScale;
+
+	mesh_collider_bvh_node node;
+	for (uint32 i = 0; i < 3; ++i)
+	{
+		node.minCorner[i] = (uint16)clamp(floor(minCorner.data[i]), 0.f, 65535.f);
+		node.maxCorner[i] = (uint16)clamp(ceil(maxCorner.data[i]), 0.f, 65535.f);
+	}
+	node.data = 0;
+	return node;
+}
+
+// Builds the subtree over the given range of triangles depth first and returns the index of its root. Inner nodes are split at the median
+// centroid along the longest axis, so the tree is balanced and its depth is logarithmic in the number of triangles.
+static uint32 buildBVHNode(mesh_collider_build_triangle* triangles, uint32 first, uint32 count, const bounding_box& meshAABB, vec3 quantizationScale,
+	std::vector<mesh_collider_bvh_node>& nodes)
+{
+	bounding_box aabb = bounding_box::negativeInfinity();
+	bounding_box centroidAABB = bounding_box::negativeInfinity();
+	for (uint32 i = first; i < first + count; ++i)
+	{
+		aabb.grow(triangles[i].aabb.minCorner);
+		aabb.grow(triangles[i].aabb.maxCorner);
+		centroidAABB.grow(triangles[i].centroid);
+	}
+
+	uint32 nodeIndex = (uint32)nodes.size();
+	nodes.push_back(quantizeNode(aabb, meshAABB, quantizationScale));
+
+	if (count <= MESH_COLLIDER_MAX_TRIANGLES_PER_LEAF)
+	{
+		nodes[nodeIndex].data = first | (count << (32 - MESH_COLLIDER_BVH_COUNT_BITS));
+		return nodeIndex;
+	}
+
+	vec3 extent = centroidAABB.maxCorner - centroidAABB.minCorner;
+	uint32 axis = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+
+	uint32 half = count / 2;
+	std::nth_element(triangles + first, triangles + first + half, triangles + first + count,
+		[axis](const mesh_collider_build_triangle& a, const mesh_collider_build_triangle& b)
+		{
+			return a.centroid.data[axis] < b.centroid.data[axis];
+		});
+
+	buildBVHNode(triangles, first, half, meshAABB, quantizationScale, nodes);
+	uint32 secondChild = buildBVHNode(triangles, first + half, count - half, meshAABB, quantizationScale, nodes);
+
+	nodes[nodeIndex].data = secondChild;
+	return nodeIndex;
+}
+
+mesh_collider_geometry mesh_collider_geometry::fromMesh(const vec3* vertices, uint32 numVertices, const indexed_triangle32* triangles, uint32 numTriangles)
+{
+	CPU_PROFILE_BLOCK("Build mesh collider");
+
+	mesh_collider_geometry result;
+	result.vertices.assign(vertices, vertices + numVertices);
+
+	result.aabb = bounding_box::negativeInfinity();
+	for (uint32 i = 0; i < numVertices; ++i)
+	{
+		result.aabb.grow(vertices[i]);
+	}
+
+	// Degenerate triangles have no normal and never generate contacts.
+	std::vector<mesh_collider_build_triangle> buildTriangles;
+	buildTriangles.reserve(numTriangles);
+	for (uint32 i = 0; i < numTriangles; ++i)
+	{
+		vec3 a = vertices[triangles[i].a];
+		vec3 b = vertices[triangles[i].b];
+		vec3 c = vertices[triangles[i].c];
+
+		if (squaredLength(cross(b - a, c - a)) < 1e-12f)
+		{
+			continue;
+		}
+
+		mesh_collider_build_triangle& t = buildTriangles.emplace_back();
+		t.aabb = bounding_box::fromMinMax(min(a, min(b, c)), max(a, max(b, c)));
+		t.centroid = (a + b + c) * (1.f / 3.f);
+		t.index = i;
+	}
+
+	uint32 numValidTriangles = (uint32)buildTriangles.size();
+	ASSERT(numValidTriangles <= MESH_COLLIDER_BVH_INDEX_MASK);
+
+	if (numValidTriangles == 0)
+	{
+		return result;
+	}
+
+	vec3 meshExtent = result.aabb.maxCorner - result.aabb.minCorner;
+	vec3 quantizationScale(
+		65535.f / max(meshExtent.x, 1e-6f),
+		65535.f / max(meshExtent.y, 1e-6f),
+		65535.f / max(meshExtent.z, 1e-6f));
+
+	result.nodes.reserve(2 * (numValidTriangles / MESH_COLLIDER_MAX_TRIANGLES_PER_LEAF) + 1);
+	buildBVHNode(buildTriangles.data(), 0, numValidTriangles, result.aabb, quantizationScale, result.nodes);
+
+	// The leaves reference contiguous ranges, so the triangles are stored in the order the build left them in.
+	result.triangles.resize(numValidTriangles);
+	for (uint32 i = 0; i < numValidTriangles; ++i)
+	{
+		result.triangles[i] = triangles[buildTriangles[i].index];
+	}
+
+	return result;
+}
+
+#ifndef PHYSICS_ONLY
+// Like allocateBoundingHullGeometry, this is not available in the physics-only build.
+
+#include "asset/model_asset.h"
+#include "asset/io.h"
+
+static const uint32 MESH_COLLIDER_CACHE_HEADER = 'MCOL';
+
+// Followed by the vertices, triangles and nodes (see readCacheFile).
+struct mesh_collider_cache_header
+{
+	uint32 header = MESH_COLLIDER_CACHE_HEADER;
+	uint32 version = 2;
+	bounding_box aabb;
+};
+
+static bool readMeshColliderCache(const fs::path& path, mesh_collider_geometry& outGeometry)
+{
+	mesh_collider_cache_header header;
+	if (!readCacheFile(path, header, outGeometry.vertices, outGeometry.triangles, outGeometry.nodes))
+	{
+		return false;
+	}
+
+	outGeometry.aabb = header.aabb;
+	return true;
+}
+
+static void writeMeshColliderCache(const fs::path& path, const mesh_collider_geometry& geometry)
+{
+	mesh_collider_cache_header header;
+	header.aabb = geometry.aabb;
+
+	writeCacheFile(path, header, geometry.vertices, geometry.triangles, geometry.nodes);
+}
+
+uint32 allocateMeshColliderGeometry(const std::string& meshFilepath)
+{
+	fs::path path = meshFilepath;
+	if (!fs::exists(path))
+	{
+		return INVALID_MESH_COLLIDER_INDEX;
+	}
+
+	fs::path cachedFilename = path;
+	cachedFilename.replace_extension(".collider.cache.bin");
+	fs::path cacheFilepath = L"asset_cache" / cachedFilename;
+
+	if (fs::exists(cacheFilepath) && fs::last_write_time(cacheFilepath) > fs::last_write_time(path))
+	{
+		mesh_collider_geometry geometry;
+		if (readMeshColliderCache(cacheFilepath, geometry))
+		{
+			return allocateMeshColliderGeometry(std::move(geometry));
+		}
+	}
+
+	model_asset asset = load3DModelFromFile(path);
+	if (asset.meshes.empty())
+	{
+		return INVALID_MESH_COLLIDER_INDEX;
+	}
+
+	// Submeshes are limited to 16 bit indices, the collider is not.
+	std::vector<vec3> vertices;
+	std::vector<indexed_triangle32> triangles;
+	for (auto& mesh : asset.meshes)
+	{
+		for (auto& sub : mesh.submeshes)
+		{
+			uint32 offset = (uint32)vertices.size();
+			vertices.insert(vertices.end(), sub.positions.begin(), sub.positions.end());
+			for (const indexed_triangle16& t : sub.triangles)
+			{
+				triangles.push_back({ offset + t.a, offset + t.b, offset + t.c });
+			}
+		}
+	}
+
+	mesh_collider_geometry geometry = mesh_collider_geometry::fromMesh(vertices.data(), (uint32)vertices.size(), triangles.data(), (uint32)triangles.size());
+	writeMeshColliderCache(cacheFilepath, geometry);
+
+	return allocateMeshColliderGeometry(std::move(geometry));
+}
+#endif
+
+uint32 allocateMeshColliderGeometry(mesh_collider_geometry&& geometry)
+{
+	uint32 index = (uint32)meshColliderGeometries.size();
+	meshColliderGeometries.push_back(std::move(geometry));
+	return index;
+}
+
+const mesh_collider_geometry& getMeshColliderGeometry(uint32 index)
+{
+	return meshColliderGeometries[index];
+}
+
+// Appends the triangles of all leaves overlapping the quantized query box. Since both the nodes and the query are rounded outwards, this
+// may return a few triangles too many, but never too few.
+static void queryBVH(const mesh_collider_geometry& geometry, const uint16 (&queryMin)[3], const uint16 (&queryMax)[3], std::vector<uint32>& outTriangles)
+{
+	uint32 stack[64];
+	uint32 stackSize = 0;
+
+	uint32 nodeIndex = 0;
+	while (true)
+	{
+		const mesh_collider_bvh_node& node = geometry.nodes[nodeIndex];
+
+		bool overlap = node.minCorner[0] <= queryMax[0] && node.maxCorner[0] >= queryMin[0]
+			&& node.minCorner[1] <= queryMax[1] && node.maxCorner[1] >= queryMin[1]
+			&& node.minCorner[2] <= queryMax[2] && node.maxCorner[2] >= queryMin[2];
+
+		if (overlap)
+		{
+			uint32 count = node.data >> (32 - MESH_COLLIDER_BVH_COUNT_BITS);
+			if (count == 0)
+			{
+				ASSERT(stackSize < arraysize(stack));
+				stack[stackSize++] = node.data;
+				++nodeIndex;
+				continue;
+			}
+
+			uint32 first = node.data & MESH_COLLIDER_BVH_INDEX_MASK;
+			for (uint32 i = 0; i < count; ++i)
+			{
+				outTriangles.push_back(first + i);
+			}
+		}
+
+		if (stackSize == 0)
+		{
+			break;
+		}
+		nodeIndex = stack[--stackSize];
+	}
+}
+
+// Keeps at most MESH_COLLIDER_MAX_CONTACTS contacts, which span the largest area: The deepest contact, the one farthest from it, the one
+// maximizing the triangle area with the first two, and the one farthest outside of that triangle. Duplicates from shared edges and vertices
+// are dropped along the way. The triangles are reordered like the contacts. Returns the new number of contacts.
+static uint32 reduceContacts(collision_contact* contacts, uint32* triangles, uint32 numContacts)
+{
+	static_assert(MESH_COLLIDER_MAX_CONTACTS == 4);
+
+	if (numContacts <= 1)
+	{
+		return numContacts;
+	}
+
+	uint32 deepest = 0;
+	for (uint32 i = 1; i < numContacts; ++i)
+	{
+		if (contacts[i].penetrationDepth > contacts[deepest].penetrationDepth)
+		{
+			deepest = i;
+		}
+	}
+	std::swap(contacts[0], contacts[deepest]);
+	std::swap(triangles[0], triangles[deepest]);
+	vec3 p0 = contacts[0].point;
+
+	uint32 farthest = 1;
+	float maxSqDistance = 0.f;
+	for (uint32 i = 1; i < numContacts; ++i)
+	{
+		float sqDistance = squaredLength(contacts[i].point - p0);
+		if (sqDistance > maxSqDistance)
+		{
+			maxSqDistance = sqDistance;
+			farthest = i;
+		}
+	}
+	if (maxSqDistance < 1e-6f)
+	{
+		return 1;
+	}
+	std::swap(contacts[1], contacts[farthest]);
+	std::swap(triangles[1], triangles[farthest]);
+	vec3 p1 = contacts[1].point;
+
+	uint32 widest = 2;
+	float maxSqArea = 0.f;
+	for (uint32 i = 2; i < numContacts; ++i)
+	{
+		float sqArea = squaredLength(cross(p1 - p0, contacts[i].point - p0));
+		if (sqArea > maxSqArea)
+		{
+			maxSqArea = sqArea;
+			widest = i;
+		}
+	}
+	if (maxSqArea < 1e-10f)
+	{
+		return 2;
+	}
+	std::swap(contacts[2], contacts[widest]);
+	std::swap(triangles[2], triangles[widest]);
+	vec3 p2 = contacts[2].point;
+
+	// Signed areas are negative for points outside of the corresponding edge of the triangle.
+	vec3 n = cross(p1 - p0, p2 - p0);
+	uint32 outermost = 3;
+	float minArea = 0.f;
+	for (uint32 i = 3; i < numContacts; ++i)
+	{
+		vec3 p = contacts[i].point;
+		float area = min(dot(cross(p1 - p0, p - p0), n), min(dot(cross(p2 - p1, p - p1), n), dot(cross(p0 - p2, p - p2), n)));
+		if (area < minArea)
+		{
+			minArea = area;
+			outermost = i;
+		}
+	}
+	if (minArea > -1e-10f)
+	{
+		return 3;
+	}
+	std::swap(contacts[3], contacts[outermost]);
+	std::swap(triangles[3], triangles[outermost]);
+
+	return 4;
+}
+
+// Exact box vs triangle tests for the triangles surviving the SIMD culling. The triangles are transformed into the box's local space, where
+// the heightmap's AABB test applies.
+static uint32 collideOBBVsTriangles(const mesh_triangle_batch& batch, const bounding_oriented_box& obb, memory_arena& arena,
+	collision_contact* outContacts, uint32* outTriangles)
+{
+	uint32* indices = arena.allocate<uint32>(batch.numTriangles);
+	uint32 numIndices = SIMD_DISPATCH(cullTrianglesVsOBBSIMD)(batch, obb, indices);
+
+	quat invRotation = conjugate(obb.rotation);
+
+	uint32 numContacts = 0;
+	for (uint32 i = 0; i < numIndices; ++i)
+	{
+		uint32 t = indices[i];
+		vec3 a = invRotation * (vec3(batch.a[0][t], batch.a[1][t], batch.a[2][t]) - obb.center);
+		vec3 b = invRotation * (vec3(batch.b[0][t], batch.b[1][t], batch.b[2][t]) - obb.center);
+		vec3 c = invRotation * (vec3(batch.c[0][t], batch.c[1][t], batch.c[2][t]) - obb.center);
+
+		if (collideAABBvsTriangle(vec3(0.f, 0.f, 0.f), obb.radius, a, b, c, outContacts + numContacts))
+		{
+			outTriangles[numContacts++] = t;
+		}
+	}
+
+	for (uint32 i = 0; i < numContacts; ++i)
+	{
+		outContacts[i].normal = obb.rotation * outContacts[i].normal;
+		outContacts[i].point = obb.rotation * outContacts[i].point + obb.center;
+	}
+
+	return numContacts;
+}
+
+// Cylinders and hulls have no dedicated triangle test. The triangles are culled against the shape's bounding box and the rest goes through
+// GJK and EPA.
+template <typename support_fn_t>
+static uint32 collideConvexVsTriangles(const mesh_triangle_batch& batch, const support_fn_t& support, const bounding_box& aabb, memory_arena& arena,
+	collision_contact* outContacts, uint32* outTriangles)
+{
+	bounding_oriented_box obb = { quat::identity, aabb.getCenter(), aabb.getRadius() };
+
+	uint32* indices = arena.allocate<uint32>(batch.numTriangles);
+	uint32 numIndices = SIMD_DISPATCH(cullTrianglesVsOBBSIMD)(batch, obb, indices);
+
+	uint32 numContacts = 0;
+	for (uint32 i = 0; i < numIndices; ++i)
+	{
+		uint32 t = indices[i];
+		vec3 a(batch.a[0][t], batch.a[1][t], batch.a[2][t]);
+		vec3 b(batch.b[0][t], batch.b[1][t], batch.b[2][t]);
+		vec3 c(batch.c[0][t], batch.c[1][t], batch.c[2][t]);
+
+		vec3 triNormal = normalize(cross(b - a, c - a));
+		extruded_triangle_support_fn triangleSupport(a, b, c, triNormal * -meshTriangleThickness);
+
+		gjk_simplex gjkSimplex;
+		if (!gjkIntersectionTest(support, triangleSupport, gjkSimplex))
+		{
+			continue;
+		}
+
+		epa_result epa;
+		if (epaCollisionInfo(gjkSimplex, support, triangleSupport, epa) != epa_success)
+		{
+			continue;
+		}
+
+		outTriangles[numContacts] = t;
+		collision_contact& contact = outContacts[numContacts++];
+		contact.point = epa.point;
+		contact.normal = epa.normal;
+		contact.penetrationDepth = epa.penetrationDepth;
+	}
+
+	return numContacts;
+}
+
+void meshCollision(game_scene& scene, const collider_union* worldSpaceColliders, const bounding_box* worldSpaceAABBs,
+	collision_output_buffers& out, std::vector<collider_pair>& overlapBuffer, memory_arena& arena, broadphase_type broadphaseType,
+	physics_index dummyRigidBodyIndex, const bool* rbAwake)
+{
+	uint32 numMeshes = scene.numberOfComponentsOfType<mesh_collider_component>();
+	if (numMeshes == 0)
+	{
+		return;
+	}
+
+	CPU_PROFILE_BLOCK("Mesh collisions");
+
+	scope_temp_memory temp(arena);
+
+	const mesh_collider_component** meshes = arena.allocate<const mesh_collider_component*>(numMeshes);
+	entity_handle* meshEntities = arena.allocate<entity_handle>(numMeshes);
+	const transform_component** meshTransforms = arena.allocate<const transform_component*>(numMeshes);
+	bounding_box* meshAABBs = arena.allocate<bounding_box>(numMeshes);
+
+	uint32 meshIndex = 0;
+	for (auto [entityHandle, mesh, transform] : scene.view<mesh_collider_component, transform_component>().each())
+	{
+		if (mesh.geometryIndex == INVALID_MESH_COLLIDER_INDEX || getMeshColliderGeometry(mesh.geometryIndex).nodes.empty())
+		{
+			continue;
+		}
+
+		const bounding_box& localAABB = getMeshColliderGeometry(mesh.geometryIndex).aabb;
+		bounding_box scaledAABB = bounding_box::fromMinMax(
+			min(localAABB.minCorner * transform.scale, localAABB.maxCorner * transform.scale),
+			max(localAABB.minCorner * transform.scale, localAABB.maxCorner * transform.scale));
+
+		meshes[meshIndex] = &mesh;
+		meshEntities[meshIndex] = entityHandle;
+		meshTransforms[meshIndex] = &transform;
+		meshAABBs[meshIndex] = scaledAABB.transformToAABB(transform.rotation, transform.position);
+		++meshIndex;
+	}
+	numMeshes = meshIndex;
+
+	uint32 numOverlaps = broadphaseQuery(scene, worldSpaceAABBs, meshAABBs, numMeshes, arena, overlapBuffer, broadphaseType);
+
+	std::vector<uint32> candidates;
+
+	for (uint32 o = 0; o < numOverlaps; ++o)
+	{
+		collider_pair overlap = overlapBuffer[o];
+		const collider_union& collider = worldSpaceColliders[overlap.colliderB];
+
+		if (collider.objectType != physics_object_type_rigid_body)
+		{
+			continue;
+		}
+
+		if (rbAwake && !rbAwake[collider.objectIndex])
+		{
+			continue;
+		}
+
+		const mesh_collider_component& mesh = *meshes[overlap.colliderA];
+		const transform_component& transform = *meshTransforms[overlap.colliderA];
+		const mesh_collider_geometry& geometry = getMeshColliderGeometry(mesh.geometryIndex);
+
+		// Collider bounds in the mesh's local space, quantized like the BVH nodes.
+		quat invRotation = conjugate(transform.rotation);
+		bounding_box localAABB = worldSpaceAABBs[overlap.colliderB].transformToAABB(invRotation, invRotation * -transform.position);
+		vec3 invScale = vec3(1.f, 1.f, 1.f) / transform.scale;
+		localAABB = bounding_box::fromMinMax(
+			min(localAABB.minCorner * invScale, localAABB.maxCorner * invScale),
+			max(localAABB.minCorner * invScale, localAABB.maxCorner * invScale));
+
+		vec3 meshExtent = geometry.aabb.maxCorner - geometry.aabb.minCorner;
+		vec3 quantizationScale(
+			65535.f / max(meshExtent.x, 1e-6f),
+			65535.f / max(meshExtent.y, 1e-6f),
+			65535.f / max(meshExtent.z, 1e-6f));
+		mesh_collider_bvh_node query = quantizeNode(localAABB, geometry.aabb, quantizationScale);
+
+		candidates.clear();
+		queryBVH(geometry, query.minCorner, query.maxCorner, candidates);
+
+		uint32 numCandidates = (uint32)candidates.size();
+		if (numCandidates == 0)
+		{
+			continue;
+		}
+
+		memory_marker marker = arena.getMarker();
+
+		// World space triangles in structure of arrays layout for the SIMD kernels.
+		uint32 numPaddedCandidates = alignTo(numCandidates, MESH_COLLISION_SIMD_PADDING);
+		float* batchMemory = arena.allocate<float>(9 * numPaddedCandidates);
+
+		mesh_triangle_batch batch;
+		for (uint32 k = 0; k < 3; ++k)
+		{
+			batch.a[k] = batchMemory + (0 + k) * numPaddedCandidates;
+			batch.b[k] = batchMemory + (3 + k) * numPaddedCandidates;
+			batch.c[k] = batchMemory + (6 + k) * numPaddedCandidates;
+		}
+		batch.numTriangles = numPaddedCandidates;
+
+		for (uint32 i = 0; i < numCandidates; ++i)
+		{
+			const indexed_triangle32& tri = geometry.triangles[candidates[i]];
+			vec3 a = transform.rotation * (geometry.vertices[tri.a] * transform.scale) + transform.position;
+			vec3 b = transform.rotation * (geometry.vertices[tri.b] * transform.scale) + transform.position;
+			vec3 c = transform.rotation * (geometry.vertices[tri.c] * transform.scale) + transform.position;
+
+			for (uint32 k = 0; k < 3; ++k)
+			{
+				batch.a[k][i] = a.data[k];
+				batch.b[k][i] = b.data[k];
+				batch.c[k][i] = c.data[k];
+			}
+		}
+		for (uint32 i = numCandidates; i < numPaddedCandidates; ++i)
+		{
+			for (uint32 k = 0; k < 3; ++k)
+			{
+				batch.a[k][i] = batch.b[k][i] = batch.c[k][i] = 1e15f;
+			}
+		}
+
+		// Each triangle generates at most one contact. The triangles are indices into the batch.
+		collision_contact* colliderContacts = arena.allocate<collision_contact>(numCandidates);
+		uint32* contactTriangles = arena.allocate<uint32>(numCandidates);
+		uint32 numContacts = 0;
+
+		switch (collider.type)
+		{
+			case collider_type_sphere:
+			{
+				numContacts = SIMD_DISPATCH(collideSphereVsTrianglesSIMD)(batch, collider.sphere, colliderContacts, contactTriangles, numCandidates);
+			} break;
+			case collider_type_capsule:
+			{
+				numContacts = SIMD_DISPATCH(collideCapsuleVsTrianglesSIMD)(batch, collider.capsule, colliderContacts, contactTriangles, numCandidates);
+			} break;
+			case collider_type_cylinder:
+			{
+				numContacts = collideConvexVsTriangles(batch, cylinder_support_fn{ collider.cylinder }, worldSpaceAABBs[overlap.colliderB], arena, colliderContacts, contactTriangles);
+			} break;
+			case collider_type_aabb:
+			{
+				bounding_oriented_box obb = { quat::identity, collider.aabb.getCenter(), collider.aabb.getRadius() };
+				numContacts = collideOBBVsTriangles(batch, obb, arena, colliderContacts, contactTriangles);
+			} break;
+			case collider_type_obb:
+			{
+				numContacts = collideOBBVsTriangles(batch, collider.obb, arena, colliderContacts, contactTriangles);
+			} break;
+			case collider_type_hull:
+			{
+				numContacts = collideConvexVsTriangles(batch, hull_support_fn{ collider.hull }, worldSpaceAABBs[overlap.colliderB], arena, colliderContacts, contactTriangles);
+			} break;
+		}
+
+		numContacts = reduceContacts(colliderContacts, contactTriangles, numContacts);
+
+		if (numContacts > 0)
+		{
+			float friction = clamp01(sqrt(collider.material.friction * mesh.material.friction));
+			float restitution = clamp01(max(collider.material.restitution, mesh.material.restitution));
+
+			uint32 friction_restitution = ((uint32)(friction * 0xFFFF) << 16) | (uint32)(restitution * 0xFFFF);
+
+			for (uint32 j = 0; j < numContacts; ++j)
+			{
+				colliderContacts[j].friction_restitution = friction_restitution;
+				out.contacts.push_back(colliderContacts[j]);
+				out.bodyPairs.push_back({ collider.objectIndex, dummyRigidBodyIndex });
+				out.contactFeatures.push_back(candidates[contactTriangles[j]]);
+			}
+
+			out.contactCountPerCollision.push_back((uint8)numContacts);
+			out.colliderPairs.push_back({ (physics_index)overlap.colliderB, INVALID_PHYSICS_INDEX });
+			out.otherEntities.push_back(meshEntities[overlap.colliderA]);
+		}
+
+		arena.resetToMarker(marker);
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "physics.h"
+#include "collision_narrow.h"
+#include "core/simd_dispatch.h"
+
+
+// Static triangle meshes for level geometry. Unlike hulls, the mesh does not need to be convex and is a single object, so it costs one
+// broadphase query instead of one broadphase entry per convex piece. Only rigid bodies collide with it.
+
+// Triangles per BVH leaf. Must fit in MESH_COLLIDER_BVH_COUNT_BITS.
+#define MESH_COLLIDER_MAX_TRIANGLES_PER_LEAF 4
+
+// Each rigid body collider keeps at most this many contacts with a mesh, after reduction.
+#define MESH_COLLIDER_MAX_CONTACTS 4
+
+// The node bounds are quantized to 16 bits relative to the mesh bounds. Rounding is conservative, so the nodes only ever get larger.
+struct mesh_collider_bvh_node
+{
+	uint16 minCorner[3];
+	uint16 maxCorner[3];
+
+	// Inner nodes: index of the second child. The first child directly follows its parent.
+	// Leaves: index of the first triangle, with the number of triangles in the top bits.
+	uint32 data;
+};
+
+static_assert(sizeof(mesh_collider_bvh_node) == 16);
+
+struct mesh_collider_geometry
+{
+	std::vector<vec3> vertices;
+	std::vector<indexed_triangle32> triangles; // Sorted by BVH leaf.
+	std::vector<mesh_collider_bvh_node> nodes; // Depth first. The root is node 0.
+
+	bounding_box aabb;
+
+	static mesh_collider_geometry fromMesh(const vec3* vertices, uint32 numVertices, const indexed_triangle32* triangles, uint32 numTriangles);
+};
+
+// The mesh is transformed by the entity's transform_component. It never moves during simulation.
+struct mesh_collider_component
+{
+	uint32 geometryIndex;
+	physics_material material;
+};
+
+#define INVALID_MESH_COLLIDER_INDEX -1
+
+// Loads all submeshes of the file into one mesh collider. The BVH is cached in the asset cache, next to the model's .bin cache, and only
+// rebuilt when the source file is newer.
+uint32 allocateMeshColliderGeometry(const std::string& meshFilepath);
+uint32 allocateMeshColliderGeometry(mesh_collider_geometry&& geometry); // Also available in the physics-only build, which can't load meshes.
+const mesh_collider_geometry& getMeshColliderGeometry(uint32 index);
+
+// Appends the collisions to out, one per colliding pair of mesh and rigid body collider. The collider pairs have INVALID_PHYSICS_INDEX as
+// the second collider, like heightmap collisions. The contact features are the indices of the triangles in the mesh geometry. Must be called after the broadphase of this frame (see broadphaseQuery). The overlap
+// buffer only holds temporary results, but is kept by the caller to avoid reallocations.
+void meshCollision(game_scene& scene, const collider_union* worldSpaceColliders, const bounding_box* worldSpaceAABBs,
+	collision_output_buffers& out, std::vector<collider_pair>& overlapBuffer, memory_arena& arena, broadphase_type broadphaseType,
+	physics_index dummyRigidBodyIndex, const bool* rbAwake = 0); // If set, colliders of sleeping rigid bodies are skipped.
+
+
+
+
+
+
+// Internal.
+
+#define MESH_COLLIDER_BVH_COUNT_BITS 3
+#define MESH_COLLIDER_BVH_INDEX_MASK ((1u << (32 - MESH_COLLIDER_BVH_COUNT_BITS)) - 1)
+
+static_assert(MESH_COLLIDER_MAX_TRIANGLES_PER_LEAF < (1 << MESH_COLLIDER_BVH_COUNT_BITS));
+
+// Widest SIMD width (see core/simd_dispatch.h). Triangle batches are padded to this.
+#define MESH_COLLISION_SIMD_PADDING 16
+
+// World space candidate triangles of one collider in structure of arrays layout. Padding triangles are degenerate and far away.
+struct mesh_triangle_batch
+{
+	float* a[3];
+	float* b[3];
+	float* c[3];
+	uint32 numTriangles; // Padded.
+};
+
+// Contacts are written for at most maxNumContacts triangles. The normal points from the shape to the mesh. The batch index of each contact's
+// triangle is written to outTriangles.
+SIMD_KERNEL_DECLARATIONS(
+	uint32 collideSphereVsTrianglesSIMD(const mesh_triangle_batch& triangles, const bounding_sphere& sphere, collision_contact* outContacts, uint32* outTriangles, uint32 maxNumContacts);
+	uint32 collideCapsuleVsTrianglesSIMD(const mesh_triangle_batch& triangles, const bounding_capsule& capsule, collision_contact* outContacts, uint32* outTriangles, uint32 maxNumContacts);
+
+	// Writes the indices of the triangles which are not separated from the oriented box on the triangle normal or the box axes. The remaining
+	// axes are left to the exact scalar tests.
+	uint32 cullTrianglesVsOBBSIMD(const mesh_triangle_batch& triangles, const bounding_oriented_box& obb, uint32* outIndices);
+)
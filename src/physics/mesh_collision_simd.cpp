@@ -0,0 +1,235 @@
+#include "pch.h"
+#include "mesh_collision.h"
+#include "core/math_simd.h"
+
+// Triangle mesh collision SIMD kernels. Compiled once per SIMD level, see core/simd_dispatch.h.
+
+namespace SIMD_ISA
+{
+
+#if defined(SIMD_AVX_512)
+#define MESH_COLLISION_SIMD_WIDTH 16
+typedef w16_float w_float;
+#elif defined(SIMD_AVX_2)
+#define MESH_COLLISION_SIMD_WIDTH 8
+typedef w8_float w_float;
+#else
+#define MESH_COLLISION_SIMD_WIDTH 4
+typedef w4_float w_float;
+#endif
+
+static_assert(MESH_COLLISION_SIMD_PADDING % MESH_COLLISION_SIMD_WIDTH == 0);
+
+typedef wN_vec3<w_float> w_vec3;
+
+static w_vec3 load(float* const* arrays, uint32 offset)
+{
+	return w_vec3(w_float(arrays[0] + offset), w_float(arrays[1] + offset), w_float(arrays[2] + offset));
+}
+
+static w_vec3 broadcast(vec3 v)
+{
+	return w_vec3(w_float(v.x), w_float(v.y), w_float(v.z));
+}
+
+// Branch free version of closestPoint_PointTriangle. All Voronoi regions are evaluated, and each one overrides the ones the scalar version
+// checks after it.
+static w_vec3 closestPointOnTriangle(w_vec3 p, w_vec3 a, w_vec3 b, w_vec3 c)
+{
+	w_float zero = w_float::zero();
+	w_float one = 1.f;
+
+	w_vec3 ab = b - a;
+	w_vec3 ac = c - a;
+
+	w_vec3 ap = p - a;
+	w_float d1 = dot(ab, ap);
+	w_float d2 = dot(ac, ap);
+
+	w_vec3 bp = p - b;
+	w_float d3 = dot(ab, bp);
+	w_float d4 = dot(ac, bp);
+
+	w_vec3 cp = p - c;
+	w_float d5 = dot(ab, cp);
+	w_float d6 = dot(ac, cp);
+
+	w_float va = d3 * d6 - d5 * d4;
+	w_float vb = d5 * d2 - d1 * d6;
+	w_float vc = d1 * d4 - d3 * d2;
+
+	// Face.
+	w_float denom = one / (va + vb + vc);
+	w_vec3 result = a + ab * (vb * denom) + ac * (vc * denom);
+
+	// Edge BC.
+	w_float d43 = d4 - d3;
+	w_float d56 = d5 - d6;
+	result = ifThen((va <= zero) & (d43 >= zero) & (d56 >= zero), b + (c - b) * (d43 / (d43 + d56)), result);
+
+	// Edge AC.
+	result = ifThen((vb <= zero) & (d2 >= zero) & (d6 <= zero), a + ac * (d2 / (d2 - d6)), result);
+
+	// Vertex C.
+	result = ifThen((d6 >= zero) & (d5 <= d6), c, result);
+
+	// Edge AB.
+	result = ifThen((vc <= zero) & (d1 >= zero) & (d3 <= zero), a + ab * (d1 / (d1 - d3)), result);
+
+	// Vertex B.
+	result = ifThen((d3 >= zero) & (d4 <= d3), b, result);
+
+	// Vertex A.
+	result = ifThen((d1 <= zero) & (d2 <= zero), a, result);
+
+	return result;
+}
+
+// Tests one sphere per lane against one triangle per lane and appends a contact for each hit. The lanes hold the triangles starting at
+// firstTriangle. Returns the new number of contacts.
+static uint32 sphereVsTriangles(w_vec3 center, w_float radius, w_vec3 a, w_vec3 b, w_vec3 c, uint32 firstTriangle,
+	collision_contact* outContacts, uint32* outTriangles, uint32 numContacts, uint32 maxNumContacts)
+{
+	w_float zero = w_float::zero();
+	w_float one = 1.f;
+
+	w_vec3 closest = closestPointOnTriangle(center, a, b, c);
+	w_vec3 n = closest - center;
+
+	w_float sqDistance = squaredLength(n);
+	int hits = toBitMask(sqDistance <= radius * radius);
+	if (!hits)
+	{
+		return numContacts;
+	}
+
+	// If the center lies on the triangle, the sphere is pushed out along the triangle normal.
+	w_float distance = sqrt(sqDistance);
+	w_vec3 triNormal = cross(b - a, c - a);
+	w_vec3 normal = ifThen(sqDistance > zero, n * (one / distance), triNormal * (-one / length(triNormal)));
+	w_float penetration = radius - distance;
+
+	alignas(64) float px[MESH_COLLISION_SIMD_WIDTH], py[MESH_COLLISION_SIMD_WIDTH], pz[MESH_COLLISION_SIMD_WIDTH];
+	alignas(64) float nx[MESH_COLLISION_SIMD_WIDTH], ny[MESH_COLLISION_SIMD_WIDTH], nz[MESH_COLLISION_SIMD_WIDTH];
+	alignas(64) float depth[MESH_COLLISION_SIMD_WIDTH];
+
+	closest.store(px, py, pz);
+	normal.store(nx, ny, nz);
+	penetration.store(depth);
+
+	while (hits && numContacts < maxNumContacts)
+	{
+		uint32 lane = indexOfLeastSignificantSetBit((uint32)hits);
+		hits &= hits - 1;
+
+		outTriangles[numContacts] = firstTriangle + lane;
+		collision_contact& contact = outContacts[numContacts++];
+		contact.point = vec3(px[lane], py[lane], pz[lane]);
+		contact.normal = vec3(nx[lane], ny[lane], nz[lane]);
+		contact.penetrationDepth = depth[lane];
+	}
+
+	return numContacts;
+}
+
+uint32 collideSphereVsTrianglesSIMD(const mesh_triangle_batch& triangles, const bounding_sphere& sphere, collision_contact* outContacts, uint32* outTriangles, uint32 maxNumContacts)
+{
+	w_vec3 center = broadcast(sphere.center);
+	w_float radius = sphere.radius;
+
+	uint32 numContacts = 0;
+	for (uint32 i = 0; i < triangles.numTriangles && numContacts < maxNumContacts; i += MESH_COLLISION_SIMD_WIDTH)
+	{
+		numContacts = sphereVsTriangles(center, radius, load(triangles.a, i), load(triangles.b, i), load(triangles.c, i), i,
+			outContacts, outTriangles, numContacts, maxNumContacts);
+	}
+	return numContacts;
+}
+
+// Like the heightmap version: The capsule axis is traced to the triangle plane, and the point of the axis closest to the triangle near
+// that intersection becomes the center of a sphere test.
+uint32 collideCapsuleVsTrianglesSIMD(const mesh_triangle_batch& triangles, const bounding_capsule& capsule, collision_contact* outContacts, uint32* outTriangles, uint32 maxNumContacts)
+{
+	w_float zero = w_float::zero();
+	w_float epsilon = 1e-12f;
+
+	vec3 axis = capsule.positionB - capsule.positionA;
+	float sqAxisLength = dot(axis, axis);
+	float invSqAxisLength = (sqAxisLength > 1e-12f) ? (1.f / sqAxisLength) : 0.f;
+
+	w_vec3 positionA = broadcast(capsule.positionA);
+	w_vec3 wideAxis = broadcast(axis);
+	w_float wideInvSqAxisLength = invSqAxisLength;
+	w_float radius = capsule.radius;
+
+	uint32 numContacts = 0;
+	for (uint32 i = 0; i < triangles.numTriangles && numContacts < maxNumContacts; i += MESH_COLLISION_SIMD_WIDTH)
+	{
+		w_vec3 a = load(triangles.a, i);
+		w_vec3 b = load(triangles.b, i);
+		w_vec3 c = load(triangles.c, i);
+
+		w_vec3 triNormal = cross(b - a, c - a);
+		w_float ndotd = dot(wideAxis, triNormal);
+
+		// Parallel axes are traced from the first endpoint.
+		w_float t = ifThen(abs(ndotd) > epsilon, dot(a - positionA, triNormal) / ndotd, zero);
+		w_vec3 trace = positionA + wideAxis * t;
+
+		w_vec3 closest = closestPointOnTriangle(trace, a, b, c);
+		w_float s = clamp01(dot(closest - positionA, wideAxis) * wideInvSqAxisLength);
+		w_vec3 reference = positionA + wideAxis * s;
+
+		numContacts = sphereVsTriangles(reference, radius, a, b, c, i, outContacts, outTriangles, numContacts, maxNumContacts);
+	}
+	return numContacts;
+}
+
+uint32 cullTrianglesVsOBBSIMD(const mesh_triangle_batch& triangles, const bounding_oriented_box& obb, uint32* outIndices)
+{
+	w_vec3 center = broadcast(obb.center);
+	w_vec3 axes[3] =
+	{
+		broadcast(obb.rotation * vec3(1.f, 0.f, 0.f)),
+		broadcast(obb.rotation * vec3(0.f, 1.f, 0.f)),
+		broadcast(obb.rotation * vec3(0.f, 0.f, 1.f)),
+	};
+	w_float radius[3] = { obb.radius.x, obb.radius.y, obb.radius.z };
+
+	uint32 numIndices = 0;
+	for (uint32 i = 0; i < triangles.numTriangles; i += MESH_COLLISION_SIMD_WIDTH)
+	{
+		w_vec3 a = load(triangles.a, i) - center;
+		w_vec3 b = load(triangles.b, i) - center;
+		w_vec3 c = load(triangles.c, i) - center;
+
+		// Triangle normal. Doesn't need to be normalized, since both sides scale the same.
+		w_vec3 n = cross(b - a, c - a);
+		w_float extent = radius[0] * abs(dot(n, axes[0])) + radius[1] * abs(dot(n, axes[1])) + radius[2] * abs(dot(n, axes[2]));
+		auto overlap = abs(dot(n, a)) <= extent;
+
+		// Box axes.
+		for (uint32 k = 0; k < 3; ++k)
+		{
+			w_float pa = dot(a, axes[k]);
+			w_float pb = dot(b, axes[k]);
+			w_float pc = dot(c, axes[k]);
+
+			w_float minP = minimum(pa, minimum(pb, pc));
+			w_float maxP = maximum(pa, maximum(pb, pc));
+
+			overlap = overlap & (minP <= radius[k]) & (maxP >= -radius[k]);
+		}
+
+		int mask = toBitMask(overlap);
+		while (mask)
+		{
+			outIndices[numIndices++] = i + indexOfLeastSignificantSetBit((uint32)mask);
+			mask &= mask - 1;
+		}
+	}
+
+	return numIndices;
+}
+
+}
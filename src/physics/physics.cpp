@@ -3,7 +3,12 @@
 #include "collision_broad.h"
 #include "collision_narrow.h"
 #include "heightmap_collision.h"
+#include "mesh_collision.h"
+#include "island.h"
+#include "physics_snapshot.h"
+#include "scene_query.h"
 #include "core/cpu_profiling.h"
+#include "core/job_system.h"
 
 #ifndef PHYSICS_ONLY
 #include "core/log.h"
@@ -16,14 +21,14 @@ static std::vector<bounding_hull_geometry> boundingHullGeometries;
 struct constraint_context
 {
 	std::vector<constraint_edge> constraintEdges;
-	uint16 firstFreeConstraintEdge = INVALID_CONSTRAINT_EDGE; // Free-list in constraintEdges array.
+	physics_index firstFreeConstraintEdge = INVALID_CONSTRAINT_EDGE; // Free-list in constraintEdges array.
 
 
 	constraint_edge& getFreeConstraintEdge()
 	{
 		if (firstFreeConstraintEdge == INVALID_CONSTRAINT_EDGE)
 		{
-			firstFreeConstraintEdge = (uint16)constraintEdges.size();
+			firstFreeConstraintEdge = (physics_index)constraintEdges.size();
 			constraintEdges.push_back(constraint_edge{ entt::null, constraint_type_none, INVALID_CONSTRAINT_EDGE, INVALID_CONSTRAINT_EDGE });
 		}
 
@@ -38,7 +43,7 @@ struct constraint_context
 
 	void freeConstraintEdge(constraint_edge& edge)
 	{
-		uint16 index = (uint16)(&edge - constraintEdges.data());
+		physics_index index = (physics_index)(&edge - constraintEdges.data());
 		edge.nextConstraintEdge = firstFreeConstraintEdge;
 		firstFreeConstraintEdge = index;
 	}
@@ -52,37 +57,96 @@ struct force_field_global_state
 #ifndef PHYSICS_ONLY
 // This is a bit dirty. PHYSICS_ONLY is defined when building the learning DLL, where we don't need bounding hulls.
 
-#include "geometry/mesh_builder.h"
 #include "asset/model_asset.h"
+#include "asset/io.h"
 
-uint32 allocateBoundingHullGeometry(const std::string& meshFilepath)
+static const uint32 BOUNDING_HULL_CACHE_HEADER = 'HULL';
+
+// Followed by the vertices, edges and faces (see readCacheFile).
+struct bounding_hull_cache_header
+{
+	uint32 header = BOUNDING_HULL_CACHE_HEADER;
+	uint32 version = 2;
+	bounding_box aabb;
+};
+
+static bool readBoundingHullCache(const fs::path& path, bounding_hull_geometry& outGeometry)
+{
+	bounding_hull_cache_header header;
+	if (!readCacheFile(path, header, outGeometry.vertices, outGeometry.edges, outGeometry.faces))
+	{
+		return false;
+	}
+
+	outGeometry.aabb = header.aabb;
+	return true;
+}
+
+static void writeBoundingHullCache(const fs::path& path, const bounding_hull_geometry& geometry)
 {
-	model_asset asset = load3DModelFromFile(meshFilepath);
+	bounding_hull_cache_header header;
+	header.aabb = geometry.aabb;
+
+	writeCacheFile(path, header, geometry.vertices, geometry.edges, geometry.faces);
+}
 
-	if (asset.meshes.empty())
+uint32 allocateBoundingHullGeometry(const std::string& meshFilepath, const bounding_hull_build_settings& settings)
+{
+	fs::path path = meshFilepath;
+	if (!fs::exists(path))
 	{
 		return INVALID_BOUNDING_HULL_INDEX;
 	}
 
-	mesh_builder builder(mesh_creation_flags_with_positions);
+	// The budget is part of the name, like the mesh flags of the model cache.
+	fs::path cachedFilename = path;
+	cachedFilename.replace_extension(".hull." + std::to_string(settings.maxNumVertices) + "." + std::to_string(settings.maxNumFaces) + "."
+		+ std::to_string(settings.coplanarTolerance) + ".cache.bin");
+	fs::path cacheFilepath = L"asset_cache" / cachedFilename;
+
+	if (fs::exists(cacheFilepath) && fs::last_write_time(cacheFilepath) > fs::last_write_time(path))
+	{
+		bounding_hull_geometry geometry;
+		if (readBoundingHullCache(cacheFilepath, geometry))
+		{
+			return allocateBoundingHullGeometry(geometry);
+		}
+	}
+
+	model_asset asset = load3DModelFromFile(path);
 
+	std::vector<vec3> points;
 	for (auto& mesh : asset.meshes)
 	{
 		for (auto& sub : mesh.submeshes)
 		{
-			builder.pushMesh(sub, 1.f);
+			points.insert(points.end(), sub.positions.begin(), sub.positions.end());
 		}
 	}
 
+	bounding_hull_geometry geometry = buildBoundingHull(points.data(), (uint32)points.size(), settings);
+	if (geometry.vertices.empty())
+	{
+		return INVALID_BOUNDING_HULL_INDEX;
+	}
+
+	writeBoundingHullCache(cacheFilepath, geometry);
+
+	return allocateBoundingHullGeometry(geometry);
+}
+#endif
+
+uint32 allocateBoundingHullGeometry(const bounding_hull_geometry& geometry)
+{
 	uint32 index = (uint32)boundingHullGeometries.size();
-	boundingHullGeometries.push_back(bounding_hull_geometry::fromMesh(
-		builder.getPositions(),
-		builder.getNumVertices(),
-		(indexed_triangle16*)builder.getTriangles(),
-		builder.getNumTriangles()));
+	boundingHullGeometries.push_back(geometry);
 	return index;
 }
-#endif
+
+const bounding_hull_geometry& getBoundingHullGeometry(uint32 index)
+{
+	return boundingHullGeometries[index];
+}
 
 static void addConstraintEdge(scene_entity& e, constraint_entity_reference_component& constraintEntityReference, entity_handle constraintEntity, constraint_type type)
 {
@@ -96,7 +160,7 @@ static void addConstraintEdge(scene_entity& e, constraint_entity_reference_compo
 	constraint_context& context = createOrGetContextVariable<constraint_context>(*e.registry);
 
 	constraint_edge& edge = context.getFreeConstraintEdge();
-	uint16 edgeIndex = (uint16)(&edge - context.constraintEdges.data());
+	physics_index edgeIndex = (physics_index)(&edge - context.constraintEdges.data());
 
 	edge.constraintEntity = constraintEntity;
 	edge.type = type;
@@ -123,6 +187,11 @@ static void addConstraintEdge(scene_entity& e, constraint_entity_reference_compo
 	}
 
 	++reference.numConstraints;
+
+	if (rigid_body_component* rb = e.getComponentIfExists<rigid_body_component>())
+	{
+		rb->wakeUp();
+	}
 }
 
 distance_constraint_handle addDistanceConstraintFromLocalPoints(scene_entity& a, scene_entity& b, vec3 localAnchorA, vec3 localAnchorB, float distance)
@@ -469,6 +538,11 @@ static void removeConstraintEdge(scene_entity entity, constraint_edge& edge, con
 	}
 
 	context.freeConstraintEdge(edge);
+
+	if (rigid_body_component* rb = entity.getComponentIfExists<rigid_body_component>())
+	{
+		rb->wakeUp();
+	}
 }
 
 static void deleteConstraint(entt::registry* registry, entity_handle constraintEntityHandle)
@@ -628,17 +702,150 @@ void testPhysicsInteraction(game_scene& scene, ray r, float strength)
 	}
 }
 
-static void getWorldSpaceColliders(game_scene& scene, bounding_box* outWorldspaceAABBs, collider_union* outWorldSpaceColliders, uint16 dummyRigidBodyIndex)
+void getWorldSpaceCollider(const collider_component& collider, const trs& transform, bounding_box& outAABB, collider_union& outCollider)
+{
+	bounding_box& bb = outAABB;
+	collider_union& col = outCollider;
+
+	col.type = collider.type;
+	col.material = collider.material;
+	col.collisionLayer = collider.collisionLayer;
+	col.collisionMask = collider.collisionMask;
+
+	switch (collider.type)
+	{
+		case collider_type_sphere:
+		{
+			vec3 center = transform.position + transform.rotation * collider.sphere.center;
+			bb = bounding_box::fromCenterRadius(center, collider.sphere.radius);
+			col.sphere = { center, collider.sphere.radius };
+		} break;
+
+		case collider_type_capsule:
+		{
+			vec3 posA = transform.rotation * collider.capsule.positionA + transform.position;
+			vec3 posB = transform.rotation * collider.capsule.positionB + transform.position;
+
+			float radius = collider.capsule.radius;
+			vec3 radius3(radius);
+
+			bb = bounding_box::negativeInfinity();
+			bb.grow(posA + radius3);
+			bb.grow(posA - radius3);
+			bb.grow(posB + radius3);
+			bb.grow(posB - radius3);
+
+			col.capsule = { posA, posB, radius };
+		} break;
+
+		case collider_type_cylinder:
+		{
+			vec3 posA = transform.rotation * collider.cylinder.positionA + transform.position;
+			vec3 posB = transform.rotation * collider.cylinder.positionB + transform.position;
+			float radius = collider.cylinder.radius;
+
+			vec3 a = posB - posA;
+			float aa = dot(a, a);
+
+			float x = 1.f - a.x * a.x / aa;
+			float y = 1.f - a.y * a.y / aa;
+			float z = 1.f - a.z * a.z / aa;
+			x = sqrt(max(0.f, x));
+			y = sqrt(max(0.f, y));
+			z = sqrt(max(0.f, z));
+
+			vec3 e = radius * vec3(x, y, z);
+
+			bb = bounding_box::fromMinMax(min(posA - e, posB - e), max(posA + e, posB + e));
+
+			col.cylinder = { posA, posB, radius };
+		} break;
+
+		case collider_type_aabb:
+		{
+			bb = collider.aabb.transformToAABB(transform.rotation, transform.position);
+			if (transform.rotation == quat::identity)
+			{
+				col.aabb = bb;
+			}
+			else
+			{
+				col.type = collider_type_obb;
+				col.obb = collider.aabb.transformToOBB(transform.rotation, transform.position);
+			}
+		} break;
+
+		case collider_type_obb:
+		{
+			bb = collider.obb.transformToAABB(transform.rotation, transform.position);
+			col.obb = collider.obb.transformToOBB(transform.rotation, transform.position);
+		} break;
+
+		case collider_type_hull:
+		{
+			const bounding_hull_geometry& geometry = boundingHullGeometries[collider.hull.geometryIndex];
+
+			quat rotation = transform.rotation * collider.hull.rotation;
+			vec3 position = transform.rotation * collider.hull.position + transform.position;
+
+			bb = geometry.aabb.transformToAABB(rotation, position);
+			col.hull.rotation = rotation;
+			col.hull.position = position;
+			col.hull.geometryPtr = &geometry;
+		} break;
+	}
+}
+
+// World space colliders of the last step, indexed like the colliders. Sleeping bodies don't move, so the world space colliders they fell asleep
+// with are reused until they wake up. The broad phase skips their updates as well.
+struct world_space_collider_cache
+{
+	std::vector<bounding_box> aabbs;
+	std::vector<collider_union> colliders;
+	std::vector<entity_handle> entities; // Collider entity of each slot.
+	std::vector<trs> transforms; // Catches sleeping bodies, which have been moved without waking them up.
+	std::vector<bool> asleep; // Computed while the body was asleep, i.e. without a swept AABB.
+
+	void resize(uint32 numColliders)
+	{
+		aabbs.resize(numColliders);
+		colliders.resize(numColliders);
+		entities.resize(numColliders, entt::null);
+		transforms.resize(numColliders);
+		asleep.resize(numColliders, false);
+	}
+};
+
+void invalidateWorldSpaceColliderCache(game_scene& scene)
+{
+	if (world_space_collider_cache* cache = scene.registry.ctx().find<world_space_collider_cache>())
+	{
+		std::fill(cache->entities.begin(), cache->entities.end(), entt::null);
+	}
+}
+
+// Writes the world space colliders and AABBs to the cache. outUnchanged is set for colliders of sleeping bodies, which have been reused from the
+// last step. Returns the number of colliders attached to continuous rigid bodies. For these, the AABB is swept along the body's motion in this
+// frame and outSpeculativeMargins holds the distance the collider may travel. For all others the margin is 0.
+static uint32 getWorldSpaceColliders(game_scene& scene, world_space_collider_cache& cache, collision_filter* outFilters,
+	float* outSpeculativeMargins, bool* outUnchanged, physics_index dummyRigidBodyIndex, float dt)
 {
 	CPU_PROFILE_BLOCK("Get world space colliders");
 
 	uint32 pushIndex = 0;
+	uint32 numContinuousColliders = 0;
 
 	for (auto [entityHandle, collider] : scene.view<collider_component>().each())
 	{
-		bounding_box& bb = outWorldspaceAABBs[pushIndex];
-		collider_union& col = outWorldSpaceColliders[pushIndex];
-		++pushIndex;
+		uint32 index = pushIndex++;
+
+		bounding_box& bb = cache.aabbs[index];
+		collider_union& col = cache.colliders[index];
+		float& speculativeMargin = outSpeculativeMargins[index];
+		outFilters[index] = { collider.collisionLayer, collider.collisionMask };
+		outUnchanged[index] = false;
+
+		speculativeMargin = 0.f;
 
 		scene_entity entity = { collider.parentEntity, scene };
 
@@ -646,22 +853,40 @@ static void getWorldSpaceColliders(game_scene& scene, bounding_box* outWorldspac
 		transform_component* transformComponent = entity.getComponentIfExists<transform_component>();
 		const trs& transform = physicsTransformComponent ? *physicsTransformComponent : transformComponent ? *transformComponent : trs::identity;
 
-		col.type = collider.type;
-		col.material = collider.material;
-
-		if (entity.hasComponent<rigid_body_component>())
+		rigid_body_component* rb = entity.getComponentIfExists<rigid_body_component>();
+		if (rb)
 		{
-			col.objectIndex = (uint16)entity.getComponentIndex<rigid_body_component>();
+			physics_index objectIndex = (physics_index)entity.getComponentIndex<rigid_body_component>();
+
+			const trs& cachedTransform = cache.transforms[index];
+			if (rb->sleeping && cache.asleep[index] && cache.entities[index] == entityHandle
+				&& cachedTransform.rotation == transform.rotation && cachedTransform.position == transform.position)
+			{
+				// Rigid body indices shift when bodies are added or removed, and the hull geometry array may have been reallocated.
+				col.objectIndex = objectIndex;
+				if (col.type == collider_type_hull)
+				{
+					col.hull.geometryPtr = &boundingHullGeometries[collider.hull.geometryIndex];
+				}
+				col.material = collider.material;
+				col.collisionLayer = collider.collisionLayer;
+				col.collisionMask = collider.collisionMask;
+
+				outUnchanged[index] = true;
+				continue;
+			}
+
+			col.objectIndex = objectIndex;
 			col.objectType = physics_object_type_rigid_body;
 		}
 		else if (entity.hasComponent<force_field_component>())
 		{
-			col.objectIndex = (uint16)entity.getComponentIndex<force_field_component>();
+			col.objectIndex = (physics_index)entity.getComponentIndex<force_field_component>();
 			col.objectType = physics_object_type_force_field;
 		}
 		else if (entity.hasComponent<trigger_component>())
 		{
-			col.objectIndex = (uint16)entity.getComponentIndex<trigger_component>();
+			col.objectIndex = (physics_index)entity.getComponentIndex<trigger_component>();
 			col.objectType = physics_object_type_trigger;
 		}
 		else
@@ -670,89 +895,34 @@ static void getWorldSpaceColliders(game_scene& scene, bounding_box* outWorldspac
 			col.objectType = physics_object_type_static_collider;
 		}
 
-		switch (collider.type)
-		{
-			case collider_type_sphere:
-			{
-				vec3 center = transform.position + transform.rotation * collider.sphere.center;
-				bb = bounding_box::fromCenterRadius(center, collider.sphere.radius);
-				col.sphere = { center, collider.sphere.radius };
-			} break;
-
-			case collider_type_capsule:
-			{
-				vec3 posA = transform.rotation * collider.capsule.positionA + transform.position;
-				vec3 posB = transform.rotation * collider.capsule.positionB + transform.position;
-
-				float radius = collider.capsule.radius;
-				vec3 radius3(radius);
-
-				bb = bounding_box::negativeInfinity();
-				bb.grow(posA + radius3);
-				bb.grow(posA - radius3);
-				bb.grow(posB + radius3);
-				bb.grow(posB - radius3);
-
-				col.capsule = { posA, posB, radius };
-			} break;
+		getWorldSpaceCollider(collider, transform, bb, col);
 
-			case collider_type_cylinder:
-			{
-				vec3 posA = transform.rotation * collider.cylinder.positionA + transform.position;
-				vec3 posB = transform.rotation * collider.cylinder.positionB + transform.position;
-				float radius = collider.cylinder.radius;
-
-				vec3 a = posB - posA;
-				float aa = dot(a, a);
-
-				float x = 1.f - a.x * a.x / aa;
-				float y = 1.f - a.y * a.y / aa;
-				float z = 1.f - a.z * a.z / aa;
-				x = sqrt(max(0.f, x));
-				y = sqrt(max(0.f, y));
-				z = sqrt(max(0.f, z));
-
-				vec3 e = radius * vec3(x, y, z);
-
-				bb = bounding_box::fromMinMax(min(posA - e, posB - e), max(posA + e, posB + e));
-
-				col.cylinder = { posA, posB, radius };
-			} break;
-
-			case collider_type_aabb:
-			{
-				bb = collider.aabb.transformToAABB(transform.rotation, transform.position);
-				if (transform.rotation == quat::identity)
-				{
-					col.aabb = bb;
-				}
-				else
-				{
-					col.type = collider_type_obb;
-					col.obb = collider.aabb.transformToOBB(transform.rotation, transform.position);
-				}
-			} break;
+		cache.entities[index] = entityHandle;
+		cache.transforms[index] = transform;
+		cache.asleep[index] = rb && rb->sleeping;
 
-			case collider_type_obb:
-			{
-				bb = collider.obb.transformToAABB(transform.rotation, transform.position);
-				col.obb = collider.obb.transformToOBB(transform.rotation, transform.position);
-			} break;
+		// Sleeping bodies have no velocity. They are excluded, so that a reused world space collider is exactly the one computed from scratch.
+		if (rb && rb->continuousCollision && rb->invMass != 0.f && !rb->sleeping)
+		{
+			// The rotation is bounded by the farthest point of the AABB from the center of gravity.
+			vec3 cog = rb->getGlobalCOGPosition(transform);
+			float extent = length(max(abs(bb.minCorner - cog), abs(bb.maxCorner - cog)));
 
-			case collider_type_hull:
-			{
-				const bounding_hull_geometry& geometry = boundingHullGeometries[collider.hull.geometryIndex];
+			vec3 linearDisplacement = rb->linearVelocity * dt;
+			float angularDisplacement = length(rb->angularVelocity) * dt * extent;
 
-				quat rotation = transform.rotation * collider.hull.rotation;
-				vec3 position = transform.rotation * collider.hull.position + transform.position;
+			bounding_box sweptBB = bb;
+			sweptBB.grow(bb.minCorner + linearDisplacement);
+			sweptBB.grow(bb.maxCorner + linearDisplacement);
+			sweptBB.pad(vec3(angularDisplacement));
+			bb = sweptBB;
 
-				bb = geometry.aabb.transformToAABB(rotation, position);
-				col.hull.rotation = rotation;
-				col.hull.position = position;
-				col.hull.geometryPtr = &geometry;
-			} break;
+			speculativeMargin = length(linearDisplacement) + angularDisplacement;
+			++numContinuousColliders;
 		}
 	}
+
+	return numContinuousColliders;
 }
 
 // Returns the accumulated force from all global force fields and writes localized forces (from force fields with colliders) in outLocalizedForceFields.
@@ -773,7 +943,7 @@ static vec3 getForceFieldStates(game_scene& scene, force_field_global_state* out
 		if (entity.hasComponent<collider_component>())
 		{
 			// Localized force field.
-			uint16 index = (uint16)entity.getComponentIndex<force_field_component>();
+			physics_index index = (physics_index)entity.getComponentIndex<force_field_component>();
 			outLocalForceFields[index].force = force;
 		}
 		else
@@ -799,154 +969,616 @@ static void getConstraintBodyPairs(game_scene& scene, constraint_body_pair* body
 
 		scene_entity rbAEntity = { reference.entityA, scene };
 		scene_entity rbBEntity = { reference.entityB, scene };
-		pair.rbA = (uint16)rbAEntity.getComponentIndex<rigid_body_component>();
-		pair.rbB = (uint16)rbBEntity.getComponentIndex<rigid_body_component>();
+		pair.rbA = (physics_index)rbAEntity.getComponentIndex<rigid_body_component>();
+		pair.rbB = (physics_index)rbBEntity.getComponentIndex<rigid_body_component>();
 	}
 }
 
-#if 0
-#define VALIDATE1(line, prefix, value) if (!isfinite(value)) { bool nan = isnan(value); std::cout << prefix << "(" << line << "): " << #value << " is " << (nan ? "NaN" : "Inf") << '\n'; }
-#define VALIDATE3(line, prefix, value) VALIDATE1(line, prefix, value.x); VALIDATE1(line, prefix, value.y); VALIDATE1(line, prefix, value.z);
-#define VALIDATE4(line, prefix, value) VALIDATE1(line, prefix, value.x); VALIDATE1(line, prefix, value.y); VALIDATE1(line, prefix, value.z); VALIDATE1(line, prefix, value.w);
+#define MAX_NUM_ISLAND_SOLVER_JOBS 32
+#define MIN_NUM_CONSTRAINTS_PER_ISLAND_SOLVER_JOB 64
 
-void validate(uint32 line, collider_union* colliders, uint32 count)
+// Address space reserved per island solver job. The largest SIMD batches take about 4KB, and in the worst case a batch holds a single constraint.
+#define ISLAND_SOLVER_ARENA_BASE_SIZE MB(4)
+#define ISLAND_SOLVER_ARENA_SIZE_PER_CONSTRAINT KB(8)
+
+// Each island solver job gets its own arena, since the constraint initialization resets the arena to markers internally, which is not thread safe.
+// The arenas are grown, when a job needs more than the reserved size.
+static memory_arena islandSolverArenas[MAX_NUM_ISLAND_SOLVER_JOBS];
+static uint64 islandSolverArenaReserveSizes[MAX_NUM_ISLAND_SOLVER_JOBS];
+
+struct island_solver_context
 {
-	for (uint32 i = 0; i < count; ++i)
+	const island_description* islands;
+	const constraint_offsets* offsets;
+
+	// Islands to solve. Islands which are asleep or have no constraints are not in this list.
+	const uint32* islandIndices;
+	uint32 numIslands;
+
+	rigid_body_global_state* rbGlobal;
+	const constraint_body_pair* allConstraintBodyPairs;
+
+	// Indexed by constraint type. The last entry are the collision contacts.
+	const void* allConstraints[constraint_type_count];
+
+	// Indexed by contact. Both may be null.
+	const contact_impulse* contactWarmStartImpulses;
+	contact_impulse* outContactImpulses;
+
+	uint32 dummyRigidBodyIndex;
+	uint32 numIterations;
+	bool simd;
+	float dt;
+};
+
+struct island_bundle
+{
+	uint32 firstIsland; // Into island_solver_context::islandIndices.
+	uint32 numIslands;
+};
+
+// The dummy may be a different one than the context's, see solveIslandsParallel.
+static void solveIslandBundle(const island_solver_context& context, island_bundle bundle, uint32 dummyRigidBodyIndex, memory_arena& arena)
+{
+	CPU_PROFILE_BLOCK("Solve island bundle");
+
+	static const uint32 constraintSizes[constraint_type_count] =
 	{
-		collider_union& c = colliders[i];
-		switch (c.type)
+		sizeof(distance_constraint),
+		sizeof(ball_constraint),
+		sizeof(fixed_constraint),
+		sizeof(hinge_constraint),
+		sizeof(cone_twist_constraint),
+		sizeof(slider_constraint),
+		sizeof(collision_contact),
+	};
+
+	const uint32* islandIndices = context.islandIndices + bundle.firstIsland;
+
+	uint32 numConstraintsPerType[constraint_type_count] = {};
+	for (uint32 i = 0; i < bundle.numIslands; ++i)
+	{
+		const uint32* typeCounts = context.islands->numConstraintsPerType + islandIndices[i] * constraint_type_count;
+		for (uint32 type = 0; type < constraint_type_count; ++type)
 		{
-			case collider_type_sphere: VALIDATE3(line, "Collider", c.sphere.center); VALIDATE1(line, "Collider", c.sphere.radius); break;
-			case collider_type_capsule: VALIDATE3(line, "Collider", c.capsule.positionA); VALIDATE3(line, "Collider", c.capsule.positionB); VALIDATE1(line, "Collider", c.capsule.radius); break;
-			case collider_type_aabb: VALIDATE3(line, "Collider", c.aabb.minCorner); VALIDATE3(line, "Collider", c.aabb.maxCorner); break;
-			case collider_type_obb: VALIDATE3(line, "Collider", c.obb.center); VALIDATE3(line, "Collider", c.obb.radius); VALIDATE4(line, "Collider", c.obb.rotation); break;
-			case collider_type_hull: break;
+			numConstraintsPerType[type] += typeCounts[type];
 		}
 	}
-}
-void validate(uint32 line, bounding_box* colliders, uint32 count)
-{
-	for (uint32 i = 0; i < count; ++i)
+
+	// Gather the constraints of all islands in this bundle into contiguous arrays.
+	uint8* constraints[constraint_type_count];
+	constraint_body_pair* bodyPairs[constraint_type_count];
+	for (uint32 type = 0; type < constraint_type_count; ++type)
 	{
-		bounding_box& c = colliders[i];
-		VALIDATE3(line, "World space BB", c.minCorner);
-		VALIDATE3(line, "World space BB", c.maxCorner);
+		constraints[type] = (uint8*)arena.allocate(constraintSizes[type] * numConstraintsPerType[type], 16);
+		bodyPairs[type] = arena.allocate<constraint_body_pair>(numConstraintsPerType[type]);
 	}
-}
-void validate(uint32 line, rigid_body_global_state* rbs, uint32 count)
-{
-	for (uint32 i = 0; i < count; ++i)
+
+	// Contact indices are needed to gather the warm start impulses and to write back the results.
+	uint32* contactIndices = arena.allocate<uint32>(numConstraintsPerType[constraint_type_collision]);
+
+	uint32 writeIndices[constraint_type_count] = {};
+	for (uint32 i = 0; i < bundle.numIslands; ++i)
 	{
-		rigid_body_global_state& r = rbs[i];
-		VALIDATE4(line, "RB update", r.rotation);
-		VALIDATE3(line, "RB update", r.localCOGPosition);
-		VALIDATE3(line, "RB update", r.position);
-		VALIDATE3(line, "RB update", r.invInertia.col0);
-		VALIDATE3(line, "RB update", r.invInertia.col1);
-		VALIDATE3(line, "RB update", r.invInertia.col2);
-		VALIDATE1(line, "RB update", r.invMass);
-		VALIDATE3(line, "RB update", r.linearVelocity);
-		VALIDATE3(line, "RB update", r.angularVelocity);
+		uint32 islandIndex = islandIndices[i];
+		const constraint_island& island = context.islands->islands[islandIndex];
+		const uint32* indices = context.islands->constraintIndices + island.startIndex;
+		const uint32* typeCounts = context.islands->numConstraintsPerType + islandIndex * constraint_type_count;
+
+		for (uint32 type = 0; type < constraint_type_count; ++type)
+		{
+			uint32 size = constraintSizes[type];
+			const uint8* source = (const uint8*)context.allConstraints[type];
+			uint32 offset = context.offsets->constraintOffsets[type];
+
+			for (uint32 j = 0; j < typeCounts[type]; ++j)
+			{
+				uint32 pairIndex = *indices++;
+				uint32 writeIndex = writeIndices[type]++;
+
+				memcpy(constraints[type] + writeIndex * size, source + (pairIndex - offset) * size, size);
+
+				constraint_body_pair pair = context.allConstraintBodyPairs[pairIndex];
+				pair.rbA = (pair.rbA == context.dummyRigidBodyIndex) ? (physics_index)dummyRigidBodyIndex : pair.rbA;
+				pair.rbB = (pair.rbB == context.dummyRigidBodyIndex) ? (physics_index)dummyRigidBodyIndex : pair.rbB;
+				bodyPairs[type][writeIndex] = pair;
+
+				if (type == constraint_type_collision)
+				{
+					contactIndices[writeIndex] = pairIndex - offset;
+				}
+			}
+		}
 	}
-}
-void validate(uint32 line, collision_contact* contacts, uint32 count)
-{
-	for (uint32 i = 0; i < count; ++i)
+
+	uint32 numContacts = numConstraintsPerType[constraint_type_collision];
+	contact_impulse* warmStartImpulses = 0;
+	if (context.contactWarmStartImpulses)
 	{
-		collision_contact& c = contacts[i];
-		VALIDATE3(line, "Contact", c.point);
-		VALIDATE1(line, "Contact", c.penetrationDepth);
-		VALIDATE3(line, "Contact", c.normal);
+		warmStartImpulses = arena.allocate<contact_impulse>(numContacts);
+		for (uint32 i = 0; i < numContacts; ++i)
+		{
+			warmStartImpulses[i] = context.contactWarmStartImpulses[contactIndices[i]];
+		}
 	}
-}
-void validate(uint32 line, collision_constraint* constraints, uint32 count)
-{
-	for (uint32 i = 0; i < count; ++i)
+
+	constraint_solver constraintSolver;
+	constraintSolver.initialize(arena, context.rbGlobal,
+		(distance_constraint*)constraints[constraint_type_distance], bodyPairs[constraint_type_distance], numConstraintsPerType[constraint_type_distance],
+		(ball_constraint*)constraints[constraint_type_ball], bodyPairs[constraint_type_ball], numConstraintsPerType[constraint_type_ball],
+		(fixed_constraint*)constraints[constraint_type_fixed], bodyPairs[constraint_type_fixed], numConstraintsPerType[constraint_type_fixed],
+		(hinge_constraint*)constraints[constraint_type_hinge], bodyPairs[constraint_type_hinge], numConstraintsPerType[constraint_type_hinge],
+		(cone_twist_constraint*)constraints[constraint_type_cone_twist], bodyPairs[constraint_type_cone_twist], numConstraintsPerType[constraint_type_cone_twist],
+		(slider_constraint*)constraints[constraint_type_slider], bodyPairs[constraint_type_slider], numConstraintsPerType[constraint_type_slider],
+		(collision_contact*)constraints[constraint_type_collision], bodyPairs[constraint_type_collision], numContacts,
+		warmStartImpulses, dummyRigidBodyIndex, context.simd, context.dt);
+
+	for (uint32 it = 0; it < context.numIterations; ++it)
 	{
-		collision_constraint& c = constraints[i];
-		VALIDATE3(line, "Collision", c.relGlobalAnchorA);
-		VALIDATE3(line, "Collision", c.relGlobalAnchorB);
-		VALIDATE3(line, "Collision", c.tangent);
-		VALIDATE3(line, "Collision", c.tangentImpulseToAngularVelocityA);
-		VALIDATE3(line, "Collision", c.tangentImpulseToAngularVelocityB);
-		VALIDATE3(line, "Collision", c.normalImpulseToAngularVelocityA);
-		VALIDATE3(line, "Collision", c.normalImpulseToAngularVelocityB);
-		VALIDATE1(line, "Collision", c.impulseInNormalDir);
-		VALIDATE1(line, "Collision", c.impulseInTangentDir);
-		VALIDATE1(line, "Collision", c.effectiveMassInNormalDir);
-		VALIDATE1(line, "Collision", c.effectiveMassInTangentDir);
-		VALIDATE1(line, "Collision", c.bias);
+		constraintSolver.solveOneIteration();
 	}
-}
-void validate(uint32 line, simd_collision_constraint_batch* constraints, uint32 count)
-{
-	for (uint32 i = 0; i < count; ++i)
+
+	if (context.outContactImpulses)
 	{
-		simd_collision_constraint_batch& c = constraints[i];
-		for (uint32 j = 0; j < CONSTRAINT_SIMD_WIDTH; ++j)
-		{
-			VALIDATE1(line, "Collision", c.relGlobalAnchorA[0][j]);
-			VALIDATE1(line, "Collision", c.relGlobalAnchorA[1][j]);
-			VALIDATE1(line, "Collision", c.relGlobalAnchorA[2][j]);
-			VALIDATE1(line, "Collision", c.relGlobalAnchorB[0][j]);
-			VALIDATE1(line, "Collision", c.relGlobalAnchorB[1][j]);
-			VALIDATE1(line, "Collision", c.relGlobalAnchorB[2][j]);
-			VALIDATE1(line, "Collision", c.normal[0][j]);
-			VALIDATE1(line, "Collision", c.normal[1][j]);
-			VALIDATE1(line, "Collision", c.normal[2][j]);
-			VALIDATE1(line, "Collision", c.tangent[0][j]);
-			VALIDATE1(line, "Collision", c.tangent[1][j]);
-			VALIDATE1(line, "Collision", c.tangent[2][j]);
-			VALIDATE1(line, "Collision", c.normalImpulseToAngularVelocityA[0][j]);
-			VALIDATE1(line, "Collision", c.normalImpulseToAngularVelocityA[1][j]);
-			VALIDATE1(line, "Collision", c.normalImpulseToAngularVelocityA[2][j]);
-			VALIDATE1(line, "Collision", c.tangentImpulseToAngularVelocityA[0][j]);
-			VALIDATE1(line, "Collision", c.tangentImpulseToAngularVelocityA[1][j]);
-			VALIDATE1(line, "Collision", c.tangentImpulseToAngularVelocityA[2][j]);
-			VALIDATE1(line, "Collision", c.normalImpulseToAngularVelocityB[0][j]);
-			VALIDATE1(line, "Collision", c.normalImpulseToAngularVelocityB[1][j]);
-			VALIDATE1(line, "Collision", c.normalImpulseToAngularVelocityB[2][j]);
-			VALIDATE1(line, "Collision", c.tangentImpulseToAngularVelocityB[0][j]);
-			VALIDATE1(line, "Collision", c.tangentImpulseToAngularVelocityB[1][j]);
-			VALIDATE1(line, "Collision", c.tangentImpulseToAngularVelocityB[2][j]);
-			VALIDATE1(line, "Collision", c.effectiveMassInNormalDir[j]);
-			VALIDATE1(line, "Collision", c.effectiveMassInTangentDir[j]);
-			VALIDATE1(line, "Collision", c.friction[j]);
-			VALIDATE1(line, "Collision", c.impulseInNormalDir[j]);
-			VALIDATE1(line, "Collision", c.impulseInTangentDir[j]);
-			VALIDATE1(line, "Collision", c.bias[j]);
+		contact_impulse* impulses = arena.allocate<contact_impulse>(numContacts);
+		constraintSolver.getContactImpulses(impulses);
+		for (uint32 i = 0; i < numContacts; ++i)
+		{
+			context.outContactImpulses[contactIndices[i]] = impulses[i];
 		}
 	}
 }
 
-#define VALIDATE(arr, count) validate(__LINE__, arr, count)
+// Islands don't share any rigid bodies, so they can be solved independently. The exception is the dummy: Its velocity stays zero, but the
+// solvers still write it back. Each job therefore gets its own dummy, which are the MAX_NUM_ISLAND_SOLVER_JOBS slots after the shared one.
+// Small islands are bundled together, so that each job has a reasonable amount of work.
+static void solveIslandsParallel(const island_solver_context& context)
+{
+	CPU_PROFILE_BLOCK("Solve islands parallel");
 
-#else
-#define VALIDATE(...)
-#endif
+	const island_description& islands = *context.islands;
+	if (context.numIslands == 0)
+	{
+		return;
+	}
 
+	uint32 totalNumConstraints = 0;
+	for (uint32 i = 0; i < context.numIslands; ++i)
+	{
+		totalNumConstraints += islands.islands[context.islandIndices[i]].count;
+	}
 
-struct entity_pair
-{
-	entity_handle a;
-	entity_handle b;
+	uint32 targetBundleSize = max(bucketize(totalNumConstraints, MAX_NUM_ISLAND_SOLVER_JOBS), (uint32)MIN_NUM_CONSTRAINTS_PER_ISLAND_SOLVER_JOB);
 
-	operator uint64() const { return ((uint64)a << 32) | (uint64)b; }
-	bool operator<(entity_pair o) const { return (uint64)*this < (uint64)o; }
-	bool operator==(entity_pair o) const { return a == o.a && b == o.b; }
-	bool operator!=(entity_pair o) const { return !(*this == o); }
-};
+	island_bundle bundles[MAX_NUM_ISLAND_SOLVER_JOBS];
+	uint32 bundleSizes[MAX_NUM_ISLAND_SOLVER_JOBS];
+	uint32 numBundles = 0;
 
-struct collision_entity_pair : entity_pair
-{
-	uint16 contactOffset;
-	uint16 numContacts;
-};
+	island_bundle current = { 0, 0 };
+	uint32 currentSize = 0;
+	for (uint32 i = 0; i < context.numIslands; ++i)
+	{
+		++current.numIslands;
+		currentSize += islands.islands[context.islandIndices[i]].count;
 
-struct event_context
-{
-	std::vector<entity_pair> prevFrameTriggerOverlaps;
-	std::vector<collision_entity_pair> prevFrameCollisions;
+		// The last bundle takes all remaining islands.
+		if (currentSize >= targetBundleSize && numBundles < MAX_NUM_ISLAND_SOLVER_JOBS - 1)
+		{
+			bundleSizes[numBundles] = currentSize;
+			bundles[numBundles++] = current;
+			current = { i + 1, 0 };
+			currentSize = 0;
+		}
+	}
+	if (current.numIslands > 0)
+	{
+		bundleSizes[numBundles] = currentSize;
+		bundles[numBundles++] = current;
+	}
+
+	for (uint32 i = 0; i < numBundles; ++i)
+	{
+		uint64 reserveSize = ISLAND_SOLVER_ARENA_BASE_SIZE + bundleSizes[i] * ISLAND_SOLVER_ARENA_SIZE_PER_CONSTRAINT;
+		if (islandSolverArenaReserveSizes[i] < reserveSize)
+		{
+			// Round up, so that slowly growing scenes don't reinitialize every frame.
+			reserveSize = alignTo(reserveSize, ISLAND_SOLVER_ARENA_BASE_SIZE * 4);
+			islandSolverArenas[i].initialize(0, reserveSize);
+			islandSolverArenaReserveSizes[i] = reserveSize;
+		}
+
+		memset(&context.rbGlobal[context.dummyRigidBodyIndex + 1 + i], 0, sizeof(rigid_body_global_state));
+	}
+
+	CPU_PROFILE_STAT("Num islands", context.numIslands);
+	CPU_PROFILE_STAT("Num island solver jobs", numBundles);
+
+	struct island_solver_job_data
+	{
+		const island_solver_context* context;
+		const island_bundle* bundles;
+		uint32 numBundles;
+	};
+
+	island_solver_job_data data = { &context, bundles, numBundles };
+
+	job_handle parentJob = highPriorityJobQueue.createJob<island_solver_job_data>([](island_solver_job_data& data, job_handle parent)
+	{
+		for (uint32 i = 0; i < data.numBundles; ++i)
+		{
+			struct island_bundle_job_data
+			{
+				const island_solver_context* context;
+				island_bundle bundle;
+				uint32 arenaIndex;
+			};
+
+			island_bundle_job_data bundleData = { data.context, data.bundles[i], i };
+
+			highPriorityJobQueue.createJob<island_bundle_job_data>([](island_bundle_job_data& data, job_handle)
+			{
+				memory_arena& arena = islandSolverArenas[data.arenaIndex];
+				solveIslandBundle(*data.context, data.bundle, data.context->dummyRigidBodyIndex + 1 + data.arenaIndex, arena);
+				arena.reset();
+			}, bundleData, parent).submitNow();
+		}
+	}, data);
+
+	parentJob.submitNow();
+	parentJob.waitForCompletion();
+}
+
+#define MAX_NUM_CLOTH_JOBS 32
+
+struct cloth_job_context
+{
+	cloth_component** cloths;
+	uint32 numCloths;
+	std::atomic<uint32> nextCloth;
+
+	vec3 windForce;
+	uint32 velocityIterations;
+	uint32 positionIterations;
+	uint32 driftIterations;
+	float dt;
+
+	cloth_collision_input* collisionInputs; // One per cloth.
+
+	memory_arena* arena;
+};
+
+static void simulateCloth(cloth_job_context& context, uint32 index)
+{
+	cloth_component& cloth = *context.cloths[index];
+	cloth.applyWindForce(context.windForce);
+	cloth.simulate(context.velocityIterations, context.positionIterations, context.driftIterations, context.dt, *context.arena,
+		&context.collisionInputs[index]);
+}
+
+// Returns false for shapes the cloth can't collide with (cylinders).
+static bool getClothCollider(const collider_union& collider, memory_arena& arena, cloth_collider& out)
+{
+	const float r = CLOTH_COLLISION_RADIUS;
+
+	switch (collider.type)
+	{
+		case collider_type_sphere:
+		{
+			out.type = cloth_collider_type_sphere;
+			out.sphere = { collider.sphere.center, collider.sphere.radius + r };
+		} return true;
+
+		case collider_type_capsule:
+		{
+			out.type = cloth_collider_type_capsule;
+			out.capsule = { collider.capsule.positionA, collider.capsule.positionB, collider.capsule.radius + r };
+		} return true;
+
+		case collider_type_aabb:
+		{
+			const bounding_box& aabb = collider.aabb;
+
+			vec4* planes = arena.allocate<vec4>(6);
+			planes[0] = vec4(1.f, 0.f, 0.f, aabb.maxCorner.x + r);
+			planes[1] = vec4(-1.f, 0.f, 0.f, -aabb.minCorner.x + r);
+			planes[2] = vec4(0.f, 1.f, 0.f, aabb.maxCorner.y + r);
+			planes[3] = vec4(0.f, -1.f, 0.f, -aabb.minCorner.y + r);
+			planes[4] = vec4(0.f, 0.f, 1.f, aabb.maxCorner.z + r);
+			planes[5] = vec4(0.f, 0.f, -1.f, -aabb.minCorner.z + r);
+
+			out.type = cloth_collider_type_planes;
+			out.planes = { planes, 6 };
+		} return true;
+
+		case collider_type_obb:
+		{
+			const bounding_oriented_box& obb = collider.obb;
+
+			vec4* planes = arena.allocate<vec4>(6);
+			for (uint32 i = 0; i < 3; ++i)
+			{
+				vec3 axis(0.f);
+				axis.data[i] = 1.f;
+				axis = obb.rotation * axis;
+
+				float center = dot(axis, obb.center);
+				planes[2 * i + 0] = vec4(axis, center + obb.radius.data[i] + r);
+				planes[2 * i + 1] = vec4(-axis, -center + obb.radius.data[i] + r);
+			}
+
+			out.type = cloth_collider_type_planes;
+			out.planes = { planes, 6 };
+		} return true;
+
+		case collider_type_hull:
+		{
+			const bounding_hull& hull = collider.hull;
+			const bounding_hull_geometry& geometry = *hull.geometryPtr;
+
+			uint32 numPlanes = (uint32)geometry.faces.size();
+			vec4* planes = arena.allocate<vec4>(numPlanes);
+			for (uint32 i = 0; i < numPlanes; ++i)
+			{
+				const bounding_hull_face& face = geometry.faces[i];
+				vec3 normal = hull.rotation * face.normal;
+				vec3 point = hull.rotation * geometry.vertices[face.a] + hull.position;
+				planes[i] = vec4(normal, dot(normal, point) + r);
+			}
+
+			out.type = cloth_collider_type_planes;
+			out.planes = { planes, numPlanes };
+		} return true;
+	}
+
+	return false;
+}
+
+// Finds the colliders near each cloth by querying the broadphase with the cloths' swept bounds, and converts them into the cloth's collision
+// input. Only rigid bodies and static colliders are collided with. The coupling is one-way: the cloths don't push the rigid bodies.
+static void prepareClothCollisions(game_scene& scene, cloth_job_context& context, const collider_union* worldSpaceColliders,
+	const bounding_box* worldSpaceAABBs, std::vector<collider_pair>& overlapBuffer, broadphase_type broadphaseType, memory_arena& arena)
+{
+	CPU_PROFILE_BLOCK("Prepare cloth collisions");
+
+	uint32 numCloths = context.numCloths;
+
+	bounding_box* clothAABBs = arena.allocate<bounding_box>(numCloths);
+	for (uint32 i = 0; i < numCloths; ++i)
+	{
+		clothAABBs[i] = context.cloths[i]->getSweptBoundingBox(context.dt);
+	}
+
+	uint32 numOverlaps = broadphaseQuery(scene, worldSpaceAABBs, clothAABBs, numCloths, arena, overlapBuffer, broadphaseType);
+	collider_pair* overlaps = overlapBuffer.data();
+
+	// Counting sort by cloth, skipping force fields and triggers.
+	uint32* offsets = arena.allocate<uint32>(numCloths + 1);
+	memset(offsets, 0, sizeof(uint32) * (numCloths + 1));
+
+	uint32 numValid = 0;
+	for (uint32 i = 0; i < numOverlaps; ++i)
+	{
+		physics_object_type type = worldSpaceColliders[overlaps[i].colliderB].objectType;
+		if (type == physics_object_type_rigid_body || type == physics_object_type_static_collider)
+		{
+			overlaps[numValid++] = overlaps[i];
+			++offsets[overlaps[i].colliderA + 1];
+		}
+	}
+
+	for (uint32 i = 0; i < numCloths; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	cloth_collider* colliders = arena.allocate<cloth_collider>(numValid);
+	uint32* counts = arena.allocate<uint32>(numCloths);
+	memset(counts, 0, sizeof(uint32) * numCloths);
+
+	for (uint32 i = 0; i < numValid; ++i)
+	{
+		uint32 cloth = overlaps[i].colliderA;
+		cloth_collider& collider = colliders[offsets[cloth] + counts[cloth]];
+		if (getClothCollider(worldSpaceColliders[overlaps[i].colliderB], arena, collider))
+		{
+			++counts[cloth];
+		}
+	}
+
+	CPU_PROFILE_STAT("Cloth collider overlaps", numValid);
+
+	uint32 numHeightmaps = scene.numberOfComponentsOfType<heightmap_collider_component>();
+	const heightmap_collider_component** heightmaps = arena.allocate<const heightmap_collider_component*>(numHeightmaps);
+
+	uint32 heightmapIndex = 0;
+	for (auto [entityHandle, heightmap] : scene.view<heightmap_collider_component>().each())
+	{
+		heightmaps[heightmapIndex++] = &heightmap;
+	}
+
+	context.collisionInputs = arena.allocate<cloth_collision_input>(numCloths);
+	for (uint32 i = 0; i < numCloths; ++i)
+	{
+		cloth_collision_input& input = context.collisionInputs[i];
+		input.bounds = clothAABBs[i];
+		input.colliders = colliders + offsets[i];
+		input.numColliders = counts[i];
+		input.heightmaps = heightmaps;
+		input.numHeightmaps = numHeightmaps;
+	}
+}
+
+// Cloths don't interact with each other, so each one is simulated by a single job. The scratch memory is allocated from the step's arena,
+// whose allocations are thread safe.
+static void simulateCloths(game_scene& scene, memory_arena& arena, vec3 windForce, const physics_settings& settings, float dt,
+	const collider_union* worldSpaceColliders, const bounding_box* worldSpaceAABBs, std::vector<collider_pair>& overlapBuffer)
+{
+	CPU_PROFILE_BLOCK("Simulate cloths");
+
+	uint32 numCloths = scene.numberOfComponentsOfType<cloth_component>();
+	if (numCloths == 0)
+	{
+		return;
+	}
+
+	cloth_job_context context;
+	context.cloths = arena.allocate<cloth_component*>(numCloths);
+	context.numCloths = numCloths;
+	context.nextCloth = 0;
+	context.windForce = windForce;
+	context.velocityIterations = settings.numClothVelocityIterations;
+	context.positionIterations = settings.numClothPositionIterations;
+	context.driftIterations = settings.numClothDriftIterations;
+	context.dt = dt;
+	context.arena = &arena;
+
+	uint32 clothIndex = 0;
+	for (auto [entityHandle, cloth] : scene.view<cloth_component>().each())
+	{
+		context.cloths[clothIndex++] = &cloth;
+	}
+
+	CPU_PROFILE_STAT("Num cloths", numCloths);
+
+	prepareClothCollisions(scene, context, worldSpaceColliders, worldSpaceAABBs, overlapBuffer, settings.broadphase, arena);
+
+	if (numCloths == 1)
+	{
+		simulateCloth(context, 0);
+		return;
+	}
+
+	struct cloth_parent_job_data
+	{
+		cloth_job_context* context;
+		uint32 numJobs;
+	};
+
+	cloth_parent_job_data data = { &context, min(numCloths, (uint32)MAX_NUM_CLOTH_JOBS) };
+
+	job_handle parentJob = highPriorityJobQueue.createJob<cloth_parent_job_data>([](cloth_parent_job_data& data, job_handle parent)
+	{
+		for (uint32 i = 0; i < data.numJobs; ++i)
+		{
+			highPriorityJobQueue.createJob<cloth_job_context*>([](cloth_job_context*& context, job_handle)
+			{
+				uint32 index;
+				while ((index = context->nextCloth++) < context->numCloths)
+				{
+					simulateCloth(*context, index);
+				}
+			}, data.context, parent).submitNow();
+		}
+	}, data);
+
+	parentJob.submitNow();
+	parentJob.waitForCompletion();
+}
+
+
+#if 0
+#define VALIDATE1(line, prefix, value) if (!isfinite(value)) { bool nan = isnan(value); std::cout << prefix << "(" << line << "): " << #value << " is " << (nan ? "NaN" : "Inf") << '\n'; }
+#define VALIDATE3(line, prefix, value) VALIDATE1(line, prefix, value.x); VALIDATE1(line, prefix, value.y); VALIDATE1(line, prefix, value.z);
+#define VALIDATE4(line, prefix, value) VALIDATE1(line, prefix, value.x); VALIDATE1(line, prefix, value.y); VALIDATE1(line, prefix, value.z); VALIDATE1(line, prefix, value.w);
+
+void validate(uint32 line, collider_union* colliders, uint32 count)
+{
+	for (uint32 i = 0; i < count; ++i)
+	{
+		collider_union& c = colliders[i];
+		switch (c.type)
+		{
+			case collider_type_sphere: VALIDATE3(line, "Collider", c.sphere.center); VALIDATE1(line, "Collider", c.sphere.radius); break;
+			case collider_type_capsule: VALIDATE3(line, "Collider", c.capsule.positionA); VALIDATE3(line, "Collider", c.capsule.positionB); VALIDATE1(line, "Collider", c.capsule.radius); break;
+			case collider_type_aabb: VALIDATE3(line, "Collider", c.aabb.minCorner); VALIDATE3(line, "Collider", c.aabb.maxCorner); break;
+			case collider_type_obb: VALIDATE3(line, "Collider", c.obb.center); VALIDATE3(line, "Collider", c.obb.radius); VALIDATE4(line, "Collider", c.obb.rotation); break;
+			case collider_type_hull: break;
+		}
+	}
+}
+void validate(uint32 line, bounding_box* colliders, uint32 count)
+{
+	for (uint32 i = 0; i < count; ++i)
+	{
+		bounding_box& c = colliders[i];
+		VALIDATE3(line, "World space BB", c.minCorner);
+		VALIDATE3(line, "World space BB", c.maxCorner);
+	}
+}
+void validate(uint32 line, rigid_body_global_state* rbs, uint32 count)
+{
+	for (uint32 i = 0; i < count; ++i)
+	{
+		rigid_body_global_state& r = rbs[i];
+		VALIDATE4(line, "RB update", r.rotation);
+		VALIDATE3(line, "RB update", r.localCOGPosition);
+		VALIDATE3(line, "RB update", r.position);
+		VALIDATE3(line, "RB update", r.invInertia.col0);
+		VALIDATE3(line, "RB update", r.invInertia.col1);
+		VALIDATE3(line, "RB update", r.invInertia.col2);
+		VALIDATE1(line, "RB update", r.invMass);
+		VALIDATE3(line, "RB update", r.linearVelocity);
+		VALIDATE3(line, "RB update", r.angularVelocity);
+	}
+}
+void validate(uint32 line, collision_contact* contacts, uint32 count)
+{
+	for (uint32 i = 0; i < count; ++i)
+	{
+		collision_contact& c = contacts[i];
+		VALIDATE3(line, "Contact", c.point);
+		VALIDATE1(line, "Contact", c.penetrationDepth);
+		VALIDATE3(line, "Contact", c.normal);
+	}
+}
+void validate(uint32 line, collision_constraint* constraints, uint32 count)
+{
+	for (uint32 i = 0; i < count; ++i)
+	{
+		collision_constraint& c = constraints[i];
+		VALIDATE3(line, "Collision", c.relGlobalAnchorA);
+		VALIDATE3(line, "Collision", c.relGlobalAnchorB);
+		VALIDATE3(line, "Collision", c.tangent);
+		VALIDATE3(line, "Collision", c.tangentImpulseToAngularVelocityA);
+		VALIDATE3(line, "Collision", c.tangentImpulseToAngularVelocityB);
+		VALIDATE3(line, "Collision", c.normalImpulseToAngularVelocityA);
+		VALIDATE3(line, "Collision", c.normalImpulseToAngularVelocityB);
+		VALIDATE1(line, "Collision", c.impulseInNormalDir);
+		VALIDATE1(line, "Collision", c.impulseInTangentDir);
+		VALIDATE1(line, "Collision", c.effectiveMassInNormalDir);
+		VALIDATE1(line, "Collision", c.effectiveMassInTangentDir);
+		VALIDATE1(line, "Collision", c.bias);
+	}
+}
+
+#define VALIDATE(arr, count) validate(__LINE__, arr, count)
+
+#else
+#define VALIDATE(...)
+#endif
+
+
+struct entity_pair
+{
+	entity_handle a;
+	entity_handle b;
+
+	operator uint64() const { return ((uint64)a << 32) | (uint64)b; }
+	bool operator<(entity_pair o) const { return (uint64)*this < (uint64)o; }
+	bool operator==(entity_pair o) const { return a == o.a && b == o.b; }
+	bool operator!=(entity_pair o) const { return !(*this == o); }
+};
+
+struct collision_entity_pair : entity_pair
+{
+	uint32 contactOffset;
+	uint32 numContacts;
+};
+
+struct event_context
+{
+	std::vector<entity_pair> prevFrameTriggerOverlaps;
+	std::vector<collision_entity_pair> prevFrameCollisions;
 };
 
 static void handleNonCollisionInteractions(game_scene& scene, 
@@ -1034,13 +1666,26 @@ static void handleNonCollisionInteractions(game_scene& scene,
 	context.prevFrameTriggerOverlaps = std::move(triggerOverlaps);
 }
 
+static bool isColliderAsleep(game_scene& scene, entity_handle colliderEntityHandle)
+{
+	const collider_component* collider = scene.registry.try_get<collider_component>(colliderEntityHandle);
+	if (!collider)
+	{
+		return false;
+	}
+
+	// Static colliders count as asleep.
+	const rigid_body_component* rb = scene.registry.try_get<rigid_body_component>(collider->parentEntity);
+	return !rb || rb->sleeping;
+}
+
 static void handleCollisionCallbacks(game_scene& scene, const collider_pair* colliderPairs, uint8* contactCountPerCollision, uint32 numColliderPairs,
 	uint32 numColliders, const collision_contact* contacts, const rigid_body_global_state* rbGlobal, uint32 dummyRigidBodyIndex,
-	const collision_begin_event_func& collisionBeginCallback, const collision_end_event_func& collisionEndCallback)
+	bool sleepingEnabled, const collision_begin_event_func& collisionBeginCallback, const collision_end_event_func& collisionEndCallback)
 {
 	std::vector<collision_entity_pair> collisions;
 
-	uint16 contactOffset = 0;
+	uint32 contactOffset = 0;
 
 	for (uint32 i = 0; i < numColliderPairs; ++i)
 	{
@@ -1048,22 +1693,46 @@ static void handleCollisionCallbacks(game_scene& scene, const collider_pair* col
 
 		if (colliderPair.colliderB < numColliders)
 		{
-			uint16 numContacts = contactCountPerCollision[i];
+			uint32 numContacts = contactCountPerCollision[i];
+
+			// Speculative contacts (from continuous collision detection) are not touching yet, so they don't generate events.
+			bool touching = false;
+			for (uint32 j = 0; j < numContacts; ++j)
+			{
+				touching |= (contacts[contactOffset + j].penetrationDepth >= 0.f);
+			}
 
-			scene_entity aEntity = scene.getEntityFromComponentAtIndex<collider_component>(numColliders - 1 - colliderPair.colliderA);
-			scene_entity bEntity = scene.getEntityFromComponentAtIndex<collider_component>(numColliders - 1 - colliderPair.colliderB);
+			if (touching)
+			{
+				scene_entity aEntity = scene.getEntityFromComponentAtIndex<collider_component>(numColliders - 1 - colliderPair.colliderA);
+				scene_entity bEntity = scene.getEntityFromComponentAtIndex<collider_component>(numColliders - 1 - colliderPair.colliderB);
 
-			collision_entity_pair overlap = { aEntity.handle, bEntity.handle, contactOffset, numContacts };
+				collision_entity_pair overlap = { aEntity.handle, bEntity.handle, contactOffset, numContacts };
 
-			collisions.push_back(overlap);
+				collisions.push_back(overlap);
+			}
 			contactOffset += numContacts;
 		}
 	}
 
-	std::sort(collisions.begin(), collisions.end());
-
 	event_context& context = scene.createOrGetContextVariable<event_context>();
 
+	if (sleepingEnabled)
+	{
+		// Colliders which are both asleep are not tested against each other. Their collisions persist, so that no end events are sent.
+		for (collision_entity_pair pair : context.prevFrameCollisions)
+		{
+			if (isColliderAsleep(scene, pair.a) && isColliderAsleep(scene, pair.b))
+			{
+				pair.contactOffset = 0;
+				pair.numContacts = 0;
+				collisions.push_back(pair);
+			}
+		}
+	}
+
+	std::sort(collisions.begin(), collisions.end());
+
 	if (collisionBeginCallback || collisionEndCallback)
 	{
 		auto prevIterator = context.prevFrameCollisions.begin();
@@ -1177,7 +1846,479 @@ static void handleCollisionCallbacks(game_scene& scene, const collider_pair* col
 	context.prevFrameCollisions = std::move(collisions);
 }
 
-static void physicsStepInternal(game_scene& scene, memory_arena& arena, const physics_settings& settings, float dt)
+struct cached_contact
+{
+	vec3 localPoint; // In the local space of rigid body A.
+	uint32 feature; // See contactFeature and collision_output_buffers::contactFeatures. 0 if the collision routine reports no features.
+	contact_impulse impulse;
+};
+
+struct cached_contact_manifold
+{
+	entity_pair colliders;
+	uint32 firstContact;
+	uint32 numContacts;
+};
+
+// Contacts and their accumulated impulses from the last frame. Used to warm start the solver.
+struct contact_cache
+{
+	std::vector<cached_contact_manifold> manifolds; // Sorted by collider pair.
+	std::vector<cached_contact> contacts;
+};
+
+static entity_pair getCollidingEntities(game_scene& scene, collider_pair colliderPair, uint32 numColliders, entity_handle otherEntity)
+{
+	entity_handle a = scene.getEntityFromComponentAtIndex<collider_component>(numColliders - 1 - colliderPair.colliderA).handle;
+
+	// Heightmap and mesh collisions don't have a second collider, so they are keyed by the object they collided with.
+	entity_handle b = otherEntity;
+	if (colliderPair.colliderB < numColliders)
+	{
+		b = scene.getEntityFromComponentAtIndex<collider_component>(numColliders - 1 - colliderPair.colliderB).handle;
+	}
+
+	return { a, b };
+}
+
+// Matches this frame's contacts to last frame's contacts of the same collider pair and returns their accumulated impulses.
+// Box contacts carry the features they were clipped from (see contactFeature) and are matched by feature alone, so they keep their impulse
+// while sliding. Contacts without a feature are matched by their position relative to body A. Heightmap and mesh contacts additionally have
+// to come from the same triangle, since neighboring triangles produce contacts close to each other. Each cached contact is used at most once.
+// The heightmap and mesh collisions are the last ones in the arrays.
+static void getContactWarmStartImpulses(game_scene& scene, const collider_pair* colliderPairs, const uint8* contactCountPerCollision, uint32 numCollisions, uint32 numColliders,
+	const collision_contact* contacts, const constraint_body_pair* bodyPairs, const uint32* contactFeatures, const rigid_body_global_state* rbGlobal, uint32 dummyRigidBodyIndex,
+	const collision_output_buffers& heightmapCollisions,
+	entity_pair* outCollidingEntities, vec3* outLocalContactPoints, contact_impulse* outWarmStartImpulses)
+{
+	CPU_PROFILE_BLOCK("Get contact warm start impulses");
+
+	// Contacts which moved farther than this relative to body A are considered new.
+	const float maxMatchDistance = 0.02f;
+
+	contact_cache& cache = scene.createOrGetContextVariable<contact_cache>();
+
+	uint32 firstHeightmapCollision = numCollisions - (uint32)heightmapCollisions.colliderPairs.size();
+
+	uint32 contactOffset = 0;
+	for (uint32 i = 0; i < numCollisions; ++i)
+	{
+		uint32 numContacts = contactCountPerCollision[i];
+		bool isHeightmapCollision = i >= firstHeightmapCollision;
+
+		entity_handle otherEntity = isHeightmapCollision ? heightmapCollisions.otherEntities[i - firstHeightmapCollision] : entt::null;
+		entity_pair colliders = getCollidingEntities(scene, colliderPairs[i], numColliders, otherEntity);
+		outCollidingEntities[i] = colliders;
+
+		const cached_contact* cachedContacts = 0;
+		uint32 numCachedContacts = 0;
+
+		auto it = std::lower_bound(cache.manifolds.begin(), cache.manifolds.end(), colliders,
+			[](const cached_contact_manifold& manifold, entity_pair pair) { return manifold.colliders < pair; });
+		if (it != cache.manifolds.end() && it->colliders == colliders)
+		{
+			cachedContacts = cache.contacts.data() + it->firstContact;
+			numCachedContacts = it->numContacts;
+		}
+
+		bool cachedContactUsed[256] = {}; // Contact counts are stored as uint8.
+
+		for (uint32 j = contactOffset; j < contactOffset + numContacts; ++j)
+		{
+			physics_index rbA = bodyPairs[j].rbA;
+
+			vec3 localPoint = contacts[j].point;
+			if (rbA != dummyRigidBodyIndex)
+			{
+				localPoint = conjugate(rbGlobal[rbA].rotation) * (localPoint - rbGlobal[rbA].position);
+			}
+			outLocalContactPoints[j] = localPoint;
+
+			uint32 feature = contactFeatures[j];
+			bool matchByFeature = !isHeightmapCollision && feature != 0;
+
+			uint32 match = numCachedContacts;
+			float closestDistance2 = maxMatchDistance * maxMatchDistance;
+			for (uint32 k = 0; k < numCachedContacts; ++k)
+			{
+				if (cachedContactUsed[k] || cachedContacts[k].feature != feature)
+				{
+					continue;
+				}
+
+				if (matchByFeature)
+				{
+					match = k;
+					break;
+				}
+
+				float distance2 = squaredLength(cachedContacts[k].localPoint - localPoint);
+				if (distance2 < closestDistance2)
+				{
+					closestDistance2 = distance2;
+					match = k;
+				}
+			}
+
+			contact_impulse impulse = { vec3(0.f), 0.f };
+			if (match < numCachedContacts)
+			{
+				cachedContactUsed[match] = true;
+				impulse = cachedContacts[match].impulse;
+			}
+			outWarmStartImpulses[j] = impulse;
+		}
+
+		contactOffset += numContacts;
+	}
+}
+
+// Heightmaps and meshes are keyed by their own entity, which has no collider. They never move, so they count as asleep, just like static colliders.
+static bool isContactEntityAsleep(game_scene& scene, entity_handle entityHandle)
+{
+	if (!scene.registry.valid(entityHandle))
+	{
+		return false;
+	}
+
+	const collider_component* collider = scene.registry.try_get<collider_component>(entityHandle);
+	if (!collider)
+	{
+		return true;
+	}
+
+	const rigid_body_component* rb = scene.registry.try_get<rigid_body_component>(collider->parentEntity);
+	return !rb || rb->sleeping;
+}
+
+// Sleeping islands are not collided, so the manifolds between sleeping or static colliders are kept until the island wakes up again. 
+// The woken bodies then start from the impulses they fell asleep with.
+static void updateContactCache(game_scene& scene, const entity_pair* collidingEntities, const uint8* contactCountPerCollision, uint32 numCollisions,
+	const vec3* localContactPoints, const uint32* contactFeatures, const contact_impulse* contactImpulses, bool keepSleepingManifolds, memory_arena& arena)
+{
+	CPU_PROFILE_BLOCK("Update contact cache");
+
+	contact_cache& cache = scene.createOrGetContextVariable<contact_cache>();
+
+	memory_marker marker = arena.getMarker();
+
+	cached_contact_manifold* sleepingManifolds = 0;
+	cached_contact* sleepingContacts = 0;
+	uint32 numSleepingManifolds = 0;
+	uint32 numSleepingContacts = 0;
+
+	if (keepSleepingManifolds)
+	{
+		sleepingManifolds = arena.allocate<cached_contact_manifold>(cache.manifolds.size());
+		sleepingContacts = arena.allocate<cached_contact>(cache.contacts.size());
+
+		for (const cached_contact_manifold& manifold : cache.manifolds)
+		{
+			if (isContactEntityAsleep(scene, manifold.colliders.a) && isContactEntityAsleep(scene, manifold.colliders.b))
+			{
+				sleepingManifolds[numSleepingManifolds++] = { manifold.colliders, numSleepingContacts, manifold.numContacts };
+				memcpy(sleepingContacts + numSleepingContacts, cache.contacts.data() + manifold.firstContact, sizeof(cached_contact) * manifold.numContacts);
+				numSleepingContacts += manifold.numContacts;
+			}
+		}
+	}
+
+	cache.manifolds.clear();
+	cache.contacts.clear();
+
+	uint32 contactOffset = 0;
+	for (uint32 i = 0; i < numCollisions; ++i)
+	{
+		uint32 numContacts = contactCountPerCollision[i];
+		cache.manifolds.push_back({ collidingEntities[i], contactOffset, numContacts });
+
+		for (uint32 j = contactOffset; j < contactOffset + numContacts; ++j)
+		{
+			cache.contacts.push_back({ localContactPoints[j], contactFeatures[j], contactImpulses[j] });
+		}
+
+		contactOffset += numContacts;
+	}
+
+	for (uint32 i = 0; i < numSleepingManifolds; ++i)
+	{
+		cached_contact_manifold manifold = sleepingManifolds[i];
+		manifold.firstContact += contactOffset;
+		cache.manifolds.push_back(manifold);
+	}
+	cache.contacts.insert(cache.contacts.end(), sleepingContacts, sleepingContacts + numSleepingContacts);
+
+	std::sort(cache.manifolds.begin(), cache.manifolds.end(), 
+		[](const cached_contact_manifold& a, const cached_contact_manifold& b) { return a.colliders < b.colliders; });
+
+	arena.resetToMarker(marker);
+}
+
+void serializeContactState(game_scene& scene, physics_snapshot_stream& stream)
+{
+	contact_cache& cache = scene.createOrGetContextVariable<contact_cache>();
+	stream.vector(cache.manifolds);
+	stream.vector(cache.contacts);
+
+	narrowphase_cache& features = scene.createOrGetContextVariable<narrowphase_cache>();
+	stream.vector(features.entries);
+
+	event_context& events = scene.createOrGetContextVariable<event_context>();
+	stream.vector(events.prevFrameTriggerOverlaps);
+	stream.vector(events.prevFrameCollisions);
+}
+
+// Removes broadphase overlaps between colliders, which are both asleep or static.
+static uint32 removeSleepingOverlaps(const collider_union* worldSpaceColliders, collider_pair* overlaps, uint32 numOverlaps, const bool* rbAwake)
+{
+	CPU_PROFILE_BLOCK("Remove sleeping overlaps");
+
+	auto isActive = [worldSpaceColliders, rbAwake](physics_index colliderIndex)
+	{
+		const collider_union& collider = worldSpaceColliders[colliderIndex];
+		return (collider.objectType == physics_object_type_rigid_body) ? rbAwake[collider.objectIndex] : (collider.objectType != physics_object_type_static_collider);
+	};
+
+	uint32 numActiveOverlaps = 0;
+	for (uint32 i = 0; i < numOverlaps; ++i)
+	{
+		collider_pair overlap = overlaps[i];
+		if (isActive(overlap.colliderA) || isActive(overlap.colliderB))
+		{
+			overlaps[numActiveOverlaps++] = overlap;
+		}
+	}
+	return numActiveOverlaps;
+}
+
+// Wakes up disturbed bodies (the user applied forces, changed their velocities or their constraints) and everything that fell asleep together
+// with them. This runs before the collision detection, so a woken island is complete again, with all the contacts supporting it. 
+// Returns the number of bodies which are still asleep.
+static uint32 wakeUpDisturbedIslands(game_scene& scene, bool* rbAwake, uint32 numRigidBodies, bool sleepingEnabled, memory_arena& arena)
+{
+	CPU_PROFILE_BLOCK("Wake up disturbed islands");
+
+	memory_marker marker = arena.getMarker();
+
+	entity_handle* wokenIslands = arena.allocate<entity_handle>(numRigidBodies);
+	uint32 numWokenIslands = 0;
+
+	auto group = scene.group<rigid_body_component, physics_transform1_component>();
+
+	for (auto [entityHandle, rb, transform] : group.each())
+	{
+		if (rb.sleeping)
+		{
+			bool disturbed = rb.forceAccumulator != vec3(0.f) || rb.torqueAccumulator != vec3(0.f)
+				|| rb.linearVelocity != vec3(0.f) || rb.angularVelocity != vec3(0.f);
+			if (disturbed || !sleepingEnabled)
+			{
+				rb.wakeUp();
+			}
+		}
+
+		if (!rb.sleeping && rb.sleepIsland != entt::null)
+		{
+			wokenIslands[numWokenIslands++] = rb.sleepIsland;
+			rb.sleepIsland = entt::null;
+		}
+	}
+
+	std::sort(wokenIslands, wokenIslands + numWokenIslands);
+
+	uint32 numSleepingRigidBodies = 0;
+	uint32 rbIndex = numRigidBodies - 1; // EnTT iterates back to front.
+	for (auto [entityHandle, rb, transform] : group.each())
+	{
+		if (rb.sleeping && std::binary_search(wokenIslands, wokenIslands + numWokenIslands, rb.sleepIsland))
+		{
+			rb.wakeUp();
+			rb.sleepIsland = entt::null;
+		}
+
+		rbAwake[rbIndex--] = !rb.sleeping;
+		numSleepingRigidBodies += rb.sleeping;
+	}
+
+	arena.resetToMarker(marker);
+
+	return numSleepingRigidBodies;
+}
+
+// Writes the indices of all islands with constraints, which contain at least one awake body, to outIslandsToSolve. Sleeping bodies in these
+// islands are touched by something awake. They take part in the solve as static bodies and are marked in outRBsToWakeUp. They (and everything 
+// that fell asleep with them) are woken up at the start of the next step, before the collision detection.
+static uint32 getAwakeIslands(const island_description& islands, const bool* rbAwake, bool* outRBsToWakeUp, uint32* outIslandsToSolve)
+{
+	CPU_PROFILE_BLOCK("Get awake islands");
+
+	uint32 numIslandsToSolve = 0;
+	uint32 numSleepingIslands = 0;
+
+	for (uint32 i = 0; i < islands.numIslands; ++i)
+	{
+		const constraint_island& island = islands.islands[i];
+		const physics_index* bodyIndices = islands.bodyIndices + island.bodyStartIndex;
+
+		bool awake = false;
+		for (uint32 j = 0; j < island.numBodies; ++j)
+		{
+			awake |= rbAwake[bodyIndices[j]];
+		}
+
+		if (!awake)
+		{
+			++numSleepingIslands;
+			continue;
+		}
+
+		for (uint32 j = 0; j < island.numBodies; ++j)
+		{
+			physics_index rbIndex = bodyIndices[j];
+			if (!rbAwake[rbIndex])
+			{
+				outRBsToWakeUp[rbIndex] = true;
+			}
+		}
+
+		if (island.count > 0)
+		{
+			outIslandsToSolve[numIslandsToSolve++] = i;
+		}
+	}
+
+	CPU_PROFILE_STAT("Num sleeping islands", numSleepingIslands);
+
+	return numIslandsToSolve;
+}
+
+// Motors drive the bodies from the outside, so islands with active motors are never put to sleep.
+static bool islandHasActiveMotor(const island_description& islands, uint32 islandIndex, const constraint_offsets& offsets,
+	const hinge_constraint* hingeConstraints, const cone_twist_constraint* coneTwistConstraints, const slider_constraint* sliderConstraints)
+{
+	const constraint_island& island = islands.islands[islandIndex];
+	const uint32* indices = islands.constraintIndices + island.startIndex;
+
+	for (uint32 i = 0; i < island.count; ++i)
+	{
+		uint32 pairIndex = indices[i];
+		if (pairIndex >= offsets.constraintOffsets[constraint_type_collision])
+		{
+			break; // Sorted, so only contacts follow.
+		}
+
+		if (pairIndex >= offsets.constraintOffsets[constraint_type_slider])
+		{
+			const slider_constraint& c = sliderConstraints[pairIndex - offsets.constraintOffsets[constraint_type_slider]];
+			if (c.maxMotorForce > 0.f) { return true; }
+		}
+		else if (pairIndex >= offsets.constraintOffsets[constraint_type_cone_twist])
+		{
+			const cone_twist_constraint& c = coneTwistConstraints[pairIndex - offsets.constraintOffsets[constraint_type_cone_twist]];
+			if (c.maxSwingMotorTorque > 0.f || c.maxTwistMotorTorque > 0.f) { return true; }
+		}
+		else if (pairIndex >= offsets.constraintOffsets[constraint_type_hinge])
+		{
+			const hinge_constraint& c = hingeConstraints[pairIndex - offsets.constraintOffsets[constraint_type_hinge]];
+			if (c.maxMotorTorque > 0.f) { return true; }
+		}
+	}
+
+	return false;
+}
+
+static void putIslandsToSleep(game_scene& scene, const island_description& islands, const constraint_offsets& offsets, uint32 numRigidBodies,
+	const hinge_constraint* hingeConstraints, const cone_twist_constraint* coneTwistConstraints, const slider_constraint* sliderConstraints,
+	float sleepTime)
+{
+	CPU_PROFILE_BLOCK("Put islands to sleep");
+
+	for (uint32 i = 0; i < islands.numIslands; ++i)
+	{
+		const constraint_island& island = islands.islands[i];
+		const physics_index* bodyIndices = islands.bodyIndices + island.bodyStartIndex;
+
+		bool canSleep = true;
+		for (uint32 j = 0; j < island.numBodies && canSleep; ++j)
+		{
+			const rigid_body_component& rb = scene.getComponentAtIndex<rigid_body_component>(numRigidBodies - 1 - bodyIndices[j]);
+			canSleep = !rb.sleeping && rb.sleepTimer >= sleepTime;
+		}
+
+		if (!canSleep || islandHasActiveMotor(islands, i, offsets, hingeConstraints, coneTwistConstraints, sliderConstraints))
+		{
+			continue;
+		}
+
+		entity_handle representative = scene.getEntityFromComponentAtIndex<rigid_body_component>(numRigidBodies - 1 - bodyIndices[0]).handle;
+		for (uint32 j = 0; j < island.numBodies; ++j)
+		{
+			rigid_body_component& rb = scene.getComponentAtIndex<rigid_body_component>(numRigidBodies - 1 - bodyIndices[j]);
+			rb.sleeping = true;
+			rb.sleepIsland = representative;
+			rb.linearVelocity = vec3(0.f);
+			rb.angularVelocity = vec3(0.f);
+		}
+	}
+}
+
+// Buffers whose size is only known after the fact. They are kept around between steps, so they only reallocate when the number of
+// overlaps grows. Everything else in the step is allocated from the arena, once the broad phase has determined the number of overlaps.
+struct collision_buffer_context
+{
+	std::vector<collider_pair> overlappingColliderPairs;
+	collision_output_buffers heightmapCollisions;
+	std::vector<collider_pair> clothOverlaps;
+	std::vector<collider_pair> meshOverlaps;
+};
+
+struct physics_state_hash_context
+{
+	uint64 hash = 0;
+};
+
+static_assert(sizeof(rigid_body_global_state) == 26 * sizeof(float), "The state hash assumes that the global state is tightly packed.");
+
+// FNV-1a over the bit patterns of the solver state and the integrated transforms. Both are hashed, since the global state is computed before
+// integration, and a divergence in the integration would otherwise only show up in the next step.
+static uint64 hashRigidBodyStates(game_scene& scene, const rigid_body_global_state* rbGlobal, uint32 numRigidBodies)
+{
+	CPU_PROFILE_BLOCK("Hash rigid body states");
+
+	const uint64 prime = 0x100000001B3ull;
+	uint64 hash = 0xCBF29CE484222325ull;
+
+	const uint32* words = (const uint32*)rbGlobal;
+	uint32 numWords = numRigidBodies * (sizeof(rigid_body_global_state) / sizeof(uint32));
+	for (uint32 i = 0; i < numWords; ++i)
+	{
+		hash = (hash ^ words[i]) * prime;
+	}
+
+	for (auto [entityHandle, rb, transform] : scene.group<rigid_body_component, physics_transform1_component>().each())
+	{
+		const uint32* rotation = (const uint32*)&transform.rotation;
+		const uint32* position = (const uint32*)&transform.position;
+		for (uint32 i = 0; i < 4; ++i) { hash = (hash ^ rotation[i]) * prime; }
+		for (uint32 i = 0; i < 3; ++i) { hash = (hash ^ position[i]) * prime; }
+	}
+
+	return hash;
+}
+
+uint64 getPhysicsStateHash(game_scene& scene)
+{
+	physics_state_hash_context* context = scene.tryGetContextVariable<physics_state_hash_context>();
+	return context ? context->hash : 0;
+}
+
+void serializeStateHash(game_scene& scene, physics_snapshot_stream& stream)
+{
+	physics_state_hash_context& context = scene.createOrGetContextVariable<physics_state_hash_context>();
+	stream.value(context.hash);
+}
+
+static void physicsStepInternal(game_scene& scene, memory_arena& arena, const physics_settings& settings, float dt)
 {
 	CPU_PROFILE_BLOCK("Physics step");
 
@@ -1200,51 +2341,103 @@ static void physicsStepInternal(game_scene& scene, memory_arena& arena, const ph
 	uint32 numSliderConstraints = scene.numberOfComponentsOfType<slider_constraint>();
 	uint32 numConstraints = numDistanceConstraints + numBallConstraints + numFixedConstraints + numHingeConstraints + numConeTwistConstraints + numSliderConstraints;
 
+	// The dummy rigid body takes one index, plus one per job for the parallel island solver. Larger scenes require PHYSICS_32BIT_INDICES
+	// (see physics_index.h).
+	uint32 numDummyRigidBodies = settings.parallelIslandSolver ? (1 + MAX_NUM_ISLAND_SOLVER_JOBS) : 1;
+	ASSERT(numRigidBodies + numDummyRigidBodies < MAX_NUM_PHYSICS_OBJECTS);
+	ASSERT(numColliders < MAX_NUM_PHYSICS_OBJECTS);
 
 
 	memory_marker marker = arena.getMarker();
 
-	rigid_body_global_state* rbGlobal = arena.allocate<rigid_body_global_state>(numRigidBodies + 1); // Reserve one slot for dummy.
+	rigid_body_global_state* rbGlobal = arena.allocate<rigid_body_global_state>(numRigidBodies + numDummyRigidBodies); // Reserve slots for dummies.
 	force_field_global_state* ffGlobal = arena.allocate<force_field_global_state>(numForceFields);
-	bounding_box* worldSpaceAABBs = arena.allocate<bounding_box>(numColliders);
-	collider_union* worldSpaceColliders = arena.allocate<collider_union>(numColliders);
 
-	collider_pair* overlappingColliderPairs = arena.allocate<collider_pair>(numColliders * numColliders + 5000); // Conservative estimate.
+	world_space_collider_cache& worldSpaceColliderCache = scene.createOrGetContextVariable<world_space_collider_cache>();
+	worldSpaceColliderCache.resize(numColliders);
+	bounding_box* worldSpaceAABBs = worldSpaceColliderCache.aabbs.data();
+	collider_union* worldSpaceColliders = worldSpaceColliderCache.colliders.data();
+
+	collision_buffer_context& collisionBuffers = scene.createOrGetContextVariable<collision_buffer_context>();
 
 	uint32 dummyRigidBodyIndex = numRigidBodies;
 
+	// Sleeping. Bodies are woken up if the user applied forces or changed their velocities, or if something awake touched their island in the last step.
+	bool sleepingEnabled = settings.enableSleeping;
+	bool* rbAwake = arena.allocate<bool>(numRigidBodies + 1);
+	bool* rbWakeUp = arena.allocate<bool>(numRigidBodies, true);
+	uint32 numSleepingRigidBodies = wakeUpDisturbedIslands(scene, rbAwake, numRigidBodies, sleepingEnabled, arena);
+	rbAwake[dummyRigidBodyIndex] = false;
+
 	// Collision detection.
-	getWorldSpaceColliders(scene, worldSpaceAABBs, worldSpaceColliders, dummyRigidBodyIndex);
+	float* speculativeMargins = arena.allocate<float>(numColliders);
+	collision_filter* collisionFilters = arena.allocate<collision_filter>(numColliders);
+	bool* unchangedColliders = arena.allocate<bool>(numColliders);
+	uint32 numContinuousColliders = getWorldSpaceColliders(scene, worldSpaceColliderCache, collisionFilters, speculativeMargins, unchangedColliders,
+		dummyRigidBodyIndex, dt);
 	VALIDATE(worldSpaceColliders, numColliders);
 	VALIDATE(worldSpaceAABBs, numColliders);
 
 	// Broad phase.
-	uint32 numBroadphaseOverlaps = broadphase(scene, worldSpaceAABBs, arena, overlappingColliderPairs, settings.simdBroadPhase);
+	uint32 numBroadphaseOverlaps = broadphase(scene, worldSpaceAABBs, collisionFilters, arena, collisionBuffers.overlappingColliderPairs, settings.broadphase, settings.simdBroadPhase,
+		(numSleepingRigidBodies > 0) ? unchangedColliders : 0);
+	if (numSleepingRigidBodies > 0)
+	{
+		numBroadphaseOverlaps = removeSleepingOverlaps(worldSpaceColliders, collisionBuffers.overlappingColliderPairs.data(), numBroadphaseOverlaps, rbAwake);
+	}
+
+	// Heightmap collisions.
+	collision_output_buffers& heightmapCollisions = collisionBuffers.heightmapCollisions;
+	heightmapCollisions.clear();
+	for (auto [entityHandle, heightmap] : scene.view<heightmap_collider_component>().each())
+	{
+		heightmapCollision(heightmap, entityHandle, worldSpaceColliders, worldSpaceAABBs, numColliders, heightmapCollisions,
+			arena, (physics_index)dummyRigidBodyIndex, (numSleepingRigidBodies > 0) ? rbAwake : 0);
+	}
+
+	// Mesh collisions have the same layout, so they share the heightmap buffers.
+	meshCollision(scene, worldSpaceColliders, worldSpaceAABBs, heightmapCollisions, collisionBuffers.meshOverlaps, arena, settings.broadphase,
+		(physics_index)dummyRigidBodyIndex, (numSleepingRigidBodies > 0) ? rbAwake : 0);
+
+	uint32 numHeightmapCollisions = (uint32)heightmapCollisions.colliderPairs.size();
+	uint32 numHeightmapContacts = (uint32)heightmapCollisions.contacts.size();
+
+	// The colliding pairs are written back into the overlap buffer, followed by the heightmap collisions.
+	std::vector<collider_pair>& overlapBuffer = collisionBuffers.overlappingColliderPairs;
+	if (overlapBuffer.size() < numBroadphaseOverlaps + numHeightmapCollisions)
+	{
+		overlapBuffer.resize(numBroadphaseOverlaps + numHeightmapCollisions);
+	}
+	collider_pair* overlappingColliderPairs = overlapBuffer.data();
+
+	uint32 maxNumCollisions = numBroadphaseOverlaps + numHeightmapCollisions;
+	uint32 maxNumContacts = numBroadphaseOverlaps * 4 + numHeightmapContacts; // Each collision between colliders can have up to 4 contact points.
 
 	non_collision_interaction* nonCollisionInteractions = arena.allocate<non_collision_interaction>(numBroadphaseOverlaps);
-	collision_contact* contacts = arena.allocate<collision_contact>(numBroadphaseOverlaps * 4 + 5000); // Each collision can have up to 4 contact points.
-	constraint_body_pair* allConstraintBodyPairs = arena.allocate<constraint_body_pair>(numConstraints + numBroadphaseOverlaps * 4 + 5000);
+	collision_contact* contacts = arena.allocate<collision_contact>(maxNumContacts);
+	uint32* contactFeatures = arena.allocate<uint32>(maxNumContacts);
+	constraint_body_pair* allConstraintBodyPairs = arena.allocate<constraint_body_pair>(numConstraints + maxNumContacts);
 	collider_pair* collidingColliderPairs = overlappingColliderPairs; // We reuse this buffer.
-	uint8* contactCountPerCollision = arena.allocate<uint8>(numColliders * numColliders + 5000);
+	uint8* contactCountPerCollision = arena.allocate<uint8>(maxNumCollisions);
 
 	constraint_body_pair* collisionBodyPairs = allConstraintBodyPairs + numConstraints;
 
 	// Narrow phase.
 	narrowphase_result narrowPhaseResult = narrowphase(worldSpaceColliders, overlappingColliderPairs, numBroadphaseOverlaps, arena,
-		contacts, collisionBodyPairs, collidingColliderPairs, contactCountPerCollision, nonCollisionInteractions, settings.simdNarrowPhase);
-	
+		contacts, collisionBodyPairs, contactFeatures, collidingColliderPairs, contactCountPerCollision, nonCollisionInteractions, 
+		(numContinuousColliders > 0) ? speculativeMargins : 0, &scene.createOrGetContextVariable<narrowphase_cache>(),
+		settings.simdNarrowPhase, settings.parallelNarrowPhase);
 
-	// Heightmap collisions.
-	for (auto [entityHandle, heightmap] : scene.view<heightmap_collider_component>().each())
+	if (numHeightmapCollisions > 0)
 	{
-		narrowphase_result heightmapCollisionResult = heightmapCollision(heightmap, worldSpaceColliders, worldSpaceAABBs, numColliders,
-			contacts + narrowPhaseResult.numContacts, collisionBodyPairs + narrowPhaseResult.numContacts,
-			collidingColliderPairs + narrowPhaseResult.numCollisions, contactCountPerCollision + narrowPhaseResult.numCollisions,
-			arena, (uint16)dummyRigidBodyIndex);
-
-		narrowPhaseResult.numCollisions += heightmapCollisionResult.numCollisions;
-		narrowPhaseResult.numContacts += heightmapCollisionResult.numContacts;
-		narrowPhaseResult.numNonCollisionInteractions += heightmapCollisionResult.numNonCollisionInteractions;
+		memcpy(contacts + narrowPhaseResult.numContacts, heightmapCollisions.contacts.data(), sizeof(collision_contact) * numHeightmapContacts);
+		memcpy(collisionBodyPairs + narrowPhaseResult.numContacts, heightmapCollisions.bodyPairs.data(), sizeof(constraint_body_pair) * numHeightmapContacts);
+		memcpy(contactFeatures + narrowPhaseResult.numContacts, heightmapCollisions.contactFeatures.data(), sizeof(uint32) * numHeightmapContacts);
+		memcpy(collidingColliderPairs + narrowPhaseResult.numCollisions, heightmapCollisions.colliderPairs.data(), sizeof(collider_pair) * numHeightmapCollisions);
+		memcpy(contactCountPerCollision + narrowPhaseResult.numCollisions, heightmapCollisions.contactCountPerCollision.data(), sizeof(uint8) * numHeightmapCollisions);
+
+		narrowPhaseResult.numCollisions += numHeightmapCollisions;
+		narrowPhaseResult.numContacts += numHeightmapContacts;
 	}
 
 	VALIDATE(contacts, narrowPhaseResult.numContacts);
@@ -1256,6 +2449,7 @@ static void physicsStepInternal(game_scene& scene, memory_arena& arena, const ph
 		numRigidBodies, numTriggers);
 
 	CPU_PROFILE_STAT("Num rigid bodies", numRigidBodies);
+	CPU_PROFILE_STAT("Num sleeping rigid bodies", numSleepingRigidBodies);
 	CPU_PROFILE_STAT("Num colliders", numColliders);
 	CPU_PROFILE_STAT("Num broadphase overlaps", numBroadphaseOverlaps);
 	CPU_PROFILE_STAT("Num narrowphase collisions", narrowPhaseResult.numCollisions);
@@ -1269,7 +2463,26 @@ static void physicsStepInternal(game_scene& scene, memory_arena& arena, const ph
 		uint32 rbIndex = numRigidBodies - 1; // EnTT iterates back to front.
 		for (auto [entityHandle, rb, transform] : scene.group<rigid_body_component, physics_transform1_component>().each())
 		{
-			rigid_body_global_state& global = rbGlobal[rbIndex--];
+			uint32 index = rbIndex--;
+			rigid_body_global_state& global = rbGlobal[index];
+
+			if (rb.sleeping)
+			{
+				// Sleeping bodies keep their pose for the whole step, so they act as static bodies in the solver. Local force fields wake them
+				// up in the next step. Global forces (like gravity) don't.
+				rb.getGlobalState(global, transform);
+				global.invMass = 0.f;
+				global.invInertia = mat3::zero;
+
+				if (rb.forceAccumulator != vec3(0.f) || rb.torqueAccumulator != vec3(0.f))
+				{
+					rb.forceAccumulator = vec3(0.f);
+					rb.torqueAccumulator = vec3(0.f);
+					rbWakeUp[index] = true;
+				}
+				continue;
+			}
+
 			rb.forceAccumulator += globalForceField;
 			rb.applyGravityAndIntegrateForces(global, transform, dt);
 		}
@@ -1282,14 +2495,34 @@ static void physicsStepInternal(game_scene& scene, memory_arena& arena, const ph
 
 
 	handleCollisionCallbacks(scene, collidingColliderPairs, contactCountPerCollision, narrowPhaseResult.numCollisions, numColliders, contacts, rbGlobal, dummyRigidBodyIndex,
-		settings.collisionBeginCallback, settings.collisionEndCallback);
+		sleepingEnabled, settings.collisionBeginCallback, settings.collisionEndCallback);
 
 
 
 
-	// Collect constraints.
+	// Match contacts with last frame's contacts to warm start the solver.
 	uint32 numContacts = narrowPhaseResult.numContacts;
 
+	contact_impulse* contactWarmStartImpulses = 0;
+	contact_impulse* contactImpulses = 0;
+	entity_pair* collidingEntities = 0;
+	vec3* localContactPoints = 0;
+
+	if (settings.warmStartContacts)
+	{
+		contactWarmStartImpulses = arena.allocate<contact_impulse>(numContacts);
+		contactImpulses = arena.allocate<contact_impulse>(numContacts, true); // Contacts of sleeping islands are not solved, so clear to zero.
+		collidingEntities = arena.allocate<entity_pair>(narrowPhaseResult.numCollisions);
+		localContactPoints = arena.allocate<vec3>(numContacts);
+
+		getContactWarmStartImpulses(scene, collidingColliderPairs, contactCountPerCollision, narrowPhaseResult.numCollisions, numColliders,
+			contacts, collisionBodyPairs, contactFeatures, rbGlobal, dummyRigidBodyIndex, heightmapCollisions,
+			collidingEntities, localContactPoints, contactWarmStartImpulses);
+	}
+
+
+	// Collect constraints.
+
 	distance_constraint* distanceConstraints = scene.raw<distance_constraint>();
 	ball_constraint* ballConstraints = scene.raw<ball_constraint>();
 	fixed_constraint* fixedConstraints = scene.raw<fixed_constraint>();
@@ -1312,25 +2545,108 @@ static void physicsStepInternal(game_scene& scene, memory_arena& arena, const ph
 	getConstraintBodyPairs<slider_constraint>(scene, sliderConstraintBodyPairs);
 
 
+	// Build islands. These are needed for the parallel solver and for sleeping.
+	constraint_offsets offsets;
+	offsets.constraintOffsets[constraint_type_distance] = (uint32)(distanceConstraintBodyPairs - allConstraintBodyPairs);
+	offsets.constraintOffsets[constraint_type_ball] = (uint32)(ballConstraintBodyPairs - allConstraintBodyPairs);
+	offsets.constraintOffsets[constraint_type_fixed] = (uint32)(fixedConstraintBodyPairs - allConstraintBodyPairs);
+	offsets.constraintOffsets[constraint_type_hinge] = (uint32)(hingeConstraintBodyPairs - allConstraintBodyPairs);
+	offsets.constraintOffsets[constraint_type_cone_twist] = (uint32)(coneTwistConstraintBodyPairs - allConstraintBodyPairs);
+	offsets.constraintOffsets[constraint_type_slider] = (uint32)(sliderConstraintBodyPairs - allConstraintBodyPairs);
+	offsets.constraintOffsets[constraint_type_collision] = (uint32)(collisionBodyPairs - allConstraintBodyPairs);
+
+	island_description islands = {};
+	uint32* islandsToSolve = 0;
+	uint32 numIslandsToSolve = 0;
+
+	if (settings.parallelIslandSolver || sleepingEnabled)
+	{
+		islands = buildIslands(arena, allConstraintBodyPairs, numConstraints + numContacts, numRigidBodies, (physics_index)dummyRigidBodyIndex, offsets);
+		islandsToSolve = arena.allocate<uint32>(islands.numIslands);
+
+		if (sleepingEnabled)
+		{
+			// Touching or being connected to an awake body wakes up the whole island in the next step.
+			numIslandsToSolve = getAwakeIslands(islands, rbAwake, rbWakeUp, islandsToSolve);
+		}
+		else
+		{
+			for (uint32 i = 0; i < islands.numIslands; ++i)
+			{
+				if (islands.islands[i].count > 0)
+				{
+					islandsToSolve[numIslandsToSolve++] = i;
+				}
+			}
+		}
+	}
+
 	// Solve constraints.
-	constraint_solver constraintSolver;
-	constraintSolver.initialize(arena, rbGlobal,
-		distanceConstraints, distanceConstraintBodyPairs, numDistanceConstraints,
-		ballConstraints, ballConstraintBodyPairs, numBallConstraints,
-		fixedConstraints, fixedConstraintBodyPairs, numFixedConstraints,
-		hingeConstraints, hingeConstraintBodyPairs, numHingeConstraints,
-		coneTwistConstraints, coneTwistConstraintBodyPairs, numConeTwistConstraints,
-		sliderConstraints, sliderConstraintBodyPairs, numSliderConstraints,
-		contacts, collisionBodyPairs, numContacts,
-		dummyRigidBodyIndex, settings.simdConstraintSolver, dt);
+	if (settings.parallelIslandSolver || numSleepingRigidBodies > 0)
+	{
+		island_solver_context context;
+		context.islands = &islands;
+		context.offsets = &offsets;
+		context.islandIndices = islandsToSolve;
+		context.numIslands = numIslandsToSolve;
+		context.rbGlobal = rbGlobal;
+		context.allConstraintBodyPairs = allConstraintBodyPairs;
+		context.allConstraints[constraint_type_distance] = distanceConstraints;
+		context.allConstraints[constraint_type_ball] = ballConstraints;
+		context.allConstraints[constraint_type_fixed] = fixedConstraints;
+		context.allConstraints[constraint_type_hinge] = hingeConstraints;
+		context.allConstraints[constraint_type_cone_twist] = coneTwistConstraints;
+		context.allConstraints[constraint_type_slider] = sliderConstraints;
+		context.allConstraints[constraint_type_collision] = contacts;
+		context.contactWarmStartImpulses = contactWarmStartImpulses;
+		context.outContactImpulses = contactImpulses;
+		context.dummyRigidBodyIndex = dummyRigidBodyIndex;
+		context.numIterations = settings.numRigidSolverIterations;
+		context.simd = settings.simdConstraintSolver;
+		context.dt = dt;
+
+		CPU_PROFILE_BLOCK("Solve constraints");
 
+		if (settings.parallelIslandSolver)
+		{
+			solveIslandsParallel(context);
+		}
+		else
+		{
+			// Solve all awake islands at once.
+			solveIslandBundle(context, { 0, numIslandsToSolve }, dummyRigidBodyIndex, arena);
+		}
+	}
+	else
 	{
+		constraint_solver constraintSolver;
+		constraintSolver.initialize(arena, rbGlobal,
+			distanceConstraints, distanceConstraintBodyPairs, numDistanceConstraints,
+			ballConstraints, ballConstraintBodyPairs, numBallConstraints,
+			fixedConstraints, fixedConstraintBodyPairs, numFixedConstraints,
+			hingeConstraints, hingeConstraintBodyPairs, numHingeConstraints,
+			coneTwistConstraints, coneTwistConstraintBodyPairs, numConeTwistConstraints,
+			sliderConstraints, sliderConstraintBodyPairs, numSliderConstraints,
+			contacts, collisionBodyPairs, numContacts,
+			contactWarmStartImpulses, dummyRigidBodyIndex, settings.simdConstraintSolver, dt);
+
 		CPU_PROFILE_BLOCK("Solve constraints");
 
 		for (uint32 it = 0; it < settings.numRigidSolverIterations; ++it)
 		{
 			constraintSolver.solveOneIteration();
 		}
+
+		if (contactImpulses)
+		{
+			constraintSolver.getContactImpulses(contactImpulses);
+		}
+	}
+
+	if (settings.warmStartContacts)
+	{
+		updateContactCache(scene, collidingEntities, contactCountPerCollision, narrowPhaseResult.numCollisions, localContactPoints, contactFeatures, contactImpulses,
+			numSleepingRigidBodies > 0, arena);
 	}
 
 
@@ -1338,31 +2654,64 @@ static void physicsStepInternal(game_scene& scene, memory_arena& arena, const ph
 	{
 		CPU_PROFILE_BLOCK("Integrate rigid body velocities");
 
+		float sleepLinearVelocityThreshold2 = settings.sleepLinearVelocityThreshold * settings.sleepLinearVelocityThreshold;
+		float sleepAngularVelocityThreshold2 = settings.sleepAngularVelocityThreshold * settings.sleepAngularVelocityThreshold;
+
 		uint32 rbIndex = numRigidBodies - 1; // EnTT iterates back to front.
 		for (auto [entityHandle, rb, transform] : scene.group<rigid_body_component, physics_transform1_component>().each())
 		{
 			rigid_body_global_state& global = rbGlobal[rbIndex--];
 
+			if (rb.sleeping)
+			{
+				continue;
+			}
+
 			rb.integrateVelocity(global, transform, dt);
+
+			if (sleepingEnabled)
+			{
+				bool slow = squaredLength(rb.linearVelocity) < sleepLinearVelocityThreshold2 && squaredLength(rb.angularVelocity) < sleepAngularVelocityThreshold2;
+				rb.sleepTimer = slow ? (rb.sleepTimer + dt) : 0.f;
+			}
 		}
 	}
 
-	VALIDATE(rbGlobal, numRigidBodies);
+	if (sleepingEnabled)
+	{
+		for (uint32 rbIndex = 0; rbIndex < numRigidBodies; ++rbIndex)
+		{
+			if (rbWakeUp[rbIndex])
+			{
+				scene.getComponentAtIndex<rigid_body_component>(numRigidBodies - 1 - rbIndex).wakeUp();
+			}
+		}
 
-	// Cloth. This needs to get integrated with the rest of the system.
+		putIslandsToSleep(scene, islands, offsets, numRigidBodies, hingeConstraints, coneTwistConstraints, sliderConstraints, settings.sleepTime);
+	}
 
-	for (auto [entityHandle, cloth] : scene.view<cloth_component>().each())
+	VALIDATE(rbGlobal, numRigidBodies);
+
+	if (settings.computeStateHash)
 	{
-		cloth.applyWindForce(globalForceField);
-		cloth.simulate(settings.numClothVelocityIterations, settings.numClothPositionIterations, settings.numClothDriftIterations, dt);
+		scene.createOrGetContextVariable<physics_state_hash_context>().hash = hashRigidBodyStates(scene, rbGlobal, numRigidBodies);
 	}
 
+	// Cloth. Collides with the colliders from the start of the step, through the broadphase structures built above.
+
+	simulateCloths(scene, arena, globalForceField, settings, dt, worldSpaceColliders, worldSpaceAABBs, collisionBuffers.clothOverlaps);
+
 
 	arena.resetToMarker(marker);
 }
 
 void physicsStep(game_scene& scene, memory_arena& arena, float& timer, const physics_settings& settings, float dt)
 {
+#if PHYSICS_DETERMINISTIC && defined(_MSC_VER)
+	// The CRT selects FMA3 implementations of the transcendental functions at runtime, if the CPU supports them. These round differently.
+	static bool fma3Disabled = (_set_FMA3_enable(0), true);
+#endif
+
 	if (settings.fixedFrameRate)
 	{
 		const float physicsFixedTimeStep = 1.f / (float)settings.frameRate;
@@ -1382,6 +2731,8 @@ void physicsStep(game_scene& scene, memory_arena& arena, float& timer, const phy
 				physicsStepInternal(scene, arena, settings, physicsFixedTimeStep);
 				timer -= physicsFixedTimeStep;
 			}
+
+			invalidateSceneQueryStructure(scene);
 		}
 
 		if (timer >= physicsFixedTimeStep)
@@ -1404,6 +2755,7 @@ void physicsStep(game_scene& scene, memory_arena& arena, float& timer, const phy
 	else
 	{
 		physicsStepInternal(scene, arena, settings, dt);
+		invalidateSceneQueryStructure(scene);
 
 		for (auto [entityHandle, transform, physicsTransform1] : scene.group(component_group<transform_component, physics_transform1_component>).each())
 		{
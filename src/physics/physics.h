@@ -3,10 +3,12 @@
 #include "core/math.h"
 #include "core/memory.h"
 #include "bounding_volumes.h"
+#include "hull_builder.h"
 #include "scene/scene.h"
 #include "constraints.h"
 #include "rigid_body.h"
 #include "cloth.h"
+#include "collision_broad.h"
 
 #define GRAVITY -9.81f
 
@@ -96,13 +98,19 @@ struct collider_union
 		bounding_hull hull;
 	};
 
+	// Two colliders only interact, if the layer bits of each one have a bit in common with the mask of the other. This is tested in the broad
+	// phase, so masked out pairs (e.g. debris against debris, or triggers against anything but the player) cost nothing afterwards.
+	uint32 collisionLayer = 1;
+	uint32 collisionMask = UINT32_MAX;
+
+	// The SIMD narrow phase loads the material together with the following type and object index. Keep these together.
 	physics_material material;
 
 	collider_type type;
 
 	// These two are only used internally and should not be read outside.
 	physics_object_type objectType;
-	uint16 objectIndex; // Depending on objectType: Rigid body index, force field index, ...
+	physics_index objectIndex; // Depending on objectType: Rigid body index, force field index, ...
 };
 
 struct collider_component : collider_union
@@ -176,7 +184,7 @@ struct physics_reference_component
 	entity_handle firstColliderEntity = entt::null;
 
 	uint32 numConstraints = 0;
-	uint16 firstConstraintEdge = INVALID_CONSTRAINT_EDGE;
+	physics_index firstConstraintEdge = INVALID_CONSTRAINT_EDGE;
 };
 
 struct force_field_component
@@ -204,7 +212,14 @@ struct trigger_component
 
 #define INVALID_BOUNDING_HULL_INDEX -1
 
-uint32 allocateBoundingHullGeometry(const std::string& meshFilepath);
+// Builds the convex hull of all vertices in the file, simplified to the budget in the settings. The result is cached in the asset cache, next
+// to the model's .bin cache, and only rebuilt when the source file is newer.
+uint32 allocateBoundingHullGeometry(const std::string& meshFilepath, const bounding_hull_build_settings& settings = {});
+uint32 allocateBoundingHullGeometry(const bounding_hull_geometry& geometry); // Also available in the physics-only build, which can't load meshes.
+const bounding_hull_geometry& getBoundingHullGeometry(uint32 index);
+
+// Transforms the collider into world space. For hulls, the geometry pointer is set. The object type and index are not touched.
+void getWorldSpaceCollider(const collider_component& collider, const trs& transform, bounding_box& outAABB, collider_union& outCollider);
 
 struct distance_constraint_handle { entity_handle entity; };
 struct ball_constraint_handle { entity_handle entity; };
@@ -321,7 +336,7 @@ struct constraint_entity_iterator
 
 	struct iterator
 	{
-		uint16 constraintEdgeIndex;
+		physics_index constraintEdgeIndex;
 		entt::registry* registry;
 
 		friend bool operator!=(const iterator& a, const iterator& b) { return a.constraintEdgeIndex != b.constraintEdgeIndex; }
@@ -332,7 +347,7 @@ struct constraint_entity_iterator
 	iterator begin() { return iterator{ firstConstraintEdgeIndex, registry }; }
 	iterator end() { return iterator{ INVALID_CONSTRAINT_EDGE, registry }; }
 
-	uint16 firstConstraintEdgeIndex = INVALID_CONSTRAINT_EDGE;
+	physics_index firstConstraintEdgeIndex = INVALID_CONSTRAINT_EDGE;
 	entt::registry* registry;
 };
 
@@ -341,7 +356,8 @@ struct constraint_entity_iterator
 struct contact_info
 {
 	vec3 point;
-	float penetrationDepth; // Positive.
+	float penetrationDepth; // Positive. Negative for speculative contacts, which are generated for continuous collision detection.
+	uint32 feature = 0; // Identifies the contact within its collision across frames, for warm starting. 0 if the test doesn't report features.
 };
 
 struct collision_contact
@@ -387,14 +403,41 @@ struct physics_settings
 
 	uint32 numRigidSolverIterations = 30;
 
+	// Carries the accumulated contact impulses over to the next frame, so that resting contacts start the solve close to last frame's solution.
+	// Does not change the number of iterations by itself, see numRigidSolverIterations.
+	bool warmStartContacts = true;
+
 	uint32 numClothVelocityIterations = 0;
 	uint32 numClothPositionIterations = 1;
 	uint32 numClothDriftIterations = 0;
 
-	bool simdBroadPhase = true;
+	broadphase_type broadphase = broadphase_type_sweep_and_prune;
+
+	bool simdBroadPhase = true; // Sweep and prune only.
 	bool simdNarrowPhase = true;
 	bool simdConstraintSolver = true;
 
+	// Processes the collision pairs in chunks on the job system. The output is identical to the serial narrow phase.
+	bool parallelNarrowPhase = true;
+
+	// Splits the constraints into independent islands and solves them in parallel on the job system.
+	bool parallelIslandSolver = false;
+
+	// The physics step gives bit-identical results across runs and worker thread counts: Parallel jobs write to fixed output ranges and their
+	// results are combined in a fixed order. Results across machines additionally require the deterministic build (premake5 --physics-deterministic),
+	// which compiles without fast floating point math, avoids the approximate hardware reciprocals, whose precision differs between CPU vendors,
+	// and runs the same SIMD kernels on every machine (see simd_dispatch.h).
+	// If set, a hash of all rigid body states is computed after each step (see getPhysicsStateHash), which catches divergences in the step they occur.
+	bool computeStateHash = false;
+
+	// Rigid bodies whose island has been below the velocity thresholds for sleepTime seconds are put to sleep.
+	// Sleeping bodies are skipped in collision detection and constraint solving until they are touched by an awake body,
+	// a force is applied to them or their constraints change.
+	bool enableSleeping = false;
+	float sleepLinearVelocityThreshold = 0.05f;
+	float sleepAngularVelocityThreshold = 0.05f;
+	float sleepTime = 0.5f;
+
 	collision_begin_event_func collisionBeginCallback;
 	collision_end_event_func collisionEndCallback;
 };
@@ -403,3 +446,6 @@ struct physics_settings
 
 void testPhysicsInteraction(game_scene& scene, ray r, float strength = 1000.f);
 void physicsStep(game_scene& scene, memory_arena& arena, float& timer, const physics_settings& settings, float dt);
+
+// Hash of all rigid body states after the last physics step. Only computed if physics_settings::computeStateHash is set, otherwise 0.
+uint64 getPhysicsStateHash(game_scene& scene);
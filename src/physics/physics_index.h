@@ -0,0 +1,21 @@
+#pragma once
+
+#include "core/math.h"
+
+// Width of the indices used throughout the physics pipeline (colliders, rigid bodies, collider pairs, constraint edges, contacts).
+// 16-bit indices keep the hot data compact, but limit a scene to 65535 of each. Large worlds can enable 32-bit indices, either here
+// or by defining PHYSICS_32BIT_INDICES=1 in the build (premake5 --physics-32bit-indices).
+#ifndef PHYSICS_32BIT_INDICES
+#define PHYSICS_32BIT_INDICES 0
+#endif
+
+#if PHYSICS_32BIT_INDICES
+typedef uint32 physics_index;
+#define INVALID_PHYSICS_INDEX UINT32_MAX
+#else
+typedef uint16 physics_index;
+#define INVALID_PHYSICS_INDEX UINT16_MAX
+#endif
+
+// The largest valid index is one below the invalid index.
+#define MAX_NUM_PHYSICS_OBJECTS ((uint32)INVALID_PHYSICS_INDEX)
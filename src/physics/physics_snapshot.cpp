@@ -0,0 +1,204 @@
+#include "pch.h"
+#include "physics_snapshot.h"
+#include "scene_query.h"
+#include "core/cpu_profiling.h"
+
+
+// The pool may have been reordered since the snapshot was taken, e.g. when a group is created in the first physics step. In that case,
+// components are located by their entity instead of by their index.
+template <typename storage_t>
+static auto& getSnapshotComponent(storage_t& s, const entity_handle* snapshotEntities, bool sameOrder, uint32 index)
+{
+	if (sameOrder)
+	{
+		return s.element_at(index);
+	}
+
+	entity_handle entity = snapshotEntities[index];
+	ASSERT(s.contains(entity));
+	return s.get(entity);
+}
+
+// Full snapshots store [count, entities, components].
+// Incremental snapshots store [count, numChanged, (index, component) * numChanged], where the indices refer to the order in the base.
+template <typename component_t>
+static void serializeComponentPool(game_scene& scene, physics_snapshot_stream& stream)
+{
+	static_assert(std::is_trivially_copyable_v<component_t>);
+
+	auto& s = scene.registry.storage<component_t>();
+	uint32 count = (uint32)s.size();
+
+	uint32 storedCount = count;
+	stream.value(storedCount);
+	ASSERT(storedCount == count); // Components of this type have been added or removed since the snapshot was taken.
+
+	const uint64 entitiesSize = sizeof(entity_handle) * count;
+
+	if (!stream.base)
+	{
+		if (stream.reading)
+		{
+			const entity_handle* snapshotEntities = (const entity_handle*)(stream.data + stream.offset);
+			bool sameOrder = memcmp(snapshotEntities, s.data(), entitiesSize) == 0;
+			stream.offset += entitiesSize;
+
+			for (uint32 i = 0; i < count; ++i)
+			{
+				stream.bytes(&getSnapshotComponent(s, snapshotEntities, sameOrder, i), sizeof(component_t));
+			}
+		}
+		else
+		{
+			stream.bytes((void*)s.data(), entitiesSize);
+
+			for (uint32 i = 0; i < count; ++i)
+			{
+				stream.bytes(&s.element_at(i), sizeof(component_t));
+			}
+		}
+	}
+	else
+	{
+		const entity_handle* baseEntities = (const entity_handle*)(stream.base + stream.baseOffset);
+		const uint8* baseComponents = stream.base + stream.baseOffset + entitiesSize;
+		bool sameOrder = memcmp(baseEntities, s.data(), entitiesSize) == 0;
+		stream.baseOffset += entitiesSize + sizeof(component_t) * count;
+
+		if (stream.reading)
+		{
+			for (uint32 i = 0; i < count; ++i)
+			{
+				memcpy(&getSnapshotComponent(s, baseEntities, sameOrder, i), baseComponents + sizeof(component_t) * i, sizeof(component_t));
+			}
+
+			uint32 numChanged;
+			stream.bytes(&numChanged, sizeof(uint32));
+			for (uint32 i = 0; i < numChanged; ++i)
+			{
+				uint32 index;
+				stream.bytes(&index, sizeof(uint32));
+				ASSERT(index < count);
+				stream.bytes(&getSnapshotComponent(s, baseEntities, sameOrder, index), sizeof(component_t));
+			}
+		}
+		else
+		{
+			uint64 numChangedOffset = stream.offset;
+			stream.offset += sizeof(uint32);
+
+			uint32 numChanged = 0;
+			for (uint32 i = 0; i < count; ++i)
+			{
+				component_t& c = getSnapshotComponent(s, baseEntities, sameOrder, i);
+				if (memcmp(&c, baseComponents + sizeof(component_t) * i, sizeof(component_t)) != 0)
+				{
+					stream.bytes(&i, sizeof(uint32));
+					stream.bytes(&c, sizeof(component_t));
+					++numChanged;
+				}
+			}
+
+			if (stream.data)
+			{
+				memcpy(stream.data + numChangedOffset, &numChanged, sizeof(uint32));
+			}
+		}
+	}
+}
+
+static void serializeCloth(game_scene& scene, physics_snapshot_stream& stream)
+{
+	auto& s = scene.registry.storage<cloth_component>();
+	uint32 count = (uint32)s.size();
+
+	uint32 storedCount = count;
+	stream.value(storedCount);
+	ASSERT(storedCount == count);
+
+	for (uint32 i = 0; i < count; ++i)
+	{
+		s.element_at(i).serializeState(stream);
+	}
+}
+
+static void serializePhysicsState(game_scene& scene, physics_snapshot_stream& stream)
+{
+	serializeComponentPool<rigid_body_component>(scene, stream);
+	serializeComponentPool<physics_transform0_component>(scene, stream);
+	serializeComponentPool<physics_transform1_component>(scene, stream);
+	serializeComponentPool<transform_component>(scene, stream);
+
+	serializeComponentPool<distance_constraint>(scene, stream);
+	serializeComponentPool<ball_constraint>(scene, stream);
+	serializeComponentPool<fixed_constraint>(scene, stream);
+	serializeComponentPool<hinge_constraint>(scene, stream);
+	serializeComponentPool<cone_twist_constraint>(scene, stream);
+	serializeComponentPool<slider_constraint>(scene, stream);
+
+	serializeComponentPool<sap_endpoint_indirection_component>(scene, stream);
+	serializeComponentPool<aabb_tree_leaf_component>(scene, stream);
+
+	serializeCloth(scene, stream);
+	serializeBroadphaseState(scene, stream);
+	serializeContactState(scene, stream);
+	serializeStateHash(scene, stream);
+}
+
+static physics_snapshot createSnapshot(game_scene& scene, const physics_snapshot* base, memory_arena& arena)
+{
+	physics_snapshot_stream stream = {};
+	stream.base = base ? base->data : 0;
+
+	// Measure first, so that the snapshot is a single allocation of exactly the right size.
+	serializePhysicsState(scene, stream);
+
+	physics_snapshot result;
+	result.size = stream.offset;
+	result.data = (uint8*)arena.allocate(result.size, 16);
+	result.base = base;
+
+	stream = {};
+	stream.data = result.data;
+	stream.base = base ? base->data : 0;
+	serializePhysicsState(scene, stream);
+
+	ASSERT(stream.offset == result.size);
+	ASSERT(!base || stream.baseOffset == base->size);
+
+	return result;
+}
+
+physics_snapshot createPhysicsSnapshot(game_scene& scene, memory_arena& arena)
+{
+	CPU_PROFILE_BLOCK("Create physics snapshot");
+
+	return createSnapshot(scene, 0, arena);
+}
+
+physics_snapshot createIncrementalPhysicsSnapshot(game_scene& scene, const physics_snapshot& base, memory_arena& arena)
+{
+	CPU_PROFILE_BLOCK("Create incremental physics snapshot");
+
+	ASSERT(!base.base);
+	return createSnapshot(scene, &base, arena);
+}
+
+void restorePhysicsSnapshot(game_scene& scene, const physics_snapshot& snapshot)
+{
+	CPU_PROFILE_BLOCK("Restore physics snapshot");
+
+	physics_snapshot_stream stream = {};
+	stream.data = snapshot.data;
+	stream.reading = true;
+	stream.base = snapshot.base ? snapshot.base->data : 0;
+
+	serializePhysicsState(scene, stream);
+
+	ASSERT(stream.offset == snapshot.size);
+
+	invalidateWorldSpaceColliderCache(scene);
+
+	// Queries should see the restored colliders, not the ones of the last step.
+	invalidateSceneQueryStructure(scene);
+}
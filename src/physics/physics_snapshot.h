@@ -0,0 +1,102 @@
+#pragma once
+
+#include "physics.h"
+
+// Snapshots of the simulation state of a scene, e.g. for resetting learning environments or for network rollbacks.
+// A snapshot captures the rigid bodies, the transforms of all entities, constraints, cloth particles, the broadphase, the contact and narrow phase
+// caches, the collision event state and the state hash in one contiguous blob, which is restored with plain memory copies. Sleeping bodies collide
+// with their physics transforms, so they are restored exactly as well. After a restore, getPhysicsStateHash returns the hash of the step before
+// the snapshot, and stepping again reproduces the hashes of the original run.
+// Only the state is captured, not the structure of the scene: Restoring requires that no physics entities or components have been added or
+// removed since the snapshot was taken. This is asserted.
+
+struct physics_snapshot
+{
+	uint8* data = 0;
+	uint64 size = 0;
+
+	// Set for incremental snapshots. The base must stay valid as long as the incremental snapshot is used.
+	const physics_snapshot* base = 0;
+};
+
+// The snapshot is allocated from the arena and stays valid until the caller resets it.
+physics_snapshot createPhysicsSnapshot(game_scene& scene, memory_arena& arena);
+
+// Stores only the components which differ from the base, which must be a full snapshot of the same scene. Variable-sized state (broadphase,
+// contact cache, cloth) is always stored completely.
+physics_snapshot createIncrementalPhysicsSnapshot(game_scene& scene, const physics_snapshot& base, memory_arena& arena);
+
+// Restoring an incremental snapshot does not require the base to be restored first.
+void restorePhysicsSnapshot(game_scene& scene, const physics_snapshot& snapshot);
+
+
+// Internal. The same serialize function is used for measuring, writing and reading a snapshot, so the layout can't get out of sync.
+struct physics_snapshot_stream
+{
+	uint8* data; // Null when measuring.
+	uint64 offset;
+	bool reading;
+
+	// Incremental snapshots only. The base is walked in lockstep, so that each section can be located in it.
+	const uint8* base;
+	uint64 baseOffset;
+
+	void bytes(void* ptr, uint64 size)
+	{
+		if (reading)
+		{
+			memcpy(ptr, data + offset, size);
+		}
+		else if (data)
+		{
+			memcpy(data + offset, ptr, size);
+		}
+		offset += size;
+	}
+
+	template <typename T>
+	T peekBase()
+	{
+		T result;
+		memcpy(&result, base + baseOffset, sizeof(T));
+		return result;
+	}
+
+	template <typename T>
+	void value(T& v)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		bytes(&v, sizeof(T));
+		if (base)
+		{
+			baseOffset += sizeof(T);
+		}
+	}
+
+	template <typename T>
+	void vector(std::vector<T>& v)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		uint32 baseCount = base ? peekBase<uint32>() : 0;
+
+		uint32 count = (uint32)v.size();
+		value(count);
+		if (reading)
+		{
+			v.resize(count);
+		}
+		bytes(v.data(), sizeof(T) * count);
+
+		if (base)
+		{
+			baseOffset += sizeof(T) * baseCount;
+		}
+	}
+};
+
+void serializeBroadphaseState(game_scene& scene, physics_snapshot_stream& stream);
+void serializeContactState(game_scene& scene, physics_snapshot_stream& stream);
+void serializeStateHash(game_scene& scene, physics_snapshot_stream& stream);
+
+// The broadphase structures are restored to an older state, so the world space colliders of sleeping bodies can no longer be reused.
+void invalidateWorldSpaceColliderCache(game_scene& scene);
@@ -24,10 +24,16 @@ rigid_body_component::rigid_body_component(bool kinematic, float gravityFactor,
 	this->angularVelocity = vec3(0.f);
 	this->forceAccumulator = vec3(0.f);
 	this->torqueAccumulator = vec3(0.f);
+	this->continuousCollision = false;
+	this->sleeping = false;
+	this->sleepTimer = 0.f;
+	this->sleepIsland = entt::null;
 }
 
 void rigid_body_component::recalculateProperties(entt::registry* registry, const physics_reference_component& reference)
 {
+	wakeUp();
+
 	if (invMass == 0.f)
 	{
 		return; // Kinematic.
@@ -92,7 +98,7 @@ vec3 rigid_body_component::getGlobalPointVelocity(const trs& transform, vec3 loc
 	return linearVelocity + cross(angularVelocity, globalP - globalCOG);
 }
 
-void rigid_body_component::applyGravityAndIntegrateForces(rigid_body_global_state& global, const trs& transform, float dt)
+void rigid_body_component::getGlobalState(rigid_body_global_state& global, const trs& transform) const
 {
 	global.rotation = transform.rotation;
 	global.position = transform.position + transform.rotation * localCOGPosition;
@@ -101,6 +107,14 @@ void rigid_body_component::applyGravityAndIntegrateForces(rigid_body_global_stat
 	global.invInertia = rot * invInertia * transpose(rot);
 	global.invMass = invMass;
 
+	global.linearVelocity = linearVelocity;
+	global.angularVelocity = angularVelocity;
+	global.localCOGPosition = localCOGPosition;
+}
+
+void rigid_body_component::applyGravityAndIntegrateForces(rigid_body_global_state& global, const trs& transform, float dt)
+{
+	getGlobalState(global, transform);
 
 	if (invMass > 0.f)
 	{
@@ -120,7 +134,6 @@ void rigid_body_component::applyGravityAndIntegrateForces(rigid_body_global_stat
 
 	global.linearVelocity = linearVelocity;
 	global.angularVelocity = angularVelocity;
-	global.localCOGPosition = localCOGPosition;
 }
 
 void rigid_body_component::integrateVelocity(const rigid_body_global_state& global, trs& transform, float dt)
@@ -24,9 +24,12 @@ struct rigid_body_component
 	vec3 getGlobalPointVelocity(const trs& transform, vec3 localP) const;
 
 
+	void getGlobalState(rigid_body_global_state& global, const trs& transform) const;
 	void applyGravityAndIntegrateForces(rigid_body_global_state& global, const trs& transform, float dt);
 	void integrateVelocity(const rigid_body_global_state& global, trs& transform, float dt);
 
+	void wakeUp() { sleeping = false; sleepTimer = 0.f; }
+
 
 	// In entity's local space.
 	vec3 localCOGPosition;
@@ -43,6 +46,14 @@ struct rigid_body_component
 
 	vec3 forceAccumulator;
 	vec3 torqueAccumulator;
+
+	// Fast bodies may tunnel through thin geometry. Continuous bodies sweep their bounding box and generate speculative contacts.
+	bool continuousCollision;
+
+	// Sleeping bodies are not integrated and only take part in collision detection when something awake touches them.
+	bool sleeping;
+	float sleepTimer; // Time the body has been below the sleep velocity thresholds.
+	entity_handle sleepIsland; // Body representing the island this body fell asleep with. The island is woken up as a whole.
 };
 
 struct physics_transform0_component : trs 
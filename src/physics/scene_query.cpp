@@ -0,0 +1,962 @@
+#include "pch.h"
+#include "scene_query.h"
+#include "collision_gjk.h"
+#include "terrain/heightmap_collider.h"
+#include "core/cpu_profiling.h"
+#include "core/job_system.h"
+
+
+#define SCENE_QUERY_MAX_PRIMITIVES_PER_LEAF 4
+#define SCENE_QUERY_MAX_STACK_SIZE 64
+
+// The BVH is refitted after each physics step and only rebuilt, when the summed surface area of its nodes has grown by this factor since the
+// last rebuild (or the set of colliders has changed).
+#define SCENE_QUERY_MAX_REFIT_AREA_GROWTH 2.f
+
+#define MAX_NUM_RAYCAST_JOBS 32
+#define MIN_NUM_RAYS_PER_RAYCAST_JOB 64
+
+// Heightmap queries walk along the ray in segments of this many heightmap cells, so that long rays don't gather all triangles below them.
+#define HEIGHTMAP_QUERY_CELLS_PER_SEGMENT 8
+
+struct scene_query_bvh_node
+{
+	bounding_box aabb;
+
+	// The first child of an inner node directly follows its parent in the node array.
+	union
+	{
+		uint32 secondChild;
+		uint32 firstPrimitive;
+	};
+	uint32 numPrimitives; // 0 for inner nodes.
+};
+
+struct scene_query_context
+{
+	// Set by physicsStep. The structure is updated by the next query, so that steps without queries don't pay for it.
+	bool outdated = true;
+
+	std::vector<scene_query_bvh_node> nodes;
+	float builtArea = 0.f; // Summed surface area of the nodes after the last rebuild.
+
+	// Sorted by the BVH, so that the primitives of each leaf are contiguous.
+	// World space colliders. Hulls store their geometry index instead of the pointer, since the geometry array may grow between queries.
+	std::vector<collider_union> colliders;
+	std::vector<entity_handle> entities; // Parent entities of the colliders.
+
+	// In the order of the collider view. Compared on each update, so that added or removed colliders trigger a rebuild.
+	std::vector<entity_handle> colliderEntities;
+	std::vector<uint32> primitiveColliders; // Collider view index of each primitive. Set by the rebuild, used by the refit.
+
+	// Scratch memory of the update, sized by the number of colliders. It lives here and not in the query's arena, since the update covers the
+	// whole scene, while the arenas passed to queries (and the raycast job arenas) are sized for a single query.
+	std::vector<collider_union> buildColliders;
+	std::vector<entity_handle> buildEntities;
+	std::vector<bounding_box> buildAABBs;
+	std::vector<vec3> buildCenters;
+};
+
+// Each raycast job gets its own arena, since the heightmap traversal uses it for its stack.
+static memory_arena raycastArenas[MAX_NUM_RAYCAST_JOBS];
+
+
+static uint32 buildBVHNode(std::vector<scene_query_bvh_node>& nodes, const bounding_box* aabbs, const vec3* centers, uint32* indices, uint32 first, uint32 count)
+{
+	uint32 nodeIndex = (uint32)nodes.size();
+	nodes.emplace_back();
+
+	bounding_box aabb = bounding_box::negativeInfinity();
+	bounding_box centerBounds = bounding_box::negativeInfinity();
+	for (uint32 i = first; i < first + count; ++i)
+	{
+		aabb.grow(aabbs[indices[i]].minCorner);
+		aabb.grow(aabbs[indices[i]].maxCorner);
+		centerBounds.grow(centers[indices[i]]);
+	}
+
+	if (count <= SCENE_QUERY_MAX_PRIMITIVES_PER_LEAF)
+	{
+		scene_query_bvh_node& node = nodes[nodeIndex];
+		node.aabb = aabb;
+		node.firstPrimitive = first;
+		node.numPrimitives = count;
+		return nodeIndex;
+	}
+
+	// Median split along the largest axis.
+	vec3 extent = centerBounds.maxCorner - centerBounds.minCorner;
+	uint32 axis = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+
+	uint32 half = count / 2;
+	std::nth_element(indices + first, indices + first + half, indices + first + count, [centers, axis](uint32 a, uint32 b)
+	{
+		return centers[a].data[axis] < centers[b].data[axis];
+	});
+
+	buildBVHNode(nodes, aabbs, centers, indices, first, half);
+	uint32 secondChild = buildBVHNode(nodes, aabbs, centers, indices, first + half, count - half);
+
+	scene_query_bvh_node& node = nodes[nodeIndex]; // Don't hold this reference over the recursion, since the array grows.
+	node.aabb = aabb;
+	node.secondChild = secondChild;
+	node.numPrimitives = 0;
+	return nodeIndex;
+}
+
+static float surfaceArea(const bounding_box& aabb)
+{
+	vec3 d = aabb.maxCorner - aabb.minCorner;
+	return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+// Recomputes the node bounds bottom up, keeping the topology. Children are stored after their parents, so a reverse sweep visits them first.
+// Returns the summed surface area of the nodes.
+static float refitBVH(std::vector<scene_query_bvh_node>& nodes, const bounding_box* aabbs, const uint32* primitiveColliders)
+{
+	float area = 0.f;
+	for (uint32 nodeIndex = (uint32)nodes.size(); nodeIndex-- > 0; )
+	{
+		scene_query_bvh_node& node = nodes[nodeIndex];
+
+		bounding_box aabb = bounding_box::negativeInfinity();
+		if (node.numPrimitives > 0)
+		{
+			for (uint32 i = node.firstPrimitive; i < node.firstPrimitive + node.numPrimitives; ++i)
+			{
+				aabb.grow(aabbs[primitiveColliders[i]].minCorner);
+				aabb.grow(aabbs[primitiveColliders[i]].maxCorner);
+			}
+		}
+		else
+		{
+			const bounding_box& first = nodes[nodeIndex + 1].aabb;
+			const bounding_box& second = nodes[node.secondChild].aabb;
+			aabb.grow(first.minCorner);
+			aabb.grow(first.maxCorner);
+			aabb.grow(second.minCorner);
+			aabb.grow(second.maxCorner);
+		}
+
+		node.aabb = aabb;
+		area += surfaceArea(aabb);
+	}
+	return area;
+}
+
+void invalidateSceneQueryStructure(game_scene& scene)
+{
+	scene.createOrGetContextVariable<scene_query_context>().outdated = true;
+}
+
+static void updateSceneQueryStructure(game_scene& scene, scene_query_context& context)
+{
+	CPU_PROFILE_BLOCK("Update scene query structure");
+
+	uint32 numColliders = scene.numberOfComponentsOfType<collider_component>();
+
+	bool sameColliders = (numColliders == (uint32)context.colliderEntities.size());
+
+	context.colliderEntities.resize(numColliders, entt::null);
+	context.buildColliders.resize(numColliders);
+	context.buildEntities.resize(numColliders);
+	context.buildAABBs.resize(numColliders);
+	context.buildCenters.resize(numColliders);
+
+	collider_union* colliders = context.buildColliders.data();
+	entity_handle* entities = context.buildEntities.data();
+	bounding_box* aabbs = context.buildAABBs.data();
+	vec3* centers = context.buildCenters.data();
+
+	uint32 pushIndex = 0;
+	for (auto [entityHandle, collider] : scene.view<collider_component>().each())
+	{
+		uint32 index = pushIndex++;
+		collider_union& col = colliders[index];
+
+		scene_entity entity = { collider.parentEntity, scene };
+
+		physics_transform1_component* physicsTransformComponent = entity.getComponentIfExists<physics_transform1_component>();
+		transform_component* transformComponent = entity.getComponentIfExists<transform_component>();
+		const trs& transform = physicsTransformComponent ? *physicsTransformComponent : transformComponent ? *transformComponent : trs::identity;
+
+		getWorldSpaceCollider(collider, transform, aabbs[index], col);
+		if (col.type == collider_type_hull)
+		{
+			col.hull.geometryIndex = collider.hull.geometryIndex;
+		}
+
+		col.objectType = entity.hasComponent<rigid_body_component>() ? physics_object_type_rigid_body
+			: entity.hasComponent<force_field_component>() ? physics_object_type_force_field
+			: entity.hasComponent<trigger_component>() ? physics_object_type_trigger
+			: physics_object_type_static_collider;
+		col.objectIndex = 0; // Unused.
+
+		entities[index] = collider.parentEntity;
+		centers[index] = aabbs[index].getCenter();
+
+		if (context.colliderEntities[index] != entityHandle)
+		{
+			context.colliderEntities[index] = entityHandle;
+			sameColliders = false;
+		}
+	}
+
+	context.outdated = false;
+
+	bool refitted = false;
+	if (sameColliders && numColliders > 0)
+	{
+		CPU_PROFILE_BLOCK("Refit");
+
+		float area = refitBVH(context.nodes, aabbs, context.primitiveColliders.data());
+		refitted = (area <= context.builtArea * SCENE_QUERY_MAX_REFIT_AREA_GROWTH);
+	}
+
+	if (!refitted)
+	{
+		CPU_PROFILE_BLOCK("Rebuild");
+
+		// The persistent arrays keep their capacity, so they only reallocate when the number of colliders grows.
+		context.nodes.clear();
+		context.colliders.resize(numColliders);
+		context.entities.resize(numColliders);
+		context.primitiveColliders.resize(numColliders);
+		context.builtArea = 0.f;
+
+		if (numColliders == 0)
+		{
+			return;
+		}
+
+		uint32* indices = context.primitiveColliders.data();
+		for (uint32 i = 0; i < numColliders; ++i)
+		{
+			indices[i] = i;
+		}
+
+		context.nodes.reserve(2 * numColliders);
+		buildBVHNode(context.nodes, aabbs, centers, indices, 0, numColliders);
+
+		for (const scene_query_bvh_node& node : context.nodes)
+		{
+			context.builtArea += surfaceArea(node.aabb);
+		}
+	}
+
+	const uint32* indices = context.primitiveColliders.data();
+	for (uint32 i = 0; i < numColliders; ++i)
+	{
+		context.colliders[i] = colliders[indices[i]];
+		context.entities[i] = entities[indices[i]];
+	}
+}
+
+// Queries before the first physics step build the structure from the current transforms. Not thread safe, so parallel queries get the
+// context once up front (see raycastBatch).
+static const scene_query_context& getSceneQueryContext(game_scene& scene)
+{
+	scene_query_context& context = scene.createOrGetContextVariable<scene_query_context>();
+	if (context.outdated)
+	{
+		updateSceneQueryStructure(scene, context);
+	}
+	return context;
+}
+
+
+
+
+// Traversal.
+
+static bool rayVsAABB(vec3 origin, vec3 invDir, const bounding_box& aabb, float maxT)
+{
+	vec3 t1 = (aabb.minCorner - origin) * invDir;
+	vec3 t2 = (aabb.maxCorner - origin) * invDir;
+
+	vec3 tmin = min(t1, t2);
+	vec3 tmax = max(t1, t2);
+
+	float entry = max(max(tmin.x, tmin.y), max(tmin.z, 0.f));
+	float exit = min(min(tmax.x, tmax.y), min(tmax.z, maxT));
+	return entry <= exit;
+}
+
+// Visits all leaf primitives whose bounding box, padded by padding, is hit by the ray. The callback may lower maxT.
+template <typename callback_t>
+static void traverseBVH(const scene_query_context& context, vec3 origin, vec3 direction, vec3 padding, const float& maxT, const callback_t& callback)
+{
+	if (context.nodes.empty())
+	{
+		return;
+	}
+
+	vec3 invDir = vec3(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+
+	uint32 stack[SCENE_QUERY_MAX_STACK_SIZE];
+	uint32 stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const scene_query_bvh_node& node = context.nodes[stack[--stackSize]];
+
+		bounding_box aabb = node.aabb;
+		aabb.pad(padding);
+		if (!rayVsAABB(origin, invDir, aabb, maxT))
+		{
+			continue;
+		}
+
+		if (node.numPrimitives > 0)
+		{
+			for (uint32 i = node.firstPrimitive; i < node.firstPrimitive + node.numPrimitives; ++i)
+			{
+				callback(i);
+			}
+		}
+		else
+		{
+			ASSERT(stackSize + 2 <= SCENE_QUERY_MAX_STACK_SIZE);
+			uint32 firstChild = (uint32)(&node - context.nodes.data()) + 1;
+			stack[stackSize++] = node.secondChild;
+			stack[stackSize++] = firstChild;
+		}
+	}
+}
+
+// Visits all leaf primitives whose bounding box overlaps the volume.
+template <typename callback_t>
+static void traverseBVH(const scene_query_context& context, const bounding_box& volume, const callback_t& callback)
+{
+	if (context.nodes.empty())
+	{
+		return;
+	}
+
+	uint32 stack[SCENE_QUERY_MAX_STACK_SIZE];
+	uint32 stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const scene_query_bvh_node& node = context.nodes[stack[--stackSize]];
+
+		if (!aabbVsAABB(node.aabb, volume))
+		{
+			continue;
+		}
+
+		if (node.numPrimitives > 0)
+		{
+			for (uint32 i = node.firstPrimitive; i < node.firstPrimitive + node.numPrimitives; ++i)
+			{
+				callback(i);
+			}
+		}
+		else
+		{
+			ASSERT(stackSize + 2 <= SCENE_QUERY_MAX_STACK_SIZE);
+			uint32 firstChild = (uint32)(&node - context.nodes.data()) + 1;
+			stack[stackSize++] = node.secondChild;
+			stack[stackSize++] = firstChild;
+		}
+	}
+}
+
+static bool passesFilter(const collider_union& collider, uint32 filter)
+{
+	return (filter & (1 << collider.objectType)) != 0;
+}
+
+static collider_union getCollider(const scene_query_context& context, uint32 index)
+{
+	collider_union result = context.colliders[index];
+	if (result.type == collider_type_hull)
+	{
+		uint32 geometryIndex = result.hull.geometryIndex;
+		result.hull.geometryPtr = &getBoundingHullGeometry(geometryIndex);
+	}
+	return result;
+}
+
+// Clips the segment [minT, maxT] of the ray to the heightmap's bounding box.
+static bool clipToHeightmap(const heightmap_collider_component& heightmap, vec3 origin, vec3 direction, vec3 padding, float& minT, float& maxT)
+{
+	bounding_box aabb = heightmap.getBoundingBox();
+	aabb.pad(padding);
+
+	vec3 invDir = vec3(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+	vec3 t1 = (aabb.minCorner - origin) * invDir;
+	vec3 t2 = (aabb.maxCorner - origin) * invDir;
+
+	vec3 tmin = min(t1, t2);
+	vec3 tmax = max(t1, t2);
+
+	minT = max(max(tmin.x, tmin.y), max(tmin.z, 0.f));
+	maxT = min(min(tmax.x, tmax.y), min(tmax.z, maxT));
+	return minT <= maxT;
+}
+
+// Calls the callback with the triangles below the swept volume (padded by padding) front to back in segments, until the callback lowered maxT
+// below the start of the next segment.
+template <typename callback_t>
+static void walkHeightmap(const heightmap_collider_component& heightmap, vec3 origin, vec3 direction, vec3 padding, float& maxT,
+	memory_arena& arena, const callback_t& callback)
+{
+	float minT;
+	float clippedMaxT = maxT;
+	if (!clipToHeightmap(heightmap, origin, direction, padding, minT, clippedMaxT))
+	{
+		return;
+	}
+
+	float segmentLength = heightmap.chunkSize / (TERRAIN_LOD_0_VERTICES_PER_DIMENSION - 1) * HEIGHTMAP_QUERY_CELLS_PER_SEGMENT;
+
+	for (float start = minT; start <= min(clippedMaxT, maxT); start += segmentLength)
+	{
+		float end = min(start + segmentLength, min(clippedMaxT, maxT));
+
+		bounding_box volume = bounding_box::negativeInfinity();
+		volume.grow(origin + start * direction);
+		volume.grow(origin + end * direction);
+		volume.pad(padding);
+
+		// Clamp to the heightmap, since the triangle iteration expects a volume inside its bounds.
+		bounding_box heightmapAABB = heightmap.getBoundingBox();
+		volume.minCorner = max(volume.minCorner, heightmapAABB.minCorner);
+		volume.maxCorner = min(volume.maxCorner, heightmapAABB.maxCorner);
+		if (volume.minCorner.x > volume.maxCorner.x || volume.minCorner.z > volume.maxCorner.z)
+		{
+			continue;
+		}
+
+		heightmap.iterateTrianglesInVolume(volume, arena, callback);
+	}
+}
+
+
+
+
+// Raycasts.
+
+static vec3 boxNormal(vec3 localPoint, vec3 radius)
+{
+	vec3 p = abs(localPoint / radius);
+	if (p.x > p.y && p.x > p.z) { return vec3(localPoint.x < 0.f ? -1.f : 1.f, 0.f, 0.f); }
+	if (p.y > p.z) { return vec3(0.f, localPoint.y < 0.f ? -1.f : 1.f, 0.f); }
+	return vec3(0.f, 0.f, localPoint.z < 0.f ? -1.f : 1.f);
+}
+
+static bool raycastCollider(const collider_union& collider, const ray& r, float& outT, vec3& outNormal)
+{
+	float t;
+
+	switch (collider.type)
+	{
+		case collider_type_sphere:
+		{
+			if (!r.intersectSphere(collider.sphere, t)) { return false; }
+			outNormal = noz(r.origin + t * r.direction - collider.sphere.center);
+		} break;
+
+		case collider_type_capsule:
+		{
+			if (!r.intersectCapsule(collider.capsule, t)) { return false; }
+			vec3 hit = r.origin + t * r.direction;
+			outNormal = noz(hit - closestPoint_PointSegment(hit, line_segment{ collider.capsule.positionA, collider.capsule.positionB }));
+		} break;
+
+		case collider_type_cylinder:
+		{
+			if (!r.intersectCylinder(collider.cylinder, t)) { return false; }
+			vec3 hit = r.origin + t * r.direction;
+
+			vec3 axis = collider.cylinder.positionB - collider.cylinder.positionA;
+			float height = length(axis);
+			axis *= 1.f / height;
+
+			float h = dot(hit - collider.cylinder.positionA, axis);
+			vec3 radial = hit - collider.cylinder.positionA - h * axis;
+
+			// Pick the closest surface.
+			float distanceToSide = collider.cylinder.radius - length(radial);
+			float distanceToCap = min(h, height - h);
+			outNormal = (distanceToSide < distanceToCap) ? noz(radial) : (h < 0.5f * height) ? -axis : axis;
+		} break;
+
+		case collider_type_aabb:
+		{
+			if (!r.intersectAABB(collider.aabb, t)) { return false; }
+			vec3 hit = r.origin + t * r.direction;
+			outNormal = boxNormal(hit - collider.aabb.getCenter(), collider.aabb.getRadius());
+		} break;
+
+		case collider_type_obb:
+		{
+			if (!r.intersectOBB(collider.obb, t)) { return false; }
+			vec3 hit = r.origin + t * r.direction;
+			outNormal = collider.obb.rotation * boxNormal(conjugate(collider.obb.rotation) * (hit - collider.obb.center), collider.obb.radius);
+		} break;
+
+		case collider_type_hull:
+		{
+			const bounding_hull& hull = collider.hull;
+			const bounding_hull_geometry& geometry = *hull.geometryPtr;
+
+			ray localR = { conjugate(hull.rotation) * (r.origin - hull.position), conjugate(hull.rotation) * r.direction };
+
+			t = FLT_MAX;
+			vec3 localNormal;
+			for (const auto& tri : geometry.faces)
+			{
+				vec3 a = geometry.vertices[tri.a];
+				vec3 b = geometry.vertices[tri.b];
+				vec3 c = geometry.vertices[tri.c];
+
+				float triT;
+				bool frontFacing;
+				if (localR.intersectTriangle(a, b, c, triT, frontFacing) && triT < t)
+				{
+					t = triT;
+					localNormal = tri.normal;
+				}
+			}
+
+			if (t == FLT_MAX) { return false; }
+			outNormal = hull.rotation * localNormal;
+		} break;
+
+		default: return false;
+	}
+
+	outT = t;
+	return true;
+}
+
+static scene_query_hit raycastInternal(game_scene& scene, const scene_query_context& context, ray r, float maxDistance, memory_arena& arena, uint32 filter)
+{
+	entity_handle hitEntity = entt::null;
+
+	scene_query_hit result;
+	result.entity = { hitEntity, scene };
+	result.distance = maxDistance;
+
+	float length = ::length(r.direction);
+	if (length == 0.f)
+	{
+		return result;
+	}
+	r.direction *= 1.f / length;
+
+	float maxT = maxDistance;
+
+	traverseBVH(context, r.origin, r.direction, vec3(0.f), maxT, [&](uint32 index)
+	{
+		if (!passesFilter(context.colliders[index], filter))
+		{
+			return;
+		}
+
+		collider_union collider = getCollider(context, index);
+
+		float t;
+		vec3 normal;
+		if (raycastCollider(collider, r, t, normal) && t < maxT)
+		{
+			maxT = t;
+			hitEntity = context.entities[index];
+			result.normal = normal;
+		}
+	});
+
+	if (filter & scene_query_filter_heightmaps)
+	{
+		for (auto [entityHandle, heightmap] : scene.view<heightmap_collider_component>().each())
+		{
+			walkHeightmap(heightmap, r.origin, r.direction, vec3(0.f), maxT, arena, [&](vec3 a, vec3 b, vec3 c, uint32)
+			{
+				float t;
+				bool frontFacing;
+				if (r.intersectTriangle(a, b, c, t, frontFacing) && t < maxT)
+				{
+					maxT = t;
+					hitEntity = entityHandle;
+					result.normal = noz(cross(b - a, c - a));
+				}
+			});
+		}
+	}
+
+	if (hitEntity != entt::null)
+	{
+		result.entity = { hitEntity, scene };
+		result.distance = maxT;
+		result.point = r.origin + maxT * r.direction;
+		if (dot(result.normal, r.direction) > 0.f)
+		{
+			result.normal = -result.normal;
+		}
+	}
+
+	return result;
+}
+
+scene_query_hit raycast(game_scene& scene, ray r, float maxDistance, memory_arena& arena, uint32 filter)
+{
+	CPU_PROFILE_BLOCK("Raycast");
+
+	const scene_query_context& context = getSceneQueryContext(scene);
+	return raycastInternal(scene, context, r, maxDistance, arena, filter);
+}
+
+void raycastBatch(game_scene& scene, const ray* rays, const float* maxDistances, uint32 numRays, scene_query_hit* outHits, uint32 filter)
+{
+	CPU_PROFILE_BLOCK("Raycast batch");
+
+	if (numRays == 0)
+	{
+		return;
+	}
+
+	uint32 numJobs = clamp(numRays / MIN_NUM_RAYS_PER_RAYCAST_JOB, 1u, (uint32)MAX_NUM_RAYCAST_JOBS);
+	uint32 numRaysPerJob = bucketize(numRays, numJobs);
+
+	for (uint32 i = 0; i < numJobs; ++i)
+	{
+		if (!raycastArenas[i].base())
+		{
+			raycastArenas[i].initialize(0, MB(64));
+		}
+	}
+
+	struct raycast_job_data
+	{
+		game_scene* scene;
+		const scene_query_context* context;
+		const ray* rays;
+		const float* maxDistances;
+		scene_query_hit* outHits;
+		uint32 first;
+		uint32 count;
+		uint32 filter;
+		uint32 arenaIndex;
+	};
+
+	struct raycast_parent_job_data
+	{
+		raycast_job_data base;
+		uint32 numRays;
+		uint32 numJobs;
+		uint32 numRaysPerJob;
+	};
+
+	raycast_parent_job_data data;
+	data.base.scene = &scene;
+	data.base.context = &getSceneQueryContext(scene);
+	data.base.rays = rays;
+	data.base.maxDistances = maxDistances;
+	data.base.outHits = outHits;
+	data.base.filter = filter;
+	data.numRays = numRays;
+	data.numJobs = numJobs;
+	data.numRaysPerJob = numRaysPerJob;
+
+	job_handle parentJob = highPriorityJobQueue.createJob<raycast_parent_job_data>([](raycast_parent_job_data& data, job_handle parent)
+	{
+		for (uint32 i = 0; i < data.numJobs; ++i)
+		{
+			raycast_job_data jobData = data.base;
+			jobData.first = i * data.numRaysPerJob;
+			jobData.count = min(data.numRaysPerJob, data.numRays - jobData.first);
+			jobData.arenaIndex = i;
+
+			highPriorityJobQueue.createJob<raycast_job_data>([](raycast_job_data& data, job_handle)
+			{
+				memory_arena& arena = raycastArenas[data.arenaIndex];
+				for (uint32 i = data.first; i < data.first + data.count; ++i)
+				{
+					float maxDistance = data.maxDistances ? data.maxDistances[i] : FLT_MAX;
+					data.outHits[i] = raycastInternal(*data.scene, *data.context, data.rays[i], maxDistance, arena, data.filter);
+				}
+				arena.reset();
+			}, jobData, parent).submitNow();
+		}
+	}, data);
+
+	parentJob.submitNow();
+	parentJob.waitForCompletion();
+}
+
+
+
+
+// Sweeps and overlaps.
+
+template <typename support_t>
+struct translated_support_fn
+{
+	const support_t& s;
+	vec3 offset;
+
+	vec3 operator()(const vec3& dir) const
+	{
+		return s(dir) + offset;
+	}
+};
+
+struct triangle_support_fn
+{
+	vec3 a, b, c;
+
+	vec3 operator()(const vec3& dir) const
+	{
+		float da = dot(dir, a);
+		float db = dot(dir, b);
+		float dc = dot(dir, c);
+		return (da > db) ? ((da > dc) ? a : c) : ((db > dc) ? b : c);
+	}
+};
+
+// Calls func(support, radius) with the support function of the collider's core shape.
+template <typename func_t>
+static bool visitColliderSupport(const collider_union& collider, const func_t& func)
+{
+	switch (collider.type)
+	{
+		case collider_type_sphere: return func(point_support_fn{ collider.sphere.center }, collider.sphere.radius);
+		case collider_type_capsule: return func(segment_support_fn{ collider.capsule.positionA, collider.capsule.positionB }, collider.capsule.radius);
+		case collider_type_cylinder: return func(cylinder_support_fn{ collider.cylinder }, 0.f);
+		case collider_type_aabb: return func(aabb_support_fn{ collider.aabb }, 0.f);
+		case collider_type_obb: return func(obb_support_fn{ collider.obb }, 0.f);
+		case collider_type_hull: return func(hull_support_fn{ collider.hull }, 0.f);
+	}
+	return false;
+}
+
+// Conservative advancement: Move shape A along the direction by the current distance divided by the approach speed, until the shapes touch.
+template <typename support_a_t, typename support_b_t>
+static bool sweepShapes(const support_a_t& a, float radiusA, const support_b_t& b, float radiusB, vec3 direction, float maxT,
+	float& outT, vec3& outPoint, vec3& outNormal)
+{
+	const float tolerance = 1e-3f;
+
+	float t = 0.f;
+	for (uint32 iteration = 0; iteration < 32; ++iteration)
+	{
+		gjk_distance_result result;
+		if (!gjkDistance(translated_support_fn<support_a_t>{ a, direction * t }, b, result) || result.distance <= 0.f)
+		{
+			// Cores overlap. This only happens if the shapes initially overlap.
+			outT = t;
+			outPoint = a(direction) + direction * t;
+			outNormal = -direction;
+			return true;
+		}
+
+		vec3 normal = (result.closestPointB - result.closestPointA) / result.distance; // From A to B.
+		float distance = result.distance - radiusA - radiusB;
+
+		if (distance <= tolerance)
+		{
+			outT = t;
+			outPoint = result.closestPointB - normal * radiusB;
+			outNormal = -normal;
+			return true;
+		}
+
+		float approachSpeed = dot(direction, normal);
+		if (approachSpeed <= 0.f)
+		{
+			return false;
+		}
+
+		t += distance / approachSpeed;
+		if (t > maxT)
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+template <typename support_a_t, typename support_b_t>
+static bool overlapShapes(const support_a_t& a, float radiusA, const support_b_t& b, float radiusB)
+{
+	gjk_distance_result result;
+	return !gjkDistance(a, b, result) || result.distance <= radiusA + radiusB;
+}
+
+template <typename support_t>
+static scene_query_hit sweepInternal(game_scene& scene, const support_t& support, float radius, const bounding_box& shapeAABB,
+	vec3 direction, float maxDistance, memory_arena& arena, uint32 filter)
+{
+	entity_handle hitEntity = entt::null;
+
+	scene_query_hit result;
+	result.entity = { hitEntity, scene };
+	result.distance = maxDistance;
+
+	float length = ::length(direction);
+	if (length == 0.f)
+	{
+		return result;
+	}
+	direction *= 1.f / length;
+
+	vec3 center = shapeAABB.getCenter();
+	vec3 extent = shapeAABB.getRadius();
+
+	float maxT = maxDistance;
+
+	const scene_query_context& context = getSceneQueryContext(scene);
+	traverseBVH(context, center, direction, extent, maxT, [&](uint32 index)
+	{
+		if (!passesFilter(context.colliders[index], filter))
+		{
+			return;
+		}
+
+		collider_union collider = getCollider(context, index);
+
+		float t;
+		vec3 point, normal;
+		bool hit = visitColliderSupport(collider, [&](const auto& otherSupport, float otherRadius)
+		{
+			return sweepShapes(support, radius, otherSupport, otherRadius, direction, maxT, t, point, normal);
+		});
+
+		if (hit && t < maxT)
+		{
+			maxT = t;
+			hitEntity = context.entities[index];
+			result.point = point;
+			result.normal = normal;
+		}
+	});
+
+	if (filter & scene_query_filter_heightmaps)
+	{
+		for (auto [entityHandle, heightmap] : scene.view<heightmap_collider_component>().each())
+		{
+			walkHeightmap(heightmap, center, direction, extent, maxT, arena, [&](vec3 a, vec3 b, vec3 c, uint32)
+			{
+				float t;
+				vec3 point, normal;
+				if (sweepShapes(support, radius, triangle_support_fn{ a, b, c }, 0.f, direction, maxT, t, point, normal) && t < maxT)
+				{
+					maxT = t;
+					hitEntity = entityHandle;
+					result.point = point;
+					result.normal = normal;
+				}
+			});
+		}
+	}
+
+	if (hitEntity != entt::null)
+	{
+		result.entity = { hitEntity, scene };
+		result.distance = maxT;
+	}
+
+	return result;
+}
+
+template <typename support_t>
+static uint32 overlapInternal(game_scene& scene, const support_t& support, float radius, const bounding_box& shapeAABB,
+	scene_entity* outEntities, uint32 maxNumEntities, memory_arena& arena, uint32 filter)
+{
+	uint32 numEntities = 0;
+
+	const scene_query_context& context = getSceneQueryContext(scene);
+	traverseBVH(context, shapeAABB, [&](uint32 index)
+	{
+		if (numEntities >= maxNumEntities || !passesFilter(context.colliders[index], filter))
+		{
+			return;
+		}
+
+		collider_union collider = getCollider(context, index);
+
+		bool overlaps = visitColliderSupport(collider, [&](const auto& otherSupport, float otherRadius)
+		{
+			return overlapShapes(support, radius, otherSupport, otherRadius);
+		});
+
+		if (overlaps)
+		{
+			outEntities[numEntities++] = { context.entities[index], scene };
+		}
+	});
+
+	if (filter & scene_query_filter_heightmaps)
+	{
+		for (auto [entityHandle, heightmap] : scene.view<heightmap_collider_component>().each())
+		{
+			bool overlaps = false;
+			float maxT = 0.f;
+			walkHeightmap(heightmap, shapeAABB.getCenter(), vec3(0.f, 1.f, 0.f), shapeAABB.getRadius(), maxT, arena, [&](vec3 a, vec3 b, vec3 c, uint32)
+			{
+				overlaps |= overlapShapes(support, radius, triangle_support_fn{ a, b, c }, 0.f);
+			});
+
+			if (overlaps && numEntities < maxNumEntities)
+			{
+				outEntities[numEntities++] = { entityHandle, scene };
+			}
+		}
+	}
+
+	return numEntities;
+}
+
+static bounding_box getCapsuleAABB(const bounding_capsule& capsule)
+{
+	bounding_box result = bounding_box::negativeInfinity();
+	result.grow(min(capsule.positionA, capsule.positionB));
+	result.grow(max(capsule.positionA, capsule.positionB));
+	result.pad(vec3(capsule.radius));
+	return result;
+}
+
+scene_query_hit sweep(game_scene& scene, const bounding_sphere& sphere, vec3 direction, float maxDistance, memory_arena& arena, uint32 filter)
+{
+	CPU_PROFILE_BLOCK("Sphere sweep");
+	return sweepInternal(scene, point_support_fn{ sphere.center }, sphere.radius, bounding_box::fromCenterRadius(sphere.center, sphere.radius),
+		direction, maxDistance, arena, filter);
+}
+
+scene_query_hit sweep(game_scene& scene, const bounding_capsule& capsule, vec3 direction, float maxDistance, memory_arena& arena, uint32 filter)
+{
+	CPU_PROFILE_BLOCK("Capsule sweep");
+	return sweepInternal(scene, segment_support_fn{ capsule.positionA, capsule.positionB }, capsule.radius, getCapsuleAABB(capsule),
+		direction, maxDistance, arena, filter);
+}
+
+scene_query_hit sweep(game_scene& scene, const bounding_oriented_box& box, vec3 direction, float maxDistance, memory_arena& arena, uint32 filter)
+{
+	CPU_PROFILE_BLOCK("Box sweep");
+	return sweepInternal(scene, obb_support_fn{ box }, 0.f, box.getAABB(), direction, maxDistance, arena, filter);
+}
+
+uint32 overlap(game_scene& scene, const bounding_sphere& sphere, scene_entity* outEntities, uint32 maxNumEntities, memory_arena& arena, uint32 filter)
+{
+	CPU_PROFILE_BLOCK("Sphere overlap");
+	return overlapInternal(scene, point_support_fn{ sphere.center }, sphere.radius, bounding_box::fromCenterRadius(sphere.center, sphere.radius),
+		outEntities, maxNumEntities, arena, filter);
+}
+
+uint32 overlap(game_scene& scene, const bounding_capsule& capsule, scene_entity* outEntities, uint32 maxNumEntities, memory_arena& arena, uint32 filter)
+{
+	CPU_PROFILE_BLOCK("Capsule overlap");
+	return overlapInternal(scene, segment_support_fn{ capsule.positionA, capsule.positionB }, capsule.radius, getCapsuleAABB(capsule),
+		outEntities, maxNumEntities, arena, filter);
+}
+
+uint32 overlap(game_scene& scene, const bounding_oriented_box& box, scene_entity* outEntities, uint32 maxNumEntities, memory_arena& arena, uint32 filter)
+{
+	CPU_PROFILE_BLOCK("Box overlap");
+	return overlapInternal(scene, obb_support_fn{ box }, 0.f, box.getAABB(), outEntities, maxNumEntities, arena, filter);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "physics.h"
+
+// Scene queries (raycasts, shape sweeps and overlaps) against colliders and heightmaps.
+// Colliders are accelerated by a bounding volume hierarchy. Each physics step marks it as outdated and the first query after the step refits
+// it to the new collider bounds, so steps without queries don't pay for it. It is only rebuilt when colliders were added or removed, or when
+// refitting has loosened it too much. Queries see the colliders at the state of the last physics step.
+// The update is not thread safe: Run queries from a single thread or through raycastBatch.
+
+enum scene_query_filter : uint32
+{
+	scene_query_filter_rigid_bodies = (1 << physics_object_type_rigid_body),
+	scene_query_filter_static_colliders = (1 << physics_object_type_static_collider),
+	scene_query_filter_force_fields = (1 << physics_object_type_force_field),
+	scene_query_filter_triggers = (1 << physics_object_type_trigger),
+	scene_query_filter_heightmaps = (1 << physics_object_type_count),
+
+	scene_query_filter_default = scene_query_filter_rigid_bodies | scene_query_filter_static_colliders | scene_query_filter_heightmaps,
+	scene_query_filter_all = scene_query_filter_default | scene_query_filter_force_fields | scene_query_filter_triggers,
+};
+
+struct scene_query_hit
+{
+	scene_entity entity; // The entity owning the collider (or the heightmap). Null, if nothing was hit.
+	vec3 point;
+	vec3 normal; // Surface normal of the hit object.
+	float distance;
+
+	operator bool() const { return entity; }
+};
+
+// Lets the next query update the acceleration structure from the current collider transforms. This is called automatically by physicsStep,
+// but can be called manually, e.g. if the scene has been edited while the physics simulation is paused.
+void invalidateSceneQueryStructure(game_scene& scene);
+
+// The ray direction does not need to be normalized. Rays starting inside a collider don't hit this collider.
+scene_query_hit raycast(game_scene& scene, ray r, float maxDistance, memory_arena& arena, uint32 filter = scene_query_filter_default);
+
+// Performs numRays raycasts in parallel. outHits must be numRays long. maxDistances may be null, in which case all rays are infinitely long.
+void raycastBatch(game_scene& scene, const ray* rays, const float* maxDistances, uint32 numRays, scene_query_hit* outHits, uint32 filter = scene_query_filter_default);
+
+// Sweeps the shape along direction (does not need to be normalized) and reports the first hit. If the shape initially overlaps an object,
+// the hit has distance 0.
+scene_query_hit sweep(game_scene& scene, const bounding_sphere& sphere, vec3 direction, float maxDistance, memory_arena& arena, uint32 filter = scene_query_filter_default);
+scene_query_hit sweep(game_scene& scene, const bounding_capsule& capsule, vec3 direction, float maxDistance, memory_arena& arena, uint32 filter = scene_query_filter_default);
+scene_query_hit sweep(game_scene& scene, const bounding_oriented_box& box, vec3 direction, float maxDistance, memory_arena& arena, uint32 filter = scene_query_filter_default);
+
+// Writes all entities overlapping the shape to outEntities (at most maxNumEntities) and returns the number of overlapping entities.
+// An entity with multiple overlapping colliders is reported multiple times.
+uint32 overlap(game_scene& scene, const bounding_sphere& sphere, scene_entity* outEntities, uint32 maxNumEntities, memory_arena& arena, uint32 filter = scene_query_filter_default);
+uint32 overlap(game_scene& scene, const bounding_capsule& capsule, scene_entity* outEntities, uint32 maxNumEntities, memory_arena& arena, uint32 filter = scene_query_filter_default);
+uint32 overlap(game_scene& scene, const bounding_oriented_box& box, scene_entity* outEntities, uint32 maxNumEntities, memory_arena& arena, uint32 filter = scene_query_filter_default);
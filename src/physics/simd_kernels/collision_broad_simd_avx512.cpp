@@ -0,0 +1,8 @@
+// Compiles the collision_broad kernels for AVX-512 (F, BW, DQ and VL), see core/simd_dispatch.h.
+#include "pch.h"
+#include "core/simd.h"
+#if !defined(SIMD_AVX_512)
+#error "This file must be compiled with AVX-512."
+#endif
+
+#include "../collision_broad_simd.cpp"
@@ -0,0 +1,8 @@
+// Compiles the constraints kernels for SSE2, see core/simd_dispatch.h. Built without AVX flags.
+#include "pch.h"
+#include "core/simd.h"
+#if defined(SIMD_AVX_2)
+#error "This file must be compiled without AVX2."
+#endif
+
+#include "../constraints_simd.cpp"
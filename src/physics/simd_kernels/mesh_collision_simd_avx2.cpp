@@ -0,0 +1,8 @@
+// Compiles the mesh collision kernels for AVX2 and FMA, see core/simd_dispatch.h.
+#include "pch.h"
+#include "core/simd.h"
+#if !defined(SIMD_AVX_2) || defined(SIMD_AVX_512)
+#error "This file must be compiled with AVX2 and FMA, but without AVX-512."
+#endif
+
+#include "../mesh_collision_simd.cpp"
@@ -1,6 +1,12 @@
 #include "pch.h"
 #include "vehicle.h"
 
+#ifndef PHYSICS_ONLY
+#include "rendering/pbr.h"
+#include "geometry/mesh.h"
+#include "geometry/mesh_builder.h"
+#endif
+
 
 struct gear_description
 {
@@ -52,7 +58,16 @@ struct axis_attachment
 		: type(attachment_type_wheel), rodLength(rodLength), rodThickness(rodThickness), wheel(wheel) {}
 };
 
-static void attach(mesh_builder& builder, ref<pbr_material> material, scene_entity axis, axis_attachment& attachment, float sign)
+// Meshes for all parts are accumulated here. Empty in the physics-only build, where only colliders and constraints are created.
+struct vehicle_graphics
+{
+#ifndef PHYSICS_ONLY
+	mesh_builder builder;
+	ref<pbr_material> material;
+#endif
+};
+
+static void attach(vehicle_graphics& graphics, scene_entity axis, axis_attachment& attachment, float sign)
 {
 	float rodOffset = attachment.rodLength * sign;
 
@@ -62,6 +77,7 @@ static void attach(mesh_builder& builder, ref<pbr_material> material, scene_enti
 		{
 			gear_description desc = attachment.gear;
 
+#ifndef PHYSICS_ONLY
 			if (desc.cylinderInnerRadius > 0.f)
 			{
 				hollow_cylinder_mesh_desc m;
@@ -71,7 +87,7 @@ static void attach(mesh_builder& builder, ref<pbr_material> material, scene_enti
 				m.innerRadius = desc.cylinderInnerRadius;
 				m.slices = 21;
 
-				builder.pushHollowCylinder(m);
+				graphics.builder.pushHollowCylinder(m);
 			}
 			else
 			{
@@ -81,8 +97,9 @@ static void attach(mesh_builder& builder, ref<pbr_material> material, scene_enti
 				m.radius = desc.cylinderRadius;
 				m.slices = 21;
 
-				builder.pushCylinder(m);
+				graphics.builder.pushCylinder(m);
 			}
+#endif
 
 			for (uint32 i = 0; i < desc.numTeeth; ++i)
 			{
@@ -91,12 +108,14 @@ static void attach(mesh_builder& builder, ref<pbr_material> material, scene_enti
 				vec3 center = localRotation * vec3(desc.cylinderRadius + desc.toothLength * 0.5f, 0.f, 0.f);
 				vec3 radius(desc.toothLength * 0.5f, desc.height * 0.5f, desc.toothWidth * 0.5f);
 				
+#ifndef PHYSICS_ONLY
 				capsule_mesh_desc m;
 				m.center = center + vec3(0.f, rodOffset, 0.f);
 				m.height = desc.toothLength;
 				m.radius = desc.toothWidth * 0.5f;
 				m.rotation = localRotation * quat(vec3(0.f, 0.f, 1.f), deg2rad(90.f));
-				builder.pushCapsule(m);
+				graphics.builder.pushCapsule(m);
+#endif
 
 				bounding_capsule capsule;
 				capsule.positionA = center + vec3(0.f, rodOffset, 0.f) - localRotation * vec3(desc.toothLength * 0.5f, 0.f, 0.f);
@@ -112,13 +131,15 @@ static void attach(mesh_builder& builder, ref<pbr_material> material, scene_enti
 		{
 			wheel_description desc = attachment.wheel;
 
+#ifndef PHYSICS_ONLY
 			hollow_cylinder_mesh_desc m;
 			m.center = vec3(0.f, rodOffset, 0.f);
 			m.height = desc.height;
 			m.radius = desc.radius;
 			m.innerRadius = desc.innerRadius;
 			m.slices = 21;
-			builder.pushHollowCylinder(m);
+			graphics.builder.pushHollowCylinder(m);
+#endif
 
 			bounding_cylinder cylinder;
 			cylinder.positionA = vec3(0.f, rodOffset - desc.height * 0.5f, 0.f);
@@ -129,56 +150,64 @@ static void attach(mesh_builder& builder, ref<pbr_material> material, scene_enti
 		} break;
 	}
 
+#ifndef PHYSICS_ONLY
 	if (attachment.rodLength > 0.f)
 	{
 		box_mesh_desc m;
 		m.radius = vec3(attachment.rodThickness * 0.5f, attachment.rodLength * 0.5f, attachment.rodThickness * 0.5f);
 		m.center = vec3(0.f, rodOffset * 0.5f, 0.f);
-		builder.pushBox(m);
+		graphics.builder.pushBox(m);
 	}
+#endif
 }
 
-static scene_entity createAxis(game_scene& scene, mesh_builder& builder, ref<pbr_material> material,
+// Adds the submesh accumulated since the last call as a mesh component.
+static void addVehiclePartMesh(vehicle_graphics& graphics, scene_entity entity)
+{
+#ifndef PHYSICS_ONLY
+	auto mesh = make_ref<multi_mesh>();
+	mesh->submeshes.push_back({ graphics.builder.endSubmesh(), {}, trs::identity, graphics.material });
+	entity.addComponent<mesh_component>(mesh);
+#endif
+}
+
+static scene_entity createAxis(game_scene& scene, vehicle_graphics& graphics,
 	vec3 position, quat rotation, gear_description desc, axis_attachment* firstAttachment = 0, axis_attachment* secondAttachment = 0)
 {
 	scene_entity axis = scene.createEntity("Axis")
 		.addComponent<transform_component>(position, rotation);
 
-	auto mesh = make_ref<multi_mesh>();
-
 	axis_attachment centerGearAttachment(0.f, 0.f, desc);
-	attach(builder, material, axis, centerGearAttachment, 1.f);
+	attach(graphics, axis, centerGearAttachment, 1.f);
 
 	if (firstAttachment)
 	{
-		attach(builder, material, axis, *firstAttachment, 1.f);
+		attach(graphics, axis, *firstAttachment, 1.f);
 
 	}
 	if (secondAttachment)
 	{
-		attach(builder, material, axis, *secondAttachment, -1.f);
+		attach(graphics, axis, *secondAttachment, -1.f);
 	}
 
-	mesh->submeshes.push_back({ builder.endSubmesh(), {}, trs::identity, material });
-
-	axis.addComponent<mesh_component>(mesh);
+	addVehiclePartMesh(graphics, axis);
 	axis.addComponent<rigid_body_component>(false);
 
 	return axis;
 }
 
-static scene_entity createGearAxis(game_scene& scene, mesh_builder& builder, ref<pbr_material> material,
+static scene_entity createGearAxis(game_scene& scene, vehicle_graphics& graphics,
 	vec3 position, quat rotation, float length, uint32 numTeeth, float toothLength, float toothWidth, 
 	float friction, float density)
 {
 	scene_entity axis = scene.createEntity("Gear Axis")
 		.addComponent<transform_component>(position, rotation);
 
-	auto mesh = make_ref<multi_mesh>();
-
+#ifndef PHYSICS_ONLY
 	box_mesh_desc m;
 	m.radius = vec3(length * 0.5f, toothWidth * 0.5f, toothWidth * 0.5f);
-	builder.pushBox(m);
+	graphics.builder.pushBox(m);
+#endif
 
 
 	float distance = length - toothWidth;
@@ -199,35 +228,35 @@ static scene_entity createGearAxis(game_scene& scene, mesh_builder& builder, ref
 
 		axis.addComponent<collider_component>(collider_component::asCapsule(capsule, { physics_material_type_wood, 0.2f, friction, density }));
 
+#ifndef PHYSICS_ONLY
 		capsule_mesh_desc m;
 		m.center = center;
 		m.height = toothLength;
 		m.radius = toothWidth * 0.5f;
-		builder.pushCapsule(m);
+		graphics.builder.pushCapsule(m);
+#endif
 	}
 
-	axis.addComponent<mesh_component>(mesh);
+	addVehiclePartMesh(graphics, axis);
 	axis.addComponent<rigid_body_component>(false);
 
-	mesh->submeshes.push_back({ builder.endSubmesh(), {}, trs::identity, material });
-
 	return axis;
 }
 
-static scene_entity createWheel(game_scene& scene, mesh_builder& builder, ref<pbr_material> material,
+static scene_entity createWheel(game_scene& scene, vehicle_graphics& graphics,
 	vec3 position, quat rotation, wheel_description desc)
 {
 	scene_entity result = scene.createEntity("Wheel")
 		.addComponent<transform_component>(position, rotation);
 
-	auto mesh = make_ref<multi_mesh>();
-
+#ifndef PHYSICS_ONLY
 	hollow_cylinder_mesh_desc m;
 	m.height = desc.height;
 	m.radius = desc.radius;
 	m.innerRadius = desc.innerRadius;
 	m.slices = 21;
-	builder.pushHollowCylinder(m);
+	graphics.builder.pushHollowCylinder(m);
+#endif
 
 	bounding_cylinder cylinder;
 	cylinder.positionA = vec3(0.f, -desc.height * 0.5f, 0.f);
@@ -236,22 +265,19 @@ static scene_entity createWheel(game_scene& scene, mesh_builder& builder, ref<pb
 
 	result.addComponent<collider_component>(collider_component::asCylinder(cylinder, { physics_material_type_wood, 0.2f, desc.friction, desc.density }));
 
-	result.addComponent<mesh_component>(mesh);
+	addVehiclePartMesh(graphics, result);
 	result.addComponent<rigid_body_component>(false);
 
-	mesh->submeshes.push_back({ builder.endSubmesh(), {}, trs::identity, material });
-
 	return result;
 }
 
-static scene_entity createWheelSuspension(game_scene& scene, mesh_builder& builder, ref<pbr_material> material,
+static scene_entity createWheelSuspension(game_scene& scene, vehicle_graphics& graphics,
 	vec3 position, quat rotation, float axisLength, float thickness, bool right)
 {
 	scene_entity result = scene.createEntity("Wheel suspension")
 		.addComponent<transform_component>(position, rotation);
 
-	auto mesh = make_ref<multi_mesh>();
-
+#ifndef PHYSICS_ONLY
 	float xSign = right ? 1.f : -1.f;
 
 	cylinder_mesh_desc m;
@@ -259,23 +285,22 @@ static scene_entity createWheelSuspension(game_scene& scene, mesh_builder& build
 	m.center = vec3(axisLength * 0.5f * xSign, 0.f, 0.f);
 	m.radius = thickness * 0.5f;
 	m.rotation = quat(vec3(0.f, 0.f, 1.f), deg2rad(90.f));
-	builder.pushCylinder(m);
+	graphics.builder.pushCylinder(m);
 
 	m.center = vec3(0.f, 0.f, axisLength * 0.5f);
 	m.rotation = quat(vec3(1.f, 0.f, 0.f), deg2rad(90.f));
-	builder.pushCylinder(m);
+	graphics.builder.pushCylinder(m);
+#endif
 
 	// These rigid bodies don't have colliders, since they penetrate the wheels.
 
-	result.addComponent<mesh_component>(mesh);
+	addVehiclePartMesh(graphics, result);
 	result.addComponent<rigid_body_component>(false);
 
-	mesh->submeshes.push_back({ builder.endSubmesh(), {}, trs::identity, material });
-
 	return result;
 }
 
-static scene_entity createRod(game_scene& scene, mesh_builder& builder, ref<pbr_material> material, 
+static scene_entity createRod(game_scene& scene, vehicle_graphics& graphics, 
 	vec3 from, vec3 to, float thickness)
 {
 	vec3 position = (from + to) * 0.5f;
@@ -286,17 +311,15 @@ static scene_entity createRod(game_scene& scene, mesh_builder& builder, ref<pbr_
 	scene_entity result = scene.createEntity("Rod")
 		.addComponent<transform_component>(position, rotation);
 
-	auto mesh = make_ref<multi_mesh>();
-
+#ifndef PHYSICS_ONLY
 	box_mesh_desc m;
 	m.radius = vec3(thickness * 0.5f, len * 0.5f, thickness * 0.5f);
-	builder.pushBox(m);
+	graphics.builder.pushBox(m);
+#endif
 
-	result.addComponent<mesh_component>(mesh);
+	addVehiclePartMesh(graphics, result);
 	result.addComponent<rigid_body_component>(false);
 
-	mesh->submeshes.push_back({ builder.endSubmesh(), {}, trs::identity, material });
-
 	return result;
 }
 
@@ -305,10 +328,11 @@ void vehicle::initialize(game_scene& scene, vec3 initialMotorPosition, float ini
 	float density = 2000.f;
 
 
-	mesh_builder builder;
-
+	vehicle_graphics graphics;
 
-	auto material = createPBRMaterial({ "assets/desert/textures/WoodenCrate2_Albedo.png", "assets/desert/textures/WoodenCrate2_Normal.png" });
+#ifndef PHYSICS_ONLY
+	graphics.material = createPBRMaterial({ "assets/desert/textures/WoodenCrate2_Albedo.png", "assets/desert/textures/WoodenCrate2_Normal.png" });
+#endif
 
 
 	motor = scene.createEntity("Motor")
@@ -316,17 +340,15 @@ void vehicle::initialize(game_scene& scene, vec3 initialMotorPosition, float ini
 		.addComponent<collider_component>(collider_component::asAABB(bounding_box::fromCenterRadius(vec3(0.f), vec3(0.6f, 0.1f, 1.f)), { physics_material_type_wood, 0.2f, 0.f, density }))
 		.addComponent<rigid_body_component>(false);
 
+#ifndef PHYSICS_ONLY
 	{	
-		auto motorMesh = make_ref<multi_mesh>();
-
 		box_mesh_desc m;
 		m.radius = vec3(0.6f, 0.1f, 1.f);
-		builder.pushBox(m);
-
-		motorMesh->submeshes.push_back({ builder.endSubmesh(), {}, trs::identity, material });
-
-		motor.addComponent<mesh_component>(motorMesh);
+		graphics.builder.pushBox(m);
 	}
+#endif
+
+	addVehiclePartMesh(graphics, motor);
 
 	gear_description motorGearDesc;
 	motorGearDesc.height = 0.1f;
@@ -362,7 +384,7 @@ void vehicle::initialize(game_scene& scene, vec3 initialMotorPosition, float ini
 	float gearOffset = 0.26f;
 
 	// Motor gear.
-	motorGear = createAxis(scene, builder, material, vec3(0.f, motorGearY, 0.f), quat::identity, motorGearDesc);
+	motorGear = createAxis(scene, graphics, vec3(0.f, motorGearY, 0.f), quat::identity, motorGearDesc);
 	auto motorConstraintHandle = addHingeConstraintFromGlobalPoints(motor, motorGear, vec3(0.f, motorGearY, 0.f), vec3(0.f, 1.f, 0.f));
 
 	auto& motorConstraint = getConstraint(scene, motorConstraintHandle);
@@ -372,7 +394,7 @@ void vehicle::initialize(game_scene& scene, vec3 initialMotorPosition, float ini
 	// Drive axis.
 	float driveAxisLength = 4.5f;
 	axis_attachment driveAxisAttachment(driveAxisLength * 0.57f - 1.1f, rodThickness, motorGearDesc);
-	driveAxis = createAxis(scene, builder, material, vec3(0.f, motorGearY + gearOffset, gearOffset), quat(vec3(-1.f, 0.f, 0.f), deg2rad(90.f)),
+	driveAxis = createAxis(scene, graphics, vec3(0.f, motorGearY + gearOffset, gearOffset), quat(vec3(-1.f, 0.f, 0.f), deg2rad(90.f)),
 		motorGearDesc, 0, &driveAxisAttachment);
 	addHingeConstraintFromGlobalPoints(motor, driveAxis, vec3(0.f, motorGearY + gearOffset, gearOffset), vec3(0.f, 0.f, 1.f));
 
@@ -382,14 +404,14 @@ void vehicle::initialize(game_scene& scene, vec3 initialMotorPosition, float ini
 
 	float frontAxisOffsetZ = -driveAxisLength * 0.5f + gearOffset * 2.f;
 	vec3 frontAxisPos(0.f, motorGearY + gearOffset, frontAxisOffsetZ);
-	frontAxis = createRod(scene, builder, material, frontAxisPos + vec3(axisLength, 0.f, 0.f), frontAxisPos - vec3(axisLength, 0.f, 0.f), 0.05f);
+	frontAxis = createRod(scene, graphics, frontAxisPos + vec3(axisLength, 0.f, 0.f), frontAxisPos - vec3(axisLength, 0.f, 0.f), 0.05f);
 	addFixedConstraintFromGlobalPoints(motor, frontAxis, frontAxisPos);
 
 	// Steering wheel.
 	axis_attachment steeringWheelAttachment(2.f, rodThickness, motorGearDesc);
 	quat steeringWheelRot(vec3(-1.f, 0.f, 0.f), deg2rad(-80.f));
 	vec3 steeringWheelPos(0.f, 1.12f, 0.81f);
-	steeringWheel = createAxis(scene, builder, material, steeringWheelPos,
+	steeringWheel = createAxis(scene, graphics, steeringWheelPos,
 		steeringWheelRot, steeringWheelDesc, 0, &steeringWheelAttachment);
 	auto steeringWheelConstraintHandle = addHingeConstraintFromGlobalPoints(motor, steeringWheel, steeringWheelPos, steeringWheelRot * vec3(0.f, -1.f, 0.f));
 
@@ -401,7 +423,7 @@ void vehicle::initialize(game_scene& scene, vec3 initialMotorPosition, float ini
 	// Steering axis.
 	vec3 steeringAxisPos(0.f, motorGearY + gearOffset + 0.06f, frontAxisOffsetZ + 0.49f);
 	float steeringAxisLength = axisLength * 1.05f;
-	steeringAxis = createGearAxis(scene, builder, material, steeringAxisPos, steeringWheelRot, steeringAxisLength, 8,
+	steeringAxis = createGearAxis(scene, graphics, steeringAxisPos, steeringWheelRot, steeringAxisLength, 8,
 		motorGearDesc.toothLength, motorGearDesc.toothWidth, motorGearDesc.friction, motorGearDesc.density);
 	addSliderConstraintFromGlobalPoints(motor, steeringAxis, steeringAxisPos, vec3(1.f, 0.f, 0.f), -4.f, 4.f);
 
@@ -411,30 +433,30 @@ void vehicle::initialize(game_scene& scene, vec3 initialMotorPosition, float ini
 	// Left wheel suspension.
 	vec3 leftWheelSuspensionPos = frontAxisPos - vec3(axisLength, 0.f, 0.f);
 	vec3 leftWheelSuspensionAttachmentPos = leftWheelSuspensionPos + vec3(0.f, 0.f, suspensionLength);
-	leftWheelSuspension = createWheelSuspension(scene, builder, material, leftWheelSuspensionPos, quat::identity, suspensionLength, 0.1f, false);
+	leftWheelSuspension = createWheelSuspension(scene, graphics, leftWheelSuspensionPos, quat::identity, suspensionLength, 0.1f, false);
 	addHingeConstraintFromGlobalPoints(motor, leftWheelSuspension, leftWheelSuspensionPos, vec3(0.f, 1.f, 0.f), deg2rad(-45.f), deg2rad(45.f));
 
 	// Right wheel suspension.
 	vec3 rightWheelSuspensionPos = frontAxisPos + vec3(axisLength, 0.f, 0.f);
 	vec3 rightWheelSuspensionAttachmentPos = rightWheelSuspensionPos + vec3(0.f, 0.f, suspensionLength);
-	rightWheelSuspension = createWheelSuspension(scene, builder, material, rightWheelSuspensionPos, quat::identity, suspensionLength, 0.1f, true);
+	rightWheelSuspension = createWheelSuspension(scene, graphics, rightWheelSuspensionPos, quat::identity, suspensionLength, 0.1f, true);
 	addHingeConstraintFromGlobalPoints(motor, rightWheelSuspension, rightWheelSuspensionPos, vec3(0.f, 1.f, 0.f), deg2rad(-45.f), deg2rad(45.f));
 
 
 	// Left front wheel.
 	vec3 leftFrontWheelPos = leftWheelSuspensionPos - vec3(suspensionLength * 0.5f, 0.f, 0.f);
-	leftFrontWheel = createWheel(scene, builder, material, leftFrontWheelPos, quat(vec3(0.f, 0.f, 1.f), deg2rad(90.f)), wheelDesc);
+	leftFrontWheel = createWheel(scene, graphics, leftFrontWheelPos, quat(vec3(0.f, 0.f, 1.f), deg2rad(90.f)), wheelDesc);
 
 	// Right front wheel.
 	vec3 rightFrontWheelPos = rightWheelSuspensionPos + vec3(suspensionLength * 0.5f, 0.f, 0.f);
-	rightFrontWheel = createWheel(scene, builder, material, rightFrontWheelPos, quat(vec3(0.f, 0.f, 1.f), deg2rad(90.f)), wheelDesc);
+	rightFrontWheel = createWheel(scene, graphics, rightFrontWheelPos, quat(vec3(0.f, 0.f, 1.f), deg2rad(90.f)), wheelDesc);
 
 	addHingeConstraintFromGlobalPoints(leftFrontWheel, leftWheelSuspension, leftFrontWheelPos, vec3(1.f, 0.f, 0.f));
 	addHingeConstraintFromGlobalPoints(rightFrontWheel, rightWheelSuspension, rightFrontWheelPos, vec3(1.f, 0.f, 0.f));
 
 
-	leftWheelArm = createRod(scene, builder, material, leftSteeringAxisAttachmentPos, leftWheelSuspensionAttachmentPos, 0.05f);
-	rightWheelArm = createRod(scene, builder, material, rightSteeringAxisAttachmentPos, rightWheelSuspensionAttachmentPos, 0.05f);
+	leftWheelArm = createRod(scene, graphics, leftSteeringAxisAttachmentPos, leftWheelSuspensionAttachmentPos, 0.05f);
+	rightWheelArm = createRod(scene, graphics, rightSteeringAxisAttachmentPos, rightWheelSuspensionAttachmentPos, 0.05f);
 
 	addBallConstraintFromGlobalPoints(leftWheelSuspension, leftWheelArm, leftWheelSuspensionAttachmentPos);
 	addBallConstraintFromGlobalPoints(steeringAxis, leftWheelArm, leftSteeringAxisAttachmentPos);
@@ -455,21 +477,23 @@ void vehicle::initialize(game_scene& scene, vec3 initialMotorPosition, float ini
 	// Rear axis.
 	float rearAxisOffsetZ = driveAxisLength * 0.505f;
 	float rearAxisOffsetX = -gearOffset;
-	differentialSunGear = createAxis(scene, builder, material, vec3(rearAxisOffsetX, motorGearY + gearOffset, rearAxisOffsetZ), quat(vec3(0.f, 0.f, -1.f), deg2rad(90.f)), rearAxisGearDesc);
+	differentialSunGear = createAxis(scene, graphics, vec3(rearAxisOffsetX, motorGearY + gearOffset, rearAxisOffsetZ), quat(vec3(0.f, 0.f, -1.f), deg2rad(90.f)), rearAxisGearDesc);
 	addHingeConstraintFromGlobalPoints(motor, differentialSunGear, vec3(rearAxisOffsetX, motorGearY + gearOffset, rearAxisOffsetZ), vec3(1.f, 0.f, 0.f));
 
+#ifndef PHYSICS_ONLY
 	{
 		box_mesh_desc m;
 		m.radius = vec3(0.01f, gearOffset * 0.5f + 0.05f, 0.01f);
 		m.center = vec3(-rearAxisGearDesc.cylinderRadius * 0.9f, gearOffset * 0.5f + 0.05f, 0.f);
-		builder.pushBox(m);
-		differentialSunGear.getComponent<mesh_component>().mesh->submeshes.push_back({ builder.endSubmesh(), {}, trs::identity, material });
+		graphics.builder.pushBox(m);
+		differentialSunGear.getComponent<mesh_component>().mesh->submeshes.push_back({ graphics.builder.endSubmesh(), {}, trs::identity, graphics.material });
 	}
+#endif
 
 	// Differential.
 	vec3 differentialSpiderGearPos(0.11f, motorGearY + gearOffset * 2.f, rearAxisOffsetZ);
 	axis_attachment spiderGearAttachment(0.2f, 0.02f);
-	differentialSpiderGear = createAxis(scene, builder, material, differentialSpiderGearPos, quat::identity, motorGearDesc, &spiderGearAttachment);
+	differentialSpiderGear = createAxis(scene, graphics, differentialSpiderGearPos, quat::identity, motorGearDesc, &spiderGearAttachment);
 	addHingeConstraintFromGlobalPoints(differentialSunGear, differentialSpiderGear, differentialSpiderGearPos, vec3(0.f, 1.f, 0.f));
 
 	vec3 leftRearWheelPos = differentialSpiderGearPos + vec3(-gearOffset, -gearOffset, 0.f);
@@ -478,8 +502,8 @@ void vehicle::initialize(game_scene& scene, vec3 initialMotorPosition, float ini
 	axis_attachment leftWheelAttachment(axisLength + differentialSpiderGearPos.x, rodThickness, wheelDesc);
 	axis_attachment rightWheelAttachment(axisLength - differentialSpiderGearPos.x, rodThickness, wheelDesc);
 
-	leftRearWheel = createAxis(scene, builder, material, leftRearWheelPos, quat(vec3(0.f, 0.f, -1.f), deg2rad(90.f)), motorGearDesc, 0, &leftWheelAttachment);
-	rightRearWheel = createAxis(scene, builder, material, rightRearWheelPos, quat(vec3(0.f, 0.f, -1.f), deg2rad(90.f)), motorGearDesc, &rightWheelAttachment, 0);
+	leftRearWheel = createAxis(scene, graphics, leftRearWheelPos, quat(vec3(0.f, 0.f, -1.f), deg2rad(90.f)), motorGearDesc, 0, &leftWheelAttachment);
+	rightRearWheel = createAxis(scene, graphics, rightRearWheelPos, quat(vec3(0.f, 0.f, -1.f), deg2rad(90.f)), motorGearDesc, &rightWheelAttachment, 0);
 
 	addHingeConstraintFromGlobalPoints(motor, leftRearWheel, leftRearWheelPos, vec3(1.f, 0.f, 0.f));
 	addHingeConstraintFromGlobalPoints(motor, rightRearWheel, rightRearWheelPos, vec3(1.f, 0.f, 0.f));
@@ -487,10 +511,14 @@ void vehicle::initialize(game_scene& scene, vec3 initialMotorPosition, float ini
 
 	quat rotation(vec3(0.f, 1.f, 0.f), initialRotation);
 
-	auto mesh = builder.createDXMesh();
+#ifndef PHYSICS_ONLY
+	auto mesh = graphics.builder.createDXMesh();
+#endif
 	for (uint32 i = 0; i < arraysize(parts); ++i)
 	{
+#ifndef PHYSICS_ONLY
 		parts[i].getComponent<mesh_component>().mesh->mesh = mesh;
+#endif
 
 		auto& transform = parts[i].getComponent<transform_component>();
 		transform.position = rotation * transform.position + initialMotorPosition;
@@ -2,6 +2,7 @@
 #include "scene.h"
 #include "physics/physics.h"
 #include "physics/collision_broad.h"
+#include "physics/mesh_collision.h"
 #include "terrain/heightmap_collider.h"
 #include "rendering/raytracing.h"
 
@@ -9,7 +10,7 @@
 game_scene::game_scene()
 {
 	// Construct groups early. Ignore the return types.
-	(void)registry.group<collider_component, sap_endpoint_indirection_component>(); // Colliders and SAP endpoints are always sorted in the same order.
+	(void)registry.group<collider_component, sap_endpoint_indirection_component, aabb_tree_leaf_component>(); // Colliders and broadphase data are always sorted in the same order.
 	(void)registry.group<transform_component, dynamic_transform_component, rigid_body_component, physics_transform0_component, physics_transform1_component>();
 	(void)registry.group<transform_component, rigid_body_component, physics_transform0_component, physics_transform1_component>();
 
@@ -53,6 +54,7 @@ void game_scene::cloneTo(game_scene& target)
 		tree_component,
 #endif
 		heightmap_collider_component,
+		mesh_collider_component,
 
 		mesh_component,
 
@@ -67,6 +69,7 @@ void game_scene::cloneTo(game_scene& target)
 		cloth_component,
 		physics_reference_component,
 		sap_endpoint_indirection_component,
+		aabb_tree_leaf_component,
 		constraint_entity_reference_component,
 
 		physics_transform0_component,
@@ -118,6 +121,7 @@ scene_entity game_scene::copyEntity(scene_entity src)
 	if (auto* c = src.getComponentIfExists<force_field_component>()) { dest.addComponent<force_field_component>(*c); }
 	if (auto* c = src.getComponentIfExists<trigger_component>()) { dest.addComponent<trigger_component>(*c); }
 	if (auto* c = src.getComponentIfExists<cloth_component>()) { dest.addComponent<cloth_component>(*c); }
+	if (auto* c = src.getComponentIfExists<mesh_collider_component>()) { dest.addComponent<mesh_collider_component>(*c); }
 
 	// We don't copy physics constraints (because I cannot think of a good way to do this).
 
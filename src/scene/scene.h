@@ -100,10 +100,11 @@ struct scene_entity
 					cloth->setWorldPositionOfFixedVertices(component, true);
 				}
 
-				if (hasComponent<struct rigid_body_component>())
+				if (struct rigid_body_component* rb = getComponentIfExists<struct rigid_body_component>())
 				{
 					addComponent<struct physics_transform0_component>(component);
 					addComponent<struct physics_transform1_component>(component);
+					rb->wakeUp();
 				}
 			}
 		}
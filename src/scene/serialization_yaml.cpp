@@ -82,6 +82,7 @@ namespace YAML
 			n["Gravity factor"] = c.gravityFactor;
 			n["Linear damping"] = c.linearDamping;
 			n["Angular damping"] = c.angularDamping;
+			n["Continuous collision"] = c.continuousCollision;
 			return n;
 		}
 
@@ -95,6 +96,7 @@ namespace YAML
 			YAML_LOAD(n, c.gravityFactor, "Gravity factor");
 			YAML_LOAD(n, c.linearDamping, "Linear damping");
 			YAML_LOAD(n, c.angularDamping, "Angular damping");
+			YAML_LOAD(n, c.continuousCollision, "Continuous collision");
 
 			return true;
 		}
@@ -164,6 +166,8 @@ namespace YAML
 			n["Restitution"] = c.material.restitution;
 			n["Friction"] = c.material.friction;
 			n["Density"] = c.material.density;
+			n["Collision layer"] = c.collisionLayer;
+			n["Collision mask"] = c.collisionMask;
 			return n;
 		}
 
@@ -238,6 +242,9 @@ namespace YAML
 				default: ASSERT(false); break;
 			}
 
+			YAML_LOAD(n, c.collisionLayer, "Collision layer");
+			YAML_LOAD(n, c.collisionMask, "Collision mask");
+
 			return true;
 		}
 	};
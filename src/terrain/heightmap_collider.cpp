@@ -40,6 +40,12 @@ float heightmap_collider_component::getHeightAt(vec2 coord) const
 	return col.getHeightAt(coord, heightScale, this->minCorner.y);
 }
 
+bounding_box heightmap_collider_component::getBoundingBox() const
+{
+	float size = chunksPerDim * chunkSize;
+	return bounding_box::fromMinMax(minCorner, minCorner + vec3(size, 1.f / invAmplitudeScale, size));
+}
+
 void heightmap_collider_chunk::setHeights(uint16* heights)
 {
 	this->heights = heights;
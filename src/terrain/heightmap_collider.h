@@ -14,9 +14,11 @@ struct heightmap_collider_chunk
 {
 	void setHeights(uint16* heights);
 
+	// Triangle indices start at firstTriangleIndex, see heightmap_collider_component::iterateTrianglesInVolume.
 	template <typename callback_func>
 	void iterateTrianglesInVolume(uint32 volMinX, uint32 volMinZ, uint32 volMaxX, uint32 volMaxZ,
-		uint32 volMinY, uint32 volMaxY, float chunkScale, float heightScale, vec3 chunkMinCorner, memory_arena& arena, const callback_func& func) const;
+		uint32 volMinY, uint32 volMaxY, float chunkScale, float heightScale, vec3 chunkMinCorner, uint32 firstTriangleIndex,
+		memory_arena& arena, const callback_func& func) const;
 
 	float getHeightAt(vec2 coord, float heightScale, float heightOffset) const;
 
@@ -34,7 +36,8 @@ private:
 
 template <typename callback_func>
 void heightmap_collider_chunk::iterateTrianglesInVolume(uint32 volMinX, uint32 volMinZ, uint32 volMaxX, uint32 volMaxZ,
-	uint32 volMinY, uint32 volMaxY, float chunkScale, float heightScale, vec3 chunkMinCorner, memory_arena& arena, const callback_func& func) const
+	uint32 volMinY, uint32 volMaxY, float chunkScale, float heightScale, vec3 chunkMinCorner, uint32 firstTriangleIndex,
+	memory_arena& arena, const callback_func& func) const
 {
 	if (!heights)
 	{
@@ -100,8 +103,10 @@ void heightmap_collider_chunk::iterateTrianglesInVolume(uint32 volMinX, uint32 v
 			vec3 posD = vec3(d.x, heightD, d.y) + chunkMinCorner;
 
 
-			func(posA, posB, posC);
-			func(posC, posB, posD);
+			uint32 triangleIndex = firstTriangleIndex + 2 * (entry.z * (TERRAIN_LOD_0_VERTICES_PER_DIMENSION - 1) + entry.x);
+
+			func(posA, posB, posC, triangleIndex);
+			func(posC, posB, posD, triangleIndex + 1);
 		}
 		else
 		{
@@ -126,10 +131,13 @@ struct heightmap_collider_component
 
 	void update(vec3 minCorner, float amplitudeScale);
 
+	// Calls func(a, b, c, triangleIndex) for each triangle which may intersect the volume. The triangle index is unique within the heightmap
+	// and stays the same between frames.
 	template <typename callback_func>
 	void iterateTrianglesInVolume(bounding_box volume, memory_arena& arena, const callback_func& func) const;
 
 	float getHeightAt(vec2 coord) const; // Returns -FLT_MAX if outside bounds.
+	bounding_box getBoundingBox() const;
 
 	heightmap_collider_chunk& collider(uint32 x, uint32 z) { return colliders[z * chunksPerDim + x]; }
 	const heightmap_collider_chunk& collider(uint32 x, uint32 z) const { return colliders[z * chunksPerDim + x]; }
@@ -199,8 +207,11 @@ inline void heightmap_collider_component::iterateTrianglesInVolume(bounding_box
 
 			vec3 chunkMinCorner = vec3(x * chunkSize, 0.f, z * chunkSize) + this->minCorner;
 
+			const uint32 numSegmentsPerDim = TERRAIN_LOD_0_VERTICES_PER_DIMENSION - 1;
+			uint32 firstTriangleIndex = (z * chunksPerDim + x) * numSegmentsPerDim * numSegmentsPerDim * 2;
+
 			collider(x, z).iterateTrianglesInVolume(chunkSpaceMinX, chunkSpaceMinZ, chunkSpaceMaxX, chunkSpaceMaxZ, 
-				minHeight, maxHeight, chunkScale, heightScale, chunkMinCorner, arena, func);
+				minHeight, maxHeight, chunkScale, heightScale, chunkMinCorner, firstTriangleIndex, arena, func);
 		}
 	}
 }